@@ -7,16 +7,22 @@
 #include <ac_std_float.h>
 
 /*
- * Input: Read one memreq
- * Output: output 8 cycles for each Vidx 
+ * Input: Read one memreq (the 8 voxel vertex IDs and weights of one sample)
+ * Output: LANES (VID, weight) pairs per cycle, 8 / LANES cycles for each memreq (LANES = 8: one per cycle)
+ * Coalescing (WINDOW > 0): a VID already requested by one of the last WINDOW memreqs, or by an earlier lane of
+ * the same memreq, is sent with its fetch bit cleared, its feature is reused instead of read from memory again.
  */
+template <int LANES = AG_LANES, int WINDOW = AG_COALESCE_WINDOW>
 class AG : public match::Module {
     SC_HAS_PROCESS(AG);
 public:
 
+    static const int GROUPS = 8 / LANES;
+    static const int DEPTH = (WINDOW > 0) ? WINDOW : 1;
+
     Connections::In<AG_VIDsWs> memreq;
-    Connections::Out<AG_VID> vid_out;
-    Connections::Out<AG_W> w_out;
+    Connections::Out<AG_VID_Vec<LANES> > vid_out;
+    Connections::Out<AG_W_Vec<LANES> > w_out;
 
     AG(sc_module_name name) : match::Module(name),
                               memreq("memreq"),
@@ -27,10 +33,26 @@ public:
         async_reset_signal_is(rst, false);
     }
 
+    // Statistics
+    unsigned long requests;  // memreqs served
+    unsigned long vids;      // VIDs sent
+    unsigned long fetches;   // ... with the fetch bit set (memory requests)
+
+    double Reduction() const { return vids ? 1.0 - double(fetches) / vids : 0.0; }
+
+    AG_VID window[DEPTH][8];
+    bool window_valid[DEPTH][8];
+
     void start() {
         memreq.Reset();
         vid_out.Reset();
         w_out.Reset();
+        requests = vids = fetches = 0;
+        #pragma hls_unroll yes
+        for (int r = 0; r < DEPTH; r++) {
+            #pragma hls_unroll yes
+            for (int i = 0; i < 8; i++) window_valid[r][i] = false;
+        }
         wait();
 
         #pragma hls_pipeline_init_interval 1
@@ -38,14 +60,64 @@ public:
             wait();
 
             AG_VIDsWs q;
-            if (memreq.PopNB(q)) {
+            if (NRSIM_POPNB(memreq, q)) {
+                ac_int<8, false> fetch = Coalesce(q);
+
                 #pragma hls_pipeline_init_interval 1
-                for (int i = 0; i < 8; i++) {
-                    vid_out.Push(q.v[i]);
-                    w_out.Push(q.w[i]);
+                for (int g = 0; g < GROUPS; g++) {
+                    AG_VID_Vec<LANES> v;
+                    AG_W_Vec<LANES> w;
+                    #pragma hls_unroll yes
+                    for (int l = 0; l < LANES; l++) {
+                        v.v[l] = q.v[g*LANES + l];
+                        v.fetch[l] = fetch[g*LANES + l];
+                        w.w[l] = q.w[g*LANES + l];
+                    }
+                    NRSIM_PUSH(vid_out, v);
+                    NRSIM_PUSH(w_out, w);
                 }
+                requests++;
+                vids += 8;
+            }
+        }
+    }
+
+    // Fetch mask of one memreq against the window, then shift the memreq into the window
+    ac_int<8, false> Coalesce(const AG_VIDsWs &q) {
+        ac_int<8, false> fetch = ~ac_int<8, false>(0);
+        if (WINDOW == 0) {
+            fetches += 8;
+            return fetch;
+        }
+
+        #pragma hls_unroll yes
+        for (int i = 0; i < 8; i++) {
+            bool hit = false;
+            #pragma hls_unroll yes
+            for (int r = 0; r < DEPTH; r++) {
+                #pragma hls_unroll yes
+                for (int j = 0; j < 8; j++) hit |= window_valid[r][j] && (window[r][j] == q.v[i]);
             }
+            #pragma hls_unroll yes
+            for (int j = 0; j < i; j++) hit |= (q.v[j] == q.v[i]);
+            fetch[i] = !hit;
+            if (!hit) fetches++;
+        }
+
+        #pragma hls_unroll yes
+        for (int r = DEPTH - 1; r > 0; r--) {
+            #pragma hls_unroll yes
+            for (int j = 0; j < 8; j++) {
+                window[r][j] = window[r-1][j];
+                window_valid[r][j] = window_valid[r-1][j];
+            }
+        }
+        #pragma hls_unroll yes
+        for (int j = 0; j < 8; j++) {
+            window[0][j] = q.v[j];
+            window_valid[0][j] = true;
         }
+        return fetch;
     }
 };
 
@@ -1,4 +1,3 @@
-#define NVHLS_VERIFY_BLOCKS (AG)
 #include "AG.h"
 #include <nvhls_verify.h>
 #include "nvhls_connections.h"
@@ -7,25 +6,85 @@
 #include <systemc.h>
 #include <nvhls_module.h>
 #include <mc_connections.h>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+/*
+ * Usage: sim_AG [rays, default 8] [samples per ray, default 64]
+ * Ray-marched samples through a GRID^3 voxel grid (step of a quarter voxel, so neighbouring samples share
+ * vertices), the same memreqs on serial and wide AGs with and without a coalescing window. VIDs, weights and
+ * fetch bits are checked against a reference; cycles per memreq and memory requests saved are reported.
+ */
+
+static const int GRID = 64;
+static int ag_running = 0; // Tops still simulating, the last one stops
+
+static std::vector<AG_VIDsWs> Requests(int rays, int steps) {
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<float> u(0.0f, 1.0f);
+    std::vector<AG_VIDsWs> reqs;
+    for (int r = 0; r < rays; r++) {
+        float o[3], d[3], norm = 0;
+        for (int i = 0; i < 3; i++) {
+            o[i] = u(gen) * GRID;
+            d[i] = u(gen) - 0.5f;
+            norm += d[i] * d[i];
+        }
+        for (int i = 0; i < 3; i++) d[i] *= 0.25f / std::sqrt(norm);
+        for (int s = 0; s < steps; s++) {
+            int lower[3];
+            float frac[3];
+            for (int i = 0; i < 3; i++) {
+                float p = o[i] + s * d[i];
+                p = p - GRID * std::floor(p / GRID);  // wrap around the grid
+                lower[i] = int(p);
+                frac[i] = p - lower[i];
+            }
+            AG_VIDsWs q;
+            for (int c = 0; c < 8; c++) {
+                int v[3];
+                float w = 1.0f;
+                for (int i = 0; i < 3; i++) {
+                    int bit = (c >> (2 - i)) & 1;
+                    v[i] = lower[i] + bit;
+                    w *= bit ? frac[i] : 1.0f - frac[i];
+                }
+                q.v[c] = AG_VID(v[0] + (GRID + 1) * (v[1] + (GRID + 1) * v[2]));
+                q.w[c] = AG_W(int(w * 65535));
+            }
+            reqs.push_back(q);
+        }
+    }
+    return reqs;
+}
 
-
+template <int LANES, int WINDOW>
 class Top : public sc_module {
+    SC_HAS_PROCESS(Top);
 public:
     sc_clock clk;
     sc_signal<bool> rst;
 
     Connections::Combinational<AG_VIDsWs> memreq;
-    Connections::Combinational<AG_VID> vid_out;
-    Connections::Combinational<AG_W> w_out;
+    Connections::Combinational<AG_VID_Vec<LANES> > vid_out;
+    Connections::Combinational<AG_W_Vec<LANES> > w_out;
+
+    AG<LANES, WINDOW> dut;
 
-    NVHLS_DESIGN(AG) dut;
+    std::vector<AG_VIDsWs> reqs;
+    int errors;
+    sc_time first, last;
 
-    SC_CTOR(Top) : clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
+    Top(sc_module_name name, const std::vector<AG_VIDsWs> &reqs) : sc_module(name),
+                   clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
                    rst("rst"),
                    memreq("memreq"),
                    vid_out("vid_out"),
                    w_out("w_out"),
-                   dut("dut") {
+                   dut("dut"),
+                   reqs(reqs),
+                   errors(0) {
 
         sc_object_tracer<sc_clock> trace_clk(clk);
 
@@ -34,6 +93,7 @@ public:
         dut.memreq(memreq);
         dut.vid_out(vid_out);
         dut.w_out(w_out);
+        ag_running++;
 
         SC_THREAD(reset);
         sensitive << clk.posedge_event();
@@ -57,42 +117,75 @@ public:
         memreq.ResetWrite();
         wait(10);
 
-        // Random inputs
-        for (int i = 0; i < 4; i++) {
-            wait();
-            AG_VIDsWs vec;
-            for (int j = 0; j < 8; j++) {
-                vec.v[j] = AG_VID(j + 8*i);
-                vec.w[j] = AG_W(10*(j + 8*i));
+        for (size_t r = 0; r < reqs.size(); r++) memreq.Push(reqs[r]);
+    }
+
+    // VID c of memreq r is fetched unless an earlier lane or one of the WINDOW memreqs before repeats it
+    bool Fetch(int r, int c) const {
+        for (int d = 0; d < c; d++) {
+            if (reqs[r].v[d] == reqs[r].v[c]) return false;
+        }
+        for (int p = r - 1; p >= 0 && p >= r - WINDOW; p--) {
+            for (int d = 0; d < 8; d++) {
+                if (reqs[p].v[d] == reqs[r].v[c]) return false;
             }
-            memreq.Push(vec);
         }
+        return true;
     }
 
     void collect() {
         vid_out.ResetRead();
         w_out.ResetRead();
-        while (1) {
-            wait(); // 1 cc
-
-            for (int i = 0; i < 4*8; i++) {
-                cout << "address Generation Output: @ timestep: " << sc_time_stamp() << endl;
-                AG_VID v;
-                v = vid_out.Pop();
-                AG_W w;
-                w = w_out.Pop();
-                cout << "Output " << v << ", " << w << ", " << sc_time_stamp() << endl;
-            }
+        wait(10);
 
-            sc_stop();
+        for (size_t r = 0; r < reqs.size(); r++) {
+            bool ok = true;
+            for (int g = 0; g < 8 / LANES; g++) {
+                AG_VID_Vec<LANES> v = vid_out.Pop();
+                AG_W_Vec<LANES> w = w_out.Pop();
+                if (r == 0 && g == 0) first = sc_time_stamp();
+                for (int l = 0; l < LANES; l++) {
+                    int c = g * LANES + l;
+                    ok &= (v.v[l] == reqs[r].v[c]) && (w.w[l] == reqs[r].w[c]) &&
+                          (bool(v.fetch[l]) == (WINDOW == 0 || Fetch(r, c)));
+                }
+            }
+            if (!ok && errors++ < 5) cout << "✗ (MISMATCH) " << name() << " memreq " << r << endl;
         }
+        last = sc_time_stamp();
+
+        if (--ag_running == 0) sc_stop();
+    }
+
+    bool Report() const {
+        double cycles = (last - first) / sc_time(1, SC_NS) + 1;
+        cout << ((errors == 0) ? "✓ " : "✗ (MISMATCH) ") << LANES << " lanes, window " << WINDOW << ": "
+             << dut.requests << " memreqs in " << cycles << " cycles, " << cycles / reqs.size() << " cycles/memreq, "
+             << dut.fetches << " / " << dut.vids << " VIDs fetched (" << 100.0 * dut.Reduction()
+             << "% fewer memory requests)" << endl;
+        return errors == 0;
     }
 };
 
 int sc_main(int argc, char *argv[]) {
-    Top tb("tb");
+    int rays = (argc > 1) ? atoi(argv[1]) : 8;
+    int steps = (argc > 2) ? atoi(argv[2]) : 64;
+    std::vector<AG_VIDsWs> reqs = Requests(rays, steps);
+
+    Top<1, 0> serial("serial", reqs);
+    Top<8, 0> wide("wide", reqs);
+    Top<1, 4> serial_w4("serial_w4", reqs);
+    Top<8, 1> wide_w1("wide_w1", reqs);
+    Top<8, 4> wide_w4("wide_w4", reqs);
+    Top<8, 16> wide_w16("wide_w16", reqs);
     sc_start();
+
+    bool pass = serial.Report();
+    pass &= wide.Report();
+    pass &= serial_w4.Report();
+    pass &= wide_w1.Report();
+    pass &= wide_w4.Report();
+    pass &= wide_w16.Report();
+    cout << (pass ? "PASSED" : "FAILED") << endl;
     return 0;
 }
-
-//#include <>
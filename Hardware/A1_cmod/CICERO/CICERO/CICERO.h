@@ -0,0 +1,307 @@
+#ifndef CICERO_H
+#define CICERO_H
+
+#include "CICEROPackDef.h"
+#include <nvhls_connections.h>
+#include <vector>
+
+#include "../AG/AG.h"
+#include "../FeatureCache/FeatureCache.h"
+#include "../reducer/reducer.h"
+#include "../NPU/NPU.h"
+
+/*
+ * Input: voxel interpolation requests (AG_VIDsWs, the 8 vertex IDs and weights of one sample)
+ * Output: the CICERO_OUT MLP outputs of every sample, in order
+ * AG (wide, coalescing WINDOW) -> FeatureCache -> reducer -> Concat -> MLP on the NPU_SIZE array
+ *     - the AG weights wait in w_fifo while the FeatureCache fetches the features
+ *     - Concat quantizes the C-channel interpolated features (>> CICERO_FEAT_SHIFT) into the ping-pong encoding
+ *       buffer, a full bank of CICERO_BATCH samples goes to MLP
+ *     - MLP copies the bank and runs CICERO_LAYERS layers (ReLU and >> CICERO_ACT_SHIFT between them), each
+ *       as NPU_SIZE x NPU_SIZE weight tiles: load the tile bottom row first, let it settle, stream the skewed
+ *       activations, Drain accumulates the tile's psums into C (the v-th psum of column j is row v - (NPU_SIZE-1))
+ *       and reports the tile drained before the next weights load
+ * Only whole batches are processed. A stalled MLP backs up into Concat, the reducer, FeatureCache and AG.
+ * Simulation model (std::vector DRAM, encodings, weights and C), the blocks stay the HLS targets.
+ */
+template <int WINDOW = AG_COALESCE_WINDOW, int C = REDUCER_CHANNELS>
+class CICERO : public match::Module {
+    SC_HAS_PROCESS(CICERO);
+public:
+
+    static const int LANES = 8;
+    static const int N = NPU_SIZE;
+
+    typedef FeatureCache<LANES, C> Cache_Type;
+
+    Connections::In<AG_VIDsWs> memreq;
+    Connections::Out<CICERO_Out_Type> mlp_out;
+
+    AG<LANES, WINDOW> ag;
+    Connections::Combinational<AG_VID_Vec<LANES> > vid;
+    Connections::Combinational<AG_W_Vec<LANES> > weight;
+
+    Cache_Type cache;
+    Connections::Combinational<reducer_Feat_Vec<LANES, C> > feat;
+
+    Connections::Buffer<AG_W_Vec<LANES>, CICERO_W_DEPTH> w_fifo;
+    Connections::Combinational<AG_W_Vec<LANES> > red_w;
+
+    reducer<C, LANES> red;
+    Connections::Combinational<reducer_Out_Vec<C> > interp;
+
+    Connections::Combinational<int> batch_ready;  // Concat -> MLP, encoding buffer bank filled
+
+    CICERO_NPU npu;
+    Connections::Combinational<NPU_W_Type> w_data;
+    Connections::Combinational<NPU_In_Type> act_data;
+    Connections::Combinational<NPU_Out_Type> psum_data;
+    Connections::Combinational<bool> tile_start;  // MLP -> Drain, the tile in cur_*
+    Connections::Combinational<bool> tile_done;   // Drain -> MLP, its psums are in C
+
+    CICERO(sc_module_name name) : match::Module(name),
+                                  memreq("memreq"),
+                                  mlp_out("mlp_out"),
+                                  ag("ag"),
+                                  vid("vid"),
+                                  weight("weight"),
+                                  cache("cache"),
+                                  feat("feat"),
+                                  red_w("red_w"),
+                                  red("red"),
+                                  interp("interp"),
+                                  batch_ready("batch_ready"),
+                                  npu("npu"),
+                                  w_data("w_data"),
+                                  act_data("act_data"),
+                                  psum_data("psum_data"),
+                                  tile_start("tile_start"),
+                                  tile_done("tile_done"),
+                                  enc_buf(2 * CICERO_BATCH * C, 0) {
+        ag.clk(clk);
+        ag.rst(rst);
+        ag.memreq(memreq);
+        ag.vid_out(vid);
+        ag.w_out(weight);
+
+        cache.clk(clk);
+        cache.rst(rst);
+        cache.vid_in(vid);
+        cache.f_out(feat);
+
+        w_fifo.clk(clk);
+        w_fifo.rst(rst);
+        w_fifo.enq(weight);
+        w_fifo.deq(red_w);
+
+        red.clk(clk);
+        red.rst(rst);
+        red.w(red_w);
+        red.f_in(feat);
+        red.f_out(interp);
+
+        npu.clk(clk);
+        npu.rst(rst);
+        npu.w_in(w_data);
+        npu.act_in(act_data);
+        npu.psum_out(psum_data);
+
+        for (int i = 0; i < CICERO_LAYERS; i++) W[i].assign(LayerIn(i) * LayerOut(i), 0);
+
+        SC_THREAD(Concat);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+
+        SC_THREAD(MLP);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+
+        SC_THREAD(Drain);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+    }
+
+    // Backing store
+    std::vector<int> enc_buf;             // [2][CICERO_BATCH][C], Concat fills one bank while MLP copies the other
+    std::vector<int> W[CICERO_LAYERS];    // [LayerIn][LayerOut], row major
+    std::vector<int> A;                   // activations of the running layer, [M][K]
+    std::vector<NPU_Out_Elem_Type> Cm;    // its outputs, [M][NC]
+    std::vector<int> encoded;             // every encoding handed to the MLP, [sample][C] (for the testbench)
+    int cur_M, cur_NC, cur_n0;            // tile being drained
+
+    static int LayerIn(int i) { return i ? CICERO_HIDDEN : C; }
+    static int LayerOut(int i) { return (i == CICERO_LAYERS - 1) ? CICERO_OUT : CICERO_HIDDEN; }
+
+    // Backdoor access for the testbench
+    void WriteFeature(unsigned vid, int ch, const reducer_feature &f) { cache.Write(vid, ch, f); }
+    void SetLayer(int i, const std::vector<int> &w) { W[i] = w; }
+
+    // Statistics
+    unsigned long samples;        // samples interpolated
+    unsigned long concat_stall;   // cycles Concat waited for the MLP to take a batch
+    unsigned long batches;
+    unsigned long mlp_cycles;     // cycles MLP was busy with a batch
+    unsigned long load_cycles;    // ... loading and settling weight tiles
+    unsigned long drain_cycles;   // ... waiting for the last psums of a tile
+    unsigned long macs;           // M*K*N of the layers
+
+    double Utilization() const { return mlp_cycles ? double(macs) / (double(N) * N * mlp_cycles) : 0.0; }
+
+    void Concat() {
+        interp.ResetRead();
+        batch_ready.ResetWrite();
+        samples = concat_stall = 0;
+        encoded.clear();
+        wait();
+
+        int n = 0, bank = 0;
+
+        #pragma hls_pipeline_init_interval 1
+        while (1) {
+            wait();
+
+            reducer_Out_Vec<C> v;
+            if (!NRSIM_POPNB(interp, v)) continue;
+            int base = (bank * CICERO_BATCH + n) * C;
+            #pragma hls_unroll yes
+            for (int ch = 0; ch < C; ch++) enc_buf[base + ch] = (v.x[ch] >> CICERO_FEAT_SHIFT).to_int();
+            encoded.insert(encoded.end(), enc_buf.begin() + base, enc_buf.begin() + base + C);
+            samples++;
+
+            if (++n == CICERO_BATCH) {
+                while (!NRSIM_PUSHNB(batch_ready, bank)) {
+                    wait();
+                    concat_stall++;
+                }
+                n = 0;
+                bank = 1 - bank;
+            }
+        }
+    }
+
+    void MLP() {
+        batch_ready.ResetRead();
+        w_data.ResetWrite();
+        act_data.ResetWrite();
+        tile_start.ResetWrite();
+        tile_done.ResetRead();
+        mlp_out.Reset();
+        batches = mlp_cycles = load_cycles = drain_cycles = macs = 0;
+        wait();
+
+        while (1) {
+            wait();
+
+            int bank, n = CICERO_BATCH;
+            if (!NRSIM_POPNB(batch_ready, bank)) continue;
+            A.assign(enc_buf.begin() + bank * n * C, enc_buf.begin() + (bank + 1) * n * C);
+
+            for (int i = 0; i < CICERO_LAYERS; i++) {
+                Layer(n, LayerIn(i), LayerOut(i), W[i]);
+                macs += (unsigned long)n * LayerIn(i) * LayerOut(i);
+                if (i == CICERO_LAYERS - 1) break;
+
+                A.resize(Cm.size());
+                for (size_t k = 0; k < Cm.size(); k++) {
+                    int a = Cm[k].to_int() >> CICERO_ACT_SHIFT;
+                    A[k] = (a > 0) ? a : 0;
+                }
+            }
+
+            for (int s = 0; s < n; s++) {
+                CICERO_Out_Type o;
+                #pragma hls_unroll yes
+                for (int j = 0; j < CICERO_OUT; j++) o.x[j] = Cm[s * CICERO_OUT + j];
+                NRSIM_PUSH(mlp_out, o);
+                wait();
+                mlp_cycles++;
+            }
+            batches++;
+        }
+    }
+
+    // Cm[M][NC] = A[M][K] * B[K][NC], one weight tile at a time
+    void Layer(int M, int K, int NC, const std::vector<int> &B) {
+        Cm.assign(M * NC, NPU_Out_Elem_Type(0));
+        for (int n0 = 0; n0 < NC; n0 += N) {
+            for (int k0 = 0; k0 < K; k0 += N) {
+                // Weights, bottom row first, then N + 1 cycles for the last row to settle
+                for (int row = N - 1; row >= 0; row--) {
+                    NPU_W_Type w;
+                    #pragma hls_unroll yes
+                    for (int j = 0; j < N; j++) {
+                        int k = k0 + row, c = n0 + j;
+                        w.X[j] = NPU_W_Elem_Type((k < K && c < NC) ? B[k * NC + c] : 0);
+                    }
+                    NRSIM_PUSH(w_data, w);
+                    wait();
+                }
+                wait(N + 1);
+                load_cycles += 2 * N + 1;
+                mlp_cycles += 2 * N + 1;
+
+                cur_M = M;
+                cur_NC = NC;
+                cur_n0 = n0;
+                NRSIM_PUSH(tile_start, true);
+
+                // Skewed activations, row i of vector t is A[t - i][k0 + i]
+                for (int t = 0; t < M + N - 1; t++) {
+                    NPU_In_Type x;
+                    #pragma hls_unroll yes
+                    for (int i = 0; i < N; i++) {
+                        int m = t - i, k = k0 + i;
+                        x.X[i] = NPU_In_Elem_Type((m >= 0 && m < M && k < K) ? A[m * K + k] : 0);
+                    }
+                    x.swap = 0;
+                    x.last = false;
+                    NRSIM_PUSH(act_data, x);
+                    wait();
+                    mlp_cycles++;
+                }
+
+                bool drained;
+                while (!NRSIM_POPNB(tile_done, drained)) {
+                    wait();
+                    mlp_cycles++;
+                    drain_cycles++;
+                }
+            }
+        }
+    }
+
+    // Every act vector of a tile leaves one psum per column, the tile is drained after M + N - 1 of them
+    void Drain() {
+        psum_data.ResetRead();
+        tile_start.ResetRead();
+        tile_done.ResetWrite();
+        wait();
+
+        while (1) {
+            wait();
+
+            bool start;
+            if (!NRSIM_POPNB(tile_start, start)) continue;
+
+            int count[N];
+            for (int j = 0; j < N; j++) count[j] = 0;
+            int remaining = N * (cur_M + N - 1);
+            while (remaining > 0) {
+                wait();
+                NPU_Out_Type out;
+                if (!NRSIM_POPNB(psum_data, out)) continue;
+                for (int j = 0; j < N; j++) {
+                    if (!out.valid[j]) continue;
+                    int m = count[j]++ - (N - 1), c = cur_n0 + j;
+                    if (m >= 0 && m < cur_M && c < cur_NC) {
+                        Cm[m * cur_NC + c] = NPU_Out_Elem_Type(Cm[m * cur_NC + c] + out.X[j]);
+                    }
+                    remaining--;
+                }
+            }
+            NRSIM_PUSH(tile_done, true);
+        }
+    }
+};
+
+#endif // CICERO_H
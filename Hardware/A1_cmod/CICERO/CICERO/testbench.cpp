@@ -0,0 +1,222 @@
+#include "CICERO.h"
+#include <nvhls_verify.h>
+#include "nvhls_connections.h"
+#include "ac_sysc_trace.h"
+#include <random>
+#include <systemc.h>
+#include <nvhls_module.h>
+#include <mc_connections.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+/*
+ * Usage: sim_CICERO [rays, default 8] [samples per ray, default 64]
+ * Ray-marched voxel interpolation requests (as sim_AG, rounded up to whole CICERO_BATCH batches) through
+ * AG -> FeatureCache -> reducer -> NPU, without and with an AG coalescing window. The encodings are checked
+ * against an exact reference of the interpolation, the MLP outputs against an integer reference on them.
+ * Reported: end-to-end samples per cycle and per-stage stalls (DRAM waits of the cache, Concat waiting for the
+ * MLP, MLP weight loads and drains, NPU MAC utilization). Build with NRSIM_INSTRUMENT for the per-channel detail.
+ */
+
+static const int GRID = 64;
+static int cicero_running = 0; // Tops still simulating, the last one stops
+
+static std::vector<AG_VIDsWs> Requests(int rays, int steps) {
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<float> u(0.0f, 1.0f);
+    std::vector<AG_VIDsWs> reqs;
+    for (int r = 0; r < rays; r++) {
+        float o[3], d[3], norm = 0;
+        for (int i = 0; i < 3; i++) {
+            o[i] = u(gen) * GRID;
+            d[i] = u(gen) - 0.5f;
+            norm += d[i] * d[i];
+        }
+        for (int i = 0; i < 3; i++) d[i] *= 0.25f / std::sqrt(norm);
+        for (int s = 0; s < steps; s++) {
+            int lower[3];
+            float frac[3];
+            for (int i = 0; i < 3; i++) {
+                float p = o[i] + s * d[i];
+                p = p - GRID * std::floor(p / GRID);
+                lower[i] = int(p);
+                frac[i] = p - lower[i];
+            }
+            AG_VIDsWs q;
+            for (int c = 0; c < 8; c++) {
+                int v[3];
+                float w = 1.0f;
+                for (int i = 0; i < 3; i++) {
+                    int bit = (c >> (2 - i)) & 1;
+                    v[i] = lower[i] + bit;
+                    w *= bit ? frac[i] : 1.0f - frac[i];
+                }
+                q.v[c] = AG_VID(v[0] + (GRID + 1) * (v[1] + (GRID + 1) * v[2]));
+                q.w[c] = AG_W(int(w * 65535));
+            }
+            reqs.push_back(q);
+        }
+    }
+    return reqs;
+}
+
+template <int WINDOW>
+class Top : public sc_module {
+    SC_HAS_PROCESS(Top);
+public:
+    typedef CICERO<WINDOW> DUT;
+    static const int C = REDUCER_CHANNELS;
+
+    sc_clock clk;
+    sc_signal<bool> rst;
+
+    Connections::Combinational<AG_VIDsWs> memreq;
+    Connections::Combinational<CICERO_Out_Type> mlp_out;
+
+    DUT dut;
+
+    std::vector<AG_VIDsWs> reqs;
+    std::vector<CICERO_Out_Type> outputs;
+    sc_time first, last;
+
+    Top(sc_module_name name, const std::vector<AG_VIDsWs> &reqs) : sc_module(name),
+                   clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
+                   rst("rst"),
+                   memreq("memreq"),
+                   mlp_out("mlp_out"),
+                   dut("dut"),
+                   reqs(reqs) {
+
+        sc_object_tracer<sc_clock> trace_clk(clk);
+
+        dut.clk(clk);
+        dut.rst(rst);
+        dut.memreq(memreq);
+        dut.mlp_out(mlp_out);
+
+        int vids = (GRID + 1) * (GRID + 1) * (GRID + 1);
+        for (int v = 0; v < vids; v++) {
+            for (int ch = 0; ch < C; ch++) dut.WriteFeature(v, ch, Feature(v, ch));
+        }
+        std::mt19937 gen(2);
+        std::uniform_int_distribution<int> w(-2, 2);
+        for (int i = 0; i < CICERO_LAYERS; i++) {
+            std::vector<int> layer(DUT::LayerIn(i) * DUT::LayerOut(i));
+            for (auto &x : layer) x = w(gen);
+            dut.SetLayer(i, layer);
+        }
+        cicero_running++;
+
+        SC_THREAD(reset);
+        sensitive << clk.posedge_event();
+
+        SC_THREAD(run);
+        sensitive << clk.posedge_event();
+        async_reset_signal_is(rst, false);
+
+        SC_THREAD(collect);
+        sensitive << clk.posedge_event();
+        async_reset_signal_is(rst, false);
+    }
+
+    static reducer_feature Feature(int vid, int ch) { return reducer_feature((vid * 2654435761u + ch * 40503u) >> 16); }
+
+    void reset() {
+        rst.write(false);
+        wait(10);
+        rst.write(true);
+    }
+
+    void run() {
+        memreq.ResetWrite();
+        wait(10);
+
+        first = sc_time_stamp();
+        for (size_t r = 0; r < reqs.size(); r++) memreq.Push(reqs[r]);
+    }
+
+    void collect() {
+        mlp_out.ResetRead();
+        wait(10);
+
+        for (size_t r = 0; r < reqs.size(); r++) outputs.push_back(mlp_out.Pop());
+        last = sc_time_stamp();
+
+        if (--cicero_running == 0) sc_stop();
+    }
+
+    static int Wrap(long v) { return NPU_Out_Elem_Type(v).to_int(); }
+
+    // Integer reference of CICERO::MLP, psums wrap to NPU_Out_Elem_Type like the array
+    static void Mlp(const DUT &dut, const int *enc, int out[CICERO_OUT]) {
+        std::vector<int> act(enc, enc + C);
+        for (int i = 0; i < CICERO_LAYERS; i++) {
+            int K = DUT::LayerIn(i), N = DUT::LayerOut(i);
+            std::vector<int> next(N);
+            for (int n = 0; n < N; n++) {
+                long sum = 0;
+                for (int k = 0; k < K; k++) sum += long(act[k]) * dut.W[i][k * N + n];
+                next[n] = Wrap(sum);
+                if (i < CICERO_LAYERS - 1) next[n] = std::max(next[n] >> CICERO_ACT_SHIFT, 0);
+            }
+            act = next;
+        }
+        for (int j = 0; j < CICERO_OUT; j++) out[j] = act[j];
+    }
+
+    bool Report() const {
+        int enc_errors = 0, mlp_errors = 0;
+        for (size_t s = 0; s < reqs.size(); s++) {
+            const int *e = &dut.encoded[s * C];
+            for (int ch = 0; ch < C; ch++) {
+                unsigned long long acc = 0;
+                for (int c = 0; c < 8; c++) {
+                    acc += (unsigned long long)reqs[s].w[c].to_uint() * Feature(reqs[s].v[c].to_int(), ch).to_uint();
+                }
+                if (e[ch] != int(acc >> CICERO_FEAT_SHIFT) && enc_errors++ < 5) {
+                    cout << "✗ (MISMATCH) " << name() << " encoding sample " << s << ": " << e[ch]
+                         << " (ref " << (acc >> CICERO_FEAT_SHIFT) << ")" << endl;
+                }
+            }
+            int ref[CICERO_OUT];
+            Mlp(dut, e, ref);
+            bool ok = true;
+            for (int j = 0; j < CICERO_OUT; j++) ok &= (outputs[s].x[j].to_int() == ref[j]);
+            if (!ok && mlp_errors++ < 5) {
+                cout << "✗ (MISMATCH) " << name() << " MLP sample " << s << ": " << outputs[s].x[0]
+                     << " (ref " << ref[0] << ")" << endl;
+            }
+        }
+
+        double cycles = (last - first) / sc_time(1, SC_NS) + 1;
+        cout << name() << " (AG window " << WINDOW << "): " << reqs.size() << " samples (" << dut.batches
+             << " batches) in " << cycles << " cycles, " << reqs.size() / cycles << " samples/cycle" << endl;
+        cout << "  AG: " << 100.0 * dut.ag.Reduction() << "% VIDs coalesced; FeatureCache: hit rate "
+             << dut.cache.HitRate() << ", " << dut.cache.dram_bytes << " DRAM bytes, " << dut.cache.stall_cycles
+             << " stall cycles" << endl;
+        cout << "  Concat: " << dut.concat_stall << " cycles waiting for the MLP; MLP: " << dut.mlp_cycles
+             << " busy cycles (" << dut.load_cycles << " weight loads, " << dut.drain_cycles << " drains), NPU MACs "
+             << dut.Utilization() << endl;
+        cout << ((enc_errors == 0) ? "✓ " : "✗ (MISMATCH) ") << enc_errors << " encoding mismatches" << endl;
+        cout << ((mlp_errors == 0) ? "✓ " : "✗ (MISMATCH) ") << mlp_errors << " MLP mismatches" << endl;
+        return enc_errors == 0 && mlp_errors == 0;
+    }
+};
+
+int sc_main(int argc, char *argv[]) {
+    int rays = (argc > 1) ? atoi(argv[1]) : 8;
+    int steps = (argc > 2) ? atoi(argv[2]) : 64;
+    std::vector<AG_VIDsWs> reqs = Requests(rays, steps);
+    reqs.resize((reqs.size() + CICERO_BATCH - 1) / CICERO_BATCH * CICERO_BATCH, reqs.back());
+
+    Top<0> plain("plain", reqs);
+    Top<4> coalesce("coalesce", reqs);
+    sc_start();
+
+    bool pass = plain.Report();
+    pass &= coalesce.Report();
+    cout << (pass ? "PASSED" : "FAILED") << endl;
+    return 0;
+}
@@ -0,0 +1,140 @@
+#ifndef CICERO_FEATURECACHE_H
+#define CICERO_FEATURECACHE_H
+
+#include "CICEROPackDef.h"
+#include <nvhls_int.h>
+#include <nvhls_connections.h>
+#include <vector>
+
+/*
+ * On-chip feature cache between AG (vid_out) and reducer (f_in)
+ * Input: LANES VIDs per cycle with their fetch bits (AG_VID_Vec)
+ * Output: their C-channel features (reducer_Feat_Vec), in order
+ * LINES lines of LINE_VIDS consecutive VIDs, WAYS ways per set (1: direct mapped, LINES: fully associative), LRU.
+ * The lanes of one vector look up in parallel; its distinct missing lines are requested together and the vector
+ * waits DRAM_LATENCY + (miss bytes / DRAM_BYTES) cycles (misses overlap their latency, the transfer is bandwidth
+ * bound). II 1 on hits. VIDs with the fetch bit cleared (AG coalescing) come from the AG window's reuse registers
+ * and skip the lookup.
+ * Simulation model: the DRAM contents are a std::vector written through the backdoor (Write), the tags and LRU
+ * stamps plain arrays.
+ */
+template <int LANES = AG_LANES, int C = REDUCER_CHANNELS, int LINES = FC_LINES, int WAYS = FC_WAYS,
+          int LINE_VIDS = FC_LINE_VIDS, int DRAM_LATENCY = FC_DRAM_LATENCY, int DRAM_BYTES = FC_DRAM_BYTES>
+class FeatureCache : public match::Module {
+    SC_HAS_PROCESS(FeatureCache);
+public:
+
+    static const int SETS = LINES / WAYS;
+    static const int LINE_BYTES = LINE_VIDS * C * (reducer_feature::width / 8);
+
+    Connections::In<AG_VID_Vec<LANES> > vid_in;
+    Connections::Out<reducer_Feat_Vec<LANES, C> > f_out;
+
+    FeatureCache(sc_module_name name) : match::Module(name),
+                                        vid_in("vid_in"),
+                                        f_out("f_out") {
+        SC_THREAD(start);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+    }
+
+    std::vector<reducer_feature> dram;  // [VID][C]
+
+    // Backdoor access for the testbench
+    void Write(unsigned vid, int ch, const reducer_feature &f) {
+        if (dram.size() < (vid + 1) * C) dram.resize((vid + 1) * C, reducer_feature(0));
+        dram[vid * C + ch] = f;
+    }
+    reducer_feature Read(unsigned vid, int ch) const {
+        return (vid * C + ch < dram.size()) ? dram[vid * C + ch] : reducer_feature(0);
+    }
+
+    unsigned tag[SETS][WAYS];
+    bool valid[SETS][WAYS];
+    unsigned long stamp[SETS][WAYS];  // last use, LRU
+    unsigned long use_count;
+
+    // Statistics
+    unsigned long lookups;
+    unsigned long hits;
+    unsigned long misses;        // lines fetched from DRAM
+    unsigned long reused;        // VIDs served by the AG window, no lookup
+    unsigned long dram_bytes;
+    unsigned long stall_cycles;  // cycles vectors waited for DRAM
+    unsigned long vectors;
+
+    double HitRate() const { return lookups ? double(hits) / lookups : 0.0; }
+
+    void start() {
+        vid_in.Reset();
+        f_out.Reset();
+        for (int s = 0; s < SETS; s++) {
+            for (int w = 0; w < WAYS; w++) {
+                valid[s][w] = false;
+                stamp[s][w] = 0;
+            }
+        }
+        lookups = hits = misses = reused = dram_bytes = stall_cycles = vectors = use_count = 0;
+        wait();
+
+        #pragma hls_pipeline_init_interval 1
+        while (1) {
+            wait();
+
+            AG_VID_Vec<LANES> in;
+            if (!NRSIM_POPNB(vid_in, in)) continue;
+            vectors++;
+
+            int missed = 0;
+            for (int l = 0; l < LANES; l++) {
+                if (!in.fetch[l]) {
+                    reused++;
+                    continue;
+                }
+                lookups++;
+                if (Lookup(in.v[l].to_uint())) {
+                    hits++;
+                } else {
+                    missed++;
+                }
+            }
+
+            if (missed) {
+                int cycles = DRAM_LATENCY + (missed * LINE_BYTES + DRAM_BYTES - 1) / DRAM_BYTES;
+                misses += missed;
+                dram_bytes += missed * LINE_BYTES;
+                stall_cycles += cycles;
+                for (int c = 0; c < cycles; c++) wait();
+            }
+
+            reducer_Feat_Vec<LANES, C> out;
+            #pragma hls_unroll yes
+            for (int l = 0; l < LANES; l++) {
+                #pragma hls_unroll yes
+                for (int ch = 0; ch < C; ch++) out.x[l*C + ch] = Read(in.v[l].to_uint(), ch);
+            }
+            NRSIM_PUSH(f_out, out);
+        }
+    }
+
+    // Hit: refresh the way. Miss: allocate the LRU way (a line missed twice in a vector is fetched once)
+    bool Lookup(unsigned vid) {
+        unsigned line = vid / LINE_VIDS;
+        int set = line % SETS;
+        unsigned t = line / SETS;
+        int victim = 0;
+        for (int w = 0; w < WAYS; w++) {
+            if (valid[set][w] && tag[set][w] == t) {
+                stamp[set][w] = ++use_count;
+                return true;
+            }
+            if (!valid[set][w] || (valid[set][victim] && stamp[set][w] < stamp[set][victim])) victim = w;
+        }
+        valid[set][victim] = true;
+        tag[set][victim] = t;
+        stamp[set][victim] = ++use_count;
+        return false;
+    }
+};
+
+#endif //CICERO_FEATURECACHE_H
@@ -0,0 +1,197 @@
+#include "FeatureCache.h"
+#include "../AG/AG.h"
+#include <nvhls_verify.h>
+#include "nvhls_connections.h"
+#include "ac_sysc_trace.h"
+#include <random>
+#include <systemc.h>
+#include <nvhls_module.h>
+#include <mc_connections.h>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+/*
+ * Usage: sim_FeatureCache [rays, default 32] [samples per ray, default 64]
+ * Ray-marched samples through a GRID^3 voxel grid (as sim_AG) into a wide AG -> FeatureCache for several
+ * organizations of the same capacity, a line size and an AG coalescing window. Features are checked against
+ * the DRAM contents; hit rate, DRAM bytes, stall cycles and cycles per sample are reported.
+ */
+
+static const int GRID = 64;
+static const int LANES = 8;
+static int fc_running = 0; // Tops still simulating, the last one stops
+
+static std::vector<AG_VIDsWs> Requests(int rays, int steps) {
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<float> u(0.0f, 1.0f);
+    std::vector<AG_VIDsWs> reqs;
+    for (int r = 0; r < rays; r++) {
+        float o[3], d[3], norm = 0;
+        for (int i = 0; i < 3; i++) {
+            o[i] = u(gen) * GRID;
+            d[i] = u(gen) - 0.5f;
+            norm += d[i] * d[i];
+        }
+        for (int i = 0; i < 3; i++) d[i] *= 0.25f / std::sqrt(norm);
+        for (int s = 0; s < steps; s++) {
+            int lower[3];
+            for (int i = 0; i < 3; i++) {
+                float p = o[i] + s * d[i];
+                lower[i] = int(p - GRID * std::floor(p / GRID));
+            }
+            AG_VIDsWs q;
+            for (int c = 0; c < 8; c++) {
+                int v[3];
+                for (int i = 0; i < 3; i++) v[i] = lower[i] + ((c >> (2 - i)) & 1);
+                q.v[c] = AG_VID(v[0] + (GRID + 1) * (v[1] + (GRID + 1) * v[2]));
+                q.w[c] = AG_W(8192);
+            }
+            reqs.push_back(q);
+        }
+    }
+    return reqs;
+}
+
+template <int LINES, int WAYS, int LINE_VIDS, int WINDOW>
+class Top : public sc_module {
+    SC_HAS_PROCESS(Top);
+public:
+    static const int C = REDUCER_CHANNELS;
+
+    sc_clock clk;
+    sc_signal<bool> rst;
+
+    Connections::Combinational<AG_VIDsWs> memreq;
+    Connections::Combinational<AG_VID_Vec<LANES> > vid;
+    Connections::Combinational<AG_W_Vec<LANES> > w;
+    Connections::Combinational<reducer_Feat_Vec<LANES, C> > feat;
+
+    AG<LANES, WINDOW> ag;
+    FeatureCache<LANES, C, LINES, WAYS, LINE_VIDS> dut;
+
+    std::vector<AG_VIDsWs> reqs;
+    int errors;
+    sc_time first, last;
+
+    Top(sc_module_name name, const std::vector<AG_VIDsWs> &reqs) : sc_module(name),
+                   clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
+                   rst("rst"),
+                   memreq("memreq"),
+                   vid("vid"),
+                   w("w"),
+                   feat("feat"),
+                   ag("ag"),
+                   dut("dut"),
+                   reqs(reqs),
+                   errors(0) {
+
+        sc_object_tracer<sc_clock> trace_clk(clk);
+
+        ag.clk(clk);
+        ag.rst(rst);
+        ag.memreq(memreq);
+        ag.vid_out(vid);
+        ag.w_out(w);
+
+        dut.clk(clk);
+        dut.rst(rst);
+        dut.vid_in(vid);
+        dut.f_out(feat);
+
+        int vids = (GRID + 1) * (GRID + 1) * (GRID + 1);
+        for (int v = 0; v < vids; v++) {
+            for (int ch = 0; ch < C; ch++) dut.Write(v, ch, Feature(v, ch));
+        }
+        fc_running++;
+
+        SC_THREAD(reset);
+        sensitive << clk.posedge_event();
+
+        SC_THREAD(run);
+        sensitive << clk.posedge_event();
+        async_reset_signal_is(rst, false);
+
+        SC_THREAD(collect);
+        sensitive << clk.posedge_event();
+        async_reset_signal_is(rst, false);
+
+        SC_THREAD(sink);
+        sensitive << clk.posedge_event();
+        async_reset_signal_is(rst, false);
+    }
+
+    static reducer_feature Feature(int vid, int ch) { return reducer_feature((vid * 31 + ch * 7) & 0xffff); }
+
+    void reset() {
+        rst.write(false);
+        wait(10);
+        rst.write(true);
+    }
+
+    void run() {
+        memreq.ResetWrite();
+        wait(10);
+
+        for (size_t r = 0; r < reqs.size(); r++) memreq.Push(reqs[r]);
+    }
+
+    // Weights go to the reducer, unused here
+    void sink() {
+        w.ResetRead();
+        wait();
+        while (1) {
+            wait();
+            AG_W_Vec<LANES> tmp;
+            w.PopNB(tmp);
+        }
+    }
+
+    void collect() {
+        feat.ResetRead();
+        wait(10);
+
+        for (size_t r = 0; r < reqs.size(); r++) {
+            reducer_Feat_Vec<LANES, C> f = feat.Pop();
+            if (r == 0) first = sc_time_stamp();
+            bool ok = true;
+            for (int l = 0; l < LANES; l++) {
+                for (int ch = 0; ch < C; ch++) ok &= (f.x[l*C + ch] == Feature(reqs[r].v[l].to_int(), ch));
+            }
+            if (!ok && errors++ < 5) cout << "✗ (MISMATCH) " << name() << " sample " << r << endl;
+        }
+        last = sc_time_stamp();
+
+        if (--fc_running == 0) sc_stop();
+    }
+
+    bool Report() const {
+        double cycles = (last - first) / sc_time(1, SC_NS) + 1;
+        cout << ((errors == 0) ? "✓ " : "✗ (MISMATCH) ") << LINES << " lines x " << LINE_VIDS << " VIDs, "
+             << WAYS << " ways, AG window " << WINDOW << ": hit rate " << dut.HitRate() << " (" << dut.lookups
+             << " lookups, " << dut.reused << " reused), " << dut.dram_bytes << " DRAM bytes, " << dut.stall_cycles
+             << " stall cycles, " << cycles / reqs.size() << " cycles/sample" << endl;
+        return errors == 0;
+    }
+};
+
+int sc_main(int argc, char *argv[]) {
+    int rays = (argc > 1) ? atoi(argv[1]) : 32;
+    int steps = (argc > 2) ? atoi(argv[2]) : 64;
+    std::vector<AG_VIDsWs> reqs = Requests(rays, steps);
+
+    Top<256, 1, 4, 0> direct("direct", reqs);
+    Top<256, 4, 4, 0> assoc4("assoc4", reqs);
+    Top<256, 256, 4, 0> full("full", reqs);
+    Top<1024, 4, 1, 0> line1("line1", reqs);
+    Top<256, 4, 4, 4> assoc4_w4("assoc4_w4", reqs);
+    sc_start();
+
+    bool pass = direct.Report();
+    pass &= assoc4.Report();
+    pass &= full.Report();
+    pass &= line1.Report();
+    pass &= assoc4_w4.Report();
+    cout << (pass ? "PASSED" : "FAILED") << endl;
+    return 0;
+}
@@ -1,5 +1,6 @@
 #define NVHLS_VERIFY_BLOCKS (NPU)
 #include "NPU.h"
+#include "../../common/include/nrsim_reference.h"
 #include <nvhls_verify.h>
 //#include <mc_scverify.h>
 #include "nvhls_connections.h"
@@ -9,7 +10,12 @@
 #include <systemc.h>
 #include <nvhls_module.h>
 #include <mc_connections.h>
+#include <vector>
 
+/*
+ * Weight row i column j of PE(i, j) is i*NPU_SIZE + j + 1, act vector m (row i enters at t = m + i) is m + 1;
+ * psum m of column j is checked against the exact GEMM wrapped to NPU_Out_Elem_Type.
+ */
 
 class Top : public sc_module {
 public:
@@ -20,7 +26,7 @@ public:
     Connections::Combinational<NPU_In_Type>  act_in;
     Connections::Combinational<NPU_Out_Type> psum_out;
 
-    NVHLS_DESIGN(NPU) dut;
+    NVHLS_DESIGN(CICERO_NPU) dut;
 
     SC_CTOR(Top) : clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
                    rst("rst"),
@@ -103,6 +109,8 @@ public:
                     act_data.X[i] = NPU_In_Elem_Type(0); // Zero padding
                 }
             }
+            act_data.swap = 0;      // no WBUF, no stream sideband
+            act_data.last = false;
             
             // Push activations
             act_in.Push(act_data);
@@ -122,10 +130,24 @@ public:
         wait(NPU_SIZE * 2);
     }
 
+    // A[m][i] = m + 1, W[i][j] = i*NPU_SIZE + j + 1, C = A*W wrapped to the 16-bit psums
+    std::vector<long> Expected() const {
+        std::vector<long> A(NPU_SIZE * NPU_SIZE), W(NPU_SIZE * NPU_SIZE), C(NPU_SIZE * NPU_SIZE);
+        for (int m = 0; m < NPU_SIZE; m++)
+            for (int i = 0; i < NPU_SIZE; i++) A[m * NPU_SIZE + i] = m + 1;
+        for (int i = 0; i < NPU_SIZE * NPU_SIZE; i++) W[i] = i + 1;
+        nrsim::ref::Gemm(NPU_SIZE, NPU_SIZE, NPU_SIZE, A.data(), W.data(), C.data());
+        nrsim::ref::WrapSigned(C.data(), C.size(), NPU_Out_Elem_Type::width);
+        return C;
+    }
+
     void collect() {
         psum_out.ResetRead();
         wait(10);  // Wait for reset
 
+        // The v-th psum of column j belongs to act vector v - (NPU_SIZE - 1)
+        std::vector<long> C(NPU_SIZE * NPU_SIZE, 0);
+        std::vector<int> psums(NPU_SIZE, 0);
         int count = 0;
         while (1) {
             NPU_Out_Type result;
@@ -133,6 +155,9 @@ public:
                 cout << "NPU Output @ " << sc_time_stamp() << " : ";
                 for (int i = 0; i < NPU_SIZE; i++) {
                     cout << result.X[i] << " ";
+                    if (!result.valid[i]) continue;
+                    int m = psums[i]++ - (NPU_SIZE - 1);
+                    if (m >= 0 && m < NPU_SIZE) C[m * NPU_SIZE + i] = result.X[i].to_int64();
                 }
                 cout << endl; 
             }
@@ -142,6 +167,10 @@ public:
             }
             wait();
         }
+
+        nrsim::ref::CompareResult r = nrsim::ref::Compare(C.data(), Expected().data(), C.size());
+        nrsim::ref::Report(cout, "NPU psums vs GEMM reference", r);
+        cout << (r.ok() ? "PASSED" : "FAILED") << endl;
         sc_stop();
     }
 };
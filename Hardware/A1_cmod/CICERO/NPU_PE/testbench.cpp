@@ -22,21 +22,25 @@ public:
     Connections::Combinational<NPU_W_Elem_Type>   w_in;
     Connections::Combinational<NPU_In_Elem_Type>  act_in;
     Connections::Combinational<NPU_Out_Elem_Type> psum_in;
+    Connections::Combinational<NPU_Flag_Type>     flag_in;   // not driven, no flags
 
     Connections::Combinational<NPU_W_Elem_Type>   w_out;
     Connections::Combinational<NPU_In_Elem_Type>  act_out;
     Connections::Combinational<NPU_Out_Elem_Type> psum_out;
+    Connections::Combinational<NPU_Flag_Type>     flag_out;
 
-    NVHLS_DESIGN(NPU_PE) dut;
+    NVHLS_DESIGN(CICERO_NPU_PE) dut;
 
     SC_CTOR(Top) : clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
                    rst("rst"),
                    w_in("w_in"),
                    act_in("act_in"),
                    psum_in("psum_in"),
+                   flag_in("flag_in"),
                    w_out("w_out"),
                    act_out("act_out"),
                    psum_out("psum_out"),
+                   flag_out("flag_out"),
                    dut("dut") { // Pass row and column indices to PE
 
         sc_object_tracer<sc_clock> trace_clk(clk);
@@ -49,6 +53,8 @@ public:
         dut.w_out(w_out);
         dut.act_out(act_out);
         dut.psum_out(psum_out);
+        dut.flag_in(flag_in);
+        dut.flag_out(flag_out);
 
         SC_THREAD(reset);
         sensitive << clk.posedge_event();
@@ -72,6 +78,7 @@ public:
         w_in.ResetWrite();
         act_in.ResetWrite();
         psum_in.ResetWrite();
+        flag_in.ResetWrite();
         wait(10);
 
         std::cout << "Testing NPU_PE with row index: " << PE_ROW_IDX << ", column index: " << PE_COL_IDX << std::endl;
@@ -129,6 +136,7 @@ public:
         w_out.ResetRead();
         act_out.ResetRead();
         psum_out.ResetRead();
+        flag_out.ResetRead();
 
         // Based on the actual behavior we've observed, the PE at row 2 is receiving
         // weight value 1 (the last weight sent) rather than PE_ROW_IDX + 1
@@ -15,9 +15,18 @@
 
 // Helpers from https://github.com/hlslibs/matchlib_toolkit/blob/main/include/auto_gen_fields.h#L425
 // Slightly modify for marshall, width only
-#include "auto_gen_fields.h"
+#include "../../common/include/auto_gen_fields.h"
 
-#define NPU_SIZE 24
+// Channel / thread stall instrumentation, JSON summary at the end of the simulation (C model only)
+// #define NRSIM_INSTRUMENT
+#include "../../common/include/nrsim_instrument.h"
+
+// Systolic array library shared with NEUREX (common/NPU), CICERO_NPU in NPU/NPU.h fixes the CICERO array
+#include "../../common/include/NPUPackDef.h"
+
+#ifndef NPU_SIZE
+#define NPU_SIZE 24            // changeable, CICERO_NPU rows and columns
+#endif
 
 
 // typedef ac_std_float<16, 8> NPU_W_Elem_Type;
@@ -28,23 +37,9 @@ typedef ac_int<16, true> NPU_In_Elem_Type;
 typedef ac_int<16, true> NPU_Out_Elem_Type;
 typedef ac_int<nvhls::log2_ceil<NPU_SIZE>::val+1, true> NPU_Index_Type;  // Generic index type for both row and column
 
-class NPU_W_Type : public nvhls_message {
-public:
-    NPU_W_Elem_Type X[NPU_SIZE];
-    AUTO_GEN_FIELD_METHODS((X))
-};
-
-class NPU_In_Type : public nvhls_message {
-public:
-    NPU_In_Elem_Type X[NPU_SIZE];
-    AUTO_GEN_FIELD_METHODS((X))
-};
-
-class NPU_Out_Type : public nvhls_message {
-public:
-    NPU_Out_Elem_Type X[NPU_SIZE];
-    AUTO_GEN_FIELD_METHODS((X))
-};
+typedef NPU_W_Vec<NPU_W_Elem_Type, NPU_SIZE>    NPU_W_Type;
+typedef NPU_In_Vec<NPU_In_Elem_Type, NPU_SIZE>  NPU_In_Type;   // swap / last: see NPUPackDef.h
+typedef NPU_Out_Vec<NPU_Out_Elem_Type, NPU_SIZE> NPU_Out_Type; // only sent when a column holds a result
 
 // Address Generation
 typedef ac_int<32, false> AG_VID;
@@ -55,9 +50,83 @@ public:
     AG_W   w[8];
     AUTO_GEN_FIELD_METHODS((v, w))
 };
+#ifndef AG_LANES
+#define AG_LANES 1             // changeable, (VID, weight) pairs per cycle: 1 (serial, 8 cycles per AG_VIDsWs) to 8 (wide)
+#endif
+#ifndef AG_COALESCE_WINDOW
+#define AG_COALESCE_WINDOW 0   // changeable, earlier AG_VIDsWs whose VIDs suppress a repeated memory request (0: off)
+#endif
+template <int LANES = AG_LANES>
+class AG_VID_Vec : public nvhls_message {
+public:
+    AG_VID v[LANES];
+    ac_int<LANES, false> fetch;  // v[i] was not requested within the coalescing window, read it from memory
+    AUTO_GEN_FIELD_METHODS((v, fetch))
+};
+template <int LANES = AG_LANES>
+class AG_W_Vec : public nvhls_message {
+public:
+    AG_W w[LANES];
+    AUTO_GEN_FIELD_METHODS((w))
+};
 
 // Reducer
 typedef ac_int<16, false> reducer_W;
 typedef ac_int<16, false> reducer_feature;
+typedef ac_int<16 + 16 + 3, false> reducer_acc;  // sum of 8 reducer_W x reducer_feature products, never wraps
+#ifndef REDUCER_CHANNELS
+#define REDUCER_CHANNELS 4     // changeable, feature channels per voxel vertex
+#endif
+// LANES vertex features of C channels, channel ch of vertex l at x[l*C + ch]
+template <int LANES = AG_LANES, int C = REDUCER_CHANNELS>
+class reducer_Feat_Vec : public nvhls_message {
+public:
+    reducer_feature x[LANES*C];
+    AUTO_GEN_FIELD_METHODS((x))
+};
+// Interpolated feature of one sample
+template <int C = REDUCER_CHANNELS>
+class reducer_Out_Vec : public nvhls_message {
+public:
+    reducer_acc x[C];
+    AUTO_GEN_FIELD_METHODS((x))
+};
+
+// Feature cache between AG and reducer, backed by DRAM
+#ifndef FC_LINES
+#define FC_LINES 256           // changeable, cache lines (capacity FC_LINES * FC_LINE_VIDS vertices)
+#endif
+#ifndef FC_WAYS
+#define FC_WAYS 4              // changeable, 1: direct mapped, FC_LINES: fully associative, else set associative
+#endif
+#ifndef FC_LINE_VIDS
+#define FC_LINE_VIDS 4         // changeable, consecutive VIDs per line (FC_LINE_VIDS * REDUCER_CHANNELS * 2 B)
+#endif
+#ifndef FC_DRAM_LATENCY
+#define FC_DRAM_LATENCY 100    // changeable, cycles from miss to the first DRAM byte
+#endif
+#ifndef FC_DRAM_BYTES
+#define FC_DRAM_BYTES 16       // changeable, DRAM bytes per cycle
+#endif
+
+// CICERO top, voxel interpolation -> MLP on the NPU
+#ifndef CICERO_BATCH
+#define CICERO_BATCH 128       // changeable, samples per MLP batch
+#endif
+#ifndef CICERO_HIDDEN
+#define CICERO_HIDDEN 64       // changeable, hidden layer width
+#endif
+#ifndef CICERO_LAYERS
+#define CICERO_LAYERS 4        // changeable, MLP layers: REDUCER_CHANNELS -> CICERO_HIDDEN ... -> CICERO_OUT (as cicero_pipeline.py)
+#endif
+#define CICERO_OUT 4           // MLP outputs per sample (density, rgb)
+#define CICERO_FEAT_SHIFT 17   // reducer_acc (0.16 weights x 16-bit features) to the 15-bit NPU input
+#define CICERO_ACT_SHIFT 8     // requantization of the hidden activations (fraction bits of the weights)
+#define CICERO_W_DEPTH 8       // AG weights waiting for their features (FeatureCache misses)
+class CICERO_Out_Type : public nvhls_message {
+public:
+    NPU_Out_Elem_Type x[CICERO_OUT];
+    AUTO_GEN_FIELD_METHODS((x))
+};
 
 #endif //CICEROPackDef_H
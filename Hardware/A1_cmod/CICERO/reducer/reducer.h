@@ -7,17 +7,23 @@
 #include <ac_std_float.h>
 
 /*
- * Input: Read one memreq
- * Output: output 8 cycles for each Vidx 
+ * Input: the weights (AG w_out) and the C-channel features of LANES voxel vertices per cycle
+ * Output: sum over the 8 vertices of w * f per channel, one C-channel vector each 8 / LANES cycles
+ *         (LANES = 8: one interpolated feature vector per cycle)
+ * The accumulator (reducer_acc) holds 8 full products without wrapping.
+ * w and f_in are held in input registers until both arrived.
  */
 #pragma hls_design top
+template <int C = REDUCER_CHANNELS, int LANES = AG_LANES>
 class reducer : public match::Module {
     SC_HAS_PROCESS(reducer);
 public:
 
-    Connections::In<reducer_W> w;
-    Connections::In<reducer_feature> f_in;
-    Connections::Out<reducer_feature> f_out;
+    static const int GROUPS = 8 / LANES;
+
+    Connections::In<AG_W_Vec<LANES> > w;
+    Connections::In<reducer_Feat_Vec<LANES, C> > f_in;
+    Connections::Out<reducer_Out_Vec<C> > f_out;
 
     reducer(sc_module_name name) : match::Module(name),
                               w("w"),
@@ -28,28 +34,54 @@ public:
         async_reset_signal_is(rst, false);
     }
 
-    reducer_feature acc;
+    reducer_acc acc[C];
+
+    // Statistics
+    unsigned long outputs;
 
     void start() {
         w.Reset();
         f_in.Reset();
         f_out.Reset();
-        acc = reducer_feature(0);
+        #pragma hls_unroll yes
+        for (int ch = 0; ch < C; ch++) acc[ch] = 0;
+        outputs = 0;
         wait();
 
+        AG_W_Vec<LANES> w_reg;
+        reducer_Feat_Vec<LANES, C> f_reg;
+        bool w_held = false, f_held = false;
+        int group = 0;
+
         #pragma hls_pipeline_init_interval 1
         while (1) {
             wait();
 
-            #pragma hls_pipeline_init_interval 1
-            for (int i = 0; i < 8; i++) { 
-                reducer_W       w_tmp = w.Pop();
-                reducer_feature f_in_tmp = f_in.Pop();
-                acc += w_tmp*f_in_tmp;
-                if (i == 7) {
-                    f_out.Push(acc);
-                    acc = 0;
+            if (!w_held) w_held = NRSIM_POPNB(w, w_reg);
+            if (!f_held) f_held = NRSIM_POPNB(f_in, f_reg);
+            if (!(w_held && f_held)) continue;
+            w_held = f_held = false;
+
+            #pragma hls_unroll yes
+            for (int ch = 0; ch < C; ch++) {
+                reducer_acc sum = acc[ch];
+                #pragma hls_unroll yes
+                for (int l = 0; l < LANES; l++) sum += w_reg.w[l] * f_reg.x[l*C + ch];
+                acc[ch] = sum;
+            }
+
+            if (group == GROUPS - 1) {
+                reducer_Out_Vec<C> out;
+                #pragma hls_unroll yes
+                for (int ch = 0; ch < C; ch++) {
+                    out.x[ch] = acc[ch];
+                    acc[ch] = 0;
                 }
+                NRSIM_PUSH(f_out, out);
+                outputs++;
+                group = 0;
+            } else {
+                group++;
             }
         }
     }
@@ -1,5 +1,5 @@
-#define NVHLS_VERIFY_BLOCKS (reducer)
 #include "reducer.h"
+#include "../../common/include/nrsim_reference.h"
 #include <nvhls_verify.h>
 #include "nvhls_connections.h"
 #include "ac_sysc_trace.h"
@@ -7,25 +7,49 @@
 #include <systemc.h>
 #include <nvhls_module.h>
 #include <mc_connections.h>
+#include <cstdlib>
+#include <vector>
 
+/*
+ * Usage: sim_reducer [samples, default 256]
+ * Full-range random weights and features (the 16-bit accumulator of the scalar reducer wrapped on them) for
+ * several channel counts and lane widths, pushed back to back; outputs are checked against an exact 64-bit
+ * reference, cycles per interpolated feature vector are reported.
+ */
 
+static int reducer_running = 0; // Tops still simulating, the last one stops
+
+template <int C, int LANES>
 class Top : public sc_module {
+    SC_HAS_PROCESS(Top);
 public:
+    static const int GROUPS = 8 / LANES;
+
     sc_clock clk;
     sc_signal<bool> rst;
 
-    Connections::Combinational<reducer_W> w;
-    Connections::Combinational<reducer_feature> f_in;
-    Connections::Combinational<reducer_feature> f_out;
+    Connections::Combinational<AG_W_Vec<LANES> > w;
+    Connections::Combinational<reducer_Feat_Vec<LANES, C> > f_in;
+    Connections::Combinational<reducer_Out_Vec<C> > f_out;
 
-    NVHLS_DESIGN(reducer) dut;
+    reducer<C, LANES> dut;
 
-    SC_CTOR(Top) : clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
+    int n;
+    std::vector<unsigned> weights;   // [n][8]
+    std::vector<unsigned> features;  // [n][8][C]
+    std::vector<uint64_t> expected;  // [n][C]
+    int errors;
+    sc_time first, last;
+
+    Top(sc_module_name name, int n) : sc_module(name),
+                   clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
                    rst("rst"),
                    w("w"),
                    f_in("f_in"),
                    f_out("f_out"),
-                   dut("dut") {
+                   dut("dut"),
+                   n(n),
+                   errors(0) {
 
         sc_object_tracer<sc_clock> trace_clk(clk);
 
@@ -35,6 +59,16 @@ public:
         dut.f_in(f_in);
         dut.f_out(f_out);
 
+        std::mt19937 gen(1);
+        std::uniform_int_distribution<unsigned> u(0, 65535);
+        weights.resize(n * 8);
+        features.resize(n * 8 * C);
+        for (auto &x : weights) x = u(gen);
+        for (auto &x : features) x = u(gen);
+        expected.resize(n * C);
+        nrsim::ref::ReduceTrilinear(n, C, weights.data(), features.data(), expected.data());
+        reducer_running++;
+
         SC_THREAD(reset);
         sensitive << clk.posedge_event();
 
@@ -58,13 +92,15 @@ public:
         f_in.ResetWrite();
         wait(10);
 
-        // Random inputs
-        for (int i = 0; i < 4; i++) {
-            #pragma hls_pipeline_init_interval 1
-            for (int j = 0; j < 8; j++) {
-                wait();
-                reducer_W w_data       = reducer_W(i*8 + j);
-                reducer_feature f_data = reducer_feature(i*8 + j);
+        for (int s = 0; s < n; s++) {
+            for (int g = 0; g < GROUPS; g++) {
+                AG_W_Vec<LANES> w_data;
+                reducer_Feat_Vec<LANES, C> f_data;
+                for (int l = 0; l < LANES; l++) {
+                    int v = s*8 + g*LANES + l;
+                    w_data.w[l] = AG_W(weights[v]);
+                    for (int ch = 0; ch < C; ch++) f_data.x[l*C + ch] = reducer_feature(features[v*C + ch]);
+                }
                 w.Push(w_data);
                 f_in.Push(f_data);
             }
@@ -73,24 +109,42 @@ public:
 
     void collect() {
         f_out.ResetRead();
-        while (1) {
-            wait(); // 1 cc
-
-            for (int i = 0; i < 4; i++) {
-                reducer_feature v;
-                v = f_out.Pop();
-                cout << "Output " << v << ", " << sc_time_stamp() << endl;
-            }
+        wait(10);
 
-            sc_stop();
+        for (int s = 0; s < n; s++) {
+            reducer_Out_Vec<C> out = f_out.Pop();
+            if (s == 0) first = sc_time_stamp();
+            bool ok = true;
+            for (int ch = 0; ch < C; ch++) ok &= (out.x[ch].to_uint64() == expected[s*C + ch]);
+            if (!ok && errors++ < 5) cout << "✗ (MISMATCH) " << name() << " sample " << s << endl;
         }
+        last = sc_time_stamp();
+
+        if (--reducer_running == 0) sc_stop();
+    }
+
+    bool Report() const {
+        double cycles = (last - first) / sc_time(1, SC_NS) + 1;
+        cout << ((errors == 0) ? "✓ " : "✗ (MISMATCH) ") << C << " channels, " << LANES << " lanes: " << n
+             << " samples in " << cycles << " cycles, " << cycles / n << " cycles/sample, " << errors
+             << " mismatches" << endl;
+        return errors == 0;
     }
 };
 
 int sc_main(int argc, char *argv[]) {
-    Top tb("tb");
+    int n = (argc > 1) ? atoi(argv[1]) : 256;
+
+    Top<1, 1> serial("serial", n);
+    Top<4, 1> serial_c4("serial_c4", n);
+    Top<4, 8> wide_c4("wide_c4", n);
+    Top<8, 8> wide_c8("wide_c8", n);
     sc_start();
+
+    bool pass = serial.Report();
+    pass &= serial_c4.Report();
+    pass &= wide_c4.Report();
+    pass &= wide_c8.Report();
+    cout << (pass ? "PASSED" : "FAILED") << endl;
     return 0;
 }
-
-//#include <>
@@ -0,0 +1,145 @@
+#ifndef GSCORE_BMU_H
+#define GSCORE_BMU_H
+
+#include "GSCOREPackDef.h"
+#include <ac_channel.h>
+#include <nvhls_connections.h>
+#include <ac_std_float.h>
+
+/*
+ * Bitonic Merge Unit: merges two sorted runs of SORT_NUM blocks (BSU output format)
+ * into one sorted run, one block per cycle.
+ * Runs longer than SORT_NUM are built by repeated passes (runs of 1, 2, 4, ... blocks).
+ */
+#pragma hls_design block
+class BMU : public match::Module {
+    SC_HAS_PROCESS(BMU);
+public:
+
+    Connections::In<BMU_CFG_TYPE> BMUConfig;
+    Connections::In<BSU_IN_OUT_TYPE> BMUInputA;
+    Connections::In<BSU_IN_OUT_TYPE> BMUInputB;
+    Connections::Out<BSU_IN_OUT_TYPE> BMUOutput;
+
+    BMU(sc_module_name name) : match::Module(name),
+                               BMUConfig("BMUConfig"),
+                               BMUInputA("BMUInputA"),
+                               BMUInputB("BMUInputB"),
+                               BMUOutput("BMUOutput") {
+        SC_THREAD(BMU_CALC);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+    }
+
+    /*
+     * Input: two sorted blocks
+     * Output: lo = smallest SORT_NUM pairs, hi = largest SORT_NUM pairs (both sorted)
+     * Perform: lo ++ reverse(hi) is bitonic, log2(2*SORT_NUM) half-cleaner stages sort it
+     */
+    void BitonicMerge(BSU_IN_OUT_TYPE &lo, BSU_IN_OUT_TYPE &hi) {
+        BSU_DATA_TYPE x[2*SORT_NUM];
+        BSU_VALUE_TYPE v[2*SORT_NUM];
+        #pragma hls_unroll
+        for (int i = 0; i < SORT_NUM; i++) {
+            x[i] = lo.x[i];
+            v[i] = lo.v[i];
+            x[2*SORT_NUM-1-i] = hi.x[i];
+            v[2*SORT_NUM-1-i] = hi.v[i];
+        }
+
+        #pragma hls_unroll
+        for (int j = SORT_NUM; j > 0; j >>= 1) {
+            #pragma hls_unroll
+            for (int i = 0; i < 2*SORT_NUM; i++) {
+                int ixj = i ^ j;
+                if (ixj > i && x[i] > x[ixj]) {
+                    BSU_DATA_TYPE temp = x[i];
+                    x[i] = x[ixj];
+                    x[ixj] = temp;
+                    BSU_VALUE_TYPE temp_v = v[i];
+                    v[i] = v[ixj];
+                    v[ixj] = temp_v;
+                }
+            }
+        }
+
+        #pragma hls_unroll
+        for (int i = 0; i < SORT_NUM; i++) {
+            lo.x[i] = x[i];
+            lo.v[i] = v[i];
+            hi.x[i] = x[SORT_NUM+i];
+            hi.v[i] = v[SORT_NUM+i];
+        }
+    }
+
+    /*
+     * Input: (len_a, len_b), then len_a blocks on A and len_b blocks on B
+     * Output: len_a + len_b blocks
+     * Perform: keep the larger half of the last merge, merge it with the next block of the
+     *          run whose next block starts with the smaller key, emit the smaller half
+     */
+    void BMU_CALC() {
+        BMUConfig.Reset();
+        BMUInputA.Reset();
+        BMUInputB.Reset();
+        BMUOutput.Reset();
+        wait();
+
+        while (1) {
+            wait();
+
+            BMU_CFG_TYPE cfg = NRSIM_POP(BMUConfig);
+            uint rem_a = cfg.len_a;
+            uint rem_b = cfg.len_b;
+            uint total = rem_a + rem_b;
+            uint out = 0;
+
+            BSU_IN_OUT_TYPE head_a, head_b, held;
+            bool has_a = false, has_b = false, has_held = false;
+
+            #pragma hls_pipeline_init_interval 1
+            while (out < total) {
+                if (!has_a && rem_a > 0 && NRSIM_POPNB(BMUInputA, head_a)) {
+                    has_a = true;
+                    rem_a--;
+                }
+                if (!has_b && rem_b > 0 && NRSIM_POPNB(BMUInputB, head_b)) {
+                    has_b = true;
+                    rem_b--;
+                }
+
+                // Both heads are needed to pick the next block, unless a run is exhausted
+                if ((has_a || rem_a == 0) && (has_b || rem_b == 0)) {
+                    if (has_a || has_b) {
+                        bool take_a = has_a && (!has_b || !(head_b.x[0] < head_a.x[0]));
+                        BSU_IN_OUT_TYPE blk = take_a ? head_a : head_b;
+                        if (take_a) {
+                            has_a = false;
+                        } else {
+                            has_b = false;
+                        }
+
+                        if (!has_held) {
+                            held = blk;
+                            has_held = true;
+                        } else {
+                            BitonicMerge(held, blk);
+                            NRSIM_PUSH(BMUOutput, held);
+                            out++;
+                            held = blk;
+                        }
+                    } else {
+                        // Both runs consumed, the kept half is the last block
+                        NRSIM_PUSH(BMUOutput, held);
+                        out++;
+                        has_held = false;
+                    }
+                }
+                wait();
+            }
+        }
+    }
+
+};
+
+#endif //GSCORE_BMU_H
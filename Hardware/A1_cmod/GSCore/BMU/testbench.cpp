@@ -0,0 +1,167 @@
+#define NVHLS_VERIFY_BLOCKS (BMU)
+#include "BMU.h"
+#include <nvhls_verify.h>
+#include "nvhls_connections.h"
+#include "ac_sysc_trace.h"
+#include <random>
+#include <systemc.h>
+#include <nvhls_module.h>
+#include <mc_connections.h>
+#include <vector>
+#include <algorithm>
+
+#define NUM_TESTS 3
+
+#pragma hls_design top
+class testbench : public sc_module {
+public:
+    sc_clock clk;
+    sc_signal<bool> rst;
+
+    Connections::Combinational<BMU_CFG_TYPE> BMUConfig;
+    Connections::Combinational<BSU_IN_OUT_TYPE> BMUInputA;
+    Connections::Combinational<BSU_IN_OUT_TYPE> BMUInputB;
+    Connections::Combinational<BSU_IN_OUT_TYPE> BMUOutput;
+
+    NVHLS_DESIGN(BMU) dut;
+
+    // Run lengths (elements) of each test, the last block of a run is padded with FP16 max
+    int len_a[NUM_TESTS] = {16, 45, 70};
+    int len_b[NUM_TESTS] = {16, 30, 0};
+    std::vector<BSU_IN_OUT_TYPE> run_a[NUM_TESTS];
+    std::vector<BSU_IN_OUT_TYPE> run_b[NUM_TESTS];
+
+    SC_CTOR(testbench) : clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
+                   rst("rst"),
+                   BMUConfig("BMUConfig"),
+                   BMUInputA("BMUInputA"),
+                   BMUInputB("BMUInputB"),
+                   BMUOutput("BMUOutput"),
+                   dut("dut") {
+
+        sc_object_tracer<sc_clock> trace_clk(clk);
+
+        dut.clk(clk);
+        dut.rst(rst);
+        dut.BMUConfig(BMUConfig);
+        dut.BMUInputA(BMUInputA);
+        dut.BMUInputB(BMUInputB);
+        dut.BMUOutput(BMUOutput);
+
+        std::mt19937 gen(7);
+        for (int t = 0; t < NUM_TESTS; t++) {
+            run_a[t] = make_run(gen, len_a[t], 0, 0);
+            run_b[t] = make_run(gen, len_b[t], 1, 1000);
+        }
+
+        SC_THREAD(reset);
+        sensitive << clk.posedge_event();
+
+        SC_THREAD(run);
+        sensitive << clk.posedge_event();
+        async_reset_signal_is(rst, false);
+
+        SC_THREAD(collect);
+        sensitive << clk.posedge_event();
+        async_reset_signal_is(rst, false);
+    }
+
+    // Sorted run of n distinct FP16 keys in [0, 128) (parity keeps A and B keys apart),
+    // values start at vbase
+    std::vector<BSU_IN_OUT_TYPE> make_run(std::mt19937 &gen, int n, int parity, int vbase) {
+        std::vector<int> keys(1024);
+        for (int i = 0; i < 1024; i++) keys[i] = 2*i + parity;
+        std::shuffle(keys.begin(), keys.end(), gen);
+        keys.resize(n);
+        std::sort(keys.begin(), keys.end());
+
+        std::vector<BSU_IN_OUT_TYPE> blocks((n + SORT_NUM - 1) / SORT_NUM);
+        for (size_t b = 0; b < blocks.size(); b++) {
+            for (int k = 0; k < SORT_NUM; k++) {
+                int i = b*SORT_NUM + k;
+                if (i < n) {
+                    blocks[b].x[k] = BSU_DATA_TYPE(keys[i] / 16.0);
+                    blocks[b].v[k] = vbase + i;
+                } else {
+                    blocks[b].x[k] = BSU_DATA_TYPE(65504.0);
+                    blocks[b].v[k] = 0;
+                }
+            }
+        }
+        return blocks;
+    }
+
+    void reset() {
+        rst.write(false);
+        wait(10);
+        rst.write(true);
+    }
+
+    void run() {
+        BMUConfig.ResetWrite();
+        BMUInputA.ResetWrite();
+        BMUInputB.ResetWrite();
+        wait(10);
+
+        for (int t = 0; t < NUM_TESTS; t++) {
+            BMU_CFG_TYPE cfg;
+            cfg.len_a = run_a[t].size();
+            cfg.len_b = run_b[t].size();
+            cout << "BMUConfig @ timestep: " << sc_time_stamp() << ": A = " << len_a[t]
+                 << " elements (" << cfg.len_a << " blocks), B = " << len_b[t]
+                 << " elements (" << cfg.len_b << " blocks)" << endl;
+            BMUConfig.Push(cfg);
+
+            size_t sa = 0, sb = 0;
+            while (sa < run_a[t].size() || sb < run_b[t].size()) {
+                if (sa < run_a[t].size() && BMUInputA.PushNB(run_a[t][sa])) sa++;
+                if (sb < run_b[t].size() && BMUInputB.PushNB(run_b[t][sb])) sb++;
+                wait();
+            }
+        }
+    }
+
+    void collect() {
+        BMUOutput.ResetRead();
+        wait(10);
+
+        for (int t = 0; t < NUM_TESTS; t++) {
+            // Expected: all pairs of both runs sorted by key
+            std::vector<std::pair<double, int> > expected;
+            for (size_t b = 0; b < run_a[t].size(); b++)
+                for (int k = 0; k < SORT_NUM; k++)
+                    expected.push_back(std::make_pair(run_a[t][b].x[k].to_double(), run_a[t][b].v[k].to_int()));
+            for (size_t b = 0; b < run_b[t].size(); b++)
+                for (int k = 0; k < SORT_NUM; k++)
+                    expected.push_back(std::make_pair(run_b[t][b].x[k].to_double(), run_b[t][b].v[k].to_int()));
+            std::stable_sort(expected.begin(), expected.end(),
+                             [](const std::pair<double, int> &a, const std::pair<double, int> &b) {
+                                 return a.first < b.first;
+                             });
+
+            sc_time start = sc_time_stamp();
+            bool ok = true;
+            size_t blocks = run_a[t].size() + run_b[t].size();
+            for (size_t b = 0; b < blocks; b++) {
+                BSU_IN_OUT_TYPE tmp = BMUOutput.Pop();
+                for (int k = 0; k < SORT_NUM; k++) {
+                    size_t i = b*SORT_NUM + k;
+                    if (tmp.x[k].to_double() != expected[i].first) ok = false;
+                    // padding values are not unique, only check real pairs
+                    if (expected[i].first < 65504.0 && tmp.v[k].to_int() != expected[i].second) ok = false;
+                }
+            }
+            cout << "BMUOutput @ timestep: " << sc_time_stamp() << ": test " << t << ", " << blocks
+                 << " blocks in " << (sc_time_stamp() - start).to_seconds()*1e9 << " cycles";
+            cout << (ok ? " ✓" : " ✗ (MISMATCH)") << endl;
+        }
+
+        sc_stop();
+    }
+};
+
+int sc_main(int argc, char *argv[]) {
+    testbench tb("tb");
+    sc_start();
+    return 0;
+}
@@ -12,7 +12,13 @@
 class BSU : public match::Module {
     SC_HAS_PROCESS(BSU);
 public:
-    
+
+    static const int LOG_SORT_NUM = nvhls::log2_ceil<SORT_NUM>::val;
+    static const int NET_STAGES = LOG_SORT_NUM * (LOG_SORT_NUM + 1) / 2;   // compare-exchange stages
+    static const int STAGES_PER_REG = (BSU_STAGES_PER_REG < NET_STAGES) ? BSU_STAGES_PER_REG : NET_STAGES;
+    static const int PIPE_STAGES = (NET_STAGES + STAGES_PER_REG - 1) / STAGES_PER_REG;
+    static const int COMPARATORS = STAGES_PER_REG * SORT_NUM / 2;         // per pipeline stage
+
     Connections::In<BSU_IN_OUT_TYPE> BSUInput;
     Connections::Out<BSU_IN_OUT_TYPE> BSUOutput;
 
@@ -24,54 +30,100 @@ public:
         async_reset_signal_is(rst, false);
     }
 
+    // Statistics
+    unsigned long sorted_blocks;
+    unsigned long output_stall_cycles;  // cycles the pipeline held because BSUOutput was full
+
+    // One compare-exchange stage: k is the size of the bitonic subsequences, j the distance of the pairs
+    static void CompareExchange(BSU_IN_OUT_TYPE &a, int k, int j) {
+        #pragma hls_unroll       // Compare and swap for each element in the array.
+        for (int i = 0; i < SORT_NUM; i++) {
+            int ixj = i ^ j; // bitwise XOR gives the paired index
+
+            // Only process each pair once
+            if (ixj > i) {
+                // Determine the direction:
+                // When (i & k) == 0, sort in ascending order.
+                // Otherwise, sort in descending order.
+                if (((i & k) == 0 && (a.x[i] > a.x[ixj])) ||
+                    ((i & k) != 0 && (a.x[i] < a.x[ixj]))) {
+                    // Swap the two elements
+                    BSU_DATA_TYPE temp = a.x[i];
+                    a.x[i] = a.x[ixj];
+                    a.x[ixj] = temp;
+                    BSU_VALUE_TYPE temp_v = a.v[i];
+                    a.v[i] = a.v[ixj];
+                    a.v[ixj] = temp_v;
+                }
+            }
+        }
+    }
+
+    // Network stages [p*STAGES_PER_REG, (p+1)*STAGES_PER_REG) of the bitonic sort (SORT_NUM a power of 2)
+    static void PipeStage(int p, BSU_IN_OUT_TYPE &a) {
+        int s = 0;
+        // k controls the size of the subsequences (doubling each stage)
+        // j controls the distance for compare–exchange within a bitonic sequence.
+        #pragma hls_unroll
+        for (int k = 2; k <= SORT_NUM; k <<= 1) {
+            #pragma hls_unroll
+            for (int j = k >> 1; j > 0; j >>= 1) {
+                if (s / STAGES_PER_REG == p) CompareExchange(a, k, j);
+                s++;
+            }
+        }
+    }
+
     /*
-     * Input: n-element
-     * Output: n-element
-     * Perform: sort 
+     * Input: n (key, value) pairs
+     * Output: n (key, value) pairs
+     * Perform: sort by key, values follow their keys
+     * PIPE_STAGES registered stages of STAGES_PER_REG network stages each, one array enters per cycle:
+     * latency PIPE_STAGES cycles, II 1. A full BSUOutput holds the whole pipeline.
      */
     void BSU_CALC() {
         BSUInput.Reset();
         BSUOutput.Reset();
+        sorted_blocks = 0;
+        output_stall_cycles = 0;
+
+        BSU_IN_OUT_TYPE pipe[PIPE_STAGES];  // stage registers, pipe[p] has been through stage p
+        bool valid[PIPE_STAGES];
+        #pragma hls_unroll
+        for (int p = 0; p < PIPE_STAGES; p++) {
+            valid[p] = false;
+        }
         wait();
 
         #pragma hls_pipeline_init_interval 1
         while (1) {
             wait();
-            
-            BSU_IN_OUT_TYPE bsu_input = BSUInput.Pop();
 
-            // Bitonic sort: the algorithm assumes SORT_NUM is a power of 2.
-            // k controls the size of the subsequences (doubling each stage)
-            // j controls the distance for compare–exchange within a bitonic sequence.
-            #pragma hls_unroll
-            for (int k = 2; k <= SORT_NUM; k <<= 1) {
-                #pragma hls_unroll
-                for (int j = k >> 1; j > 0; j >>= 1) {
-                    #pragma hls_unroll       // Compare and swap for each element in the array.
-                    for (int i = 0; i < SORT_NUM; i++) {
-                        int ixj = i ^ j; // bitwise XOR gives the paired index
-
-                        // Only process each pair once
-                        if (ixj > i) {
-                            // Determine the direction:
-                            // When (i & k) == 0, sort in ascending order.
-                            // Otherwise, sort in descending order.
-                            if (((i & k) == 0 && (bsu_input.x[i] > bsu_input.x[ixj])) ||
-                                ((i & k) != 0 && (bsu_input.x[i] < bsu_input.x[ixj]))) {
-                                // Swap the two elements
-                                BSU_DATA_TYPE temp = bsu_input.x[i];
-                                bsu_input.x[i] = bsu_input.x[ixj];
-                                bsu_input.x[ixj] = temp;
-                            }
-                        }
-                    }
-                    // Wait for one clock cycle after each j-loop stage to pipeline the operation    
+            // Push the sorted data to the output
+            if (valid[PIPE_STAGES-1]) {
+                if (NRSIM_PUSHNB(BSUOutput, pipe[PIPE_STAGES-1])) {
+                    valid[PIPE_STAGES-1] = false;
+                    sorted_blocks++;
+                } else {
+                    output_stall_cycles++;
+                    continue;
                 }
-                
             }
-            // Push the sorted data to the output
-            BSUOutput.PushNB(bsu_input);
-            
+
+            // Stages advance last to first, each reads the register of the previous cycle
+            #pragma hls_unroll
+            for (int p = PIPE_STAGES-1; p > 0; p--) {
+                pipe[p] = pipe[p-1];
+                PipeStage(p, pipe[p]);
+                valid[p] = valid[p-1];
+            }
+
+            BSU_IN_OUT_TYPE bsu_input;
+            valid[0] = NRSIM_POPNB(BSUInput, bsu_input);
+            if (valid[0]) {
+                PipeStage(0, bsu_input);
+                pipe[0] = bsu_input;
+            }
         }
     }
 
@@ -1,5 +1,7 @@
 #define NVHLS_VERIFY_BLOCKS (BSU)
 #include "BSU.h"
+#include "GSCORETrace.h"
+#include "../../common/include/nrsim_timing.h"
 #include <nvhls_verify.h>
 //#include <mc_scverify.h>
 #include "nvhls_connections.h"
@@ -9,6 +11,18 @@
 #include <systemc.h>
 #include <nvhls_module.h>
 #include <mc_connections.h>
+#include <vector>
+#include <algorithm>
+#include <string>
+
+/*
+ * Usage: sim_BSU
+ * BSU_BLOCKS descending arrays pushed back to back, each output checked ascending with its values. The latency
+ * (first array in to first array out) and II (cycles between outputs) are measured, HLS latency / II of the
+ * same BSU_STAGES_PER_REG: cycle.rpt of the printed make hls.
+ *        sim_BSU trace <scene.gstr>
+ */
+#define BSU_BLOCKS 5
 
 #pragma hls_design top
 class testbench : public sc_module {
@@ -21,6 +35,8 @@ public:
 
     NVHLS_DESIGN(BSU) dut;
 
+    sc_time first_in;
+
     SC_CTOR(testbench) : clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
                    rst("rst"),
                    BSUInput("BSUInput"),
@@ -56,12 +72,14 @@ public:
         BSUInput.ResetWrite();
         wait(10);
 
-        for (int t = 0; t < 5; t++) {
+        first_in = sc_time_stamp();
+        for (int t = 0; t < BSU_BLOCKS; t++) {
             BSU_IN_OUT_TYPE bsu_in;
             cout << "BSUInput: @ timestep: " << sc_time_stamp() << ": ";
             #pragma unroll
             for (int i = 0; i < SORT_NUM; i++) {
                 bsu_in.x[i] = BSU_DATA_TYPE( (t+1)*SORT_NUM - i );   
+                bsu_in.v[i] = i;
                 cout << (t+1)*SORT_NUM - i << " ";
             }
             cout << endl;
@@ -74,23 +92,175 @@ public:
         while (1) {
             wait(); // 1 cc
 
-            for (int t = 0; t < 5; t++) {
+            sc_time first_out, last_out;
+            for (int t = 0; t < BSU_BLOCKS; t++) {
                 BSU_IN_OUT_TYPE tmp;
                 tmp = BSUOutput.Pop();
+                if (t == 0) first_out = sc_time_stamp();
+                last_out = sc_time_stamp();
                 // compare with sample_color in vru_test.h
                 cout << "BSUOutput: @ timestep: " << sc_time_stamp() << ": ";
+                bool ok = true;
                 for (uint j = 0; j < SORT_NUM; j++) {
-                    cout << tmp.x[j] << " ";
+                    cout << tmp.x[j] << "(" << tmp.v[j] << ") ";
+                    // ascending keys, value still points at the original position of its key
+                    if (j > 0 && tmp.x[j] < tmp.x[j-1]) ok = false;
+                    if (tmp.x[j].to_double() != double((t+1)*SORT_NUM - tmp.v[j].to_int())) ok = false;
                 }
-                cout << endl;
+                cout << (ok ? " ✓" : " ✗ (MISMATCH)") << endl;
             }
 
+            double latency = (first_out - first_in) / sc_time(1, SC_NS);
+            double ii = (last_out - first_out) / sc_time(1, SC_NS) / (BSU_BLOCKS - 1);
+            cout << "BSU network: " << BSU::NET_STAGES << " compare-exchange stages in " << BSU::PIPE_STAGES
+                 << " pipeline stages of " << BSU::COMPARATORS << " comparators (BSU_STAGES_PER_REG = "
+                 << BSU::STAGES_PER_REG << ")" << endl;
+            cout << "Measured latency = " << latency << " cycles, II = " << ii << " cycles per array "
+                 << (ii <= 1.0 ? "✓" : "✗ (MISMATCH)") << ", output stall cycles = " << dut.output_stall_cycles << endl;
+            cout << "HLS: make hls PROJ_PATH=GSCore/BSU HLS_BUILD_NAME=build_hls_bsu" << BSU::STAGES_PER_REG
+                 << " HLS_DEFINES=\"-DBSU_STAGES_PER_REG=" << BSU::STAGES_PER_REG << "\"" << endl;
             sc_stop();
         }
     }
 };
 
+/*
+ * Trace-driven run (./sim_BSU trace <scene.gstr>): the depths of every tile in CCU (gid) order,
+ * cut into SORT_NUM chunks (last chunk padded with FP16 max), one chunk per cycle when possible
+ */
+class trace_bench : public sc_module {
+public:
+    sc_clock clk;
+    sc_signal<bool> rst;
+
+    Connections::Combinational<BSU_IN_OUT_TYPE> BSUInput;
+    Connections::Combinational<BSU_IN_OUT_TYPE> BSUOutput;
+
+    BSU dut;
+
+    GSTraceReader feed;         // run() cursor
+    GSTraceReader check;        // collect() cursor
+
+    SC_HAS_PROCESS(trace_bench);
+    trace_bench(sc_module_name name, const char *path) : sc_module(name),
+                                                         clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
+                                                         rst("rst"),
+                                                         BSUInput("BSUInput"),
+                                                         BSUOutput("BSUOutput"),
+                                                         dut("dut") {
+        sc_object_tracer<sc_clock> trace_clk(clk);
+
+        dut.clk(clk);
+        dut.rst(rst);
+        dut.BSUInput(BSUInput);
+        dut.BSUOutput(BSUOutput);
+
+        if (!feed.Open(path) || !check.Open(path)) exit(1);
+
+        SC_THREAD(reset);
+        sensitive << clk.posedge_event();
+
+        SC_THREAD(run);
+        sensitive << clk.posedge_event();
+        async_reset_signal_is(rst, false);
+
+        SC_THREAD(collect);
+        sensitive << clk.posedge_event();
+        async_reset_signal_is(rst, false);
+    }
+
+    void reset() {
+        rst.write(false);
+        wait(10);
+        rst.write(true);
+    }
+
+    // Chunks of one tile, values are the tile-local index of the Gaussian
+    static void tile_chunks(const GSTraceTile &tile, const GSTraceGauss *gauss,
+                            std::vector<BSU_IN_OUT_TYPE> &chunks) {
+        std::vector<int> order(tile.num_gaussians);
+        for (size_t k = 0; k < order.size(); k++) order[k] = k;
+        std::sort(order.begin(), order.end(), [gauss](int a, int b) { return gauss[a].gid < gauss[b].gid; });
+        chunks.resize((order.size() + SORT_NUM - 1) / SORT_NUM);
+        for (size_t c = 0; c < chunks.size(); c++) {
+            for (int i = 0; i < SORT_NUM; i++) {
+                size_t k = c*SORT_NUM + i;
+                chunks[c].x[i] = (k < order.size()) ? BSU_DATA_TYPE(double(gauss[order[k]].depth))
+                                                    : BSU_DATA_TYPE(65504.0);
+                chunks[c].v[i] = (k < order.size()) ? order[k] : 0;
+            }
+        }
+    }
+
+    void run() {
+        BSUInput.ResetWrite();
+        wait(10);
+
+        GSTraceTile tile;
+        const GSTraceGauss *gauss;
+        std::vector<BSU_IN_OUT_TYPE> chunks;
+        while (feed.NextTile(tile, gauss)) {
+            tile_chunks(tile, gauss, chunks);
+            for (size_t c = 0; c < chunks.size(); c++) {
+                BSUInput.Push(chunks[c]);
+            }
+        }
+    }
+
+    void collect() {
+        BSUOutput.ResetRead();
+        wait(10);
+
+        sc_time start = sc_time_stamp(), first_out;
+        GSTraceTile tile;
+        const GSTraceGauss *gauss;
+        std::vector<BSU_IN_OUT_TYPE> chunks;
+        unsigned long mismatches = 0, blocks = 0, tiles = 0;
+        while (check.NextTile(tile, gauss)) {
+            tile_chunks(tile, gauss, chunks);
+            for (size_t c = 0; c < chunks.size(); c++) {
+                BSU_IN_OUT_TYPE o = BSUOutput.Pop();
+                if (blocks == 0) first_out = sc_time_stamp();
+                bool ok = true;
+                for (int j = 0; j < SORT_NUM; j++) {
+                    if (j > 0 && o.x[j] < o.x[j-1]) ok = false;
+                    // padding keys share value 0, only real pairs must keep their Gaussian
+                    if (o.x[j].to_double() < 65504.0) {
+                        int k = o.v[j].to_int();
+                        if (k >= (int)tile.num_gaussians ||
+                            BSU_DATA_TYPE(double(gauss[k].depth)).to_double() != o.x[j].to_double()) ok = false;
+                    }
+                }
+                if (!ok) mismatches++;
+                blocks++;
+            }
+            tiles++;
+        }
+
+        double cycles = (sc_time_stamp() - start).to_seconds()*1e9;
+        const GSTraceHeader &h = check.Header();
+        cout << "=== BSU trace: " << h.width << "x" << h.height << ", " << tiles << " tiles, "
+             << h.num_pairs << " tile-Gaussian pairs ===" << endl;
+        cout << "Blocks = " << blocks << " | cycles = " << cycles
+             << " | blocks/cycle = " << (cycles > 0 ? blocks / cycles : 0.0)
+             << " | padding = " << (blocks ? 100.0 * (1.0 - double(h.num_pairs) / (blocks * SORT_NUM)) : 0.0)
+             << "%" << endl;
+        cout << "Unsorted blocks = " << mismatches << (mismatches == 0 ? " ✓" : " ✗ (MISMATCH)") << endl;
+        nrsim::TimingReport timing("BSU");
+        timing.Op("sort", "key", double(blocks) * SORT_NUM, cycles, (first_out - start).to_seconds()*1e9);
+        timing.Value("sort_num", SORT_NUM);
+        timing.Value("pipe_stages", BSU::PIPE_STAGES);
+        timing.Write();
+        sc_stop();
+    }
+};
+
 int sc_main(int argc, char *argv[]) {
+    if (argc > 2 && std::string(argv[1]) == "trace") {
+        trace_bench tb("tb", argv[2]);
+        sc_start();
+        return 0;
+    }
     testbench tb("tb");
     sc_start();
     return 0;
@@ -0,0 +1,231 @@
+#ifndef GSCORE_CCU_H
+#define GSCORE_CCU_H
+
+#include "GSCOREPackDef.h"
+#include <ac_channel.h>
+#include <nvhls_connections.h>
+#include <ac_math.h>
+#include <ac_std_float.h>
+
+/*
+ * Culling & Conversion Unit
+ * Input: camera (once per frame), 3D Gaussians
+ * Output: visible projected 2D Gaussians (mean, conic, color, opacity, radius, touched tiles)
+ * Perform: frustum culling -> EWA projection of the 3D covariance -> inverse 2D covariance
+ *          -> SH evaluation for the view direction, one Gaussian per cycle
+ */
+#pragma hls_design block
+class CCU : public match::Module {
+    SC_HAS_PROCESS(CCU);
+public:
+
+    Connections::In<CCU_CAM_TYPE> CCUCamera;
+    Connections::In<CCU_IN_TYPE> CCUInput;
+    Connections::Out<CCU_OUT_TYPE> CCUOutput;
+
+    CCU(sc_module_name name) : match::Module(name),
+                               CCUCamera("CCUCamera"),
+                               CCUInput("CCUInput"),
+                               CCUOutput("CCUOutput") {
+        SC_THREAD(CCU_CALC);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+    }
+
+    // Current camera
+    CCU_CAM_TYPE cam;
+
+    // Statistics
+    unsigned long gauss_in;         // Gaussians received
+    unsigned long gauss_culled;     // Gaussians culled (near plane, frustum, degenerate, off-screen)
+    unsigned long busy_cycles;      // cycles spent on a Gaussian, including output back-pressure
+
+    // Evaluate SH (degree SH_DEGREE) for the unit view direction, 3DGS convention (+0.5, clamp at 0)
+    void EvalSH(const CCU_IN_TYPE &g, FP32_TYPE x, FP32_TYPE y, FP32_TYPE z, RGB_TYPE &color) {
+        FP32_TYPE basis[SH_COEFFS];
+        basis[0] = FP32_TYPE(0.28209479177387814);
+#if SH_DEGREE > 0
+        basis[1] = FP32_TYPE(-0.4886025119029199) * y;
+        basis[2] = FP32_TYPE(0.4886025119029199) * z;
+        basis[3] = FP32_TYPE(-0.4886025119029199) * x;
+#endif
+#if SH_DEGREE > 1
+        basis[4] = FP32_TYPE(1.0925484305920792) * x * y;
+        basis[5] = FP32_TYPE(-1.0925484305920792) * y * z;
+        basis[6] = FP32_TYPE(0.31539156525252005) * (FP32_TYPE(2.0) * z * z - x * x - y * y);
+        basis[7] = FP32_TYPE(-1.0925484305920792) * x * z;
+        basis[8] = FP32_TYPE(0.5462742152960396) * (x * x - y * y);
+#endif
+
+        FP32_TYPE rgb[3];
+        #pragma hls_unroll
+        for (int c = 0; c < 3; c++) {
+            FP32_TYPE acc = FP32_TYPE(0.5);
+            #pragma hls_unroll
+            for (int k = 0; k < SH_COEFFS; k++) {
+                acc += basis[k] * FP32_TYPE(g.sh[k*3 + c]);
+            }
+            rgb[c] = (acc < FP32_TYPE(0.0)) ? FP32_TYPE(0.0) : acc;
+        }
+        color.r = FP16_TYPE(rgb[0]);
+        color.g = FP16_TYPE(rgb[1]);
+        color.b = FP16_TYPE(rgb[2]);
+    }
+
+    // floor(x) for screen-space values
+    int FloorToInt(FP32_TYPE x) {
+        return x.convert_to_ac_fixed<32, 20, true, AC_TRN, AC_SAT>().to_int();
+    }
+
+    // Tile range [lo, hi) touched by [p - r, p + r], clamped to [0, grid)
+    void TileRange(FP32_TYPE p, int r, int grid, UINT16_TYPE &lo, UINT16_TYPE &hi) {
+        FP32_TYPE inv_tile = FP32_TYPE(1.0 / TILE_SIZE);
+        int l = FloorToInt((p - FP32_TYPE(double(r))) * inv_tile);
+        int h = FloorToInt((p + FP32_TYPE(double(r + TILE_SIZE - 1))) * inv_tile);
+        lo = (l < 0) ? 0 : ((l > grid) ? grid : l);
+        hi = (h < 0) ? 0 : ((h > grid) ? grid : h);
+    }
+
+    /*
+     * Input: 3D Gaussian
+     * Output: projected Gaussian, false if culled
+     */
+    bool Project(const CCU_IN_TYPE &g, CCU_OUT_TYPE &o) {
+        // World -> view space
+        FP32_TYPE t[3];
+        #pragma hls_unroll
+        for (int i = 0; i < 3; i++) {
+            t[i] = cam.view[i*4 + 0] * g.mean[0] + cam.view[i*4 + 1] * g.mean[1]
+                 + cam.view[i*4 + 2] * g.mean[2] + cam.view[i*4 + 3];
+        }
+
+        // Near plane culling
+        if (t[2] < FP32_TYPE(CCU_NEAR_PLANE)) return false;
+        FP32_TYPE inv_z;
+        ac_math::ac_reciprocal_pwl(t[2], inv_z);
+        FP32_TYPE tx_z = t[0] * inv_z;
+        FP32_TYPE ty_z = t[1] * inv_z;
+
+        // Frustum culling (tan(fov/2) = c / f)
+        FP32_TYPE inv_fx, inv_fy;
+        ac_math::ac_reciprocal_pwl(cam.fx, inv_fx);
+        ac_math::ac_reciprocal_pwl(cam.fy, inv_fy);
+        FP32_TYPE lim_x = FP32_TYPE(CCU_FRUSTUM_GUARD) * cam.cx * inv_fx;
+        FP32_TYPE lim_y = FP32_TYPE(CCU_FRUSTUM_GUARD) * cam.cy * inv_fy;
+        if (tx_z > lim_x || tx_z < -lim_x || ty_z > lim_y || ty_z < -lim_y) return false;
+
+        // Jacobian of the perspective projection
+        FP32_TYPE j00 = cam.fx * inv_z;
+        FP32_TYPE j02 = -cam.fx * tx_z * inv_z;
+        FP32_TYPE j11 = cam.fy * inv_z;
+        FP32_TYPE j12 = -cam.fy * ty_z * inv_z;
+
+        // T = J * W (2x3), W = rotation part of the view matrix
+        FP32_TYPE T[2][3];
+        #pragma hls_unroll
+        for (int k = 0; k < 3; k++) {
+            T[0][k] = j00 * cam.view[0*4 + k] + j02 * cam.view[2*4 + k];
+            T[1][k] = j11 * cam.view[1*4 + k] + j12 * cam.view[2*4 + k];
+        }
+
+        // cov2d = T * Sigma * T^T
+        FP32_TYPE S[3][3];
+        S[0][0] = g.cov3d[0]; S[0][1] = g.cov3d[1]; S[0][2] = g.cov3d[2];
+        S[1][0] = g.cov3d[1]; S[1][1] = g.cov3d[3]; S[1][2] = g.cov3d[4];
+        S[2][0] = g.cov3d[2]; S[2][1] = g.cov3d[4]; S[2][2] = g.cov3d[5];
+        FP32_TYPE M[2][3];
+        #pragma hls_unroll
+        for (int i = 0; i < 2; i++) {
+            #pragma hls_unroll
+            for (int k = 0; k < 3; k++) {
+                M[i][k] = T[i][0] * S[0][k] + T[i][1] * S[1][k] + T[i][2] * S[2][k];
+            }
+        }
+        FP32_TYPE a = M[0][0] * T[0][0] + M[0][1] * T[0][1] + M[0][2] * T[0][2] + FP32_TYPE(CCU_LOW_PASS);
+        FP32_TYPE b = M[0][0] * T[1][0] + M[0][1] * T[1][1] + M[0][2] * T[1][2];
+        FP32_TYPE c = M[1][0] * T[1][0] + M[1][1] * T[1][1] + M[1][2] * T[1][2] + FP32_TYPE(CCU_LOW_PASS);
+
+        // Inverse 2D covariance
+        FP32_TYPE det = a * c - b * b;
+        if (!(det > FP32_TYPE(0.0))) return false;
+        FP32_TYPE inv_det;
+        ac_math::ac_reciprocal_pwl(det, inv_det);
+        o.conx = FP16_TYPE(c * inv_det);
+        o.cony = FP16_TYPE(-b * inv_det);
+        o.conz = FP16_TYPE(a * inv_det);
+
+        // 3-sigma radius from the largest eigenvalue, sqrt(x) = x * x^-1/2
+        FP32_TYPE mid = FP32_TYPE(0.5) * (a + c);
+        FP32_TYPE disc = mid * mid - det;
+        if (disc < FP32_TYPE(0.1)) disc = FP32_TYPE(0.1);
+        FP32_TYPE inv_sqrt_disc;
+        ac_math::ac_inverse_sqrt_pwl(disc, inv_sqrt_disc);
+        FP32_TYPE lambda = mid + disc * inv_sqrt_disc;
+        FP32_TYPE inv_sqrt_lambda;
+        ac_math::ac_inverse_sqrt_pwl(lambda, inv_sqrt_lambda);
+        FP32_TYPE r3 = FP32_TYPE(3.0) * lambda * inv_sqrt_lambda;
+        int radius = FloorToInt(r3);
+        if (FP32_TYPE(double(radius)) < r3) radius++;           // ceil
+
+        // Screen-space mean and touched tiles
+        o.mean_x = cam.fx * tx_z + cam.cx;
+        o.mean_y = cam.fy * ty_z + cam.cy;
+        TileRange(o.mean_x, radius, cam.grid_x.to_int(), o.tile_min_x, o.tile_max_x);
+        TileRange(o.mean_y, radius, cam.grid_y.to_int(), o.tile_min_y, o.tile_max_y);
+        if (o.tile_min_x == o.tile_max_x || o.tile_min_y == o.tile_max_y) return false;
+
+        // View-dependent color
+        FP32_TYPE d[3];
+        #pragma hls_unroll
+        for (int i = 0; i < 3; i++) {
+            d[i] = g.mean[i] - cam.cam_pos[i];
+        }
+        FP32_TYPE inv_len;
+        ac_math::ac_inverse_sqrt_pwl(FP32_TYPE(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]), inv_len);
+        EvalSH(g, d[0] * inv_len, d[1] * inv_len, d[2] * inv_len, o.color);
+
+        o.gid = g.gid;
+        o.depth = FP16_TYPE(t[2]);
+        o.opacity = g.opacity;
+        o.radius = radius;
+        return true;
+    }
+
+    void CCU_CALC() {
+        CCUCamera.Reset();
+        CCUInput.Reset();
+        CCUOutput.Reset();
+        gauss_in = 0;
+        gauss_culled = 0;
+        busy_cycles = 0;
+        wait();
+
+        #pragma hls_pipeline_init_interval 1
+        while (1) {
+            wait();
+
+            CCU_CAM_TYPE new_cam;
+            if (NRSIM_POPNB(CCUCamera, new_cam)) {
+                cam = new_cam;
+            }
+
+            CCU_IN_TYPE g;
+            if (NRSIM_POPNB(CCUInput, g)) {
+                gauss_in++;
+                busy_cycles++;
+                CCU_OUT_TYPE o;
+                if (Project(g, o)) {
+                    while (!NRSIM_PUSHNB(CCUOutput, o)) {
+                        busy_cycles++;
+                        wait();
+                    }
+                } else {
+                    gauss_culled++;
+                }
+            }
+        }
+    }
+
+};
+
+#endif //GSCORE_CCU_H
@@ -0,0 +1,308 @@
+#define NVHLS_VERIFY_BLOCKS (CCU)
+#include "CCU.h"
+#include "../../common/include/nrsim_timing.h"
+#include <nvhls_verify.h>
+#include "nvhls_connections.h"
+#include "ac_sysc_trace.h"
+#include <random>
+#include <systemc.h>
+#include <nvhls_module.h>
+#include <mc_connections.h>
+#include <cmath>
+#include <vector>
+#include <iomanip>
+
+#define NUM_GAUSS 256
+#define IMG_W 800
+#define IMG_H 800
+
+// Double-precision reference of one projected Gaussian
+struct RefGauss {
+    int gid;
+    double depth, mean_x, mean_y, conx, cony, conz, r, g, b;
+    int radius, tile_min_x, tile_min_y, tile_max_x, tile_max_y;
+};
+
+#pragma hls_design top
+class testbench : public sc_module {
+public:
+    sc_clock clk;
+    sc_signal<bool> rst;
+
+    Connections::Combinational<CCU_CAM_TYPE> CCUCamera;
+    Connections::Combinational<CCU_IN_TYPE> CCUInput;
+    Connections::Combinational<CCU_OUT_TYPE> CCUOutput;
+
+    NVHLS_DESIGN(CCU) dut;
+
+    double view[12];
+    double cam_pos[3];
+    std::vector<CCU_IN_TYPE> scene;
+    std::vector<RefGauss> expected;
+    sc_time start, first_out;
+
+    SC_CTOR(testbench) : clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
+                   rst("rst"),
+                   CCUCamera("CCUCamera"),
+                   CCUInput("CCUInput"),
+                   CCUOutput("CCUOutput"),
+                   dut("dut") {
+
+        sc_object_tracer<sc_clock> trace_clk(clk);
+
+        dut.clk(clk);
+        dut.rst(rst);
+        dut.CCUCamera(CCUCamera);
+        dut.CCUInput(CCUInput);
+        dut.CCUOutput(CCUOutput);
+
+        generate_scene();
+
+        SC_THREAD(reset);
+        sensitive << clk.posedge_event();
+
+        SC_THREAD(run);
+        sensitive << clk.posedge_event();
+        async_reset_signal_is(rst, false);
+
+        SC_THREAD(collect);
+        sensitive << clk.posedge_event();
+        async_reset_signal_is(rst, false);
+    }
+
+    void reset() {
+        rst.write(false);
+        wait(10);
+        rst.write(true);
+    }
+
+    // Camera at (0.5, -0.3, -1) looking along +z, slightly rotated around y
+    void make_camera(CCU_CAM_TYPE &cam) {
+        double th = 0.1;
+        double R[3][3] = {{cos(th), 0, -sin(th)}, {0, 1, 0}, {sin(th), 0, cos(th)}};
+        cam_pos[0] = 0.5; cam_pos[1] = -0.3; cam_pos[2] = -1.0;
+        for (int i = 0; i < 3; i++) {
+            double t = 0;
+            for (int k = 0; k < 3; k++) {
+                view[i*4 + k] = R[i][k];
+                t -= R[i][k] * cam_pos[k];
+            }
+            view[i*4 + 3] = t;
+        }
+        for (int i = 0; i < 12; i++) cam.view[i] = FP32_TYPE(view[i]);
+        for (int i = 0; i < 3; i++) cam.cam_pos[i] = FP32_TYPE(cam_pos[i]);
+        cam.fx = FP32_TYPE(800.0);
+        cam.fy = FP32_TYPE(800.0);
+        cam.cx = FP32_TYPE(IMG_W / 2.0);
+        cam.cy = FP32_TYPE(IMG_H / 2.0);
+        cam.grid_x = (IMG_W + TILE_SIZE - 1) / TILE_SIZE;
+        cam.grid_y = (IMG_H + TILE_SIZE - 1) / TILE_SIZE;
+    }
+
+    // Random Gaussians in front of, beside and behind the camera
+    void generate_scene() {
+        std::mt19937 gen(3);
+        std::uniform_real_distribution<double> u(0.0, 1.0);
+        for (int n = 0; n < NUM_GAUSS; n++) {
+            CCU_IN_TYPE g;
+            g.gid = n;
+            g.mean[0] = FP32_TYPE(-8.0 + 16.0*u(gen));
+            g.mean[1] = FP32_TYPE(-8.0 + 16.0*u(gen));
+            g.mean[2] = FP32_TYPE(-3.0 + 15.0*u(gen));
+
+            // Sigma = R diag(s^2) R^T, rotation about a random axis
+            double s[3] = {0.02 + 0.2*u(gen), 0.02 + 0.2*u(gen), 0.02 + 0.2*u(gen)};
+            double ax[3] = {u(gen) - 0.5, u(gen) - 0.5, u(gen) - 0.5};
+            double len = sqrt(ax[0]*ax[0] + ax[1]*ax[1] + ax[2]*ax[2]);
+            for (int i = 0; i < 3; i++) ax[i] /= len;
+            double a = 2*M_PI*u(gen), ca = cos(a), sa = sin(a);
+            double R[3][3];
+            for (int i = 0; i < 3; i++)
+                for (int j = 0; j < 3; j++)
+                    R[i][j] = (i == j ? ca : 0) + (1 - ca)*ax[i]*ax[j];
+            R[0][1] -= sa*ax[2]; R[0][2] += sa*ax[1];
+            R[1][0] += sa*ax[2]; R[1][2] -= sa*ax[0];
+            R[2][0] -= sa*ax[1]; R[2][1] += sa*ax[0];
+            double S[3][3];
+            for (int i = 0; i < 3; i++)
+                for (int j = 0; j < 3; j++) {
+                    S[i][j] = 0;
+                    for (int k = 0; k < 3; k++) S[i][j] += R[i][k]*s[k]*s[k]*R[j][k];
+                }
+            g.cov3d[0] = FP32_TYPE(S[0][0]); g.cov3d[1] = FP32_TYPE(S[0][1]); g.cov3d[2] = FP32_TYPE(S[0][2]);
+            g.cov3d[3] = FP32_TYPE(S[1][1]); g.cov3d[4] = FP32_TYPE(S[1][2]); g.cov3d[5] = FP32_TYPE(S[2][2]);
+
+            for (int k = 0; k < 3*SH_COEFFS; k++) {
+                g.sh[k] = FP16_TYPE((k < 3) ? 2.0*u(gen) - 0.5 : 0.4*(u(gen) - 0.5));
+            }
+            g.opacity = FP16_TYPE(0.05 + 0.9*u(gen));
+            scene.push_back(g);
+        }
+    }
+
+    static int ref_floor(double x) { return (int)floor(x); }
+
+    // Same math as CCU::Project in double precision
+    bool reference(const CCU_IN_TYPE &g, const CCU_CAM_TYPE &cam, RefGauss &o) {
+        double m[3] = {g.mean[0].to_double(), g.mean[1].to_double(), g.mean[2].to_double()};
+        double t[3];
+        for (int i = 0; i < 3; i++)
+            t[i] = view[i*4]*m[0] + view[i*4+1]*m[1] + view[i*4+2]*m[2] + view[i*4+3];
+        if (t[2] < CCU_NEAR_PLANE) return false;
+        double fx = cam.fx.to_double(), fy = cam.fy.to_double();
+        double cx = cam.cx.to_double(), cy = cam.cy.to_double();
+        double txz = t[0]/t[2], tyz = t[1]/t[2];
+        double lx = CCU_FRUSTUM_GUARD*cx/fx, ly = CCU_FRUSTUM_GUARD*cy/fy;
+        if (txz > lx || txz < -lx || tyz > ly || tyz < -ly) return false;
+
+        double j00 = fx/t[2], j02 = -fx*txz/t[2], j11 = fy/t[2], j12 = -fy*tyz/t[2];
+        double T[2][3];
+        for (int k = 0; k < 3; k++) {
+            T[0][k] = j00*view[k] + j02*view[8+k];
+            T[1][k] = j11*view[4+k] + j12*view[8+k];
+        }
+        double c3[6];
+        for (int i = 0; i < 6; i++) c3[i] = g.cov3d[i].to_double();
+        double S[3][3] = {{c3[0], c3[1], c3[2]}, {c3[1], c3[3], c3[4]}, {c3[2], c3[4], c3[5]}};
+        double M[2][3];
+        for (int i = 0; i < 2; i++)
+            for (int k = 0; k < 3; k++)
+                M[i][k] = T[i][0]*S[0][k] + T[i][1]*S[1][k] + T[i][2]*S[2][k];
+        double a = M[0][0]*T[0][0] + M[0][1]*T[0][1] + M[0][2]*T[0][2] + CCU_LOW_PASS;
+        double b = M[0][0]*T[1][0] + M[0][1]*T[1][1] + M[0][2]*T[1][2];
+        double c = M[1][0]*T[1][0] + M[1][1]*T[1][1] + M[1][2]*T[1][2] + CCU_LOW_PASS;
+        double det = a*c - b*b;
+        if (!(det > 0)) return false;
+        o.conx = c/det; o.cony = -b/det; o.conz = a/det;
+        double mid = 0.5*(a + c);
+        double lambda = mid + sqrt(std::max(0.1, mid*mid - det));
+        o.radius = (int)ceil(3.0*sqrt(lambda));
+        o.mean_x = fx*txz + cx;
+        o.mean_y = fy*tyz + cy;
+        int gx = cam.grid_x.to_int(), gy = cam.grid_y.to_int();
+        o.tile_min_x = std::min(gx, std::max(0, ref_floor((o.mean_x - o.radius)/TILE_SIZE)));
+        o.tile_max_x = std::min(gx, std::max(0, ref_floor((o.mean_x + o.radius + TILE_SIZE - 1)/TILE_SIZE)));
+        o.tile_min_y = std::min(gy, std::max(0, ref_floor((o.mean_y - o.radius)/TILE_SIZE)));
+        o.tile_max_y = std::min(gy, std::max(0, ref_floor((o.mean_y + o.radius + TILE_SIZE - 1)/TILE_SIZE)));
+        if (o.tile_min_x == o.tile_max_x || o.tile_min_y == o.tile_max_y) return false;
+
+        double d[3] = {m[0] - cam_pos[0], m[1] - cam_pos[1], m[2] - cam_pos[2]};
+        double len = sqrt(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+        double x = d[0]/len, y = d[1]/len, z = d[2]/len;
+        double basis[9] = {0.28209479177387814,
+                           -0.4886025119029199*y, 0.4886025119029199*z, -0.4886025119029199*x,
+                           1.0925484305920792*x*y, -1.0925484305920792*y*z,
+                           0.31539156525252005*(2*z*z - x*x - y*y), -1.0925484305920792*x*z,
+                           0.5462742152960396*(x*x - y*y)};
+        double rgb[3];
+        for (int ch = 0; ch < 3; ch++) {
+            double acc = 0.5;
+            for (int k = 0; k < SH_COEFFS; k++) acc += basis[k]*g.sh[k*3 + ch].to_double();
+            rgb[ch] = std::max(0.0, acc);
+        }
+        o.r = rgb[0]; o.g = rgb[1]; o.b = rgb[2];
+        o.gid = g.gid;
+        o.depth = t[2];
+        return true;
+    }
+
+    void run() {
+        CCUCamera.ResetWrite();
+        CCUInput.ResetWrite();
+        wait(10);
+
+        CCU_CAM_TYPE cam;
+        make_camera(cam);
+        for (size_t n = 0; n < scene.size(); n++) {
+            RefGauss r;
+            if (reference(scene[n], cam, r)) expected.push_back(r);
+        }
+        cout << "CCUCamera @ timestep: " << sc_time_stamp() << ": " << IMG_W << "x" << IMG_H
+             << ", " << cam.grid_x << "x" << cam.grid_y << " tiles" << endl;
+        CCUCamera.Push(cam);
+        wait(2);
+
+        start = sc_time_stamp();
+        for (size_t n = 0; n < scene.size(); n++) {
+            CCUInput.Push(scene[n]);
+        }
+    }
+
+    static double rel_err(double x, double ref) {
+        return fabs(x - ref) / std::max(fabs(ref), 1e-3);
+    }
+
+    void collect() {
+        CCUOutput.ResetRead();
+        wait(20);
+
+        // Wait until the CCU has seen every Gaussian, then drain
+        while (dut.gauss_in < NUM_GAUSS) {
+            CCU_OUT_TYPE o;
+            if (CCUOutput.PopNB(o)) check(o);
+            wait();
+        }
+        for (int i = 0; i < 10; i++) {
+            CCU_OUT_TYPE o;
+            if (CCUOutput.PopNB(o)) check(o);
+            wait();
+        }
+
+        double cycles = (sc_time_stamp() - start).to_seconds()*1e9;
+        cout << "\n=== CCU Statistics ===" << endl;
+        cout << "Gaussians in: " << dut.gauss_in << ", culled: " << dut.gauss_culled
+             << " (" << std::setprecision(3) << 100.0*dut.gauss_culled/dut.gauss_in << "%)"
+             << ", expected culled: " << NUM_GAUSS - expected.size() << endl;
+        cout << "Busy cycles per Gaussian: " << double(dut.busy_cycles)/dut.gauss_in
+             << ", wall cycles per Gaussian: " << cycles/dut.gauss_in << endl;
+        cout << "Outputs: " << received << "/" << expected.size() << ", mismatches: " << mismatches;
+        if (received == expected.size() && mismatches == 0) {
+            cout << " ✓" << endl;
+        } else {
+            cout << " ✗ (MISMATCH)" << endl;
+        }
+        nrsim::TimingReport timing("CCU");
+        timing.Op("preprocess", "Gaussian", dut.gauss_in, cycles, (first_out - start).to_seconds()*1e9);
+        timing.Write();
+        sc_stop();
+    }
+
+    size_t received = 0;
+    int mismatches = 0;
+
+    void check(const CCU_OUT_TYPE &o) {
+        if (received >= expected.size()) {
+            mismatches++;
+            return;
+        }
+        if (received == 0) first_out = sc_time_stamp();
+        const RefGauss &e = expected[received++];
+        // FP16 outputs: ~1e-2 relative, FP32 screen position: 0.05 px, radius/tiles +-1 (rounding)
+        bool ok = (o.gid.to_int() == e.gid)
+               && rel_err(o.depth.to_double(), e.depth) < 1e-2
+               && fabs(o.mean_x.to_double() - e.mean_x) < 0.05
+               && fabs(o.mean_y.to_double() - e.mean_y) < 0.05
+               && rel_err(o.conx.to_double(), e.conx) < 2e-2
+               && fabs(o.cony.to_double() - e.cony) < 2e-2*std::max(fabs(e.conx), fabs(e.conz))
+               && rel_err(o.conz.to_double(), e.conz) < 2e-2
+               && fabs(o.color.r.to_double() - e.r) < 2e-2
+               && fabs(o.color.g.to_double() - e.g) < 2e-2
+               && fabs(o.color.b.to_double() - e.b) < 2e-2
+               && abs(o.radius.to_int() - e.radius) <= 1
+               && abs(o.tile_min_x.to_int() - e.tile_min_x) <= 1 && abs(o.tile_max_x.to_int() - e.tile_max_x) <= 1
+               && abs(o.tile_min_y.to_int() - e.tile_min_y) <= 1 && abs(o.tile_max_y.to_int() - e.tile_max_y) <= 1;
+        if (!ok) {
+            mismatches++;
+            cout << "CCUOutput @ timestep: " << sc_time_stamp() << ": GID = " << o.gid
+                 << " (expected " << e.gid << "), mean = (" << o.mean_x.to_double() << ", " << o.mean_y.to_double()
+                 << ") expected (" << e.mean_x << ", " << e.mean_y << "), radius = " << o.radius
+                 << " expected " << e.radius << " ✗ (MISMATCH)" << endl;
+        }
+    }
+};
+
+int sc_main(int argc, char *argv[]) {
+    testbench tb("tb");
+    sc_start();
+    return 0;
+}
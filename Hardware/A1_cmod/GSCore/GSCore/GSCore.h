@@ -0,0 +1,859 @@
+#ifndef GSCORE_H
+#define GSCORE_H
+
+#include "GSCOREPackDef.h"
+#include "QSU.h"
+#include "BSU.h"
+#include "BMU.h"
+#include "VRU.h"
+#include <ac_channel.h>
+#include <nvhls_connections.h>
+#include <ac_std_float.h>
+
+/*
+ * Input: tile header + projected Gaussians of the tile (unsorted)
+ *        + QSU pivots of the tile (only for tiles with adaptive_pivots == false)
+ * Output: TILE_PIXELS pixel colors of the tile (raster order)
+ * Perform: QSU (coarse depth bucketing) -> BSU (bitonic sort per SORT_NUM chunk)
+ *          -> BMU (merge the sorted chunks of each subset)
+ *          -> GSCORE_NUM_VRU parallel VRUs (NUM_ROTATE pixels interleaved per VRU)
+ * Output order: raster with GSCORE_DISPATCH_STATIC, completion order (VRU_OUT_TYPE::pixel) with
+ * GSCORE_DISPATCH_DYNAMIC, tiles in input order either way
+ *
+ *   Dispatch -> qsu[GSCORE_NUM_QSU] -> Bucket -> bsu[GSCORE_NUM_BSU] -> Gather <-> bmu
+ *            -> Render -> vru[GSCORE_NUM_VRU] -> Collect
+ *
+ * Tiles are processed one at a time through the shared tile buffer (gauss_mem),
+ * Render hands a credit back to Dispatch when the buffer can be overwritten.
+ * Render sends a pixel's closing pair to a VRU only with one of its VRU_FIFO_DEPTH output credits (out_credit),
+ * Collect returns the credit when it takes the color (vru_out_free), so a VRU never finds vru_out_fifo full.
+ * GSCORE_DISPATCH_DYNAMIC: Render tells Collect which VRU got each pixel group (group_to_collect).
+ */
+class GSCore : public match::Module {
+    SC_HAS_PROCESS(GSCore);
+public:
+
+    Connections::In<GSCORE_TILE_TYPE> TileInput;
+    Connections::In<GSCORE_GAUSS_TYPE> GaussInput;
+    Connections::In<QSU_PIVOT_TYPE> PivotInput;
+    Connections::Out<VRU_OUT_TYPE> PixelOutput;
+
+    // QSU stage
+    QSU *qsu[GSCORE_NUM_QSU];
+    Connections::Combinational<QSU_PIVOT_TYPE> qsu_pivot[GSCORE_NUM_QSU];
+    Connections::Combinational<QSU_IN_TYPE> qsu_in_enq[GSCORE_NUM_QSU];
+    Connections::Combinational<QSU_IN_TYPE> qsu_in_deq[GSCORE_NUM_QSU];
+    Connections::Buffer<QSU_IN_TYPE, QSU_FIFO_DEPTH> qsu_in_fifo[GSCORE_NUM_QSU];
+    Connections::Combinational<QSU_OUT_TYPE> qsu_out_enq[GSCORE_NUM_QSU];
+    Connections::Combinational<QSU_OUT_TYPE> qsu_out_deq[GSCORE_NUM_QSU];
+    Connections::Buffer<QSU_OUT_TYPE, QSU_FIFO_DEPTH> qsu_out_fifo[GSCORE_NUM_QSU];
+
+    // BSU stage
+    BSU *bsu[GSCORE_NUM_BSU];
+    Connections::Combinational<BSU_IN_OUT_TYPE> bsu_in_enq[GSCORE_NUM_BSU];
+    Connections::Combinational<BSU_IN_OUT_TYPE> bsu_in_deq[GSCORE_NUM_BSU];
+    Connections::Buffer<BSU_IN_OUT_TYPE, BSU_FIFO_DEPTH> bsu_in_fifo[GSCORE_NUM_BSU];
+    Connections::Combinational<BSU_IN_OUT_TYPE> bsu_out_enq[GSCORE_NUM_BSU];
+    Connections::Combinational<BSU_IN_OUT_TYPE> bsu_out_deq[GSCORE_NUM_BSU];
+    Connections::Buffer<BSU_IN_OUT_TYPE, BSU_FIFO_DEPTH> bsu_out_fifo[GSCORE_NUM_BSU];
+
+    // BMU (merge of sorted runs, shared by all subsets)
+    BMU *bmu;
+    Connections::Combinational<BMU_CFG_TYPE> bmu_cfg;
+    Connections::Combinational<BSU_IN_OUT_TYPE> bmu_in_a;
+    Connections::Combinational<BSU_IN_OUT_TYPE> bmu_in_b;
+    Connections::Combinational<BSU_IN_OUT_TYPE> bmu_out;
+
+    // VRU stage
+    VRU<NUM_ROTATE> *vru[GSCORE_NUM_VRU];
+    Connections::Combinational<VRU_IN_TYPE> vru_in_enq[GSCORE_NUM_VRU];
+    Connections::Combinational<VRU_IN_TYPE> vru_in_deq[GSCORE_NUM_VRU];
+    Connections::Buffer<VRU_IN_TYPE, VRU_FIFO_DEPTH> vru_in_fifo[GSCORE_NUM_VRU];
+    Connections::Combinational<VRU_TERM_TYPE> vru_term[GSCORE_NUM_VRU];
+    Connections::Combinational<VRU_OUT_TYPE> vru_out_enq[GSCORE_NUM_VRU];
+    Connections::Combinational<VRU_OUT_TYPE> vru_out_deq[GSCORE_NUM_VRU];
+    Connections::Buffer<VRU_OUT_TYPE, VRU_FIFO_DEPTH> vru_out_fifo[GSCORE_NUM_VRU];
+    Connections::Combinational<bool> vru_free_enq[GSCORE_NUM_VRU];   // Collect -> Render, output credits
+    Connections::Combinational<bool> vru_free_deq[GSCORE_NUM_VRU];
+    Connections::Buffer<bool, VRU_FIFO_DEPTH> vru_out_free[GSCORE_NUM_VRU];
+
+    // Control between stages
+    Connections::Combinational<GSCORE_TILE_TYPE> tile_to_bucket;
+    Connections::Combinational<GSCORE_TILE_TYPE> tile_to_gather;
+    Connections::Combinational<UINT16_TYPE> chunks_to_gather;
+    Connections::Combinational<GSCORE_TILE_TYPE> tile_to_render;
+    Connections::Combinational<bool> tile_free;
+    Connections::Combinational<GSCORE_GROUP_TYPE> group_to_collect;
+
+    GSCore(sc_module_name name) : match::Module(name),
+                                  TileInput       ("TileInput"),
+                                  GaussInput      ("GaussInput"),
+                                  PivotInput      ("PivotInput"),
+                                  PixelOutput     ("PixelOutput"),
+                                  bmu_cfg         ("bmu_cfg"),
+                                  bmu_in_a        ("bmu_in_a"),
+                                  bmu_in_b        ("bmu_in_b"),
+                                  bmu_out         ("bmu_out"),
+                                  tile_to_bucket  ("tile_to_bucket"),
+                                  tile_to_gather  ("tile_to_gather"),
+                                  chunks_to_gather("chunks_to_gather"),
+                                  tile_to_render  ("tile_to_render"),
+                                  tile_free       ("tile_free"),
+                                  group_to_collect("group_to_collect") {
+
+        for (int i = 0; i < GSCORE_NUM_QSU; i++) {
+            qsu_in_fifo[i].clk(clk);
+            qsu_in_fifo[i].rst(rst);
+            qsu_in_fifo[i].enq(qsu_in_enq[i]);
+            qsu_in_fifo[i].deq(qsu_in_deq[i]);
+
+            qsu[i] = new QSU(sc_gen_unique_name("QSU"));
+            qsu[i]->clk(clk);
+            qsu[i]->rst(rst);
+            qsu[i]->QSUInput(qsu_in_deq[i]);
+            qsu[i]->QSUPivot(qsu_pivot[i]);
+            qsu[i]->QSUOutput(qsu_out_enq[i]);
+
+            qsu_out_fifo[i].clk(clk);
+            qsu_out_fifo[i].rst(rst);
+            qsu_out_fifo[i].enq(qsu_out_enq[i]);
+            qsu_out_fifo[i].deq(qsu_out_deq[i]);
+        }
+
+        for (int i = 0; i < GSCORE_NUM_BSU; i++) {
+            bsu_in_fifo[i].clk(clk);
+            bsu_in_fifo[i].rst(rst);
+            bsu_in_fifo[i].enq(bsu_in_enq[i]);
+            bsu_in_fifo[i].deq(bsu_in_deq[i]);
+
+            bsu[i] = new BSU(sc_gen_unique_name("BSU"));
+            bsu[i]->clk(clk);
+            bsu[i]->rst(rst);
+            bsu[i]->BSUInput(bsu_in_deq[i]);
+            bsu[i]->BSUOutput(bsu_out_enq[i]);
+
+            bsu_out_fifo[i].clk(clk);
+            bsu_out_fifo[i].rst(rst);
+            bsu_out_fifo[i].enq(bsu_out_enq[i]);
+            bsu_out_fifo[i].deq(bsu_out_deq[i]);
+        }
+
+        bmu = new BMU(sc_gen_unique_name("BMU"));
+        bmu->clk(clk);
+        bmu->rst(rst);
+        bmu->BMUConfig(bmu_cfg);
+        bmu->BMUInputA(bmu_in_a);
+        bmu->BMUInputB(bmu_in_b);
+        bmu->BMUOutput(bmu_out);
+
+        for (int i = 0; i < GSCORE_NUM_VRU; i++) {
+            vru_in_fifo[i].clk(clk);
+            vru_in_fifo[i].rst(rst);
+            vru_in_fifo[i].enq(vru_in_enq[i]);
+            vru_in_fifo[i].deq(vru_in_deq[i]);
+
+            vru[i] = new VRU<NUM_ROTATE>(sc_gen_unique_name("VRU"));
+            vru[i]->clk(clk);
+            vru[i]->rst(rst);
+            vru[i]->VRUInput(vru_in_deq[i]);
+            vru[i]->VRUOutput(vru_out_enq[i]);
+            vru[i]->VRUTerminate(vru_term[i]);
+
+            vru_out_fifo[i].clk(clk);
+            vru_out_fifo[i].rst(rst);
+            vru_out_fifo[i].enq(vru_out_enq[i]);
+            vru_out_fifo[i].deq(vru_out_deq[i]);
+
+            vru_out_free[i].clk(clk);
+            vru_out_free[i].rst(rst);
+            vru_out_free[i].enq(vru_free_enq[i]);
+            vru_out_free[i].deq(vru_free_deq[i]);
+        }
+
+        SC_THREAD(Dispatch);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+
+        SC_THREAD(Bucket);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+
+        SC_THREAD(Gather);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+
+        SC_THREAD(Render);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+
+        SC_THREAD(Collect);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+    }
+
+    // Tile buffer, indexed by the slot a Gaussian was written to (slot is used as QSU gid)
+    GSCORE_GAUSS_TYPE gauss_mem[MAX_TILE_GAUSS];
+    // Per-subset slot lists built from QSU results
+    UINT16_TYPE bucket[NUM_SUBSETS][MAX_TILE_GAUSS];
+    UINT16_TYPE bucket_cnt[NUM_SUBSETS];
+    // Sorted runs of the tile (ping-pong between merge passes)
+    BSU_IN_OUT_TYPE run_mem[2][MAX_TILE_CHUNKS];
+    // Early termination state of the pixels in flight (per VRU and rotate slot)
+    bool pixel_done[GSCORE_NUM_VRU][NUM_ROTATE];
+    ET_TAG_TYPE pixel_tag[GSCORE_NUM_VRU][NUM_ROTATE];
+    // Free vru_out_fifo entries per VRU, less the colors still computing (Render)
+    uint out_credit[GSCORE_NUM_VRU];
+    // Render order of the tile
+    UINT16_TYPE sorted_slot[MAX_TILE_GAUSS];
+    // Depth histogram for adaptive pivots
+    UINT16_TYPE depth_hist[QSU_HIST_BINS];
+
+    // Statistics (cycles a stage was blocked by a full downstream FIFO)
+    unsigned long qsu_stall_cycles;
+    unsigned long bsu_stall_cycles;
+    unsigned long vru_stall_cycles;
+    unsigned long tiles_done;
+    unsigned long bsu_chunks;       // SORT_NUM chunks sorted by the BSUs
+    unsigned long merge_passes;     // BMU passes over a subset (runs of 1, 2, 4, ... blocks)
+    unsigned long merge_cycles;     // cycles Gather spent merging
+    unsigned long et_skipped_pairs; // (pixel, Gaussian) pairs not sent to a VRU after saturation
+    unsigned long bitmap_skipped_pairs;         // pairs of subtiles the Gaussian misses, not sent (dynamic)
+    unsigned long vru_pairs[GSCORE_NUM_VRU];    // pairs a VRU accepted, one per busy cycle
+    unsigned long vru_groups[GSCORE_NUM_VRU];   // pixel groups a VRU rendered (dynamic)
+
+    // Send (depth, slot) to QSU (slot % GSCORE_NUM_QSU)
+    void SendToQSU(uint slot, FP16_TYPE depth) {
+        QSU_IN_TYPE q;
+        q.depth = depth;
+        q.gid = slot;
+        while (!NRSIM_PUSHNB(qsu_in_enq[slot % GSCORE_NUM_QSU], q)) {
+            qsu_stall_cycles++;
+            wait();
+        }
+    }
+
+    /*
+     * Equal-population pivots from a QSU_HIST_BINS depth histogram of the buffered tile.
+     * Bins are uniform over [dmin, dmax], pivot k is the upper edge of the bin where
+     * the cumulative count first reaches (k+1)*n/NUM_SUBSETS.
+     */
+    void DerivePivots(uint n, FP16_TYPE dmin, FP16_TYPE dmax, QSU_PIVOT_TYPE &cfg) {
+        FP16_TYPE step = (dmax - dmin) * FP16_TYPE(1.0 / QSU_HIST_BINS);
+        FP16_TYPE edge[QSU_HIST_BINS];
+        #pragma hls_unroll
+        for (int b = 0; b < QSU_HIST_BINS; b++) {
+            edge[b] = dmin + step * FP16_TYPE(double(b + 1));
+            depth_hist[b] = 0;
+        }
+        edge[QSU_HIST_BINS-1] = dmax;
+
+        // Histogram pass, bin = number of upper edges the depth is at or above
+        #pragma hls_pipeline_init_interval 1
+        for (uint i = 0; i < n; i++) {
+            FP16_TYPE depth = gauss_mem[i].depth;
+            uint bin = 0;
+            #pragma hls_unroll
+            for (int b = 0; b < QSU_HIST_BINS-1; b++) {
+                if (depth >= edge[b]) bin++;
+            }
+            depth_hist[bin]++;
+            wait();
+        }
+
+        // Cumulative counts -> pivots
+        uint cum = 0;
+        uint k = 0;
+        #pragma hls_unroll
+        for (int i = 0; i < NUM_PIVOTS; i++) {
+            cfg.pivots[i] = dmax;
+        }
+        for (int b = 0; b < QSU_HIST_BINS; b++) {
+            cum += depth_hist[b];
+            while (k < NUM_PIVOTS && cum * NUM_SUBSETS >= (k + 1) * n) {
+                cfg.pivots[k] = edge[b];
+                k++;
+            }
+        }
+    }
+
+    /*
+     * Input: tile header + Gaussians (+ pivots)
+     * Perform: fill tile buffer, load QSU pivots, distribute (depth, slot) round-robin over the QSUs
+     * Adaptive tiles are buffered first, their pivots come from a histogram pass over the buffer.
+     */
+    void Dispatch() {
+        TileInput.Reset();
+        GaussInput.Reset();
+        PivotInput.Reset();
+        tile_to_bucket.ResetWrite();
+        tile_free.ResetRead();
+        #pragma hls_unroll
+        for (int i = 0; i < GSCORE_NUM_QSU; i++) {
+            qsu_in_enq[i].ResetWrite();
+            qsu_pivot[i].ResetWrite();
+        }
+        qsu_stall_cycles = 0;
+        wait();
+
+        while (1) {
+            wait();
+
+            NRSIM_POP(tile_free);                        // tile buffer is free, QSUs are idle
+            GSCORE_TILE_TYPE tile = NRSIM_POP(TileInput);
+            NRSIM_PUSH(tile_to_bucket, tile);
+
+            if (!tile.adaptive_pivots) {
+                QSU_PIVOT_TYPE cfg = NRSIM_POP(PivotInput);
+                #pragma hls_unroll
+                for (int q = 0; q < GSCORE_NUM_QSU; q++) {
+                    NRSIM_PUSH(qsu_pivot[q], cfg);
+                }
+
+                for (uint i = 0; i < tile.num_gaussians; i++) {
+                    GSCORE_GAUSS_TYPE g = NRSIM_POP(GaussInput);
+                    gauss_mem[i] = g;
+                    SendToQSU(i, g.depth);
+                }
+            } else {
+                FP16_TYPE dmin = FP16_TYPE(65504.0);
+                FP16_TYPE dmax = FP16_TYPE(-65504.0);
+                for (uint i = 0; i < tile.num_gaussians; i++) {
+                    GSCORE_GAUSS_TYPE g = NRSIM_POP(GaussInput);
+                    gauss_mem[i] = g;
+                    if (g.depth < dmin) dmin = g.depth;
+                    if (dmax < g.depth) dmax = g.depth;
+                }
+
+                QSU_PIVOT_TYPE cfg;
+                DerivePivots(tile.num_gaussians, dmin, dmax, cfg);
+                #pragma hls_unroll
+                for (int q = 0; q < GSCORE_NUM_QSU; q++) {
+                    NRSIM_PUSH(qsu_pivot[q], cfg);
+                }
+
+                for (uint i = 0; i < tile.num_gaussians; i++) {
+                    SendToQSU(i, gauss_mem[i].depth);
+                }
+            }
+        }
+    }
+
+    /*
+     * Input: (slot, subset) from all QSUs
+     * Output: SORT_NUM-sized (depth, slot) chunks, subsets in front-to-back order
+     * Perform: build subset lists, split them into chunks, pad with +max, send to the BSUs
+     */
+    void Bucket() {
+        tile_to_bucket.ResetRead();
+        tile_to_gather.ResetWrite();
+        chunks_to_gather.ResetWrite();
+        #pragma hls_unroll
+        for (int i = 0; i < GSCORE_NUM_QSU; i++) {
+            qsu_out_deq[i].ResetRead();
+        }
+        #pragma hls_unroll
+        for (int i = 0; i < GSCORE_NUM_BSU; i++) {
+            bsu_in_enq[i].ResetWrite();
+        }
+        bsu_stall_cycles = 0;
+        bsu_chunks = 0;
+        wait();
+
+        while (1) {
+            wait();
+
+            GSCORE_TILE_TYPE tile = NRSIM_POP(tile_to_bucket);
+
+            #pragma hls_unroll
+            for (int s = 0; s < NUM_SUBSETS; s++) {
+                bucket_cnt[s] = 0;
+            }
+
+            // Collect QSU results, one pop per QSU per cycle
+            uint received = 0;
+            while (received < tile.num_gaussians) {
+                #pragma hls_unroll
+                for (int i = 0; i < GSCORE_NUM_QSU; i++) {
+                    QSU_OUT_TYPE r;
+                    if (NRSIM_POPNB(qsu_out_deq[i], r)) {
+                        bucket[r.subset][bucket_cnt[r.subset]] = r.gid;
+                        bucket_cnt[r.subset]++;
+                        received++;
+                    }
+                }
+                if (received < tile.num_gaussians) wait();
+            }
+
+            NRSIM_PUSH(tile_to_gather, tile);
+
+            // Chunk each subset for the BSUs
+            uint chunk = 0;
+            for (int s = 0; s < NUM_SUBSETS; s++) {
+                for (uint base = 0; base < bucket_cnt[s]; base += SORT_NUM) {
+                    BSU_IN_OUT_TYPE b;
+                    #pragma hls_unroll
+                    for (int k = 0; k < SORT_NUM; k++) {
+                        if (base + k < bucket_cnt[s]) {
+                            UINT16_TYPE slot = bucket[s][base + k];
+                            b.x[k] = gauss_mem[slot].depth;
+                            b.v[k] = slot;
+                        } else {
+                            b.x[k] = BSU_DATA_TYPE(65504.0); // FP16 max, sorts to the end
+                            b.v[k] = 0;
+                        }
+                    }
+                    while (!NRSIM_PUSHNB(bsu_in_enq[chunk % GSCORE_NUM_BSU], b)) {
+                        bsu_stall_cycles++;
+                        wait();
+                    }
+                    chunk++;
+                    bsu_chunks++;
+                    wait();
+                }
+            }
+            NRSIM_PUSH(chunks_to_gather, chunk);
+        }
+    }
+
+    /*
+     * Merge run_mem[src][base, base+len_a) and run_mem[src][base+len_a, base+len_a+len_b)
+     * into run_mem[1-src][base, ...) through the BMU
+     */
+    void MergeRuns(uint src, uint base, uint len_a, uint len_b) {
+        if (len_b == 0) {
+            for (uint i = 0; i < len_a; i++) {
+                run_mem[1-src][base + i] = run_mem[src][base + i];
+            }
+            return;
+        }
+
+        BMU_CFG_TYPE cfg;
+        cfg.len_a = len_a;
+        cfg.len_b = len_b;
+        NRSIM_PUSH(bmu_cfg, cfg);
+
+        uint sent_a = 0, sent_b = 0, recv = 0;
+        while (recv < len_a + len_b) {
+            if (sent_a < len_a && NRSIM_PUSHNB(bmu_in_a, run_mem[src][base + sent_a])) sent_a++;
+            if (sent_b < len_b && NRSIM_PUSHNB(bmu_in_b, run_mem[src][base + len_a + sent_b])) sent_b++;
+            BSU_IN_OUT_TYPE o;
+            if (NRSIM_POPNB(bmu_out, o)) {
+                run_mem[1-src][base + recv] = o;
+                recv++;
+            }
+            merge_cycles++;
+            wait();
+        }
+    }
+
+    /*
+     * Input: sorted chunks from the BSUs (same round-robin order as Bucket)
+     * Output: render order of the tile (sorted_slot)
+     * Perform: merge the chunks of each subset pairwise (runs of 1, 2, 4, ... chunks)
+     *          until one sorted run is left, padding stays at the end of the run
+     */
+    void Gather() {
+        tile_to_gather.ResetRead();
+        chunks_to_gather.ResetRead();
+        tile_to_render.ResetWrite();
+        bmu_cfg.ResetWrite();
+        bmu_in_a.ResetWrite();
+        bmu_in_b.ResetWrite();
+        bmu_out.ResetRead();
+        #pragma hls_unroll
+        for (int i = 0; i < GSCORE_NUM_BSU; i++) {
+            bsu_out_deq[i].ResetRead();
+        }
+        merge_passes = 0;
+        merge_cycles = 0;
+        wait();
+
+        while (1) {
+            wait();
+
+            GSCORE_TILE_TYPE tile = NRSIM_POP(tile_to_gather);
+            UINT16_TYPE num_chunks = NRSIM_POP(chunks_to_gather);
+
+            for (uint c = 0; c < num_chunks; c++) {
+                run_mem[0][c] = NRSIM_POP(bsu_out_deq[c % GSCORE_NUM_BSU]);
+            }
+
+            // bucket_cnt stays valid: the next tile only enters Bucket after the tile_free credit
+            uint n = 0;
+            uint first = 0;
+            for (int s = 0; s < NUM_SUBSETS; s++) {
+                uint runs = (bucket_cnt[s] + SORT_NUM - 1) / SORT_NUM;
+                uint src = 0;
+                for (uint len = 1; len < runs; len <<= 1) {
+                    for (uint r = 0; r < runs; r += 2*len) {
+                        uint len_a = (runs - r < len) ? runs - r : len;
+                        uint len_b = (runs - r > len) ? ((runs - r - len < len) ? runs - r - len : len) : 0;
+                        MergeRuns(src, first + r, len_a, len_b);
+                    }
+                    src = 1 - src;
+                    merge_passes++;
+                }
+
+                for (uint k = 0; k < bucket_cnt[s]; k++) {
+                    sorted_slot[n++] = run_mem[src][first + k / SORT_NUM].v[k % SORT_NUM];
+                }
+                first += runs;
+            }
+            tile.num_gaussians = n;
+            NRSIM_PUSH(tile_to_render, tile);
+        }
+    }
+
+    /*
+     * Mark pixels the VRUs reported saturated (ignore feedback for pixels already closed)
+     * and take back the output credits Collect returned
+     */
+    void PollTerminate() {
+        #pragma hls_unroll
+        for (int v = 0; v < GSCORE_NUM_VRU; v++) {
+            VRU_TERM_TYPE term;
+            if (NRSIM_POPNB(vru_term[v], term) && term.tag == pixel_tag[v][term.rotate_idx]) {
+                pixel_done[v][term.rotate_idx] = true;
+            }
+            bool f;
+            if (NRSIM_POPNB(vru_free_deq[v], f)) out_credit[v]++;
+        }
+    }
+
+    // A closing pair (the pixel's color comes out) needs an output credit of the VRU
+    bool OutCredit(int v, const VRU_IN_TYPE &in) { return !in.last_gaussian || out_credit[v] > 0; }
+    void TakeCredit(int v, const VRU_IN_TYPE &in) {
+        if (in.last_gaussian) out_credit[v]--;
+    }
+
+    // Gaussian g of the render order, an empty tile closes out every pixel with a transparent Gaussian
+    void RenderGauss(const GSCORE_TILE_TYPE &tile, uint g, GSCORE_GAUSS_TYPE &gauss) {
+        if (tile.num_gaussians == 0) {
+            gauss.mean_x = FP16_TYPE(0.0);
+            gauss.mean_y = FP16_TYPE(0.0);
+            gauss.conx = FP16_TYPE(0.0);
+            gauss.cony = FP16_TYPE(0.0);
+            gauss.conz = FP16_TYPE(0.0);
+            gauss.color.r = FP16_TYPE(0.0);
+            gauss.color.g = FP16_TYPE(0.0);
+            gauss.color.b = FP16_TYPE(0.0);
+            gauss.opacity = FP16_TYPE(0.0);
+#ifdef USE_SUBTILE_BITMAP
+            gauss.bitmap = 0;
+#endif
+        } else {
+            gauss = gauss_mem[sorted_slot[g]];
+        }
+    }
+
+    // (pixel p, Gaussian) pair for rotate slot r
+    void PairInput(const GSCORE_GAUSS_TYPE &gauss, uint p, bool last, uint r, VRU_IN_TYPE &in) {
+        in.pixel_pos_x = FP16_TYPE(double(p % TILE_SIZE));
+        in.pixel_pos_y = FP16_TYPE(double(p / TILE_SIZE));
+        in.mean_x = gauss.mean_x;
+        in.mean_y = gauss.mean_y;
+        in.conx = gauss.conx;
+        in.cony = gauss.cony;
+        in.conz = gauss.conz;
+        in.color = gauss.color;
+        in.opacity = gauss.opacity;
+        in.last_gaussian = last;
+        in.rotate_idx = r;
+#ifdef USE_SUBTILE_BITMAP
+        in.bitmap = gauss.bitmap;
+        in.subtile_idx = ((p / TILE_SIZE) / SUBTILE_SIZE) * (TILE_SIZE / SUBTILE_SIZE)
+                       + (p % TILE_SIZE) / SUBTILE_SIZE;
+#endif
+    }
+
+    /*
+     * Input: render order of the tile
+     * Output: (pixel, Gaussian) pairs to the VRUs
+     * Saturated pixels (VRU feedback) only get their last Gaussian.
+     * GSCORE_DISPATCH_STATIC: pixel p of the tile goes to VRU (p % GSCORE_NUM_VRU), NUM_ROTATE pixels are
+     *   interleaved per VRU, all VRUs take the same Gaussian in the same step, a step is skipped once all
+     *   GSCORE_NUM_VRU*NUM_ROTATE pixels of the group are saturated.
+     * GSCORE_DISPATCH_DYNAMIC: the tile is split into GSCORE_PIXEL_GROUPS groups of NUM_ROTATE pixels, the
+     *   next group goes to the first idle VRU (one per cycle), which walks the Gaussians for it on its own and
+     *   jumps to the closing Gaussian once its NUM_ROTATE pixels are saturated. A VRU whose pixels saturate
+     *   early (or, with USE_SUBTILE_BITMAP, whose subtile the Gaussians miss: those pairs are not sent) takes
+     *   more groups instead of idling behind the slowest one. Every VRU reads its own Gaussian per cycle
+     *   (GSCORE_NUM_VRU read ports on gauss_mem / sorted_slot, replicated in hardware).
+     */
+    void Render() {
+        tile_to_render.ResetRead();
+        tile_free.ResetWrite();
+        #pragma hls_unroll
+        for (int i = 0; i < GSCORE_NUM_VRU; i++) {
+            vru_in_enq[i].ResetWrite();
+            vru_term[i].ResetRead();
+            vru_free_deq[i].ResetRead();
+            out_credit[i] = VRU_FIFO_DEPTH;
+            #pragma hls_unroll
+            for (int r = 0; r < NUM_ROTATE; r++) {
+                pixel_done[i][r] = false;
+                pixel_tag[i][r] = 0;
+            }
+        }
+        group_to_collect.ResetWrite();
+        #pragma hls_unroll
+        for (int i = 0; i < GSCORE_NUM_VRU; i++) {
+            vru_pairs[i] = 0;
+            vru_groups[i] = 0;
+        }
+        vru_stall_cycles = 0;
+        et_skipped_pairs = 0;
+        bitmap_skipped_pairs = 0;
+        wait();
+
+        while (1) {
+            wait();
+
+            NRSIM_PUSH(tile_free, true);                   // credit for the next tile
+            GSCORE_TILE_TYPE tile = NRSIM_POP(tile_to_render);
+            NRSIM_TRACE_EVENT(tile);                       // trace trigger, e.g. tile:37,last_gaussian
+
+            // An empty tile still closes out every pixel with a transparent Gaussian
+            uint num = (tile.num_gaussians == 0) ? 1 : (uint)tile.num_gaussians;
+
+#if GSCORE_VRU_DISPATCH == GSCORE_DISPATCH_DYNAMIC
+            RenderDynamic(tile, num);
+#else
+            for (uint base = 0; base < TILE_PIXELS; base += GSCORE_NUM_VRU*NUM_ROTATE) {
+                for (uint g = 0; g < num; g++) {
+                    // Whole pixel group saturated: jump to the closing Gaussian
+                    bool all_done = true;
+                    #pragma hls_unroll
+                    for (int v = 0; v < GSCORE_NUM_VRU; v++) {
+                        #pragma hls_unroll
+                        for (int r = 0; r < NUM_ROTATE; r++) {
+                            all_done = all_done && pixel_done[v][r];
+                        }
+                    }
+                    if (all_done && g < num-1) {
+                        et_skipped_pairs += (num-1-g) * GSCORE_NUM_VRU * NUM_ROTATE;
+                        g = num-1;
+                    }
+
+                    GSCORE_GAUSS_TYPE gauss;
+                    RenderGauss(tile, g, gauss);
+                    for (uint r = 0; r < NUM_ROTATE; r++) {
+                        bool pushed[GSCORE_NUM_VRU];
+                        VRU_IN_TYPE in[GSCORE_NUM_VRU];
+                        #pragma hls_unroll
+                        for (int v = 0; v < GSCORE_NUM_VRU; v++) {
+                            uint p = base + r*GSCORE_NUM_VRU + v;
+                            PairInput(gauss, p, g == num-1, r, in[v]);
+                            pushed[v] = pixel_done[v][r] && !in[v].last_gaussian;
+                            if (pushed[v]) et_skipped_pairs++;
+                        }
+                        // Push to all VRUs, retrying the ones whose FIFO is full or that are out of credits
+                        bool done = true;
+                        #pragma hls_unroll
+                        for (int v = 0; v < GSCORE_NUM_VRU; v++) {
+                            done = done && pushed[v];
+                        }
+                        while (!done) {
+                            done = true;
+                            #pragma hls_unroll
+                            for (int v = 0; v < GSCORE_NUM_VRU; v++) {
+                                if (!pushed[v] && OutCredit(v, in[v])) {
+                                    pushed[v] = NRSIM_PUSHNB(vru_in_enq[v], in[v]);
+                                    if (pushed[v]) {
+                                        vru_pairs[v]++;
+                                        TakeCredit(v, in[v]);
+                                    }
+                                }
+                                done = done && pushed[v];
+                            }
+                            if (!done) vru_stall_cycles++;
+                            PollTerminate();
+                            wait();
+                        }
+                        #pragma hls_unroll
+                        for (int v = 0; v < GSCORE_NUM_VRU; v++) {
+                            if (in[v].last_gaussian) {
+                                pixel_done[v][r] = false;
+                                pixel_tag[v][r]++;
+                            }
+                        }
+                    }
+                }
+            }
+#endif
+        }
+    }
+
+    // GSCORE_DISPATCH_DYNAMIC render of one tile (num >= 1 Gaussians in the render order)
+    void RenderDynamic(const GSCORE_TILE_TYPE &tile, uint num) {
+        bool busy[GSCORE_NUM_VRU];
+        uint group[GSCORE_NUM_VRU];  // pixel group of the VRU, pixels group*NUM_ROTATE + r
+        uint gi[GSCORE_NUM_VRU];     // next Gaussian of the group
+        uint ri[GSCORE_NUM_VRU];     // next rotate slot for that Gaussian
+        #pragma hls_unroll
+        for (int v = 0; v < GSCORE_NUM_VRU; v++) {
+            busy[v] = false;
+            group[v] = 0;
+            gi[v] = 0;
+            ri[v] = 0;
+        }
+
+        uint next_group = 0;
+        bool any_busy = false;
+        while (next_group < GSCORE_PIXEL_GROUPS || any_busy) {
+            // Hand the next group to the first idle VRU
+            bool assigned = false;
+            #pragma hls_unroll
+            for (int v = 0; v < GSCORE_NUM_VRU; v++) {
+                if (!assigned && !busy[v] && next_group < GSCORE_PIXEL_GROUPS) {
+                    assigned = true;
+                    GSCORE_GROUP_TYPE msg;
+                    msg.vru = v;
+                    msg.last = (next_group == GSCORE_PIXEL_GROUPS-1);
+                    if (NRSIM_PUSHNB(group_to_collect, msg)) {
+                        busy[v] = true;
+                        group[v] = next_group;
+                        gi[v] = 0;
+                        ri[v] = 0;
+                        next_group++;
+                        vru_groups[v]++;
+                    }
+                }
+            }
+
+            // One pair per busy VRU
+            bool stalled = false;
+            any_busy = false;
+            #pragma hls_unroll
+            for (int v = 0; v < GSCORE_NUM_VRU; v++) {
+                if (busy[v]) {
+                    // Whole group saturated: jump to the closing Gaussian
+                    bool all_done = true;
+                    #pragma hls_unroll
+                    for (int r = 0; r < NUM_ROTATE; r++) {
+                        all_done = all_done && pixel_done[v][r];
+                    }
+                    if (all_done && ri[v] == 0 && gi[v] < num-1) {
+                        et_skipped_pairs += (num-1-gi[v]) * NUM_ROTATE;
+                        gi[v] = num-1;
+                    }
+
+                    uint r = ri[v];
+                    GSCORE_GAUSS_TYPE gauss;
+                    RenderGauss(tile, gi[v], gauss);
+                    VRU_IN_TYPE in;
+                    PairInput(gauss, group[v]*NUM_ROTATE + r, gi[v] == num-1, r, in);
+
+                    bool advance = false;
+                    if (pixel_done[v][r] && !in.last_gaussian) {
+                        et_skipped_pairs++;
+                        advance = true;
+#ifdef USE_SUBTILE_BITMAP
+                    } else if (in.bitmap[in.subtile_idx] == 0 && !in.last_gaussian) {
+                        bitmap_skipped_pairs++;   // alpha would be 0 in the VRU
+                        advance = true;
+#endif
+                    } else if (OutCredit(v, in) && NRSIM_PUSHNB(vru_in_enq[v], in)) {
+                        vru_pairs[v]++;
+                        TakeCredit(v, in);
+                        if (in.last_gaussian) {
+                            pixel_done[v][r] = false;
+                            pixel_tag[v][r]++;
+                        }
+                        advance = true;
+                    } else {
+                        stalled = true;
+                    }
+
+                    if (advance) {
+                        if (r == NUM_ROTATE-1) {
+                            ri[v] = 0;
+                            if (gi[v] == num-1) {
+                                busy[v] = false;
+                            } else {
+                                gi[v]++;
+                            }
+                        } else {
+                            ri[v] = r + 1;
+                        }
+                    }
+                }
+                any_busy = any_busy || busy[v];
+            }
+            if (stalled) vru_stall_cycles++;
+            PollTerminate();
+            wait();
+        }
+    }
+
+    /*
+     * Output: the TILE_PIXELS pixel colors of a tile
+     * GSCORE_DISPATCH_STATIC: raster order, pixel p from VRU (p % GSCORE_NUM_VRU)
+     * GSCORE_DISPATCH_DYNAMIC: as they complete, a VRU's outputs belong to the current tile while it has
+     *   outputs of the groups it got (group_to_collect) left, later ones stay queued for the next tile
+     */
+    void Collect() {
+        PixelOutput.Reset();
+        group_to_collect.ResetRead();
+        #pragma hls_unroll
+        for (int i = 0; i < GSCORE_NUM_VRU; i++) {
+            vru_out_deq[i].ResetRead();
+            vru_free_enq[i].ResetWrite();
+        }
+        tiles_done = 0;
+        wait();
+
+        while (1) {
+            wait();
+
+#if GSCORE_VRU_DISPATCH == GSCORE_DISPATCH_DYNAMIC
+            uint pending[GSCORE_NUM_VRU];  // outputs of the tile still expected from a VRU
+            #pragma hls_unroll
+            for (int v = 0; v < GSCORE_NUM_VRU; v++) {
+                pending[v] = 0;
+            }
+            bool all_groups = false;
+            uint received = 0;
+            uint rr = 0;
+            while (received < TILE_PIXELS) {
+                GSCORE_GROUP_TYPE msg;
+                if (!all_groups && NRSIM_POPNB(group_to_collect, msg)) {
+                    pending[msg.vru.to_uint()] += NUM_ROTATE;
+                    all_groups = msg.last;
+                }
+
+                // One output per cycle, round robin over the VRUs with outputs of this tile left
+                bool got = false;
+                uint from = 0;
+                VRU_OUT_TYPE o;
+                #pragma hls_unroll
+                for (int k = 0; k < GSCORE_NUM_VRU; k++) {
+                    uint v = (rr + k) % GSCORE_NUM_VRU;
+                    if (!got && pending[v] > 0 && NRSIM_POPNB(vru_out_deq[v], o)) {
+                        got = true;
+                        from = v;
+                    }
+                }
+                if (got) {
+                    NRSIM_PUSH(vru_free_enq[from], true); // never blocks, at most VRU_FIFO_DEPTH credits out
+                    pending[from]--;
+                    received++;
+                    rr = (from + 1) % GSCORE_NUM_VRU;
+                    NRSIM_PUSH(PixelOutput, o);
+                }
+                if (received < TILE_PIXELS) wait();
+            }
+#else
+            for (uint p = 0; p < TILE_PIXELS; p++) {
+                VRU_OUT_TYPE o = NRSIM_POP(vru_out_deq[p % GSCORE_NUM_VRU]);
+                NRSIM_PUSH(vru_free_enq[p % GSCORE_NUM_VRU], true);
+                NRSIM_PUSH(PixelOutput, o);
+            }
+#endif
+            tiles_done++;
+        }
+    }
+
+};
+
+#endif //GSCORE_H
@@ -0,0 +1,290 @@
+#define NVHLS_VERIFY_BLOCKS (GSCore)
+#include "GSCore.h"
+#include <nvhls_verify.h>
+#include "nvhls_connections.h"
+#include "ac_sysc_trace.h"
+#include <random>
+#include <systemc.h>
+#include <nvhls_module.h>
+#include <mc_connections.h>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <iomanip>
+
+#define NUM_FIXED_TILES 5    // tiles with pivots 20, 40, ... from PivotInput
+#define NUM_ADAPTIVE_TILES 2 // tiles with histogram-derived pivots
+#define NUM_TILES (NUM_FIXED_TILES + NUM_ADAPTIVE_TILES)
+#define GAUSS_PER_SUBSET 12 // <= SORT_NUM, so every subset is one BSU chunk
+#define LARGE_SUBSET_GAUSS 50 // last fixed tile: 4 chunks per subset, merged by BMU
+#define ADAPTIVE_GAUSS 96   // nearly all below 20: a single subset for the fixed pivots
+
+class Top : public sc_module {
+public:
+    sc_clock clk;
+    sc_signal<bool> rst;
+
+    Connections::Combinational<GSCORE_TILE_TYPE> TileInput;
+    Connections::Combinational<GSCORE_GAUSS_TYPE> GaussInput;
+    Connections::Combinational<QSU_PIVOT_TYPE> PivotInput;
+    Connections::Combinational<VRU_OUT_TYPE> PixelOutput;
+
+    NVHLS_DESIGN(GSCore) dut;
+
+    // Test tiles (unsorted Gaussians as sent to the DUT)
+    std::vector<GSCORE_TILE_TYPE> tiles;
+    std::vector<std::vector<GSCORE_GAUSS_TYPE> > tile_gauss;
+    sc_time tile_start[NUM_TILES];
+
+    SC_CTOR(Top) : clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
+                   rst("rst"),
+                   TileInput("TileInput"),
+                   GaussInput("GaussInput"),
+                   PivotInput("PivotInput"),
+                   PixelOutput("PixelOutput"),
+                   dut("dut") {
+
+        sc_object_tracer<sc_clock> trace_clk(clk);
+
+        dut.clk(clk);
+        dut.rst(rst);
+        dut.TileInput(TileInput);
+        dut.GaussInput(GaussInput);
+        dut.PivotInput(PivotInput);
+        dut.PixelOutput(PixelOutput);
+
+        generate_tiles();
+
+        SC_THREAD(reset);
+        sensitive << clk.posedge_event();
+
+        SC_THREAD(run);
+        sensitive << clk.posedge_event();
+        async_reset_signal_is(rst, false);
+
+        SC_THREAD(collect);
+        sensitive << clk.posedge_event();
+        async_reset_signal_is(rst, false);
+    }
+
+    void reset() {
+        rst.write(false);
+        wait(10);
+        rst.write(true);
+    }
+
+#ifdef USE_SUBTILE_BITMAP
+    // Subtiles overlapped by the region where alpha >= 1/255 (what CCU would compute)
+    UINT8_TYPE subtile_bitmap(const GSCORE_GAUSS_TYPE &g) {
+        double a = g.conx.to_double(), b = g.cony.to_double(), c = g.conz.to_double();
+        double det = a*c - b*b;
+        // largest eigenvalue of the covariance (inverse of the conic)
+        double mid = 0.5 * (a + c) / det;
+        double lambda = mid + sqrt(std::max(0.0, mid*mid - 1.0/det));
+        double o = g.opacity.to_double();
+        double radius = (255.0*o > 1.0) ? sqrt(2.0*log(255.0*o) * lambda) : 0.0;
+        double mx = g.mean_x.to_double(), my = g.mean_y.to_double();
+        UINT8_TYPE bitmap = 0;
+        const int SUBTILES_X = TILE_SIZE / SUBTILE_SIZE;
+        for (int sy = 0; sy < SUBTILES_X; sy++) {
+            for (int sx = 0; sx < SUBTILES_X; sx++) {
+                // distance from the mean to the closest pixel center of the subtile
+                double cx = std::min(std::max(mx, double(sx*SUBTILE_SIZE)), double(sx*SUBTILE_SIZE + SUBTILE_SIZE-1));
+                double cy = std::min(std::max(my, double(sy*SUBTILE_SIZE)), double(sy*SUBTILE_SIZE + SUBTILE_SIZE-1));
+                if ((cx-mx)*(cx-mx) + (cy-my)*(cy-my) <= radius*radius) {
+                    bitmap[sy*SUBTILES_X + sx] = 1;
+                }
+            }
+        }
+        return bitmap;
+    }
+#endif
+
+    GSCORE_GAUSS_TYPE random_gaussian(std::mt19937 &gen, int gid, double depth) {
+        std::uniform_real_distribution<double> u(0.0, 1.0);
+        GSCORE_GAUSS_TYPE g;
+        g.gid = gid;
+        g.depth = FP16_TYPE(depth);
+        g.mean_x = FP16_TYPE(u(gen) * TILE_SIZE);
+        g.mean_y = FP16_TYPE(u(gen) * TILE_SIZE);
+        g.conx = FP16_TYPE(0.02 + 0.1*u(gen));
+        g.cony = FP16_TYPE(0.01*(u(gen) - 0.5));
+        g.conz = FP16_TYPE(0.02 + 0.1*u(gen));
+        g.color.r = FP16_TYPE(u(gen));
+        g.color.g = FP16_TYPE(u(gen));
+        g.color.b = FP16_TYPE(u(gen));
+        g.opacity = FP16_TYPE(0.1 + 0.8*u(gen));
+#ifdef USE_SUBTILE_BITMAP
+        g.bitmap = subtile_bitmap(g);
+#endif
+        return g;
+    }
+
+    // Fixed tiles: Gaussians of subset s have distinct depths in [20s, 20s+20) (pivots 20, 40, ...),
+    //              the last one has subsets larger than SORT_NUM
+    // Adaptive tiles: ADAPTIVE_GAUSS depths skewed to [0, 20), only correct if QSU spreads them
+    void generate_tiles() {
+        std::mt19937 gen(42);
+        for (int t = 0; t < NUM_TILES; t++) {
+            GSCORE_TILE_TYPE tile;
+            tile.tile_x = t;
+            tile.tile_y = 0;
+            tile.adaptive_pivots = (t >= NUM_FIXED_TILES);
+            std::vector<GSCORE_GAUSS_TYPE> gs;
+            if (!tile.adaptive_pivots) {
+                bool large = (t == NUM_FIXED_TILES - 1);
+                int subsets = large ? 3 : (t % NUM_SUBSETS) + 1; // tiles get heavier
+                int per_subset = large ? LARGE_SUBSET_GAUSS : GAUSS_PER_SUBSET;
+                double spacing = large ? 0.37 : 1.0;
+                for (int s = 0; s < subsets; s++) {
+                    for (int k = 0; k < per_subset; k++) {
+                        gs.push_back(random_gaussian(gen, gs.size(), 20.0*s + k*spacing + 0.5));
+                    }
+                }
+            } else {
+                // Skewed towards the camera, distinct in FP16
+                for (int k = 0; k < ADAPTIVE_GAUSS; k++) {
+                    double x = double(k) / ADAPTIVE_GAUSS;
+                    gs.push_back(random_gaussian(gen, gs.size(), 20.0*x*x + 0.01*k));
+                }
+            }
+            std::shuffle(gs.begin(), gs.end(), gen);
+            tile.num_gaussians = gs.size();
+            tiles.push_back(tile);
+            tile_gauss.push_back(gs);
+        }
+    }
+
+    // Double-precision reference for one pixel (front-to-back on sorted depth)
+    void reference_pixel(int t, int px, int py, double &r, double &g, double &b) {
+        std::vector<GSCORE_GAUSS_TYPE> gs = tile_gauss[t];
+        std::sort(gs.begin(), gs.end(), [](const GSCORE_GAUSS_TYPE &a, const GSCORE_GAUSS_TYPE &b) {
+            return a.depth.to_double() < b.depth.to_double();
+        });
+        double T = 1.0;
+        r = g = b = 0.0;
+        for (size_t i = 0; i < gs.size(); i++) {
+            double dx = px - gs[i].mean_x.to_double();
+            double dy = py - gs[i].mean_y.to_double();
+            double cx = gs[i].conx.to_double(), cy = gs[i].cony.to_double(), cz = gs[i].conz.to_double();
+            double alpha = gs[i].opacity.to_double() *
+                           exp(-0.5 * (dx * (cx * dx + cy * dy) + dy * (cy * dx + cz * dy)));
+            if (alpha < 1.0/255.0) continue;
+            r += T * alpha * gs[i].color.r.to_double();
+            g += T * alpha * gs[i].color.g.to_double();
+            b += T * alpha * gs[i].color.b.to_double();
+            T *= (1.0 - alpha);
+        }
+    }
+
+    void run() {
+        TileInput.ResetWrite();
+        GaussInput.ResetWrite();
+        PivotInput.ResetWrite();
+        wait(10);
+
+        QSU_PIVOT_TYPE pivots;
+        for (int i = 0; i < NUM_PIVOTS; i++) {
+            pivots.pivots[i] = FP16_TYPE(20.0 * (i + 1));
+        }
+
+        for (int t = 0; t < NUM_TILES; t++) {
+            tile_start[t] = sc_time_stamp();
+            cout << "TileInput @ " << sc_time_stamp() << ": tile " << t
+                 << ", Gaussians = " << tiles[t].num_gaussians << endl;
+            TileInput.Push(tiles[t]);
+            if (!tiles[t].adaptive_pivots) {
+                PivotInput.Push(pivots);
+            }
+            for (size_t i = 0; i < tile_gauss[t].size(); i++) {
+                GaussInput.Push(tile_gauss[t][i]);
+            }
+        }
+    }
+
+    void collect() {
+        PixelOutput.ResetRead();
+        wait(10);
+
+        sc_time first_in = SC_ZERO_TIME;
+        unsigned long chunks_before = 0;
+        for (int t = 0; t < NUM_TILES; t++) {
+            double max_err = 0.0;
+            bool seen[TILE_PIXELS] = {false};
+            bool once = true;
+            for (int i = 0; i < TILE_PIXELS; i++) {
+                VRU_OUT_TYPE o = PixelOutput.Pop();
+                // raster order with GSCORE_DISPATCH_STATIC, completion order with GSCORE_DISPATCH_DYNAMIC
+                int p = o.pixel.to_int();
+                once = once && !seen[p];
+                seen[p] = true;
+                double r, g, b;
+                reference_pixel(t, p % TILE_SIZE, p / TILE_SIZE, r, g, b);
+                max_err = std::max(max_err, fabs(o.color.r.to_double() - r));
+                max_err = std::max(max_err, fabs(o.color.g.to_double() - g));
+                max_err = std::max(max_err, fabs(o.color.b.to_double() - b));
+            }
+            if (t == 0) first_in = tile_start[0];
+            cout << "PixelOutput @ " << sc_time_stamp() << ": tile " << t
+                 << " done, latency = " << (sc_time_stamp() - tile_start[t]).to_seconds()*1e9 << " cycles"
+                 << ", BSU chunks = " << dut.bsu_chunks - chunks_before
+                 << (tiles[t].adaptive_pivots ? " (adaptive pivots)" : "")
+                 << ", max abs error = " << std::setprecision(4) << max_err;
+            chunks_before = dut.bsu_chunks;
+            if (!once) cout << ", pixel output twice";
+            if (max_err < 0.05 && once) {
+                cout << " ✓" << endl;
+            } else {
+                cout << " ✗ (MISMATCH)" << endl;
+            }
+        }
+
+        double total = (sc_time_stamp() - first_in).to_seconds()*1e9;
+        cout << "\n=== GSCore Statistics ===" << endl;
+        cout << "QSU/BSU/VRU instances: " << GSCORE_NUM_QSU << "/" << GSCORE_NUM_BSU << "/" << GSCORE_NUM_VRU << endl;
+        cout << "Tiles: " << dut.tiles_done << ", total cycles: " << total
+             << ", cycles per tile: " << total / NUM_TILES << endl;
+        cout << "VRU dispatch: " << (GSCORE_VRU_DISPATCH == GSCORE_DISPATCH_DYNAMIC ? "dynamic" : "static")
+             << " (compare: python S0_scripts/sweep.py GSCore sim_GSCore -p GSCORE_VRU_DISPATCH=0,1)" << endl;
+        double util_min = 1.0, util_max = 0.0, util_sum = 0.0;
+        for (int i = 0; i < GSCORE_NUM_VRU; i++) {
+            double u = total > 0 ? dut.vru_pairs[i] / total : 0.0;
+            util_min = std::min(util_min, u);
+            util_max = std::max(util_max, u);
+            util_sum += u;
+            cout << "  VRU " << i << ": " << dut.vru_pairs[i] << " pairs, utilization "
+                 << std::setprecision(3) << 100.0*u << "%";
+            if (GSCORE_VRU_DISPATCH == GSCORE_DISPATCH_DYNAMIC) cout << ", " << dut.vru_groups[i] << " pixel groups";
+            cout << endl;
+        }
+        cout << "VRU utilization min/mean/max: " << 100.0*util_min << "% / "
+             << 100.0*util_sum/GSCORE_NUM_VRU << "% / " << 100.0*util_max << "%" << endl;
+        if (dut.bitmap_skipped_pairs) {
+            cout << "Pairs not sent (subtile bitmap miss): " << dut.bitmap_skipped_pairs << endl;
+        }
+        cout << "QSU stall cycles: " << dut.qsu_stall_cycles << endl;
+        cout << "BSU stall cycles: " << dut.bsu_stall_cycles << endl;
+        cout << "VRU stall cycles: " << dut.vru_stall_cycles << endl;
+        cout << "BSU chunks: " << dut.bsu_chunks << endl;
+        cout << "BMU merge passes: " << dut.merge_passes << ", merge cycles: " << dut.merge_cycles << endl;
+        unsigned long pairs = 0, skipped = 0, et_saved = 0, hazard = 0;
+        for (int i = 0; i < GSCORE_NUM_VRU; i++) {
+            pairs += dut.vru[i]->total_pairs;
+            skipped += dut.vru[i]->skipped_pairs;
+            et_saved += dut.vru[i]->et_saved_step1 + dut.vru[i]->et_saved_step2;
+            hazard += dut.vru[i]->hazard_stall_cycles;
+        }
+        cout << "VRU RMW hazard stall cycles (NUM_ROTATE = " << NUM_ROTATE << "): " << hazard << endl;
+        cout << "Gaussian-pixel pairs: " << pairs << ", skipped by subtile bitmap: " << skipped
+             << " (" << (pairs ? 100.0*skipped/pairs : 0.0) << "%)" << endl;
+        cout << "Early termination: " << dut.et_skipped_pairs << " pairs not sent, "
+             << et_saved << " dropped inside the VRUs" << endl;
+        sc_stop();
+    }
+};
+
+int sc_main(int argc, char *argv[]) {
+    Top tb("tb");
+    sc_start();
+    return 0;
+}
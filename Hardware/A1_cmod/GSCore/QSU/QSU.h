@@ -14,10 +14,12 @@ class QSU : public match::Module {
 public:
     // Input/Output channels
     Connections::In<QSU_IN_TYPE> QSUInput;
+    Connections::In<QSU_PIVOT_TYPE> QSUPivot;
     Connections::Out<QSU_OUT_TYPE> QSUOutput;
 
     QSU(sc_module_name name) : match::Module(name),
                                QSUInput("QSUInput"),
+                               QSUPivot("QSUPivot"),
                                QSUOutput("QSUOutput") {
         SC_THREAD(QSU_CALC);
         sensitive << clk.pos();
@@ -27,23 +29,17 @@ public:
     // Store the pivot values
     FP16_TYPE pivots[NUM_PIVOTS];
 
-    // Function to set pivot values
-    // void setPivots(FP16_TYPE* pivot_values, int num_values) {
-    //     for (int i = 0; i < NUM_PIVOTS && i < num_values; i++) {
-    //         pivots[i] = pivot_values[i];
-    //     }
-    // }
-
     /*
-     * Input: (Depth: FP16, GID: UINT16)
+     * Input: (Depth: FP16, GID: UINT16), pivot configuration (optional, per tile)
      * Output: Subset index for the key
      * Perform: Compare key against pivots to determine subset
      */
     void QSU_CALC() {
         QSUInput.Reset();
+        QSUPivot.Reset();
         QSUOutput.Reset();
         // Initialize default pivot values
-        // These can be overridden by calling setPivots()
+        // These are overridden by a QSUPivot message
         pivots[0] = FP16_TYPE(20.0); // Example: Pivot1
         pivots[1] = FP16_TYPE(40.0); // Example: Pivot2
         // Initialize other pivots as needed
@@ -56,10 +52,20 @@ public:
         #pragma hls_pipeline_init_interval 1
         while (1) {
             wait();
+
+            // Load new pivots (checked before the input, so a tile sent after its
+            // pivots is compared against them)
+            QSU_PIVOT_TYPE pivot_cfg;
+            if (NRSIM_POPNB(QSUPivot, pivot_cfg)) {
+                #pragma hls_unroll
+                for (int i = 0; i < NUM_PIVOTS; i++) {
+                    pivots[i] = pivot_cfg.pivots[i];
+                }
+            }
             
             // Get input key-value pair
             QSU_IN_TYPE qsu_input;
-            if(QSUInput.PopNB(qsu_input)) {
+            if(NRSIM_POPNB(QSUInput, qsu_input)) {
                 FP16_TYPE depth = qsu_input.depth;
                 UINT16_TYPE gid = qsu_input.gid;
                 
@@ -97,7 +103,7 @@ public:
                 // For now, we're just determining the subset
                 
                 // Push the result to output
-                QSUOutput.Push(qsu_output);
+                NRSIM_PUSH(QSUOutput, qsu_output);
             }
         }
     }
@@ -1,5 +1,7 @@
 #define NVHLS_VERIFY_BLOCKS (QSU)
 #include "QSU.h"
+#include "GSCORETrace.h"
+#include "../../common/include/nrsim_timing.h"
 #include <nvhls_verify.h>
 #include "nvhls_connections.h"
 #include "ac_sysc_trace.h"
@@ -7,6 +9,9 @@
 #include <systemc.h>
 #include <nvhls_module.h>
 #include <mc_connections.h>
+#include <vector>
+#include <algorithm>
+#include <string>
 
 #pragma hls_design top
 class testbench : public sc_module {
@@ -15,6 +20,7 @@ public:
     sc_signal<bool> rst;
 
     Connections::Combinational<QSU_IN_TYPE> QSUInput;
+    Connections::Combinational<QSU_PIVOT_TYPE> QSUPivot;
     Connections::Combinational<QSU_OUT_TYPE> QSUOutput;
 
     NVHLS_DESIGN(QSU) dut;
@@ -22,6 +28,7 @@ public:
     SC_CTOR(testbench) : clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
                    rst("rst"),
                    QSUInput("QSUInput"),
+                   QSUPivot("QSUPivot"),
                    QSUOutput("QSUOutput"),
                    dut("dut") {
 
@@ -30,6 +37,7 @@ public:
         dut.clk(clk);
         dut.rst(rst);
         dut.QSUInput(QSUInput);
+        dut.QSUPivot(QSUPivot);
         dut.QSUOutput(QSUOutput);
 
         SC_THREAD(reset);
@@ -50,8 +58,14 @@ public:
         rst.write(true);
     }
 
+    // Pivots loaded through QSUPivot for the second test round
+    double loaded_pivot(int i) {
+        return 5.0 * (i + 1);  // 5, 10, ..., 35
+    }
+
     void run() {
         QSUInput.ResetWrite();
+        QSUPivot.ResetWrite();
         wait(10);
 
         // Setup test cases with different depth values to test different subsets
@@ -82,6 +96,24 @@ public:
             QSUInput.Push(qsu_in);
             wait(1);  // Wait one clock cycle between inputs
         }
+
+        // Second round: load pivots at runtime while the QSU is idle
+        wait(10);
+        QSU_PIVOT_TYPE pivot_cfg;
+        for (int i = 0; i < NUM_PIVOTS; i++) {
+            pivot_cfg.pivots[i] = FP16_TYPE(loaded_pivot(i));
+        }
+        cout << "QSUPivot @ timestep: " << sc_time_stamp() << ": loading pivots 5, 10, ..., 35" << endl;
+        QSUPivot.Push(pivot_cfg);
+        wait(1);
+
+        for (int t = 0; t < NUM_TESTS; t++) {
+            QSU_IN_TYPE qsu_in;
+            qsu_in.depth = FP16_TYPE(t * 4.0);  // 0, 4, ..., 36
+            qsu_in.gid = t + 2000;
+            QSUInput.Push(qsu_in);
+            wait(1);
+        }
     }
 
     void collect() {
@@ -129,12 +161,180 @@ public:
                 cout << " ✗ (MISMATCH)" << endl;
             }
         }
+
+        cout << "\n=== Runtime pivots: 5, 10, ..., 35 ===" << endl;
+        for (int t = 0; t < NUM_TESTS; t++) {
+            QSU_OUT_TYPE result = QSUOutput.Pop();
+            double depth = t * 4.0;
+            uint8_t expected_subset = 0;
+            for (int i = 0; i < NUM_PIVOTS; i++) {
+                if (depth >= loaded_pivot(i)) {
+                    expected_subset = i + 1;
+                }
+            }
+            cout << "QSUOutput @ timestep: " << sc_time_stamp() << ": ";
+            cout << "GID = " << result.gid << ", Depth = " << depth << ", Subset = " << result.subset;
+            cout << "  Expected Subset: " << (int)expected_subset;
+            if (result.subset == expected_subset && result.gid == t + 2000) {
+                cout << " ✓" << endl;
+            } else {
+                cout << " ✗ (MISMATCH)" << endl;
+            }
+        }
         
         sc_stop();
     }
 };
 
+/*
+ * Trace-driven run (./sim_QSU trace <scene.gstr>): the Gaussians of every tile in CCU (gid) order,
+ * with equal-population pivots of the tile loaded through QSUPivot before its depths
+ */
+class trace_bench : public sc_module {
+public:
+    sc_clock clk;
+    sc_signal<bool> rst;
+
+    Connections::Combinational<QSU_IN_TYPE> QSUInput;
+    Connections::Combinational<QSU_PIVOT_TYPE> QSUPivot;
+    Connections::Combinational<QSU_OUT_TYPE> QSUOutput;
+
+    QSU dut;
+
+    GSTraceReader feed;         // run() cursor
+    GSTraceReader check;        // collect() cursor
+    unsigned long sent, received;
+
+    SC_HAS_PROCESS(trace_bench);
+    trace_bench(sc_module_name name, const char *path) : sc_module(name),
+                                                         clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
+                                                         rst("rst"),
+                                                         QSUInput("QSUInput"),
+                                                         QSUPivot("QSUPivot"),
+                                                         QSUOutput("QSUOutput"),
+                                                         dut("dut"),
+                                                         sent(0), received(0) {
+        sc_object_tracer<sc_clock> trace_clk(clk);
+
+        dut.clk(clk);
+        dut.rst(rst);
+        dut.QSUInput(QSUInput);
+        dut.QSUPivot(QSUPivot);
+        dut.QSUOutput(QSUOutput);
+
+        if (!feed.Open(path) || !check.Open(path)) exit(1);
+
+        SC_THREAD(reset);
+        sensitive << clk.posedge_event();
+
+        SC_THREAD(run);
+        sensitive << clk.posedge_event();
+        async_reset_signal_is(rst, false);
+
+        SC_THREAD(collect);
+        sensitive << clk.posedge_event();
+        async_reset_signal_is(rst, false);
+    }
+
+    void reset() {
+        rst.write(false);
+        wait(10);
+        rst.write(true);
+    }
+
+    // Tile Gaussians in gid order and the equal-population pivots of their depths
+    static void tile_order(const GSTraceTile &tile, const GSTraceGauss *gauss,
+                           std::vector<int> &order, QSU_PIVOT_TYPE &cfg) {
+        order.resize(tile.num_gaussians);
+        for (size_t k = 0; k < order.size(); k++) order[k] = k;
+        std::sort(order.begin(), order.end(), [gauss](int a, int b) { return gauss[a].gid < gauss[b].gid; });
+        // The trace is front to back, so quantiles are direct lookups
+        for (int i = 0; i < NUM_PIVOTS; i++) {
+            size_t k = (order.size() * (i + 1)) / NUM_SUBSETS;
+            cfg.pivots[i] = (order.empty()) ? FP16_TYPE(65504.0)
+                                            : FP16_TYPE(double(gauss[std::min(k, order.size()-1)].depth));
+        }
+    }
+
+    void run() {
+        QSUInput.ResetWrite();
+        QSUPivot.ResetWrite();
+        wait(10);
+
+        GSTraceTile tile;
+        const GSTraceGauss *gauss;
+        std::vector<int> order;
+        while (feed.NextTile(tile, gauss)) {
+            QSU_PIVOT_TYPE cfg;
+            tile_order(tile, gauss, order, cfg);
+            // Pivots only change while the QSU is idle
+            while (received < sent) wait();
+            QSUPivot.Push(cfg);
+            for (size_t k = 0; k < order.size(); k++) {
+                QSU_IN_TYPE in;
+                in.depth = FP16_TYPE(double(gauss[order[k]].depth));
+                in.gid = k;
+                QSUInput.Push(in);
+                sent++;
+            }
+        }
+    }
+
+    void collect() {
+        QSUOutput.ResetRead();
+        wait(10);
+
+        sc_time start = sc_time_stamp(), first_out;
+        GSTraceTile tile;
+        const GSTraceGauss *gauss;
+        std::vector<int> order;
+        unsigned long mismatches = 0, chunks = 0, tiles = 0, max_subset = 0;
+        while (check.NextTile(tile, gauss)) {
+            QSU_PIVOT_TYPE cfg;
+            tile_order(tile, gauss, order, cfg);
+            unsigned long count[NUM_SUBSETS] = {0};
+            for (size_t k = 0; k < order.size(); k++) {
+                QSU_OUT_TYPE o = QSUOutput.Pop();
+                if (received++ == 0) first_out = sc_time_stamp();
+                size_t idx = std::min((size_t)o.gid.to_int(), order.size()-1);
+                FP16_TYPE depth = FP16_TYPE(double(gauss[order[idx]].depth));
+                int expected = 0;
+                for (int i = 0; i < NUM_PIVOTS; i++) {
+                    if (depth >= cfg.pivots[i]) expected = i + 1;
+                }
+                if (o.gid.to_int() != (int)k || o.subset.to_int() != expected) mismatches++;
+                count[o.subset.to_int() % NUM_SUBSETS]++;
+            }
+            for (int s = 0; s < NUM_SUBSETS; s++) {
+                chunks += (count[s] + SORT_NUM - 1) / SORT_NUM;
+                max_subset = std::max(max_subset, count[s]);
+            }
+            tiles++;
+        }
+
+        double cycles = (sc_time_stamp() - start).to_seconds()*1e9;
+        const GSTraceHeader &h = check.Header();
+        cout << "=== QSU trace: " << h.width << "x" << h.height << ", " << tiles << " tiles, "
+             << h.num_pairs << " tile-Gaussian pairs ===" << endl;
+        cout << "Cycles = " << cycles << " | keys/cycle = " << (cycles > 0 ? h.num_pairs / cycles : 0.0) << endl;
+        cout << "Largest subset = " << max_subset << " | BSU chunks = " << chunks
+             << " (" << (h.num_pairs ? double(chunks * SORT_NUM) / h.num_pairs : 0.0) << " slots per key)" << endl;
+        cout << "Subset mismatches = " << mismatches << (mismatches == 0 ? " ✓" : " ✗ (MISMATCH)") << endl;
+        nrsim::TimingReport timing("QSU");
+        timing.Op("partition", "key", h.num_pairs, cycles, (first_out - start).to_seconds()*1e9);
+        timing.Value("slots_per_key", h.num_pairs ? double(chunks * SORT_NUM) / h.num_pairs : 0.0);
+        timing.Value("num_subsets", NUM_SUBSETS);
+        timing.Write();
+        sc_stop();
+    }
+};
+
 int sc_main(int argc, char *argv[]) {
+    if (argc > 2 && std::string(argv[1]) == "trace") {
+        trace_bench tb("tb", argv[2]);
+        sc_start();
+        return 0;
+    }
     testbench tb("tb");
     sc_start();
     return 0;
@@ -4,24 +4,79 @@
 #include "GSCOREPackDef.h"
 #include <ac_channel.h>
 #include <nvhls_connections.h>
+#include <nvhls_assert.h>
 #include <ac_math/ac_hcordic.h>
 #include <ac_math/ac_sigmoid_pwl.h>
 #include <ac_math.h>
 #include <ac_std_float.h>
+#include "../../common/include/nrsim_exp.h"
 
+typedef nrsim::NrsimExp<VRU_EXP_IMPL, VRU_EXP_SEGMENTS> VRU_EXP_POLICY;
+
+/*
+ * FP16 datapath of the three stages, shared with the untimed model (VRU_untimed.h)
+ */
+// Stage 1: alpha = o * exp(-0.5 * (p' - mu')^T Sigma'^(-1) (p' - mu')), before pruning
+inline FP16_TYPE VRU_Alpha(const VRU_IN_TYPE &in) {
+    // Calculate (p' - mu')
+    FP16_TYPE diff_x = in.pixel_pos_x - in.mean_x;
+    FP16_TYPE diff_y = in.pixel_pos_y - in.mean_y;
+
+    // Calculate -0.5 * (p' - mu')^T Sigma'^(-1) (p' - mu')
+    FP16_TYPE exponent = FP16_TYPE(FP16_TYPE(-0.5) * (
+        diff_x * (in.conx * diff_x + in.cony * diff_y) +
+        diff_y * (in.cony * diff_x + in.conz * diff_y)
+    ));
+
+    FP16_TYPE alpha;
+    VRU_EXP_POLICY::exp(exponent, alpha);
+    return in.opacity * alpha;
+}
+
+// Pixel of the tile a (pixel, Gaussian) pair belongs to, tags the output of the pixel
+inline PIXEL_ID_TYPE VRU_PixelId(const VRU_IN_TYPE &in) {
+    int x = in.pixel_pos_x.convert_to_ac_fixed<8, 8, false, AC_TRN, AC_SAT>().to_int();
+    int y = in.pixel_pos_y.convert_to_ac_fixed<8, 8, false, AC_TRN, AC_SAT>().to_int();
+    return PIXEL_ID_TYPE(y * TILE_SIZE + x);
+}
+
+// Stage 2: T_i+1 = T_i * (1 - alpha_i)
+inline FP16_TYPE VRU_Transmittance(FP16_TYPE transmittance, FP16_TYPE alpha) {
+    return FP16_TYPE(transmittance * (FP16_TYPE(1.0) - alpha));
+}
+
+// Stage 3: C += T_i * alpha_i * c_i
+inline void VRU_Accumulate(RGB_TYPE &acc, FP16_TYPE transmittance, FP16_TYPE alpha, const RGB_TYPE &color) {
+    FP16_TYPE temp = transmittance * alpha;
+    acc.r += temp * color.r;
+    acc.g += temp * color.g;
+    acc.b += temp * color.b;
+}
+
+/*
+ * ROTATE: number of pixels interleaved per VRU (hides the transmittance / color
+ * read-modify-write latency VRU_RMW_LATENCY, a slot is stalled until its last update is done)
+ */
 #pragma hls_design block
+template <int ROTATE = NUM_ROTATE>
 class VRU : public match::Module {
     SC_HAS_PROCESS(VRU);
 public:
+    typedef ac_int<nvhls::index_width<ROTATE>::val, false> ROTATE_INDEX_TYPE;
     // Input/Output channels
     Connections::In<VRU_IN_TYPE> VRUInput;
     Connections::Out<VRU_OUT_TYPE> VRUOutput;
+    Connections::Out<VRU_TERM_TYPE> VRUTerminate;  // early-termination hint for the feeder
+
+    // Stage 2 -> Stage 1 (early-termination feedback)
+    Connections::Combinational<VRU_TERM_TYPE> terminate_to_step1;
 
     // Stage 1 -> Stage 2
     Connections::Combinational<FP16_TYPE> alpha_out_to_step2;
     Connections::Combinational<RGB_TYPE> gaussian_color_to_step2;
     Connections::Combinational<bool> last_gaussian_to_step2;
     Connections::Combinational<ROTATE_INDEX_TYPE> rotate_idx_to_step2;
+    Connections::Combinational<PIXEL_ID_TYPE> pixel_to_step2;
 
     // Stage 2 -> Stage 3
     Connections::Combinational<FP16_TYPE> alpha_out_to_step3;
@@ -29,19 +84,24 @@ public:
     Connections::Combinational<RGB_TYPE> gaussian_color_to_step3;
     Connections::Combinational<bool> last_gaussian_to_step3;
     Connections::Combinational<ROTATE_INDEX_TYPE> rotate_idx_to_step3;
+    Connections::Combinational<PIXEL_ID_TYPE> pixel_to_step3;
     // Constructor
     VRU(sc_module_name name) : match::Module(name),
                               VRUInput("VRUInput"),
                               VRUOutput("VRUOutput"),
+                              VRUTerminate("VRUTerminate"),
+                              terminate_to_step1("terminate_to_step1"),
                               alpha_out_to_step2("alpha_out_to_step2"),
                               gaussian_color_to_step2("gaussian_color_to_step2"),
                               last_gaussian_to_step2("last_gaussian_to_step2"),
                               rotate_idx_to_step2("rotate_idx_to_step2"),
+                              pixel_to_step2("pixel_to_step2"),
                               alpha_out_to_step3("alpha_out_to_step3"),
                               transmittance_to_step3("transmittance_to_step3"),
                               gaussian_color_to_step3("gaussian_color_to_step3"),
                               last_gaussian_to_step3("last_gaussian_to_step3"),
-                              rotate_idx_to_step3("rotate_idx_to_step3") {
+                              rotate_idx_to_step3("rotate_idx_to_step3"),
+                              pixel_to_step3("pixel_to_step3") {
         SC_THREAD(VRU_step1);
         sensitive << clk.pos();
         async_reset_signal_is(rst, false);
@@ -55,77 +115,124 @@ public:
         async_reset_signal_is(rst, false);  
     }
 
+    // Statistics: Gaussian-pixel pairs seen / skipped by the subtile bitmap
+    unsigned long total_pairs;
+    unsigned long skipped_pairs;
+    // Statistics: Gaussians dropped after their pixel saturated (step1 / step2)
+    unsigned long et_saved_step1;
+    unsigned long et_saved_step2;
+    // Statistics: Gaussians issued to step2 / cycles step1 was stalled by the RMW hazard
+    unsigned long issued_gaussians;
+    unsigned long hazard_stall_cycles;
+
     /*
      * Input: Gaussian features (mean, covariance, color, opacity)
-     * Output: RGB pixel color
+     * Output: RGB pixel color, tagged with the pixel of the tile (VRU_PixelId)
      * Perform: Volume rendering based on alpha computation and blending
+     * Gaussians of a pixel reported saturated by step2 are dropped until its last Gaussian
      */
     void VRU_step1() {
         VRUInput.Reset();
+        terminate_to_step1.ResetRead();
         alpha_out_to_step2.ResetWrite();
         gaussian_color_to_step2.ResetWrite();
         last_gaussian_to_step2.ResetWrite();
         rotate_idx_to_step2.ResetWrite();
+        pixel_to_step2.ResetWrite();
+        total_pairs = 0;
+        skipped_pairs = 0;
+        et_saved_step1 = 0;
+        issued_gaussians = 0;
+        hazard_stall_cycles = 0;
+
+        bool terminated[ROTATE];
+        ET_TAG_TYPE pixel_tag[ROTATE];
+        UINT8_TYPE slot_busy[ROTATE];   // cycles until the slot's last RMW is done
+        #pragma hls_unroll
+        for (int i = 0; i < ROTATE; i++) {
+            terminated[i] = false;
+            pixel_tag[i] = 0;
+            slot_busy[i] = 0;
+        }
+        VRU_IN_TYPE vru_input;
+        bool holding = false;           // input waiting for its slot
         wait();
 
 
         #pragma hls_pipeline_init_interval 1
         while (1) {
             wait();
+
+            // Saturation feedback, only for the pixel currently in the slot
+            VRU_TERM_TYPE term;
+            if (NRSIM_POPNB(terminate_to_step1, term)) {
+                if (term.tag == pixel_tag[term.rotate_idx]) {
+                    terminated[term.rotate_idx] = true;
+                }
+            }
+
+            #pragma hls_unroll
+            for (int i = 0; i < ROTATE; i++) {
+                if (slot_busy[i] != 0) slot_busy[i]--;
+            }
             
             // Get input Gaussian features
-            VRU_IN_TYPE vru_input;
-            if (VRUInput.PopNB(vru_input)) { 
-                // Extract Gaussian features
-                FP16_TYPE pixel_x = vru_input.pixel_pos_x;
-                FP16_TYPE pixel_y = vru_input.pixel_pos_y;
-                FP16_TYPE mean_x = vru_input.mean_x;
-                FP16_TYPE mean_y = vru_input.mean_y;
-                
-                // Get 2x2 covariance matrix
-                FP16_TYPE conx = vru_input.conx;
-                FP16_TYPE cony = vru_input.cony;
-                FP16_TYPE conz = vru_input.conz;
-            
-                // Get color and opacity
+            if (!holding) holding = NRSIM_POPNB(VRUInput, vru_input);
+            if (holding) { 
+                // Get color
                 RGB_TYPE gaussian_color = vru_input.color;
-                FP16_TYPE opacity = vru_input.opacity;
                 ROTATE_INDEX_TYPE rotate_idx = vru_input.rotate_idx;
-                // Bitmap for subtile skipping (optional)
-                // UINT8_TYPE bitmap = vru_input.bitmap;
-                // UINT8_TYPE subtile_idx = vru_input.subtile_idx;
-
-                // // Check bitmap to see if this subtile should be processed
-                // bool skip_computation = ((bitmap & (1 << subtile_idx)) == 0);
-                
-                // // If subtile should be skipped, skip alpha computation
-                // if (!skip_computation) {
+#ifdef USE_SUBTILE_BITMAP
+                // Bitmap for subtile skipping
+                UINT8_TYPE bitmap = vru_input.bitmap;
+                UINT8_TYPE subtile_idx = vru_input.subtile_idx;
+
+                // Check bitmap to see if this subtile should be processed
+                bool skip_computation = (bitmap[subtile_idx] == 0);
+#else
+                bool skip_computation = false;
+#endif
+                bool dead = terminated[rotate_idx];
+                bool bitmap_skip = skip_computation && !dead;
+                if (dead) {
+                    skip_computation = true;
+                }
+
+                // If subtile should be skipped, skip alpha computation
+                FP16_TYPE alpha = FP16_TYPE(0.0);
+                if (!skip_computation) {
                     // Stage 1: Alpha Computation & Pruning
                     // Compute alpha according to equation 2: α_i = o_i * exp(-0.5 * (p' - μ')^T Σ'^(-1) (p' - μ'))
+                    alpha = VRU_Alpha(vru_input);
+                }
                     
-                    // Calculate (p' - μ')
-                    FP16_TYPE diff_x = pixel_x - mean_x;
-                    FP16_TYPE diff_y = pixel_y - mean_y;
-                    
-                    // Calculate (p' - μ')^T Σ'^(-1) (p' - μ')
-                    FP16_TYPE exponent = FP16_TYPE(FP16_TYPE(-0.5) * (
-                        diff_x * (conx * diff_x + cony * diff_y) +
-                        diff_y * (cony * diff_x + conz * diff_y)
-                    ));
-                    
-                    // Calculate alpha: α_i = o_i * exp(-0.5 * exponent)
-                    FP16_TYPE alpha;
-                    // ac_math::ac_exp_cordic(exponent, alpha);
-                    ac_math::ac_exp_pwl(exponent, alpha);
-                    alpha = opacity * alpha;
-                    
-                    // Alpha pruning: check if alpha is below threshold (1/255)
-                    if (alpha >= FP16_TYPE(1.0/255.0)) {
-                        alpha_out_to_step2.PushNB(alpha);
-                        gaussian_color_to_step2.PushNB(gaussian_color);
-                        last_gaussian_to_step2.PushNB(vru_input.last_gaussian);
-                        rotate_idx_to_step2.PushNB(rotate_idx);
+                // Alpha pruning: check if alpha is below threshold (1/255)
+                // The last Gaussian always passes (with zero alpha) so the pixel is closed out
+                bool issue = (alpha >= FP16_TYPE(1.0/255.0) || vru_input.last_gaussian);
+                if (issue && slot_busy[rotate_idx] != 0) {
+                    // Read-modify-write hazard on the slot, retry next cycle
+                    hazard_stall_cycles++;
+                } else {
+                    if (issue) {
+                        if (alpha < FP16_TYPE(1.0/255.0)) alpha = FP16_TYPE(0.0);
+                        NRSIM_PUSHNB(alpha_out_to_step2, alpha);
+                        NRSIM_PUSHNB(gaussian_color_to_step2, gaussian_color);
+                        NRSIM_PUSHNB(last_gaussian_to_step2, vru_input.last_gaussian);
+                        NRSIM_PUSHNB(rotate_idx_to_step2, rotate_idx);
+                        NRSIM_PUSHNB(pixel_to_step2, VRU_PixelId(vru_input));
+                        slot_busy[rotate_idx] = VRU_RMW_LATENCY;
+                        issued_gaussians++;
+                    }
+                    if (bitmap_skip) skipped_pairs++;
+                    if (dead && !vru_input.last_gaussian) et_saved_step1++;
+                    if (vru_input.last_gaussian) {
+                        NRSIM_TRACE_EVENT(last_gaussian);
+                        terminated[rotate_idx] = false;
+                        pixel_tag[rotate_idx]++;
                     }
+                    total_pairs++;
+                    holding = false;
+                }
             }
         }
     }
@@ -136,17 +243,26 @@ public:
         gaussian_color_to_step2.ResetRead();
         last_gaussian_to_step2.ResetRead();
         rotate_idx_to_step2.ResetRead();
+        pixel_to_step2.ResetRead();
         gaussian_color_to_step3.ResetWrite();
         transmittance_to_step3.ResetWrite();
         last_gaussian_to_step3.ResetWrite();
         alpha_out_to_step3.ResetWrite();
         rotate_idx_to_step3.ResetWrite();
+        pixel_to_step3.ResetWrite();
+        terminate_to_step1.ResetWrite();
+        VRUTerminate.Reset();
+        et_saved_step2 = 0;
         
         // Initialize per-pixel transmittance and color
-        FP16_TYPE transmittance[NUM_ROTATE];
+        FP16_TYPE transmittance[ROTATE];
+        bool terminated[ROTATE];
+        ET_TAG_TYPE pixel_tag[ROTATE];
         #pragma hls_unroll
-        for (int i = 0; i < NUM_ROTATE; i++) {
+        for (int i = 0; i < ROTATE; i++) {
             transmittance[i] = FP16_TYPE(1.0);
+            terminated[i] = false;
+            pixel_tag[i] = 0;
         }
 
         wait();
@@ -159,29 +275,49 @@ public:
             RGB_TYPE gaussian_color;
             bool last_gaussian;
             ROTATE_INDEX_TYPE rotate_idx;
+            PIXEL_ID_TYPE pixel;
+
+            bool alpha_valid = NRSIM_POPNB(alpha_out_to_step2, alpha);
+            bool gaussian_color_valid = NRSIM_POPNB(gaussian_color_to_step2, gaussian_color);
+            bool last_gaussian_valid = NRSIM_POPNB(last_gaussian_to_step2, last_gaussian);
+            bool rotate_idx_valid = NRSIM_POPNB(rotate_idx_to_step2, rotate_idx);
+            bool pixel_valid = NRSIM_POPNB(pixel_to_step2, pixel);
+            if (alpha_valid && gaussian_color_valid && last_gaussian_valid && rotate_idx_valid && pixel_valid) {
+                // Gaussians already in flight when the pixel saturated
+                if (terminated[rotate_idx] && !last_gaussian) {
+                    et_saved_step2++;
+                    continue;
+                }
 
-            bool alpha_valid = alpha_out_to_step2.PopNB(alpha);
-            bool gaussian_color_valid = gaussian_color_to_step2.PopNB(gaussian_color);
-            bool last_gaussian_valid = last_gaussian_to_step2.PopNB(last_gaussian);
-            bool rotate_idx_valid = rotate_idx_to_step2.PopNB(rotate_idx);
-            if (alpha_valid && gaussian_color_valid && last_gaussian_valid && rotate_idx_valid) {
                 // Stage 2: Early Termination
                 // Update transmittance according to equation 4: T_i+1 = T_i * (1 - α_i) = T_i - T_i * α_i
-                FP16_TYPE temp = transmittance[rotate_idx];
-                FP16_TYPE new_transmittance = FP16_TYPE(temp * (FP16_TYPE(1.0) - alpha));
+                FP16_TYPE temp = terminated[rotate_idx] ? FP16_TYPE(0.0) : transmittance[rotate_idx];
+                FP16_TYPE new_transmittance = VRU_Transmittance(temp, alpha);
             
                
                 // Push to next stage
-                gaussian_color_to_step3.PushNB(gaussian_color);
-                transmittance_to_step3.PushNB(temp);
-                last_gaussian_to_step3.PushNB(last_gaussian);
-                alpha_out_to_step3.PushNB(alpha);
-                rotate_idx_to_step3.PushNB(rotate_idx);
+                NRSIM_PUSHNB(gaussian_color_to_step3, gaussian_color);
+                NRSIM_PUSHNB(transmittance_to_step3, temp);
+                NRSIM_PUSHNB(last_gaussian_to_step3, last_gaussian);
+                NRSIM_PUSHNB(alpha_out_to_step3, alpha);
+                NRSIM_PUSHNB(rotate_idx_to_step3, rotate_idx);
+                NRSIM_PUSHNB(pixel_to_step3, pixel);
                  // Update transmittance
                 transmittance[rotate_idx] = new_transmittance;
 
-                if (last_gaussian || temp < FP16_TYPE(0.0001)) {
+                if (last_gaussian) {
+                    // Reset for next pixel
                     transmittance[rotate_idx] = FP16_TYPE(1.0);
+                    terminated[rotate_idx] = false;
+                    pixel_tag[rotate_idx]++;
+                } else if (new_transmittance < FP16_TYPE(ET_THRESHOLD)) {
+                    // Saturated: tell step1 and the feeder to drop the rest of this pixel
+                    terminated[rotate_idx] = true;
+                    VRU_TERM_TYPE term;
+                    term.rotate_idx = rotate_idx;
+                    term.tag = pixel_tag[rotate_idx];
+                    NRSIM_PUSHNB(terminate_to_step1, term);
+                    NRSIM_PUSHNB(VRUTerminate, term);
                 }
             }
         }
@@ -194,11 +330,12 @@ public:
         last_gaussian_to_step3.ResetRead();
         alpha_out_to_step3.ResetRead();
         rotate_idx_to_step3.ResetRead();
+        pixel_to_step3.ResetRead();
         VRUOutput.Reset();
         
-        RGB_TYPE accumulated_color[NUM_ROTATE];
+        RGB_TYPE accumulated_color[ROTATE];
         #pragma hls_unroll
-        for (int i = 0; i < NUM_ROTATE; i++) {
+        for (int i = 0; i < ROTATE; i++) {
             accumulated_color[i].r = FP16_TYPE(0.0);
             accumulated_color[i].g = FP16_TYPE(0.0);
             accumulated_color[i].b = FP16_TYPE(0.0);
@@ -215,35 +352,39 @@ public:
             bool last_gaussian;
             FP16_TYPE alpha;
             ROTATE_INDEX_TYPE rotate_idx;
+            PIXEL_ID_TYPE pixel;
             
-            bool gaussian_color_valid = gaussian_color_to_step3.PopNB(gaussian_color);
-            bool transmittance_valid = transmittance_to_step3.PopNB(transmittance);
-            bool last_gaussian_valid = last_gaussian_to_step3.PopNB(last_gaussian);
-            bool alpha_valid = alpha_out_to_step3.PopNB(alpha);
-            bool rotate_idx_valid = rotate_idx_to_step3.PopNB(rotate_idx);
-            if (gaussian_color_valid && transmittance_valid && last_gaussian_valid && alpha_valid && rotate_idx_valid) {
+            bool gaussian_color_valid = NRSIM_POPNB(gaussian_color_to_step3, gaussian_color);
+            bool transmittance_valid = NRSIM_POPNB(transmittance_to_step3, transmittance);
+            bool last_gaussian_valid = NRSIM_POPNB(last_gaussian_to_step3, last_gaussian);
+            bool alpha_valid = NRSIM_POPNB(alpha_out_to_step3, alpha);
+            bool rotate_idx_valid = NRSIM_POPNB(rotate_idx_to_step3, rotate_idx);
+            bool pixel_valid = NRSIM_POPNB(pixel_to_step3, pixel);
+            if (gaussian_color_valid && transmittance_valid && last_gaussian_valid && alpha_valid && rotate_idx_valid
+                && pixel_valid) {
                 // Stage 3: Volume Rendering
                 // Accumulate color: C += T_i * α_i * c_i
-                FP16_TYPE temp = transmittance * alpha;
-                accumulated_color[rotate_idx].r += temp * gaussian_color.r;
-                accumulated_color[rotate_idx].g += temp * gaussian_color.g;
-                accumulated_color[rotate_idx].b += temp * gaussian_color.b;
+                VRU_Accumulate(accumulated_color[rotate_idx], transmittance, alpha, gaussian_color);
+                NRSIM_TOGGLE_AT(accumulated_color, rotate_idx.to_int(), accumulated_color[rotate_idx]);
                         
-                // Early termination or finished processing all Gaussians
-                if (last_gaussian || transmittance < FP16_TYPE(0.0001)) {
+                // Finished processing all Gaussians, exactly one output per pixel
+                if (last_gaussian) {
                      // Initialize output
                     VRU_OUT_TYPE vru_output;
                     
                     // Set the final accumulated color as output
                     vru_output.color = accumulated_color[rotate_idx];
+                    vru_output.pixel = pixel;
                     
                     // Reset transmittance and accumulated color for next pixel
                     accumulated_color[rotate_idx].r = FP16_TYPE(0.0);
                     accumulated_color[rotate_idx].g = FP16_TYPE(0.0);
                     accumulated_color[rotate_idx].b = FP16_TYPE(0.0);
                     
-                    // Push output to channel
-                    VRUOutput.PushNB(vru_output);
+                    // Push output to channel; step1 / step2 cannot stall, the sender provides the space
+                    // (GSCore Render holds VRU_FIFO_DEPTH output credits per VRU), checked in C simulation only
+                    bool pushed = NRSIM_PUSHNB(VRUOutput, vru_output);
+                    NVHLS_ASSERT_MSG(pushed, "VRUOutput full, pixel color dropped");
                 }
             }
         }
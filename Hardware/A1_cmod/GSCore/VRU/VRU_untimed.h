@@ -0,0 +1,233 @@
+#ifndef GSCORE_VRU_UNTIMED_H
+#define GSCORE_VRU_UNTIMED_H
+
+#include "VRU.h"
+#include <deque>
+#include <vector>
+
+/*
+ * Untimed functional model of VRU<ROTATE> for full-frame renders
+ * Same FP16 math as VRU_step1..3 (VRU_Alpha / VRU_Transmittance / VRU_Accumulate), so pixel
+ * colors are bit-exact with the cycle-accurate VRU for the same input stream.
+ * Push / PopNB / PopTerminateNB stand in for VRUInput / VRUOutput / VRUTerminate.
+ * cycles is an estimate: one input per cycle, RMW hazard stalls, early-termination feedback
+ * latency and pipeline drain are modeled, FIFO back-pressure is not.
+ */
+template <int ROTATE = NUM_ROTATE>
+class VRU_untimed {
+public:
+    static const int FEEDBACK_LATENCY = 2;  // step1 -> step2 -> terminate_to_step1 -> step1
+    static const int PIPELINE_DRAIN = 2;    // step2, step3
+
+    // Statistics, same meaning as in VRU<ROTATE>
+    unsigned long total_pairs;
+    unsigned long skipped_pairs;
+    unsigned long et_saved_step1;
+    unsigned long et_saved_step2;
+    unsigned long issued_gaussians;
+    unsigned long hazard_stall_cycles;
+    // Estimated cycles of step1 (inputs consumed + stalls)
+    unsigned long cycles;
+
+    VRU_untimed() { Reset(); }
+
+    void Reset() {
+        for (int i = 0; i < ROTATE; i++) {
+            transmittance[i] = FP16_TYPE(1.0);
+            accumulated_color[i].r = FP16_TYPE(0.0);
+            accumulated_color[i].g = FP16_TYPE(0.0);
+            accumulated_color[i].b = FP16_TYPE(0.0);
+            terminated[i] = false;
+            pixel_tag[i] = 0;
+            slot_ready[i] = 0;
+            term_visible[i] = 0;
+        }
+        outputs.clear();
+        terminations.clear();
+        total_pairs = 0;
+        skipped_pairs = 0;
+        et_saved_step1 = 0;
+        et_saved_step2 = 0;
+        issued_gaussians = 0;
+        hazard_stall_cycles = 0;
+        cycles = 0;
+    }
+
+    // One (pixel, Gaussian) pair, as pushed to VRUInput
+    void Push(const VRU_IN_TYPE &in) {
+        int slot = in.rotate_idx.to_int() % ROTATE;
+        cycles++;
+
+#ifdef USE_SUBTILE_BITMAP
+        bool skip_computation = (in.bitmap[in.subtile_idx] == 0);
+#else
+        bool skip_computation = false;
+#endif
+        // step1 only sees the saturation once the feedback arrived
+        bool dead = terminated[slot] && cycles >= term_visible[slot];
+        bool bitmap_skip = skip_computation && !dead;
+        if (dead) skip_computation = true;
+
+        FP16_TYPE alpha = FP16_TYPE(0.0);
+        if (!skip_computation) alpha = VRU_Alpha(in);
+
+        bool issue = (alpha >= FP16_TYPE(1.0/255.0) || in.last_gaussian);
+        if (issue) {
+            if (slot_ready[slot] > cycles) {
+                hazard_stall_cycles += slot_ready[slot] - cycles;
+                cycles = slot_ready[slot];
+            }
+            if (alpha < FP16_TYPE(1.0/255.0)) alpha = FP16_TYPE(0.0);
+            slot_ready[slot] = cycles + VRU_RMW_LATENCY;
+            issued_gaussians++;
+        }
+        if (bitmap_skip) skipped_pairs++;
+        if (dead && !in.last_gaussian) et_saved_step1++;
+        total_pairs++;
+
+        if (issue) {
+            if (terminated[slot] && !in.last_gaussian) {
+                // In flight when the pixel saturated, dropped by step2
+                et_saved_step2++;
+            } else {
+                // step2
+                FP16_TYPE temp = terminated[slot] ? FP16_TYPE(0.0) : transmittance[slot];
+                FP16_TYPE new_transmittance = VRU_Transmittance(temp, alpha);
+                transmittance[slot] = new_transmittance;
+
+                // step3
+                VRU_Accumulate(accumulated_color[slot], temp, alpha, in.color);
+
+                if (in.last_gaussian) {
+                    VRU_OUT_TYPE out;
+                    out.color = accumulated_color[slot];
+                    out.pixel = VRU_PixelId(in);
+                    outputs.push_back(out);
+                    accumulated_color[slot].r = FP16_TYPE(0.0);
+                    accumulated_color[slot].g = FP16_TYPE(0.0);
+                    accumulated_color[slot].b = FP16_TYPE(0.0);
+                    transmittance[slot] = FP16_TYPE(1.0);
+                } else if (new_transmittance < FP16_TYPE(ET_THRESHOLD)) {
+                    terminated[slot] = true;
+                    term_visible[slot] = cycles + FEEDBACK_LATENCY;
+                    VRU_TERM_TYPE term;
+                    term.rotate_idx = slot;
+                    term.tag = pixel_tag[slot];
+                    terminations.push_back(term);
+                }
+            }
+        }
+        if (in.last_gaussian) {
+            terminated[slot] = false;
+            pixel_tag[slot]++;
+        }
+    }
+
+    bool PopNB(VRU_OUT_TYPE &out) {
+        if (outputs.empty()) return false;
+        out = outputs.front();
+        outputs.pop_front();
+        return true;
+    }
+
+    bool PopTerminateNB(VRU_TERM_TYPE &term) {
+        if (terminations.empty()) return false;
+        term = terminations.front();
+        terminations.pop_front();
+        return true;
+    }
+
+    // Saturated and not closed yet (what the feeder learns from VRUTerminate)
+    bool PixelDone(int slot) const { return terminated[slot]; }
+
+    // Whole input list, outputs appended in pixel close-out order
+    void Run(const std::vector<VRU_IN_TYPE> &in, std::vector<VRU_OUT_TYPE> &out) {
+        for (size_t i = 0; i < in.size(); i++) {
+            Push(in[i]);
+        }
+        VRU_OUT_TYPE o;
+        while (PopNB(o)) out.push_back(o);
+    }
+
+    // Estimated cycles until the last output leaves step3
+    unsigned long TotalCycles() const { return cycles + PIPELINE_DRAIN; }
+
+private:
+    FP16_TYPE transmittance[ROTATE];
+    RGB_TYPE accumulated_color[ROTATE];
+    bool terminated[ROTATE];
+    ET_TAG_TYPE pixel_tag[ROTATE];
+    unsigned long slot_ready[ROTATE];    // first cycle the slot may issue again
+    unsigned long term_visible[ROTATE];  // cycle step1 learns about the saturation
+    std::deque<VRU_OUT_TYPE> outputs;
+    std::deque<VRU_TERM_TYPE> terminations;
+};
+
+/*
+ * Untimed render of one tile, pixels distributed over GSCORE_NUM_VRU models in the same order as
+ * GSCore::Render (pixel p -> VRU p % GSCORE_NUM_VRU, NUM_ROTATE pixels interleaved per VRU),
+ * saturated pixels only get their closing Gaussian.
+ * Input: depth-sorted Gaussians of the tile (tile-relative means), num may be 0
+ * Output: TILE_PIXELS colors in raster order, returns the estimated cycles (slowest VRU)
+ */
+inline unsigned long VRU_RenderTile(const GSCORE_GAUSS_TYPE *gauss, int num, RGB_TYPE *pixels) {
+    VRU_untimed<NUM_ROTATE> vru[GSCORE_NUM_VRU];
+    int n = (num == 0) ? 1 : num;
+
+    for (int base = 0; base < TILE_PIXELS; base += GSCORE_NUM_VRU*NUM_ROTATE) {
+        for (int g = 0; g < n; g++) {
+            GSCORE_GAUSS_TYPE gs;
+            if (num == 0) {
+                gs.mean_x = FP16_TYPE(0.0);
+                gs.mean_y = FP16_TYPE(0.0);
+                gs.conx = FP16_TYPE(0.0);
+                gs.cony = FP16_TYPE(0.0);
+                gs.conz = FP16_TYPE(0.0);
+                gs.color.r = FP16_TYPE(0.0);
+                gs.color.g = FP16_TYPE(0.0);
+                gs.color.b = FP16_TYPE(0.0);
+                gs.opacity = FP16_TYPE(0.0);
+#ifdef USE_SUBTILE_BITMAP
+                gs.bitmap = 0;
+#endif
+            } else {
+                gs = gauss[g];
+            }
+            for (int r = 0; r < NUM_ROTATE; r++) {
+                for (int v = 0; v < GSCORE_NUM_VRU; v++) {
+                    bool last = (g == n-1);
+                    if (vru[v].PixelDone(r) && !last) continue;
+                    int p = base + r*GSCORE_NUM_VRU + v;
+                    VRU_IN_TYPE in;
+                    in.pixel_pos_x = FP16_TYPE(double(p % TILE_SIZE));
+                    in.pixel_pos_y = FP16_TYPE(double(p / TILE_SIZE));
+                    in.mean_x = gs.mean_x;
+                    in.mean_y = gs.mean_y;
+                    in.conx = gs.conx;
+                    in.cony = gs.cony;
+                    in.conz = gs.conz;
+                    in.color = gs.color;
+                    in.opacity = gs.opacity;
+                    in.last_gaussian = last;
+                    in.rotate_idx = r;
+#ifdef USE_SUBTILE_BITMAP
+                    in.bitmap = gs.bitmap;
+                    in.subtile_idx = ((p / TILE_SIZE) / SUBTILE_SIZE) * (TILE_SIZE / SUBTILE_SIZE)
+                                   + (p % TILE_SIZE) / SUBTILE_SIZE;
+#endif
+                    vru[v].Push(in);
+                    VRU_OUT_TYPE out;
+                    if (vru[v].PopNB(out)) pixels[p] = out.color;
+                }
+            }
+        }
+    }
+
+    unsigned long cycles = 0;
+    for (int v = 0; v < GSCORE_NUM_VRU; v++) {
+        if (vru[v].TotalCycles() > cycles) cycles = vru[v].TotalCycles();
+    }
+    return cycles;
+}
+
+#endif //GSCORE_VRU_UNTIMED_H
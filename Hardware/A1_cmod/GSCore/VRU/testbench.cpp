@@ -1,5 +1,10 @@
 #define NVHLS_VERIFY_BLOCKS (VRU)
 #include "VRU.h"
+#include "VRU_untimed.h"
+#include "GSCORETrace.h"
+#include "../../common/include/nrsim_reference.h"
+#include "../../common/include/nrsim_timing.h"
+#include "../../common/include/nrsim_latency.h"
 #include <nvhls_verify.h>
 #include "nvhls_connections.h"
 #include "ac_sysc_trace.h"
@@ -9,6 +14,11 @@
 #include <mc_connections.h>
 #include <cmath>
 #include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <deque>
 
 #pragma hls_design top
 class testbench : public sc_module {
@@ -18,13 +28,16 @@ public:
 
     Connections::Combinational<VRU_IN_TYPE> VRUInput;
     Connections::Combinational<VRU_OUT_TYPE> VRUOutput;
+    Connections::Combinational<VRU_TERM_TYPE> VRUTerminate;
 
-    NVHLS_DESIGN(VRU) dut;
+    NVHLS_DESIGN(VRU<NUM_ROTATE>) dut;
+    VRU_untimed<NUM_ROTATE> model;      // fed the same inputs, outputs must match bit-exactly
 
     SC_CTOR(testbench) : clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
                    rst("rst"),
                    VRUInput("VRUInput"),
                    VRUOutput("VRUOutput"),
+                   VRUTerminate("VRUTerminate"),
                    dut("dut") {
 
         sc_object_tracer<sc_clock> trace_clk(clk);
@@ -33,6 +46,7 @@ public:
         dut.rst(rst);
         dut.VRUInput(VRUInput);
         dut.VRUOutput(VRUOutput);
+        dut.VRUTerminate(VRUTerminate);
 
         SC_THREAD(reset);
         sensitive << clk.posedge_event();
@@ -111,6 +125,15 @@ public:
         // Set last_gaussian flag
         gaussian.last_gaussian = last_gaussian;
         gaussian.rotate_idx = 0;
+#ifdef USE_SUBTILE_BITMAP
+        gaussian.bitmap = 0xFF;     // touches every subtile unless a test says otherwise
+        gaussian.subtile_idx = 0;
+#endif
+    }
+
+    void send(const VRU_IN_TYPE &gaussian) {
+        model.Push(gaussian);
+        VRUInput.Push(gaussian);
     }
 
     void run() {
@@ -148,7 +171,7 @@ public:
         cout << "Expected Alpha: " << expected_alpha << endl;
         cout << "Expected Color: (" << expected_r << ", " << expected_g << ", " << expected_b << ")" << endl;
         
-        VRUInput.Push(gaussian1);
+        send(gaussian1);
         wait(5);
         
         
@@ -225,11 +248,11 @@ public:
                                            << transmittance2_3 << endl;
         cout << "Expected Color: (" << expected_r2 << ", " << expected_g2 << ", " << expected_b2 << ")" << endl;
         
-        VRUInput.Push(gaussian2_1);
+        send(gaussian2_1);
         wait(1);
-        VRUInput.Push(gaussian2_2);
+        send(gaussian2_2);
         wait(1);
-        VRUInput.Push(gaussian2_3);
+        send(gaussian2_3);
         wait(5);
         
 
@@ -292,9 +315,70 @@ public:
         
         cout << "Expected Color: (" << expected_r3 << ", " << expected_g3 << ", " << expected_b3 << ")" << endl;
         
-        VRUInput.Push(gaussian3_1);
+        send(gaussian3_1);
         wait(1);
-        VRUInput.Push(gaussian3_2);
+        send(gaussian3_2);
+        wait(5);
+
+#ifdef USE_SUBTILE_BITMAP
+        // Test Case 4: Subtile bitmap skipping - first Gaussian does not touch the pixel's subtile
+        cout << "\n=== Test Case 4: Subtile Bitmap Skipping ===" << endl;
+
+        VRU_IN_TYPE gaussian4_1, gaussian4_2;
+        createGaussian(gaussian4_1,
+                      1.0, 1.0,        // Pixel position (subtile 0)
+                      1.0, 1.0,        // Mean
+                      0.5, 0.0, 0.5,   // Inverse covariance
+                      1.0, 0.0, 0.0,   // Red
+                      0.9,             // Opacity
+                      false);
+        gaussian4_1.bitmap = 0x0E;     // subtiles 1..3 only
+        gaussian4_1.subtile_idx = 0;
+        createGaussian(gaussian4_2,
+                      1.0, 1.0,
+                      1.0, 1.0,
+                      0.5, 0.0, 0.5,
+                      0.0, 0.0, 1.0,   // Blue
+                      0.5,
+                      true);
+        gaussian4_2.bitmap = 0x01;
+        gaussian4_2.subtile_idx = 0;
+
+        // Skipped Gaussian contributes nothing, transmittance stays 1
+        double expected_r4 = 0, expected_g4 = 0, expected_b4 = 0;
+        compute_expected_color(1.0, compute_expected_alpha(1.0, 1.0, 1.0, 1.0, 0.5, 0.0, 0.5, 0.5),
+                               0.0, 0.0, 1.0, expected_r4, expected_g4, expected_b4);
+        cout << "Expected Color: (" << expected_r4 << ", " << expected_g4 << ", " << expected_b4 << ")" << endl;
+
+        send(gaussian4_1);
+        wait(1);
+        send(gaussian4_2);
+        wait(5);
+#endif
+
+        // Test Case 5: Early termination feedback - long list behind an opaque front
+        cout << "\n=== Test Case 5: Early Termination Feedback ===" << endl;
+        const int NUM_ET_GAUSS = 16;
+        double expected_r5 = 0.0, expected_g5 = 0.0, expected_b5 = 0.0;
+        double T5 = 1.0;
+        int alive = 0;
+        for (int i = 0; i < NUM_ET_GAUSS; i++) {
+            double a = compute_expected_alpha(5.0, 5.0, 5.0, 5.0, 0.5, 0.0, 0.5, 0.95);
+            if (T5 >= ET_THRESHOLD) {
+                compute_expected_color(T5, a, (i % 2), 0.5, 1.0 - (i % 2), expected_r5, expected_g5, expected_b5);
+                T5 *= (1.0 - a);
+                alive++;
+            }
+        }
+        cout << "Gaussians needed before saturation: " << alive << " of " << NUM_ET_GAUSS << endl;
+        cout << "Expected Color: (" << expected_r5 << ", " << expected_g5 << ", " << expected_b5 << ")" << endl;
+
+        for (int i = 0; i < NUM_ET_GAUSS; i++) {
+            VRU_IN_TYPE g5;
+            createGaussian(g5, 5.0, 5.0, 5.0, 5.0, 0.5, 0.0, 0.5,
+                           (i % 2), 0.5, 1.0 - (i % 2), 0.95, i == NUM_ET_GAUSS-1);
+            send(g5);
+        }
         wait(5);
     }
 
@@ -303,26 +387,647 @@ public:
         wait(10);  // Wait for reset and initialization
 
         int count = 0;
+        int terminate_msgs = 0;
+        int untimed_mismatch = 0;
         while (1) {
+            VRU_TERM_TYPE term;
+            if (VRUTerminate.PopNB(term)) {
+                cout << "VRUTerminate @ " << sc_time_stamp() << " : rotate_idx = " << term.rotate_idx
+                     << ", tag = " << term.tag << endl;
+                terminate_msgs++;
+            }
             VRU_OUT_TYPE result;
             if (VRUOutput.PopNB(result)) {
                 cout << "VRU Output @ " << sc_time_stamp() << " : ";
                 cout << "  Actual Color: (" << std::setprecision(6) << result.color.r.to_double() << ", " 
                                         << std::setprecision(6) << result.color.g.to_double() << ", " 
                                         << std::setprecision(6) << result.color.b.to_double() << ")" << endl;
+                VRU_OUT_TYPE ref;
+                if (!model.PopNB(ref) || ref.color.r.data() != result.color.r.data()
+                                      || ref.color.g.data() != result.color.g.data()
+                                      || ref.color.b.data() != result.color.b.data()) {
+                    untimed_mismatch++;
+                }
                 count++;
             }
             
-            if (count >= 3) {
+#ifdef USE_SUBTILE_BITMAP
+            if (count >= 5) {
+#else
+            if (count >= 4) {
+#endif
                 break;
             }
             wait();
         }
+        cout << "\nGaussian-pixel pairs: " << dut.total_pairs
+             << ", skipped by subtile bitmap: " << dut.skipped_pairs << endl;
+        cout << "Early termination: " << terminate_msgs << " feedback messages, "
+             << dut.et_saved_step1 << " Gaussians dropped in step1, "
+             << dut.et_saved_step2 << " in step2" << endl;
+        if (terminate_msgs > 0 && dut.et_saved_step1 + dut.et_saved_step2 > 0) {
+            cout << "Early termination feedback ✓" << endl;
+        } else {
+            cout << "Early termination feedback ✗ (MISMATCH)" << endl;
+        }
+        cout << "Untimed model: " << count - untimed_mismatch << " of " << count << " pixels bit-exact, "
+             << model.TotalCycles() << " estimated cycles";
+        cout << (untimed_mismatch == 0 ? " ✓" : " ✗ (MISMATCH)") << endl;
+        sc_stop();
+    }
+};
+
+/*
+ * Interleaving sweep (./sim_VRU sweep): one VRU<R> per design point, all fed the same
+ * SWEEP_PIXELS x SWEEP_GAUSS workload R pixels at a time, every Gaussian above the alpha threshold
+ */
+#define SWEEP_PIXELS 64
+#define SWEEP_GAUSS 32
+
+class sweep_base {
+public:
+    static int running;
+};
+int sweep_base::running = 0;
+
+template <int R>
+class rotate_sweep : public sc_module, public sweep_base {
+public:
+    sc_in<bool> clk;
+    sc_in<bool> rst;
+
+    Connections::Combinational<VRU_IN_TYPE> VRUInput;
+    Connections::Combinational<VRU_OUT_TYPE> VRUOutput;
+    Connections::Combinational<VRU_TERM_TYPE> VRUTerminate;
+
+    VRU<R> dut;
+    sc_time start;
+
+    SC_HAS_PROCESS(rotate_sweep);
+    rotate_sweep(sc_module_name name) : sc_module(name),
+                                        clk("clk"),
+                                        rst("rst"),
+                                        VRUInput("VRUInput"),
+                                        VRUOutput("VRUOutput"),
+                                        VRUTerminate("VRUTerminate"),
+                                        dut("dut") {
+        dut.clk(clk);
+        dut.rst(rst);
+        dut.VRUInput(VRUInput);
+        dut.VRUOutput(VRUOutput);
+        dut.VRUTerminate(VRUTerminate);
+        running++;
+
+        SC_THREAD(run);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+
+        SC_THREAD(collect);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+    }
+
+    void run() {
+        VRUInput.ResetWrite();
+        wait(10);
+
+        start = sc_time_stamp();
+        for (int base = 0; base < SWEEP_PIXELS; base += R) {
+            for (int g = 0; g < SWEEP_GAUSS; g++) {
+                for (int r = 0; r < R; r++) {
+                    VRU_IN_TYPE in;
+                    int p = base + r;
+                    in.pixel_pos_x = FP16_TYPE(double(p % 8));
+                    in.pixel_pos_y = FP16_TYPE(double(p / 8));
+                    in.mean_x = FP16_TYPE(double(p % 8));
+                    in.mean_y = FP16_TYPE(double(p / 8));
+                    in.conx = FP16_TYPE(0.5);
+                    in.cony = FP16_TYPE(0.0);
+                    in.conz = FP16_TYPE(0.5);
+                    in.color.r = FP16_TYPE(1.0);
+                    in.color.g = FP16_TYPE(0.5);
+                    in.color.b = FP16_TYPE(0.25);
+                    in.opacity = FP16_TYPE(0.05);
+                    in.last_gaussian = (g == SWEEP_GAUSS-1);
+                    in.rotate_idx = r;
+#ifdef USE_SUBTILE_BITMAP
+                    in.bitmap = 0xFF;
+                    in.subtile_idx = 0;
+#endif
+                    VRUInput.Push(in);
+                }
+            }
+        }
+    }
+
+    void collect() {
+        VRUOutput.ResetRead();
+        VRUTerminate.ResetRead();
+        wait(10);
+
+        for (int p = 0; p < SWEEP_PIXELS; p++) {
+            VRUOutput.Pop();
+        }
+        double cycles = (sc_time_stamp() - start).to_seconds()*1e9;
+        // per-slot state: transmittance + RGB (FP16), terminated flag, ET tag, RMW scoreboard
+        int state_bits = R * (16 + 3*16 + 1 + ET_TAG_TYPE::width + UINT8_TYPE::width);
+        cout << "NUM_ROTATE = " << std::setw(2) << R
+             << " | Gaussians/cycle = " << std::setprecision(4) << (SWEEP_PIXELS*SWEEP_GAUSS) / cycles
+             << " | cycles = " << cycles
+             << " | hazard stall cycles = " << dut.hazard_stall_cycles
+             << " | slot state bits = " << state_bits << endl;
+        if (--running == 0) sc_stop();
+    }
+};
+
+class sweep_top : public sc_module {
+public:
+    sc_clock clk;
+    sc_signal<bool> rst;
+
+    rotate_sweep<1> r1;
+    rotate_sweep<2> r2;
+    rotate_sweep<4> r4;
+    rotate_sweep<8> r8;
+    rotate_sweep<16> r16;
+
+    SC_CTOR(sweep_top) : clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
+                         rst("rst"),
+                         r1("r1"), r2("r2"), r4("r4"), r8("r8"), r16("r16") {
+        sc_object_tracer<sc_clock> trace_clk(clk);
+        r1.clk(clk);  r1.rst(rst);
+        r2.clk(clk);  r2.rst(rst);
+        r4.clk(clk);  r4.rst(rst);
+        r8.clk(clk);  r8.rst(rst);
+        r16.clk(clk); r16.rst(rst);
+
+        cout << "=== VRU interleaving sweep (VRU_RMW_LATENCY = " << VRU_RMW_LATENCY << ") ===" << endl;
+
+        SC_THREAD(reset);
+        sensitive << clk.posedge_event();
+    }
+
+    void reset() {
+        rst.write(false);
+        wait(10);
+        rst.write(true);
+    }
+};
+
+/*
+ * Untimed full-frame render (./sim_VRU frame [W H]): random screen-space Gaussians binned per tile,
+ * every tile rendered with VRU_RenderTile (FP16 datapath) and in double precision, PSNR of the FP16 frame
+ */
+struct FrameGauss {
+    double depth, mean_x, mean_y, conx, cony, conz, r, g, b, opacity;
+    int tile_min_x, tile_min_y, tile_max_x, tile_max_y;
+};
+
+int frame_render(int W, int H) {
+    int grid_x = (W + TILE_SIZE - 1) / TILE_SIZE;
+    int grid_y = (H + TILE_SIZE - 1) / TILE_SIZE;
+    int num_gauss = W * H / TILE_PIXELS;
+
+    std::mt19937 gen(11);
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    std::vector<FrameGauss> scene(num_gauss);
+    for (int i = 0; i < num_gauss; i++) {
+        FrameGauss &f = scene[i];
+        f.depth = 1.0 + 99.0*u(gen);
+        f.mean_x = W*u(gen);
+        f.mean_y = H*u(gen);
+        // Sigma = R diag(s1^2, s2^2) R^T, conic = Sigma^-1
+        double s1 = 2.0 + 14.0*u(gen), s2 = 2.0 + 14.0*u(gen), th = M_PI*u(gen);
+        double c = cos(th), s = sin(th);
+        double a = c*c*s1*s1 + s*s*s2*s2, b = c*s*(s1*s1 - s2*s2), d = s*s*s1*s1 + c*c*s2*s2;
+        double det = a*d - b*b;
+        f.conx = d/det;
+        f.cony = -b/det;
+        f.conz = a/det;
+        f.r = u(gen);
+        f.g = u(gen);
+        f.b = u(gen);
+        f.opacity = 0.2 + 0.79*u(gen);
+        double rad = 3.0*std::max(s1, s2);
+        f.tile_min_x = std::max(0, (int)floor((f.mean_x - rad) / TILE_SIZE));
+        f.tile_max_x = std::min(grid_x, (int)floor((f.mean_x + rad) / TILE_SIZE) + 1);
+        f.tile_min_y = std::max(0, (int)floor((f.mean_y - rad) / TILE_SIZE));
+        f.tile_max_y = std::min(grid_y, (int)floor((f.mean_y + rad) / TILE_SIZE) + 1);
+    }
+    std::sort(scene.begin(), scene.end(),
+              [](const FrameGauss &a, const FrameGauss &b) { return a.depth < b.depth; });
+
+    std::vector<std::vector<int> > bins(grid_x * grid_y);
+    for (int i = 0; i < num_gauss; i++) {
+        for (int ty = scene[i].tile_min_y; ty < scene[i].tile_max_y; ty++)
+            for (int tx = scene[i].tile_min_x; tx < scene[i].tile_max_x; tx++)
+                bins[ty*grid_x + tx].push_back(i);
+    }
+
+    auto wall_start = std::chrono::steady_clock::now();
+    double sq_err = 0.0;
+    unsigned long cycles = 0, pairs = 0;
+    std::vector<GSCORE_GAUSS_TYPE> list;
+    RGB_TYPE pixels[TILE_PIXELS];
+    for (int ty = 0; ty < grid_y; ty++) {
+        for (int tx = 0; tx < grid_x; tx++) {
+            const std::vector<int> &bin = bins[ty*grid_x + tx];
+            double ox = tx * TILE_SIZE, oy = ty * TILE_SIZE;
+            list.resize(bin.size());
+            for (size_t k = 0; k < bin.size(); k++) {
+                const FrameGauss &f = scene[bin[k]];
+                list[k].gid = bin[k];
+                list[k].depth = FP16_TYPE(f.depth);
+                list[k].mean_x = FP16_TYPE(f.mean_x - ox);
+                list[k].mean_y = FP16_TYPE(f.mean_y - oy);
+                list[k].conx = FP16_TYPE(f.conx);
+                list[k].cony = FP16_TYPE(f.cony);
+                list[k].conz = FP16_TYPE(f.conz);
+                list[k].color.r = FP16_TYPE(f.r);
+                list[k].color.g = FP16_TYPE(f.g);
+                list[k].color.b = FP16_TYPE(f.b);
+                list[k].opacity = FP16_TYPE(f.opacity);
+#ifdef USE_SUBTILE_BITMAP
+                list[k].bitmap = 0xFF;
+#endif
+            }
+            cycles += VRU_RenderTile(list.data(), bin.size(), pixels);
+            pairs += TILE_PIXELS * std::max<size_t>(bin.size(), 1);
+
+            for (int p = 0; p < TILE_PIXELS; p++) {
+                int x = tx*TILE_SIZE + p % TILE_SIZE, y = ty*TILE_SIZE + p / TILE_SIZE;
+                if (x >= W || y >= H) continue;
+                // Double-precision reference of the same blending
+                double T = 1.0, ref[3] = {0.0, 0.0, 0.0};
+                for (size_t k = 0; k < bin.size() && T >= ET_THRESHOLD; k++) {
+                    const FrameGauss &f = scene[bin[k]];
+                    double dx = (p % TILE_SIZE) - (f.mean_x - ox), dy = (p / TILE_SIZE) - (f.mean_y - oy);
+                    double alpha = f.opacity * exp(-0.5 * (dx*(f.conx*dx + f.cony*dy) + dy*(f.cony*dx + f.conz*dy)));
+                    if (alpha < 1.0/255.0) continue;
+                    ref[0] += T*alpha*f.r;
+                    ref[1] += T*alpha*f.g;
+                    ref[2] += T*alpha*f.b;
+                    T *= (1.0 - alpha);
+                }
+                double hw[3] = {pixels[p].r.to_double(), pixels[p].g.to_double(), pixels[p].b.to_double()};
+                for (int c = 0; c < 3; c++) {
+                    double e = std::min(1.0, std::max(0.0, hw[c])) - std::min(1.0, std::max(0.0, ref[c]));
+                    sq_err += e*e;
+                }
+            }
+        }
+    }
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    double mse = sq_err / (3.0 * W * H);
+    double psnr = (mse > 0) ? 10.0 * log10(1.0 / mse) : 99.0;
+
+    cout << "=== Untimed VRU frame render " << W << "x" << H << " ===" << endl;
+    cout << "Gaussians = " << num_gauss << " | tiles = " << grid_x * grid_y
+         << " | pixel-Gaussian pairs = " << pairs << endl;
+    cout << "Estimated cycles = " << cycles << " (" << GSCORE_NUM_VRU << " VRUs x NUM_ROTATE = " << NUM_ROTATE
+         << ", tiles back to back)" << endl;
+    cout << "Wall time = " << std::setprecision(3) << wall << " s | PSNR vs double = "
+         << std::setprecision(4) << psnr << " dB";
+    cout << (psnr >= 35.0 ? " ✓" : " ✗ (MISMATCH)") << endl;
+    return 0;
+}
+
+/*
+ * exp implementations (./sim_VRU exp): error of every VRU_EXP_IMPL / VRU_EXP_SEGMENTS choice of nrsim_exp.h over
+ * the alpha operating range, exponent in [ln(1/255), 0] (below it alpha < 1/255 is pruned), FP16 in and out as in
+ * VRU_Alpha. HLS latency / II of a choice: cycle.rpt of the printed make hls (S0_scripts/exp_sweep.sh runs them all).
+ */
+#define EXP_SWEEP_POINTS 4096
+#define EXP_MAX_ERR (1.0/255.0)  // the configured choice has to resolve alpha to 8 bits
+
+template <class EXP>
+bool exp_error(const char *name, int impl, int segments) {
+    double max_err = 0.0, sum_err = 0.0, max_at = 0.0;
+    for (int i = 0; i <= EXP_SWEEP_POINTS; i++) {
+        FP16_TYPE x = FP16_TYPE(log(1.0/255.0) * i / EXP_SWEEP_POINTS);
+        FP16_TYPE y;
+        EXP::exp(x, y);
+        double err = fabs(y.to_double() - exp(x.to_double()));
+        sum_err += err;
+        if (err > max_err) {
+            max_err = err;
+            max_at = x.to_double();
+        }
+    }
+    bool configured = (impl == VRU_EXP_IMPL && (impl < NRSIM_EXP_PWL || segments == VRU_EXP_SEGMENTS));
+    cout << std::left << std::setw(10) << name << std::right << std::setw(4) << segments
+         << " | max err " << std::scientific << std::setprecision(3) << max_err << " (x = " << std::fixed
+         << std::setprecision(3) << max_at << ") | mean err " << std::scientific << sum_err / (EXP_SWEEP_POINTS + 1)
+         << std::fixed << " | make hls PROJ_PATH=GSCore/VRU HLS_BUILD_NAME=build_hls_exp" << impl << "_" << segments
+         << " HLS_DEFINES=\"-DVRU_EXP_IMPL=" << impl << " -DVRU_EXP_SEGMENTS=" << segments << "\"";
+    if (configured) cout << (max_err <= EXP_MAX_ERR ? "  <- configured ✓" : "  <- configured ✗ (MISMATCH)");
+    cout << endl;
+    return !configured || max_err <= EXP_MAX_ERR;
+}
+
+int exp_report() {
+    cout << "=== VRU exp implementations, exponent in [ln(1/255), 0], " << EXP_SWEEP_POINTS + 1 << " FP16 points ===" << endl;
+    bool ok = true;
+    ok &= exp_error<nrsim::ExpAcPwl>("ac_pwl", NRSIM_EXP_AC_PWL, 0);
+    ok &= exp_error<nrsim::ExpCordic>("cordic", NRSIM_EXP_CORDIC, 0);
+    ok &= exp_error<nrsim::ExpPwl<4> >("pwl", NRSIM_EXP_PWL, 4);
+    ok &= exp_error<nrsim::ExpPwl<8> >("pwl", NRSIM_EXP_PWL, 8);
+    ok &= exp_error<nrsim::ExpPwl<16> >("pwl", NRSIM_EXP_PWL, 16);
+    ok &= exp_error<nrsim::ExpPwl<32> >("pwl", NRSIM_EXP_PWL, 32);
+    ok &= exp_error<nrsim::ExpLut<16> >("lut", NRSIM_EXP_LUT, 16);
+    ok &= exp_error<nrsim::ExpLut<32> >("lut", NRSIM_EXP_LUT, 32);
+    ok &= exp_error<nrsim::ExpLut<64> >("lut", NRSIM_EXP_LUT, 64);
+    return ok ? 0 : 1;
+}
+
+/*
+ * Trace-driven run (./sim_VRU trace <scene.gstr> [colors.gsco]): every tile of the trace rendered by
+ * one VRU, NUM_ROTATE pixels interleaved; like GSCore::Render, pixels reported on VRUTerminate only
+ * get their closing Gaussian. Colors are checked bit-exact against VRU_untimed, against the float blend of
+ * nrsim_reference.h (same FP16 inputs, within VRU_REF_ABS_TOL + VRU_REF_REL_TOL * |ref|) and optionally written out.
+ * The latency of a pixel runs from its first Gaussian entering the VRU to the output tagged with it, reported as
+ * p50 / p95 / p99 over all pixels and the p99 of every tile (common/include/nrsim_latency.h).
+ */
+#ifndef VRU_REF_ABS_TOL
+#define VRU_REF_ABS_TOL 0.03   // changeable, FP16 datapath (PWL exp, FP16 accumulation) vs float reference
+#endif
+#ifndef VRU_REF_REL_TOL
+#define VRU_REF_REL_TOL 0.03   // changeable
+#endif
+class trace_bench : public sc_module {
+public:
+    sc_clock clk;
+    sc_signal<bool> rst;
+
+    Connections::Combinational<VRU_IN_TYPE> VRUInput;
+    Connections::Combinational<VRU_OUT_TYPE> VRUOutput;
+    Connections::Combinational<VRU_TERM_TYPE> VRUTerminate;
+
+    VRU<NUM_ROTATE> dut;
+    VRU_untimed<NUM_ROTATE> model;
+
+    GSTraceReader trace;
+    GSColorWriter colors;
+    bool write_colors;
+    std::deque<GSTraceTile> tiles_in_flight;    // run() -> collect()
+    std::deque<std::vector<float> > ref_in_flight;  // float reference colors of the tile, planar RGB
+    bool feed_done;
+    nrsim::LatencyHistogram latency;            // pixel id: tile * TILE_PIXELS + pixel of the tile
+
+    // Feeder state and statistics
+    bool pixel_done[NUM_ROTATE];
+    ET_TAG_TYPE pixel_tag[NUM_ROTATE];
+    unsigned long pairs_sent, et_skipped_pairs, feed_stall_cycles;
+
+    SC_HAS_PROCESS(trace_bench);
+    trace_bench(sc_module_name name, const char *path, const char *out) : sc_module(name),
+                                                       clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
+                                                       rst("rst"),
+                                                       VRUInput("VRUInput"),
+                                                       VRUOutput("VRUOutput"),
+                                                       VRUTerminate("VRUTerminate"),
+                                                       dut("dut"),
+                                                       write_colors(out != NULL),
+                                                       feed_done(false),
+                                                       latency("VRU", "pixel"),
+                                                       pairs_sent(0), et_skipped_pairs(0), feed_stall_cycles(0) {
+        sc_object_tracer<sc_clock> trace_clk(clk);
+
+        dut.clk(clk);
+        dut.rst(rst);
+        dut.VRUInput(VRUInput);
+        dut.VRUOutput(VRUOutput);
+        dut.VRUTerminate(VRUTerminate);
+
+        if (!trace.Open(path)) exit(1);
+        if (write_colors && !colors.Open(out, trace.Header())) exit(1);
+
+        SC_THREAD(reset);
+        sensitive << clk.posedge_event();
+
+        SC_THREAD(run);
+        sensitive << clk.posedge_event();
+        async_reset_signal_is(rst, false);
+
+        SC_THREAD(collect);
+        sensitive << clk.posedge_event();
+        async_reset_signal_is(rst, false);
+    }
+
+    void reset() {
+        rst.write(false);
+        wait(10);
+        rst.write(true);
+    }
+
+    void poll_terminate() {
+        VRU_TERM_TYPE term;
+        if (VRUTerminate.PopNB(term) && term.tag == pixel_tag[term.rotate_idx.to_int()]) {
+            pixel_done[term.rotate_idx.to_int()] = true;
+        }
+    }
+
+    void run() {
+        VRUInput.ResetWrite();
+        VRUTerminate.ResetRead();
+        for (int r = 0; r < NUM_ROTATE; r++) {
+            pixel_done[r] = false;
+            pixel_tag[r] = 0;
+        }
+        wait(10);
+
+        float px[TILE_PIXELS], py[TILE_PIXELS];
+        for (int p = 0; p < TILE_PIXELS; p++) {
+            px[p] = float(p % TILE_SIZE);
+            py[p] = float(p / TILE_SIZE);
+        }
+        std::vector<float> soa;
+        float scratch[2 * TILE_PIXELS];
+
+        GSTraceTile tile;
+        const GSTraceGauss *gauss;
+        uint64_t tile_idx = 0;
+        while (trace.NextTile(tile, gauss)) {
+            NRSIM_TRACE_EVENT(tile);    // NRSIM_TRACE_TRIGGER=tile:37,last_gaussian traces from tile 37 on
+            tiles_in_flight.push_back(tile);
+            int num = tile.num_gaussians;
+
+            // Reference of the whole tile from the FP16 Gaussians the VRU gets
+            soa.resize(9 * num);
+            for (int g = 0; g < num; g++) {
+                GSCORE_GAUSS_TYPE gs = GSTraceReader::ToGauss(gauss[g], tile);
+                soa[0*num + g] = gs.mean_x.to_float();
+                soa[1*num + g] = gs.mean_y.to_float();
+                soa[2*num + g] = gs.conx.to_float();
+                soa[3*num + g] = gs.cony.to_float();
+                soa[4*num + g] = gs.conz.to_float();
+                soa[5*num + g] = gs.color.r.to_float();
+                soa[6*num + g] = gs.color.g.to_float();
+                soa[7*num + g] = gs.color.b.to_float();
+                soa[8*num + g] = gs.opacity.to_float();
+            }
+            const float *f = soa.data();
+            nrsim::ref::Splats splats = {num, f, f + num, f + 2*num, f + 3*num, f + 4*num,
+                                         f + 5*num, f + 6*num, f + 7*num, f + 8*num};
+            std::vector<float> ref(3 * TILE_PIXELS);
+            nrsim::ref::BlendTile(TILE_PIXELS, px, py, splats, 1.0f/255.0f, ET_THRESHOLD, ref.data(), NULL, scratch);
+            ref_in_flight.push_back(ref);
+
+            int n = (num == 0) ? 1 : num;   // an empty tile is closed out with a transparent Gaussian
+            for (int base = 0; base < TILE_PIXELS; base += NUM_ROTATE) {
+                for (int g = 0; g < n; g++) {
+                    bool all_done = true;
+                    for (int r = 0; r < NUM_ROTATE; r++) all_done = all_done && pixel_done[r];
+                    if (all_done && g < n-1) {
+                        et_skipped_pairs += (n-1-g) * NUM_ROTATE;
+                        g = n-1;
+                    }
+
+                    GSCORE_GAUSS_TYPE gs;
+                    if (num == 0) {
+                        GSTraceGauss empty;
+                        memset(&empty, 0, sizeof(empty));
+                        gs = GSTraceReader::ToGauss(empty, tile);
+                        gs.mean_x = FP16_TYPE(0.0);
+                        gs.mean_y = FP16_TYPE(0.0);
+                    } else {
+                        gs = GSTraceReader::ToGauss(gauss[g], tile);
+                    }
+                    for (int r = 0; r < NUM_ROTATE; r++) {
+                        bool last = (g == n-1);
+                        if (pixel_done[r] && !last) {
+                            et_skipped_pairs++;
+                            continue;
+                        }
+                        int p = base + r;
+                        VRU_IN_TYPE in;
+                        in.pixel_pos_x = FP16_TYPE(double(p % TILE_SIZE));
+                        in.pixel_pos_y = FP16_TYPE(double(p / TILE_SIZE));
+                        in.mean_x = gs.mean_x;
+                        in.mean_y = gs.mean_y;
+                        in.conx = gs.conx;
+                        in.cony = gs.cony;
+                        in.conz = gs.conz;
+                        in.color = gs.color;
+                        in.opacity = gs.opacity;
+                        in.last_gaussian = last;
+                        in.rotate_idx = r;
+#ifdef USE_SUBTILE_BITMAP
+                        in.bitmap = gs.bitmap;
+                        in.subtile_idx = ((p / TILE_SIZE) / SUBTILE_SIZE) * (TILE_SIZE / SUBTILE_SIZE)
+                                       + (p % TILE_SIZE) / SUBTILE_SIZE;
+#endif
+                        while (!VRUInput.PushNB(in)) {
+                            feed_stall_cycles++;
+                            poll_terminate();
+                            wait();
+                        }
+                        model.Push(in);
+                        if (g == 0) latency.In(tile_idx * TILE_PIXELS + p, sc_time_stamp() / sc_time(1, SC_NS));
+                        pairs_sent++;
+                        poll_terminate();
+                        wait();
+                        if (last) {
+                            pixel_done[r] = false;
+                            pixel_tag[r]++;
+                        }
+                    }
+                }
+            }
+            tile_idx++;
+        }
+        feed_done = true;
+    }
+
+    void collect() {
+        VRUOutput.ResetRead();
+        wait(10);
+
+        sc_time start = sc_time_stamp(), first_out;
+        unsigned long tiles = 0, mismatches = 0, ref_errors = 0, tag_errors = 0;
+        double ref_max_err = 0.0;
+        RGB_TYPE pixels[TILE_PIXELS];
+        float hw[3 * TILE_PIXELS];
+        while (!(feed_done && tiles_in_flight.empty())) {
+            if (tiles_in_flight.empty()) {
+                wait();
+                continue;
+            }
+            for (int p = 0; p < TILE_PIXELS; p++) {
+                VRU_OUT_TYPE o = VRUOutput.Pop();
+                if (tiles == 0 && p == 0) first_out = sc_time_stamp();
+                if (o.pixel.to_int() != p) tag_errors++;
+                latency.Out(uint64_t(tiles) * TILE_PIXELS + o.pixel.to_int(), sc_time_stamp() / sc_time(1, SC_NS), tiles);
+                VRU_OUT_TYPE ref;
+                if (!model.PopNB(ref) || ref.color.r.data() != o.color.r.data()
+                                      || ref.color.g.data() != o.color.g.data()
+                                      || ref.color.b.data() != o.color.b.data()) {
+                    mismatches++;
+                }
+                pixels[p] = o.color;
+                hw[p] = o.color.r.to_float();
+                hw[TILE_PIXELS + p] = o.color.g.to_float();
+                hw[2*TILE_PIXELS + p] = o.color.b.to_float();
+            }
+            nrsim::ref::CompareResult r = nrsim::ref::Compare(hw, ref_in_flight.front().data(), 3 * TILE_PIXELS,
+                                                              VRU_REF_ABS_TOL, VRU_REF_REL_TOL);
+            ref_errors += r.errors;
+            ref_max_err = std::max(ref_max_err, r.max_err);
+            if (write_colors) colors.WriteTile(tiles_in_flight.front(), pixels);
+            tiles_in_flight.pop_front();
+            ref_in_flight.pop_front();
+            tiles++;
+        }
+        if (write_colors) colors.Close();
+
+        double cycles = (sc_time_stamp() - start).to_seconds()*1e9;
+        const GSTraceHeader &h = trace.Header();
+        cout << "=== VRU trace: " << h.width << "x" << h.height << ", " << tiles << " tiles, "
+             << h.num_pairs << " tile-Gaussian pairs, NUM_ROTATE = " << NUM_ROTATE << " ===" << endl;
+        cout << "Cycles = " << cycles << " | cycles/tile = " << (tiles ? cycles / tiles : 0.0)
+             << " | pixel-Gaussian pairs sent = " << pairs_sent
+             << " | pairs/cycle = " << (cycles > 0 ? pairs_sent / cycles : 0.0) << endl;
+        cout << "Feeder stall cycles = " << feed_stall_cycles
+             << " | RMW hazard stall cycles = " << dut.hazard_stall_cycles << endl;
+        cout << "Early termination: " << et_skipped_pairs << " pairs not sent, "
+             << dut.et_saved_step1 << " dropped in step1, " << dut.et_saved_step2 << " in step2" << endl;
+        cout << "Untimed model: " << tiles * TILE_PIXELS - mismatches << " of " << tiles * TILE_PIXELS
+             << " pixels bit-exact" << (mismatches == 0 ? " ✓" : " ✗ (MISMATCH)") << endl;
+        cout << "Float reference: " << tiles * TILE_PIXELS * 3 - ref_errors << " of " << tiles * TILE_PIXELS * 3
+             << " color channels within tolerance, max error " << ref_max_err
+             << (ref_errors == 0 ? " ✓" : " ✗ (MISMATCH)") << endl;
+        cout << "Pixel tags: " << tiles * TILE_PIXELS - tag_errors << " of " << tiles * TILE_PIXELS
+             << " outputs tagged with their pixel" << (tag_errors == 0 ? " ✓" : " ✗ (MISMATCH)") << endl;
+        latency.Print();
+        latency.Write();
+        nrsim::TimingReport timing("VRU");
+        timing.Op("blend", "pixel-Gaussian pair", pairs_sent, cycles, (first_out - start).to_seconds()*1e9);
+        timing.Value("gauss_hits_per_pixel", tiles ? double(pairs_sent) / (tiles * TILE_PIXELS) : 0.0);
+        timing.Value("num_rotate", NUM_ROTATE);
+        timing.Write();
         sc_stop();
     }
 };
 
 int sc_main(int argc, char *argv[]) {
+    if (argc > 2 && std::string(argv[1]) == "trace") {
+        trace_bench tb("tb", argv[2], (argc > 3) ? argv[3] : NULL);
+        sc_start();
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "frame") {
+        int W = (argc > 3) ? atoi(argv[2]) : 800;
+        int H = (argc > 3) ? atoi(argv[3]) : 800;
+        return frame_render(W, H);
+    }
+    if (argc > 1 && std::string(argv[1]) == "exp") {
+        return exp_report();
+    }
+    if (argc > 1 && std::string(argv[1]) == "sweep") {
+        sweep_top sweep("sweep");
+        sc_start();
+        return 0;
+    }
     testbench tb("tb");
     sc_start();
     return 0;
@@ -14,19 +14,34 @@
 
 // Helpers from https://github.com/hlslibs/matchlib_toolkit/blob/main/include/auto_gen_fields.h#L425
 // Slightly modify for marshall, width only
-#include "auto_gen_fields.h"
+#include "../../common/include/auto_gen_fields.h"
+
+// Channel / thread stall instrumentation, JSON summary at the end of the simulation (C model only)
+// #define NRSIM_INSTRUMENT
+#include "../../common/include/nrsim_instrument.h"
 
 /*** BSU Constants ***/
-#define SORT_NUM 16
+#ifndef SORT_NUM
+#define SORT_NUM 16        // changeable, BSU sorting width (power of two)
+#endif
+// The bitonic network has log2(SORT_NUM)*(log2(SORT_NUM)+1)/2 compare-exchange stages of SORT_NUM/2 comparators,
+// BSU_STAGES_PER_REG of them between two pipeline registers (1: a register after every stage, all: one stage
+// for the whole network). Fewer registers cost a longer path per cycle, a new array is accepted every cycle either way
+#ifndef BSU_STAGES_PER_REG
+#define BSU_STAGES_PER_REG 1   // changeable
+#endif
 /*** BSU Types ***/
 //                  16-bit, 8-bit precision
 typedef ac_std_float<16, 5> BSU_DATA_TYPE;
+typedef ac_int<16, false> BSU_VALUE_TYPE;  // payload moved along with the key (Gaussian slot / GID)
 typedef ac_int<nvhls::log2_ceil<SORT_NUM>::val, false> log_bsu_num;
 
+// SORT_NUM (key, value) pairs, sorted by key
 class BSU_IN_OUT_TYPE : public nvhls_message {
 public:
     BSU_DATA_TYPE x[SORT_NUM];
-    AUTO_GEN_FIELD_METHODS((x))
+    BSU_VALUE_TYPE v[SORT_NUM];
+    AUTO_GEN_FIELD_METHODS((x,v))
 };
 
 /*** QSU Constants ***/
@@ -46,6 +61,14 @@ public:
     AUTO_GEN_FIELD_METHODS((depth,gid))
 };
 
+// Pivot configuration for QSU, ascending (loaded per tile while the QSU is idle)
+class QSU_PIVOT_TYPE : public nvhls_message {
+public:
+    FP16_TYPE pivots[NUM_PIVOTS];
+
+    AUTO_GEN_FIELD_METHODS((pivots))
+};
+
 // Output type for QSU: GID and subset index
 class QSU_OUT_TYPE : public nvhls_message {
 public:
@@ -55,9 +78,35 @@ public:
     AUTO_GEN_FIELD_METHODS((gid,subset))
 };
 
+/*** BMU Types ***/
+// Number of SORT_NUM blocks in the two sorted runs merged by BMU
+class BMU_CFG_TYPE : public nvhls_message {
+public:
+    UINT16_TYPE len_a;
+    UINT16_TYPE len_b;
+
+    AUTO_GEN_FIELD_METHODS((len_a,len_b))
+};
+
 /*** VRU Types ***/
-#define NUM_ROTATE 4
-typedef ac_int<nvhls::log2_ceil<NUM_ROTATE>::val, false> ROTATE_INDEX_TYPE; // 2-bit unsigned int for rotate index
+// #define USE_SUBTILE_BITMAP // skip (pixel, Gaussian) pairs whose subtile the Gaussian does not touch
+#ifndef NUM_ROTATE
+#define NUM_ROTATE 4       // changeable, default VRU<ROTATE> interleaving depth (<= MAX_NUM_ROTATE)
+#endif
+#define MAX_NUM_ROTATE 16  // widest rotate index carried in the VRU messages
+#define VRU_RMW_LATENCY 4  // cycles before a rotate slot can be updated again (transmittance/color RMW)
+// exp of the alpha computation (common/include/nrsim_exp.h), e.g. HLS_DEFINES="-DVRU_EXP_IMPL=NRSIM_EXP_LUT -DVRU_EXP_SEGMENTS=32"
+#ifndef VRU_EXP_IMPL
+#define VRU_EXP_IMPL NRSIM_EXP_AC_PWL  // changeable, NRSIM_EXP_AC_PWL / NRSIM_EXP_CORDIC / NRSIM_EXP_PWL / NRSIM_EXP_LUT
+#endif
+#ifndef VRU_EXP_SEGMENTS
+#define VRU_EXP_SEGMENTS 16            // changeable, segments of NRSIM_EXP_PWL (4..32) / entries of NRSIM_EXP_LUT (16..64)
+#endif
+#define SUBTILE_SIZE 8     // 16x16 tile -> 4 subtiles of 8x8 (at most 8 subtiles fit the bitmap)
+typedef ac_int<8, false> UINT8_TYPE;       // 8-bit unsigned int for subtile bitmap / index
+typedef ac_int<8, false> PIXEL_ID_TYPE;    // pixel of the 16x16 tile, y * TILE_SIZE + x
+// Rotate index in messages (VRU<ROTATE> uses its own index_width<ROTATE> type internally)
+typedef ac_int<nvhls::index_width<MAX_NUM_ROTATE>::val, false> ROTATE_INDEX_TYPE;
 // RGB color type
 class RGB_TYPE : public nvhls_message{
 public:
@@ -88,26 +137,190 @@ public:
     RGB_TYPE color;
     FP16_TYPE opacity;
     
+#ifdef USE_SUBTILE_BITMAP
     // Bitmap for subtile skipping
-    // UINT8_TYPE bitmap;
-    // UINT8_TYPE subtile_idx;
+    UINT8_TYPE bitmap;      // bit i set: Gaussian touches subtile i
+    UINT8_TYPE subtile_idx; // subtile of this pixel
+#endif
     
     // Flag to indicate last Gaussian for this pixel
     bool last_gaussian;
 
     ROTATE_INDEX_TYPE rotate_idx;
 
+#ifdef USE_SUBTILE_BITMAP
+    AUTO_GEN_FIELD_METHODS((pixel_pos_x,pixel_pos_y,mean_x,mean_y,
+                           conx,cony,conz,
+                           color,opacity,bitmap,subtile_idx,last_gaussian,rotate_idx))
+#else
     AUTO_GEN_FIELD_METHODS((pixel_pos_x,pixel_pos_y,mean_x,mean_y,
                            conx,cony,conz,
-                           color,opacity,/*(bitmap)(subtile_idx)*/last_gaussian,rotate_idx))
+                           color,opacity,last_gaussian,rotate_idx))
+#endif
+};
+
+// Early termination: transmittance threshold and per-pixel tag
+// Every pixel that closes in a rotate slot (last_gaussian) advances that slot's tag,
+// so stale feedback for an already finished pixel is ignored
+#define ET_THRESHOLD 0.0001
+typedef ac_int<4, false> ET_TAG_TYPE;
+
+// Feedback from VRU step2: pixel (rotate_idx, tag) is saturated, rest of its Gaussians can be dropped
+class VRU_TERM_TYPE : public nvhls_message{
+public:
+    ROTATE_INDEX_TYPE rotate_idx;
+    ET_TAG_TYPE tag;
+
+    AUTO_GEN_FIELD_METHODS((rotate_idx,tag))
 };
 
 // Output type for VRU
 class VRU_OUT_TYPE : public nvhls_message {
 public:
     RGB_TYPE color;
+    PIXEL_ID_TYPE pixel;    // pixel the color belongs to, from its pixel_pos
     
-    AUTO_GEN_FIELD_METHODS((color))
+    AUTO_GEN_FIELD_METHODS((color,pixel))
+};
+
+/*** GSCore Top Constants ***/
+#ifndef GSCORE_NUM_QSU
+#define GSCORE_NUM_QSU 4       // changeable
+#endif
+#ifndef GSCORE_NUM_BSU
+#define GSCORE_NUM_BSU 2       // changeable
+#endif
+#ifndef GSCORE_NUM_VRU
+#define GSCORE_NUM_VRU 16      // changeable, GSCORE_NUM_VRU*NUM_ROTATE must divide TILE_PIXELS
+#endif
+#define TILE_SIZE 16           // tile is TILE_SIZE x TILE_SIZE pixels
+#define TILE_PIXELS (TILE_SIZE*TILE_SIZE)
+// Pixels of a tile -> VRUs
+#define GSCORE_DISPATCH_STATIC 0   // pixel p -> VRU p % GSCORE_NUM_VRU, all VRUs step through the Gaussians together
+#define GSCORE_DISPATCH_DYNAMIC 1  // groups of NUM_ROTATE pixels handed to whichever VRU is idle
+#ifndef GSCORE_VRU_DISPATCH
+#define GSCORE_VRU_DISPATCH GSCORE_DISPATCH_STATIC  // changeable
+#endif
+#define GSCORE_PIXEL_GROUPS (TILE_PIXELS/NUM_ROTATE)
+#ifndef MAX_TILE_GAUSS
+#define MAX_TILE_GAUSS 1024    // changeable, depth of the per-tile Gaussian buffer
+#endif
+#define MAX_TILE_CHUNKS (MAX_TILE_GAUSS/SORT_NUM + NUM_SUBSETS) // SORT_NUM-sized chunks per tile
+#define QSU_FIFO_DEPTH 16
+#define BSU_FIFO_DEPTH 16
+#define VRU_FIFO_DEPTH 16
+#ifndef QSU_HIST_BINS
+#define QSU_HIST_BINS 32       // changeable, depth histogram bins for adaptive pivots
+#endif
+
+/*** GSCore Top Types ***/
+// Tile header, sent once before the Gaussians of a tile
+class GSCORE_TILE_TYPE : public nvhls_message {
+public:
+    UINT16_TYPE tile_x;
+    UINT16_TYPE tile_y;
+    UINT16_TYPE num_gaussians; // <= MAX_TILE_GAUSS
+    // false: QSU pivots of the tile are read from PivotInput
+    // true:  equal-population pivots are derived from a depth histogram of the tile
+    bool adaptive_pivots;
+
+    AUTO_GEN_FIELD_METHODS((tile_x,tile_y,num_gaussians,adaptive_pivots))
+};
+
+// One projected Gaussian of a tile (output of culling & conversion)
+class GSCORE_GAUSS_TYPE : public nvhls_message {
+public:
+    UINT16_TYPE gid;
+    FP16_TYPE depth;
+
+    // 2D mean relative to the tile origin (keeps FP16 precision for large frames)
+    FP16_TYPE mean_x;
+    FP16_TYPE mean_y;
+
+    // Inverse 2D covariance
+    FP16_TYPE conx;
+    FP16_TYPE cony;
+    FP16_TYPE conz;
+
+    RGB_TYPE color;
+    FP16_TYPE opacity;
+
+#ifdef USE_SUBTILE_BITMAP
+    UINT8_TYPE bitmap;     // subtiles touched by the Gaussian
+    AUTO_GEN_FIELD_METHODS((gid,depth,mean_x,mean_y,conx,cony,conz,color,opacity,bitmap))
+#else
+    AUTO_GEN_FIELD_METHODS((gid,depth,mean_x,mean_y,conx,cony,conz,color,opacity))
+#endif
+};
+
+typedef ac_int<nvhls::index_width<GSCORE_NUM_VRU>::val, false> VRU_INDEX_TYPE;
+
+// Render -> Collect (GSCORE_DISPATCH_DYNAMIC): the next pixel group of the tile went to VRU vru
+class GSCORE_GROUP_TYPE : public nvhls_message {
+public:
+    VRU_INDEX_TYPE vru;
+    bool last;                 // last group of the tile
+
+    AUTO_GEN_FIELD_METHODS((vru,last))
+};
+
+/*** CCU Constants ***/
+#define SH_DEGREE 1            // changeable, 0..2
+#define SH_COEFFS ((SH_DEGREE+1)*(SH_DEGREE+1))
+#define CCU_NEAR_PLANE 0.2     // Gaussians closer than this (view space z) are culled
+#define CCU_FRUSTUM_GUARD 1.3  // cull |x/z| > GUARD * tan(fov/2), same guard band as 3DGS
+#define CCU_LOW_PASS 0.3       // added to the 2D covariance diagonal (anti-aliasing)
+
+/*** CCU Types ***/
+typedef ac_std_float<32, 8> FP32_TYPE;     // projection math, screen-space positions
+
+// Camera, sent once per frame
+class CCU_CAM_TYPE : public nvhls_message {
+public:
+    FP32_TYPE view[12];        // world -> camera, row-major 3x4 [R | t]
+    FP32_TYPE cam_pos[3];      // camera center in world space (SH view direction)
+    FP32_TYPE fx;
+    FP32_TYPE fy;
+    FP32_TYPE cx;
+    FP32_TYPE cy;
+    UINT16_TYPE grid_x;        // frame size in tiles
+    UINT16_TYPE grid_y;
+
+    AUTO_GEN_FIELD_METHODS((view,cam_pos,fx,fy,cx,cy,grid_x,grid_y))
+};
+
+// 3D Gaussian as stored in the scene
+class CCU_IN_TYPE : public nvhls_message {
+public:
+    UINT16_TYPE gid;
+    FP32_TYPE mean[3];
+    FP32_TYPE cov3d[6];        // upper triangle: xx, xy, xz, yy, yz, zz
+    FP16_TYPE sh[3*SH_COEFFS]; // SH coefficients, coefficient-major (k*3 + channel)
+    FP16_TYPE opacity;
+
+    AUTO_GEN_FIELD_METHODS((gid,mean,cov3d,sh,opacity))
+};
+
+// Projected 2D Gaussian (input of tile binning)
+class CCU_OUT_TYPE : public nvhls_message {
+public:
+    UINT16_TYPE gid;
+    FP16_TYPE depth;
+    FP32_TYPE mean_x;          // screen space, pixels
+    FP32_TYPE mean_y;
+    FP16_TYPE conx;            // inverse 2D covariance
+    FP16_TYPE cony;
+    FP16_TYPE conz;
+    RGB_TYPE color;
+    FP16_TYPE opacity;
+    UINT16_TYPE radius;        // 3-sigma radius, pixels
+    UINT16_TYPE tile_min_x;    // touched tiles [min, max)
+    UINT16_TYPE tile_min_y;
+    UINT16_TYPE tile_max_x;
+    UINT16_TYPE tile_max_y;
+
+    AUTO_GEN_FIELD_METHODS((gid,depth,mean_x,mean_y,conx,cony,conz,color,opacity,
+                           radius,tile_min_x,tile_min_y,tile_max_x,tile_max_y))
 };
 
 
@@ -0,0 +1,226 @@
+#ifndef GSCORE_TRACE_H
+#define GSCORE_TRACE_H
+
+/*
+ * Binary scene traces for the GSCore testbenches (written by trace/gs_trace.py)
+ *
+ * Trace file (.gstr), little endian:
+ *   GSTraceHeader
+ *   num_tiles x { GSTraceTile, num_gaussians x GSTraceGauss (front to back) }
+ * Color file (.gsco), one record per rendered tile:
+ *   GSTraceHeader (magic "GSCO", num_pairs unused)
+ *   { GSTraceTile, TILE_PIXELS x 3 float (RGB, raster order in the tile) }
+ *
+ * Testbench-only: not included by any synthesized block.
+ */
+
+#include "GSCOREPackDef.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define GSTRACE_VERSION 1
+
+struct GSTraceHeader {
+    char magic[4];              // "GSTR" (trace) or "GSCO" (colors)
+    uint32_t version;
+    uint32_t width;             // frame size in pixels
+    uint32_t height;
+    uint32_t tile_size;         // must match TILE_SIZE
+    uint32_t num_tiles;
+    uint64_t num_pairs;         // sum of num_gaussians over all tiles
+};
+
+struct GSTraceTile {
+    uint32_t tile_x;
+    uint32_t tile_y;
+    uint32_t num_gaussians;
+    uint32_t reserved;
+};
+
+// One projected Gaussian of a tile, screen-space pixel coordinates
+struct GSTraceGauss {
+    uint32_t gid;               // index in the scene, the order CCU emits Gaussians in
+    float depth;
+    float mean_x;
+    float mean_y;
+    float conx;
+    float cony;
+    float conz;
+    float r;
+    float g;
+    float b;
+    float opacity;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(GSTraceHeader) == 32, "GSTraceHeader layout");
+static_assert(sizeof(GSTraceTile) == 16, "GSTraceTile layout");
+static_assert(sizeof(GSTraceGauss) == 48, "GSTraceGauss layout");
+
+/*
+ * Memory-mapped trace reader, tiles are streamed in file order without copying
+ */
+class GSTraceReader {
+public:
+    GSTraceReader() : base(NULL), size(0), offset(0), tiles_read(0) {}
+    ~GSTraceReader() { Close(); }
+
+    bool Open(const char *path) {
+        Close();
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            std::cerr << "GSTraceReader: cannot open " << path << std::endl;
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(GSTraceHeader)) {
+            std::cerr << "GSTraceReader: " << path << " is not a trace" << std::endl;
+            close(fd);
+            return false;
+        }
+        size = st.st_size;
+        void *p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (p == MAP_FAILED) {
+            std::cerr << "GSTraceReader: mmap failed for " << path << std::endl;
+            size = 0;
+            return false;
+        }
+        base = static_cast<const char *>(p);
+        madvise(p, size, MADV_SEQUENTIAL);
+
+        const GSTraceHeader &h = Header();
+        if (memcmp(h.magic, "GSTR", 4) != 0 || h.version != GSTRACE_VERSION) {
+            std::cerr << "GSTraceReader: bad magic or version in " << path << std::endl;
+            Close();
+            return false;
+        }
+        if (h.tile_size != TILE_SIZE) {
+            std::cerr << "GSTraceReader: trace tile size " << h.tile_size
+                      << " != TILE_SIZE " << TILE_SIZE << std::endl;
+            Close();
+            return false;
+        }
+        Rewind();
+        return true;
+    }
+
+    void Close() {
+        if (base != NULL) munmap(const_cast<char *>(base), size);
+        base = NULL;
+        size = 0;
+    }
+
+    const GSTraceHeader &Header() const { return *reinterpret_cast<const GSTraceHeader *>(base); }
+
+    void Rewind() {
+        offset = sizeof(GSTraceHeader);
+        tiles_read = 0;
+    }
+
+    /*
+     * Output: next tile header and a pointer to its Gaussians (valid while the reader is open)
+     * Returns false at the end of the trace or on a truncated file
+     */
+    bool NextTile(GSTraceTile &tile, const GSTraceGauss *&gauss) {
+        if (base == NULL || tiles_read >= Header().num_tiles) return false;
+        if (offset + sizeof(GSTraceTile) > size) {
+            std::cerr << "GSTraceReader: truncated trace" << std::endl;
+            return false;
+        }
+        memcpy(&tile, base + offset, sizeof(GSTraceTile));
+        size_t bytes = (size_t)tile.num_gaussians * sizeof(GSTraceGauss);
+        if (offset + sizeof(GSTraceTile) + bytes > size) {
+            std::cerr << "GSTraceReader: truncated trace" << std::endl;
+            return false;
+        }
+        gauss = reinterpret_cast<const GSTraceGauss *>(base + offset + sizeof(GSTraceTile));
+        offset += sizeof(GSTraceTile) + bytes;
+        tiles_read++;
+        return true;
+    }
+
+    // Hardware format of a trace Gaussian: FP16, mean relative to the tile origin
+    static GSCORE_GAUSS_TYPE ToGauss(const GSTraceGauss &g, const GSTraceTile &tile) {
+        GSCORE_GAUSS_TYPE o;
+        o.gid = g.gid;
+        o.depth = FP16_TYPE(double(g.depth));
+        o.mean_x = FP16_TYPE(double(g.mean_x) - double(tile.tile_x * TILE_SIZE));
+        o.mean_y = FP16_TYPE(double(g.mean_y) - double(tile.tile_y * TILE_SIZE));
+        o.conx = FP16_TYPE(double(g.conx));
+        o.cony = FP16_TYPE(double(g.cony));
+        o.conz = FP16_TYPE(double(g.conz));
+        o.color.r = FP16_TYPE(double(g.r));
+        o.color.g = FP16_TYPE(double(g.g));
+        o.color.b = FP16_TYPE(double(g.b));
+        o.opacity = FP16_TYPE(double(g.opacity));
+#ifdef USE_SUBTILE_BITMAP
+        o.bitmap = 0xFF;        // the trace carries no bitmap, every subtile is touched
+#endif
+        return o;
+    }
+
+private:
+    const char *base;
+    size_t size;
+    size_t offset;
+    uint32_t tiles_read;
+};
+
+/*
+ * Writer of rendered tile colors, same tile headers as the input trace
+ */
+class GSColorWriter {
+public:
+    GSColorWriter() : fp(NULL), tiles(0) {}
+    ~GSColorWriter() { Close(); }
+
+    bool Open(const char *path, const GSTraceHeader &trace) {
+        fp = fopen(path, "wb");
+        if (fp == NULL) {
+            std::cerr << "GSColorWriter: cannot open " << path << std::endl;
+            return false;
+        }
+        header = trace;
+        memcpy(header.magic, "GSCO", 4);
+        header.num_tiles = 0;   // patched on Close
+        header.num_pairs = 0;
+        fwrite(&header, sizeof(header), 1, fp);
+        return true;
+    }
+
+    void WriteTile(const GSTraceTile &tile, const RGB_TYPE *pixels) {
+        if (fp == NULL) return;
+        fwrite(&tile, sizeof(tile), 1, fp);
+        float rgb[3*TILE_PIXELS];
+        for (int p = 0; p < TILE_PIXELS; p++) {
+            rgb[3*p + 0] = pixels[p].r.to_double();
+            rgb[3*p + 1] = pixels[p].g.to_double();
+            rgb[3*p + 2] = pixels[p].b.to_double();
+        }
+        fwrite(rgb, sizeof(rgb), 1, fp);
+        tiles++;
+    }
+
+    void Close() {
+        if (fp == NULL) return;
+        header.num_tiles = tiles;
+        fseek(fp, 0, SEEK_SET);
+        fwrite(&header, sizeof(header), 1, fp);
+        fclose(fp);
+        fp = NULL;
+    }
+
+private:
+    FILE *fp;
+    GSTraceHeader header;
+    uint32_t tiles;
+};
+
+#endif //GSCORE_TRACE_H
@@ -0,0 +1,404 @@
+"""
+Binary scene traces for the GSCore testbenches (format: include/GSCORETrace.h)
+
+  python gs_trace.py export --ply point_cloud.ply --cameras cameras.json --cam 0 -o lego.gstr
+  python gs_trace.py synth -o synth.gstr --width 800 --height 800 --gaussians 20000
+  python gs_trace.py stim capture.nrst --call 0 -o frame0.gstr
+  python gs_trace.py stats lego.gstr
+  python gs_trace.py compare hw.gsco ref.gsco
+  python gs_trace.py ppm hw.gsco hw.ppm
+
+export projects a trained 3DGS point cloud (the point_cloud.ply / cameras.json of the reference
+implementation) with the same EWA math as the CCU model, bins it into TILE_SIZE tiles and sorts
+every tile front to back. stim bins the Gaussians splatfacto itself projected in an instrumented ns-eval run
+(the gs_* tensors of Instrumentation/instrumentation/stimulus.py, one set per rendered frame). The testbenches
+read the result with GSTraceReader:
+
+  ./sim_VRU trace lego.gstr lego.gsco
+  ./sim_QSU trace lego.gstr
+  ./sim_BSU trace lego.gstr
+"""
+import argparse
+import json
+import struct
+import sys
+
+import numpy as np
+
+TILE_SIZE = 16
+VERSION = 1
+HEADER = struct.Struct("<4sIIIIIQ")
+TILE = struct.Struct("<IIII")
+GAUSS_DTYPE = np.dtype([("gid", "<u4"), ("depth", "<f4"), ("mean_x", "<f4"), ("mean_y", "<f4"),
+                        ("conx", "<f4"), ("cony", "<f4"), ("conz", "<f4"),
+                        ("r", "<f4"), ("g", "<f4"), ("b", "<f4"), ("opacity", "<f4"),
+                        ("reserved", "<u4")])
+assert GAUSS_DTYPE.itemsize == 48
+
+NEAR_PLANE = 0.2
+FRUSTUM_GUARD = 1.3
+LOW_PASS = 0.3
+
+STIM_HEADER = struct.Struct("<4sIII")        # common/include/nrsim_stimulus.h
+STIM_RECORD = struct.Struct("<32sI4IIQ")
+
+SH_C0 = 0.28209479177387814
+SH_C1 = 0.4886025119029199
+SH_C2 = [1.0925484305920792, -1.0925484305920792, 0.31539156525252005,
+         -1.0925484305920792, 0.5462742152960396]
+SH_C3 = [-0.5900435899266435, 2.890611442640554, -0.4570457994644658, 0.3731763325901154,
+         -0.4570457994644658, 1.445305721320277, -0.5900435899266435]
+
+
+# ───────────────────────────── trace I/O ─────────────────────────────
+
+def write_trace(path, width, height, tiles):
+    """tiles: list of (tile_x, tile_y, structured array of GAUSS_DTYPE, front to back)"""
+    pairs = sum(len(g) for _, _, g in tiles)
+    with open(path, "wb") as f:
+        f.write(HEADER.pack(b"GSTR", VERSION, width, height, TILE_SIZE, len(tiles), pairs))
+        for tx, ty, g in tiles:
+            f.write(TILE.pack(tx, ty, len(g), 0))
+            f.write(np.ascontiguousarray(g, dtype=GAUSS_DTYPE).tobytes())
+    print(f"{path}: {width}x{height}, {len(tiles)} tiles, {pairs} tile-Gaussian pairs")
+
+
+def read_trace(path):
+    """Yields the header dict, then (tile_x, tile_y, Gaussians) per tile (memory-mapped)"""
+    buf = np.memmap(path, dtype=np.uint8, mode="r")
+    magic, version, width, height, tile_size, num_tiles, pairs = HEADER.unpack_from(buf, 0)
+    if magic not in (b"GSTR", b"GSCO") or version != VERSION:
+        sys.exit(f"{path}: bad magic or version")
+    yield dict(magic=magic, width=width, height=height, tile_size=tile_size,
+               num_tiles=num_tiles, pairs=pairs)
+    off = HEADER.size
+    for _ in range(num_tiles):
+        tx, ty, n, _ = TILE.unpack_from(buf, off)
+        off += TILE.size
+        if magic == b"GSTR":
+            g = np.frombuffer(buf, dtype=GAUSS_DTYPE, count=n, offset=off)
+            off += n * GAUSS_DTYPE.itemsize
+        else:
+            g = np.frombuffer(buf, dtype="<f4", count=tile_size * tile_size * 3, offset=off)
+            g = g.reshape(tile_size, tile_size, 3)
+            off += g.nbytes
+        yield tx, ty, g
+
+
+def read_colors(path):
+    it = read_trace(path)
+    h = next(it)
+    img = np.zeros((h["height"], h["width"], 3), dtype=np.float64)
+    for tx, ty, rgb in it:
+        y0, x0 = ty * TILE_SIZE, tx * TILE_SIZE
+        hh = min(TILE_SIZE, h["height"] - y0)
+        ww = min(TILE_SIZE, h["width"] - x0)
+        img[y0:y0 + hh, x0:x0 + ww] = rgb[:hh, :ww]
+    return img
+
+
+def read_stimulus(path):
+    """{(name, call): float32 array} of an .nrst stimulus file"""
+    buf = np.memmap(path, dtype=np.uint8, mode="r")
+    magic, version, _, _ = STIM_HEADER.unpack_from(buf, 0)
+    if magic != b"NRST" or version != 1:
+        sys.exit(f"{path}: bad magic or version")
+    tensors, off = {}, STIM_HEADER.size
+    while off + STIM_RECORD.size <= len(buf):
+        name, ndim, d0, d1, d2, d3, call, count = STIM_RECORD.unpack_from(buf, off)
+        off += STIM_RECORD.size
+        if off + 4 * count > len(buf):
+            break
+        a = np.frombuffer(buf, dtype="<f4", count=count, offset=off)
+        tensors[(name.rstrip(b"\0").decode(), call)] = a.reshape((d0, d1, d2, d3)[:ndim])
+        off += 4 * count
+    return tensors
+
+
+# ───────────────────────────── 3DGS export ─────────────────────────────
+
+def load_ply(path):
+    with open(path, "rb") as f:
+        props, count = [], 0
+        line = f.readline()
+        if line.strip() != b"ply":
+            sys.exit(f"{path}: not a ply file")
+        while True:
+            line = f.readline().strip()
+            if line.startswith(b"format") and b"binary_little_endian" not in line:
+                sys.exit(f"{path}: only binary_little_endian ply is supported")
+            if line.startswith(b"element vertex"):
+                count = int(line.split()[-1])
+            if line.startswith(b"property"):
+                _, typ, name = line.split()
+                props.append((name.decode(), {b"float": "<f4", b"double": "<f8",
+                                              b"uchar": "u1", b"int": "<i4"}[typ]))
+            if line == b"end_header":
+                break
+        return np.fromfile(f, dtype=np.dtype(props), count=count)
+
+
+def eval_sh(v, dirs):
+    """3DGS SH convention, degree taken from the number of f_rest coefficients"""
+    rest = sorted([n for n in v.dtype.names if n.startswith("f_rest_")], key=lambda n: int(n[7:]))
+    coeffs = 1 + len(rest) // 3
+    sh = np.zeros((len(v), coeffs, 3))
+    sh[:, 0] = np.stack([v["f_dc_0"], v["f_dc_1"], v["f_dc_2"]], -1)
+    if rest:
+        r = np.stack([v[n] for n in rest], -1).reshape(len(v), 3, coeffs - 1)
+        sh[:, 1:] = r.transpose(0, 2, 1)
+    x, y, z = dirs[:, 0:1], dirs[:, 1:2], dirs[:, 2:3]
+    c = SH_C0 * sh[:, 0]
+    if coeffs > 1:
+        c = c - SH_C1 * y * sh[:, 1] + SH_C1 * z * sh[:, 2] - SH_C1 * x * sh[:, 3]
+    if coeffs > 4:
+        xx, yy, zz, xy, yz, xz = x * x, y * y, z * z, x * y, y * z, x * z
+        c = (c + SH_C2[0] * xy * sh[:, 4] + SH_C2[1] * yz * sh[:, 5]
+             + SH_C2[2] * (2 * zz - xx - yy) * sh[:, 6]
+             + SH_C2[3] * xz * sh[:, 7] + SH_C2[4] * (xx - yy) * sh[:, 8])
+        if coeffs > 9:
+            c = (c + SH_C3[0] * y * (3 * xx - yy) * sh[:, 9] + SH_C3[1] * xy * z * sh[:, 10]
+                 + SH_C3[2] * y * (4 * zz - xx - yy) * sh[:, 11]
+                 + SH_C3[3] * z * (2 * zz - 3 * xx - 3 * yy) * sh[:, 12]
+                 + SH_C3[4] * x * (4 * zz - xx - yy) * sh[:, 13]
+                 + SH_C3[5] * z * (xx - yy) * sh[:, 14] + SH_C3[6] * x * (xx - 3 * yy) * sh[:, 15])
+    return np.clip(c + 0.5, 0.0, None)
+
+
+def project(v, cam):
+    """Same culling / EWA projection as the CCU model, returns per-Gaussian screen-space records"""
+    width, height = cam["width"], cam["height"]
+    fx, fy = cam["fx"], cam["fy"]
+    cx, cy = width / 2.0, height / 2.0
+    c2w_r = np.array(cam["rotation"], dtype=np.float64)
+    pos = np.array(cam["position"], dtype=np.float64)
+    W = c2w_r.T
+    t_view = -W @ pos
+
+    mean = np.stack([v["x"], v["y"], v["z"]], -1).astype(np.float64)
+    t = mean @ W.T + t_view
+    keep = t[:, 2] >= NEAR_PLANE
+    txz = t[:, 0] / np.where(keep, t[:, 2], 1.0)
+    tyz = t[:, 1] / np.where(keep, t[:, 2], 1.0)
+    keep &= (np.abs(txz) <= FRUSTUM_GUARD * cx / fx) & (np.abs(tyz) <= FRUSTUM_GUARD * cy / fy)
+
+    # Sigma = R S S^T R^T from log scales and (w, x, y, z) quaternions
+    s = np.exp(np.stack([v["scale_0"], v["scale_1"], v["scale_2"]], -1).astype(np.float64))
+    q = np.stack([v["rot_0"], v["rot_1"], v["rot_2"], v["rot_3"]], -1).astype(np.float64)
+    q /= np.linalg.norm(q, axis=1, keepdims=True)
+    w, x, y, z = q.T
+    R = np.stack([1 - 2 * (y * y + z * z), 2 * (x * y - w * z), 2 * (x * z + w * y),
+                  2 * (x * y + w * z), 1 - 2 * (x * x + z * z), 2 * (y * z - w * x),
+                  2 * (x * z - w * y), 2 * (y * z + w * x), 1 - 2 * (x * x + y * y)], -1).reshape(-1, 3, 3)
+    M = R * s[:, None, :]
+    sigma = M @ M.transpose(0, 2, 1)
+
+    z_safe = np.where(keep, t[:, 2], 1.0)
+    J = np.zeros((len(v), 2, 3))
+    J[:, 0, 0] = fx / z_safe
+    J[:, 0, 2] = -fx * txz / z_safe
+    J[:, 1, 1] = fy / z_safe
+    J[:, 1, 2] = -fy * tyz / z_safe
+    T = J @ W
+    cov = T @ sigma @ T.transpose(0, 2, 1)
+    a = cov[:, 0, 0] + LOW_PASS
+    b = cov[:, 0, 1]
+    c = cov[:, 1, 1] + LOW_PASS
+    det = a * c - b * b
+    keep &= det > 0
+    det_safe = np.where(keep, det, 1.0)
+
+    mid = 0.5 * (a + c)
+    lam = mid + np.sqrt(np.maximum(0.1, mid * mid - det))
+    radius = np.ceil(3.0 * np.sqrt(lam))
+    mx = fx * txz + cx
+    my = fy * tyz + cy
+    grid_x = (width + TILE_SIZE - 1) // TILE_SIZE
+    grid_y = (height + TILE_SIZE - 1) // TILE_SIZE
+    tmin_x = np.clip(np.floor((mx - radius) / TILE_SIZE), 0, grid_x).astype(np.int64)
+    tmax_x = np.clip(np.floor((mx + radius + TILE_SIZE - 1) / TILE_SIZE), 0, grid_x).astype(np.int64)
+    tmin_y = np.clip(np.floor((my - radius) / TILE_SIZE), 0, grid_y).astype(np.int64)
+    tmax_y = np.clip(np.floor((my + radius + TILE_SIZE - 1) / TILE_SIZE), 0, grid_y).astype(np.int64)
+    keep &= (tmax_x > tmin_x) & (tmax_y > tmin_y)
+
+    d = mean - pos
+    d /= np.linalg.norm(d, axis=1, keepdims=True)
+    rgb = eval_sh(v, d)
+    opacity = 1.0 / (1.0 + np.exp(-v["opacity"].astype(np.float64)))
+
+    idx = np.nonzero(keep)[0]
+    rec = np.zeros(len(idx), dtype=GAUSS_DTYPE)
+    rec["gid"] = idx
+    rec["depth"] = t[idx, 2]
+    rec["mean_x"] = mx[idx]
+    rec["mean_y"] = my[idx]
+    rec["conx"] = (c / det_safe)[idx]
+    rec["cony"] = (-b / det_safe)[idx]
+    rec["conz"] = (a / det_safe)[idx]
+    rec["r"], rec["g"], rec["b"] = rgb[idx, 0], rgb[idx, 1], rgb[idx, 2]
+    rec["opacity"] = opacity[idx]
+    rects = np.stack([tmin_x, tmax_x, tmin_y, tmax_y], -1)[idx]
+    print(f"{len(v)} Gaussians, {len(idx)} visible after culling")
+    return rec, rects, grid_x, grid_y
+
+
+def bin_tiles(rec, rects, grid_x, grid_y):
+    """Duplicate every Gaussian into the tiles it touches, sort each tile front to back"""
+    nx = rects[:, 1] - rects[:, 0]
+    ny = rects[:, 3] - rects[:, 2]
+    cnt = nx * ny
+    owner = np.repeat(np.arange(len(rec)), cnt)
+    local = np.arange(cnt.sum()) - np.repeat(np.cumsum(cnt) - cnt, cnt)
+    tx = rects[owner, 0] + local % nx[owner]
+    ty = rects[owner, 2] + local // nx[owner]
+    key = ty * grid_x + tx
+    order = np.lexsort((rec["depth"][owner], key))
+    key, owner = key[order], owner[order]
+    bounds = np.searchsorted(key, np.arange(grid_x * grid_y + 1))
+    tiles = []
+    for k in range(grid_x * grid_y):
+        tiles.append((k % grid_x, k // grid_x, rec[owner[bounds[k]:bounds[k + 1]]]))
+    return tiles
+
+
+def cmd_export(args):
+    v = load_ply(args.ply)
+    with open(args.cameras) as f:
+        cams = json.load(f)
+    cam = next((c for c in cams if c.get("id") == args.cam), cams[args.cam])
+    rec, rects, gx, gy = project(v, cam)
+    write_trace(args.output, cam["width"], cam["height"], bin_tiles(rec, rects, gx, gy))
+
+
+def cmd_stim(args):
+    t = read_stimulus(args.stimulus)
+    get = lambda n: t.get((f"{args.prefix}_{n}", args.call))
+    if get("means2d") is None:
+        calls = sorted(c for n, c in t if n == f"{args.prefix}_means2d")
+        sys.exit(f"{args.stimulus}: no {args.prefix}_means2d of call {args.call} (calls: {calls})")
+    width, height = (int(v) for v in get("frame"))
+    means, conics, depths = get("means2d"), get("conics"), get("depths")
+    radius = np.ceil(get("radii"))
+    keep = (radius > 0) & (depths >= NEAR_PLANE)
+    idx = np.nonzero(keep)[0]
+    rec = np.zeros(len(idx), dtype=GAUSS_DTYPE)
+    rec["gid"] = idx
+    rec["depth"] = depths[idx]
+    rec["mean_x"], rec["mean_y"] = means[idx, 0], means[idx, 1]
+    rec["conx"], rec["cony"], rec["conz"] = conics[idx, 0], conics[idx, 1], conics[idx, 2]
+    colors = get("colors")
+    rec["r"], rec["g"], rec["b"] = colors[idx, 0], colors[idx, 1], colors[idx, 2]
+    rec["opacity"] = get("opacities")[idx]
+    gx = (width + TILE_SIZE - 1) // TILE_SIZE
+    gy = (height + TILE_SIZE - 1) // TILE_SIZE
+    mx, my, r = rec["mean_x"], rec["mean_y"], radius[idx]
+    rects = np.stack([
+        np.clip(np.floor((mx - r) / TILE_SIZE), 0, gx),
+        np.clip(np.floor((mx + r + TILE_SIZE - 1) / TILE_SIZE), 0, gx),
+        np.clip(np.floor((my - r) / TILE_SIZE), 0, gy),
+        np.clip(np.floor((my + r + TILE_SIZE - 1) / TILE_SIZE), 0, gy)], -1).astype(np.int64)
+    on_screen = (rects[:, 1] > rects[:, 0]) & (rects[:, 3] > rects[:, 2])
+    print(f"{len(means)} Gaussians rasterized, {on_screen.sum()} visible")
+    write_trace(args.output, width, height, bin_tiles(rec[on_screen], rects[on_screen], gx, gy))
+
+
+def cmd_synth(args):
+    rng = np.random.default_rng(args.seed)
+    n = args.gaussians
+    s1 = rng.uniform(1.0, args.max_sigma, n)
+    s2 = rng.uniform(1.0, args.max_sigma, n)
+    th = rng.uniform(0, np.pi, n)
+    cs, sn = np.cos(th), np.sin(th)
+    a = cs * cs * s1 * s1 + sn * sn * s2 * s2
+    b = cs * sn * (s1 * s1 - s2 * s2)
+    c = sn * sn * s1 * s1 + cs * cs * s2 * s2
+    det = a * c - b * b
+    rec = np.zeros(n, dtype=GAUSS_DTYPE)
+    rec["gid"] = np.arange(n)
+    rec["depth"] = rng.uniform(1.0, 100.0, n)
+    rec["mean_x"] = rng.uniform(0, args.width, n)
+    rec["mean_y"] = rng.uniform(0, args.height, n)
+    rec["conx"], rec["cony"], rec["conz"] = c / det, -b / det, a / det
+    rec["r"], rec["g"], rec["b"] = rng.uniform(0, 1, (3, n))
+    rec["opacity"] = rng.uniform(0.2, 0.99, n)
+    radius = np.ceil(3.0 * np.maximum(s1, s2))
+    gx = (args.width + TILE_SIZE - 1) // TILE_SIZE
+    gy = (args.height + TILE_SIZE - 1) // TILE_SIZE
+    rects = np.stack([
+        np.clip(np.floor((rec["mean_x"] - radius) / TILE_SIZE), 0, gx),
+        np.clip(np.floor((rec["mean_x"] + radius + TILE_SIZE - 1) / TILE_SIZE), 0, gx),
+        np.clip(np.floor((rec["mean_y"] - radius) / TILE_SIZE), 0, gy),
+        np.clip(np.floor((rec["mean_y"] + radius + TILE_SIZE - 1) / TILE_SIZE), 0, gy)], -1).astype(np.int64)
+    write_trace(args.output, args.width, args.height, bin_tiles(rec, rects, gx, gy))
+
+
+def cmd_stats(args):
+    it = read_trace(args.trace)
+    h = next(it)
+    counts, gids = [], set()
+    for _, _, g in it:
+        counts.append(len(g))
+        gids.update(np.unique(g["gid"]).tolist())
+    counts = np.array(counts)
+    print(f"{h['width']}x{h['height']}, {h['num_tiles']} tiles, {h['pairs']} tile-Gaussian pairs, "
+          f"{len(gids)} visible Gaussians")
+    print(f"Gaussians per tile: mean {counts.mean():.1f}, median {np.median(counts):.0f}, "
+          f"p99 {np.percentile(counts, 99):.0f}, max {counts.max()}, empty {np.sum(counts == 0)}")
+    print(f"Scheduler: Scene(\"{args.name}\", {len(gids)}, {h['pairs']}, {h['width']}, {h['height']})")
+
+
+def cmd_compare(args):
+    a, b = read_colors(args.a), read_colors(args.b)
+    mse = np.mean((np.clip(a, 0, 1) - np.clip(b, 0, 1)) ** 2)
+    psnr = 10 * np.log10(1.0 / mse) if mse > 0 else float("inf")
+    print(f"PSNR = {psnr:.2f} dB, max abs error = {np.abs(a - b).max():.4g}")
+
+
+def cmd_ppm(args):
+    img = (np.clip(read_colors(args.colors), 0, 1) * 255 + 0.5).astype(np.uint8)
+    with open(args.output, "wb") as f:
+        f.write(f"P6 {img.shape[1]} {img.shape[0]} 255\n".encode())
+        f.write(img.tobytes())
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description="GSCore scene traces")
+    sub = parser.add_subparsers(dest="cmd", required=True)
+    p = sub.add_parser("export", help="3DGS point cloud + camera -> trace")
+    p.add_argument("--ply", required=True)
+    p.add_argument("--cameras", required=True, help="cameras.json of the 3DGS output")
+    p.add_argument("--cam", type=int, default=0, help="camera id")
+    p.add_argument("-o", "--output", required=True)
+    p.set_defaults(func=cmd_export)
+    p = sub.add_parser("stim", help="splatfacto Gaussians of an instrumented run (.nrst) -> trace")
+    p.add_argument("stimulus")
+    p.add_argument("--call", type=int, default=0, help="rendered frame (call of get_outputs)")
+    p.add_argument("--prefix", default="gs", help="tensor name prefix of the splats export")
+    p.add_argument("-o", "--output", required=True)
+    p.set_defaults(func=cmd_stim)
+    p = sub.add_parser("synth", help="random screen-space scene -> trace")
+    p.add_argument("-o", "--output", required=True)
+    p.add_argument("--width", type=int, default=800)
+    p.add_argument("--height", type=int, default=800)
+    p.add_argument("--gaussians", type=int, default=20000)
+    p.add_argument("--max-sigma", type=float, default=12.0)
+    p.add_argument("--seed", type=int, default=0)
+    p.set_defaults(func=cmd_synth)
+    p = sub.add_parser("stats", help="per-tile Gaussian counts and the scheduler Scene")
+    p.add_argument("trace")
+    p.add_argument("--name", default="Trace")
+    p.set_defaults(func=cmd_stats)
+    p = sub.add_parser("compare", help="PSNR between two color files")
+    p.add_argument("a")
+    p.add_argument("b")
+    p.set_defaults(func=cmd_compare)
+    p = sub.add_parser("ppm", help="color file -> PPM image")
+    p.add_argument("colors")
+    p.add_argument("output")
+    p.set_defaults(func=cmd_ppm)
+    args = parser.parse_args(argv)
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
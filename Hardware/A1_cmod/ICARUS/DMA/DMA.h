@@ -0,0 +1,250 @@
+#ifndef ICARUS_DMA_H
+#define ICARUS_DMA_H
+
+#include "ICARUSPackDef.h"
+#include <nvhls_connections.h>
+#include <deque>
+#include <vector>
+
+/*
+ * Off-chip memory + DMA behind the ICARUS pos_in / memory_req_in / VRU_out ports
+ * (same role as the DMA in https://github.com/hlslibs/matchlib_toolkit/tree/main/examples/08_dma)
+ * Input: DMA requests, VRU outputs
+ * Output: positions (DMA_POS region), weight writes (DMA_WEIGHT region)
+ * Timing: reads in bursts of DRAM_BURST_BYTES, first data DRAM_LATENCY cycles after the burst is issued,
+ *         up to DMA_MAX_OUTSTANDING bursts in flight per read stream (positions and weights are
+ *         independent streams, a weight load does not wait for a position read); reads and (coalesced, posted) writes share a bus
+ *         of DRAM_GBPS/DRAM_CLK_GHZ bytes per cycle
+ * Simulation model (std::vector backing store, preloaded by the testbench), not an HLS block.
+ */
+class DMA : public match::Module {
+    SC_HAS_PROCESS(DMA);
+public:
+
+    Connections::In<DMA_Req_Type> DMAReq;
+    Connections::Out<PEU_In_Type> pos_out;
+    Connections::Out<MemReq> memreq_out;
+    Connections::In<VRU_Out_Type> vru_in;
+
+    Connections::Combinational<DMA_Req_Type> pos_req;
+    Connections::Combinational<DMA_Req_Type> weight_req;
+
+    DMA(sc_module_name name) : match::Module(name),
+                               DMAReq("DMAReq"),
+                               pos_out("pos_out"),
+                               memreq_out("memreq_out"),
+                               vru_in("vru_in"),
+                               pos_req("pos_req"),
+                               weight_req("weight_req") {
+        SC_THREAD(Tick);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+
+        SC_THREAD(RouteDMA);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+
+        SC_THREAD(ReadPos);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+
+        SC_THREAD(ReadWeight);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+
+        SC_THREAD(WriteDMA);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+    }
+
+    // Element sizes in DRAM (message width rounded up to bytes)
+    static const unsigned POS_BYTES = (Wrapped<PEU_In_Type>::width + 7) / 8;
+    static const unsigned WEIGHT_BYTES = (Wrapped<MemReq>::width + 7) / 8;
+    static const unsigned OUT_BYTES = (Wrapped<VRU_Out_Type>::width + 7) / 8;
+
+    // Backing store, element addressed per region
+    std::vector<PEU_In_Type> pos_mem;
+    std::vector<MemReq> weight_mem;
+    std::vector<VRU_Out_Type> out_mem;
+
+    // Backdoor access for the testbench
+    void WritePos(unsigned addr, const PEU_In_Type &x) {
+        if (addr >= pos_mem.size()) pos_mem.resize(addr + 1);
+        pos_mem[addr] = x;
+    }
+    void WriteWeight(unsigned addr, const MemReq &q) {
+        if (addr >= weight_mem.size()) weight_mem.resize(addr + 1);
+        weight_mem[addr] = q;
+    }
+    VRU_Out_Type ReadOut(unsigned addr) const {
+        return (addr < out_mem.size()) ? out_mem[addr] : VRU_Out_Type();
+    }
+
+    // Statistics
+    unsigned long cycle;             // cycles since reset
+    unsigned long bytes_read;
+    unsigned long bytes_written;
+    unsigned long read_bursts;
+    unsigned long write_bursts;
+    unsigned long read_wait_cycles;  // cycles the read streams waited for their next burst
+    unsigned long out_written;       // VRU outputs stored
+    double bus_busy_cycles;          // cycles the DRAM bus transferred data
+
+    double BytesPerCycle() const { return DRAM_GBPS / DRAM_CLK_GHZ; }
+    double BusUtilization() const { return cycle ? bus_busy_cycles / cycle : 0.0; }
+
+    void Tick() {
+        cycle = 0;
+        wait();
+
+        while (1) {
+            wait();
+            cycle++;
+        }
+    }
+
+    /*
+     * Reserve the bus for one burst of the given size
+     * Returns the cycle its data is available (reads), the bus is released after the transfer
+     */
+    unsigned long Issue(unsigned bytes) {
+        double xfer = bytes / BytesPerCycle();
+        double start = (bus_free > double(cycle)) ? bus_free : double(cycle);
+        bus_free = start + xfer;
+        bus_busy_cycles += xfer;
+        return (unsigned long)(start + xfer + 0.999999) + DRAM_LATENCY;
+    }
+
+    void RouteDMA() {
+        DMAReq.Reset();
+        pos_req.ResetWrite();
+        weight_req.ResetWrite();
+        wait();
+
+        while (1) {
+            wait();
+
+            DMA_Req_Type req;
+            if (NRSIM_POPNB(DMAReq, req)) {
+                if (req.region == DMA_OUT) {
+                    wr_ptr = req.addr.to_uint();
+                } else if (req.region == DMA_POS) {
+                    NRSIM_PUSH(pos_req, req);
+                } else {
+                    NRSIM_PUSH(weight_req, req);
+                }
+            }
+        }
+    }
+
+    /*
+     * Stream req.num elements of mem from req.addr to out, burst by burst
+     */
+    template <typename T, typename Port>
+    void Stream(const DMA_Req_Type &req, const std::vector<T> &mem, Port &out) {
+        const unsigned elem_bytes = (Wrapped<T>::width + 7) / 8;
+        unsigned per_burst = (DRAM_BURST_BYTES >= elem_bytes) ? DRAM_BURST_BYTES / elem_bytes : 1;
+        unsigned bursts = (req.num + per_burst - 1) / per_burst;
+        unsigned base = req.addr.to_uint();
+
+        std::deque<unsigned long> inflight;
+        unsigned issued = 0;
+        for (unsigned b = 0; b < bursts; b++) {
+            while (issued < bursts && inflight.size() < DMA_MAX_OUTSTANDING) {
+                unsigned n = (req.num - issued*per_burst < per_burst) ? req.num - issued*per_burst : per_burst;
+                inflight.push_back(Issue(n * elem_bytes));
+                read_bursts++;
+                issued++;
+            }
+            unsigned long ready = inflight.front();
+            inflight.pop_front();
+            while (cycle < ready) {
+                read_wait_cycles++;
+                wait();
+            }
+
+            unsigned first = b*per_burst;
+            unsigned last = (first + per_burst < req.num) ? first + per_burst : req.num;
+            for (unsigned e = first; e < last; e++) {
+                unsigned a = base + e;
+                NRSIM_PUSH(out, (a < mem.size()) ? mem[a] : T());
+                bytes_read += elem_bytes;
+            }
+        }
+    }
+
+    void ReadPos() {
+        pos_req.ResetRead();
+        pos_out.Reset();
+        bus_free = 0;
+        bus_busy_cycles = 0;
+        bytes_read = 0;
+        read_bursts = 0;
+        read_wait_cycles = 0;
+        wait();
+
+        while (1) {
+            wait();
+
+            DMA_Req_Type req;
+            if (NRSIM_POPNB(pos_req, req)) {
+                Stream(req, pos_mem, pos_out);
+            }
+        }
+    }
+
+    void ReadWeight() {
+        weight_req.ResetRead();
+        memreq_out.Reset();
+        wait();
+
+        while (1) {
+            wait();
+
+            DMA_Req_Type req;
+            if (NRSIM_POPNB(weight_req, req)) {
+                Stream(req, weight_mem, memreq_out);
+            }
+        }
+    }
+
+    void WriteDMA() {
+        vru_in.Reset();
+        wr_ptr = 0;
+        bytes_written = 0;
+        write_bursts = 0;
+        out_written = 0;
+        unsigned pending = 0;       // outputs coalesced into the open write burst
+        unsigned idle = 0;
+        const unsigned per_burst = (DRAM_BURST_BYTES >= OUT_BYTES) ? DRAM_BURST_BYTES / OUT_BYTES : 1;
+        wait();
+
+        while (1) {
+            wait();
+
+            VRU_Out_Type o;
+            if (NRSIM_POPNB(vru_in, o)) {
+                if (wr_ptr >= out_mem.size()) out_mem.resize(wr_ptr + 1);
+                out_mem[wr_ptr++] = o;
+                out_written++;
+                pending++;
+                idle = 0;
+            } else if (pending > 0) {
+                idle++;
+            }
+            if (pending == per_burst || (pending > 0 && idle >= DMA_WRITE_COALESCE)) {
+                Issue(pending * OUT_BYTES);
+                bytes_written += pending * OUT_BYTES;
+                write_bursts++;
+                pending = 0;
+                idle = 0;
+            }
+        }
+    }
+
+private:
+    double bus_free;   // first cycle the bus is free again
+    unsigned wr_ptr;   // DMA_OUT element the next VRU output goes to
+};
+
+#endif //ICARUS_DMA_H
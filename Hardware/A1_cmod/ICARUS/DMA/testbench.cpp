@@ -0,0 +1,170 @@
+#include "DMA.h"
+#include "nvhls_connections.h"
+#include "ac_sysc_trace.h"
+#include <iomanip>
+//#include <ac_channel.h>
+#include <systemc.h>
+#include <nvhls_module.h>
+#include <mc_connections.h>
+
+#define POS_NUM 1024
+#define WEIGHT_NUM 64
+#define OUT_NUM 40
+
+class Top : public sc_module {
+public:
+    sc_clock clk;
+    sc_signal<bool> rst;
+
+    Connections::Combinational<DMA_Req_Type> DMAReq;
+    Connections::Combinational<PEU_In_Type> pos_out;
+    Connections::Combinational<MemReq> memreq_out;
+    Connections::Combinational<VRU_Out_Type> vru_in;
+
+    DMA dut;
+
+    SC_CTOR(Top) : clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
+                   rst("rst"),
+                   DMAReq("DMAReq"),
+                   pos_out("pos_out"),
+                   memreq_out("memreq_out"),
+                   vru_in("vru_in"),
+                   dut("dut") {
+
+        sc_object_tracer<sc_clock> trace_clk(clk);
+
+        dut.clk(clk);
+        dut.rst(rst);
+        dut.DMAReq(DMAReq);
+        dut.pos_out(pos_out);
+        dut.memreq_out(memreq_out);
+        dut.vru_in(vru_in);
+
+        SC_THREAD(reset);
+        sensitive << clk.posedge_event();
+
+        SC_THREAD(run);
+        sensitive << clk.posedge_event();
+        async_reset_signal_is(rst, false);
+    }
+
+    void reset() {
+        rst.write(false);
+        wait(10);
+        rst.write(true);
+    }
+
+    static PEU_In_Type Pos(int i) {
+        PEU_In_Type pos;
+        for (int k = 0; k < PEU_INPUT_DIM; k++)
+            pos.X[k] = PEU_Position_Type(((i*PEU_INPUT_DIM + k) % 997) * 0.01);
+        pos.isLastSample = ((i % 64) == 63);
+        return pos;
+    }
+
+    static bool Same(const PEU_In_Type &a, const PEU_In_Type &b) {
+        for (int k = 0; k < PEU_INPUT_DIM; k++)
+            if (a.X[k] != b.X[k]) return false;
+        return a.isLastSample == b.isLastSample;
+    }
+
+    void run() {
+        DMAReq.ResetWrite();
+        pos_out.ResetRead();
+        memreq_out.ResetRead();
+        vru_in.ResetWrite();
+        bool pass = true;
+
+        // Backdoor load, positions at offset 16 to test a non-zero base
+        for (int i = 0; i < POS_NUM; i++)
+            dut.WritePos(16 + i, Pos(i));
+        for (int i = 0; i < WEIGHT_NUM; i++) {
+            MemReq q;
+            q.forPEU = true;
+            q.forMLP0 = false;
+            q.index[0] = i / PEU_INPUT_DIM;
+            q.index[1] = i % PEU_INPUT_DIM;
+            q.len = 1;
+            q.data[0] = PEU_Matrix_A_Type(i * 0.125);
+            dut.WriteWeight(i, q);
+        }
+        wait(10);
+
+        cout << "DRAM: latency " << DRAM_LATENCY << " cycles, burst " << DRAM_BURST_BYTES << " B, "
+             << dut.BytesPerCycle() << " B/cycle, " << DMA_MAX_OUTSTANDING << " bursts outstanding" << endl;
+
+        // 1. Position stream: order, content, first-data latency and sustained bandwidth
+        DMA_Req_Type req;
+        req.region = DMA_POS;
+        req.addr = 16;
+        req.num = POS_NUM;
+        DMAReq.Push(req);
+        unsigned long issue = dut.cycle;
+        unsigned long first = 0;
+        int errors = 0;
+        for (int i = 0; i < POS_NUM; i++) {
+            PEU_In_Type x = pos_out.Pop();
+            if (i == 0) first = dut.cycle;
+            if (!Same(x, Pos(i))) errors++;
+        }
+        unsigned long last = dut.cycle;
+        double bw = double(POS_NUM - 1) * DMA::POS_BYTES / (last - first);
+        cout << (errors == 0 ? "✓" : "✗ (MISMATCH)") << " pos stream: " << POS_NUM << " x "
+             << DMA::POS_BYTES << " B, " << errors << " errors" << endl;
+        cout << "  first data after " << (first - issue) << " cycles (DRAM_LATENCY " << DRAM_LATENCY << ")" << endl;
+        cout << "  " << std::fixed << std::setprecision(2) << bw << " B/cycle sustained (configured "
+             << dut.BytesPerCycle() << ")" << endl;
+        pass &= (errors == 0);
+        pass &= (first - issue >= DRAM_LATENCY);
+        pass &= (bw <= dut.BytesPerCycle() * 1.05);
+
+        // 2. Weight stream
+        req.region = DMA_WEIGHT;
+        req.addr = 0;
+        req.num = WEIGHT_NUM;
+        DMAReq.Push(req);
+        errors = 0;
+        for (int i = 0; i < WEIGHT_NUM; i++) {
+            MemReq q = memreq_out.Pop();
+            if (q.index[0] != i / PEU_INPUT_DIM || q.index[1] != i % PEU_INPUT_DIM ||
+                q.data[0] != PEU_Matrix_A_Type(i * 0.125)) errors++;
+        }
+        cout << (errors == 0 ? "✓" : "✗ (MISMATCH)") << " weight stream: " << WEIGHT_NUM << " x "
+             << DMA::WEIGHT_BYTES << " B, " << errors << " errors" << endl;
+        pass &= (errors == 0);
+
+        // 3. Output writes from offset 8, the last partial burst is flushed after DMA_WRITE_COALESCE idle cycles
+        req.region = DMA_OUT;
+        req.addr = 8;
+        req.num = 0;
+        DMAReq.Push(req);
+        wait(5);
+        for (int i = 0; i < OUT_NUM; i++) {
+            VRU_Out_Type o;
+            for (int c = 0; c < 3; c++)
+                o.c[c] = VRU_Color_Type((i*3 + c) * 0.001);
+            vru_in.Push(o);
+        }
+        wait(DMA_WRITE_COALESCE + 5);
+        errors = 0;
+        for (int i = 0; i < OUT_NUM; i++) {
+            VRU_Out_Type o = dut.ReadOut(8 + i);
+            for (int c = 0; c < 3; c++)
+                if (o.c[c] != VRU_Color_Type((i*3 + c) * 0.001)) errors++;
+        }
+        cout << (errors == 0 ? "✓" : "✗ (MISMATCH)") << " output writes: " << OUT_NUM << " x "
+             << DMA::OUT_BYTES << " B in " << dut.write_bursts << " bursts, " << errors << " errors" << endl;
+        pass &= (errors == 0) && (dut.bytes_written == OUT_NUM * DMA::OUT_BYTES);
+
+        cout << "DMA: " << dut.bytes_read << " B read in " << dut.read_bursts << " bursts, bus utilization "
+             << dut.BusUtilization() * 100 << "% over " << dut.cycle << " cycles" << endl;
+        cout << (pass ? "PASSED" : "FAILED") << endl;
+        sc_stop();
+    }
+};
+
+int sc_main(int argc, char *argv[]) {
+    Top tb("tb");
+    sc_start();
+    return 0;
+}
@@ -3,7 +3,9 @@
 
 #include "ICARUSPackDef.h"
 #include "PEU.h"
-#include "MLP_vanilla.h" // current use this version. TODO: allocate a scratchpad mem for PEUOutput, and include TriggerMLP
+#include "MLP_vanilla.h"
+#include "MLP_block.h"
+#include "MLP_ssa.h"
 #include "VRU.h"
 #include <ac_channel.h>
 #include <nvhls_connections.h>
@@ -14,28 +16,52 @@
  * Input: (x,y,z)
  * Output: (r,g,b)
  * 45.75 (s) / (800*800(pixels)*1/(400MHz)) = 28593 cycles for batch 192 samples
- *     - PEU: 128 * 192 (if 1 mul and 2 cordics only)
+ *     - PEU: 128 * 192 (if 1 mul and 2 cordics only), max(128*3/PEU_MAC_LANES, 128/PEU_CORDIC_UNITS) * 192
  *     - MLP:  32 * 192 
  *     - VRU:   1 * 192
+ * MLP_ENGINE: MLP_vanilla, MLP_block or MLP_ssa. PEU outputs are collected per batch (isLastSample,
+ * at most MAX_SAMPLE_NUM samples) in a ping-pong scratchpad and streamed MLP_ENGINE::INPUT_PASSES
+ * times into the MLP, so the weight-stationary engines reuse every weight across the whole batch.
+ * Per-sample delta and ray id travel with the sample through PEU and the scratchpad (Sample_Tag_Type),
+ * the MLP only sees the features. Early ray termination: the VRU reports a ray on ray_term once its
+ * transmittance is spent, RunBatch then drops the ray's samples not sent to PEU yet and TriggerMLP the ones
+ * waiting in the scratchpad. The last sample of a ray is always kept, it closes the ray in VRU and
+ * the batch in the MLP.
+ * Instructions (inst_type) are queued (OP_QUEUE_DEPTH) and dispatched in order to LoadWeights and
+ * RunBatch, which run concurrently: the PEU / MLP weights are double-buffered (wbank travels with each
+ * sample), so WEIGHT_INIT into one bank overlaps READ_POS batches on the other. Dispatch only holds an
+ * instruction back on a bank hazard: WEIGHT_INIT waits for the bank's samples in flight to drain,
+ * READ_POS for every weight write of its bank to reach the PEU / MLP memories.
  */
+template <class MLP_ENGINE = ICARUS_MLP_ENGINE>
 class ICARUS : public match::Module {
     SC_HAS_PROCESS(ICARUS);
 public:
 
     // Host, Off-chip mem access
-    // DMA: https://github.com/hlslibs/matchlib_toolkit/tree/main/examples/08_dma
+    // DMA: https://github.com/hlslibs/matchlib_toolkit/tree/main/examples/08_dma (C model: DMA/DMA.h)
 
-    Connections::In<ICARUS_Op_In_Type> ICARUS_Op;
-    Connections::In<PEU_In_Type> pos_in;    // TODO: should be offchip-memory access
-    Connections::In<MemReq> memory_req_in;  // TODO: should be offchip-memory access
-    Connections::Out<VRU_Out_Type> VRU_out; // TODO: should connect to buffer, then write to memory
+    Connections::In<ICARUS_Op_In_Type> ICARUS_Op;  // instruction queue (op_fifo) input
+    Connections::Out<DMA_Req_Type> dma_req;  // DMA reads for READ_POS / WEIGHT_INIT, output pointer for SET_OUT
+    Connections::In<PEU_In_Type> pos_in;     // from DMA (DMA_POS)
+    Connections::In<MemReq> memory_req_in;   // from DMA (DMA_WEIGHT)
+    Connections::Out<VRU_Out_Type> VRU_out;  // to DMA, written from the SET_OUT address on
 
-    PEU *peu;
+    Connections::Buffer<ICARUS_Op_In_Type, OP_QUEUE_DEPTH> op_fifo;
+    Connections::Combinational<ICARUS_Op_In_Type> op_deq;
+    Connections::Combinational<ICARUS_Op_In_Type> load_op; // Dispatch -> LoadWeights
+    Connections::Combinational<ICARUS_Op_In_Type> run_op;  // Dispatch -> RunBatch
+
+    PEU<PEU_MAC_LANES, PEU_CORDIC_UNITS> *peu;
     Connections::Combinational<MemReq> peu_memreq; 
     Connections::Combinational<PEU_In_Type> PEUInput;
     Connections::Combinational<PEU_Out_Type> PEUOutput;
 
-    MLP *mlp;
+    Connections::Combinational<PEU_Out_Type> PEUBatch;      // peu_mlp -> scratchpad
+    Connections::Combinational<sample_cnt> batch_ready;     // samples in the bank just filled
+    Connections::Combinational<bool> scratch_free;          // TriggerMLP -> FillScratchpad, bank replayed
+
+    MLP_ENGINE *mlp;
     Connections::Combinational<MemReq> mlp_memreq;
     Connections::Combinational<MLP_In_Type> MLPInput;
     Connections::Combinational<MLP_Out_Type> MLPOutput;
@@ -43,6 +69,12 @@ public:
     VRU *vru;
     Connections::Combinational<VRU_In_Type> VRUInput;
     Connections::Combinational<VRU_Out_Type> VRUOutput;
+    Connections::Combinational<ray_id_type> ray_term;
+    Connections::Combinational<ray_id_type> ray_retire;     // MLP_to_VRU -> RayTerm, last sample of a ray retired
+
+    Connections::Buffer<Sample_Tag_Type, TAG_DEPTH> tag_fifo; // TriggerMLP -> MLP_to_VRU, one per MLP output
+    Connections::Combinational<Sample_Tag_Type> tag_enq;
+    Connections::Combinational<Sample_Tag_Type> tag_deq;
 
     Connections::Buffer<PEU_Out_Type, PEU_MLP_TO_DEPTH> peu_mlp;
     Connections::Buffer<MemReq, MEMREQ_DEPTH> memreq_fifo;
@@ -53,21 +85,37 @@ public:
 
     ICARUS(sc_module_name name) : match::Module(name),
                                   ICARUS_Op     ("ICARUS_Op"),
+                                  dma_req       ("dma_req"),
+                                  op_deq        ("op_deq"),
+                                  load_op       ("load_op"),
+                                  run_op        ("run_op"),
                                   pos_in        ("pos_in"),
                                   memory_req_in ("memory_req_in"),
                                   VRU_out       ("VRU_out"),
                                   peu_memreq    ("peu_memreq"),
                                   PEUInput      ("PEUInput"),
                                   PEUOutput     ("PEUOutput"),
+                                  PEUBatch      ("PEUBatch"),
+                                  batch_ready   ("batch_ready"),
+                                  scratch_free  ("scratch_free"),
                                   mlp_memreq    ("mlp_memreq"),
                                   MLPInput      ("MLPInput"),
                                   MLPOutput     ("MLPOutput"),
                                   VRUInput      ("VRUInput"),
                                   VRUOutput     ("VRUOutput"),
+                                  ray_term      ("ray_term"),
+                                  ray_retire    ("ray_retire"),
+                                  tag_enq       ("tag_enq"),
+                                  tag_deq       ("tag_deq"),
                                   memory_req_out("memory_req_out"),
                                   memory_fifo_in("memory_fifo_in") {
 
-        peu = new PEU(sc_gen_unique_name("PEU"));
+        op_fifo.clk(clk);
+        op_fifo.rst(rst);
+        op_fifo.enq(ICARUS_Op);
+        op_fifo.deq(op_deq);
+
+        peu = new PEU<PEU_MAC_LANES, PEU_CORDIC_UNITS>(sc_gen_unique_name("PEU"));
         peu->clk(clk);
         peu->rst(rst);
         peu->memreq(peu_memreq);
@@ -77,9 +125,9 @@ public:
         peu_mlp.clk(clk);
         peu_mlp.rst(rst);
         peu_mlp.enq(PEUOutput);
-        peu_mlp.deq(MLPInput);
+        peu_mlp.deq(PEUBatch);
 
-        mlp = new MLP(sc_gen_unique_name("MLP"));
+        mlp = new MLP_ENGINE(sc_gen_unique_name("MLP"));
         mlp->clk(clk);
         mlp->rst(rst);
         mlp->memreq(mlp_memreq);
@@ -91,6 +139,12 @@ public:
         vru->rst(rst);
         vru->VRUInput(VRUInput);
         vru->VRUOutput(VRUOutput);
+        vru->ray_term(ray_term);
+
+        tag_fifo.clk(clk);
+        tag_fifo.rst(rst);
+        tag_fifo.enq(tag_enq);
+        tag_fifo.deq(tag_deq);
 
         vruout_fifo.clk(clk);
         vruout_fifo.rst(rst);
@@ -106,59 +160,213 @@ public:
         sensitive << clk.pos();
         async_reset_signal_is(rst, false);
 
-        SC_THREAD(Cfg);
+        SC_THREAD(Dispatch);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+
+        SC_THREAD(LoadWeights);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+
+        SC_THREAD(RunBatch);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+
+        SC_THREAD(FillScratchpad);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+
+        SC_THREAD(TriggerMLP);
         sensitive << clk.pos();
         async_reset_signal_is(rst, false);
 
         SC_THREAD(MLP_to_VRU);
         sensitive << clk.pos();
         async_reset_signal_is(rst, false);
+
+        SC_THREAD(RayTerm);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+    }
+
+    // Statistics
+    unsigned long batches;          // batches handed to the MLP
+    unsigned long replayed_samples; // samples streamed into MLPInput (INPUT_PASSES per batch sample)
+    unsigned long rays;             // rays read by RunBatch
+    unsigned long pos_samples;      // samples read by RunBatch
+    unsigned long cfg_dropped;      // samples of terminated rays not sent to PEU
+    unsigned long weight_loads;     // WEIGHT_INIT instructions
+    unsigned long load_cycles;      // cycles LoadWeights was busy
+    unsigned long overlap_cycles;   // ... of which RunBatch was busy too
+    unsigned long hazard_cycles;    // cycles Dispatch held an instruction back on a bank hazard
+    unsigned long mlp_dropped;      // samples of terminated rays removed from a batch before the MLP
+
+    /*
+     * Terminated rays, slot ray % RAY_TERM_WINDOW (written by RayTerm, read by RunBatch and TriggerMLP)
+     * The ray id is kept with the flag, so a slot reused by a later ray never drops its samples.
+     * MLP_to_VRU reports a ray on ray_retire when its last sample retires, RayTerm then clears the slot and ignores
+     * later reports of that ray, so ray + 2^16 (ray_id_type wraps) never matches a stale entry.
+     */
+    bool term_valid[RAY_TERM_WINDOW];
+    ray_id_type term_ray[RAY_TERM_WINDOW];
+    ray_id_type last_retired;   // rays retire in order (RayTerm)
+    bool retired_any;
+    bool Terminated(ray_id_type ray) {
+        uint slot = ray % RAY_TERM_WINDOW;
+        return term_valid[slot] && term_ray[slot] == ray;
+    }
+    // ray is last_retired or before it (modulo the wrap, fewer than 2^15 rays in flight)
+    bool Retired(ray_id_type ray) {
+        ray_id_type behind = last_retired - ray;
+        return retired_any && behind[ray_id_type::width-1] == 0;
+    }
+
+    void RayTerm() {
+        ray_term.ResetRead();
+        ray_retire.ResetRead();
+        #pragma hls_unroll
+        for (int i = 0; i < RAY_TERM_WINDOW; i++) {
+            term_valid[i] = false;
+        }
+        last_retired = 0;
+        retired_any = false;
+        wait();
+
+        while (1) {
+            wait();
+
+            ray_id_type ray;
+            if (NRSIM_POPNB(ray_term, ray) && !Retired(ray)) {
+                uint slot = ray % RAY_TERM_WINDOW;
+                term_ray[slot] = ray;
+                term_valid[slot] = true;
+            }
+            if (NRSIM_POPNB(ray_retire, ray)) {
+                uint slot = ray % RAY_TERM_WINDOW;
+                if (term_valid[slot] && term_ray[slot] == ray) term_valid[slot] = false;
+                last_retired = ray;
+                retired_any = true;
+            }
+        }
     }
 
     void RouteMemReq() {
         memory_fifo_in.ResetRead();
         peu_memreq.ResetWrite();
         mlp_memreq.ResetWrite();
+        #pragma hls_unroll
+        for (int b = 0; b < WEIGHT_BANKS; b++) {
+            memreqs_written[b] = 0;
+        }
         wait();
 
         while (1) {
             wait();
 
             MemReq q;
-            if (memory_fifo_in.PopNB(q)) {
+            if (NRSIM_POPNB(memory_fifo_in, q)) {
                 if (q.forPEU)
-                    peu_memreq.Push(q);
+                    NRSIM_PUSH(peu_memreq, q);
                 else
-                    mlp_memreq.Push(q);
+                    NRSIM_PUSH(mlp_memreq, q);
+                memreqs_written[q.wbank]++; // the engine writes a MemReq in the cycle it pops it
             }
         }
     }
 
-    void Cfg() {
-        ICARUS_Op.Reset();
-        pos_in.Reset();
-        memory_req_in.Reset();
-        memory_req_out.ResetWrite();
-        PEUInput.ResetWrite();
+    /*
+     * Backdoor access for the testbench (C simulation only, no timing): a weight write routed like RouteMemReq
+     * straight into the PEU / MLP memories of bank q.wbank, in place of a WEIGHT_INIT through the DMA
+     */
+    void PreloadWeight(const MemReq &q) {
+        if (q.forPEU) peu->PreloadWeight(q);
+        else          mlp->PreloadWeight(q);
+    }
+
+    /*
+     * Weight bank bookkeeping, each counter written by one thread
+     * A bank is drained when every sample dispatched on it has left the MLP or was dropped, and loaded when
+     * every MemReq of its WEIGHT_INITs was written into the PEU / MLP memories (not just queued in memreq_fifo).
+     */
+    uint samples_issued[WEIGHT_BANKS];  // Dispatch
+    uint samples_dropped[WEIGHT_BANKS]; // RunBatch (before PEU)
+    uint samples_skipped[WEIGHT_BANKS]; // TriggerMLP (before MLP)
+    uint samples_retired[WEIGHT_BANKS]; // MLP_to_VRU
+    uint memreqs_issued[WEIGHT_BANKS];  // Dispatch
+    uint memreqs_written[WEIGHT_BANKS]; // RouteMemReq
+    bool run_busy;                      // RunBatch
+    bool Drained(wbank_type b) {
+        return samples_issued[b] == samples_dropped[b] + samples_skipped[b] + samples_retired[b];
+    }
+    bool AllDrained() {
+        bool drained = true;
+        #pragma hls_unroll
+        for (int b = 0; b < WEIGHT_BANKS; b++) {
+            drained = drained && Drained(b);
+        }
+        return drained;
+    }
+
+    void Dispatch() {
+        op_deq.ResetRead();
+        dma_req.Reset();
+        load_op.ResetWrite();
+        run_op.ResetWrite();
+        wbank_type active = 0;
+        #pragma hls_unroll
+        for (int b = 0; b < WEIGHT_BANKS; b++) {
+            samples_issued[b] = 0;
+            memreqs_issued[b] = 0;
+        }
+        weight_loads = 0;
+        hazard_cycles = 0;
         wait();
 
         while (1) {
             wait();
 
             ICARUS_Op_In_Type op;
-            if (ICARUS_Op.PopNB(op)) {
+            if (NRSIM_POPNB(op_deq, op)) {
+                DMA_Req_Type req;
+                req.addr = op.addr;
+                req.num = op.num;
                 switch (op.mode) {
                     case (inst_type::WEIGHT_INIT): {
-                        for (uint i = 0; i < op.num; i++) {
-                            MemReq q = memory_req_in.Pop(); // should be poppable
-                            memory_req_out.Push(q);
+                        while (!Drained(op.wbank)) { // batches still computing with this bank
+                            hazard_cycles++;
+                            wait();
                         }
+                        memreqs_issued[op.wbank] += op.num;
+                        weight_loads++;
+                        req.region = DMA_WEIGHT;
+                        NRSIM_PUSH(dma_req, req);
+                        NRSIM_PUSH(load_op, op);
+                        break;
                     }
                     case (inst_type::READ_POS): {
-                        for (uint i = 0; i < op.num; i++) {
-                            PEU_In_Type x = pos_in.Pop(); // should be poppable
-                            PEUInput.Push(x);
+                        while (memreqs_written[active] != memreqs_issued[active]) { // bank still loading
+                            hazard_cycles++;
+                            wait();
+                        }
+                        op.wbank = active;
+                        samples_issued[active] += op.num;
+                        req.region = DMA_POS;
+                        NRSIM_PUSH(dma_req, req);
+                        NRSIM_PUSH(run_op, op);
+                        break;
+                    }
+                    case (inst_type::SET_OUT): {
+                        while (!AllDrained()) { // earlier outputs go to the old address
+                            hazard_cycles++;
+                            wait();
                         }
+                        req.region = DMA_OUT;
+                        NRSIM_PUSH(dma_req, req);
+                        break;
+                    }
+                    case (inst_type::SWAP_WEIGHTS): {
+                        active = active ^ 1;
+                        break;
                     }
                     default:
                         break;
@@ -167,21 +375,205 @@ public:
         }
     }
 
+    void LoadWeights() {
+        load_op.ResetRead();
+        memory_req_in.Reset();
+        memory_req_out.ResetWrite();
+        load_cycles = 0;
+        overlap_cycles = 0;
+        wait();
+
+        while (1) {
+            wait();
+
+            ICARUS_Op_In_Type op;
+            if (NRSIM_POPNB(load_op, op)) {
+                for (uint i = 0; i < op.num; i++) {
+                    MemReq q;
+                    while (!NRSIM_POPNB(memory_req_in, q)) {
+                        load_cycles++;
+                        if (run_busy) overlap_cycles++;
+                        wait();
+                    }
+                    q.wbank = op.wbank;
+                    NRSIM_PUSH(memory_req_out, q);
+                    load_cycles++;
+                    if (run_busy) overlap_cycles++;
+                }
+            }
+        }
+    }
+
+    void RunBatch() {
+        run_op.ResetRead();
+        pos_in.Reset();
+        PEUInput.ResetWrite();
+        ray_id_type ray = 0;
+        #pragma hls_unroll
+        for (int b = 0; b < WEIGHT_BANKS; b++) {
+            samples_dropped[b] = 0;
+        }
+        run_busy = false;
+        rays = 0;
+        pos_samples = 0;
+        cfg_dropped = 0;
+        wait();
+
+        while (1) {
+            wait();
+
+            ICARUS_Op_In_Type op;
+            if (NRSIM_POPNB(run_op, op)) {
+                run_busy = true;
+                for (uint i = 0; i < op.num; i++) {
+                    PEU_In_Type x = NRSIM_POP(pos_in); // should be poppable
+                    x.ray = ray;
+                    x.wbank = op.wbank;
+                    pos_samples++;
+                    if (x.isLastSample || !Terminated(ray)) {
+                        NRSIM_PUSH(PEUInput, x);
+                    } else {
+                        samples_dropped[op.wbank]++;
+                        cfg_dropped++;
+                    }
+                    if (x.isLastSample) {
+                        ray++;
+                        rays++;
+                    }
+                }
+                run_busy = false;
+            }
+        }
+    }
+
+    /*
+     * Batch scratchpad for PEU outputs (two banks, filled and replayed alternately)
+     * FillScratchpad writes one bank per batch and hands it over on batch_ready,
+     * TriggerMLP streams that bank while the next batch fills the other one and releases it on
+     * scratch_free; a bank is only refilled after its release.
+     */
+    MLP_In_Type scratchpad[2][MAX_SAMPLE_NUM];
+    Sample_Tag_Type tags[2][MAX_SAMPLE_NUM];
+    void FillScratchpad() {
+        PEUBatch.ResetRead();
+        batch_ready.ResetWrite();
+        scratch_free.ResetRead();
+        ac_int<1, false> bank = 0;
+        ac_int<2, false> free_banks = 2;
+        bool own = false;           // bank claimed for the batch being filled
+        sample_cnt n = 0;
+        wait();
+
+        while (1) {
+            wait();
+
+            // scratch_free is polled in every cycle, TriggerMLP never waits on a release
+            bool f;
+            if (NRSIM_POPNB(scratch_free, f)) free_banks++;
+            if (!own) {
+                if (free_banks == 0) continue; // both banks still being replayed
+                free_banks--;
+                own = true;
+            }
+
+            MLP_In_Type x;
+            if (NRSIM_POPNB(PEUBatch, x)) {
+                tags[bank][n].ray = x.ray;
+                tags[bank][n].delta = x.delta;
+                tags[bank][n].wbank = x.wbank;
+                tags[bank][n].isLastSample = x.isLastSample;
+                x.isLastSample = x.isLastSample || (n == MAX_SAMPLE_NUM-1); // split batches larger than a bank
+                scratchpad[bank][n] = x;
+                if (x.isLastSample) {
+                    while (!NRSIM_PUSHNB(batch_ready, sample_cnt(n+1))) {
+                        wait();
+                        if (NRSIM_POPNB(scratch_free, f)) free_banks++;
+                    }
+                    bank = bank ^ 1;
+                    own = false;
+                    n = 0;
+                } else {
+                    n++;
+                }
+            }
+        }
+    }
+
+    void TriggerMLP() {
+        batch_ready.ResetRead();
+        scratch_free.ResetWrite();
+        MLPInput.ResetWrite();
+        tag_enq.ResetWrite();
+        ac_int<1, false> bank = 0;
+        sample_cnt keep[MAX_SAMPLE_NUM];
+        #pragma hls_unroll
+        for (int b = 0; b < WEIGHT_BANKS; b++) {
+            samples_skipped[b] = 0;
+        }
+        batches = 0;
+        replayed_samples = 0;
+        mlp_dropped = 0;
+        wait();
+
+        while (1) {
+            wait();
+
+            sample_cnt num;
+            if (NRSIM_POPNB(batch_ready, num)) {
+                // Drop the samples of rays terminated meanwhile, the batch's last sample stays (batch end)
+                sample_cnt kept = 0;
+                #pragma hls_pipeline_init_interval 1
+                for (uint n = 0; n < num; n++) {
+                    Sample_Tag_Type t = tags[bank][n];
+                    if (n == num-1 || t.isLastSample || !Terminated(t.ray)) {
+                        keep[kept] = n;
+                        kept++;
+                        NRSIM_PUSH(tag_enq, t);
+                    } else {
+                        samples_skipped[t.wbank]++;
+                        mlp_dropped++;
+                    }
+                }
+                for (uint p = 0; p < MLP_ENGINE::INPUT_PASSES; p++) {
+                    #pragma hls_pipeline_init_interval 1
+                    for (uint k = 0; k < kept; k++) {
+                        NRSIM_PUSH(MLPInput, scratchpad[bank][keep[k]]);
+                    }
+                }
+                replayed_samples += kept.to_int() * MLP_ENGINE::INPUT_PASSES;
+                batches++;
+                NRSIM_PUSH(scratch_free, true);
+                bank = bank ^ 1;
+            }
+        }
+    }
+
     void MLP_to_VRU() {
         MLPOutput.ResetRead();
+        tag_deq.ResetRead();
         VRUInput.ResetWrite();
+        ray_retire.ResetWrite();
+        #pragma hls_unroll
+        for (int b = 0; b < WEIGHT_BANKS; b++) {
+            samples_retired[b] = 0;
+        }
         wait();
 
         while (1) {
             wait();
             MLP_Out_Type m;
             VRU_In_Type v;
-            if (MLPOutput.PopNB(m)) {
+            if (NRSIM_POPNB(MLPOutput, m)) {
+                Sample_Tag_Type t = NRSIM_POP(tag_deq); // pushed before the sample entered the MLP
                 for (int i = 0; i < 3; i++)
                     v.emitted_c[i] = m.X[i];
                 v.sigma = m.X[3];
-                v.delta = VRU_Delta_Type(0.1); // Placeholder. TODO: change this
-                VRUInput.Push(v);
+                v.delta = t.delta;
+                v.ray = t.ray;
+                v.isLastSample = t.isLastSample;
+                samples_retired[t.wbank]++;
+                NRSIM_PUSH(VRUInput, v);
+                if (t.isLastSample) NRSIM_PUSH(ray_retire, t.ray);
             }
         }
     }
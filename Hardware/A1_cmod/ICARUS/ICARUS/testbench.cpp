@@ -1,16 +1,20 @@
 #define NVHLS_VERIFY_BLOCKS (ICARUS)
 #include "ICARUS.h"
+#include "DMA.h"
 #include <nvhls_verify.h>
 //#include <mc_scverify.h>
 #include "nvhls_connections.h"
 #include "ac_sysc_trace.h"
 #include <random>
+#include <algorithm>
 //#include <ac_channel.h>
 #include <systemc.h>
 #include <nvhls_module.h>
 #include <mc_connections.h>
 
-#define SAMPLE_NUM 192
+#define RAY_NUM 4
+#define RAY_SAMPLES 96
+#define SAMPLE_NUM (RAY_NUM*RAY_SAMPLES)
 
 class Top : public sc_module {
 public:
@@ -18,49 +22,53 @@ public:
     sc_signal<bool> rst;
 
     Connections::Combinational<ICARUS_Op_In_Type> ICARUS_Op;
-    Connections::Combinational<VRU_Out_Type> VRU_out;                // TODO: should connect to buffer, then write to memory
+    Connections::Combinational<DMA_Req_Type> dma_req;
+    Connections::Combinational<PEU_In_Type> pos_in;
+    Connections::Combinational<MemReq> memory_req_in;
+    Connections::Combinational<VRU_Out_Type> VRU_out;
 
-    Connections::Buffer<PEU_In_Type, SAMPLE_NUM> pos_in;             // TODO: should be offchip memory access
-    Connections::Combinational<PEU_In_Type> pos_in_enq;
-    Connections::Combinational<PEU_In_Type> pos_in_deq;
-
-    Connections::Buffer<MemReq, 1024> memory_req_in;  // TODO: should be offchip memory access
-    // There's a limit in terms of buffer depth, just put 1024 here, will latter test for correctness
+    DMA dma;                               // off-chip memory behind pos_in / memory_req_in / VRU_out
+    NVHLS_DESIGN(ICARUS<>) dut;            // ICARUS<ICARUS_MLP_ENGINE>
+//    CCS_DESIGN(SDAcc) CCS_INIT_S1(dut);
 
-    Connections::Combinational<MemReq> memory_req_in_enq;
-    Connections::Combinational<MemReq> memory_req_in_deq;
+    bool backdoor;                         // ./sim_ICARUS backdoor: both scenes preloaded, no WEIGHT_INIT
+    bool swap;                             // ./sim_ICARUS swap: load bank 1, swap and read right away
+    unsigned scene_reqs;                   // MemReqs of one scene (MEMREQ_BURST elements each)
 
-    NVHLS_DESIGN(ICARUS) dut;
-//    CCS_DESIGN(SDAcc) CCS_INIT_S1(dut);
+    // Off-chip memory layout (element offsets per region)
+    static const unsigned WEIGHT_BASE = 0;
+    static const unsigned POS_BASE = 0;
+    static const unsigned OUT_BASE = 0;
 
     SC_CTOR(Top) : clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
                    rst("rst"),
                    ICARUS_Op("ICARUS_Op"),
+                   dma_req("dma_req"),
+                   pos_in("pos_in"),
+                   memory_req_in("memory_req_in"),
                    VRU_out("VRU_out"),
-                   pos_in_enq("pos_in_enq"),
-                   pos_in_deq("pos_in_deq"),
-                   memory_req_in_enq("memory_req_in_enq"),
-                   memory_req_in_deq("memory_req_in_deq"),
-                   dut("dut") {
+                   dma("dma"),
+                   dut("dut"),
+                   backdoor(false),
+                   swap(false),
+                   scene_reqs(0) {
 
         sc_object_tracer<sc_clock> trace_clk(clk);
 
         dut.clk(clk);
         dut.rst(rst);
         dut.ICARUS_Op(ICARUS_Op);
-        dut.pos_in(pos_in_deq);
-        dut.memory_req_in(memory_req_in_deq);
+        dut.dma_req(dma_req);
+        dut.pos_in(pos_in);
+        dut.memory_req_in(memory_req_in);
         dut.VRU_out(VRU_out);
 
-        pos_in.clk(clk);
-        pos_in.rst(rst);
-        pos_in.enq(pos_in_enq);
-        pos_in.deq(pos_in_deq);
-
-        memory_req_in.clk(clk);
-        memory_req_in.rst(rst);
-        memory_req_in.enq(memory_req_in_enq);
-        memory_req_in.deq(memory_req_in_deq);
+        dma.clk(clk);
+        dma.rst(rst);
+        dma.DMAReq(dma_req);
+        dma.pos_out(pos_in);
+        dma.memreq_out(memory_req_in);
+        dma.vru_in(VRU_out);
 
         SC_THREAD(reset);
         sensitive << clk.posedge_event();
@@ -72,6 +80,10 @@ public:
         SC_THREAD(collect);
         sensitive << clk.posedge_event();
         async_reset_signal_is(rst, false);
+
+        SC_THREAD(check_swap);
+        sensitive << clk.posedge_event();
+        async_reset_signal_is(rst, false);
     }
 
     void reset() {
@@ -80,100 +92,225 @@ public:
         rst.write(true);
     }
 
-    void run() {
-        ICARUS_Op.ResetWrite();
-        pos_in_enq.ResetWrite();
-        memory_req_in_enq.ResetWrite();
-        wait(10);
-/*
-        // Write to matrix A memory 128x3
+    // Weight write w of a scene: to off-chip memory, or with backdoor into weight bank wbank directly
+    void StoreWeight(unsigned w, wbank_type wbank, MemReq q) {
+        if (backdoor) {
+            q.wbank = wbank;
+            dut.PreloadWeight(q);
+        } else {
+            dma.WriteWeight(w, q);
+        }
+    }
+
+    // MLP1 weight (i, j) of the scene written with scale
+    static MLP_Weight_Type SceneW1(int i, int j, double scale) { return MLP_Weight_Type(scale*(i*MLP1_IN_DIM+j)); }
+
+    // Scene weights (matrix A and layers) to off-chip memory from base (bank wbank), returns the MemReq count
+    unsigned WriteScene(unsigned base, wbank_type wbank, double scale) {
+        unsigned w = base;
+
+        // Write to matrix A memory 128x3 (off-chip, backdoor)
         cout << "Matrix A (128x3): " << endl;
         for (int i = 0; i < PEU_CORDIC_IN_DIM; i++) {
-            for (int j = 0; j < PEU_INPUT_DIM; j++) {
+            for (int j = 0; j < PEU_INPUT_DIM; j += MEMREQ_BURST) {
                 MemReq req1;
                 req1.index[0] = i;
                 req1.index[1] = j;
+                req1.len = std::min(MEMREQ_BURST, PEU_INPUT_DIM - j);
                 int power = i / 3;
-                if (j == i % 3) {
-                    // not quite the same as mentioned in paper, here hust test matrix-vector and cordic functionalities
-                    req1.data = PEU_Matrix_A_Type((1 << power)/3.141592653589793);
-                } else {
-                    req1.data = PEU_Matrix_A_Type(0);
+                for (int k = 0; k < req1.len; k++) {
+                    if (j + k == i % 3) {
+                        // not quite the same as mentioned in paper, here hust test matrix-vector and cordic functionalities
+                        req1.data[k] = PEU_Matrix_A_Type((1 << power)/3.141592653589793);
+                    } else {
+                        req1.data[k] = PEU_Matrix_A_Type(0);
+                    }
                 }
                 req1.forMLP0 = false;
                 req1.forPEU = true;
-                memory_req_in_enq.Push(req1);
+                req1.isBias = false;
+                StoreWeight(w++, wbank, req1);
             }
-            cout << endl;
         }
-
+/*
         // Write to layer0 weight memory 256x256
         cout << "Weight memory (256x256): " << endl;
         for (int i = 0; i < MLP0_OUT_DIM; i++) {
-            for (int j = 0; j < MLP0_IN_DIM; j++) {
+            for (int j = 0; j < MLP0_IN_DIM; j += MEMREQ_BURST) {
                 MemReq req1;
                 req1.index[0] = i;
                 req1.index[1] = j;
-                req1.data = MLP_Weight_Type(0.001*(i*MLP0_IN_DIM+j));
+                req1.len = std::min(MEMREQ_BURST, MLP0_IN_DIM - j);
+                for (int k = 0; k < req1.len; k++) req1.data[k] = MLP_Weight_Type(scale*(i*MLP0_IN_DIM+j+k));
                 req1.forMLP0 = true;
                 req1.forPEU = false;
-                memory_req_in_enq.Push(req1);
+                req1.isBias = false;
+                StoreWeight(w++, wbank, req1);
             }
         }
-        cout << "Finish writing to layer0 @ " << sc_time_stamp() << endl;
 */
         // Write to layer1 weight memory 4x256
         cout << "Weight memory (4x256): " << endl;
         for (int i = 0; i < MLP1_OUT_DIM; i++) {
-            for (int j = 0; j < MLP1_IN_DIM; j++) {
+            for (int j = 0; j < MLP1_IN_DIM; j += MEMREQ_BURST) {
                 MemReq req1;
                 req1.index[0] = i;
                 req1.index[1] = j;
-                req1.data = MLP_Weight_Type(0.001*(i*MLP1_IN_DIM+j));
+                req1.len = std::min(MEMREQ_BURST, MLP1_IN_DIM - j);
+                for (int k = 0; k < req1.len; k++) req1.data[k] = SceneW1(i, j+k, scale);
                 req1.forMLP0 = false;
                 req1.forPEU = false;
-                memory_req_in_enq.Push(req1);
+                req1.isBias = false;
+                StoreWeight(w++, wbank, req1);
             }
         }
-        cout << "Finish writing to layer1 @ " << sc_time_stamp() << endl;
+        return w - base;
+    }
 
-        // Random input Poly input
+    // Random input Poly input
+    void WritePositions() {
         for (int i = 0; i < SAMPLE_NUM; i++) {
             PEU_In_Type pos;
             pos.X[0] = PEU_Position_Type(i*0.1);
             pos.X[1] = PEU_Position_Type(i*0.1);
             pos.X[2] = PEU_Position_Type(i*0.1);
-            pos.isLastSample = (i == SAMPLE_NUM-1);
-            pos_in_enq.Push(pos);
+            int s = i % RAY_SAMPLES;
+            pos.delta = PEU_Delta_Type(0.5 + 1.5*s/RAY_SAMPLES); // sample spacing grows along the ray
+            pos.isLastSample = (s == RAY_SAMPLES-1);
+            dma.WritePos(POS_BASE + i, pos);
         }
-        cout << "Finish writing to pos @ " << sc_time_stamp() << endl;
+    }
+
+    void run() {
+        ICARUS_Op.ResetWrite();
+
+        if (swap) {
+            RunSwap();
+            return;
+        }
+
+        // Two scenes, the second one loaded into the other weight bank while the first one renders
+        unsigned scene_num = WriteScene(WEIGHT_BASE, 0, 0.001);
+        scene_reqs = scene_num;
+        WriteScene(WEIGHT_BASE + scene_num, 1, 0.002);
 
+        WritePositions();
         wait(10);
 
-        // Start testing 
+        // Start testing: scene 0 on bank 0, scene 1 loaded into bank 1 meanwhile, swap, scene 1
+        ICARUS_Op_In_Type op_out;
+        op_out.mode = inst_type::SET_OUT;
+        op_out.addr = OUT_BASE;
+        ICARUS_Op.Push(op_out);
+
         ICARUS_Op_In_Type op_init;
-        op_init.mode = inst_type::WEIGHT_INIT;
-        op_init.num  = 1024;
+        op_init.mode  = inst_type::WEIGHT_INIT;
+        op_init.addr  = WEIGHT_BASE;
+        op_init.num   = scene_num;
+        op_init.wbank = 0;
+        if (!backdoor) ICARUS_Op.Push(op_init);
+
+        ICARUS_Op_In_Type op_run;
+        op_run.mode = inst_type::READ_POS;
+        op_run.addr = POS_BASE;
+        op_run.num  = SAMPLE_NUM/2;
+        ICARUS_Op.Push(op_run);
+
+        op_init.addr  = WEIGHT_BASE + scene_num;
+        op_init.wbank = 1;
+        if (!backdoor) ICARUS_Op.Push(op_init);
+
+        ICARUS_Op_In_Type op_swap;
+        op_swap.mode = inst_type::SWAP_WEIGHTS;
+        ICARUS_Op.Push(op_swap);
+
+        op_run.addr = POS_BASE + SAMPLE_NUM/2;
+        ICARUS_Op.Push(op_run);
+    }
+
+    /*
+     * Bank switch: bank 1 holds stale weights (scene 0, backdoor), WEIGHT_INIT loads scene 1 into it, SWAP_WEIGHTS
+     * and READ_POS follow at once. check_swap compares bank 1 with scene 1 when the READ_POS is dispatched.
+     */
+    void RunSwap() {
+        backdoor = true;
+        WriteScene(WEIGHT_BASE, 1, 0.001);
+        backdoor = false;
+        scene_reqs = WriteScene(WEIGHT_BASE, 1, 0.002);
+
+        WritePositions();
+        wait(10);
+
+        ICARUS_Op_In_Type op_out;
+        op_out.mode = inst_type::SET_OUT;
+        op_out.addr = OUT_BASE;
+        ICARUS_Op.Push(op_out);
+
+        ICARUS_Op_In_Type op_init;
+        op_init.mode  = inst_type::WEIGHT_INIT;
+        op_init.addr  = WEIGHT_BASE;
+        op_init.num   = scene_reqs;
+        op_init.wbank = 1;
         ICARUS_Op.Push(op_init);
 
+        ICARUS_Op_In_Type op_swap;
+        op_swap.mode = inst_type::SWAP_WEIGHTS;
+        ICARUS_Op.Push(op_swap);
+
         ICARUS_Op_In_Type op_run;
         op_run.mode = inst_type::READ_POS;
-        op_run.num  = 192;
+        op_run.addr = POS_BASE;
+        op_run.num  = SAMPLE_NUM;
         ICARUS_Op.Push(op_run);
     }
 
+    // swap mode: the first batch on bank 1 must find scene 1 in the MLP memory (MLP1 rows are loaded last)
+    void check_swap() {
+        wait();
+        if (!swap) return;
+        while (dut.samples_issued[1] == 0) wait();
+
+        unsigned mismatches = 0;
+        for (int i = 0; i < MLP1_OUT_DIM; i++) {
+            for (int j = 0; j < MLP1_IN_DIM; j++) {
+                if (dut.mlp->mlp1[1][i][j] != SceneW1(i, j, 0.002)) mismatches++;
+            }
+        }
+        cout << "Bank 1 at the first READ_POS: " << mismatches << " stale MLP1 weights"
+             << (mismatches == 0 ? " ✓" : " ✗ (MISMATCH)") << endl;
+    }
+
     void collect() {
-        VRU_out.ResetRead();
         while (1) {
             wait(); // 1 cc
 
-            VRU_Out_Type tmp;
-            tmp = VRU_out.Pop();
+            if (dma.out_written < RAY_NUM) continue;
+            wait(DMA_WRITE_COALESCE + 1); // let the last write burst go out
+
             cout << "ICARUSOutput: @ timestep: " << sc_time_stamp() << endl;
-            for (uint i = 0; i < 3; i++) {
-                cout << tmp.c[i] << " ";
+            for (uint r = 0; r < RAY_NUM; r++) {
+                VRU_Out_Type tmp = dma.ReadOut(OUT_BASE + r);
+                for (uint i = 0; i < 3; i++) {
+                    cout << tmp.c[i] << " ";
+                }
+                cout << endl;
             }
 
+            cout << "Early ray termination: " << dut.vru->terminated_rays << "/" << dut.rays << " rays, "
+                 << dut.cfg_dropped << " samples dropped before PEU, " << dut.mlp_dropped
+                 << " before MLP, " << dut.vru->ignored_samples << " reached VRU after termination ("
+                 << dut.pos_samples << " samples)" << endl;
+            cout << "Weight loads: " << dut.weight_loads << ", " << dut.load_cycles << " cycles, "
+                 << dut.overlap_cycles << " overlapped with a batch, " << dut.hazard_cycles
+                 << " cycles of bank hazards" << endl;
+            cout << "Weight bus: " << MEMREQ_BURST << " elements per MemReq (" << DMA::WEIGHT_BYTES
+                 << " B), " << scene_reqs << " MemReqs per scene" << endl;
+            cout << "DMA: " << dma.bytes_read << " B read in " << dma.read_bursts << " bursts, "
+                 << dma.bytes_written << " B written in " << dma.write_bursts << " bursts, "
+                 << dma.read_wait_cycles << " cycles waiting for read data" << endl;
+            cout << "DMA: bus utilization " << dma.BusUtilization() * 100 << "% of "
+                 << dma.BytesPerCycle() << " B/cycle over " << dma.cycle << " cycles" << endl;
+
             sc_stop();
         }
     }
@@ -181,6 +318,8 @@ public:
 
 int sc_main(int argc, char *argv[]) {
     Top tb("tb");
+    tb.backdoor = (argc > 1 && std::string(argv[1]) == "backdoor");
+    tb.swap = (argc > 1 && std::string(argv[1]) == "swap");
     sc_start();
     return 0;
 }
@@ -11,22 +11,34 @@
  * Input: [--256 dimensional vector--]
  * Output: [--4 dimensional vector--]
  * Perform: MLP0 (256x256), MLP1 (256x4)
+ * act_mem / out_mem are ping-pong buffered: Monb fills one act_mem bank with batch k+1 while Sonb
+ * reads batch k from the other, and Output streams out_mem of batch k while Sonb computes batch k+1,
+ * so a batch takes max(Monb, Sonb) cycles in steady state instead of Monb + Sonb.
  */
-class MLP : public match::Module {
-    SC_HAS_PROCESS(MLP);
+class MLP_block : public match::Module {
+    SC_HAS_PROCESS(MLP_block);
 public:
 
+    // Times a batch is streamed into MLPInput (once per BLOCK_SZ x BLOCK_SZ submatrix of MLP0)
+    static const int INPUT_PASSES = (MLP0_OUT_DIM/BLOCK_SZ) * (MLP0_IN_DIM/BLOCK_SZ);
+
     Connections::In<MemReq> memreq; // For write request to memory
     Connections::In<MLP_In_Type> MLPInput;
     Connections::Out<MLP_Out_Type> MLPOutput;
 
-    Connections::Combinational<sample_cnt> sample_num;
+    Connections::Combinational<MLP_Batch_Type> sample_num; // Monb -> Sonb, act_mem bank filled
+    Connections::Combinational<bool> act_free;             // Sonb -> Monb, act_mem bank released
+    Connections::Combinational<sample_cnt> out_num;        // Sonb -> Output, out_mem bank filled
+    Connections::Combinational<bool> out_free;             // Output -> Sonb, out_mem bank released
     
-    MLP(sc_module_name name) : match::Module(name),
-                               memreq("memreq"),
-                               MLPInput("MLPInput"),
-                               MLPOutput("MLPOutput"),
-                               sample_num("sample_num") {
+    MLP_block(sc_module_name name) : match::Module(name),
+                                     memreq("memreq"),
+                                     MLPInput("MLPInput"),
+                                     MLPOutput("MLPOutput"),
+                                     sample_num("sample_num"),
+                                     act_free("act_free"),
+                                     out_num("out_num"),
+                                     out_free("out_free") {
         SC_THREAD(InitializeMLP);
         sensitive << clk.pos();
         async_reset_signal_is(rst, false);
@@ -38,14 +50,25 @@ public:
         SC_THREAD(Sonb);
         sensitive << clk.pos();
         async_reset_signal_is(rst, false);
+
+        SC_THREAD(Output);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
     }
 
+    // Statistics
+    unsigned long batches;          // batches finished by Sonb
+    unsigned long monb_cycles;      // cycles Monb computed (one sample x submatrix per cycle)
+    unsigned long monb_stall;       // cycles Monb waited for Sonb to release an act_mem bank
+    unsigned long sonb_cycles;      // cycles Sonb computed (one sample x BLOCK_SZ MACs per cycle)
+    unsigned long sonb_stall;       // cycles Sonb waited for Output to release an out_mem bank
+
     // Layer0 weight memory
-    MLP_Weight_Type mlp0[MLP0_OUT_DIM][MLP0_IN_DIM];
-    MLP_Weight_Type mlp0_bias[MLP0_OUT_DIM];
+    MLP_Weight_Type mlp0[WEIGHT_BANKS][MLP0_OUT_DIM][MLP0_IN_DIM];
+    MLP_Weight_Type mlp0_bias[WEIGHT_BANKS][MLP0_OUT_DIM];
     // Layer1 weight memory
-    MLP_Weight_Type mlp1[MLP1_OUT_DIM][MLP1_IN_DIM];
-    MLP_Weight_Type mlp1_bias[MLP1_OUT_DIM];
+    MLP_Weight_Type mlp1[WEIGHT_BANKS][MLP1_OUT_DIM][MLP1_IN_DIM];
+    MLP_Weight_Type mlp1_bias[WEIGHT_BANKS][MLP1_OUT_DIM];
     /*
      * Dummy memory to write to (may be replaced with technology dependent memory)
      */
@@ -56,18 +79,36 @@ public:
         while (1) {
             wait();
 
-            MemReq q = memreq.Pop();
+            MemReq q = NRSIM_POP(memreq);
             // assert((q.index[0] < MLP0_OUT_DIM) && (q.index[1] < MLP0_IN_DIM));
-            if (q.forMLP0) {
-                if (q.isBias) mlp0_bias[q.index[0]]        = q.data;
-                else          mlp0[q.index[0]][q.index[1]] = q.data;
-            } else {
-                if (q.isBias) mlp1_bias[q.index[0]]        = q.data;
-                else          mlp1[q.index[0]][q.index[1]] = q.data;
+            WriteMemReq(q);
+        }
+    }
+
+    // One MemReq into the memories: q.len weights of row index[0] from column index[1], biases from index[0]
+    void WriteMemReq(const MemReq &q) {
+        #pragma hls_unroll yes
+        for (int k = 0; k < MEMREQ_BURST; k++) {
+            if (k < q.len) {  // lanes past the burst write nothing
+                if (q.forMLP0) {
+                    if (q.isBias) mlp0_bias[q.wbank][q.index[0] + k]        = q.data[k];
+                    else          mlp0[q.wbank][q.index[0]][q.index[1] + k] = q.data[k];
+                } else {
+                    if (q.isBias) mlp1_bias[q.wbank][q.index[0] + k]        = q.data[k];
+                    else          mlp1[q.wbank][q.index[0]][q.index[1] + k] = q.data[k];
+                }
             }
         }
     }
 
+    /*
+     * Backdoor access for the testbench (C simulation only, no timing): one weight write straight into the
+     * memories, decoded as InitializeMLP does; used before / instead of streaming memreq (mlp_weights.h Preload)
+     */
+    void PreloadWeight(const MemReq &q) {
+        WriteMemReq(q);
+    }
+
     /* 
      * Multi-Output Network Block
      * Input: 256-dimensional data
@@ -75,22 +116,44 @@ public:
      * Processing order: 1. inner loops for 64x64 submatrix            (ii, jj)
      *                   2. pipelined samples (weight stationary)      (cnt)
      *                   3. outer loops for which row/col of submatrix (i, j)
-     * cycles: 16*192
+     * cycles: INPUT_PASSES*num per batch
      */
-    // temporary memory
-    MLP1_In_Elem_Type act_mem[MLP0_OUT_DIM][MAX_SAMPLE_NUM];
+    // temporary memory, ping-pong between Monb and Sonb
+    MLP1_In_Elem_Type act_mem[2][MLP0_OUT_DIM][MAX_SAMPLE_NUM];
     void Monb() {
         sample_cnt cnt = 0; // which sample (pipelined in)
         uint i=0, j=0;      // which submatrices
+        ac_int<1, false> bank = 0;
+        ac_int<2, false> free_banks = 2;
         MLPInput.Reset();
         sample_num.ResetWrite();
+        act_free.ResetRead();
+        monb_cycles = 0;
+        monb_stall = 0;
         wait();
 
 // #pragma hls_pipeline_init_interval 1
         while (1) {
             wait();
 
-            MLP_In_Type vec_in = MLPInput.Pop();
+            // act_free is polled in every cycle, Sonb never waits on a release
+            bool f;
+            if (NRSIM_POPNB(act_free, f)) free_banks++;
+            if (cnt == 0 && i == 0 && j == 0) { // first write of a batch, claim a bank
+                while (free_banks == 0) {
+                    monb_stall++;
+                    wait();
+                    if (NRSIM_POPNB(act_free, f)) free_banks++;
+                }
+                free_banks--;
+            }
+
+            MLP_In_Type vec_in;
+            while (!NRSIM_POPNB(MLPInput, vec_in)) {
+                wait();
+                if (NRSIM_POPNB(act_free, f)) free_banks++;
+            }
+            monb_cycles++;
 
 #ifdef USE_FLOAT
             MLP1_In_Elem_Type acc[BLOCK_SZ]; // accumulator (reg);
@@ -103,32 +166,39 @@ public:
 #pragma unroll
             for (uint ii = 0; ii < BLOCK_SZ; ii++) {                            // submatrix row
 #ifdef USE_FLOAT
-                acc[ii] = (j == 0) ? mlp0_bias[i+ii] : act_mem[i+ii][cnt];      // load from temporary memory
+                acc[ii] = (j == 0) ? mlp0_bias[vec_in.wbank][i+ii] : act_mem[bank][i+ii][cnt];      // load from temporary memory
 #pragma unroll
                 for (uint jj = 0; jj < BLOCK_SZ; jj++) {                        // submatrix col
-                    acc[ii] += mlp0[i+ii][j+jj] * vec_in.X[j+jj];
+                    acc[ii] += mlp0[vec_in.wbank][i+ii][j+jj] * vec_in.X[j+jj];
                 }
                 MLP1_In_Elem_Type tmp = acc[ii];
                 if (j == (MLP0_IN_DIM-BLOCK_SZ) && (acc[ii] < MLP1_In_Elem_Type(0))) { // ReLU
                     tmp = MLP1_In_Elem_Type(0);
                 }
-                act_mem[i+ii][cnt] = tmp;
+                act_mem[bank][i+ii][cnt] = tmp;
 #else
-                acc[ii] = (j == 0) ? SUM_TYPE(mlp0_bias[i+ii] << nvhls::log2_ceil<SCALE>::val) : 
-                                     SUM_TYPE(act_mem[i+ii][cnt] << nvhls::log2_ceil<SCALE>::val); // load bias or psum
+                acc[ii] = (j == 0) ? SUM_TYPE(mlp0_bias[vec_in.wbank][i+ii] << nvhls::log2_ceil<SCALE>::val) : 
+                                     SUM_TYPE(act_mem[bank][i+ii][cnt] << nvhls::log2_ceil<SCALE>::val); // load bias or psum
 #pragma unroll
                 for (uint jj = 0; jj < BLOCK_SZ; jj++) {                        // submatrix col
-                    PROD_TYPE m = mlp0[i+ii][j+jj] * vec_in.X[j+jj];
+                    PROD_TYPE m = mlp0[vec_in.wbank][i+ii][j+jj] * vec_in.X[j+jj];
                     acc[ii] += m;
                 }
                 if (j == (MLP0_IN_DIM-BLOCK_SZ) && acc[ii] < MLP1_In_Elem_Type(0)) { // ReLU
                     acc[ii] = MLP1_In_Elem_Type(0);
                 }
-                act_mem[i+ii][cnt] = acc[ii] >> nvhls::log2_ceil<SCALE>::val;
+                act_mem[bank][i+ii][cnt] = acc[ii] >> nvhls::log2_ceil<SCALE>::val;
 #endif
             }
             if ((i == MLP0_OUT_DIM-BLOCK_SZ) && j == (MLP0_IN_DIM-BLOCK_SZ) && vec_in.isLastSample) {
-                sample_num.Push(cnt+1); // trigger sonb after processing last submatrix (can be earlier)
+                MLP_Batch_Type batch;
+                batch.num = cnt+1;
+                batch.wbank = vec_in.wbank;
+                while (!NRSIM_PUSHNB(sample_num, batch)) { // trigger sonb after processing last submatrix
+                    wait();
+                    if (NRSIM_POPNB(act_free, f)) free_banks++;
+                }
+                bank = bank ^ 1;
             }
             cnt = (vec_in.isLastSample) ? sample_cnt(0) : sample_cnt(cnt+1);
             i = (vec_in.isLastSample) ? 
@@ -141,18 +211,38 @@ public:
      * Single Output Network Block
      * Input: 256-dimensional data
      * Output: 4-dimensional data (r,g,b,\sigma)
-     * cycles: 16*192 (can be overlapped with Monb by adjusting the timing of pushing sample_num)
+     * cycles: MLP1_OUT_DIM*MLP1_IN_DIM/BLOCK_SZ*num per batch, overlapped with Monb of the next batch
      */
-    MLP1_In_Elem_Type out_mem[MLP1_OUT_DIM][MAX_SAMPLE_NUM];
+    MLP1_In_Elem_Type out_mem[2][MLP1_OUT_DIM][MAX_SAMPLE_NUM];
     void Sonb() {
         sample_num.ResetRead();
-        MLPOutput.Reset();
+        act_free.ResetWrite();
+        out_num.ResetWrite();
+        out_free.ResetRead();
+        ac_int<1, false> bank = 0;  // act_mem bank, follows Monb
+        ac_int<1, false> obank = 0; // out_mem bank, followed by Output
+        ac_int<2, false> free_obanks = 2;
+        batches = 0;
+        sonb_cycles = 0;
+        sonb_stall = 0;
 
         wait();
         while (1) {
             wait();
             
-            sample_cnt num = sample_num.Pop(); // wait for Monb to finish
+            // out_free is polled in every cycle, Output never waits on a release
+            bool f;
+            if (NRSIM_POPNB(out_free, f)) free_obanks++;
+            MLP_Batch_Type batch;
+            if (!NRSIM_POPNB(sample_num, batch)) continue; // wait for Monb to finish
+            sample_cnt num = batch.num;
+            wbank_type wbank = batch.wbank;
+            while (free_obanks == 0) {
+                sonb_stall++;
+                wait();
+                if (NRSIM_POPNB(out_free, f)) free_obanks++;
+            }
+            free_obanks--;
 
             MLP1_In_Type vec_in;
             MLP_Out_Elem_Type acc; // accumulator (reg);
@@ -160,37 +250,71 @@ public:
                 for (uint j = 0; j < MLP1_IN_DIM; j+=BLOCK_SZ) {
 // #pragma hls_pipeline_init_interval 1
                     for (uint n = 0; n < num; n++) {
+                        if (i > 0 || j > 0 || n > 0) {
+                            wait();
+                            if (NRSIM_POPNB(out_free, f)) free_obanks++;
+                        }
+                        sonb_cycles++;
 #ifdef USE_FLOAT
-                        MLP_Out_Elem_Type acc = (j == 0) ? mlp1_bias[i] : out_mem[i][n];
+                        MLP_Out_Elem_Type acc = (j == 0) ? mlp1_bias[wbank][i] : out_mem[obank][i][n];
 #pragma unroll
                         for (uint jj = 0; jj < BLOCK_SZ; jj++) {
-                            acc += mlp1[i][j+jj] * act_mem[j+jj][n]; // adder tree
+                            acc += mlp1[wbank][i][j+jj] * act_mem[bank][j+jj][n]; // adder tree
                         }
-                        out_mem[i][n] = acc;
+                        out_mem[obank][i][n] = acc;
 #else
                         typedef MLP1_In_Elem_Type::rt_T<MLP_Weight_Type>::mult PROD_TYPE;
                         typedef PROD_TYPE::rt_unary::set<MLP1_IN_DIM>::sum SUM_TYPE;
-                        SUM_TYPE acc = (j == 0) ? SUM_TYPE(mlp1_bias[i] << nvhls::log2_ceil<SCALE>::val) : 
-                                                  SUM_TYPE(out_mem[i][n] << nvhls::log2_ceil<SCALE>::val); // load bias or psum
+                        SUM_TYPE acc = (j == 0) ? SUM_TYPE(mlp1_bias[wbank][i] << nvhls::log2_ceil<SCALE>::val) : 
+                                                  SUM_TYPE(out_mem[obank][i][n] << nvhls::log2_ceil<SCALE>::val); // load bias or psum
 #pragma unroll
                         for (uint jj = 0; jj < BLOCK_SZ; jj++) {
-                            PROD_TYPE m = mlp1[i][j+jj] * act_mem[j+jj][n];
+                            PROD_TYPE m = mlp1[wbank][i][j+jj] * act_mem[bank][j+jj][n];
                             acc += m; // adder tree
                         }
-                        out_mem[i][n] = acc >> nvhls::log2_ceil<SCALE>::val; // Divided by 128
+                        out_mem[obank][i][n] = acc >> nvhls::log2_ceil<SCALE>::val; // Divided by 128
 #endif
                     }
                 }
             }
 
-            for (uint n = 0; n < num; n++) {
-                MLP_Out_Type vec_out;
+            NRSIM_PUSH(act_free, true);
+            while (!NRSIM_PUSHNB(out_num, num)) {
+                wait();
+                if (NRSIM_POPNB(out_free, f)) free_obanks++;
+            }
+            bank = bank ^ 1;
+            obank = obank ^ 1;
+            batches++;
+        }
+    }
+
+    /*
+     * Stream a finished out_mem bank, one sample per cycle
+     */
+    void Output() {
+        out_num.ResetRead();
+        out_free.ResetWrite();
+        MLPOutput.Reset();
+        ac_int<1, false> obank = 0;
+
+        wait();
+        while (1) {
+            wait();
+
+            sample_cnt num;
+            if (NRSIM_POPNB(out_num, num)) {
+                for (uint n = 0; n < num; n++) {
+                    MLP_Out_Type vec_out;
 #pragma unroll
-                for (uint i = 0; i < MLP1_OUT_DIM; i++) {
-                    vec_out.X[i] = out_mem[i][n];
+                    for (uint i = 0; i < MLP1_OUT_DIM; i++) {
+                        vec_out.X[i] = out_mem[obank][i][n];
+                    }
+                    vec_out.isLastSample = (n == num-1);
+                    NRSIM_PUSH(MLPOutput, vec_out);
                 }
-                vec_out.isLastSample = (n == num-1);
-                MLPOutput.Push(vec_out);
+                NRSIM_PUSH(out_free, true);
+                obank = obank ^ 1;
             }
         }
     }
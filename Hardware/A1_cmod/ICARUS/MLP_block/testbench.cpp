@@ -1,4 +1,4 @@
-#define NVHLS_VERIFY_BLOCKS (MLP)
+#define NVHLS_VERIFY_BLOCKS (MLP_block)
 #include "MLP_block.h"
 #include <nvhls_verify.h>
 //#include <mc_scverify.h>
@@ -9,9 +9,10 @@
 #include <systemc.h>
 #include <nvhls_module.h>
 #include <mc_connections.h>
-#include "mlp_test.h"
+#include "mlp_weights.h"
 
 #define SAMPLE_NUM 192
+#define BATCH_NUM 3     // batches back to back, Monb of batch k+1 overlaps Sonb of batch k
 
 class Top : public sc_module {
 public:
@@ -22,7 +23,7 @@ public:
     Connections::Combinational<MLP_In_Type> MLPInput;
     Connections::Combinational<MLP_Out_Type> MLPOutput;
 
-    NVHLS_DESIGN(MLP) dut;
+    NVHLS_DESIGN(MLP_block) dut;
 //    CCS_DESIGN(SDAcc) CCS_INIT_S1(dut);
 
     SC_CTOR(Top) : clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
@@ -63,66 +64,32 @@ public:
         MLPInput.ResetWrite();
         wait(10);
         
-        // Write to layer0 weight memory 256x256
-        cout << "Weight memory (256x256): " << endl;
-        for (int i = 0; i < MLP0_OUT_DIM; i++) {
-            MemReq req1;
-            for (int j = 0; j < MLP0_IN_DIM; j++) {
-                req1.index[0] = i;
-                req1.index[1] = j;
-                req1.data = MLP_Weight_Type(mlp0_weight[i][j]);
-                req1.forMLP0 = true;
-                req1.isBias = false;
-                memreq.Push(req1);
-            }
-            req1.index[0] = i;
+        // Write both layers to weight memory (bank 0)
+        cout << "Weight memory (" << MLP0_OUT_DIM << "x" << MLP0_IN_DIM << ", " << MLP1_OUT_DIM << "x" << MLP1_IN_DIM << "): " << endl;
 #ifdef USE_FLOAT
-            req1.data = MLP_Weight_Type(mlp0_bias[i]*SCALE); // scale up
+        if (mlp_backdoor) mlp_weights.Preload(dut, 0, SCALE, SCALE*SCALE);
+        else              mlp_weights.StreamMemReq(memreq, 0, SCALE, SCALE*SCALE); // scale up biases
 #else
-            req1.data = MLP_Weight_Type(mlp0_bias[i]);
+        if (mlp_backdoor) mlp_weights.Preload(dut, 0);
+        else              mlp_weights.StreamMemReq(memreq, 0);
 #endif
-            req1.forMLP0 = true;
-            req1.isBias = true;
-            memreq.Push(req1);
-        }
-        cout << "Finish writing to layer0 @ " << sc_time_stamp() << endl;
-
-        // Write to layer1 weight memory 4x256
-        cout << "Weight memory (4x256): " << endl;
-        for (int i = 0; i < MLP1_OUT_DIM; i++) {
-            MemReq req1;
-            for (int j = 0; j < MLP1_IN_DIM; j++) {
-                req1.index[0] = i;
-                req1.index[1] = j;
-                req1.data = MLP_Weight_Type(mlp1_weight[i][j]);
-                req1.forMLP0 = false;
-                req1.isBias = false;
-                memreq.Push(req1);
-            }
-            req1.index[0] = i;
-#ifdef USE_FLOAT
-            req1.data = MLP_Weight_Type(mlp1_bias[i]*SCALE*SCALE); // scale up
-#else
-            req1.data = MLP_Weight_Type(mlp1_bias[i]);
-#endif
-            req1.forMLP0 = false;
-            req1.isBias = true;
-            memreq.Push(req1);
-        }
-        cout << "Finish writing to layer1 @ " << sc_time_stamp() << endl;
+        cout << "Finish writing weights @ " << sc_time_stamp() << endl;
 
 
         wait(10);
 
         // Random inputs
-        for (int _ = 0; _ < MLP0_IN_DIM/64 * MLP0_OUT_DIM/64; _++) {
-            for (int i = 0; i < SAMPLE_NUM; i++) {
-                MLP_In_Type vec;
-                for (int j = 0; j < MLP0_IN_DIM; j++) {
-                    vec.X[j] = MLP_In_Elem_Type(test_input[i][j]);
+        for (int b = 0; b < BATCH_NUM; b++) {
+            for (int _ = 0; _ < MLP_block::INPUT_PASSES; _++) {
+                for (int i = 0; i < SAMPLE_NUM; i++) {
+                    MLP_In_Type vec;
+                    vec.wbank = 0;
+                    for (int j = 0; j < MLP0_IN_DIM; j++) {
+                        vec.X[j] = MLP_In_Elem_Type(mlp_weights.In(i, j));
+                    }
+                    vec.isLastSample = (i == SAMPLE_NUM-1);
+                    MLPInput.Push(vec);
                 }
-                vec.isLastSample = (i == SAMPLE_NUM-1);
-                MLPInput.Push(vec);
             }
         }
     }
@@ -132,26 +99,44 @@ public:
         while (1) {
             wait(); // 1 cc
 
-            float acc = 0;
-            for (int i = 0; i < SAMPLE_NUM; i++) {
-                MLP_Out_Type tmp;
-                tmp = MLPOutput.Pop();
-                cout << "MLPOutput: @ timestep: " << sc_time_stamp() << endl;
-                cout << "Sample " << i << ": ";
-                for (uint j = 0; j < MLP1_OUT_DIM; j++) {
+            sc_time done[BATCH_NUM];
+            for (int b = 0; b < BATCH_NUM; b++) {
+                float acc = 0;
+                for (int i = 0; i < SAMPLE_NUM; i++) {
+                    MLP_Out_Type tmp;
+                    tmp = MLPOutput.Pop();
+                    if (b == 0) {
+                        cout << "MLPOutput: @ timestep: " << sc_time_stamp() << endl;
+                        cout << "Sample " << i << ": ";
+                    }
+                    for (uint j = 0; j < MLP1_OUT_DIM; j++) {
 #ifdef USE_FLOAT
-                    MLP_Out_Elem_Type _ = tmp.X[j]/(MLP_Out_Elem_Type(SCALE*SCALE*SCALE)); // scale down
-                    cout << _ << " ";
-                    acc += _.to_float() - test_output[i][j];
+                        MLP_Out_Elem_Type _ = tmp.X[j]/(MLP_Out_Elem_Type(SCALE*SCALE*SCALE)); // scale down
+                        if (b == 0) cout << _ << " ";
+                        acc += _.to_float() - mlp_weights.Out(i, j);
 #else
-                    MLP_Out_Elem_Type _ = tmp.X[j]; // scale down
-                    cout << float(_.to_int())/SCALE << " ";
-                    acc += float(_.to_int())/SCALE - test_output[i][j];
+                        MLP_Out_Elem_Type _ = tmp.X[j]; // scale down
+                        if (b == 0) cout << float(_.to_int())/SCALE << " ";
+                        acc += float(_.to_int())/SCALE - mlp_weights.Out(i, j);
 #endif
+                    }
+                    if (b == 0) cout << endl;
                 }
-                cout << endl;
+                done[b] = sc_time_stamp();
+                cout << "Batch " << b << " done @ " << done[b] << ", Avg Error: "
+                     << acc / (SAMPLE_NUM*MLP1_OUT_DIM) << endl;
+            }
+
+            // Steady state: interval between batch completions, vs. Monb and Sonb back to back
+            double monb = double(dut.monb_cycles) / BATCH_NUM;
+            double sonb = double(dut.sonb_cycles) / BATCH_NUM;
+            cout << "Monb: " << monb << " cycles/batch (" << dut.monb_stall << " stall cycles), Sonb: "
+                 << sonb << " cycles/batch (" << dut.sonb_stall << " stall cycles)" << endl;
+            if (BATCH_NUM > 1) {
+                double steady = (done[BATCH_NUM-1] - done[0]) / sc_time(1, SC_NS) / (BATCH_NUM-1);
+                cout << "Steady state: " << steady << " cycles/batch (serialized Monb + Sonb: "
+                     << monb + sonb << ", bound max(Monb, Sonb): " << (monb > sonb ? monb : sonb) << ")" << endl;
             }
-            cout << "Avg Error: " << acc / (SAMPLE_NUM*MLP1_OUT_DIM) << endl;
 
             sc_stop();
         }
@@ -159,6 +144,9 @@ public:
 };
 
 int sc_main(int argc, char *argv[]) {
+    std::string weights = (argc > 1) ? argv[1] : MLP_WEIGHTS_DEFAULT; // checkpoint written by mlp_test.py
+    mlp_backdoor = (argc > 2 && std::string(argv[2]) == "backdoor"); // no simulated weight load
+    if (!mlp_weights.Load(weights, SAMPLE_NUM)) return 1;
     Top tb("tb");
     sc_start();
     return 0;
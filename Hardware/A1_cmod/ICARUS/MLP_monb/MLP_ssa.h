@@ -88,15 +88,33 @@ public:
             wait();
 
             MemReq q;
-            if (memreq.PopNB(q)){
+            if (NRSIM_POPNB(memreq, q)){
+                WriteMemReq(q);
+            }
+        }
+    }
+
+    // One MemReq into the memory: q.len weights of row index[0] from column index[1], biases from index[0]
+    void WriteMemReq(const MemReq &q) {
+        #pragma hls_unroll yes
+        for (int k = 0; k < MEMREQ_BURST; k++) {
+            if (k < q.len) {  // lanes past the burst write nothing
                 if (q.forMLP0) {
-                    if (q.isBias) mlp0_bias[q.index[0]]        = q.data;
-                    else          mlp0[q.index[0]][q.index[1]] = q.data;
+                    if (q.isBias) mlp0_bias[q.index[0] + k]        = q.data[k];
+                    else          mlp0[q.index[0]][q.index[1] + k] = q.data[k];
                 }
             }
         }
     }
 
+    /*
+     * Backdoor access for the testbench (C simulation only, no timing): one weight write straight into the
+     * memory, decoded as InitializeMLP does; used before / instead of streaming memreq (mlp_weights.h Preload)
+     */
+    void PreloadWeight(const MemReq &q) {
+        WriteMemReq(q);
+    }
+
     // PCM to several SSAs
     void fanout_pcm () {
         #pragma unroll
@@ -113,10 +131,10 @@ public:
             wait();
             #pragma unroll
             for (int j = 0; j < BLOCK_SZ; j++) {
-                PCM_Out_Type tmp = PCM_out[j].Pop();
+                PCM_Out_Type tmp = NRSIM_POP(PCM_out[j]);
                 #pragma unroll
                 for (int i = 0; i < BLOCK_SZ; i++) {
-                    PCM_out_fanout[i][j].Push(tmp);
+                    NRSIM_PUSH(PCM_out_fanout[i][j], tmp);
                 }
             }
         }
@@ -134,9 +152,20 @@ public:
      */
     // temporary memory
     MLP1_In_Elem_Type act_mem[MLP0_OUT_DIM][MAX_SAMPLE_NUM];
+    // Statistics (zero skipping)
+    unsigned long monb_samples;        // samples through all MLP0 submatrices
+    unsigned long monb_grid_cycles;    // submatrix x sample issued to the BLOCK_SZ x BLOCK_SZ SSA grid
+    unsigned long monb_macs;           // MACs of MLP0 (BLOCK_SZ*BLOCK_SZ per submatrix x sample)
+    unsigned long monb_skipped_macs;   // MACs on zero activations (gated by pcm::is_zero or skipped with the block)
+    unsigned long monb_skipped_blocks; // all-zero activation blocks not sent to the grid (one cycle each)
     void Monb() {
         sample_cnt cnt = 0; // which sample (pipelined in)
         uint i=0, j=0;      // which submatrices
+        monb_samples = 0;
+        monb_grid_cycles = 0;
+        monb_macs = 0;
+        monb_skipped_macs = 0;
+        monb_skipped_blocks = 0;
         MLPInput.Reset();
         sample_num.ResetWrite();
         #pragma unroll
@@ -158,7 +187,7 @@ public:
         while (1) {
             wait();
 
-            MLP_In_Type vec_in = MLPInput.Pop();
+            MLP_In_Type vec_in = NRSIM_POP(MLPInput);
 
             typedef MUL_Out_Type::rt_unary::set<MLP0_IN_DIM>::sum SUM_TYPE;
             SUM_TYPE acc[BLOCK_SZ]; // accumulator (reg);
@@ -167,34 +196,56 @@ public:
                for (int jj = BLOCK_SZ-1; jj >= 0; jj--) { // 64 cc
                     #pragma unroll
                     for (int ii = 0; ii < BLOCK_SZ; ii++) { 
-                        w_in[ii].Push(mlp0[i+ii][j+jj]); 
+                        NRSIM_PUSH(w_in[ii], mlp0[i+ii][j+jj]); 
                     }
                     #pragma unroll
                     for (int ii = 0; ii < BLOCK_SZ; ii++) {
-                        MULWeight_in[ii][BLOCK_SZ-1].Pop(); // pop here to not get stuck
+                        NRSIM_POP(MULWeight_in[ii][BLOCK_SZ-1]); // pop here to not get stuck
                     }
                 }
             }
+            // Zero activations are gated in the SSAs (pcm::is_zero), an all-zero block skips the grid
+            uint zeros = 0;
             #pragma unroll
             for (uint jj = 0; jj < BLOCK_SZ; jj++) {
-                MULInput_wire[jj].Push(vec_in.X[j+jj]);
+                if (vec_in.X[j+jj] == 0) zeros++;
+            }
+#ifdef MLP_SKIP_ZERO_BLOCK
+            bool skip_block = (zeros == BLOCK_SZ);
+#else
+            bool skip_block = false;
+#endif
+            monb_macs += BLOCK_SZ*BLOCK_SZ;
+            monb_skipped_macs += zeros*BLOCK_SZ;
+            if (skip_block) {
+                monb_skipped_blocks++;
+            } else {
+                monb_grid_cycles++;
+                #pragma unroll
+                for (uint jj = 0; jj < BLOCK_SZ; jj++) {
+                    NRSIM_PUSH(MULInput_wire[jj], vec_in.X[j+jj]);
+                }
             }
             #pragma unroll
             for (uint ii = 0; ii < BLOCK_SZ; ii++) {                            // submatrix row
                 acc[ii] = (j == 0) ? SUM_TYPE(mlp0_bias[i+ii] << nvhls::log2_ceil<SCALE>::val) : 
                                      SUM_TYPE(act_mem[i+ii][cnt] << nvhls::log2_ceil<SCALE>::val); // load bias or psum
-                #pragma unroll
-                for (uint jj = 0; jj < BLOCK_SZ; jj++) {                        // submatrix col (adder tree)
-                    MUL_Out_Type m = MULOutput_wire[ii][jj].Pop();
-                    acc[ii] += m;
+                if (!skip_block) {
+                    #pragma unroll
+                    for (uint jj = 0; jj < BLOCK_SZ; jj++) {                    // submatrix col (adder tree)
+                        MUL_Out_Type m = NRSIM_POP(MULOutput_wire[ii][jj]);
+                        acc[ii] += m;
+                    }
+                    NRSIM_TOGGLE_AT(acc, ii, acc[ii]);
                 }
                 if (j == (MLP0_IN_DIM-BLOCK_SZ) && acc[ii] < MLP1_In_Elem_Type(0)) { // ReLU
                     acc[ii] = MLP1_In_Elem_Type(0);
                 }
                 act_mem[i+ii][cnt] = acc[ii] >> nvhls::log2_ceil<SCALE>::val;
             }
+            if ((i == MLP0_OUT_DIM-BLOCK_SZ) && j == (MLP0_IN_DIM-BLOCK_SZ)) monb_samples++;
             if ((i == MLP0_OUT_DIM-BLOCK_SZ) && j == (MLP0_IN_DIM-BLOCK_SZ) && vec_in.isLastSample) {
-                sample_num.Push(cnt+1); // trigger sonb after processing last submatrix (can be earlier)
+                NRSIM_PUSH(sample_num, cnt+1); // trigger sonb after processing last submatrix (can be earlier)
             }
             cnt = (vec_in.isLastSample) ? sample_cnt(0) : sample_cnt(cnt+1);
             i = (vec_in.isLastSample) ? 
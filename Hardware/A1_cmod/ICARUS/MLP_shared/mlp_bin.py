@@ -0,0 +1,81 @@
+"""
+Read / write the NRMW MLP checkpoint read by mlp_weights.h (no dependencies, numpy arrays or nested lists)
+    python mlp_bin.py <old mlp_test.h> <out.bin>    convert a generated header
+    python mlp_bin.py <in.bin>                      print the sizes
+"""
+import re
+import struct
+import sys
+from array import array
+
+MAGIC = b"NRMW"
+VERSION = 1
+
+
+def _rows(a):
+    a = a.tolist() if hasattr(a, "tolist") else a
+    return [list(r) for r in a]
+
+
+def _vec(a):
+    a = a.tolist() if hasattr(a, "tolist") else a
+    return [float(v) for v in a]
+
+
+def _f32(values):
+    a = array("f", values)
+    if sys.byteorder != "little":
+        a.byteswap()
+    return a.tobytes()
+
+
+def write_bin(path, w0, b0, w1, b1, inputs, outputs):
+    w0, w1, inputs, outputs = _rows(w0), _rows(w1), _rows(inputs), _rows(outputs)
+    b0, b1 = _vec(b0), _vec(b1)
+    hidden, in_dim = len(w0), len(w0[0])
+    out_dim = len(w1)
+    assert len(b0) == hidden and len(w1[0]) == hidden and len(b1) == out_dim
+    assert len(inputs[0]) == in_dim and len(outputs) == len(inputs) and len(outputs[0]) == out_dim
+    with open(path, "wb") as f:
+        f.write(MAGIC)
+        f.write(struct.pack("<5I", VERSION, in_dim, hidden, out_dim, len(inputs)))
+        for m in (w0, [b0], w1, [b1], inputs, outputs):
+            for r in m:
+                f.write(_f32(r))
+
+
+def read_bin(path):
+    """[w0, b0, w1, b1, inputs, outputs] as lists (vectors for the biases)"""
+    with open(path, "rb") as f:
+        assert f.read(4) == MAGIC, "not an NRMW checkpoint"
+        version, in_dim, hidden, out_dim, samples = struct.unpack("<5I", f.read(20))
+        assert version == VERSION
+
+        def mat(rows, cols):
+            a = array("f")
+            a.frombytes(f.read(4 * rows * cols))
+            if sys.byteorder != "little":
+                a.byteswap()
+            return [a[r * cols:(r + 1) * cols].tolist() for r in range(rows)]
+
+        w0, b0 = mat(hidden, in_dim), mat(1, hidden)[0]
+        w1, b1 = mat(out_dim, hidden), mat(1, out_dim)[0]
+        return [w0, b0, w1, b1, mat(samples, in_dim), mat(samples, out_dim)]
+
+
+def read_header(path):
+    """Arrays of a header written by the old mlp_test.py (static float name[..] = {...};)"""
+    text = open(path).read()
+    arrays = {}
+    for name, body in re.findall(r"static float (\w+)\[[^=]*=\s*(\{.*?\});", text, re.S):
+        rows = re.findall(r"\{([^{}]*)\}", body[1:-1]) or [body[1:-1]]
+        arrays[name] = [[float(v) for v in r.split(",") if v.strip()] for r in rows]
+    return [arrays["mlp0_weight"], arrays["mlp0_bias"][0], arrays["mlp1_weight"],
+            arrays["mlp1_bias"][0], arrays["test_input"], arrays["test_output"]]
+
+
+if __name__ == "__main__":
+    if len(sys.argv) == 3:
+        write_bin(sys.argv[2], *read_header(sys.argv[1]))
+    w0, b0, w1, b1, inputs, outputs = read_bin(sys.argv[-1])
+    print(f"{sys.argv[-1]}: {len(w0[0])}x{len(w0)}x{len(w1)} MLP, {len(inputs)} test vectors")
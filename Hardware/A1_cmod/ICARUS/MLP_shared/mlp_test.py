@@ -4,6 +4,7 @@ import torch.optim as optim
 import torch.ao.quantization as quantization
 import random
 import numpy as np
+from mlp_bin import write_bin
 
 # Set random seeds for reproducibility
 seed = 42
@@ -85,75 +86,23 @@ for epoch in range(epochs):
 model.eval()
 model = quantization.convert(model)
 
-# Function to export weights and sample inputs to a .h file
-def export_to_header(model, num_samples=192):
-    with open("mlp_test.h", "w") as f:
-        # Write weights for the first layer (256x256)
-        fc1_weights_int = torch.int_repr(model.fc1.weight()).numpy()
-
-        f.write("static float mlp0_weight[256][256] = {\n")
-        for i in range(256):
-            f.write("    {")
-            float_weights = [(fc1_weights_int[i][j]) for j in range(256)]
-            f.write(", ".join([f"{float_weights[j]:.6f}" for j in range(256)]))
-            f.write("},\n")
-        f.write("};\n\n")
-
-        # Write bias for the first layer (256)
-        if model.fc1.bias is not None:
-            fc1_bias = model.fc1.bias().detach().numpy()
-            fc1_bias = np.round(model.fc1.bias().detach().numpy() * 128)
-            f.write("static float mlp0_bias[256] = \n")
-            f.write("    {")
-            f.write(", ".join([f"{fc1_bias[i]:.6f}" for i in range(256)]))
-            f.write("};\n\n")
-
-        # Write weights for the second layer (4x256)
-        fc2_weights_int = torch.int_repr(model.fc2.weight()).numpy()
-
-        f.write("static float mlp1_weight[4][256] = {\n")
-        for i in range(4):
-            f.write("    {")
-            float_weights = [(fc2_weights_int[i][j]) for j in range(256)]
-            f.write(", ".join([f"{float_weights[j]:.6f}" for j in range(256)]))
-            f.write("},\n")
-        f.write("};\n\n")
-        
-        # Write bias for the second layer (4)
-        if model.fc2.bias is not None:
-            fc2_bias = np.round(model.fc2.bias().detach().numpy() * 128)
-            f.write("static float mlp1_bias[4] = \n")
-            f.write("    {")
-            f.write(", ".join([f"{fc2_bias[i]:.6f}" for i in range(4)]))
-            f.write("};\n\n")
-
-        # Generate and write sample inputs
-        test_inputs = []
-        f.write(f"static float test_input[{num_samples:4d}][256] = " + "{\n")
-        for _ in range(num_samples):
-            sample_input = np.random.rand(256).astype(np.float32)
-            sample_input_int = (sample_input * 128).astype(np.int32)
-            test_inputs.append(sample_input)
-            f.write("    {")
-            f.write(", ".join([f"{sample_input_int[j]:.6f}" for j in range(256)]))
-            f.write("},\n")
-        f.write("};\n\n")
-
-        # Evaluate the model on the sample inputs and write the outputs (results) to the file
-        f.write(f"static float test_output[{num_samples:4d}][4] = " + "{\n")
-        test_inputs_tensor = torch.tensor(np.array(test_inputs))  # Convert to tensor for inference
-        with torch.no_grad():
-            model.eval()  # Ensure the model is in evaluation mode
-            outputs = model(test_inputs_tensor)  # Get the model outputs
-            outputs = outputs.detach().numpy()  # Convert outputs to numpy
-
-            for i in range(num_samples):
-                f.write("    {")
-                f.write(", ".join([f"{outputs[i][j]:.6f}" for j in range(4)]))
-                f.write("},\n")
-        f.write("};\n")
-
-# Export the weights and sample inputs to the header file
-export_to_header(model)
-print("Weights and sample inputs exported to mlp_test.h")
-
+# Function to export weights and sample inputs to the NRMW checkpoint read by mlp_weights.h
+def export_to_bin(model, path="mlp_test.bin", num_samples=192):
+    # Weights in int8 units (SCALE 128), biases scaled to the same units
+    fc1_weights_int = torch.int_repr(model.fc1.weight()).numpy().astype(np.float32)
+    fc1_bias = np.round(model.fc1.bias().detach().numpy() * 128)
+    fc2_weights_int = torch.int_repr(model.fc2.weight()).numpy().astype(np.float32)
+    fc2_bias = np.round(model.fc2.bias().detach().numpy() * 128)
+
+    # Sample inputs in SCALE units, outputs of the quantized model
+    test_inputs = np.random.rand(num_samples, 256).astype(np.float32)
+    test_inputs_int = (test_inputs * 128).astype(np.int32).astype(np.float32)
+    with torch.no_grad():
+        model.eval()  # Ensure the model is in evaluation mode
+        outputs = model(torch.tensor(test_inputs)).detach().numpy()
+
+    write_bin(path, fc1_weights_int, fc1_bias, fc2_weights_int, fc2_bias, test_inputs_int, outputs)
+
+# Export the weights and sample inputs to the checkpoint
+export_to_bin(model)
+print("Weights and sample inputs exported to mlp_test.bin")
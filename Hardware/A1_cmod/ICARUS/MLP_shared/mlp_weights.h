@@ -0,0 +1,162 @@
+#ifndef ICARUS_MLP_WEIGHTS_H
+#define ICARUS_MLP_WEIGHTS_H
+
+#include "ICARUSPackDef.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*
+ * MLP checkpoint + test vectors, read at run time instead of compiled in (written by mlp_test.py / mlp_bin.py)
+ * File format, little endian:
+ *   char     magic[4] = "NRMW"
+ *   uint32   version = 1
+ *   uint32   in_dim, hidden_dim, out_dim, samples
+ *   float32  w0[hidden_dim][in_dim], b0[hidden_dim]
+ *   float32  w1[out_dim][hidden_dim], b1[out_dim]
+ *   float32  input[samples][in_dim], output[samples][out_dim]
+ * Values are stored as the testbenches use them (weights/inputs in SCALE units, outputs unscaled).
+ */
+#ifndef MLP_SHARED_DIR
+#define MLP_SHARED_DIR "../MLP_shared"  // set by the module CMakeLists
+#endif
+#define MLP_WEIGHTS_DEFAULT MLP_SHARED_DIR "/mlp_test.bin"
+
+class MLPWeights {
+public:
+    static const unsigned VERSION = 1;
+
+    unsigned in_dim, hidden_dim, out_dim, samples;
+    std::vector<float> w0, b0, w1, b1, input, output;
+
+    MLPWeights() : in_dim(0), hidden_dim(0), out_dim(0), samples(0) {}
+
+    float W0(int i, int j) const { return w0[i*in_dim + j]; }
+    float B0(int i) const { return b0[i]; }
+    float W1(int i, int j) const { return w1[i*hidden_dim + j]; }
+    float B1(int i) const { return b1[i]; }
+    float In(int n, int j) const { return input[n*in_dim + j]; }
+    float Out(int n, int j) const { return output[n*out_dim + j]; }
+
+    /*
+     * Read a checkpoint, the layers have to be at least MLP0_IN_DIM / MLP0_OUT_DIM / MLP1_OUT_DIM wide
+     * (a larger network is cut to its leading rows/columns, as with PEU_CORDIC_IN_DIM < 128)
+     * and it has to carry at least min_samples test vectors
+     */
+    bool Load(const std::string &path, unsigned min_samples = 0) {
+        FILE *f = fopen(path.c_str(), "rb");
+        if (!f) return Error(path, "cannot open");
+
+        char magic[4];
+        unsigned hdr[5];
+        bool ok = fread(magic, 1, 4, f) == 4 && memcmp(magic, "NRMW", 4) == 0 &&
+                  fread(hdr, sizeof(unsigned), 5, f) == 5;
+        if (!ok || hdr[0] != VERSION) {
+            fclose(f);
+            return Error(path, "not a version 1 NRMW checkpoint");
+        }
+        in_dim = hdr[1];
+        hidden_dim = hdr[2];
+        out_dim = hdr[3];
+        samples = hdr[4];
+        if (in_dim < unsigned(MLP0_IN_DIM) || hidden_dim < unsigned(MLP0_OUT_DIM) || out_dim < unsigned(MLP1_OUT_DIM)) {
+            fclose(f);
+            std::cerr << path << ": " << in_dim << "x" << hidden_dim << "x" << out_dim << " network, model is "
+                      << MLP0_IN_DIM << "x" << MLP0_OUT_DIM << "x" << MLP1_OUT_DIM << std::endl;
+            return false;
+        }
+
+        ok = Read(f, w0, hidden_dim*in_dim) && Read(f, b0, hidden_dim) &&
+             Read(f, w1, out_dim*hidden_dim) && Read(f, b1, out_dim) &&
+             Read(f, input, samples*in_dim) && Read(f, output, samples*out_dim);
+        fclose(f);
+        if (!ok) return Error(path, "truncated");
+        if (samples < min_samples) {
+            std::cerr << path << ": " << samples << " test vectors, need " << min_samples << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    /*
+     * Push both layers (model sizes) into a MemReq port, bank wbank: per layer the rows of weights, then the
+     * biases, in bursts of up to MEMREQ_BURST elements
+     * Biases are multiplied by b0_scale / b1_scale (the float path keeps them unshifted)
+     */
+    template <typename Port>
+    void StreamMemReq(Port &memreq, wbank_type wbank, float b0_scale = 1, float b1_scale = 1) const {
+        PortSink<Port> sink = {memreq};
+        ForEachMemReq(sink, wbank, b0_scale, b1_scale);
+    }
+
+    /*
+     * Backdoor: the same writes straight into the engine's memories (its PreloadWeight), no simulated cycles
+     * Before sc_start / instead of StreamMemReq, the timed path stays untouched
+     */
+    template <typename Engine>
+    void Preload(Engine &mlp, wbank_type wbank, float b0_scale = 1, float b1_scale = 1) const {
+        PreloadSink<Engine> sink = {mlp};
+        ForEachMemReq(sink, wbank, b0_scale, b1_scale);
+    }
+
+private:
+    template <typename Port>
+    struct PortSink {
+        Port &port;
+        void operator()(const MemReq &q) { port.Push(q); }
+    };
+    template <typename Engine>
+    struct PreloadSink {
+        Engine &mlp;
+        void operator()(const MemReq &q) { mlp.PreloadWeight(q); }
+    };
+
+    template <typename Sink>
+    void ForEachMemReq(Sink &sink, wbank_type wbank, float b0_scale, float b1_scale) const {
+        for (unsigned layer = 0; layer < 2; layer++) {
+            unsigned rows = layer ? MLP1_OUT_DIM : MLP0_OUT_DIM;
+            unsigned cols = layer ? MLP1_IN_DIM : MLP0_IN_DIM;
+            MemReq req;
+            req.forPEU = false;
+            req.forMLP0 = (layer == 0);
+            req.wbank = wbank;
+            req.isBias = false;
+            for (unsigned i = 0; i < rows; i++) {
+                req.index[0] = i;
+                for (unsigned j = 0; j < cols; j += MEMREQ_BURST) {
+                    req.index[1] = j;
+                    req.len = std::min(unsigned(MEMREQ_BURST), cols - j);
+                    for (unsigned k = 0; k < req.len; k++)
+                        req.data[k] = MLP_Weight_Type(layer ? W1(i, j + k) : W0(i, j + k));
+                    sink(req);
+                }
+            }
+            req.isBias = true;
+            req.index[1] = 0;
+            for (unsigned i = 0; i < rows; i += MEMREQ_BURST) {
+                req.index[0] = i;
+                req.len = std::min(unsigned(MEMREQ_BURST), rows - i);
+                for (unsigned k = 0; k < req.len; k++)
+                    req.data[k] = MLP_Weight_Type(layer ? B1(i + k)*b1_scale : B0(i + k)*b0_scale);
+                sink(req);
+            }
+        }
+    }
+
+    static bool Read(FILE *f, std::vector<float> &v, unsigned n) {
+        v.resize(n);
+        return fread(v.data(), sizeof(float), n, f) == n;
+    }
+    static bool Error(const std::string &path, const char *what) {
+        std::cerr << path << ": " << what << std::endl;
+        return false;
+    }
+};
+
+static MLPWeights mlp_weights; // loaded by sc_main, argv[1] or MLP_WEIGHTS_DEFAULT
+static bool mlp_backdoor = false; // argv[2] "backdoor": the testbenches Preload the weights instead of streaming them
+
+#endif //ICARUS_MLP_WEIGHTS_H
@@ -97,17 +97,35 @@ public:
         while (1) {
             wait();
 
-            MemReq q = memreq.Pop();
-            if (q.forMLP0) {
-                if (q.isBias) mlp0_bias[q.index[0]]        = q.data;
-                else          mlp0[q.index[0]][q.index[1]] = q.data;
-            } else {
-                if (q.isBias) mlp1_bias[q.index[0]]        = q.data;
-                else          mlp1[q.index[0]][q.index[1]] = q.data;
+            MemReq q = NRSIM_POP(memreq);
+            WriteMemReq(q);
+        }
+    }
+
+    // One MemReq into the memories: q.len weights of row index[0] from column index[1], biases from index[0]
+    void WriteMemReq(const MemReq &q) {
+        #pragma hls_unroll yes
+        for (int k = 0; k < MEMREQ_BURST; k++) {
+            if (k < q.len) {  // lanes past the burst write nothing
+                if (q.forMLP0) {
+                    if (q.isBias) mlp0_bias[q.index[0] + k]        = q.data[k];
+                    else          mlp0[q.index[0]][q.index[1] + k] = q.data[k];
+                } else {
+                    if (q.isBias) mlp1_bias[q.index[0] + k]        = q.data[k];
+                    else          mlp1[q.index[0]][q.index[1] + k] = q.data[k];
+                }
             }
         }
     }
 
+    /*
+     * Backdoor access for the testbench (C simulation only, no timing): one weight write straight into the
+     * memories, decoded as InitializeMLP does; used before / instead of streaming memreq (mlp_weights.h Preload)
+     */
+    void PreloadWeight(const MemReq &q) {
+        WriteMemReq(q);
+    }
+
     // PCM to several SSAs
     void fanout_pcm () {
         #pragma unroll
@@ -124,10 +142,10 @@ public:
             wait();
             #pragma unroll
             for (int j = 0; j < BLOCK_SZ; j++) {
-                PCM_Out_Type tmp = PCM_out[j].Pop();
+                PCM_Out_Type tmp = NRSIM_POP(PCM_out[j]);
                 #pragma unroll
                 for (int i = 0; i < BLOCK_SZ; i++) {
-                    PCM_out_fanout[i][j].Push(tmp);
+                    NRSIM_PUSH(PCM_out_fanout[i][j], tmp);
                 }
             }
         }
@@ -145,9 +163,20 @@ public:
      */
     // temporary memory
     MLP1_In_Elem_Type act_mem[MLP0_OUT_DIM][MAX_SAMPLE_NUM];
+    // Statistics (zero skipping)
+    unsigned long monb_samples;        // samples through all MLP0 submatrices
+    unsigned long monb_grid_cycles;    // submatrix x sample issued to the BLOCK_SZ x BLOCK_SZ SSA grid
+    unsigned long monb_macs;           // MACs of MLP0 (BLOCK_SZ*BLOCK_SZ per submatrix x sample)
+    unsigned long monb_skipped_macs;   // MACs on zero activations (gated by pcm::is_zero or skipped with the block)
+    unsigned long monb_skipped_blocks; // all-zero activation blocks not sent to the grid (one cycle each)
     void Monb() {
         sample_cnt cnt = 0; // which sample (pipelined in)
         uint i=0, j=0;      // which submatrices
+        monb_samples = 0;
+        monb_grid_cycles = 0;
+        monb_macs = 0;
+        monb_skipped_macs = 0;
+        monb_skipped_blocks = 0;
         MLPInput.Reset();
         sample_num.ResetWrite();
         #pragma unroll
@@ -169,7 +198,7 @@ public:
         while (1) {
             wait();
 
-            MLP_In_Type vec_in = MLPInput.Pop();
+            MLP_In_Type vec_in = NRSIM_POP(MLPInput);
 
             typedef MUL_Out_Type::rt_unary::set<MLP0_IN_DIM>::sum SUM_TYPE;
             SUM_TYPE acc[BLOCK_SZ]; // accumulator (reg);
@@ -178,34 +207,56 @@ public:
                for (int jj = BLOCK_SZ-1; jj >= 0; jj--) { // 64 cc
                     #pragma unroll
                     for (int ii = 0; ii < BLOCK_SZ; ii++) { 
-                        w_in[ii].Push(mlp0[i+ii][j+jj]); 
+                        NRSIM_PUSH(w_in[ii], mlp0[i+ii][j+jj]); 
                     }
                     #pragma unroll
                     for (int ii = 0; ii < BLOCK_SZ; ii++) {
-                        MULWeight_in[ii][BLOCK_SZ-1].Pop(); // pop here to not get stuck
+                        NRSIM_POP(MULWeight_in[ii][BLOCK_SZ-1]); // pop here to not get stuck
                     }
                 }
             }
+            // Zero activations are gated in the SSAs (pcm::is_zero), an all-zero block skips the grid
+            uint zeros = 0;
             #pragma unroll
             for (uint jj = 0; jj < BLOCK_SZ; jj++) {
-                MULInput_wire[jj].Push(vec_in.X[j+jj]);
+                if (vec_in.X[j+jj] == 0) zeros++;
+            }
+#ifdef MLP_SKIP_ZERO_BLOCK
+            bool skip_block = (zeros == BLOCK_SZ);
+#else
+            bool skip_block = false;
+#endif
+            monb_macs += BLOCK_SZ*BLOCK_SZ;
+            monb_skipped_macs += zeros*BLOCK_SZ;
+            if (skip_block) {
+                monb_skipped_blocks++;
+            } else {
+                monb_grid_cycles++;
+                #pragma unroll
+                for (uint jj = 0; jj < BLOCK_SZ; jj++) {
+                    NRSIM_PUSH(MULInput_wire[jj], vec_in.X[j+jj]);
+                }
             }
             #pragma unroll
             for (uint ii = 0; ii < BLOCK_SZ; ii++) {                            // submatrix row
                 acc[ii] = (j == 0) ? SUM_TYPE(mlp0_bias[i+ii] << nvhls::log2_ceil<SCALE>::val) : 
                                      SUM_TYPE(act_mem[i+ii][cnt] << nvhls::log2_ceil<SCALE>::val); // load bias or psum
-                #pragma unroll
-                for (uint jj = 0; jj < BLOCK_SZ; jj++) {                        // submatrix col (adder tree)
-                    MUL_Out_Type m = MULOutput_wire[ii][jj].Pop();
-                    acc[ii] += m;
+                if (!skip_block) {
+                    #pragma unroll
+                    for (uint jj = 0; jj < BLOCK_SZ; jj++) {                    // submatrix col (adder tree)
+                        MUL_Out_Type m = NRSIM_POP(MULOutput_wire[ii][jj]);
+                        acc[ii] += m;
+                    }
+                    NRSIM_TOGGLE_AT(acc, ii, acc[ii]);
                 }
                 if (j == (MLP0_IN_DIM-BLOCK_SZ) && acc[ii] < MLP1_In_Elem_Type(0)) { // ReLU
                     acc[ii] = MLP1_In_Elem_Type(0);
                 }
                 act_mem[i+ii][cnt] = acc[ii] >> nvhls::log2_ceil<SCALE>::val;
             }
+            if ((i == MLP0_OUT_DIM-BLOCK_SZ) && j == (MLP0_IN_DIM-BLOCK_SZ)) monb_samples++;
             if ((i == MLP0_OUT_DIM-BLOCK_SZ) && j == (MLP0_IN_DIM-BLOCK_SZ) && vec_in.isLastSample) {
-                sample_num.Push(cnt+1); // trigger sonb after processing last submatrix (can be earlier)
+                NRSIM_PUSH(sample_num, cnt+1); // trigger sonb after processing last submatrix (can be earlier)
             }
             cnt = (vec_in.isLastSample) ? sample_cnt(0) : sample_cnt(cnt+1);
             i = (vec_in.isLastSample) ? 
@@ -221,15 +272,24 @@ public:
      * cycles: 16*192 (can be overlapped with Monb by adjusting the timing of pushing sample_num)
      */
     MLP1_In_Elem_Type out_mem[MLP1_OUT_DIM][MAX_SAMPLE_NUM];
+    // Statistics (zero skipping), one cycle = BLOCK_SZ MACs of one output for one sample
+    unsigned long sonb_cycles;         // issued cycles
+    unsigned long sonb_macs;           // MACs of MLP1
+    unsigned long sonb_skipped_macs;   // MACs on zero (ReLU) activations
+    unsigned long sonb_skipped_blocks; // all-zero activation blocks skipped (one cycle each)
     void Sonb() {
         sample_num.ResetRead();
         MLPOutput.Reset();
+        sonb_cycles = 0;
+        sonb_macs = 0;
+        sonb_skipped_macs = 0;
+        sonb_skipped_blocks = 0;
 
         wait();
         while (1) {
             wait();
             
-            sample_cnt num = sample_num.Pop(); // wait for Monb to finish
+            sample_cnt num = NRSIM_POP(sample_num); // wait for Monb to finish
 
             MLP1_In_Type vec_in;
             MLP_Out_Elem_Type acc; // accumulator (reg);
@@ -241,8 +301,24 @@ public:
                         typedef PROD_TYPE::rt_unary::set<MLP1_IN_DIM>::sum SUM_TYPE;
                         SUM_TYPE acc = (j == 0) ? SUM_TYPE(mlp1_bias[i] << nvhls::log2_ceil<SCALE>::val) : 
                                                   SUM_TYPE(out_mem[i][n] << nvhls::log2_ceil<SCALE>::val); // load bias or psum
+                        uint zeros = 0;
+                        #pragma unroll
+                        for (uint jj = 0; jj < BLOCK_SZ; jj++) {
+                            if (act_mem[j+jj][n] == 0) zeros++;
+                        }
+                        sonb_macs += BLOCK_SZ;
+                        sonb_skipped_macs += zeros;
+#ifdef MLP_SKIP_ZERO_BLOCK
+                        if (zeros == BLOCK_SZ) {
+                            sonb_skipped_blocks++;
+                            out_mem[i][n] = acc >> nvhls::log2_ceil<SCALE>::val; // psum unchanged
+                            continue;
+                        }
+#endif
+                        sonb_cycles++;
                         #pragma unroll
                         for (uint jj = 0; jj < BLOCK_SZ; jj++) {
+                            if (act_mem[j+jj][n] == 0) continue; // gated MAC
                             PROD_TYPE m = mlp1[i][j+jj] * act_mem[j+jj][n];
                             acc += m; // adder tree
                         }
@@ -258,7 +334,7 @@ public:
                     vec_out.X[i] = out_mem[i][n];
                 }
                 vec_out.isLastSample = (n == num-1);
-                MLPOutput.Push(vec_out);
+                NRSIM_PUSH(MLPOutput, vec_out);
             }
         }
     }
@@ -13,21 +13,24 @@
  * Output: [--4 dimensional vector--]
  * Perform: MLP0 (256x256), MLP1 (256x4)
  */
-class MLP : public match::Module {
-    SC_HAS_PROCESS(MLP);
+class MLP_vanilla : public match::Module {
+    SC_HAS_PROCESS(MLP_vanilla);
 public:
 
+    // Times a batch is streamed into MLPInput (once, each sample goes through both layers)
+    static const int INPUT_PASSES = 1;
+
     Connections::In<MemReq> memreq; // For write request to memory
     Connections::In<MLP_In_Type> MLPInput;
     Connections::Out<MLP_Out_Type> MLPOutput;
 
     Connections::Combinational<MLP1_In_Type> MLP0Result;
     
-    MLP(sc_module_name name) : match::Module(name),
-                               memreq("memreq"),
-                               MLPInput("MLPInput"),
-                               MLPOutput("MLPOutput"),
-                               MLP0Result("MLP0Result") {
+    MLP_vanilla(sc_module_name name) : match::Module(name),
+                                       memreq("memreq"),
+                                       MLPInput("MLPInput"),
+                                       MLPOutput("MLPOutput"),
+                                       MLP0Result("MLP0Result") {
         SC_THREAD(InitializeMLP);
         sensitive << clk.pos();
         async_reset_signal_is(rst, false);
@@ -42,11 +45,11 @@ public:
     }
 
     // Layer0 weight memory
-    MLP_Weight_Type mlp0[MLP0_OUT_DIM][MLP0_IN_DIM];
-    MLP_Weight_Type mlp0_bias[MLP0_OUT_DIM];
+    MLP_Weight_Type mlp0[WEIGHT_BANKS][MLP0_OUT_DIM][MLP0_IN_DIM];
+    MLP_Weight_Type mlp0_bias[WEIGHT_BANKS][MLP0_OUT_DIM];
     // Layer1 weight memory
-    MLP_Weight_Type mlp1[MLP1_OUT_DIM][MLP1_IN_DIM];
-    MLP_Weight_Type mlp1_bias[MLP1_OUT_DIM];
+    MLP_Weight_Type mlp1[WEIGHT_BANKS][MLP1_OUT_DIM][MLP1_IN_DIM];
+    MLP_Weight_Type mlp1_bias[WEIGHT_BANKS][MLP1_OUT_DIM];
     /*
      * Dummy memory to write to (may be replaced with technology dependent memory)
      */
@@ -58,19 +61,37 @@ public:
             wait();
 
             MemReq q;
-            if (memreq.PopNB(q)) {
+            if (NRSIM_POPNB(memreq, q)) {
                 // assert((q.index[0] < MLP0_OUT_DIM) && (q.index[1] < MLP0_IN_DIM));
+                WriteMemReq(q);
+            }
+        }
+    }
+
+    // One MemReq into the memories: q.len weights of row index[0] from column index[1], biases from index[0]
+    void WriteMemReq(const MemReq &q) {
+        #pragma hls_unroll yes
+        for (int k = 0; k < MEMREQ_BURST; k++) {
+            if (k < q.len) {  // lanes past the burst write nothing
                 if (q.forMLP0) {
-                    if (q.isBias) mlp0_bias[q.index[0]]        = q.data;
-                    else          mlp0[q.index[0]][q.index[1]] = q.data;
+                    if (q.isBias) mlp0_bias[q.wbank][q.index[0] + k]        = q.data[k];
+                    else          mlp0[q.wbank][q.index[0]][q.index[1] + k] = q.data[k];
                 } else {
-                    if (q.isBias) mlp1_bias[q.index[0]]        = q.data;
-                    else          mlp1[q.index[0]][q.index[1]] = q.data;
+                    if (q.isBias) mlp1_bias[q.wbank][q.index[0] + k]        = q.data[k];
+                    else          mlp1[q.wbank][q.index[0]][q.index[1] + k] = q.data[k];
                 }
             }
         }
     }
 
+    /*
+     * Backdoor access for the testbench (C simulation only, no timing): one weight write straight into the
+     * memories, decoded as InitializeMLP does; used before / instead of streaming memreq (mlp_weights.h Preload)
+     */
+    void PreloadWeight(const MemReq &q) {
+        WriteMemReq(q);
+    }
+
     /* 
      * Multi-Output Network Block
      * Input: 256-dimensional data
@@ -86,22 +107,22 @@ public:
             wait();
 
             MLP_In_Type vec_in;
-            if (MLPInput.PopNB(vec_in)) {
+            if (NRSIM_POPNB(MLPInput, vec_in)) {
                 MLP1_In_Type vec_out;
                 for (uint i = 0; i < MLP0_OUT_DIM; i++) {
 #ifdef USE_FLOAT
-                    MLP1_In_Elem_Type tmp = mlp0_bias[i];
+                    MLP1_In_Elem_Type tmp = mlp0_bias[vec_in.wbank][i];
                     for (uint j = 0; j < MLP0_IN_DIM; j++) {
-                        tmp += mlp0[i][j] * vec_in.X[j];
+                        tmp += mlp0[vec_in.wbank][i][j] * vec_in.X[j];
                     }
                     if (tmp < MLP1_In_Elem_Type(0)) tmp = MLP1_In_Elem_Type(0);   // ReLU
                     vec_out.X[i] = tmp;
 #else
                     typedef MLP_In_Elem_Type::rt_T<MLP_Weight_Type>::mult PROD_TYPE;
                     typedef PROD_TYPE::rt_unary::set<MLP0_IN_DIM>::sum SUM_TYPE;
-                    SUM_TYPE tmp = (mlp0_bias[i] << 7);
+                    SUM_TYPE tmp = (mlp0_bias[vec_in.wbank][i] << 7);
                     for (uint j = 0; j < MLP0_IN_DIM; j++) {
-                        PROD_TYPE m = mlp0[i][j] * vec_in.X[j];
+                        PROD_TYPE m = mlp0[vec_in.wbank][i][j] * vec_in.X[j];
                         tmp += m;
                     }
                     MLP1_In_Elem_Type tmp2;
@@ -110,9 +131,10 @@ public:
                     vec_out.X[i] = tmp2;
 #endif
                 }
+                vec_out.wbank = vec_in.wbank;
                 vec_out.isLastSample = vec_in.isLastSample;
 
-                MLP0Result.Push(vec_out);
+                NRSIM_PUSH(MLP0Result, vec_out);
             }
         }
     }
@@ -131,27 +153,27 @@ public:
             wait();
 
             MLP1_In_Type vec_in;
-            if (MLP0Result.PopNB(vec_in)) {
+            if (NRSIM_POPNB(MLP0Result, vec_in)) {
                 MLP_Out_Type vec_out;
                 for (uint i = 0; i < MLP1_OUT_DIM; i++) {
 #ifdef USE_FLOAT
-                    MLP_Out_Elem_Type tmp = mlp1_bias[i];
+                    MLP_Out_Elem_Type tmp = mlp1_bias[vec_in.wbank][i];
                     for (uint j = 0; j < MLP1_IN_DIM; j++) {
-                        tmp += mlp1[i][j] * vec_in.X[j];
+                        tmp += mlp1[vec_in.wbank][i][j] * vec_in.X[j];
                     }
                     vec_out.X[i] = tmp;
 #else
                     typedef MLP1_In_Elem_Type::rt_T<MLP_Weight_Type>::mult PROD_TYPE;
                     typedef PROD_TYPE::rt_unary::set<MLP1_IN_DIM>::sum SUM_TYPE;
-                    SUM_TYPE tmp = (mlp1_bias[i] << 7);
+                    SUM_TYPE tmp = (mlp1_bias[vec_in.wbank][i] << 7);
                     for (uint j = 0; j < MLP1_IN_DIM; j++) {
-                        PROD_TYPE m = mlp1[i][j] * vec_in.X[j];
+                        PROD_TYPE m = mlp1[vec_in.wbank][i][j] * vec_in.X[j];
                         tmp += m;
                     }
                     vec_out.X[i] = tmp >> 7; // Divided by 128
 #endif
                 }
-                MLPOutput.Push(vec_out);
+                NRSIM_PUSH(MLPOutput, vec_out);
             }
         }
     }
@@ -1,4 +1,4 @@
-#define NVHLS_VERIFY_BLOCKS (MLP)
+#define NVHLS_VERIFY_BLOCKS (MLP_vanilla)
 #include "MLP_vanilla.h"
 #include <nvhls_verify.h>
 //#include <mc_scverify.h>
@@ -9,7 +9,7 @@
 #include <systemc.h>
 #include <nvhls_module.h>
 #include <mc_connections.h>
-#include "mlp_test.h"
+#include "mlp_weights.h"
 
 #define SAMPLE_NUM 192
 
@@ -22,7 +22,7 @@ public:
     Connections::Combinational<MLP_In_Type> MLPInput;
     Connections::Combinational<MLP_Out_Type> MLPOutput;
 
-    NVHLS_DESIGN(MLP) dut;
+    NVHLS_DESIGN(MLP_vanilla) dut;
 //    CCS_DESIGN(SDAcc) CCS_INIT_S1(dut);
 
     SC_CTOR(Top) : clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
@@ -63,53 +63,16 @@ public:
         MLPInput.ResetWrite();
         wait(10);
 
-        // Write to layer0 weight memory 256x256 
-        cout << "Weight memory (256x256): " << endl;
-        for (int i = 0; i < MLP0_OUT_DIM; i++) {
-            MemReq req1;
-            for (int j = 0; j < MLP0_IN_DIM; j++) {
-                req1.index[0] = i;
-                req1.index[1] = j;
-                req1.data = MLP_Weight_Type(mlp0_weight[i][j]);
-                req1.forMLP0 = true;
-                req1.isBias = false;
-                memreq.Push(req1);
-            }
-            req1.index[0] = i;
-#ifdef USE_FLOAT
-            req1.data = MLP_Weight_Type(mlp0_bias[i]*128); // scale up
-#else
-            req1.data = MLP_Weight_Type(mlp0_bias[i]);
-#endif
-            req1.forMLP0 = true;
-            req1.isBias = true;
-            memreq.Push(req1);
-        }
-        cout << "Finish writing to layer0 @ " << sc_time_stamp() << endl;
-
-        // Write to layer1 weight memory 4x256 
-        cout << "Weight memory (4x256): " << endl;
-        for (int i = 0; i < MLP1_OUT_DIM; i++) {
-            MemReq req1;
-            for (int j = 0; j < MLP1_IN_DIM; j++) {
-                req1.index[0] = i;
-                req1.index[1] = j;
-                req1.data = MLP_Weight_Type(mlp1_weight[i][j]);
-                req1.forMLP0 = false;
-                req1.isBias = false;
-                memreq.Push(req1);
-            }
-            req1.index[0] = i;
+        // Write both layers to weight memory (bank 0)
+        cout << "Weight memory (" << MLP0_OUT_DIM << "x" << MLP0_IN_DIM << ", " << MLP1_OUT_DIM << "x" << MLP1_IN_DIM << "): " << endl;
 #ifdef USE_FLOAT
-            req1.data = MLP_Weight_Type(mlp1_bias[i]*128*128); // scale up
+        if (mlp_backdoor) mlp_weights.Preload(dut, 0, 128, 128*128);
+        else              mlp_weights.StreamMemReq(memreq, 0, 128, 128*128); // scale up biases
 #else
-            req1.data = MLP_Weight_Type(mlp1_bias[i]);
+        if (mlp_backdoor) mlp_weights.Preload(dut, 0);
+        else              mlp_weights.StreamMemReq(memreq, 0);
 #endif
-            req1.forMLP0 = false;
-            req1.isBias = true;
-            memreq.Push(req1);
-        }
-        cout << "Finish writing to layer1 @ " << sc_time_stamp() << endl;
+        cout << "Finish writing weights @ " << sc_time_stamp() << endl;
 
 
         wait(10);
@@ -117,8 +80,9 @@ public:
         // Random inputs
         for (int i = 0; i < SAMPLE_NUM; i++) {
             MLP_In_Type vec;
+            vec.wbank = 0;
             for (int j = 0; j < MLP0_IN_DIM; j++) {
-                vec.X[j] = MLP_In_Elem_Type(test_input[i][j]);
+                vec.X[j] = MLP_In_Elem_Type(mlp_weights.In(i, j));
             }
             vec.isLastSample = (i == SAMPLE_NUM-1);
             MLPInput.Push(vec);
@@ -140,11 +104,11 @@ public:
 #ifdef USE_FLOAT
                     MLP_Out_Elem_Type _ = tmp.X[j]/(MLP_Out_Elem_Type(128*128*128)); // scale down
                     cout << _ << " ";
-                    acc += _.to_float() - test_output[i][j];
+                    acc += _.to_float() - mlp_weights.Out(i, j);
 #else
                     MLP_Out_Elem_Type _ = tmp.X[j]; // scale down
                     cout << float(_.to_int())/128 << " ";
-                    acc += float(_.to_int())/128 - test_output[i][j];
+                    acc += float(_.to_int())/128 - mlp_weights.Out(i, j);
 #endif
                 }
                 cout << endl;
@@ -157,6 +121,9 @@ public:
 };
 
 int sc_main(int argc, char *argv[]) {
+    std::string weights = (argc > 1) ? argv[1] : MLP_WEIGHTS_DEFAULT; // checkpoint written by mlp_test.py
+    mlp_backdoor = (argc > 2 && std::string(argv[2]) == "backdoor"); // no simulated weight load
+    if (!mlp_weights.Load(weights, SAMPLE_NUM)) return 1;
     Top tb("tb");
     sc_start();
     return 0;
@@ -11,25 +11,36 @@
  * Input: (x,y,z)
  * Output: [--256 dimensional vector--]
  * Perform: [cos(A * (x,y,z)), sin(A * (x,y,z))], where A \in R^{128x3}
+ * LANES rows of A are multiplied in parallel: PEU_CORDIC_IN_DIM/LANES * PEU_INPUT_DIM cycles per sample
+ * CORDICS sin/cos pairs run in parallel: PEU_CORDIC_IN_DIM/CORDICS cycles per sample
+ * (one unconditional wait() per loop iteration, idle cycles wait in the else branch, so the C simulation
+ * shows the same schedule as the II=1 pipeline)
  */
+template <int LANES = PEU_MAC_LANES, int CORDICS = PEU_CORDIC_UNITS>
 class PEU : public match::Module {
     SC_HAS_PROCESS(PEU);
+    static_assert(PEU_CORDIC_IN_DIM % LANES == 0, "LANES must divide PEU_CORDIC_IN_DIM");
+    static_assert(PEU_CORDIC_IN_DIM % CORDICS == 0, "CORDICS must divide PEU_CORDIC_IN_DIM");
 public:
 
-    //Connections::In<MemReq> memreq; // For write request to Matrix A
+    static const int ROWS_PER_LANE = PEU_CORDIC_IN_DIM / LANES;
+    static const int MATMUL_CYCLES = ROWS_PER_LANE * PEU_INPUT_DIM;
+    static const int CORDIC_CYCLES = PEU_CORDIC_IN_DIM / CORDICS;
+
+    Connections::In<MemReq> memreq; // For write request to Matrix A
     Connections::In<PEU_In_Type> PEUInput;
     Connections::Out<PEU_Out_Type> PEUOutput;
 
     Connections::Combinational<PEU_CORDIC_In_Type> PEUMatMulResult;
     
     PEU(sc_module_name name) : match::Module(name),
-                               ////memreq("memreq"),
+                               memreq("memreq"),
                                PEUInput("PEUInput"),
                                PEUOutput("PEUOutput"),
                                PEUMatMulResult("PEUMatMulResult") {
-        /*SC_THREAD(InitializeMatrixA);
+        SC_THREAD(InitializeMatrixA);
         sensitive << clk.pos();
-        async_reset_signal_is(rst, false);*/
+        async_reset_signal_is(rst, false);
 
         SC_THREAD(PEU_MatMul);
         sensitive << clk.pos();
@@ -40,12 +51,13 @@ public:
         async_reset_signal_is(rst, false);
     }
 
-    // Frequency memory
-    //PEU_Matrix_A_Type MatrixA[PEU_CORDIC_IN_DIM][PEU_INPUT_DIM];
+    // Frequency memory, per weight bank one bank per MAC lane: row i of A is MatrixA[wbank][i % LANES][i / LANES]
+    PEU_Matrix_A_Type MatrixA[WEIGHT_BANKS][LANES][ROWS_PER_LANE][PEU_INPUT_DIM];
     /*
      * Dummy memory to write to (may be replaced with technology dependent memory)
+     * index[0]: row of A (< PEU_CORDIC_IN_DIM), index[1]: first column (< PEU_INPUT_DIM), q.len columns
      */
-    /*void InitializeMatrixA() {
+    void InitializeMatrixA() {
         memreq.Reset();
         wait();
 
@@ -53,17 +65,30 @@ public:
             wait();
 
             MemReq q;
-            if (memreq.PopNB(q)) {
+            if (NRSIM_POPNB(memreq, q)) {
                 // assert((q.index[0] < PEU_CORDIC_IN_DIM) && (q.index[1] < PEU_INPUT_DIM));
-                MatrixA[q.index[0]][q.index[1]] = q.data;
+                WriteMemReq(q);
+            }
+        }
+    }
+
+    // One MemReq into MatrixA: q.len columns of row index[0] from index[1]
+    void WriteMemReq(const MemReq &q) {
+        #pragma hls_unroll yes
+        for (int k = 0; k < MEMREQ_BURST; k++) {
+            if (k < q.len) {  // lanes past the burst write nothing
+                MatrixA[q.wbank][q.index[0] % LANES][q.index[0] / LANES][q.index[1] + k] = q.data[k];
             }
         }
-    }*/
+    }
+
+    // Backdoor access for the testbench (C simulation only, no timing): one write of A straight into MatrixA
+    void PreloadWeight(const MemReq &q) { WriteMemReq(q); }
 
     /*
      * Input: (x,y,z)
      * Output: 128-dimensional data
-     * Requirement: 1 sample finished in 128 cycles --> 1 mul
+     * Requirement: 1 sample finished in 128*3/LANES cycles --> LANES muls
      */
     void PEU_MatMul() {
         PEUInput.Reset();
@@ -72,22 +97,37 @@ public:
 
         #pragma hls_pipeline_init_interval 1
         while (1) {
-            wait();
-
             PEU_In_Type pos;
-            if (PEUInput.PopNB(pos)) {
+            if (NRSIM_POPNB(PEUInput, pos)) {
                 PEU_CORDIC_In_Type vec;
                  #pragma hls_pipeline_init_interval 1
-                for (uint i = 0; i < PEU_CORDIC_IN_DIM; i++) {
-                    PEU_CORDIC_In_Elem_Type tmp = PEU_CORDIC_In_Elem_Type(0);
-                    // 3-stage MAC
+                for (uint r = 0; r < ROWS_PER_LANE; r++) {
+                    PEU_CORDIC_In_Elem_Type tmp[LANES];
+                    #pragma hls_unroll
+                    for (uint l = 0; l < LANES; l++) {
+                        tmp[l] = PEU_CORDIC_In_Elem_Type(0);
+                    }
+                    // 3-stage MAC per lane
                  #pragma hls_pipeline_init_interval 1
                     for (uint j = 0; j < PEU_INPUT_DIM; j++) {
-                        tmp += (i+j) * pos.X[j];
+                        #pragma hls_unroll
+                        for (uint l = 0; l < LANES; l++) {
+                            tmp[l] += MatrixA[pos.wbank][l][r][j] * pos.X[j];
+                        }
+                        wait();
+                    }
+                    #pragma hls_unroll
+                    for (uint l = 0; l < LANES; l++) {
+                        vec.X[r*LANES + l] = tmp[l];
                     }
-                    vec.X[i] = tmp;
                 }
-                PEUMatMulResult.Push(vec);
+                vec.delta = pos.delta;
+                vec.ray = pos.ray;
+                vec.wbank = pos.wbank;
+                vec.isLastSample = pos.isLastSample;
+                NRSIM_PUSH(PEUMatMulResult, vec);
+            } else {
+                wait();
             }
         }
     }
@@ -95,7 +135,7 @@ public:
     /*
      * Input: 128-dimensional data
      * Output: 256-dimensional data (cos, sin)
-     * Requirement: 1 sample finished in 128 cycles --> 2 cordics (sin, cos)
+     * Requirement: 1 sample finished in 128/CORDICS cycles --> 2*CORDICS cordics (sin, cos)
      */
     void PEU_CORDIC() {
         PEUMatMulResult.ResetRead();
@@ -104,19 +144,27 @@ public:
         wait();
         #pragma hls_pipeline_init_interval 1
         while (1) {
-            wait();
-
             PEU_CORDIC_In_Type vec;
-            if (PEUMatMulResult.PopNB(vec)) {
+            if (NRSIM_POPNB(PEUMatMulResult, vec)) {
                 PEU_Out_Type tmp;
                 #pragma hls_pipeline_init_interval 1
-                for (uint i = 0; i < PEU_CORDIC_IN_DIM; i++) {
-                    // Original work use cordic, input here is over pi, e.g. pi/4 --> 1/4
-                    ac_math::ac_sin_cordic(vec.X[i], tmp.X[2*i+0]);
-                    ac_math::ac_cos_cordic(vec.X[i], tmp.X[2*i+1]);
+                for (uint i = 0; i < CORDIC_CYCLES; i++) {
+                    #pragma hls_unroll
+                    for (uint c = 0; c < CORDICS; c++) {
+                        uint k = i*CORDICS + c;
+                        // Original work use cordic, input here is over pi, e.g. pi/4 --> 1/4
+                        ac_math::ac_sin_cordic(vec.X[k], tmp.X[2*k+0]);
+                        ac_math::ac_cos_cordic(vec.X[k], tmp.X[2*k+1]);
+                    }
+                    wait();
                 }
+                tmp.delta = vec.delta;
+                tmp.ray = vec.ray;
+                tmp.wbank = vec.wbank;
                 tmp.isLastSample = vec.isLastSample;
-                PEUOutput.Push(tmp);
+                NRSIM_PUSH(PEUOutput, tmp);
+            } else {
+                wait();
             }
         }
     }
@@ -1,10 +1,15 @@
 #define NVHLS_VERIFY_BLOCKS (PEU)
 #include "PEU.h"
+#include "../../common/include/nrsim_stimulus.h"
 #include <nvhls_verify.h>
 //#include <mc_scverify.h>
 #include "nvhls_connections.h"
 #include "ac_sysc_trace.h"
 #include <random>
+#include <iomanip>
+#include <algorithm>
+#include <string>
+#include <vector>
 //#include <ac_channel.h>
 #include <systemc.h>
 #include <nvhls_module.h>
@@ -12,6 +17,14 @@
 
 #define SAMPLE_NUM 5
 
+/*
+ * Usage: sim_PEU [backdoor]            SAMPLE_NUM positions on the diagonal
+ *        sim_PEU stim <capture.nrst> [samples, default all]
+ *        sim_PEU sweep
+ * stim encodes the ray_positions [rays, samples, 3] of an instrumented run (common/include/nrsim_stimulus.h),
+ * the last sample of every ray flagged isLastSample; only the first SAMPLE_NUM outputs are printed.
+ */
+
 class Top : public sc_module {
 public:
     sc_clock clk;
@@ -21,21 +34,27 @@ public:
     Connections::Combinational<PEU_In_Type> PEUInput;
     Connections::Combinational<PEU_Out_Type> PEUOutput;
 
-    NVHLS_DESIGN(PEU) dut;
+    NVHLS_DESIGN(PEU<>) dut;            // PEU<PEU_MAC_LANES, PEU_CORDIC_UNITS>
 //    CCS_DESIGN(SDAcc) CCS_INIT_S1(dut);
 
+    bool backdoor;                      // ./sim_PEU backdoor: matrix A preloaded, not streamed through memreq
+    std::vector<float> stim_positions;  // ./sim_PEU stim: [sample][3], empty for the diagonal positions
+    int stim_ray_len;                   // samples per captured ray
+
     SC_CTOR(Top) : clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
                    rst("rst"),
-                   //memreq("memreq"),
+                   memreq("memreq"),
                    PEUInput("PEUInput"),
                    PEUOutput("PEUOutput"),
-                   dut("dut") {
+                   dut("dut"),
+                   backdoor(false),
+                   stim_ray_len(0) {
 
         sc_object_tracer<sc_clock> trace_clk(clk);
 
         dut.clk(clk);
         dut.rst(rst);
-        //dut.memreq(memreq);
+        dut.memreq(memreq);
         dut.PEUInput(PEUInput);
         dut.PEUOutput(PEUOutput);
 
@@ -57,41 +76,75 @@ public:
         rst.write(true);
     }
 
+    // Matrix A (128x3) and the expected outputs, computed with the same types as the PEU
+    PEU_Matrix_A_Type A[PEU_CORDIC_IN_DIM][PEU_INPUT_DIM];
+    std::vector<PEU_In_Type> samples;
+    sc_time first_in;
+
+    void InitMatrixA() {
+        for (int i = 0; i < PEU_CORDIC_IN_DIM; i++) {
+            for (int j = 0; j < PEU_INPUT_DIM; j++) {
+                int power = i / 3;
+                // not quite the same as mentioned in paper, here just test matrix-vector and cordic functionalities
+                if (j == i % 3) A[i][j] = PEU_Matrix_A_Type((1 << power)/3.141592653589793);
+                else            A[i][j] = PEU_Matrix_A_Type(0);
+            }
+        }
+        int n = stim_positions.empty() ? SAMPLE_NUM : int(stim_positions.size() / 3);
+        samples.resize(n);
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < PEU_INPUT_DIM; j++) {
+                samples[i].X[j] = stim_positions.empty() ? PEU_Position_Type(i)
+                                                         : PEU_Position_Type(stim_positions[i*3 + j]);
+            }
+            samples[i].isLastSample = stim_positions.empty() ? (i == n-1)
+                                                             : ((i + 1) % stim_ray_len == 0 || i == n-1);
+            samples[i].wbank = 0;
+        }
+    }
+
+    PEU_Out_Type Expected(const PEU_In_Type &pos) {
+        PEU_Out_Type out;
+        for (int i = 0; i < PEU_CORDIC_IN_DIM; i++) {
+            PEU_CORDIC_In_Elem_Type tmp = PEU_CORDIC_In_Elem_Type(0);
+            for (int j = 0; j < PEU_INPUT_DIM; j++) {
+                tmp += A[i][j] * pos.X[j];
+            }
+            ac_math::ac_sin_cordic(tmp, out.X[2*i+0]);
+            ac_math::ac_cos_cordic(tmp, out.X[2*i+1]);
+        }
+        return out;
+    }
+
     void run() {
-        //memreq.ResetWrite();
+        memreq.ResetWrite();
         PEUInput.ResetWrite();
+        InitMatrixA();
         wait(10);
 
-        // Write to matrix A memory 128x3
-        /*cout << "Matrix A (128x3): " << endl;
+        // Write to matrix A memory 128x3, rows in bursts of up to MEMREQ_BURST
         for (int i = 0; i < PEU_CORDIC_IN_DIM; i++) {
-            for (int j = 0; j < PEU_INPUT_DIM; j++) {
+            for (int j = 0; j < PEU_INPUT_DIM; j += MEMREQ_BURST) {
                 MemReq req1;
+                req1.wbank = 0;
                 req1.index[0] = i;
                 req1.index[1] = j;
-                int power = i / 3;
-                if (j == i % 3) {
-                    // not quite the same as mentioned in paper, here hust test matrix-vector and cordic functionalities
-                    req1.data = PEU_Matrix_A_Type((1 << power)/3.141592653589793);
-                } else {
-                    req1.data = PEU_Matrix_A_Type(0);
-                }
-                cout << req1.data << " ";
-                memreq.Push(req1);
+                req1.len = std::min(MEMREQ_BURST, PEU_INPUT_DIM - j);
+                for (int k = 0; k < req1.len; k++) req1.data[k] = A[i][j + k];
+                req1.forPEU = true;
+                req1.forMLP0 = false;
+                req1.isBias = false;
+                if (backdoor) dut.PreloadWeight(req1);
+                else          memreq.Push(req1);
             }
-            cout << endl;
-        }*/
+        }
 
         wait(10);
 
-        // Random input Poly input (5 inputs)
-        for (int i = 0; i < SAMPLE_NUM; i++) {
-            PEU_In_Type pos;
-            pos.X[0] = PEU_Position_Type(i);
-            pos.X[1] = PEU_Position_Type(i);
-            pos.X[2] = PEU_Position_Type(i);
-            pos.isLastSample = (i == SAMPLE_NUM-1);
-            PEUInput.Push(pos);
+        // Poly input (5 inputs, or the captured samples)
+        first_in = sc_time_stamp();
+        for (size_t i = 0; i < samples.size(); i++) {
+            PEUInput.Push(samples[i]);
         }
     }
 
@@ -100,27 +153,201 @@ public:
         while (1) {
             wait(); // 1 cc
 
-            for (int i = 0; i < SAMPLE_NUM; i++) {
+            int errors = 0;
+            int n = samples.size();
+            for (int i = 0; i < n; i++) {
                 PEU_Out_Type tmp;
                 tmp = PEUOutput.Pop();
-                cout << "PEUOutput: @ timestep: " << sc_time_stamp() << endl;
-                // Rearrange outputs and compare with test_output in peu_test.h
-                for (uint j = 0; j < PEU_CORDIC_IN_DIM/3; j++) {
-                    for (uint k = 0; k < 3; k++)
-                        cout << tmp.X[6*j+2*k] << " ";
-                    for (uint k = 0; k < 3; k++)
-                        cout << tmp.X[6*j+2*k+1] << " ";
+                bool verbose = (i < SAMPLE_NUM);
+                if (verbose) {
+                    cout << "PEUOutput: @ timestep: " << sc_time_stamp() << endl;
+                    // Rearrange outputs (3 sin, 3 cos per frequency)
+                    for (uint j = 0; j < PEU_CORDIC_IN_DIM/3; j++) {
+                        for (uint k = 0; k < 3; k++)
+                            cout << tmp.X[6*j+2*k] << " ";
+                        for (uint k = 0; k < 3; k++)
+                            cout << tmp.X[6*j+2*k+1] << " ";
+                    }
+                    cout << endl;
+                }
+
+                PEU_Out_Type exp = Expected(samples[i]);
+                bool match = true;
+                for (uint j = 0; j < PEU_CORDIC_IN_DIM*2; j++) {
+                    if (tmp.X[j] != exp.X[j]) match = false;
+                }
+                if (tmp.isLastSample != samples[i].isLastSample) match = false;
+                if (match) {
+                    if (verbose) cout << "  Expected output ✓" << endl;
+                } else {
+                    if (verbose || errors < 5) cout << "  Expected output ✗ (MISMATCH) sample " << i << endl;
+                    errors++;
                 }
-                cout << endl;
             }
 
+            double cycles = (sc_time_stamp() - first_in) / sc_time(1, SC_NS);
+            cout << "PEU_MAC_LANES = " << PEU_MAC_LANES << ", PEU_CORDIC_UNITS = " << PEU_CORDIC_UNITS << ": "
+                 << cycles / n << " cycles/sample (MatMul " << PEU<>::MATMUL_CYCLES
+                 << ", CORDIC " << PEU<>::CORDIC_CYCLES << " cycles)" << endl;
+            cout << (errors ? "FAILED: " : "PASSED: ") << n - errors << "/" << n << " samples match" << endl;
+
             sc_stop();
         }
     }
 };
 
+/*
+ * Parallelism sweep (./sim_PEU sweep): one PEU<LANES, CORDICS> per design point, all fed the same
+ * SWEEP_SAMPLES back-to-back positions (matrix A not loaded, throughput only)
+ * Each point prints the make hls command for its area / power run.
+ */
+#define SWEEP_SAMPLES 64
+
+class sweep_base {
+public:
+    static int running;
+};
+int sweep_base::running = 0;
+
+template <int LANES, int CORDICS>
+class peu_sweep : public sc_module, public sweep_base {
+public:
+    sc_in<bool> clk;
+    sc_in<bool> rst;
+
+    Connections::Combinational<MemReq> memreq;
+    Connections::Combinational<PEU_In_Type> PEUInput;
+    Connections::Combinational<PEU_Out_Type> PEUOutput;
+
+    PEU<LANES, CORDICS> dut;
+    sc_time start;
+
+    SC_HAS_PROCESS(peu_sweep);
+    peu_sweep(sc_module_name name) : sc_module(name),
+                                     clk("clk"),
+                                     rst("rst"),
+                                     memreq("memreq"),
+                                     PEUInput("PEUInput"),
+                                     PEUOutput("PEUOutput"),
+                                     dut("dut") {
+        dut.clk(clk);
+        dut.rst(rst);
+        dut.memreq(memreq);
+        dut.PEUInput(PEUInput);
+        dut.PEUOutput(PEUOutput);
+        running++;
+
+        SC_THREAD(run);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+
+        SC_THREAD(collect);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+    }
+
+    void run() {
+        memreq.ResetWrite();
+        PEUInput.ResetWrite();
+        wait(10);
+
+        start = sc_time_stamp();
+        for (int i = 0; i < SWEEP_SAMPLES; i++) {
+            PEU_In_Type pos;
+            pos.wbank = 0;
+            pos.X[0] = PEU_Position_Type(i);
+            pos.X[1] = PEU_Position_Type(i);
+            pos.X[2] = PEU_Position_Type(i);
+            pos.isLastSample = (i == SWEEP_SAMPLES-1);
+            PEUInput.Push(pos);
+        }
+    }
+
+    void collect() {
+        PEUOutput.ResetRead();
+        wait(10);
+
+        for (int i = 0; i < SWEEP_SAMPLES; i++) {
+            PEUOutput.Pop();
+        }
+        double cycles = (sc_time_stamp() - start).to_seconds()*1e9;
+        int bound = (PEU<LANES, CORDICS>::MATMUL_CYCLES > PEU<LANES, CORDICS>::CORDIC_CYCLES)
+                  ? PEU<LANES, CORDICS>::MATMUL_CYCLES : PEU<LANES, CORDICS>::CORDIC_CYCLES;
+        cout << "LANES = " << std::setw(2) << LANES << ", CORDICS = " << std::setw(2) << CORDICS
+             << " | samples/cycle = " << std::setprecision(4) << SWEEP_SAMPLES / cycles
+             << " | cycles/sample = " << cycles / SWEEP_SAMPLES
+             << " (bound " << bound << ", "
+             << (PEU<LANES, CORDICS>::MATMUL_CYCLES >= PEU<LANES, CORDICS>::CORDIC_CYCLES ? "MatMul" : "CORDIC") << ")"
+             << " | make hls PROJ_PATH=ICARUS/PEU HLS_BUILD_NAME=build_hls_l" << LANES << "_c" << CORDICS
+             << " HLS_DEFINES=\"-DPEU_MAC_LANES=" << LANES << " -DPEU_CORDIC_UNITS=" << CORDICS << "\"" << endl;
+        if (--running == 0) sc_stop();
+    }
+};
+
+class sweep_top : public sc_module {
+public:
+    sc_clock clk;
+    sc_signal<bool> rst;
+
+    // CORDIC parallelism at the configured MAC lanes, then with a fully parallel MatMul
+    peu_sweep<PEU_MAC_LANES, 1> p1;
+    peu_sweep<PEU_MAC_LANES, 2> p2;
+    peu_sweep<PEU_MAC_LANES, 4> p4;
+    peu_sweep<PEU_MAC_LANES, 8> p8;
+    peu_sweep<PEU_MAC_LANES, PEU_CORDIC_IN_DIM> pf;
+    peu_sweep<PEU_CORDIC_IN_DIM, 1> f1;
+    peu_sweep<PEU_CORDIC_IN_DIM, 2> f2;
+    peu_sweep<PEU_CORDIC_IN_DIM, 4> f4;
+    peu_sweep<PEU_CORDIC_IN_DIM, 8> f8;
+    peu_sweep<PEU_CORDIC_IN_DIM, PEU_CORDIC_IN_DIM> ff;
+
+    SC_CTOR(sweep_top) : clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
+                         rst("rst"),
+                         p1("p1"), p2("p2"), p4("p4"), p8("p8"), pf("pf"),
+                         f1("f1"), f2("f2"), f4("f4"), f8("f8"), ff("ff") {
+        sc_object_tracer<sc_clock> trace_clk(clk);
+        p1.clk(clk); p1.rst(rst);
+        p2.clk(clk); p2.rst(rst);
+        p4.clk(clk); p4.rst(rst);
+        p8.clk(clk); p8.rst(rst);
+        pf.clk(clk); pf.rst(rst);
+        f1.clk(clk); f1.rst(rst);
+        f2.clk(clk); f2.rst(rst);
+        f4.clk(clk); f4.rst(rst);
+        f8.clk(clk); f8.rst(rst);
+        ff.clk(clk); ff.rst(rst);
+
+        cout << "=== PEU parallelism sweep (PEU_CORDIC_IN_DIM = " << PEU_CORDIC_IN_DIM
+             << ", PEU_INPUT_DIM = " << PEU_INPUT_DIM << ") ===" << endl;
+
+        SC_THREAD(reset);
+        sensitive << clk.posedge_event();
+    }
+
+    void reset() {
+        rst.write(false);
+        wait(10);
+        rst.write(true);
+    }
+};
+
 int sc_main(int argc, char *argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "sweep") {
+        sweep_top sweep("sweep");
+        sc_start();
+        return 0;
+    }
     Top tb("tb");
+    tb.backdoor = (argc > 1 && std::string(argv[1]) == "backdoor");
+    if (argc > 2 && std::string(argv[1]) == "stim") {
+        nrsim::StimulusReader stim;
+        size_t max_samples = (argc > 3) ? atoi(argv[3]) : 0;
+        if (!stim.Open(argv[2]) || stim.Gather("ray_positions", 3, tb.stim_positions, max_samples) == 0) return 1;
+        const nrsim::NRStimRecord *r = stim.Find("ray_positions");
+        tb.stim_ray_len = (r->ndim == 3) ? int(r->dims[1]) : int(tb.stim_positions.size() / 3);
+        cout << "Stimulus " << argv[2] << ": " << tb.stim_positions.size() / 3 << " samples, "
+             << tb.stim_ray_len << " per ray" << endl;
+    }
     sc_start();
     return 0;
 }
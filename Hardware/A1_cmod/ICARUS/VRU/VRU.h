@@ -7,6 +7,16 @@
 #include <ac_math/ac_hcordic.h>
 #include <ac_math/ac_sigmoid_pwl.h>
 #include <ac_std_float.h>
+#include "../../common/include/nrsim_exp.h"
+
+typedef nrsim::NrsimExp<VRU_EXP_IMPL, VRU_EXP_SEGMENTS> VRU_EXP_POLICY;
+typedef nrsim::NrsimExp<VRU_SIGMOID_IMPL, VRU_SIGMOID_SEGMENTS> VRU_SIGMOID_POLICY;
+#ifdef USE_FLOAT
+typedef VRU_Color_Type VRU_Exp_Type;
+#else
+typedef ac_fixed<32, 16, false, AC_TRN, AC_SAT> VRU_Exp_Type; // exp / sigmoid result > 0, so false
+#endif
+typedef ac_int<nvhls::index_width<VRU_RAY_BANKS>::val, false> VRU_Bank_Type;
 
 #pragma hls_design block
 class VRU : public match::Module {
@@ -15,67 +25,118 @@ public:
     
     Connections::In<VRU_In_Type> VRUInput;
     Connections::Out<VRU_Out_Type> VRUOutput;
+    Connections::Out<ray_id_type> ray_term;     // early ray termination, once per terminated ray
 
     VRU(sc_module_name name) : match::Module(name),
                                VRUInput("VRUInput"),
-                               VRUOutput("VRUOutput") {
+                               VRUOutput("VRUOutput"),
+                               ray_term("ray_term") {
         SC_THREAD(VRU_CALC);
         sensitive << clk.pos();
         async_reset_signal_is(rst, false);
     }
 
+    // Statistics
+    unsigned long terminated_rays;  // rays stopped by early ray termination
+    unsigned long ignored_samples;  // samples of terminated rays that still reached the VRU
+    unsigned long hazard_stall_cycles;  // cycles a sample waited for its bank (VRU_RMW_LATENCY)
+
     /*
-     * Input: (cx,cy,cz,sigma,delta)
-     * Output: (r,g,b)
+     * Input: (cx,cy,cz,sigma,delta), tagged with the ray
+     * Output: (r,g,b), tagged with the ray
      * Perform: C(r) = \Sigma_{i=0}^{N-1} T_i * (1 - exp(-\sigma_i*\delta_i)) * c_i
+     * Ray r accumulates in bank r % VRU_RAY_BANKS: samples of up to VRU_RAY_BANKS consecutive rays may
+     * come interleaved (in order within a ray), a sample waits while its bank is still busy with the previous one.
+     * VRU_EARLY_TERMINATION: once T <= VRU_T_THRESHOLD the ray is reported on ray_term and its
+     * remaining samples are not accumulated (the ICARUS top drops the ones it has not processed yet),
+     * C(r) is still pushed out on the last sample.
+     * exp / sigmoid: VRU_EXP_POLICY / VRU_SIGMOID_POLICY (VRU_EXP_IMPL / VRU_SIGMOID_IMPL of the PackDef).
      */
     #pragma hls_pipeline_init_interval 1
     void VRU_CALC() {
-        VRU_Color_Type T = VRU_Color_Type(1); // registers
-        VRU_Color_Type color[3] = {VRU_Color_Type(0),VRU_Color_Type(0),VRU_Color_Type(0)}; // registers
+        VRU_Color_Type T[VRU_RAY_BANKS]; // registers
+        VRU_Color_Type color[VRU_RAY_BANKS][3]; // registers
+        bool terminated[VRU_RAY_BANKS]; // registers
+        ac_int<8, false> bank_busy[VRU_RAY_BANKS]; // cycles until the bank's last update is done
+        #pragma hls_unroll
+        for (int k = 0; k < VRU_RAY_BANKS; k++) {
+            T[k] = VRU_Color_Type(1);
+            #pragma hls_unroll
+            for (int i = 0; i < 3; i++) {
+                color[k][i] = VRU_Color_Type(0);
+            }
+            terminated[k] = false;
+            bank_busy[k] = 0;
+        }
         VRUInput.Reset();
         VRUOutput.Reset();
+        ray_term.Reset();
+        terminated_rays = 0;
+        ignored_samples = 0;
+        hazard_stall_cycles = 0;
+        VRU_In_Type vru_input;
+        bool holding = false; // input waiting for its bank
         wait();
 
         while (1) {
             wait();
-            
-            VRU_In_Type vru_input;
-            if (VRUInput.PopNB(vru_input)) {
-                // Perform C(r) += (T_i - T_{i+1})*sigmoid(emitted_c)
-                //         T_{i+1} = T_i * exp(-\sigma_i*\delta_i)
-                // Where T_0 = 1, initial C(r) = 0
-#ifdef USE_FLOAT
-                VRU_Color_Type exp_result;
-                VRU_Color_Type sigmoid_result;
-#else
-                ac_fixed<32, 16, false, AC_TRN, AC_SAT> exp_result; // exp result > 0, so false
-                ac_fixed<32, 16, false, AC_TRN, AC_SAT> sigmoid_result;
+
+            #pragma hls_unroll
+            for (int k = 0; k < VRU_RAY_BANKS; k++) {
+                if (bank_busy[k] != 0) bank_busy[k]--;
+            }
+
+            if (!holding) holding = NRSIM_POPNB(VRUInput, vru_input);
+            VRU_Bank_Type b = vru_input.ray.to_uint() % VRU_RAY_BANKS;
+            if (holding && !terminated[b] && bank_busy[b] != 0) {
+                // Read-modify-write hazard on the bank, retry next cycle
+                hazard_stall_cycles++;
+            } else if (holding) {
+                holding = false;
+                if (terminated[b]) {
+                    ignored_samples++;
+                } else {
+                    // Perform C(r) += (T_i - T_{i+1})*sigmoid(emitted_c)
+                    //         T_{i+1} = T_i * exp(-\sigma_i*\delta_i)
+                    // Where T_0 = 1, initial C(r) = 0
+                    VRU_Exp_Type exp_result;
+                    VRU_Exp_Type sigmoid_result;
+                    VRU_EXP_POLICY::exp(-vru_input.sigma * vru_input.delta, exp_result);
+                    VRU_Color_Type tmp_T = T[b] * exp_result;
+                    #pragma hls_pipeline_init_interval 1
+                    for (int i = 0; i < 3; i++) {
+                        VRU_SIGMOID_POLICY::sigmoid(vru_input.emitted_c[i], sigmoid_result);
+                        color[b][i] += sigmoid_result*(T[b] - tmp_T);
+                    }
+                    T[b] = tmp_T;
+                    bank_busy[b] = VRU_RMW_LATENCY;
+
+#ifdef VRU_EARLY_TERMINATION
+                    if (T[b] <= VRU_Color_Type(VRU_T_THRESHOLD) && !vru_input.isLastSample) {
+                        NRSIM_PUSH(ray_term, vru_input.ray);
+                        terminated[b] = true;
+                        terminated_rays++;
+                    }
 #endif
-                ac_math::ac_exp_cordic(-vru_input.sigma * vru_input.delta, exp_result);
-                VRU_Color_Type tmp_T = T * exp_result;
-                #pragma hls_pipeline_init_interval 1
-                for (int i = 0; i < 3; i++) {
-                    ac_math::ac_sigmoid_pwl(vru_input.emitted_c[i], sigmoid_result);
-                    color[i] += sigmoid_result*(T - tmp_T);
                 }
-                T = tmp_T;
 
                 if (vru_input.isLastSample) { // Last sample
                     // after accumulating last sample, push out the result
                     VRU_Out_Type vru_output;
                     #pragma hls_unroll
                     for (int i = 0; i < 3; i++) {
-                        vru_output.c[i] = color[i];
+                        vru_output.c[i] = color[b][i];
                     }
-                    VRUOutput.Push(vru_output);
+                    vru_output.ray = vru_input.ray;
+                    NRSIM_PUSH(VRUOutput, vru_output);
 
                     // reset accumulators and T
                     #pragma hls_unroll
                     for (int i = 0; i < 3; i++) {
-                        color[i] = VRU_Color_Type(0);
+                        color[b][i] = VRU_Color_Type(0);
                     }
-                    T = VRU_Color_Type(1);
+                    T[b] = VRU_Color_Type(1);
+                    terminated[b] = false;
                 }
             }
         }
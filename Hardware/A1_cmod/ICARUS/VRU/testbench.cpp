@@ -1,10 +1,15 @@
 #define NVHLS_VERIFY_BLOCKS (VRU)
 #include "VRU.h"
+#include "../../common/include/nrsim_latency.h"
 #include <nvhls_verify.h>
 //#include <mc_scverify.h>
 #include "nvhls_connections.h"
 #include "ac_sysc_trace.h"
 #include <random>
+#include <cstdlib>
+#include <cmath>
+#include <iomanip>
+#include <string>
 //#include <ac_channel.h>
 #include <systemc.h>
 #include <nvhls_module.h>
@@ -13,6 +18,84 @@
 
 #define SAMPLE_NUM 192
 
+/*
+ * Usage: sim_VRU [rays, default 5]
+ * SAMPLE_NUM samples per ray pushed back to back; every output is checked for the ray it is tagged with, the
+ * latency of a ray (first sample in to its color out) is reported as p50 / p95 / p99 (common/include/nrsim_latency.h).
+ *        sim_VRU interleave [rays]
+ * Samples of VRU_RAY_BANKS consecutive rays pushed round robin (one sample of each ray in turn), with per-ray values.
+ * Both modes check every color bit-exactly against the datapath run one ray at a time (serial_color), so a sample
+ * accumulated into the wrong bank shows, and report samples per cycle and the bank hazard stalls,
+ * e.g. python S0_scripts/sweep.py ICARUS sim_VRU -p VRU_RAY_BANKS=1,2,4,8 -p VRU_RMW_LATENCY=4 -- interleave 16
+ *        sim_VRU exp
+ * Error of every exp / sigmoid choice of nrsim_exp.h over the operating range (exp: [-NRSIM_EXP_RANGE, 0], the
+ * transmittance below e^-8 is not visible; sigmoid: [-8, 8]), VRU_Exp_Type results. HLS latency / II of a choice:
+ * cycle.rpt of the printed make hls (S0_scripts/exp_sweep.sh runs them all).
+ */
+
+#define EXP_SWEEP_POINTS 4096
+#define EXP_MAX_ERR (1.0/255.0)  // the configured choices have to resolve T and the colors to 8 bits
+
+template <class EXP, bool SIGMOID>
+bool exp_error(const char *name, int impl, int segments) {
+    double lo = SIGMOID ? -NRSIM_SIGMOID_RANGE : -NRSIM_EXP_RANGE;
+    double hi = SIGMOID ? NRSIM_SIGMOID_RANGE : 0.0;
+    double max_err = 0.0, sum_err = 0.0, max_at = 0.0;
+    for (int i = 0; i <= EXP_SWEEP_POINTS; i++) {
+        nrsim::EXP_ARG_TYPE x = lo + (hi - lo) * i / EXP_SWEEP_POINTS;
+        VRU_Exp_Type y;
+        double ref;
+        if (SIGMOID) {
+            EXP::sigmoid(x, y);
+            ref = 1.0 / (1.0 + exp(-x.to_double()));
+        } else {
+            EXP::exp(x, y);
+            ref = exp(x.to_double());
+        }
+        double err = fabs(y.to_double() - ref);
+        sum_err += err;
+        if (err > max_err) {
+            max_err = err;
+            max_at = x.to_double();
+        }
+    }
+    int cfg_impl = SIGMOID ? VRU_SIGMOID_IMPL : VRU_EXP_IMPL;
+    int cfg_segments = SIGMOID ? VRU_SIGMOID_SEGMENTS : VRU_EXP_SEGMENTS;
+    bool configured = (impl == cfg_impl && (impl < NRSIM_EXP_PWL || segments == cfg_segments));
+    const char *flag = SIGMOID ? "VRU_SIGMOID" : "VRU_EXP";
+    cout << (SIGMOID ? "sigmoid " : "exp     ") << std::left << std::setw(8) << name << std::right << std::setw(4)
+         << segments << " | max err " << std::scientific << std::setprecision(3) << max_err << " (x = " << std::fixed
+         << std::setprecision(3) << max_at << ") | mean err " << std::scientific << sum_err / (EXP_SWEEP_POINTS + 1)
+         << std::fixed << " | make hls PROJ_PATH=ICARUS/VRU HLS_BUILD_NAME=build_hls_" << (SIGMOID ? "sig" : "exp")
+         << impl << "_" << segments << " HLS_DEFINES=\"-D" << flag << "_IMPL=" << impl << " -D" << flag
+         << "_SEGMENTS=" << segments << "\"";
+    if (configured) cout << (max_err <= EXP_MAX_ERR ? "  <- configured ✓" : "  <- configured ✗ (MISMATCH)");
+    cout << endl;
+    return !configured || max_err <= EXP_MAX_ERR;
+}
+
+template <bool SIGMOID>
+bool exp_errors() {
+    bool ok = true;
+    ok &= exp_error<nrsim::ExpAcPwl, SIGMOID>("ac_pwl", NRSIM_EXP_AC_PWL, 0);
+    ok &= exp_error<nrsim::ExpCordic, SIGMOID>("cordic", NRSIM_EXP_CORDIC, 0);
+    ok &= exp_error<nrsim::ExpPwl<4>, SIGMOID>("pwl", NRSIM_EXP_PWL, 4);
+    ok &= exp_error<nrsim::ExpPwl<8>, SIGMOID>("pwl", NRSIM_EXP_PWL, 8);
+    ok &= exp_error<nrsim::ExpPwl<16>, SIGMOID>("pwl", NRSIM_EXP_PWL, 16);
+    ok &= exp_error<nrsim::ExpPwl<32>, SIGMOID>("pwl", NRSIM_EXP_PWL, 32);
+    ok &= exp_error<nrsim::ExpLut<16>, SIGMOID>("lut", NRSIM_EXP_LUT, 16);
+    ok &= exp_error<nrsim::ExpLut<32>, SIGMOID>("lut", NRSIM_EXP_LUT, 32);
+    ok &= exp_error<nrsim::ExpLut<64>, SIGMOID>("lut", NRSIM_EXP_LUT, 64);
+    return ok;
+}
+
+int exp_report() {
+    cout << "=== VRU exp / sigmoid implementations, " << EXP_SWEEP_POINTS + 1 << " points ===" << endl;
+    bool ok = exp_errors<false>();
+    ok &= exp_errors<true>();
+    return ok ? 0 : 1;
+}
+
 #pragma hls_design top
 class testbench : public sc_module {
 public:
@@ -21,15 +104,25 @@ public:
 
     Connections::Combinational<VRU_In_Type> VRUInput;
     Connections::Combinational<VRU_Out_Type> VRUOutput;
+    Connections::Combinational<ray_id_type> ray_term;
 
     NVHLS_DESIGN(VRU) dut;
 //    CCS_DESIGN(SDAcc) CCS_INIT_S1(dut);
 
+    int rays;
+    bool interleave;
+    nrsim::LatencyHistogram latency;
+    sc_time first_in;
+
     SC_CTOR(testbench) : clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
                    rst("rst"),
                    VRUInput("VRUInput"),
                    VRUOutput("VRUOutput"),
-                   dut("dut") {
+                   ray_term("ray_term"),
+                   dut("dut"),
+                   rays(5),
+                   interleave(false),
+                   latency("VRU", "ray") {
 
         sc_object_tracer<sc_clock> trace_clk(clk);
 
@@ -37,6 +130,7 @@ public:
         dut.rst(rst);
         dut.VRUInput(VRUInput);
         dut.VRUOutput(VRUOutput);
+        dut.ray_term(ray_term);
 
         SC_THREAD(reset);
         sensitive << clk.posedge_event();
@@ -48,6 +142,10 @@ public:
         SC_THREAD(collect);
         sensitive << clk.posedge_event();
         async_reset_signal_is(rst, false);
+
+        SC_THREAD(terminate);
+        sensitive << clk.posedge_event();
+        async_reset_signal_is(rst, false);
     }
 
     void reset() {
@@ -60,44 +158,134 @@ public:
         VRUInput.ResetWrite();
         wait(10);
 
-        // Test vru accumulation (5 times)
-        for (int t = 0; t < 5; t++) {
+        // Test vru accumulation (5 rays by default), interleave: VRU_RAY_BANKS rays at a time
+        first_in = sc_time_stamp();
+        int group = interleave ? VRU_RAY_BANKS : 1;
+        for (int base = 0; base < rays; base += group) {
             for (int i = 0; i < SAMPLE_NUM; i++) {
-                VRU_In_Type vru_in;
-                vru_in.emitted_c[0] = VRU_C_Type(1);
-                vru_in.emitted_c[1] = VRU_C_Type(2);
-                vru_in.emitted_c[2] = VRU_C_Type(3);
-                vru_in.sigma        = VRU_Sigma_Type(4);
-                vru_in.delta        = VRU_Delta_Type(5);
-                vru_in.isLastSample = ((i%SAMPLE_NUM) == SAMPLE_NUM-1);
-                VRUInput.Push(vru_in);
+                for (int t = base; t < base + group && t < rays; t++) {
+                    float c[3], sigma, delta;
+                    sample(t, i, c, sigma, delta);
+                    VRU_In_Type vru_in;
+                    vru_in.emitted_c[0] = VRU_C_Type(c[0]);
+                    vru_in.emitted_c[1] = VRU_C_Type(c[1]);
+                    vru_in.emitted_c[2] = VRU_C_Type(c[2]);
+                    vru_in.sigma        = VRU_Sigma_Type(sigma);
+                    vru_in.delta        = VRU_Delta_Type(delta);
+                    vru_in.ray          = t;
+                    vru_in.isLastSample = ((i%SAMPLE_NUM) == SAMPLE_NUM-1);
+                    VRUInput.Push(vru_in);
+                    if (i == 0) latency.In(t, sc_time_stamp() / sc_time(1, SC_NS));
+                }
             }
         }
     }
 
+    // Sample i of ray t, per-ray values in the interleave mode
+    void sample(int t, int i, float c[3], float &sigma, float &delta) {
+        if (!interleave) {
+            c[0] = 1; c[1] = 2; c[2] = 3;
+            sigma = 4;
+            delta = 5;
+            return;
+        }
+        c[0] = float(t % 3) - 1.0f;
+        c[1] = 0.5f * float(t % 5);
+        c[2] = -0.25f * float(i % 4);
+        sigma = 0.5f + 0.25f * float(t % 4);
+        delta = 0.03125f;
+    }
+
+    // Color of ray t through the VRU datapath with a single T / color register set
+    void serial_color(int t, VRU_Color_Type out[3]) {
+        VRU_Color_Type T = VRU_Color_Type(1);
+        VRU_Color_Type color[3] = {VRU_Color_Type(0), VRU_Color_Type(0), VRU_Color_Type(0)};
+        bool terminated = false;
+        for (int i = 0; i < SAMPLE_NUM && !terminated; i++) {
+            float c[3], sigma, delta;
+            sample(t, i, c, sigma, delta);
+            VRU_Exp_Type exp_result, sigmoid_result;
+            VRU_EXP_POLICY::exp(-VRU_Sigma_Type(sigma) * VRU_Delta_Type(delta), exp_result);
+            VRU_Color_Type tmp_T = T * exp_result;
+            for (int k = 0; k < 3; k++) {
+                VRU_SIGMOID_POLICY::sigmoid(VRU_C_Type(c[k]), sigmoid_result);
+                color[k] += sigmoid_result*(T - tmp_T);
+            }
+            T = tmp_T;
+#ifdef VRU_EARLY_TERMINATION
+            terminated = (T <= VRU_Color_Type(VRU_T_THRESHOLD) && i != SAMPLE_NUM-1);
+#endif
+        }
+        for (int k = 0; k < 3; k++) out[k] = color[k];
+    }
+
     void collect() {
         VRUOutput.ResetRead();
         while (1) {
             wait(); // 1 cc
 
-            for (int i = 0; i < 5; i++) {
+            int tag_errors = 0;
+            int color_errors = 0;
+            for (int i = 0; i < rays; i++) {
                 VRU_Out_Type tmp;
                 tmp = VRUOutput.Pop();
+                latency.Out(tmp.ray.to_int(), sc_time_stamp() / sc_time(1, SC_NS));
+                if (tmp.ray != ray_id_type(i)) tag_errors++;
+                VRU_Color_Type ref[3];
+                serial_color(tmp.ray.to_int(), ref);
+                for (int j = 0; j < 3; j++) {
+                    if (!(tmp.c[j] == ref[j])) color_errors++;
+                }
+                if (i >= 5) continue;
                 // compare with sample_color in vru_test.h
-                cout << "VRUOutput: @ timestep: " << sc_time_stamp() << endl;
+                cout << "VRUOutput: @ timestep: " << sc_time_stamp() << " ray " << tmp.ray << endl;
                 for (uint j = 0; j < 3; j++) {
                     cout << tmp.c[j] << " ";
                 }
                 cout << endl;
             }
+            cout << "Ray tags: " << rays - tag_errors << " of " << rays << " outputs tagged with their ray"
+                 << (tag_errors == 0 ? " ✓" : " ✗ (MISMATCH)") << endl;
+            cout << "Ray colors: " << 3*rays - color_errors << " of " << 3*rays << " match the one-ray-at-a-time datapath"
+                 << (color_errors == 0 ? " ✓" : " ✗ (MISMATCH)") << endl;
+            double cycles = (sc_time_stamp() - first_in) / sc_time(1, SC_NS);
+            cout << (interleave ? "Interleaved " : "Serial ") << "rays, VRU_RAY_BANKS = " << VRU_RAY_BANKS
+                 << ", VRU_RMW_LATENCY = " << VRU_RMW_LATENCY << ": " << cycles << " cycles, "
+                 << std::setprecision(3) << double(rays) * SAMPLE_NUM / cycles << " samples per cycle, "
+                 << dut.hazard_stall_cycles << " bank hazard stall cycles" << endl;
+            latency.Print();
+            latency.Write();
 
+            cout << "Early ray termination: " << dut.terminated_rays << " rays, "
+                 << dut.ignored_samples << " samples not accumulated" << endl;
             sc_stop();
         }
     }
+
+    void terminate() {
+        ray_term.ResetRead();
+        while (1) {
+            wait();
+
+            ray_id_type ray;
+            if (ray_term.PopNB(ray)) {
+                cout << "ray_term: ray " << ray << " @ timestep: " << sc_time_stamp() << endl;
+            }
+        }
+    }
 };
 
 int sc_main(int argc, char *argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "exp") {
+        return exp_report();
+    }
     testbench tb("tb");
+    int arg = 1;
+    if (argc > arg && std::string(argv[arg]) == "interleave") {
+        tb.interleave = true;
+        arg++;
+    }
+    if (argc > arg) tb.rays = atoi(argv[arg]);
     sc_start();
     return 0;
 }
@@ -31,7 +31,7 @@ public:
         while (1) {
             wait();
  
-            PCM_In_Type tmp = PCMInput.Pop();
+            PCM_In_Type tmp = NRSIM_POP(PCMInput);
             PCM_Out_Type ret;
             if (tmp == 0) {
                 ret.is_zero = true; 
@@ -43,7 +43,7 @@ public:
                 ret.X[2] = (tmp_int<<2) + tmp_int;   //  5x
                 ret.X[3] = (tmp_int<<3) - tmp_int;   //  7x
             }
-            PCMOutput.Push(ret);
+            NRSIM_PUSH(PCMOutput, ret);
         }
     }
 };
@@ -77,10 +77,10 @@ public:
         
         while (1) {
             wait();
-            bool has_weight = MULWeight.PopNB(w);
+            bool has_weight = NRSIM_POPNB(MULWeight, w);
             
 
-            SSA_In_Type tmp = SSAInput.Pop();
+            SSA_In_Type tmp = NRSIM_POP(SSAInput);
             SSA_Out_Type ret;
             if (tmp.is_zero) {
                 ret = 0;
@@ -111,10 +111,10 @@ public:
             //cout << "test: " << w << " "  << tmp.X[0] << " " << tmp.X[1] << " " << tmp.X[2] << " " << tmp.X[3] << " " << lower << upper << endl;
             }
             //cout << ret << endl;
-            SSAOutput.Push(ret);
+            NRSIM_PUSH(SSAOutput, ret);
 
             if (has_weight) {
-                MULWeight_prop.PushNB(w);
+                NRSIM_PUSHNB(MULWeight_prop, w);
             }
         }
     }
@@ -200,10 +200,10 @@ public:
         while (1) {
             wait();
 
-            MUL_In_Type tmp = MULInput.Pop();
-            MUL_In_Type w = MULWeight.Pop();
+            MUL_In_Type tmp = NRSIM_POP(MULInput);
+            MUL_In_Type w = NRSIM_POP(MULWeight);
             MUL_Out_Type ret = tmp*w >> nvhls::log2_ceil<SCALE>::val;              // Vanilla multiplier and truncation
-            MULOutput.Push(ret);
+            NRSIM_PUSH(MULOutput, ret);
         }
     }
 #elif MULTIPLIER == 1
@@ -219,8 +219,8 @@ public:
             wait();
 
             /*** Pre-Compute Module (PCM) ***/
-            MUL_In_Type tmp = MULInput.Pop();                     // Get input
-            MUL_In_Type w = MULWeight.Pop();                      // Get weight
+            MUL_In_Type tmp = NRSIM_POP(MULInput);                     // Get input
+            MUL_In_Type w = NRSIM_POP(MULWeight);                      // Get weight
             MUL_Out_Type ret;
             if (tmp == 0) {                                       // Gated ?
                 ret = 0;
@@ -254,7 +254,7 @@ public:
                     ret = -ret;
                 }
             }
-            MULOutput.Push(ret);
+            NRSIM_PUSH(MULOutput, ret);
         }
     }
 #elif MULTIPLIER == 2
@@ -269,8 +269,8 @@ public:
         while (1) {
             wait();
 
-            MUL_In_Type tmp = MULInput.Pop();                   // Get input
-            MUL_In_Type w = MULWeight.Pop();                    // Get weight
+            MUL_In_Type tmp = NRSIM_POP(MULInput);                   // Get input
+            MUL_In_Type w = NRSIM_POP(MULWeight);                    // Get weight
             MUL_Out_Type ret;
             if (tmp == 0) {                                     // Gated ?
                 ret = 0;
@@ -324,7 +324,7 @@ public:
                     ret = -ret;
                 }
             }
-            MULOutput.Push(ret);
+            NRSIM_PUSH(MULOutput, ret);
         }
     }
 #elif MULTIPLIER == 3
@@ -345,17 +345,17 @@ public:
             wait();
 
             MUL_In_Type tmp2, ttt; 
-            if (MULWeight.PopNB(tmp2)) {
-                MULWeight_wire.Push(tmp2);                // 1cc
-                MULWeight_prop.PopNB(ttt);                     // 1cc
+            if (NRSIM_POPNB(MULWeight, tmp2)) {
+                NRSIM_PUSH(MULWeight_wire, tmp2);                // 1cc
+                NRSIM_POPNB(MULWeight_prop, ttt);                     // 1cc
             }
             MUL_In_Type tmp;
-            if (MULInput.PopNB(tmp)) {
-                MULInput_wire.Push(tmp);                  // 1cc
+            if (NRSIM_POPNB(MULInput, tmp)) {
+                NRSIM_PUSH(MULInput_wire, tmp);                  // 1cc
             }
             MUL_Out_Type tmp3;
-            if (MULOutput_wire.PopNB(tmp3)) {
-                MULOutput.Push(tmp3);                     // 1cc
+            if (NRSIM_POPNB(MULOutput_wire, tmp3)) {
+                NRSIM_PUSH(MULOutput, tmp3);                     // 1cc
             }
         }
     }
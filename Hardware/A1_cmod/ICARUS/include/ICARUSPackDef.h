@@ -14,7 +14,11 @@
 
 // Helpers from https://github.com/hlslibs/matchlib_toolkit/blob/main/include/auto_gen_fields.h#L425
 // Slightly modify for marshall, width only
-#include "auto_gen_fields.h"
+#include "../../common/include/auto_gen_fields.h"
+
+// Channel / thread stall instrumentation, JSON summary at the end of the simulation (C model only)
+// #define NRSIM_INSTRUMENT
+#include "../../common/include/nrsim_instrument.h"
 
 #ifdef USE_FLOAT
 typedef ac_std_float<16, 8> TESTTYPE;
@@ -23,6 +27,24 @@ typedef ac_std_float<16, 8> TESTTYPE;
 typedef ac_fixed<9, 9, true, AC_TRN, AC_SAT> TESTTYPE; // saturated to nearest max/min
 #endif
 
+// Per-stage number formats, overridable from the compile flags (e.g. -DICARUS_MLP_ACC_FMT="ac_fixed<16,9,true,AC_TRN,AC_SAT>")
+// The fixed-point C model keeps the SCALE convention of TESTTYPE, precision_sweep/ compares formats on the host
+#ifndef ICARUS_POS_FMT
+#define ICARUS_POS_FMT TESTTYPE        // PEU positions and A*x
+#endif
+#ifndef ICARUS_CORDIC_FMT
+#define ICARUS_CORDIC_FMT TESTTYPE     // PEU sin/cos output, MLP input
+#endif
+#ifndef ICARUS_WEIGHT_FMT
+#define ICARUS_WEIGHT_FMT TESTTYPE     // PEU frequencies and MLP weights (shared MemReq write path)
+#endif
+#ifndef ICARUS_MLP_ACC_FMT
+#define ICARUS_MLP_ACC_FMT TESTTYPE    // MLP partial sums, hidden activations and output
+#endif
+#ifndef ICARUS_VRU_COLOR_FMT
+#define ICARUS_VRU_COLOR_FMT TESTTYPE  // VRU transmittance and color
+#endif
+
 // MUL types
 static int const MUL_PART     = 2;                    // number of selectors
 static int const BIT_PER_PART = 4;                    // selector width
@@ -47,33 +69,53 @@ typedef MUL_Out_Type SSA_Out_Type;
 /*** PEU Constants ***/
 static int const PEU_INPUT_DIM = 3;       // changeable
 static int const PEU_CORDIC_IN_DIM = 32; // changeable, tb_PEU: 30, tb_ICARUS: 128
+// PEU parallelism, overridable from the compile flags (e.g. HLS_DEFINES="-DPEU_CORDIC_UNITS=4" for make hls)
+#ifndef PEU_MAC_LANES
+#define PEU_MAC_LANES 4    // changeable, parallel MACs in PEU_MatMul, divides PEU_CORDIC_IN_DIM
+#endif
+#ifndef PEU_CORDIC_UNITS
+#define PEU_CORDIC_UNITS 1 // changeable, parallel sin/cos CORDIC pairs in PEU_CORDIC, divides PEU_CORDIC_IN_DIM
+#endif
 
 // Currently using float32 for correctness check
 /*** PEU Types ***/
-typedef TESTTYPE PEU_Matrix_A_Type;        // changeable
-typedef TESTTYPE PEU_Position_Type;        // changeable
-typedef TESTTYPE PEU_CORDIC_In_Elem_Type;  // changeable
-typedef TESTTYPE PEU_CORDIC_Out_Elem_Type; // changeable
+typedef ICARUS_WEIGHT_FMT PEU_Matrix_A_Type;        // changeable
+typedef ICARUS_POS_FMT PEU_Position_Type;           // changeable
+typedef ICARUS_POS_FMT PEU_CORDIC_In_Elem_Type;     // changeable
+typedef ICARUS_CORDIC_FMT PEU_CORDIC_Out_Elem_Type; // changeable
+typedef TESTTYPE PEU_Delta_Type;           // changeable, per-sample distance, passed through to VRU
+typedef ac_int<16, false> ray_id_type;     // ray counter, set by the ICARUS RunBatch (wraps)
+static int const WEIGHT_BANKS = 2;         // PEU / MLP weight memories are double-buffered
+typedef ac_int<1, false> wbank_type;       // weight bank a sample is computed with / a MemReq writes to
 
 class PEU_In_Type : public nvhls_message {
 public:
     PEU_Position_Type X[PEU_INPUT_DIM];
+    PEU_Delta_Type delta;
+    ray_id_type ray;
+    wbank_type wbank;
     bool isLastSample;
-    AUTO_GEN_FIELD_METHODS((X, isLastSample))
+    AUTO_GEN_FIELD_METHODS((X, delta, ray, wbank, isLastSample))
 };
 
 class PEU_CORDIC_In_Type : public nvhls_message {
 public:
     PEU_CORDIC_In_Elem_Type X[PEU_CORDIC_IN_DIM];
+    PEU_Delta_Type delta;
+    ray_id_type ray;
+    wbank_type wbank;
     bool isLastSample;
-    AUTO_GEN_FIELD_METHODS((X, isLastSample))
+    AUTO_GEN_FIELD_METHODS((X, delta, ray, wbank, isLastSample))
 };
 
 class PEU_Out_Type : public nvhls_message {
 public:
     PEU_CORDIC_Out_Elem_Type X[PEU_CORDIC_IN_DIM*2]; // *2 from sin, cos
+    PEU_Delta_Type delta;
+    ray_id_type ray;
+    wbank_type wbank;
     bool isLastSample;
-    AUTO_GEN_FIELD_METHODS((X, isLastSample))
+    AUTO_GEN_FIELD_METHODS((X, delta, ray, wbank, isLastSample))
 };
 
 
@@ -83,21 +125,34 @@ static int const MLP0_OUT_DIM = 256;                // changeable
 static int const MLP1_IN_DIM = MLP0_OUT_DIM;
 static int const MLP1_OUT_DIM = 4;
 static int const MAX_SAMPLE_NUM = 256;
-static int const BLOCK_SZ = 4;
+#ifndef BLOCK_SZ
+#define BLOCK_SZ 4                           // changeable, MLP_block/ssa/monb/sonb block edge
+#endif
+#define ICARUS_MLP_ENGINE MLP_block  // changeable, MLP used by the ICARUS top: MLP_vanilla, MLP_block, MLP_ssa
+#define MLP_SKIP_ZERO_BLOCK         // MLP_ssa/monb/sonb: all-zero BLOCK_SZ activation blocks skip the MAC cycle
 
 /*** MLP Types ***/
-typedef ac_int<nvhls::log2_ceil<MAX_SAMPLE_NUM>::val, false> sample_cnt; 
-typedef TESTTYPE MLP1_In_Elem_Type; // changeable
-typedef TESTTYPE MLP_In_Elem_Type;  // changeable
-typedef TESTTYPE MLP_Out_Elem_Type; // changeable
+typedef ac_int<nvhls::log2_ceil<MAX_SAMPLE_NUM>::val+1, false> sample_cnt; // also holds a full batch count (MAX_SAMPLE_NUM)
+typedef ICARUS_MLP_ACC_FMT MLP1_In_Elem_Type; // changeable
+typedef ICARUS_CORDIC_FMT MLP_In_Elem_Type;   // changeable
+typedef ICARUS_MLP_ACC_FMT MLP_Out_Elem_Type; // changeable
 typedef PEU_Matrix_A_Type MLP_Weight_Type;
 typedef PEU_Out_Type MLP_In_Type;
 
+// Monb -> Sonb: samples of the finished batch and the weight bank it uses
+class MLP_Batch_Type : public nvhls_message {
+public:
+    sample_cnt num;
+    wbank_type wbank;
+    AUTO_GEN_FIELD_METHODS((num, wbank))
+};
+
 class MLP1_In_Type : public nvhls_message {
 public:
     MLP1_In_Elem_Type X[MLP1_IN_DIM];
+    wbank_type wbank;
     bool isLastSample;
-    AUTO_GEN_FIELD_METHODS((X, isLastSample))
+    AUTO_GEN_FIELD_METHODS((X, wbank, isLastSample))
 };
 
 class MLP_Out_Type : public nvhls_message {
@@ -109,26 +164,55 @@ public:
 
 
 /*** VRU Constants ***/
+#define VRU_EARLY_TERMINATION          // stop integrating a ray once T <= VRU_T_THRESHOLD and report it on ray_term
+#ifndef VRU_T_THRESHOLD
+#define VRU_T_THRESHOLD 0.0001         // changeable
+#endif
+// exp of the transmittance and sigmoid of the color (common/include/nrsim_exp.h),
+// e.g. HLS_DEFINES="-DVRU_EXP_IMPL=NRSIM_EXP_PWL -DVRU_EXP_SEGMENTS=8"
+#ifndef VRU_EXP_IMPL
+#define VRU_EXP_IMPL NRSIM_EXP_CORDIC      // changeable, NRSIM_EXP_AC_PWL / NRSIM_EXP_CORDIC / NRSIM_EXP_PWL / NRSIM_EXP_LUT
+#endif
+#ifndef VRU_EXP_SEGMENTS
+#define VRU_EXP_SEGMENTS 16                // changeable, segments of NRSIM_EXP_PWL (4..32) / entries of NRSIM_EXP_LUT (16..64)
+#endif
+#ifndef VRU_SIGMOID_IMPL
+#define VRU_SIGMOID_IMPL NRSIM_EXP_AC_PWL  // changeable
+#endif
+#ifndef VRU_SIGMOID_SEGMENTS
+#define VRU_SIGMOID_SEGMENTS 16            // changeable
+#endif
+// Accumulator banks: ray r is integrated in bank r % VRU_RAY_BANKS (T and color), so the samples of up to
+// VRU_RAY_BANKS consecutive rays can come interleaved. A bank takes a sample every VRU_RMW_LATENCY cycles
+// (exp -> T / color read-modify-write), interleaving hides it. 1 / 1: one ray at a time, as before
+#ifndef VRU_RAY_BANKS
+#define VRU_RAY_BANKS 1                    // changeable, power of 2
+#endif
+#ifndef VRU_RMW_LATENCY
+#define VRU_RMW_LATENCY 1                  // changeable, 1: the update is not modeled as a hazard
+#endif
 
 /*** VRU Types ***/
 typedef MLP_Out_Elem_Type VRU_C_Type;
 typedef MLP_Out_Elem_Type VRU_Sigma_Type;
-typedef TESTTYPE VRU_Delta_Type;
-typedef TESTTYPE VRU_Color_Type;
+typedef PEU_Delta_Type VRU_Delta_Type;
+typedef ICARUS_VRU_COLOR_FMT VRU_Color_Type;
 
 class VRU_In_Type : public nvhls_message {
 public:
     VRU_C_Type emitted_c[3];
     VRU_Sigma_Type sigma;
     VRU_Delta_Type delta;
+    ray_id_type ray;
     bool isLastSample;
-    AUTO_GEN_FIELD_METHODS((emitted_c, sigma, delta, isLastSample))
+    AUTO_GEN_FIELD_METHODS((emitted_c, sigma, delta, ray, isLastSample))
 };
 
 class VRU_Out_Type : public nvhls_message {
 public:
     VRU_Color_Type c[3];
-    AUTO_GEN_FIELD_METHODS((c))
+    ray_id_type ray;    // ray of the last sample, the ray the color belongs to
+    AUTO_GEN_FIELD_METHODS((c, ray))
 };
 
 
@@ -136,30 +220,81 @@ public:
 static int const PEU_MLP_TO_DEPTH = 512;
 static int const MEMREQ_DEPTH = 512;
 static int const VRUOUT_DEPTH = 512;
+static int const TAG_DEPTH = 2*MAX_SAMPLE_NUM; // sample tags of the batches between TriggerMLP and MLP_to_VRU
+static int const RAY_TERM_WINDOW = 16;         // terminated rays remembered by the ICARUS top (rays in flight)
+static int const OP_QUEUE_DEPTH = 8;           // ICARUS instruction queue
+
+/*** DMA / off-chip memory Constants (ICARUS/DMA), overridable from the compile flags ***/
+#ifndef DRAM_LATENCY
+#define DRAM_LATENCY 100       // changeable, cycles from burst issue to its first data
+#endif
+#ifndef DRAM_BURST_BYTES
+#define DRAM_BURST_BYTES 64    // changeable
+#endif
+#ifndef DRAM_GBPS
+#define DRAM_GBPS 25.6         // changeable, peak bandwidth shared by reads and writes
+#endif
+#ifndef DRAM_CLK_GHZ
+#define DRAM_CLK_GHZ 0.4       // accelerator clock, DRAM_GBPS/DRAM_CLK_GHZ bytes per cycle (400 MHz, see ICARUS.h)
+#endif
+#define DMA_MAX_OUTSTANDING 16 // changeable, read bursts in flight
+#define DMA_WRITE_COALESCE 32  // idle cycles before a partial write burst is flushed
 
 /*** ICARUS Types ***/
 // For instructions
-enum inst_type {WEIGHT_INIT=0, READ_POS=1};      // modify this 
-class ICARUS_Op_In_Type : public nvhls_message { // TODO: modify this
+// WEIGHT_INIT: load num MemReqs from addr into weight bank wbank (overlaps batches on the other bank)
+// READ_POS:    run num samples from addr on the active weight bank
+// SET_OUT:     VRU outputs of the following batches are written from addr on
+// SWAP_WEIGHTS: following READ_POS use the other weight bank
+enum inst_type {WEIGHT_INIT=0, READ_POS=1, SET_OUT=2, SWAP_WEIGHTS=3};
+class ICARUS_Op_In_Type : public nvhls_message {
 public:
     ac_int<3, false> mode;  // opmode
     ac_int<32, false> addr; // offset to read address 
     uint num;               // some counter
     bool wr_en;             // write or read
-    AUTO_GEN_FIELD_METHODS((mode, addr, num, wr_en))
+    wbank_type wbank;       // WEIGHT_INIT: bank to load
+    AUTO_GEN_FIELD_METHODS((mode, addr, num, wr_en, wbank))
+};
+
+// DMA request, addresses are element offsets in a region of the off-chip memory
+enum dma_region {DMA_POS=0, DMA_WEIGHT=1, DMA_OUT=2};
+class DMA_Req_Type : public nvhls_message {
+public:
+    ac_int<2, false> region; // dma_region
+    ac_int<32, false> addr;  // first element (DMA_OUT: write pointer for the following VRU outputs)
+    uint num;                // elements to read (unused for DMA_OUT)
+    AUTO_GEN_FIELD_METHODS((region, addr, num))
+};
+
+// Per-sample side information, kept by the ICARUS top while the MLP works on the batch
+class Sample_Tag_Type : public nvhls_message {
+public:
+    ray_id_type ray;
+    VRU_Delta_Type delta;
+    wbank_type wbank;
+    bool isLastSample;       // last sample of the ray (not of the MLP batch)
+    AUTO_GEN_FIELD_METHODS((ray, delta, wbank, isLastSample))
 };
 
 
 
 // For write request to Matrix A memory
+// Weight write, a burst of len elements along a row: (index[0], index[1] + k), biases index[0] + k
+// MEMREQ_BURST sets the weight-load bus width (and the DMA bytes per MemReq), a burst does not cross a row
+#ifndef MEMREQ_BURST
+#define MEMREQ_BURST 1  // changeable, e.g. BLOCK_SZ or 16, divides MLP0_IN_DIM and MLP1_IN_DIM
+#endif
 class MemReq : public nvhls_message {
 public:
     bool forPEU;
     bool forMLP0;
     bool isBias;
+    wbank_type wbank;
     uint16 index[2];
-    PEU_Matrix_A_Type data;
-    AUTO_GEN_FIELD_METHODS((forPEU, forMLP0, isBias, index, data))
+    ac_int<nvhls::log2_ceil<MEMREQ_BURST>::val+1, false> len; // 1..MEMREQ_BURST
+    PEU_Matrix_A_Type data[MEMREQ_BURST];
+    AUTO_GEN_FIELD_METHODS((forPEU, forMLP0, isBias, wbank, index, len, data))
 };
 class CORDICINPUT : public nvhls_message {
 public:
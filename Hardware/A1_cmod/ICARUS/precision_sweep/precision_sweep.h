@@ -0,0 +1,170 @@
+#ifndef ICARUS_PRECISION_SWEEP_H
+#define ICARUS_PRECISION_SWEEP_H
+
+#include "ICARUSPackDef.h"
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+ * Host-side numerics of the ICARUS pipeline (PEU -> MLP -> VRU), templated on the per-stage formats
+ * Values are rounded to the stage format wherever the hardware stores or forwards them:
+ *   PEU:  A*x in Pos, sin/cos in Cordic
+ *   MLP:  weights in Weight, partial sums per BLOCK_SZ MACs (act_mem / out_mem) and activations in Acc
+ *   VRU:  exp, sigmoid, T and color in Color
+ * Data is in its natural range (no SCALE), ac_fixed<9,9>/SCALE 128 corresponds to ac_fixed<9,2>
+ * Not cycle accurate, compare against Precision<double, ...> to get the error of a format choice.
+ */
+template <typename PosT, typename CordicT, typename WeightT, typename AccT, typename ColorT>
+struct Precision {
+    typedef PosT Pos;
+    typedef CordicT Cordic;
+    typedef WeightT Weight;
+    typedef AccT Acc;
+    typedef ColorT Color;
+};
+
+// Rounding, multiplier width (mantissa for floats) and name of a format
+template <typename T> struct Fmt;
+template <> struct Fmt<double> {
+    static const int mult_width = 53;
+    static double Q(double x) { return x; }
+    static std::string Name() { return "double"; }
+};
+template <int W, int I, bool S, ac_q_mode QM, ac_o_mode OM> struct Fmt<ac_fixed<W, I, S, QM, OM> > {
+    static const int mult_width = W;
+    static double Q(double x) { return ac_fixed<W, I, S, QM, OM>(x).to_double(); }
+    static std::string Name() {
+        std::ostringstream s;
+        s << (S ? "fx" : "ufx") << "<" << W << "," << I << ">";
+        return s.str();
+    }
+};
+template <int W, int E> struct Fmt<ac_std_float<W, E> > {
+    static const int mult_width = W - E;
+    static double Q(double x) { return ac_std_float<W, E>(float(x)).to_float(); }
+    static std::string Name() {
+        std::ostringstream s;
+        s << "fp<" << W << "," << E << ">";
+        return s.str();
+    }
+};
+
+// Random scene: network parameters and rays, shared by every format
+struct Scene {
+    static const int RAYS = 16;
+    static const int SAMPLES = 64;   // samples per ray
+    double A[PEU_CORDIC_IN_DIM][PEU_INPUT_DIM];
+    double w0[MLP0_OUT_DIM][MLP0_IN_DIM], b0[MLP0_OUT_DIM];
+    double w1[MLP1_OUT_DIM][MLP1_IN_DIM], b1[MLP1_OUT_DIM];
+    double x[RAYS][SAMPLES][PEU_INPUT_DIM];
+    double delta;
+
+    explicit Scene(unsigned seed = 1) : delta(0.1) {
+        std::mt19937 gen(seed);
+        std::uniform_real_distribution<double> u(-1.0, 1.0);
+        for (int r = 0; r < PEU_CORDIC_IN_DIM; r++)
+            for (int k = 0; k < PEU_INPUT_DIM; k++) A[r][k] = 2.0 * u(gen);
+        for (int o = 0; o < MLP0_OUT_DIM; o++) {
+            b0[o] = 0.1 * u(gen);
+            for (int i = 0; i < MLP0_IN_DIM; i++) w0[o][i] = 0.25 * u(gen);
+        }
+        for (int o = 0; o < MLP1_OUT_DIM; o++) {
+            b1[o] = 0.1 * u(gen);
+            for (int i = 0; i < MLP1_IN_DIM; i++) w1[o][i] = 0.125 * u(gen);
+        }
+        // rays through the unit cube, samples evenly spaced
+        for (int r = 0; r < RAYS; r++) {
+            double o[PEU_INPUT_DIM], d[PEU_INPUT_DIM];
+            for (int k = 0; k < PEU_INPUT_DIM; k++) { o[k] = u(gen); d[k] = u(gen); }
+            for (int s = 0; s < SAMPLES; s++)
+                for (int k = 0; k < PEU_INPUT_DIM; k++) {
+                    double v = o[k] + d[k] * s / SAMPLES;
+                    x[r][s][k] = (v > 1.0) ? 1.0 : (v < -1.0) ? -1.0 : v;
+                }
+        }
+    }
+};
+
+template <typename Cfg>
+class ICARUS_Numerics {
+    typedef Fmt<typename Cfg::Pos> P;
+    typedef Fmt<typename Cfg::Cordic> C;
+    typedef Fmt<typename Cfg::Weight> W;
+    typedef Fmt<typename Cfg::Acc> A;
+    typedef Fmt<typename Cfg::Color> K;
+public:
+
+    static std::string Name() {
+        return P::Name() + " " + C::Name() + " " + W::Name() + " " + A::Name() + " " + K::Name();
+    }
+
+    // Multiplier bits summed over the multiplies of one sample (wa*wb per multiplier, array multiplier area)
+    static double MultBits() {
+        return double(PEU_CORDIC_IN_DIM) * PEU_INPUT_DIM * W::mult_width * P::mult_width
+             + double(MLP0_OUT_DIM) * MLP0_IN_DIM * W::mult_width * C::mult_width
+             + double(MLP1_OUT_DIM) * MLP1_IN_DIM * W::mult_width * A::mult_width
+             + 5.0 * K::mult_width * K::mult_width; // sigma*delta, T*exp, 3x sigmoid*(T-T')
+    }
+
+    // Render all rays, color[r][c]
+    static void Render(const Scene &sc, double color[Scene::RAYS][3]) {
+        for (int r = 0; r < Scene::RAYS; r++) {
+            double T = 1.0;
+            for (int c = 0; c < 3; c++) color[r][c] = 0.0;
+            for (int s = 0; s < Scene::SAMPLES; s++) {
+                double out[MLP1_OUT_DIM];
+                Sample(sc, sc.x[r][s], out);
+
+                double sigma = (out[3] > 0) ? out[3] : 0.0;
+                double e = K::Q(std::exp(A::Q(-sigma * sc.delta)));
+                double Tn = K::Q(T * e);
+                for (int c = 0; c < 3; c++) {
+                    double sig = K::Q(1.0 / (1.0 + std::exp(-out[c])));
+                    color[r][c] = K::Q(color[r][c] + K::Q(sig * (T - Tn)));
+                }
+                T = Tn;
+            }
+        }
+    }
+
+    // PEU + MLP of one sample
+    static void Sample(const Scene &sc, const double x[PEU_INPUT_DIM], double out[MLP1_OUT_DIM]) {
+        double enc[MLP0_IN_DIM];
+        for (int r = 0; r < PEU_CORDIC_IN_DIM; r++) {
+            double a = 0;
+            for (int k = 0; k < PEU_INPUT_DIM; k++)
+                a = P::Q(a + W::Q(sc.A[r][k]) * P::Q(x[k]));
+            // as PEU_CORDIC: the angle is over pi (ac_sin_cordic(x) = sin(pi*x)), sin and cos interleaved
+            enc[2*r+0] = C::Q(std::sin(M_PI * a));
+            enc[2*r+1] = C::Q(std::cos(M_PI * a));
+        }
+
+        double h[MLP1_IN_DIM];
+        for (int o = 0; o < MLP0_OUT_DIM; o++) {
+            double acc = A::Q(W::Q(sc.b0[o]));
+            for (int i = 0; i < MLP0_IN_DIM; i += BLOCK_SZ) {
+                double blk = acc;
+                for (int ii = 0; ii < BLOCK_SZ; ii++)
+                    blk += W::Q(sc.w0[o][i + ii]) * enc[i + ii];
+                acc = A::Q(blk); // psum stored per BLOCK_SZ
+            }
+            h[o] = (acc > 0) ? acc : 0.0; // ReLU
+        }
+
+        for (int o = 0; o < MLP1_OUT_DIM; o++) {
+            double acc = A::Q(W::Q(sc.b1[o]));
+            for (int i = 0; i < MLP1_IN_DIM; i += BLOCK_SZ) {
+                double blk = acc;
+                for (int ii = 0; ii < BLOCK_SZ; ii++)
+                    blk += W::Q(sc.w1[o][i + ii]) * h[i + ii];
+                acc = A::Q(blk);
+            }
+            out[o] = acc;
+        }
+    }
+};
+
+#endif //ICARUS_PRECISION_SWEEP_H
@@ -0,0 +1,118 @@
+#include "precision_sweep.h"
+#include <iomanip>
+#include <cstdlib>
+#include <systemc.h>
+
+/*
+ * Per-stage format sweep against a double-precision reference
+ * Usage: sim_precision_sweep [error budget, default 0.01]
+ * 1. one stage narrowed at a time, the others at WIDE bits
+ * 2. uniform and mixed formats
+ * Reports the mean/max absolute color error over Scene::RAYS rays and the multiplier bits per sample
+ * relative to the uniform 16-bit design, then the cheapest format within the error budget.
+ */
+
+static const int WIDE = 24;
+
+// Integer bits per stage: |A*x| < 8, sin/cos in [-1,1], |A| < 2, MLP psums < 16, color and T in [0,1]
+template <int P, int C, int W, int A, int K>
+struct Fixed : Precision<ac_fixed<P, 4, true, AC_TRN, AC_SAT>,
+                         ac_fixed<C, 2, true, AC_TRN, AC_SAT>,
+                         ac_fixed<W, 2, true, AC_TRN, AC_SAT>,
+                         ac_fixed<A, 5, true, AC_TRN, AC_SAT>,
+                         ac_fixed<K, 1, false, AC_TRN, AC_SAT> > {};
+
+typedef Precision<double, double, double, double, double> Reference;
+typedef Fixed<16, 16, 16, 16, 16> Baseline;
+
+class Sweep {
+public:
+    Sweep(double budget) : budget(budget), best_bits(0) {
+        ICARUS_Numerics<Reference>::Render(scene, ref);
+        base_bits = ICARUS_Numerics<Baseline>::MultBits();
+        cout << std::setw(10) << std::left << "sweep" << std::setw(50) << "pos cordic weight acc color"
+             << std::setw(12) << "mean err" << std::setw(12) << "max err" << "mult bits" << endl;
+    }
+
+    template <typename Cfg>
+    void Run(const std::string &tag) {
+        double color[Scene::RAYS][3];
+        ICARUS_Numerics<Cfg>::Render(scene, color);
+        double sum = 0, max = 0;
+        for (int r = 0; r < Scene::RAYS; r++)
+            for (int c = 0; c < 3; c++) {
+                double e = std::fabs(color[r][c] - ref[r][c]);
+                sum += e;
+                if (e > max) max = e;
+            }
+        double mean = sum / (Scene::RAYS * 3);
+        double bits = ICARUS_Numerics<Cfg>::MultBits() / base_bits;
+        cout << std::setw(10) << std::left << tag << std::setw(50) << ICARUS_Numerics<Cfg>::Name()
+             << std::setw(12) << std::setprecision(4) << mean << std::setw(12) << max
+             << std::fixed << std::setprecision(2) << bits << "x" << std::defaultfloat << endl;
+
+        if (mean <= budget && (best.empty() || bits < best_bits)) {
+            best = ICARUS_Numerics<Cfg>::Name();
+            best_bits = bits;
+        }
+        last_mean = mean;
+    }
+
+    // Narrow one stage to N bits at a time
+    template <int N>
+    void Stages() {
+        Run<Fixed<N, WIDE, WIDE, WIDE, WIDE> >("pos");
+        Run<Fixed<WIDE, N, WIDE, WIDE, WIDE> >("cordic");
+        Run<Fixed<WIDE, WIDE, N, WIDE, WIDE> >("weight");
+        Run<Fixed<WIDE, WIDE, WIDE, N, WIDE> >("acc");
+        Run<Fixed<WIDE, WIDE, WIDE, WIDE, N> >("color");
+    }
+
+    Scene scene;
+    double ref[Scene::RAYS][3];
+    double budget;
+    double base_bits;
+    double last_mean;
+    std::string best;
+    double best_bits;
+};
+
+int sc_main(int argc, char *argv[]) {
+    double budget = (argc > 1) ? atof(argv[1]) : 0.01;
+    Sweep sweep(budget);
+    bool pass = true;
+
+    // sanity: the wide format has to match the reference
+    sweep.Run<Fixed<WIDE, WIDE, WIDE, WIDE, WIDE> >("wide");
+    pass &= (sweep.last_mean < 1e-3);
+
+    // 1. per stage
+    sweep.Stages<16>();
+    sweep.Stages<12>();
+    sweep.Stages<10>();
+    sweep.Stages<8>();
+    sweep.Stages<6>();
+
+    // 2. uniform and mixed
+    sweep.Run<Baseline>("uniform");
+    sweep.Run<Fixed<12, 12, 12, 12, 12> >("uniform");
+    sweep.Run<Fixed<9, 9, 9, 9, 9> >("uniform");  // TESTTYPE, ac_fixed<9,9> with SCALE 128
+    sweep.Run<Precision<ac_std_float<16, 8>, ac_std_float<16, 8>, ac_std_float<16, 8>,
+                        ac_std_float<16, 8>, ac_std_float<16, 8> > >("uniform"); // TESTTYPE with USE_FLOAT
+    sweep.Run<Fixed<16, 10, 8, 16, 12> >("mixed");
+    sweep.Run<Fixed<12, 8, 8, 12, 10> >("mixed");
+    sweep.Run<Fixed<12, 8, 6, 12, 10> >("mixed");
+    sweep.Run<Fixed<10, 6, 6, 10, 8> >("mixed");
+    sweep.Run<Precision<ac_fixed<12, 4, true, AC_TRN, AC_SAT>, ac_fixed<8, 2, true, AC_TRN, AC_SAT>,
+                        ac_fixed<8, 2, true, AC_TRN, AC_SAT>, ac_std_float<16, 8>,
+                        ac_fixed<10, 1, false, AC_TRN, AC_SAT> > >("mixed"); // float accumulator
+
+    if (sweep.best.empty()) {
+        cout << "No format within the error budget " << budget << endl;
+    } else {
+        cout << "Cheapest within error budget " << budget << ": " << sweep.best << " ("
+             << std::fixed << std::setprecision(2) << sweep.best_bits << "x multiplier bits)" << endl;
+    }
+    cout << (pass ? "PASSED" : "FAILED") << endl;
+    return 0;
+}
@@ -0,0 +1,131 @@
+#ifndef NEUREX_FEATURETABLE_H
+#define NEUREX_FEATURETABLE_H
+
+#include "NEUREXPackDef.h"
+#include <nvhls_int.h>
+#include <nvhls_connections.h>
+#include <ac_std_float.h>
+#include <vector>
+
+/*
+ * Banked hash table SRAM between IGU and ICU
+ * Input: the 8 corner entries of one level (Hashed_addr from an IGU lane)
+ * Output: their 8 features of F channels together (ICU data_in)
+ * BANKS single-port banks, MAPPING (ft_mapping) picks the bank of an entry. The 8 lookups issue in parallel,
+ * lookups of the same entry are merged, different entries in one bank serialize: a sample takes as many
+ * cycles as its busiest bank (II 1 without conflicts). A bank word holds the F channels of one entry.
+ * In NEUREX a table serves one of LANES IGU lanes and holds only the levels of that lane (level % LANES), stored
+ * at level / LANES: simulation storage of LEVELS_PER_LANE x 2^TABLE_BITS x F. The bank mapping hashes the level.
+ * The table contents are written through the backdoor (Write).
+ * A Hashed_addr with reuse set (IGU_CORNER_REUSE) reads no bank, the features last read for its level
+ * (last_feat) are sent again.
+ */
+template <int BANKS = FT_BANKS, int MAPPING = FT_MAPPING, int LEVELS = IGU_LEVELS, int TABLE_BITS = IGU_TABLE_BITS,
+          int F = ICU_FEATURES, int LANES = 1>
+class FeatureTable : public match::Module {
+    SC_HAS_PROCESS(FeatureTable);
+public:
+
+    static const int BANK_BITS = nvhls::log2_ceil<BANKS>::val;
+    static const int LEVELS_PER_LANE = (LEVELS + LANES - 1) / LANES;
+
+    Connections::In<Hashed_addr> addr_in;
+    Connections::Out<ICU_Feat_Type<F> > feat_out;
+
+    FeatureTable(sc_module_name name) : match::Module(name),
+                                        addr_in("addr_in"),
+                                        feat_out("feat_out"),
+                                        table((LEVELS_PER_LANE << TABLE_BITS) * F, ICU_In_Elem(0.0f)) {
+        SC_THREAD(start);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+    }
+
+    std::vector<ICU_In_Elem> table;
+    ICU_Feat_Type<F> last_feat[LEVELS_PER_LANE];  // features of the previous lookup per level (corner reuse)
+
+    // Backdoor access for the testbench, level is one of the lane's levels
+    void Write(int level, int entry, int ch, const ICU_In_Elem &f) { table[Index(level, entry, ch)] = f; }
+    ICU_In_Elem Read(int level, int entry, int ch) const { return table[Index(level, entry, ch)]; }
+    static int Index(int level, int entry, int ch) { return (((level / LANES) << TABLE_BITS) + entry) * F + ch; }
+
+    // Statistics
+    unsigned long samples;         // Hashed_addr served (one level of one position)
+    unsigned long lookups;
+    unsigned long merged;          // lookups served by another corner's read of the same entry
+    unsigned long conflicts;       // lookups that waited for their bank
+    unsigned long conflict_cycles; // extra cycles spent serializing
+    unsigned long reused;          // Hashed_addr served from last_feat, 8 lookups avoided each
+
+    double CyclesPerSample() const { return samples ? double(samples + conflict_cycles) / samples : 0.0; }
+
+    static int Bank(int level, int corner, int entry) {
+        if (MAPPING == FT_MAP_CORNER) return corner % BANKS;
+        if (MAPPING == FT_MAP_LOW) return entry & (BANKS - 1);
+        int b = level;
+        for (int s = 0; s < TABLE_BITS; s += BANK_BITS) b ^= entry >> s;
+        return b & (BANKS - 1);
+    }
+
+    void start() {
+        addr_in.Reset();
+        feat_out.Reset();
+        samples = lookups = merged = conflicts = conflict_cycles = reused = 0;
+        wait();
+
+        #pragma hls_pipeline_init_interval 1
+        while (1) {
+            wait();
+
+            Hashed_addr addr;
+            if (NRSIM_POPNB(addr_in, addr)) {
+                int level = addr.level.to_int();
+                if (addr.reuse) {
+                    samples++;
+                    reused++;
+                    NRSIM_PUSH(feat_out, last_feat[level / LANES]);
+                    continue;
+                }
+                int reads[BANKS];
+                #pragma hls_unroll yes
+                for (int b = 0; b < BANKS; b++) reads[b] = 0;
+
+                // Distinct entries per bank
+                #pragma hls_unroll yes
+                for (int c = 0; c < 8; c++) {
+                    bool dup = false;
+                    for (int d = 0; d < c; d++) {
+                        dup |= (addr.x[d] == addr.x[c]) && (Bank(level, d, addr.x[d]) == Bank(level, c, addr.x[c]));
+                    }
+                    if (dup) {
+                        merged++;
+                    } else {
+                        reads[Bank(level, c, addr.x[c])]++;
+                    }
+                }
+                int cycles = 1;
+                #pragma hls_unroll yes
+                for (int b = 0; b < BANKS; b++) {
+                    if (reads[b] > 1) conflicts += reads[b] - 1;
+                    if (reads[b] > cycles) cycles = reads[b];
+                }
+                for (int c = 1; c < cycles; c++) wait();
+
+                ICU_Feat_Type<F> feat;
+                #pragma hls_unroll yes
+                for (int c = 0; c < 8; c++) {
+                    #pragma hls_unroll yes
+                    for (int f = 0; f < F; f++) feat.x[c*F + f] = Read(level, addr.x[c], f);
+                }
+
+                samples++;
+                lookups += 8;
+                conflict_cycles += cycles - 1;
+                last_feat[level / LANES] = feat;
+                NRSIM_PUSH(feat_out, feat);
+            }
+        }
+    }
+};
+
+#endif //NEUREX_FEATURETABLE_H
@@ -0,0 +1,238 @@
+#include "FeatureTable.h"
+#include "../IGU/IGU.h"
+#include <nvhls_verify.h>
+#include "nvhls_connections.h"
+#include "ac_sysc_trace.h"
+#include <random>
+#include <systemc.h>
+#include <nvhls_module.h>
+#include <mc_connections.h>
+#include <cmath>
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+/*
+ * Usage: sim_FeatureTable [samples, default 256] [rays]
+ * IGU (one lane, 2^TABLE_BITS entries per level) -> FeatureTable for several bank counts and mappings,
+ * the same random positions on each. Features (ICU_FEATURES channels) are checked against the table contents at the reference
+ * corner entries; lookups, merged lookups, bank conflicts and cycles per level lookup are reported.
+ * rays: the positions march along random rays (RAY_SAMPLES per ray, RAY_STEP apart) instead, with IGU_CORNER_REUSE
+ * the level lookups served from the previous sample of the level and the table lookups avoided are reported.
+ */
+
+static const int TABLE_BITS = 14;
+static const int RAY_SAMPLES = 32;
+static const float RAY_STEP = 1.0f / 256;
+static int ft_running = 0; // Tops still simulating, the last one stops
+static const char *mapping_name[] = {"low bits", "xor fold", "per corner"};
+
+template <int BANKS, int MAPPING>
+class Top : public sc_module {
+    SC_HAS_PROCESS(Top);
+public:
+    static const int LEVELS = IGU_LEVELS;
+
+    sc_clock clk;
+    sc_signal<bool> rst;
+
+    Connections::Combinational<IGU_Level_Res> level_res;
+    Connections::Combinational<IGU_In_Type> pos;
+    Connections::Combinational<Hashed_addr> hashed_addr[1];
+    Connections::Combinational<IGU_Weight> weight[1];
+    Connections::Combinational<ICU_Feat_Type<> > feat;
+
+    IGU<IGU_LEVELS, 1, TABLE_BITS> igu;
+    FeatureTable<BANKS, MAPPING, IGU_LEVELS, TABLE_BITS> dut;
+
+    int samples;
+    std::vector<float> positions;  // [sample][3]
+    int res[LEVELS];
+    int errors;
+    sc_time first, last;
+
+    Top(sc_module_name name, int samples, bool rays) : sc_module(name),
+                   clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
+                   rst("rst"),
+                   level_res("level_res"),
+                   pos("pos"),
+                   feat("feat"),
+                   igu("igu"),
+                   dut("dut"),
+                   samples(samples),
+                   errors(0) {
+
+        sc_object_tracer<sc_clock> trace_clk(clk);
+
+        igu.clk(clk);
+        igu.rst(rst);
+        igu.level_res(level_res);
+        igu.pos(pos);
+        igu.hashed_addr[0](hashed_addr[0]);
+        igu.weight[0](weight[0]);
+
+        dut.clk(clk);
+        dut.rst(rst);
+        dut.addr_in(hashed_addr[0]);
+        dut.feat_out(feat);
+
+        for (int l = 0; l < LEVELS; l++) {
+            for (int e = 0; e < (1 << TABLE_BITS); e++) {
+                for (int f = 0; f < ICU_FEATURES; f++) dut.Write(l, e, f, Feature(l, e, f));
+            }
+        }
+
+        // Instant-NGP resolutions, 16 to 512 geometric
+        double b = std::exp((std::log(512.0) - std::log(16.0)) / (LEVELS - 1));
+        for (int l = 0; l < LEVELS; l++) res[l] = int(std::floor(16.0 * std::pow(b, l)));
+        std::mt19937 gen(1);
+        std::uniform_real_distribution<float> u(0.0f, 0.999f);
+        positions.resize(samples * 3);
+        for (auto &p : positions) p = u(gen);
+        if (rays) {
+            std::normal_distribution<float> n(0.0f, 1.0f);
+            float o[3], d[3];
+            for (int s = 0; s < samples; s++) {
+                if (s % RAY_SAMPLES == 0) {
+                    float len = 0.0f;
+                    for (int i = 0; i < 3; i++) {
+                        o[i] = 0.25f + 0.5f * u(gen);
+                        d[i] = n(gen);
+                        len += d[i] * d[i];
+                    }
+                    for (int i = 0; i < 3; i++) d[i] /= std::sqrt(len);
+                }
+                for (int i = 0; i < 3; i++) {
+                    float p = o[i] + d[i] * RAY_STEP * (s % RAY_SAMPLES);
+                    positions[s*3 + i] = std::min(std::max(p, 0.0f), 0.999f);
+                }
+            }
+        }
+        ft_running++;
+
+        SC_THREAD(reset);
+        sensitive << clk.posedge_event();
+
+        SC_THREAD(run);
+        sensitive << clk.posedge_event();
+        async_reset_signal_is(rst, false);
+
+        SC_THREAD(collect);
+        sensitive << clk.posedge_event();
+        async_reset_signal_is(rst, false);
+
+        SC_THREAD(sink);
+        sensitive << clk.posedge_event();
+        async_reset_signal_is(rst, false);
+    }
+
+    static ICU_In_Elem Feature(int level, int entry, int ch) {
+        return ICU_In_Elem(float((level * 7919 + entry * ICU_FEATURES + ch) % 1024) / 1024);
+    }
+
+    void reset() {
+        rst.write(false);
+        wait(10);
+        rst.write(true);
+    }
+
+    void run() {
+        level_res.ResetWrite();
+        pos.ResetWrite();
+        wait(10);
+
+        for (int l = 0; l < LEVELS; l++) {
+            IGU_Level_Res cfg;
+            cfg.level = l;
+            cfg.res = res[l];
+            level_res.Push(cfg);
+        }
+        wait(2);
+
+        for (int s = 0; s < samples; s++) {
+            IGU_In_Type in;
+            for (int i = 0; i < 3; i++) in.x[i] = IGU_In_Elem_Type(positions[s*3 + i]);
+            pos.Push(in);
+        }
+    }
+
+    // Interpolation weights go to ICU, unused here
+    void sink() {
+        weight[0].ResetRead();
+        wait();
+        while (1) {
+            wait();
+            IGU_Weight w;
+            weight[0].PopNB(w);
+        }
+    }
+
+    // Corner entries of one level, as IGU::Encode
+    void Entries(int s, int level, int entry[8]) const {
+        int lower[3];
+        for (int i = 0; i < 3; i++) lower[i] = int(positions[s*3 + i] * float(res[level]));
+        for (int c = 0; c < 8; c++) {
+            unsigned v[3];
+            for (int i = 0; i < 3; i++) v[i] = unsigned(lower[i] + ((c >> (2 - i)) & 1));
+            entry[c] = int((v[0] ^ (v[1] * IGU_P1) ^ (v[2] * IGU_P2)) & ((1u << TABLE_BITS) - 1));
+        }
+    }
+
+    void collect() {
+        feat.ResetRead();
+        wait(10);
+
+        for (int s = 0; s < samples; s++) {
+            for (int level = 0; level < LEVELS; level++) {
+                ICU_Feat_Type<> f = feat.Pop();
+                if (s == 0 && level == 0) first = sc_time_stamp();
+                int entry[8];
+                Entries(s, level, entry);
+                bool ok = true;
+                for (int c = 0; c < 8; c++) {
+                    for (int ch = 0; ch < ICU_FEATURES; ch++) ok &= (f.x[c*ICU_FEATURES + ch] == Feature(level, entry[c], ch));
+                }
+                if (!ok && errors++ < 5) cout << "✗ (MISMATCH) " << name() << " sample " << s << " level " << level << endl;
+            }
+        }
+        last = sc_time_stamp();
+
+        if (--ft_running == 0) sc_stop();
+    }
+
+    bool Report() const {
+        double cycles = (last - first) / sc_time(1, SC_NS) + 1;
+        cout << ((errors == 0) ? "✓ " : "✗ (MISMATCH) ") << BANKS << " banks, " << mapping_name[MAPPING] << ": "
+             << dut.lookups << " lookups, " << dut.merged << " merged, " << dut.conflicts << " conflicts, "
+             << dut.CyclesPerSample() << " cycles per level lookup, " << cycles / samples << " cycles/sample";
+        if (IGU_CORNER_REUSE) {
+            cout << ", corner reuse: " << dut.reused << " of " << dut.samples << " level lookups, "
+                 << 8 * dut.reused << " table lookups avoided";
+        }
+        cout << endl;
+        return errors == 0;
+    }
+};
+
+int sc_main(int argc, char *argv[]) {
+    int samples = (argc > 1) ? atoi(argv[1]) : 256;
+    bool rays = (argc > 2) && std::string(argv[2]) == "rays";
+
+    Top<4, FT_MAP_XOR> b4("b4", samples, rays);
+    Top<8, FT_MAP_LOW> b8_low("b8_low", samples, rays);
+    Top<8, FT_MAP_XOR> b8_xor("b8_xor", samples, rays);
+    Top<16, FT_MAP_XOR> b16_xor("b16_xor", samples, rays);
+    Top<32, FT_MAP_XOR> b32_xor("b32_xor", samples, rays);
+    Top<8, FT_MAP_CORNER> b8_corner("b8_corner", samples, rays);
+    sc_start();
+
+    bool pass = b4.Report();
+    pass &= b8_low.Report();
+    pass &= b8_xor.Report();
+    pass &= b16_xor.Report();
+    pass &= b32_xor.Report();
+    pass &= b8_corner.Report();
+    cout << (pass ? "PASSED" : "FAILED") << endl;
+    return 0;
+}
@@ -0,0 +1,237 @@
+#ifndef NEUREX_GEMM_H
+#define NEUREX_GEMM_H
+
+#include "NEUREXPackDef.h"
+#include <nvhls_connections.h>
+#include <vector>
+
+#include "../NPU/NPU.h"
+#include "../NPU/NPU_behavioral.h"
+
+/*
+ * Tile schedule of one M x K x N GEMM on the NPU_SIZE array (weight stationary)
+ * B is cut into kt x nt tiles of NPU_SIZE x NPU_SIZE, tile q = nt_index * kt + kt_index (the K tiles of an output
+ * column block are consecutive). Tile q streams the M rows of A[:, kt_index] from cycle T(q), row i of the array
+ * one cycle later per i; its weights are pushed bottom row first from Load(q), one row per cycle.
+ * overlap: the next tile loads into the shadow registers NPU_SIZE cycles after T(q), once the swap of tile q has
+ *          passed the last column, and starts once the shadow is settled, period max(M, 2 NPU_SIZE)
+ * serial:  the next tile loads after the last activation of tile q entered the array, period M + 2 NPU_SIZE - 1
+ */
+class GEMM_Schedule {
+public:
+    static const int N = NPU_SIZE;
+
+    int M, K, NC;
+    int kt, nt;   // K tiles, N tiles
+    int P;        // cycles between tile starts
+    int L;        // cycles from a tile start to the weight load of the next one
+
+    GEMM_Schedule(const GEMM_Req_Type &r) : M(r.M.to_int()), K(r.K.to_int()), NC(r.N.to_int()) {
+        kt = (K + N - 1) / N;
+        nt = (NC + N - 1) / N;
+        P = r.overlap ? ((M > 2*N) ? M : 2*N) : M + 2*N - 1;
+        L = r.overlap ? N : M + N - 1;
+    }
+
+    int Tiles() const { return kt * nt; }
+    int KTile(int q) const { return q % kt; }
+    int NTile(int q) const { return q / kt; }
+    int T(int q) const { return N + q * P; }
+    int Load(int q) const { return q ? T(q-1) + L : 0; }
+
+    // Act vectors pushed, one per cycle (the last tile's last row ends with it)
+    int FeedCycles() const { return T(Tiles()-1) + M + N - 1; }
+
+    // Tile whose row 0 window covers cycle t (m: row of A), -1 between tiles
+    int Tile(int t, int &m) const {
+        if (t < N) return -1;
+        int q = (t - N) / P;
+        m = t - T(q);
+        return (q < Tiles() && m < M) ? q : -1;
+    }
+
+    // Tile whose weights are pushed in cycle t (row: row of the tile), -1 if none
+    int Loading(int t, int &row) const {
+        for (int q = 0; q < Tiles(); q++) {
+            int d = t - Load(q);
+            if (d < 0) break;
+            if (d < N) {
+                row = N - 1 - d;
+                return q;
+            }
+        }
+        return -1;
+    }
+};
+
+/*
+ * GEMM controller on a weight double-buffered NPU_WS array (ENGINE: NEUREX_NPU<NPU_WS, true> or NPU_behavioral<NPU_WS, true>)
+ * Input: GEMM requests, operands from the backing store A[M][K], B[K][N] (row major, written by the testbench)
+ * Output: done once C[M][N] (wrapped to NPU_Out_Elem_Type) is complete
+ * Feed:  weight tiles (prefetched into the shadow registers) and skewed activation vectors, one of each per cycle,
+ *        act_in.swap marks the first element of every tile per row, the last vector is flagged last
+ * Drain: accumulates the K tiles of each output block into C, the v-th valid psum of column j belongs to act
+ *        vector v (its row NPU_SIZE-1 element), done with the psum_out tagged last
+ * Requests are served one after another.
+ * Simulation model (std::vector backing store), the NPU stays the HLS target.
+ */
+template <typename ENGINE = NEUREX_NPU<NPU_WS, true> >
+class GEMM : public match::Module {
+    SC_HAS_PROCESS(GEMM);
+public:
+    static const int N = NPU_SIZE;
+
+    Connections::In<GEMM_Req_Type> req;
+    Connections::Out<bool>         done;
+
+    ENGINE npu;
+
+    Connections::Combinational<NPU_W_Type>    w_data;
+    Connections::Combinational<NPU_In_Type>   act_data;
+    Connections::Combinational<NPU_Out_Type>  psum_data;
+    Connections::Combinational<GEMM_Req_Type> drain_req;   // Feed -> Drain, the running GEMM
+    Connections::Combinational<bool>          drain_done;  // Drain -> Feed, C complete
+
+    GEMM(sc_module_name name) : match::Module(name),
+                                req("req"),
+                                done("done"),
+                                npu("npu"),
+                                w_data("w_data"),
+                                act_data("act_data"),
+                                psum_data("psum_data"),
+                                drain_req("drain_req"),
+                                drain_done("drain_done") {
+        npu.clk(clk);
+        npu.rst(rst);
+        npu.w_in(w_data);
+        npu.act_in(act_data);
+        npu.psum_out(psum_data);
+
+        SC_THREAD(Feed);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+
+        SC_THREAD(Drain);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+    }
+
+    // Backing store
+    std::vector<int> A, B;
+    std::vector<NPU_Out_Elem_Type> C;
+
+    // Statistics
+    unsigned long gemms;
+    unsigned long tiles;
+    unsigned long macs;           // M*K*N of the served GEMMs
+    unsigned long busy_cycles;    // request to done
+    unsigned long last_cycles;    // of the last GEMM
+
+    double Utilization() const { return busy_cycles ? double(macs) / (double(N) * N * busy_cycles) : 0.0; }
+
+    void Feed() {
+        req.Reset();
+        done.Reset();
+        w_data.ResetWrite();
+        act_data.ResetWrite();
+        drain_req.ResetWrite();
+        drain_done.ResetRead();
+        gemms = tiles = macs = busy_cycles = last_cycles = 0;
+        wait();
+
+        while (1) {
+            wait();
+
+            GEMM_Req_Type r;
+            if (NRSIM_POPNB(req, r)) {
+                C.assign(r.M.to_int() * r.N.to_int(), NPU_Out_Elem_Type(0));
+                last_cycles = Run(r);
+                gemms++;
+                tiles += GEMM_Schedule(r).Tiles();
+                macs += (unsigned long)r.M.to_int() * r.K.to_int() * r.N.to_int();
+                busy_cycles += last_cycles;
+                NRSIM_PUSH(done, true);
+            }
+        }
+    }
+
+    // Stream one GEMM, returns the cycles until the drain finished
+    unsigned long Run(const GEMM_Req_Type &r) {
+        GEMM_Schedule s(r);
+        NRSIM_PUSH(drain_req, r);
+
+        unsigned long c = 0;
+        for (int t = 0; t < s.FeedCycles(); t++, c++) {
+            int row, q = s.Loading(t, row);
+            if (q >= 0) {
+                NPU_W_Type w;
+                int k = s.KTile(q) * N + row;
+                for (int j = 0; j < N; j++) {
+                    int n = s.NTile(q) * N + j;
+                    w.X[j] = NPU_W_Elem_Type((k < s.K && n < s.NC) ? B[k * s.NC + n] : 0);
+                }
+                NRSIM_PUSH(w_data, w);
+            }
+
+            NPU_In_Type x;
+            x.swap = 0;
+            x.last = (t == s.FeedCycles() - 1);
+            for (int i = 0; i < N; i++) {
+                int m, qa = s.Tile(t - i, m);
+                int k = (qa >= 0) ? s.KTile(qa) * N + i : s.K;
+                x.X[i] = NPU_In_Elem_Type((k < s.K) ? A[m * s.K + k] : 0);
+                if (qa >= 0 && m == 0) x.swap[i] = 1;
+            }
+            NRSIM_PUSH(act_data, x);
+            wait();
+        }
+
+        bool finished;
+        while (!NRSIM_POPNB(drain_done, finished)) {
+            wait();
+            c++;
+        }
+        return c;
+    }
+
+    void Drain() {
+        psum_data.ResetRead();
+        drain_req.ResetRead();
+        drain_done.ResetWrite();
+        wait();
+
+        while (1) {
+            wait();
+
+            GEMM_Req_Type r;
+            if (NRSIM_POPNB(drain_req, r)) {
+                Collect(r);
+                NRSIM_PUSH(drain_done, true);
+            }
+        }
+    }
+
+    // Psum v of column j is row m of tile q when v = T(q) + m + (N-1), act vector v carried it into row N-1
+    void Collect(const GEMM_Req_Type &r) {
+        GEMM_Schedule s(r);
+        int count[N];
+        for (int j = 0; j < N; j++) count[j] = 0;
+
+        bool last = false;
+        while (!last) {
+            wait();
+
+            NPU_Out_Type out;
+            if (!NRSIM_POPNB(psum_data, out)) continue;
+            for (int j = 0; j < N; j++) {
+                if (!out.valid[j]) continue;
+                int m, q = s.Tile(count[j]++ - (N-1), m);
+                int n = (q >= 0) ? s.NTile(q) * N + j : s.NC;
+                if (n < s.NC) C[m * s.NC + n] = NPU_Out_Elem_Type(C[m * s.NC + n] + out.X[j]);
+            }
+            last = out.last;
+        }
+    }
+};
+
+#endif // NEUREX_GEMM_H
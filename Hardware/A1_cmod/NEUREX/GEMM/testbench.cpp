@@ -0,0 +1,170 @@
+#include "GEMM.h"
+#include <nvhls_verify.h>
+#include "nvhls_connections.h"
+#include "ac_sysc_trace.h"
+#include <random>
+#include <systemc.h>
+#include <nvhls_module.h>
+#include <mc_connections.h>
+#include <cstdlib>
+#include <vector>
+
+/*
+ * Usage: sim_GEMM [pe | behavioral] [M K N [zero fraction]]
+ * Each GEMM (default a list of shapes up to several tiles in K and N) runs twice on the same controller,
+ * the weight tiles loaded serially and preloaded during the previous tile, C is checked against the
+ * reference, cycles from request to done and array utilization are reported for both.
+ * behavioral (default) uses NPU_behavioral as the array, pe the NPU_PE array.
+ * Shapes with a zero fraction get ReLU-like sparse activations, with NPU_ZERO_SKIP the share of PE
+ * products skipped (skew padding included) is reported.
+ */
+
+struct Shape {
+    int M, K, N;
+    double zeros;  // fraction of A set to zero
+};
+
+template <typename ENGINE>
+class Top : public sc_module {
+    SC_HAS_PROCESS(Top);
+public:
+    sc_clock clk;
+    sc_signal<bool> rst;
+
+    Connections::Combinational<GEMM_Req_Type> req;
+    Connections::Combinational<bool>          done;
+
+    GEMM<ENGINE> dut;
+
+    std::vector<Shape> shapes;
+    bool pass;
+
+    Top(sc_module_name name, const std::vector<Shape> &shapes) : sc_module(name),
+                   clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
+                   rst("rst"),
+                   req("req"),
+                   done("done"),
+                   dut("dut"),
+                   shapes(shapes),
+                   pass(true) {
+
+        sc_object_tracer<sc_clock> trace_clk(clk);
+
+        dut.clk(clk);
+        dut.rst(rst);
+        dut.req(req);
+        dut.done(done);
+
+        SC_THREAD(reset);
+        sensitive << clk.posedge_event();
+
+        SC_THREAD(run);
+        sensitive << clk.posedge_event();
+        async_reset_signal_is(rst, false);
+    }
+
+    void reset() {
+        rst.write(false);
+        wait(10);
+        rst.write(true);
+    }
+
+    // Serve one request, cycles until done
+    unsigned long Serve(const Shape &sh, bool overlap) {
+        GEMM_Req_Type r;
+        r.M = sh.M;
+        r.K = sh.K;
+        r.N = sh.N;
+        r.overlap = overlap;
+        req.Push(r);
+        done.Pop();
+        return dut.last_cycles;
+    }
+
+    bool Check(const Shape &sh) const {
+        int errors = 0;
+        for (int m = 0; m < sh.M; m++) {
+            for (int n = 0; n < sh.N; n++) {
+                int c = 0;
+                for (int k = 0; k < sh.K; k++) c += dut.A[m*sh.K + k] * dut.B[k*sh.N + n];
+                if (dut.C[m*sh.N + n] != NPU_Out_Elem_Type(c)) {
+                    if (errors < 5) {
+                        cout << "  C[" << m << "][" << n << "] = " << dut.C[m*sh.N + n] << ", expected " << c << endl;
+                    }
+                    errors++;
+                }
+            }
+        }
+        return errors == 0;
+    }
+
+    void run() {
+        req.ResetWrite();
+        done.ResetRead();
+        wait(10);
+
+        std::mt19937 gen(1);
+        std::uniform_int_distribution<int> u(-4, 4);
+        std::uniform_real_distribution<double> z(0, 1);
+        for (const Shape &sh : shapes) {
+            dut.A.resize(sh.M * sh.K);
+            dut.B.resize(sh.K * sh.N);
+            for (auto &a : dut.A) a = (z(gen) < sh.zeros) ? 0 : u(gen);
+            for (auto &b : dut.B) b = u(gen);
+
+            unsigned long macs0 = dut.npu.Macs(), skipped0 = dut.npu.Skipped();
+            unsigned long serial = Serve(sh, false);
+            bool ok = Check(sh);
+            unsigned long overlap = Serve(sh, true);
+            ok &= Check(sh);
+            pass &= ok;
+
+            double macs = double(sh.M) * sh.K * sh.N;
+            double peak = double(NPU_SIZE) * NPU_SIZE;
+            cout << (ok ? "✓ " : "✗ (MISMATCH) ") << sh.M << "x" << sh.K << "x" << sh.N << " GEMM, "
+                 << NPU_SIZE << "x" << NPU_SIZE << " array, "
+                 << ((sh.K + NPU_SIZE - 1) / NPU_SIZE) * ((sh.N + NPU_SIZE - 1) / NPU_SIZE) << " tiles: serial "
+                 << serial << " cycles (" << 100 * macs / (peak * serial) << "% utilization), double buffered "
+                 << overlap << " cycles (" << 100 * macs / (peak * overlap) << "%), "
+                 << double(serial) / overlap << "x" << endl;
+            if (sh.zeros > 0) {
+                double skipped = dut.npu.Skipped() - skipped0;
+                double products = skipped + (dut.npu.Macs() - macs0);
+                cout << "  " << 100 * sh.zeros << "% zero activations, "
+                     << (NPU_ZERO_SKIP ? "" : "NPU_ZERO_SKIP off, ") << 100 * skipped / products
+                     << "% of PE products skipped" << endl;
+            }
+        }
+
+        cout << dut.gemms << " GEMMs, " << dut.tiles << " tiles, overall utilization "
+             << 100 * dut.Utilization() << "%, " << dut.npu.Macs() << " PE products, "
+             << dut.npu.Skipped() << " skipped" << endl;
+        cout << (pass ? "PASSED" : "FAILED") << endl;
+        sc_stop();
+    }
+};
+
+int sc_main(int argc, char *argv[]) {
+    std::string mode = (argc > 1) ? argv[1] : "behavioral";
+    std::vector<Shape> shapes;
+    if (argc > 4) {
+        shapes.push_back({atoi(argv[2]), atoi(argv[3]), atoi(argv[4]), (argc > 5) ? atof(argv[5]) : 0.0});
+    } else {
+        shapes = {{1, NPU_SIZE, NPU_SIZE, 0},
+                  {8, NPU_SIZE, NPU_SIZE, 0},
+                  {2*NPU_SIZE, 100, 70, 0},
+                  {128, 256, 128, 0},
+                  {512, 64, 96, 0},
+                  {128, 256, 128, 0.5},
+                  {128, 256, 128, 0.9}};
+    }
+
+    if (mode == "pe") {
+        Top<NEUREX_NPU<NPU_WS, true> > tb("tb", shapes);
+        sc_start();
+    } else {
+        Top<NPU_behavioral<NPU_WS, true> > tb("tb", shapes);
+        sc_start();
+    }
+    return 0;
+}
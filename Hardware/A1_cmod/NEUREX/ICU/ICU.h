@@ -7,16 +7,22 @@
 #include <ac_std_float.h>
 
 /*
- * Input: Read one memreq
- * Output: output 8 cycles for each Vidx 
+ * Trilinear interpolation of one level: out[f] = sum_c w[c] * data[c][f]
+ * Input: the 8 corner features of F channels (FeatureTable) and the 8 corner weights (IGU), one of each per level
+ * Output: the F-channel interpolated feature
+ * II 1 pipeline, 4 stages: products, then the 8 -> 4 -> 2 -> 1 adder tree, one level per stage register.
+ * data_in and w_in are held in input registers until both arrived, a blocked data_out stalls the pipeline.
  */
+template <int F = ICU_FEATURES>
 class ICU : public match::Module {
     SC_HAS_PROCESS(ICU);
 public:
 
-    Connections::In<ICU_In_Type> data_in;
-    Connections::In<ICU_In_Type> w_in;
-    Connections::Out<ICU_Out_Type> data_out;
+    static const int STAGES = 4;
+
+    Connections::In<ICU_Feat_Type<F> > data_in;
+    Connections::In<IGU_Weight> w_in;
+    Connections::Out<ICU_Out_Vec<F> > data_out;
 
     ICU(sc_module_name name) : match::Module(name),
                               data_in("data_in"),
@@ -27,41 +33,61 @@ public:
         async_reset_signal_is(rst, false);
     }
 
+    // Statistics
+    unsigned long interpolations;
+
     void start() {
         data_in.Reset();
         w_in.Reset();
         data_out.Reset();
+        interpolations = 0;
         wait();
 
+        ICU_Feat_Type<F> data_reg;
+        IGU_Weight w_reg;
+        bool data_held = false, w_held = false;
+
+        // Stage registers, valid bits v1..v3
+        ICU_Out_Type prod[8][F], sum4[4][F], sum2[2][F];
+        bool v1 = false, v2 = false, v3 = false;
+
         #pragma hls_pipeline_init_interval 1
         while (1) {
             wait();
 
-            ICU_In_Type w_tmp;
-            ICU_In_Type data_tmp;
-            if (data_in.PopNB(data_tmp)) {
-                w_in.PopNB(w_tmp);
-                ICU_Out_Type tmp[8];
-                #pragma hls_unroll
-                for (int i = 0; i < 8; i++) {
-                    tmp[i] = w_tmp.x[i] * data_tmp.x[i];
-                }
-                ICU_Out_Type out = ICU_Out_Type(0);
-                wait();
-                ICU_Out_Type tmp2[4];
-                #pragma hls_unroll
-                for (int i = 0; i < 4; i++) {
-                    tmp2[i] = tmp[i] + tmp[i+4];
-                }
-                wait();
-                ICU_Out_Type tmp3[2];
-                #pragma hls_unroll
-                for (int i = 0; i < 2; i++) {
-                    tmp3[i] = tmp2[i] + tmp2[i+2];
+            // Stages advance last to first, each reads the register of the previous cycle
+            if (v3) {
+                ICU_Out_Vec<F> out;
+                #pragma hls_unroll yes
+                for (int f = 0; f < F; f++) out.x[f] = sum2[0][f] + sum2[1][f];
+                NRSIM_PUSH(data_out, out);
+                interpolations++;
+            }
+
+            v3 = v2;
+            #pragma hls_unroll yes
+            for (int i = 0; i < 2; i++) {
+                #pragma hls_unroll yes
+                for (int f = 0; f < F; f++) sum2[i][f] = sum4[i][f] + sum4[i+2][f];
+            }
+
+            v2 = v1;
+            #pragma hls_unroll yes
+            for (int i = 0; i < 4; i++) {
+                #pragma hls_unroll yes
+                for (int f = 0; f < F; f++) sum4[i][f] = prod[i][f] + prod[i+4][f];
+            }
+
+            if (!data_held) data_held = NRSIM_POPNB(data_in, data_reg);
+            if (!w_held) w_held = NRSIM_POPNB(w_in, w_reg);
+            v1 = data_held && w_held;
+            if (v1) {
+                #pragma hls_unroll yes
+                for (int c = 0; c < 8; c++) {
+                    #pragma hls_unroll yes
+                    for (int f = 0; f < F; f++) prod[c][f] = w_reg.x[c] * data_reg.x[c*F + f];
                 }
-                wait();
-                ICU_Out_Type result = tmp3[0] + tmp3[1];
-                data_out.Push(result);
+                data_held = w_held = false;
             }
         }
     }
@@ -1,5 +1,6 @@
 #define NVHLS_VERIFY_BLOCKS (ICU)
 #include "ICU.h"
+#include "../../common/include/nrsim_stimulus.h"
 #include <nvhls_verify.h>
 #include "nvhls_connections.h"
 #include "ac_sysc_trace.h"
@@ -7,26 +8,82 @@
 #include <systemc.h>
 #include <nvhls_module.h>
 #include <mc_connections.h>
-
-
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+ * Usage: sim_ICU [interpolations, default 256]
+ *        sim_ICU stim <capture.nrst> [interpolations, default all]
+ * ICU<2>, ICU<4> and ICU<8> on the same random weights (normalized like trilinear weights) and features, pushed
+ * back to back; outputs are checked against a float reference of the same adder tree, cycles per interpolation
+ * from the first to the last output are reported per channel count.
+ * stim feeds the icu_weights / icu_features tensors of an instrumented run (common/include/nrsim_stimulus.h)
+ * to the ICU<F> with the captured channel count only.
+ */
+
+static int icu_running = 0; // Tops still simulating, the last one stops
+
+template <int F>
 class Top : public sc_module {
+    SC_HAS_PROCESS(Top);
 public:
     sc_clock clk;
     sc_signal<bool> rst;
 
-    Connections::Combinational<ICU_In_Type> data_in;
-    Connections::Combinational<ICU_In_Type> w_in;
-    Connections::Combinational<ICU_Out_Type> data_out;
+    Connections::Combinational<ICU_Feat_Type<F> > data_in;
+    Connections::Combinational<IGU_Weight> w_in;
+    Connections::Combinational<ICU_Out_Vec<F> > data_out;
 
-    NVHLS_DESIGN(ICU) dut;
+    ICU<F> dut;
 
-    SC_CTOR(Top) : clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
+    int n;
+    std::vector<float> w;     // [n][8]
+    std::vector<float> data;  // [n][8][F]
+    int errors;
+    sc_time first, last;
+
+    Top(sc_module_name name, int n) : sc_module(name),
+                   clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
                    rst("rst"),
                    data_in("data_in"),
                    w_in("w_in"),
                    data_out("data_out"),
-                   dut("dut") {
+                   dut("dut"),
+                   n(n),
+                   errors(0) {
+        std::mt19937 gen(1);
+        std::uniform_real_distribution<float> u(0.0f, 1.0f);
+        std::uniform_real_distribution<float> feat(-1.0f, 1.0f);
+        w.resize(n * 8);
+        data.resize(n * 8 * F);
+        for (int s = 0; s < n; s++) {
+            float sum = 0;
+            for (int c = 0; c < 8; c++) sum += (w[s*8 + c] = u(gen));
+            for (int c = 0; c < 8; c++) w[s*8 + c] /= sum;
+        }
+        for (auto &d : data) d = feat(gen);
+        Init();
+    }
 
+    // Captured corner weights [n][8] and features [n][8][F]
+    Top(sc_module_name name, const std::vector<float> &w, const std::vector<float> &data) : sc_module(name),
+                   clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
+                   rst("rst"),
+                   data_in("data_in"),
+                   w_in("w_in"),
+                   data_out("data_out"),
+                   dut("dut"),
+                   n(w.size() / 8),
+                   w(w),
+                   data(data),
+                   errors(0) {
+        Init();
+    }
+
+    void Init() {
         sc_object_tracer<sc_clock> trace_clk(clk);
 
         dut.clk(clk);
@@ -34,6 +91,7 @@ public:
         dut.data_in(data_in);
         dut.w_in(w_in);
         dut.data_out(data_out);
+        icu_running++;
 
         SC_THREAD(reset);
         sensitive << clk.posedge_event();
@@ -58,40 +116,97 @@ public:
         w_in.ResetWrite();
         wait(10);
 
-        // Random inputs
-        for (int i = 0; i < 4; i++) {
-            wait();
-            ICU_In_Type data_in_tmp;
-            ICU_In_Type w_in_tmp;
-            for (int j = 0; j < 8; j++) {
-                data_in_tmp.x[j] = ICU_In_Elem(j + 8*i);
-                w_in_tmp.x[j] = ICU_In_Elem(10*(j + 8*i));
+        for (int s = 0; s < n; s++) {
+            ICU_Feat_Type<F> data_in_tmp;
+            IGU_Weight w_in_tmp;
+            for (int c = 0; c < 8; c++) {
+                w_in_tmp.x[c] = ICU_In_Elem(w[s*8 + c]);
+                for (int f = 0; f < F; f++) data_in_tmp.x[c*F + f] = ICU_In_Elem(data[(s*8 + c)*F + f]);
             }
             data_in.Push(data_in_tmp);
             w_in.Push(w_in_tmp);
         }
     }
 
+    // Same operation order as ICU::start
+    float Reference(int s, int f) const {
+        float prod[8];
+        for (int c = 0; c < 8; c++) prod[c] = w[s*8 + c] * data[(s*8 + c)*F + f];
+        float sum4[4], sum2[2];
+        for (int i = 0; i < 4; i++) sum4[i] = prod[i] + prod[i+4];
+        for (int i = 0; i < 2; i++) sum2[i] = sum4[i] + sum4[i+2];
+        return sum2[0] + sum2[1];
+    }
+
     void collect() {
         data_out.ResetRead();
-        while (1) {
-            wait(); // 1 cc
+        wait(10);
 
-            for (int i = 0; i < 4; i++) {
-                ICU_Out_Type data;
-                data = data_out.Pop();
-                cout << "Output " << data << ", " << sc_time_stamp() << endl;
+        for (int s = 0; s < n; s++) {
+            ICU_Out_Vec<F> out = data_out.Pop();
+            if (s == 0) first = sc_time_stamp();
+            bool ok = true;
+            for (int f = 0; f < F; f++) ok &= std::fabs(out.x[f].to_float() - Reference(s, f)) < 1e-6f;
+            if (!ok && errors++ < 5) {
+                cout << "✗ (MISMATCH) " << name() << " interpolation " << s << ": " << out.x[0]
+                     << " (ref " << Reference(s, 0) << ")" << endl;
             }
-
-            sc_stop();
         }
+        last = sc_time_stamp();
+
+        if (--icu_running == 0) sc_stop();
+    }
+
+    bool Report() const {
+        double cycles = (last - first) / sc_time(1, SC_NS) + 1;
+        cout << ((errors == 0) ? "✓ " : "✗ (MISMATCH) ") << F << " channels: " << n << " interpolations in "
+             << cycles << " cycles, " << cycles / n << " cycles/interpolation, " << errors << " mismatches" << endl;
+        return errors == 0;
     }
 };
 
 int sc_main(int argc, char *argv[]) {
-    Top tb("tb");
+    if (argc > 2 && std::string(argv[1]) == "stim") {
+        nrsim::StimulusReader stim;
+        if (!stim.Open(argv[2])) return 1;
+        const nrsim::NRStimRecord *feat = stim.Find("icu_features");
+        int F = (feat != NULL && feat->ndim == 3) ? int(feat->dims[2]) : 0;
+        size_t max_n = (argc > 3) ? atoi(argv[3]) : 0;
+        std::vector<float> w, data;
+        size_t n = stim.Gather("icu_weights", 8, w, max_n);
+        if (n == 0 || stim.Gather("icu_features", 8 * F, data, n) != n) {
+            cout << "Stimulus " << argv[2] << ": no matching icu_weights [n, 8] / icu_features [n, 8, F]" << endl;
+            return 1;
+        }
+        cout << "Stimulus " << argv[2] << ": " << n << " interpolations, " << F << " channels" << endl;
+
+        std::unique_ptr<Top<2> > f2;  // only the ICU<F> of the captured channel count runs
+        std::unique_ptr<Top<4> > f4;
+        std::unique_ptr<Top<8> > f8;
+        if (F == 2) f2.reset(new Top<2>("f2", w, data));
+        else if (F == 4) f4.reset(new Top<4>("f4", w, data));
+        else if (F == 8) f8.reset(new Top<8>("f8", w, data));
+        else {
+            cout << "No ICU<" << F << "> instance (2, 4 or 8 channels)" << endl;
+            return 1;
+        }
+        sc_start();
+
+        bool pass = f2 ? f2->Report() : (f4 ? f4->Report() : f8->Report());
+        cout << (pass ? "PASSED" : "FAILED") << endl;
+        return 0;
+    }
+
+    int n = (argc > 1) ? atoi(argv[1]) : 256;
+
+    Top<2> f2("f2", n);
+    Top<4> f4("f4", n);
+    Top<8> f8("f8", n);
     sc_start();
+
+    bool pass = f2.Report();
+    pass &= f4.Report();
+    pass &= f8.Report();
+    cout << (pass ? "PASSED" : "FAILED") << endl;
     return 0;
 }
-
-//#include <>
@@ -7,23 +7,31 @@
 #include <ac_std_float.h>
 #include <ac_math/ac_abs.h>
 
-// position scaling, hash index computation, and interpolation weight computation.
+/*
+ * Multi-resolution hash encoding: position scaling, hash index computation, and interpolation weight computation
+ * Input: the per-level resolution table (level_res, at configuration time), positions in [0, 1)
+ * Output: per level the 8 corner entries of its hash table (tagged with the level) and the trilinear weights,
+ *         LANES levels per cycle, lane l carries levels l, l+LANES, ... of every position
+ * Hash : (xv · 1) ⊕ (yv · PRIME1) ⊕ (zv · PRIME2) mod 2^TABLE_BITS
+ * IGU_CORNER_REUSE: the cell of the previous sample is kept per level, a level in the same cell again is
+ *         sent with reuse set and without its hashes (the weights are always computed)
+ */
+template <int LEVELS = IGU_LEVELS, int LANES = IGU_LANES, int TABLE_BITS = IGU_TABLE_BITS,
+          unsigned PRIME1 = IGU_P1, unsigned PRIME2 = IGU_P2>
 class IGU : public match::Module {
     SC_HAS_PROCESS(IGU);
 public:
 
-    Connections::In<IGU_Grid_Res> sugbrid_res;
+    static const int GROUPS = (LEVELS + LANES - 1) / LANES;  // cycles per position
+
+    Connections::In<IGU_Level_Res> level_res;
     Connections::In<IGU_In_Type> pos;
-    Connections::Out<IGU_Grid_Res> grid_id;
-    Connections::Out<Hashed_addr> hashed_addr;
-    Connections::Out<IGU_Weight> weight;
+    Connections::Out<Hashed_addr> hashed_addr[LANES];
+    Connections::Out<IGU_Weight> weight[LANES];
 
     IGU(sc_module_name name) : match::Module(name),
-                               sugbrid_res("sugbrid_res"),
-                               pos("pos"),
-                               grid_id("grid_id"),
-                               hashed_addr("hashed_addr"),
-                               weight("weight") {
+                               level_res("level_res"),
+                               pos("pos") {
         SC_THREAD(start);
         sensitive << clk.pos();
         async_reset_signal_is(rst, false);
@@ -38,78 +46,101 @@ public:
                                  {1,1,0},
                                  {1,1,1}};
 
+    IGU_Grid_Res res_table[LEVELS];
+    int last_cell[LEVELS][3];   // pos_lower_int of the previous sample per level
+    bool cell_valid[LEVELS];
+
+    // Statistics
+    unsigned long reused_levels;  // Hashed_addr sent with reuse (8 hashes and table reads saved each)
+
     void start() {
-        sugbrid_res.Reset();
+        level_res.Reset();
         pos.Reset();
-        grid_id.Reset();
-        hashed_addr.Reset();
-        weight.Reset();
+        #pragma hls_unroll yes
+        for (int l = 0; l < LANES; l++) {
+            hashed_addr[l].Reset();
+            weight[l].Reset();
+        }
+        #pragma hls_unroll yes
+        for (int l = 0; l < LEVELS; l++) {
+            res_table[l] = 1;
+            cell_valid[l] = false;
+        }
+        reused_levels = 0;
         wait();
 
-        Hashed_addr ret_addr;
-        IGU_Weight w_addr;
+        IGU_In_Type pos_reg;
+        int group = 0;
 
         #pragma hls_pipeline_init_interval 1
         while (1) {
             wait();
 
-            IGU_In_Type pos_tmp;
-            IGU_Grid_Res sugbrid_res_tmp;
-            sugbrid_res.PopNB(sugbrid_res_tmp); // get resolution
-
-            IGU_In_Elem_Type pos_after_mul[3];
-            IGU_In_Elem_Type pos_lower_int[3];
-            IGU_In_Elem_Type pos_fraction[3];
-
-            int to_hash[8][3];
-            if (pos.PopNB(pos_tmp)) {
-                #pragma hls_unroll
-                for (int i = 0; i < 3; i++) {
-                     pos_after_mul[i] = pos_tmp.x[i] * IGU_In_Elem_Type(sugbrid_res_tmp);
-                     pos_lower_int[i] = pos_after_mul[i];
-                     pos_fraction[i] = pos_after_mul[i] - pos_lower_int[i];
-                }
-                // Get Grid ID
-                IGU_In_Elem_Type mul_tmp = pos_lower_int[0] + (pos_lower_int[1] * IGU_In_Elem_Type(sugbrid_res_tmp)) + (pos_lower_int[2] * IGU_In_Elem_Type(sugbrid_res_tmp+sugbrid_res_tmp));
-                IGU_Grid_Res tmp = IGU_Grid_Res(mul_tmp.to_int()); 
-
-                // Get pos
-                #pragma hls_unroll
-                for (int idx = 0; idx < 8; idx ++) {
-                    #pragma hls_unroll
-                    for (int i = 0; i < 3; i++) {
-                        to_hash[idx][i] = pos_lower_int[i].to_int() + to_add[idx][i];
-                    }
-                }
+            IGU_Level_Res cfg;
+            if (NRSIM_POPNB(level_res, cfg)) {
+                res_table[cfg.level.to_int()] = cfg.res;
+                cell_valid[cfg.level.to_int()] = false;
+            }
 
-                // Start hashing
-                #pragma hls_unroll
-                for (int i = 0; i < 8; i++) {
-                    ret_addr.x[i] = (to_hash[i][0] ^ (to_hash[i][1] * P1) ^ (to_hash[i][2] * P2)) & (IGU_Grid_Res((1<<19) - 1)); 
-                }
-                 
-
-                // Generate Weight
-                #pragma hls_unroll
-                for (int i = 0; i < 8; i++) {
-                    IGU_In_Elem_Type abs_val0 = pos_fraction[0]-IGU_In_Elem_Type(1); 
-                    IGU_In_Elem_Type abs_val1 = pos_fraction[1]-IGU_In_Elem_Type(1);
-                    IGU_In_Elem_Type abs_val2 = pos_fraction[2]-IGU_In_Elem_Type(1);
-                    if (abs_val0 < IGU_In_Elem_Type(0)) abs_val0 = -abs_val0;
-                    if (abs_val1 < IGU_In_Elem_Type(0)) abs_val1 = -abs_val1;
-                    if (abs_val2 < IGU_In_Elem_Type(0)) abs_val2 = -abs_val2;
-                    w_addr.x[i] = (IGU_In_Elem_Type(1) - abs_val0) * 
-                                  (IGU_In_Elem_Type(1) - abs_val1) * 
-                                  (IGU_In_Elem_Type(1) - abs_val2);
+            if (group == 0 && !NRSIM_POPNB(pos, pos_reg)) continue;
+
+            #pragma hls_unroll yes
+            for (int l = 0; l < LANES; l++) {
+                int level = group * LANES + l;
+                if (level < LEVELS) {
+                    Hashed_addr ret_addr;
+                    IGU_Weight w_addr;
+                    Encode(pos_reg, level, ret_addr, w_addr);
+                    NRSIM_PUSH(hashed_addr[l], ret_addr);
+                    NRSIM_PUSH(weight[l], w_addr);
                 }
-
-                hashed_addr.Push(ret_addr);
-                weight.Push(w_addr);
             }
+            group = (group == GROUPS - 1) ? 0 : group + 1;
         }
     }
 
-    // Hash : (xv · 1) ⊕ (yv · P1) ⊕ (zv · P2) mod T
+    // One level of one position
+    void Encode(const IGU_In_Type &pos_tmp, int level, Hashed_addr &ret_addr, IGU_Weight &w_addr) {
+        IGU_In_Elem_Type res = IGU_In_Elem_Type(res_table[level]);
+        int pos_lower_int[3];
+        IGU_In_Elem_Type pos_fraction[3];
+        #pragma hls_unroll
+        for (int i = 0; i < 3; i++) {
+            IGU_In_Elem_Type pos_after_mul = pos_tmp.x[i] * res;
+            pos_lower_int[i] = pos_after_mul.to_int();
+            pos_fraction[i] = pos_after_mul - IGU_In_Elem_Type(pos_lower_int[i]);
+        }
+
+        bool same = cell_valid[level];
+        #pragma hls_unroll
+        for (int i = 0; i < 3; i++) {
+            same &= (last_cell[level][i] == pos_lower_int[i]);
+            last_cell[level][i] = pos_lower_int[i];
+        }
+        cell_valid[level] = true;
+        ret_addr.reuse = (IGU_CORNER_REUSE != 0) && same;
+        if (ret_addr.reuse) reused_levels++;
+
+        #pragma hls_unroll
+        for (int idx = 0; idx < 8; idx++) {
+            ac_int<32, false> to_hash[3];
+            IGU_In_Elem_Type w = IGU_In_Elem_Type(1);
+            #pragma hls_unroll
+            for (int i = 0; i < 3; i++) {
+                to_hash[i] = pos_lower_int[i] + to_add[idx][i];
+                w = w * (to_add[idx][i] ? pos_fraction[i] : IGU_In_Elem_Type(1) - pos_fraction[i]);
+            }
+            if (ret_addr.reuse) {
+                ret_addr.x[idx] = 0;
+            } else {
+                ac_int<32, false> h = to_hash[0] ^ (to_hash[1] * ac_int<32, false>(PRIME1)) ^
+                                      (to_hash[2] * ac_int<32, false>(PRIME2));
+                ret_addr.x[idx] = h.template slc<TABLE_BITS>(0).to_int();
+            }
+            w_addr.x[idx] = w;
+        }
+        ret_addr.level = level;
+    }
 };
 
 #endif //NEUREX_IGU_H
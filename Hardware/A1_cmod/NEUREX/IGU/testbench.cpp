@@ -1,5 +1,7 @@
 #define NVHLS_VERIFY_BLOCKS (IGU)
 #include "IGU.h"
+#include "../../common/include/nrsim_reference.h"
+#include "../../common/include/nrsim_stimulus.h"
 #include <nvhls_verify.h>
 #include "nvhls_connections.h"
 #include "ac_sysc_trace.h"
@@ -7,37 +9,82 @@
 #include <systemc.h>
 #include <nvhls_module.h>
 #include <mc_connections.h>
-
-
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+/*
+ * Usage: sim_IGU [samples, default 64]
+ *        sim_IGU stim <capture.nrst> [samples, default all]
+ * IGU_LEVELS levels with Instant-NGP resolutions (16 to 512 geometric), the same random positions on
+ * IGU<> and on 1 / IGU_LEVELS lane instances; addresses and weights are checked against a float reference,
+ * cycles per sample from the first to the last output are reported per lane count.
+ * IGU_CORNER_REUSE: a reused level has to be in the cell of the previous sample (same reference corners).
+ * stim takes the positions from the igu_positions tensor of an instrumented run (common/include/nrsim_stimulus.h)
+ * instead, clamped to the [0, 0.999] the random ones are drawn from.
+ */
+
+static int igu_running = 0; // Tops still simulating, the last one stops
+
+template <typename DUT, int LANES>
 class Top : public sc_module {
+    SC_HAS_PROCESS(Top);
 public:
+    static const int LEVELS = IGU_LEVELS;
+
     sc_clock clk;
     sc_signal<bool> rst;
 
-    Connections::Combinational<IGU_Grid_Res> sugbrid_res;
+    Connections::Combinational<IGU_Level_Res> level_res;
     Connections::Combinational<IGU_In_Type> pos;
-    Connections::Combinational<IGU_Grid_Res> grid_id;
-    Connections::Combinational<Hashed_addr> hashed_addr;
-    Connections::Combinational<IGU_Weight> weight;
-
-    NVHLS_DESIGN(IGU) dut;
-
-    SC_CTOR(Top) : clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
+    Connections::Combinational<Hashed_addr> hashed_addr[LANES];
+    Connections::Combinational<IGU_Weight> weight[LANES];
+
+    DUT dut;
+
+    int samples;
+    std::vector<float> positions;  // [sample][3]
+    int res[LEVELS];
+    std::vector<uint32_t> ref_addr[LEVELS];  // [sample][8] per level, float reference of IGU::Encode
+    std::vector<float> ref_w[LEVELS];
+    int errors;
+    int reused;  // levels sent with reuse
+    sc_time first, last;
+
+    Top(sc_module_name name, const std::vector<float> &positions) : sc_module(name),
+                   clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
                    rst("rst"),
-                   sugbrid_res("sugbrid_res"),
+                   level_res("level_res"),
                    pos("pos"),
-                   grid_id("grid_id"),
-                   hashed_addr("hashed_addr"),
-                   dut("dut") {
+                   dut("dut"),
+                   samples(positions.size() / 3),
+                   positions(positions),
+                   errors(0),
+                   reused(0) {
 
         sc_object_tracer<sc_clock> trace_clk(clk);
 
         dut.clk(clk);
         dut.rst(rst);
-        dut.sugbrid_res(sugbrid_res);
+        dut.level_res(level_res);
         dut.pos(pos);
-        dut.grid_id(grid_id);
-        dut.hashed_addr(hashed_addr);
+        for (int l = 0; l < LANES; l++) {
+            dut.hashed_addr[l](hashed_addr[l]);
+            dut.weight[l](weight[l]);
+        }
+
+        // Instant-NGP: N_l = floor(N_min * b^l), b = exp((ln N_max - ln N_min) / (L - 1))
+        double b = (LEVELS > 1) ? std::exp((std::log(512.0) - std::log(16.0)) / (LEVELS - 1)) : 1.0;
+        for (int l = 0; l < LEVELS; l++) res[l] = int(std::floor(16.0 * std::pow(b, l)));
+
+        for (int l = 0; l < LEVELS; l++) {
+            ref_addr[l].resize(samples * 8);
+            ref_w[l].resize(samples * 8);
+            nrsim::ref::HashGridLevel(samples, positions.data(), float(res[l]), (1u << IGU_TABLE_BITS) - 1,
+                                      ref_addr[l].data(), ref_w[l].data(), IGU_P1, IGU_P2);
+        }
+        igu_running++;
 
         SC_THREAD(reset);
         sensitive << clk.posedge_event();
@@ -58,53 +105,132 @@ public:
     }
 
     void run() {
-        sugbrid_res.ResetWrite();
+        level_res.ResetWrite();
         pos.ResetWrite();
         wait(10);
 
-        // Random inputs
-        for (int i = 0; i < 10; i++) {
-            wait();
-            IGU_Grid_Res res = IGU_Grid_Res(4);
+        // Configuration: the resolution table
+        for (int l = 0; l < LEVELS; l++) {
+            IGU_Level_Res cfg;
+            cfg.level = l;
+            cfg.res = res[l];
+            level_res.Push(cfg);
+        }
+        wait(2);
+
+        for (int s = 0; s < samples; s++) {
             IGU_In_Type in;
-            for (int i = 0; i < 3; i++) in.x[i] = IGU_In_Elem_Type(0.1*i+0.2);
+            for (int i = 0; i < 3; i++) in.x[i] = IGU_In_Elem_Type(positions[s*3 + i]);
             pos.Push(in);
-            sugbrid_res.Push(res);
         }
     }
 
+    void Check(int s, int level, const Hashed_addr &a, const IGU_Weight &w) {
+        const uint32_t *ref_a = &ref_addr[level][s*8];
+        const float *ref_wc = &ref_w[level][s*8];
+        float sum = 0;
+        bool ok = (a.level == level);
+        // A reused level (IGU_CORNER_REUSE) has no addresses, the FeatureTable resends those of sample s-1
+        const uint32_t *want = a.reuse ? &ref_addr[level][(s-1)*8] : ref_a;
+        ok &= !a.reuse || (IGU_CORNER_REUSE && s > 0);
+        if (a.reuse) reused++;
+        for (int c = 0; c < 8; c++) {
+            float wc = w.x[c].to_float();
+            ok &= (a.reuse || unsigned(a.x[c]) == ref_a[c]) && (want[c] == ref_a[c]) && std::fabs(wc - ref_wc[c]) < 1e-6f;
+            sum += wc;
+        }
+        ok &= std::fabs(sum - 1.0f) < 1e-4f;
+        if (!ok) {
+            if (errors < 5) {
+                cout << "✗ (MISMATCH) " << name() << " sample " << s << " level " << level
+                     << ": addr " << a.x[0] << " (ref " << ref_a[0] << "), weight sum " << sum << endl;
+            }
+            errors++;
+        }
+    }
+
+    // Lane l carries levels l, l+LANES, ... of every sample
     void collect() {
-        grid_id.ResetRead();
-        hashed_addr.ResetRead();
-        weight.ResetRead();
-        while (1) {
-            wait(); // 1 cc
-
-            for (int i = 0; i < 10; i++) {
-                cout << "address Generation Output: @ timestep: " << sc_time_stamp() << endl;
-
-                IGU_Grid_Res tmp_grid_id;
-                Hashed_addr tmp_hashed_addr;
-                IGU_Weight tmp_weight;
-                tmp_grid_id = grid_id.Pop();
-                tmp_hashed_addr = hashed_addr.Pop();
-                tmp_weight = weight.Pop();
-                cout << "Output " << tmp_grid_id << sc_time_stamp() << endl;
-                for (int i = 0; i < 8; i++) {
-                    cout << "(" << tmp_hashed_addr.x[i] << ", " << tmp_weight.x[i] << ") " << endl;
+        for (int l = 0; l < LANES; l++) {
+            hashed_addr[l].ResetRead();
+            weight[l].ResetRead();
+        }
+        wait(10);
+
+        int sample[LANES], level[LANES];
+        bool held[LANES];
+        Hashed_addr addr[LANES];
+        for (int l = 0; l < LANES; l++) {
+            sample[l] = 0;
+            level[l] = l;
+            held[l] = false;
+        }
+
+        int remaining = samples * LEVELS;
+        while (remaining > 0) {
+            wait();
+            for (int l = 0; l < LANES; l++) {
+                if (!held[l]) held[l] = hashed_addr[l].PopNB(addr[l]);
+                IGU_Weight w;
+                if (held[l] && weight[l].PopNB(w)) {
+                    if (remaining == samples * LEVELS) first = sc_time_stamp();
+                    Check(sample[l], level[l], addr[l], w);
+                    held[l] = false;
+                    remaining--;
+                    level[l] += LANES;
+                    if (level[l] >= LEVELS) {
+                        level[l] = l;
+                        sample[l]++;
+                    }
                 }
-                cout << endl;
             }
-
-            sc_stop();
         }
+        last = sc_time_stamp();
+
+        if (--igu_running == 0) sc_stop();
+    }
+
+    bool Report() const {
+        double cycles = (last - first) / sc_time(1, SC_NS) + 1;
+        cout << ((errors == 0) ? "✓ " : "✗ (MISMATCH) ") << LANES << " lanes: " << samples << " samples x "
+             << LEVELS << " levels in " << cycles << " cycles, " << cycles / samples << " cycles/sample, "
+             << errors << " mismatches";
+        if (IGU_CORNER_REUSE) cout << ", " << reused << " levels reused (" << dut.reused_levels << " counted by the IGU)";
+        cout << endl;
+        return errors == 0;
     }
 };
 
 int sc_main(int argc, char *argv[]) {
-    Top tb("tb");
+    std::vector<float> positions;  // [sample][3]
+    if (argc > 2 && std::string(argv[1]) == "stim") {
+        nrsim::StimulusReader stim;
+        size_t max_samples = (argc > 3) ? atoi(argv[3]) : 0;
+        if (!stim.Open(argv[2]) || stim.Gather("igu_positions", 3, positions, max_samples) == 0) return 1;
+        int clamped = 0;
+        for (auto &p : positions) {
+            float c = (p < 0.0f) ? 0.0f : ((p > 0.999f) ? 0.999f : p);
+            clamped += (c != p);
+            p = c;
+        }
+        cout << "Stimulus " << argv[2] << ": " << positions.size() / 3 << " samples, " << clamped
+             << " coordinates clamped" << endl;
+    } else {
+        int samples = (argc > 1) ? atoi(argv[1]) : 64;
+        std::mt19937 gen(1);
+        std::uniform_real_distribution<float> u(0.0f, 0.999f);
+        positions.resize(samples * 3);
+        for (auto &p : positions) p = u(gen);
+    }
+
+    Top<IGU<>, IGU_LANES> lanes("lanes", positions);
+    Top<IGU<IGU_LEVELS, 1>, 1> single("single", positions);
+    Top<IGU<IGU_LEVELS, IGU_LEVELS>, IGU_LEVELS> full("full", positions);
     sc_start();
+
+    bool pass = single.Report();
+    pass &= lanes.Report();
+    pass &= full.Report();
+    cout << (pass ? "PASSED" : "FAILED") << endl;
     return 0;
 }
-
-//#include <>
@@ -0,0 +1,231 @@
+#ifndef NEUREX_H
+#define NEUREX_H
+
+#include "NEUREXPackDef.h"
+#include <nvhls_connections.h>
+#include <vector>
+
+#include "../IGU/IGU.h"
+#include "../FeatureTable/FeatureTable.h"
+#include "../ICU/ICU.h"
+#include "../GEMM/GEMM.h"
+
+/*
+ * Input: the per-level resolution table (level_res, at configuration time), sample positions in [0, 1)
+ * Output: the NEUREX_OUT MLP outputs of every sample, in order
+ * IGU -> LANES x (FeatureTable -> ICU) -> Concat -> MLP on the GEMM controller (ENGINE array)
+ *     - IGU lane l encodes levels l, l+LANES, ... and looks them up in its own FeatureTable (WriteFeature fills the
+ *       lane of the level), its weights wait in w_fifo for the features, the ICU interpolates the F channels
+ *       of one level per cycle
+ *     - Concat collects the LEVELS x F features of a sample into the encoding buffer (NEUREX_FEAT_FRAC fraction
+ *       bits), a full batch of NEUREX_BATCH samples goes to MLP
+ *     - MLP copies the batch (Concat fills the other bank of the encoding buffer meanwhile) and runs NEUREX_LAYERS GEMMs,
+ *       ReLU and >> NEUREX_ACT_SHIFT between layers, weights from the backing store W (SetLayer)
+ * Only whole batches are processed. A stalled MLP backs up into Concat, the ICUs and the IGU.
+ * Simulation model (std::vector hash tables, encodings and weights), the blocks stay the HLS targets.
+ */
+template <int LANES = IGU_LANES, int TABLE_BITS = IGU_TABLE_BITS, int F = ICU_FEATURES,
+          typename ENGINE = NEUREX_NPU<NPU_WS, true> >
+class NEUREX : public match::Module {
+    SC_HAS_PROCESS(NEUREX);
+public:
+
+    static const int LEVELS = IGU_LEVELS;
+    static const int ENC = LEVELS * F;  // encoding width, MLP input
+
+    typedef FeatureTable<FT_BANKS, FT_MAPPING, LEVELS, TABLE_BITS, F, LANES> FT_Type;
+
+    Connections::In<IGU_Level_Res> level_res;
+    Connections::In<IGU_In_Type> pos;
+    Connections::Out<NEUREX_Out_Type> mlp_out;
+
+    IGU<LEVELS, LANES, TABLE_BITS> igu;
+    Connections::Combinational<Hashed_addr> addr[LANES];
+    Connections::Combinational<IGU_Weight> weight[LANES];
+
+    FT_Type *ft[LANES];
+    Connections::Combinational<ICU_Feat_Type<F> > feat[LANES];
+
+    Connections::Buffer<IGU_Weight, NEUREX_W_DEPTH> w_fifo[LANES];
+    Connections::Combinational<IGU_Weight> icu_w[LANES];
+
+    ICU<F> *icu[LANES];
+    Connections::Combinational<ICU_Out_Vec<F> > enc[LANES];
+
+    Connections::Combinational<int> batch_ready;  // Concat -> MLP, encoding buffer bank filled
+
+    GEMM<ENGINE> gemm;
+    Connections::Combinational<GEMM_Req_Type> gemm_req;
+    Connections::Combinational<bool> gemm_done;
+
+    NEUREX(sc_module_name name) : match::Module(name),
+                                  level_res("level_res"),
+                                  pos("pos"),
+                                  mlp_out("mlp_out"),
+                                  igu("igu"),
+                                  batch_ready("batch_ready"),
+                                  gemm("gemm"),
+                                  gemm_req("gemm_req"),
+                                  gemm_done("gemm_done"),
+                                  enc_buf(2 * NEUREX_BATCH * ENC, 0) {
+        igu.clk(clk);
+        igu.rst(rst);
+        igu.level_res(level_res);
+        igu.pos(pos);
+
+        for (int l = 0; l < LANES; l++) {
+            igu.hashed_addr[l](addr[l]);
+            igu.weight[l](weight[l]);
+
+            ft[l] = new FT_Type(sc_gen_unique_name("FeatureTable"));
+            ft[l]->clk(clk);
+            ft[l]->rst(rst);
+            ft[l]->addr_in(addr[l]);
+            ft[l]->feat_out(feat[l]);
+
+            w_fifo[l].clk(clk);
+            w_fifo[l].rst(rst);
+            w_fifo[l].enq(weight[l]);
+            w_fifo[l].deq(icu_w[l]);
+
+            icu[l] = new ICU<F>(sc_gen_unique_name("ICU"));
+            icu[l]->clk(clk);
+            icu[l]->rst(rst);
+            icu[l]->data_in(feat[l]);
+            icu[l]->w_in(icu_w[l]);
+            icu[l]->data_out(enc[l]);
+        }
+
+        gemm.clk(clk);
+        gemm.rst(rst);
+        gemm.req(gemm_req);
+        gemm.done(gemm_done);
+
+        for (int i = 0; i < NEUREX_LAYERS; i++) W[i].assign(LayerIn(i) * LayerOut(i), 0);
+
+        SC_THREAD(Concat);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+
+        SC_THREAD(MLP);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+    }
+
+    // Backing store
+    std::vector<int> enc_buf;             // [2][NEUREX_BATCH][ENC], Concat fills one bank while MLP copies the other
+    std::vector<int> W[NEUREX_LAYERS];    // [LayerIn][LayerOut], row major
+    std::vector<int> encoded;             // every encoding handed to the MLP, [sample][ENC] (for the testbench)
+
+    static int LayerIn(int i) { return i ? NEUREX_HIDDEN : ENC; }
+    static int LayerOut(int i) { return (i == NEUREX_LAYERS - 1) ? NEUREX_OUT : NEUREX_HIDDEN; }
+
+    // Backdoor access for the testbench
+    void WriteFeature(int level, int entry, int ch, const ICU_In_Elem &f) { ft[level % LANES]->Write(level, entry, ch, f); }
+    void SetLayer(int i, const std::vector<int> &w) { W[i] = w; }
+
+    // Statistics
+    unsigned long samples;      // samples encoded
+    unsigned long batches;      // batches through the MLP
+    unsigned long mlp_cycles;   // cycles MLP was busy with a batch
+
+    void Concat() {
+        #pragma hls_unroll yes
+        for (int l = 0; l < LANES; l++) enc[l].ResetRead();
+        batch_ready.ResetWrite();
+        samples = 0;
+        encoded.clear();
+        wait();
+
+        int got[LANES];  // levels of the current sample received per lane
+        #pragma hls_unroll yes
+        for (int l = 0; l < LANES; l++) got[l] = 0;
+        int n = 0, bank = 0;
+
+        #pragma hls_pipeline_init_interval 1
+        while (1) {
+            wait();
+
+            int base = (bank * NEUREX_BATCH + n) * ENC;
+            bool complete = true;
+            #pragma hls_unroll yes
+            for (int l = 0; l < LANES; l++) {
+                int level = got[l] * LANES + l;
+                ICU_Out_Vec<F> v;
+                if (level < LEVELS && NRSIM_POPNB(enc[l], v)) {
+                    #pragma hls_unroll yes
+                    for (int f = 0; f < F; f++) enc_buf[base + level * F + f] = Quantize(v.x[f]);
+                    got[l]++;
+                    level += LANES;
+                }
+                complete &= (level >= LEVELS);
+            }
+            if (!complete) continue;
+
+            encoded.insert(encoded.end(), enc_buf.begin() + base, enc_buf.begin() + base + ENC);
+            #pragma hls_unroll yes
+            for (int l = 0; l < LANES; l++) got[l] = 0;
+            samples++;
+            if (++n == NEUREX_BATCH) {
+                NRSIM_PUSH(batch_ready, bank);
+                n = 0;
+                bank = 1 - bank;
+            }
+        }
+    }
+
+    static int Quantize(const ICU_Out_Type &x) {
+        return (x * ICU_Out_Type(float(1 << NEUREX_FEAT_FRAC))).to_int();
+    }
+
+    void MLP() {
+        batch_ready.ResetRead();
+        gemm_req.ResetWrite();
+        gemm_done.ResetRead();
+        mlp_out.Reset();
+        batches = mlp_cycles = 0;
+        wait();
+
+        while (1) {
+            wait();
+
+            int bank, n = NEUREX_BATCH;
+            if (!NRSIM_POPNB(batch_ready, bank)) continue;
+            gemm.A.assign(enc_buf.begin() + bank * n * ENC, enc_buf.begin() + (bank + 1) * n * ENC);
+
+            for (int i = 0; i < NEUREX_LAYERS; i++) {
+                gemm.B = W[i];
+                GEMM_Req_Type r;
+                r.M = n;
+                r.K = LayerIn(i);
+                r.N = LayerOut(i);
+                r.overlap = true;
+                NRSIM_PUSH(gemm_req, r);
+                bool finished;
+                while (!NRSIM_POPNB(gemm_done, finished)) {
+                    wait();
+                    mlp_cycles++;
+                }
+                if (i == NEUREX_LAYERS - 1) break;
+
+                gemm.A.resize(gemm.C.size());
+                for (size_t k = 0; k < gemm.C.size(); k++) {
+                    int a = gemm.C[k].to_int() >> NEUREX_ACT_SHIFT;
+                    gemm.A[k] = (a > 0) ? a : 0;
+                }
+            }
+
+            for (int s = 0; s < n; s++) {
+                NEUREX_Out_Type o;
+                #pragma hls_unroll yes
+                for (int j = 0; j < NEUREX_OUT; j++) o.x[j] = gemm.C[s * NEUREX_OUT + j];
+                NRSIM_PUSH(mlp_out, o);
+                wait();
+                mlp_cycles++;
+            }
+            batches++;
+        }
+    }
+};
+
+#endif // NEUREX_H
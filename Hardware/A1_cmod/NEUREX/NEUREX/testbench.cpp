@@ -0,0 +1,257 @@
+#include "NEUREX.h"
+#include <nvhls_verify.h>
+#include "nvhls_connections.h"
+#include "ac_sysc_trace.h"
+#include <random>
+#include <systemc.h>
+#include <nvhls_module.h>
+#include <mc_connections.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+/*
+ * Usage: sim_NEUREX [pe | behavioral] [samples, default 512] [clock MHz, default 1000]
+ * Random sample positions (rounded up to whole NEUREX_BATCH batches) through IGU -> FeatureTable -> ICU -> NPU.
+ * The encodings are checked against a float reference of the hash encoding (within 1 LSB of NEUREX_FEAT_FRAC),
+ * the MLP outputs exactly against an integer reference on the encodings the top produced. Reported: per-stage
+ * utilization (IGU lane groups, FeatureTable and ICU cycles per lane, NPU busy share and MAC utilization) and
+ * samples per second at the clock.
+ * behavioral (default) uses NPU_behavioral as the array, pe the NPU_PE array.
+ */
+
+static const int TABLE_BITS = 14;
+
+template <typename ENGINE>
+class Top : public sc_module {
+    SC_HAS_PROCESS(Top);
+public:
+    typedef NEUREX<IGU_LANES, TABLE_BITS, ICU_FEATURES, ENGINE> DUT;
+    static const int LEVELS = IGU_LEVELS;
+    static const int F = ICU_FEATURES;
+    static const int ENC = DUT::ENC;
+
+    sc_clock clk;
+    sc_signal<bool> rst;
+
+    Connections::Combinational<IGU_Level_Res> level_res;
+    Connections::Combinational<IGU_In_Type> pos;
+    Connections::Combinational<NEUREX_Out_Type> mlp_out;
+
+    DUT dut;
+
+    int samples;
+    double mhz;
+    std::vector<float> positions;  // [sample][3]
+    std::vector<NEUREX_Out_Type> outputs;
+    int res[LEVELS];
+    sc_time first, last;
+
+    Top(sc_module_name name, int samples, double mhz) : sc_module(name),
+                   clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
+                   rst("rst"),
+                   level_res("level_res"),
+                   pos("pos"),
+                   mlp_out("mlp_out"),
+                   dut("dut"),
+                   samples(samples),
+                   mhz(mhz) {
+
+        sc_object_tracer<sc_clock> trace_clk(clk);
+
+        dut.clk(clk);
+        dut.rst(rst);
+        dut.level_res(level_res);
+        dut.pos(pos);
+        dut.mlp_out(mlp_out);
+
+        for (int l = 0; l < LEVELS; l++) {
+            for (int e = 0; e < (1 << TABLE_BITS); e++) {
+                for (int f = 0; f < F; f++) dut.WriteFeature(l, e, f, ICU_In_Elem(Feature(l, e, f)));
+            }
+        }
+
+        std::mt19937 gen(1);
+        std::uniform_int_distribution<int> w(-2, 2);
+        for (int i = 0; i < NEUREX_LAYERS; i++) {
+            std::vector<int> layer(DUT::LayerIn(i) * DUT::LayerOut(i));
+            for (auto &x : layer) x = w(gen);
+            dut.SetLayer(i, layer);
+        }
+
+        // Instant-NGP resolutions, 16 to 512 geometric
+        double b = std::exp((std::log(512.0) - std::log(16.0)) / (LEVELS - 1));
+        for (int l = 0; l < LEVELS; l++) res[l] = int(std::floor(16.0 * std::pow(b, l)));
+        std::uniform_real_distribution<float> u(0.0f, 0.999f);
+        positions.resize(samples * 3);
+        for (auto &p : positions) p = u(gen);
+
+        SC_THREAD(reset);
+        sensitive << clk.posedge_event();
+
+        SC_THREAD(run);
+        sensitive << clk.posedge_event();
+        async_reset_signal_is(rst, false);
+
+        SC_THREAD(collect);
+        sensitive << clk.posedge_event();
+        async_reset_signal_is(rst, false);
+    }
+
+    static float Feature(int level, int entry, int ch) {
+        return float((level * 7919 + entry * F + ch) % 1024) / 1024;
+    }
+
+    void reset() {
+        rst.write(false);
+        wait(10);
+        rst.write(true);
+    }
+
+    void run() {
+        level_res.ResetWrite();
+        pos.ResetWrite();
+        wait(10);
+
+        for (int l = 0; l < LEVELS; l++) {
+            IGU_Level_Res cfg;
+            cfg.level = l;
+            cfg.res = res[l];
+            level_res.Push(cfg);
+        }
+        wait(2);
+
+        first = sc_time_stamp();
+        for (int s = 0; s < samples; s++) {
+            IGU_In_Type in;
+            for (int i = 0; i < 3; i++) in.x[i] = IGU_In_Elem_Type(positions[s*3 + i]);
+            pos.Push(in);
+        }
+    }
+
+    void collect() {
+        mlp_out.ResetRead();
+        wait(10);
+
+        for (int s = 0; s < samples; s++) outputs.push_back(mlp_out.Pop());
+        last = sc_time_stamp();
+        sc_stop();
+    }
+
+    // Float reference of one level, same operation order as IGU::Encode and ICU
+    void Encoding(int s, int level, float out[F]) const {
+        int lower[3];
+        float frac[3];
+        for (int i = 0; i < 3; i++) {
+            float scaled = positions[s*3 + i] * float(res[level]);
+            lower[i] = int(scaled);
+            frac[i] = scaled - float(lower[i]);
+        }
+        float prod[8][F];
+        for (int c = 0; c < 8; c++) {
+            unsigned v[3];
+            float w = 1.0f;
+            for (int i = 0; i < 3; i++) {
+                int bit = (c >> (2 - i)) & 1;
+                v[i] = unsigned(lower[i] + bit);
+                w = w * (bit ? frac[i] : 1.0f - frac[i]);
+            }
+            int entry = int((v[0] ^ (v[1] * IGU_P1) ^ (v[2] * IGU_P2)) & ((1u << TABLE_BITS) - 1));
+            for (int f = 0; f < F; f++) prod[c][f] = w * Feature(level, entry, f);
+        }
+        for (int f = 0; f < F; f++) {
+            float sum4[4], sum2[2];
+            for (int i = 0; i < 4; i++) sum4[i] = prod[i][f] + prod[i+4][f];
+            for (int i = 0; i < 2; i++) sum2[i] = sum4[i] + sum4[i+2];
+            out[f] = sum2[0] + sum2[1];
+        }
+    }
+
+    static int Wrap(long v) { return NPU_Out_Elem_Type(v).to_int(); }
+
+    // Integer reference of NEUREX::MLP, psums wrap to NPU_Out_Elem_Type like the array
+    void Mlp(const int *enc, int out[NEUREX_OUT]) const {
+        std::vector<int> act(enc, enc + ENC);
+        for (int i = 0; i < NEUREX_LAYERS; i++) {
+            int K = DUT::LayerIn(i), N = DUT::LayerOut(i);
+            std::vector<int> next(N);
+            for (int n = 0; n < N; n++) {
+                long sum = 0;
+                for (int k = 0; k < K; k++) sum += long(act[k]) * dut.W[i][k * N + n];
+                next[n] = Wrap(sum);
+                if (i < NEUREX_LAYERS - 1) next[n] = std::max(next[n] >> NEUREX_ACT_SHIFT, 0);
+            }
+            act = next;
+        }
+        for (int j = 0; j < NEUREX_OUT; j++) out[j] = act[j];
+    }
+
+    bool Report() const {
+        int enc_errors = 0, mlp_errors = 0;
+        for (int s = 0; s < samples; s++) {
+            const int *e = &dut.encoded[s * ENC];
+            for (int level = 0; level < LEVELS; level++) {
+                float ref[F];
+                Encoding(s, level, ref);
+                for (int f = 0; f < F; f++) {
+                    int q = int(ref[f] * float(1 << NEUREX_FEAT_FRAC));
+                    if (std::abs(e[level * F + f] - q) > 1 && enc_errors++ < 5) {
+                        cout << "✗ (MISMATCH) encoding sample " << s << " level " << level << ": " << e[level * F + f]
+                             << " (ref " << q << ")" << endl;
+                    }
+                }
+            }
+            int ref[NEUREX_OUT];
+            Mlp(e, ref);
+            bool ok = true;
+            for (int j = 0; j < NEUREX_OUT; j++) ok &= (outputs[s].x[j].to_int() == ref[j]);
+            if (!ok && mlp_errors++ < 5) {
+                cout << "✗ (MISMATCH) MLP sample " << s << ": " << outputs[s].x[0] << " (ref " << ref[0] << ")" << endl;
+            }
+        }
+
+        double cycles = (last - first) / sc_time(1, SC_NS) + 1;
+        unsigned long ft_busy = 0, icu_out = 0, reused = 0;
+        for (int l = 0; l < IGU_LANES; l++) {
+            ft_busy += dut.ft[l]->samples + dut.ft[l]->conflict_cycles;
+            icu_out += dut.icu[l]->interpolations;
+            reused += dut.ft[l]->reused;
+        }
+        double igu = double(samples) * DUT::LEVELS / IGU_LANES / cycles;
+        cout << samples << " samples (" << dut.batches << " batches) in " << cycles << " cycles, "
+             << cycles / samples << " cycles/sample, " << samples / cycles * mhz * 1e6 << " samples/s at "
+             << mhz << " MHz" << endl;
+        cout << "  utilization: IGU " << igu << ", FeatureTable " << ft_busy / (IGU_LANES * cycles)
+             << ", ICU " << icu_out / (IGU_LANES * cycles) << ", MLP " << dut.mlp_cycles / cycles
+             << " (NPU MACs " << dut.gemm.Utilization() << ")" << endl;
+        if (IGU_CORNER_REUSE) {
+            cout << "  corner reuse: " << reused << " of " << samples * DUT::LEVELS << " level lookups, "
+                 << 8 * reused << " table lookups avoided" << endl;
+        }
+        cout << ((enc_errors == 0) ? "✓ " : "✗ (MISMATCH) ") << enc_errors << " encoding mismatches" << endl;
+        cout << ((mlp_errors == 0) ? "✓ " : "✗ (MISMATCH) ") << mlp_errors << " MLP mismatches" << endl;
+        return enc_errors == 0 && mlp_errors == 0;
+    }
+};
+
+int sc_main(int argc, char *argv[]) {
+    std::string mode = (argc > 1) ? argv[1] : "behavioral";
+    int samples = (argc > 2) ? atoi(argv[2]) : 512;
+    double mhz = (argc > 3) ? atof(argv[3]) : 1000.0;
+    samples = (samples + NEUREX_BATCH - 1) / NEUREX_BATCH * NEUREX_BATCH;
+
+    bool pass;
+    if (mode == "pe") {
+        Top<NEUREX_NPU<NPU_WS, true> > tb("tb", samples, mhz);
+        sc_start();
+        pass = tb.Report();
+    } else {
+        Top<NPU_behavioral<NPU_WS, true> > tb("tb", samples, mhz);
+        sc_start();
+        pass = tb.Report();
+    }
+    cout << (pass ? "PASSED" : "FAILED") << endl;
+    return 0;
+}
@@ -0,0 +1,284 @@
+#ifndef NEUREX_NPU_BEHAVIORAL_H
+#define NEUREX_NPU_BEHAVIORAL_H
+
+#include "NEUREXPackDef.h"
+#include <nvhls_int.h>
+#include <nvhls_connections.h>
+#include <ac_std_float.h>
+
+/*
+ * Single-thread C model of the NPU systolic array (same ports and cycle-by-cycle outputs as NEUREX_NPU<DATAFLOW, WBUF>)
+ * The NPU_SIZE x NPU_SIZE NPU_PE threads and their Combinational channels become flat arrays advanced
+ * once per cycle. Each PE-to-PE channel is one register slot: a value pushed in cycle t is popped in t+1,
+ * a push fails (the PE drops the value, as NPU_PE's PushNB) when the slot is still full.
+ * psum_out is blocking as in NPU::CollectPsums (sent when a column holds a psum, valid / last tagged),
+ * here back pressure also stalls the array.
+ * Simulation only, NPU stays the HLS target.
+ */
+template <int DATAFLOW = NPU_DATAFLOW, bool WBUF = false>
+class NPU_behavioral : public match::Module {
+    SC_HAS_PROCESS(NPU_behavioral);
+public:
+
+    const static int N = NPU_SIZE;
+
+    Connections::In<NPU_W_Type>     w_in;
+    Connections::In<NPU_In_Type>    act_in;
+    Connections::Out<NPU_Out_Type>  psum_out;
+
+    NPU_behavioral(sc_module_name name) : match::Module(name),
+                                          w_in("w_in"),
+                                          act_in("act_in"),
+                                          psum_out("psum_out") {
+        SC_THREAD(run);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+    }
+
+    // PE registers
+    NPU_W_Elem_Type w_reg[N][N];
+    NPU_W_Elem_Type w_shadow[N][N];                             // WBUF
+    NPU_Out_Elem_Type acc[N][N], res_reg[N][N], out_reg[N][N];  // NPU_OS
+    bool res_valid[N][N], out_valid[N][N];
+    unsigned k[N][N];
+
+    // Channel slots at the start of the cycle
+    // w[i][j]/p[i][j]: into PE(i,j) from above, row N leaves the array; a[i][j]: into PE(i,j) from the left
+    // a_f: the NPU_Flag_Type riding with a_d
+    bool w_v[N+1][N], a_v[N][N+1], p_v[N+1][N];
+    NPU_Flag_Type a_f[N][N+1];
+    NPU_W_Elem_Type w_d[N+1][N];
+    NPU_In_Elem_Type a_d[N][N+1];
+    NPU_Out_Elem_Type p_d[N+1][N];
+
+    // Slots for the next cycle
+    bool nw_v[N+1][N], na_v[N][N+1], np_v[N+1][N];
+    NPU_Flag_Type na_f[N][N+1];
+    NPU_W_Elem_Type nw_d[N+1][N];
+    NPU_In_Elem_Type na_d[N][N+1];
+    NPU_Out_Elem_Type np_d[N+1][N];
+
+    // Statistics, NPU::Macs / NPU::Skipped
+    unsigned long macs;
+    unsigned long skipped;
+    unsigned long Macs() const { return macs; }
+    unsigned long Skipped() const { return skipped; }
+
+    // NPU::SkewInputs (NPU_OS)
+    bool w_skew_v[N][N], act_skew_v[N][N];
+    NPU_W_Elem_Type w_skew[N][N];
+    NPU_In_Elem_Type act_skew[N][N];
+
+    void run() {
+        w_in.Reset();
+        act_in.Reset();
+        psum_out.Reset();
+        for (int i = 0; i <= N; i++) {
+            for (int j = 0; j <= N; j++) {
+                if (i < N && j < N) {
+                    w_reg[i][j] = NPU_W_Elem_Type(0);
+                    w_shadow[i][j] = NPU_W_Elem_Type(0);
+                    acc[i][j] = NPU_Out_Elem_Type(0);
+                    k[i][j] = 0;
+                    res_valid[i][j] = out_valid[i][j] = false;
+                    w_skew_v[i][j] = act_skew_v[i][j] = false;
+                }
+                if (j < N) w_v[i][j] = p_v[i][j] = false;
+                if (i < N) {
+                    a_v[i][j] = false;
+                    a_f[i][j] = 0;
+                }
+            }
+        }
+        macs = skipped = 0;
+        wait();
+
+        while (1) {
+            wait();
+
+            // NPU::CollectPsums, the bottom row psums of the last cycle
+            NPU_Out_Type out;
+            out.valid = 0;
+            for (int j = 0; j < N; j++) {
+                out.X[j] = p_v[N][j] ? p_d[N][j] : NPU_Out_Elem_Type(0);
+                out.valid[j] = p_v[N][j];
+            }
+            out.last = a_v[N-1][N] && (a_f[N-1][N] & NPU_FLAG_LAST);
+
+            // w and act slots are always popped, NPU::Popout drains row N / column N
+            for (int i = 0; i <= N; i++) {
+                for (int j = 0; j <= N; j++) {
+                    if (j < N) nw_v[i][j] = false;
+                    if (i < N) {
+                        na_v[i][j] = false;
+                        na_f[i][j] = 0;
+                    }
+                }
+            }
+
+            if (DATAFLOW == NPU_OS) {
+                OutputStationary();
+            } else {
+                Stationary();
+            }
+
+            for (int i = 0; i <= N; i++) {
+                for (int j = 0; j <= N; j++) {
+                    if (j < N) {
+                        w_v[i][j] = nw_v[i][j]; w_d[i][j] = nw_d[i][j];
+                        p_v[i][j] = np_v[i][j]; p_d[i][j] = np_d[i][j];
+                    }
+                    if (i < N) {
+                        a_v[i][j] = na_v[i][j]; a_d[i][j] = na_d[i][j]; a_f[i][j] = na_f[i][j];
+                    }
+                }
+            }
+
+            if (out.valid != 0) NRSIM_PUSH(psum_out, out);
+        }
+    }
+
+    // NPU_WS / NPU_IS cycle
+    void Stationary() {
+        // psum slots are kept when their PE got no activation
+        for (int i = 0; i <= N; i++) {
+            for (int j = 0; j < N; j++) {
+                np_v[i][j] = (i < N) && p_v[i][j] && !a_v[i][j];
+                np_d[i][j] = p_d[i][j];
+            }
+        }
+
+        // NPU_PE::run of every PE
+        for (int i = 0; i < N; i++) {
+            for (int j = 0; j < N; j++) {
+                if (w_v[i][j]) {            // shift the old weight down
+                    NPU_W_Elem_Type &w = WBUF ? w_shadow[i][j] : w_reg[i][j];
+                    nw_v[i+1][j] = true;
+                    nw_d[i+1][j] = w;
+                    w = w_d[i][j];
+                }
+                if (a_v[i][j]) {
+                    na_v[i][j+1] = true;
+                    na_d[i][j+1] = a_d[i][j];
+                    na_f[i][j+1] = a_f[i][j];
+                    if (WBUF && (a_f[i][j] & NPU_FLAG_SWAP)) w_reg[i][j] = w_shadow[i][j];
+                    NPU_Out_Elem_Type psum = p_v[i][j] ? p_d[i][j] : NPU_Out_Elem_Type(0);
+                    NPU_Out_Elem_Type new_psum;
+                    if (NPU_ZERO_SKIP && a_d[i][j] == 0) {
+                        new_psum = psum;
+                        skipped++;
+                    } else {
+                        new_psum = NPU_Out_Elem_Type((a_d[i][j] * w_reg[i][j]) + psum);
+                        macs++;
+                    }
+                    if (!np_v[i+1][j]) {    // PushNB, dropped if the slot below is still full
+                        np_v[i+1][j] = true;
+                        np_d[i+1][j] = new_psum;
+                    }
+                }
+            }
+        }
+
+        // NPU::SendInputs, into row 0 / column 0 for the next cycle
+        NPU_W_Type w_tmp;
+        if (NRSIM_POPNB(w_in, w_tmp)) {
+            for (int j = 0; j < N; j++) {
+                nw_v[0][j] = true;
+                nw_d[0][j] = w_tmp.X[j];
+            }
+        }
+        NPU_In_Type act_tmp;
+        if (NRSIM_POPNB(act_in, act_tmp)) {
+            for (int i = 0; i < N; i++) {
+                na_v[i][0] = true;
+                na_d[i][0] = act_tmp.X[i];
+                na_f[i][0] = 0;
+                if (WBUF && act_tmp.swap[i]) na_f[i][0] |= NPU_FLAG_SWAP;
+                if (act_tmp.last) na_f[i][0] |= NPU_FLAG_LAST;
+            }
+        }
+    }
+
+    // NPU_OS cycle
+    void OutputStationary() {
+        // Rows bottom up: whether a PE pops psum_in depends on its own push, which frees the slot above
+        for (int j = 0; j < N; j++) {
+            np_v[N][j] = false;             // bottom row, drained by CollectPsums
+            for (int i = N-1; i >= 0; i--) {
+                if (w_v[i][j]) {
+                    w_reg[i][j] = w_d[i][j];
+                    nw_v[i+1][j] = true;
+                    nw_d[i+1][j] = w_reg[i][j];
+                }
+                if (a_v[i][j]) {
+                    na_v[i][j+1] = true;
+                    na_d[i][j+1] = a_d[i][j];
+                }
+                if (w_v[i][j] && a_v[i][j]) {
+                    acc[i][j] = NPU_Out_Elem_Type(acc[i][j] + a_d[i][j] * w_reg[i][j]);
+                    if (k[i][j] == NPU_OS_K-1) {
+                        res_reg[i][j] = acc[i][j];
+                        res_valid[i][j] = true;
+                        acc[i][j] = NPU_Out_Elem_Type(0);
+                        k[i][j] = 0;
+                    } else {
+                        k[i][j]++;
+                    }
+                }
+
+                // Drain, np_v[i+1][j] is already the slot below after its consumer's pop
+                if (out_valid[i][j] && !np_v[i+1][j]) {
+                    np_v[i+1][j] = true;
+                    np_d[i+1][j] = out_reg[i][j];
+                    out_valid[i][j] = false;
+                }
+                bool popped = false;
+                if (!out_valid[i][j]) {
+                    if (res_valid[i][j]) {
+                        out_reg[i][j] = res_reg[i][j];
+                        out_valid[i][j] = true;
+                        res_valid[i][j] = false;
+                    } else if (p_v[i][j]) {
+                        out_reg[i][j] = p_d[i][j];
+                        out_valid[i][j] = true;
+                        popped = true;
+                    }
+                }
+                np_v[i][j] = p_v[i][j] && !popped;
+                np_d[i][j] = p_d[i][j];
+            }
+        }
+
+        // NPU::SkewInputs
+        for (int i = 0; i < N; i++) {
+            for (int d = i; d > 0; d--) {
+                w_skew_v[i][d] = w_skew_v[i][d-1];
+                w_skew[i][d] = w_skew[i][d-1];
+                act_skew_v[i][d] = act_skew_v[i][d-1];
+                act_skew[i][d] = act_skew[i][d-1];
+            }
+        }
+        NPU_W_Type w_tmp;
+        bool w_valid = NRSIM_POPNB(w_in, w_tmp);
+        NPU_In_Type act_tmp;
+        bool act_valid = NRSIM_POPNB(act_in, act_tmp);
+        for (int i = 0; i < N; i++) {
+            w_skew_v[i][0] = w_valid;
+            w_skew[i][0] = w_tmp.X[i];
+            act_skew_v[i][0] = act_valid;
+            act_skew[i][0] = act_tmp.X[i];
+        }
+        for (int i = 0; i < N; i++) {
+            if (w_skew_v[i][i]) {
+                nw_v[0][i] = true;
+                nw_d[0][i] = w_skew[i][i];
+            }
+            if (act_skew_v[i][i]) {
+                na_v[i][0] = true;
+                na_d[i][0] = act_skew[i][i];
+            }
+        }
+    }
+};
+
+#endif // NEUREX_NPU_BEHAVIORAL_H
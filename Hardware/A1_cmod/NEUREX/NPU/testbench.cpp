@@ -1,5 +1,6 @@
 #define NVHLS_VERIFY_BLOCKS (NPU)
 #include "NPU.h"
+#include "NPU_behavioral.h"
 #include <nvhls_verify.h>
 //#include <mc_scverify.h>
 #include "nvhls_connections.h"
@@ -9,9 +10,23 @@
 #include <systemc.h>
 #include <nvhls_module.h>
 #include <mc_connections.h>
+#include <chrono>
+#include <cstdlib>
+#include <vector>
 
+/*
+ * Modes: sim_NPU [pe | behavioral | compare] [gemms]
+ *   pe / behavioral: run one engine (default NEUREX_NPU_ENGINE), wall-clock time of the simulation
+ *   compare:         both engines on the same stimulus, psum vectors (values, valid, last) checked one by one
+ * gemms: activation passes after the weight load (default 1, outputs printed only for 1)
+ * sim_NPU dataflow [M K N] [behavioral]
+ *   one MxK * KxN GEMM (default 8 x NPU_SIZE x NPU_SIZE) on each dataflow, checked against the
+ *   reference, cycles from the first input to the last result and PE utilization
+ */
 
+template <typename DUT>
 class Top : public sc_module {
+    SC_HAS_PROCESS(Top);
 public:
     sc_clock clk;
     sc_signal<bool> rst;
@@ -20,14 +35,23 @@ public:
     Connections::Combinational<NPU_In_Type>  act_in;
     Connections::Combinational<NPU_Out_Type> psum_out;
 
-    NVHLS_DESIGN(NPU) dut;
+    NVHLS_DESIGN(DUT) dut;
 
-    SC_CTOR(Top) : clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
+    int gemms;
+    bool stop;                          // sc_stop() after the run (compare mode stops by time)
+    bool verbose;
+    std::vector<NPU_Out_Type> outputs;  // psum_out, valid vectors only
+
+    Top(sc_module_name name, int gemms = 1, bool stop = true) : sc_module(name),
+                   clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
                    rst("rst"),
                    w_in("w_in"),
                    act_in("act_in"),
                    psum_out("psum_out"),
-                   dut("dut") {
+                   dut("dut"),
+                   gemms(gemms),
+                   stop(stop),
+                   verbose(gemms == 1 && stop) {
 
         sc_object_tracer<sc_clock> trace_clk(clk);
 
@@ -61,7 +85,7 @@ public:
         wait(10);
 
         // Phase 1: Load weights by streaming from last row to first row
-        cout << "======= Phase 1: Loading Weights - Streaming from Last Row to First Row =======" << endl;
+        if (verbose) cout << "======= Phase 1: Loading Weights - Streaming from Last Row to First Row =======" << endl;
         
         // In the new approach, we stream weights from bottom (row NPU_SIZE-1) to top (row 0)
         // This way, each PE will automatically store its appropriate weight
@@ -76,46 +100,54 @@ public:
             // Push weights
             w_in.Push(w_data);
             
-            cout << "Streaming weights @ " << sc_time_stamp() << " for row " << row << ", weight values: ";
-            for (int j = 0; j < NPU_SIZE; j++) {
-                // For proper floating-point display, convert to double
-                double display_val = w_data.X[j].to_double();
-                cout << display_val << " ";
+            if (verbose) {
+                cout << "Streaming weights @ " << sc_time_stamp() << " for row " << row << ", weight values: ";
+                for (int j = 0; j < NPU_SIZE; j++) {
+                    // For proper floating-point display, convert to double
+                    double display_val = w_data.X[j].to_double();
+                    cout << display_val << " ";
+                }
+                cout << endl;
             }
-            cout << endl;
             
             wait();
         }
         
         // Add a small wait after all weights are loaded
-        cout << "All weights loaded, waiting for stabilization..." << endl;
+        if (verbose) cout << "All weights loaded, waiting for stabilization..." << endl;
         wait(NPU_SIZE+1);
         
-        // Phase 2: Stream activations for matrix multiplication
-        cout << "======= Phase 2: Streaming Activations =======" << endl;
-        for (int t = 0; t < NPU_SIZE * 2; t++) {
-            // Create activation row - shift pattern to have systolic behavior
-            NPU_In_Type act_data;
-            for (int i = 0; i < NPU_SIZE; i++) {
-                if (t - i >= 0 && t - i < NPU_SIZE) {
-                    act_data.X[i] = NPU_In_Elem_Type(t - i + 1); // Value depends on timestep
-                } else {
-                    act_data.X[i] = NPU_In_Elem_Type(0); // Zero padding
+        // Phase 2: Stream activations for matrix multiplication (gemms passes)
+        if (verbose) cout << "======= Phase 2: Streaming Activations =======" << endl;
+        for (int g = 0; g < gemms; g++) {
+            for (int t = 0; t < NPU_SIZE * 2; t++) {
+                // Create activation row - shift pattern to have systolic behavior
+                NPU_In_Type act_data;
+                act_data.swap = 0;
+                act_data.last = (t == NPU_SIZE * 2 - 1);
+                for (int i = 0; i < NPU_SIZE; i++) {
+                    if (t - i >= 0 && t - i < NPU_SIZE) {
+                        act_data.X[i] = NPU_In_Elem_Type(t - i + 1 + g); // Value depends on timestep
+                    } else {
+                        act_data.X[i] = NPU_In_Elem_Type(0); // Zero padding
+                    }
                 }
+
+                // Push activations
+                act_in.Push(act_data);
+
+                if (verbose) {
+                    cout << "Activations at time " << t << ": ";
+                    for (int i = 0; i < NPU_SIZE; i++) {
+                        // For proper floating-point display, convert to double
+                        double display_val = act_data.X[i].to_double();
+                        cout << display_val << " ";
+                    }
+                    cout << endl;
+                }
+
+                wait();
             }
-            
-            // Push activations
-            act_in.Push(act_data);
-            
-            cout << "Activations at time " << t << ": ";
-            for (int i = 0; i < NPU_SIZE; i++) {
-                // For proper floating-point display, convert to double
-                double display_val = act_data.X[i].to_double();
-                cout << display_val << " ";
-            }
-            cout << endl;
-            
-            wait();
         }
         
         // Let computation complete
@@ -130,25 +162,280 @@ public:
         while (1) {
             NPU_Out_Type result;
             if (psum_out.PopNB(result)) {
-                cout << "NPU Output @ " << sc_time_stamp() << " : ";
-                for (int i = 0; i < NPU_SIZE; i++) {
-                    cout << result.X[i] << " ";
+                outputs.push_back(result);
+                if (verbose) {
+                    cout << "NPU Output @ " << sc_time_stamp() << " : ";
+                    for (int i = 0; i < NPU_SIZE; i++) {
+                        if (result.valid[i]) cout << result.X[i] << " ";
+                        else cout << "- ";
+                    }
+                    if (result.last) cout << "(last)";
+                    cout << endl; 
                 }
-                cout << endl; 
             }
             count++;
-            if (count > NPU_SIZE * 10) {
+            if (count > Cycles(gemms)) {
                 break;
             }
             wait();
         }
-        sc_stop();
+        if (stop) sc_stop();
     }
+
+    // Cycles collected after reset
+    static int Cycles(int gemms) { return NPU_SIZE * 10 + (gemms - 1) * NPU_SIZE * 2; }
 };
 
-int sc_main(int argc, char *argv[]) {
-    Top tb("tb");
+static const char *dataflow_name[] = {"WS", "OS", "IS"};
+static int gemm_running = 0; // GemmTops still simulating, the last one stops
+
+/*
+ * One M x K x NC GEMM, C = A * B, mapped on the DF dataflow:
+ *   NPU_WS: B (K <= NPU_SIZE, NC <= NPU_SIZE) stationary, the M rows of A stream, C[m][j] leaves column j
+ *   NPU_IS: A (M <= NPU_SIZE, K <= NPU_SIZE) stationary, the NC columns of B stream, C[m][n] leaves column m
+ *   NPU_OS: C (M <= NPU_SIZE, NC <= NPU_SIZE) stationary, NPU_OS_K steps of A and B stream (K <= NPU_OS_K)
+ */
+template <typename DUT, int DF>
+class GemmTop : public sc_module {
+    SC_HAS_PROCESS(GemmTop);
+public:
+    static const int N = NPU_SIZE;
+
+    sc_clock clk;
+    sc_signal<bool> rst;
+
+    Connections::Combinational<NPU_W_Type>   w_in;
+    Connections::Combinational<NPU_In_Type>  act_in;
+    Connections::Combinational<NPU_Out_Type> psum_out;
+
+    DUT dut;
+
+    int M, K, NC;
+    std::vector<int> A, B;              // A[m][k], B[k][n]
+    std::vector<NPU_Out_Type> outputs;  // psum_out per cycle from the first input
+    unsigned long cycles;
+    bool pass;
+
+    GemmTop(sc_module_name name, int M, int K, int NC) : sc_module(name),
+                   clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
+                   rst("rst"),
+                   w_in("w_in"),
+                   act_in("act_in"),
+                   psum_out("psum_out"),
+                   dut("dut"),
+                   M(M), K(K), NC(NC), A(M*K), B(K*NC), cycles(0), pass(false) {
+        std::mt19937 gen(DF + 1);
+        std::uniform_int_distribution<int> u(-4, 4);
+        for (auto &a : A) a = u(gen);
+        for (auto &b : B) b = u(gen);
+        gemm_running++;
+
+        dut.clk(clk);
+        dut.rst(rst);
+        dut.w_in(w_in);
+        dut.act_in(act_in);
+        dut.psum_out(psum_out);
+
+        SC_THREAD(reset);
+        sensitive << clk.posedge_event();
+
+        SC_THREAD(run);
+        sensitive << clk.posedge_event();
+        async_reset_signal_is(rst, false);
+
+        SC_THREAD(collect);
+        sensitive << clk.posedge_event();
+        async_reset_signal_is(rst, false);
+    }
+
+    void reset() {
+        rst.write(false);
+        wait(10);
+        rst.write(true);
+    }
+
+    int a(int m, int k) const { return (m >= 0 && m < M && k >= 0 && k < K) ? A[m*K + k] : 0; }
+    int b(int k, int n) const { return (k >= 0 && k < K && n >= 0 && n < NC) ? B[k*NC + n] : 0; }
+
+    // Stationary operand, bottom row first
+    template <typename F>
+    void Load(F elem) {
+        for (int r = N - 1; r >= 0; r--) {
+            NPU_W_Type w;
+            for (int j = 0; j < N; j++) w.X[j] = NPU_W_Elem_Type(elem(r, j));
+            w_in.Push(w);
+            wait();
+        }
+    }
+
+    // Streamed operand, element i one cycle later per row
+    template <typename F>
+    void Stream(int len, F elem) {
+        for (int t = 0; t < len + N - 1; t++) {
+            NPU_In_Type x;
+            x.swap = 0;
+            x.last = (t == len + N - 2);
+            for (int i = 0; i < N; i++) x.X[i] = NPU_In_Elem_Type(elem(i, t - i));
+            act_in.Push(x);
+            wait();
+        }
+    }
+
+    void run() {
+        w_in.ResetWrite();
+        act_in.ResetWrite();
+        wait(10);
+
+        if (DF == NPU_WS) {
+            Load([this](int r, int j) { return b(r, j); });
+            Stream(M, [this](int i, int m) { return a(m, i); });
+        } else if (DF == NPU_IS) {
+            Load([this](int r, int j) { return a(j, r); });
+            Stream(NC, [this](int i, int n) { return b(i, n); });
+        } else {
+            for (int k = 0; k < NPU_OS_K; k++) {
+                NPU_W_Type w;
+                NPU_In_Type x;
+                x.swap = 0;
+                x.last = false;
+                for (int i = 0; i < N; i++) {
+                    x.X[i] = NPU_In_Elem_Type(a(i, k));
+                    w.X[i] = NPU_W_Elem_Type(b(k, i));
+                }
+                w_in.Push(w);
+                act_in.Push(x);
+                wait();
+            }
+        }
+    }
+
+    void collect() {
+        psum_out.ResetRead();
+        wait(10);
+
+        const int limit = 4*N + M + K + NC + NPU_OS_K + 16;
+        for (int c = 0; c < limit; c++) {
+            NPU_Out_Type r;
+            if (!psum_out.PopNB(r)) {
+                for (int j = 0; j < N; j++) r.X[j] = NPU_Out_Elem_Type(0);
+            }
+            outputs.push_back(r);
+            wait();
+        }
+        Check();
+        if (--gemm_running == 0) sc_stop();
+    }
+
+    NPU_Out_Elem_Type C(int m, int n) const {
+        int c = 0;
+        for (int k = 0; k < K; k++) c += a(m, k) * b(k, n);
+        return NPU_Out_Elem_Type(c);
+    }
+
+    // Find the output offset all results line up with, C[s][col] leaves column col at cycle o + s + col (WS)
+    void Check() {
+        int S    = (DF == NPU_WS) ? M : (DF == NPU_IS) ? NC : N;
+        int COLS = (DF == NPU_IS) ? M : NC;
+        for (int o = 0; !pass && o + S + COLS - 1 <= int(outputs.size()); o++) {
+            bool ok = true;
+            for (int s = 0; ok && s < S; s++) {
+                for (int col = 0; ok && col < COLS; col++) {
+                    NPU_Out_Elem_Type expect = (DF == NPU_WS) ? C(s, col) :
+                                               (DF == NPU_IS) ? C(col, s) :
+                                                                C(N - 1 - s, col); // drained bottom row first
+                    ok = (outputs[o + s + col].X[col] == expect);
+                }
+            }
+            if (ok) {
+                pass = true;
+                cycles = o + S + COLS - 1;
+            }
+        }
+    }
+
+    void Report() const {
+        double util = pass ? double(M) * K * NC / (double(N) * N * cycles) : 0;
+        cout << (pass ? "✓ " : "✗ (MISMATCH) ") << dataflow_name[DF] << ": " << M << "x" << K << "x" << NC
+             << " GEMM in " << cycles << " cycles, PE utilization " << 100 * util << "%" << endl;
+    }
+};
+
+template <int DF>
+using GemmPE = GemmTop<NEUREX_NPU<DF>, DF>;
+template <int DF>
+using GemmBehavioral = GemmTop<NPU_behavioral<DF>, DF>;
+
+template <template <int> class G>
+static bool RunDataflows(int M, int K, int NC) {
+    G<NPU_WS> ws("ws", M, K, NC);
+    G<NPU_OS> os("os", M, K, NC);
+    G<NPU_IS> is("is", M, K, NC);
     sc_start();
+    ws.Report();
+    os.Report();
+    is.Report();
+    return ws.pass && os.pass && is.pass;
+}
+
+template <typename DUT>
+static double Run(int gemms) {
+    Top<DUT> tb("tb", gemms);
+    auto start = std::chrono::steady_clock::now();
+    sc_start();
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    int cycles = Top<DUT>::Cycles(gemms);
+    cout << cycles << " cycles (" << tb.outputs.size() << " psum vectors), " << gemms << " GEMMs simulated in "
+         << sec << " s (" << cycles / sec << " cycles/s)" << endl;
+    return sec;
+}
+
+int sc_main(int argc, char *argv[]) {
+    std::string mode = (argc > 1) ? argv[1] : "";
+    int gemms = (argc > 2) ? atoi(argv[2]) : 1;
+
+    if (mode == "pe") {
+        Run<NEUREX_NPU<> >(gemms);
+    } else if (mode == "behavioral") {
+        Run<NPU_behavioral<> >(gemms);
+    } else if (mode == "compare") {
+        Top<NEUREX_NPU<> > pe("pe", gemms, false);
+        Top<NPU_behavioral<> > beh("beh", gemms, false);
+        sc_start(sc_time(10 + Top<NEUREX_NPU<> >::Cycles(gemms) + 10, SC_NS));
+
+        int mismatches = 0;
+        size_t n = (pe.outputs.size() < beh.outputs.size()) ? pe.outputs.size() : beh.outputs.size();
+        for (size_t c = 0; c < n; c++) {
+            for (int j = 0; j < NPU_SIZE; j++) {
+                if (pe.outputs[c].X[j] != beh.outputs[c].X[j] || pe.outputs[c].valid[j] != beh.outputs[c].valid[j]) {
+                    if (mismatches < 10) {
+                        cout << "✗ (MISMATCH) vector " << c << " col " << j << ": NPU " << pe.outputs[c].X[j]
+                             << ", NPU_behavioral " << beh.outputs[c].X[j] << endl;
+                    }
+                    mismatches++;
+                }
+            }
+            if (pe.outputs[c].last != beh.outputs[c].last) {
+                if (mismatches < 10) cout << "✗ (MISMATCH) vector " << c << ": last differs" << endl;
+                mismatches++;
+            }
+        }
+        bool pass = (mismatches == 0) && (pe.outputs.size() == beh.outputs.size()) && n > 0;
+        cout << (pass ? "✓" : "✗") << " " << n << " psum vectors compared, " << mismatches << " mismatches" << endl;
+        cout << (pass ? "PASSED" : "FAILED") << endl;
+    } else if (mode == "dataflow") {
+        int M = (argc > 4) ? atoi(argv[2]) : 8;
+        int K = (argc > 4) ? atoi(argv[3]) : NPU_SIZE;
+        int NC = (argc > 4) ? atoi(argv[4]) : NPU_SIZE;
+        bool behavioral = std::string(argv[argc-1]) == "behavioral";
+        if (M > NPU_SIZE || K > NPU_SIZE || NC > NPU_SIZE) {
+            cout << "M, K, N have to fit one NPU_SIZE tile" << endl;
+            return 1;
+        }
+        bool pass = behavioral ? RunDataflows<GemmBehavioral>(M, K, NC) : RunDataflows<GemmPE>(M, K, NC);
+        cout << (pass ? "PASSED" : "FAILED") << endl;
+    } else {
+        Run<NEUREX_NPU_ENGINE>(gemms);
+    }
     return 0;
 }
 
@@ -15,9 +15,26 @@
 
 // Helpers from https://github.com/hlslibs/matchlib_toolkit/blob/main/include/auto_gen_fields.h#L425
 // Slightly modify for marshall, width only
-#include "auto_gen_fields.h"
+#include "../../common/include/auto_gen_fields.h"
 
-#define NPU_SIZE 32
+// Channel / thread stall instrumentation, JSON summary at the end of the simulation (C model only)
+// #define NRSIM_INSTRUMENT
+#include "../../common/include/nrsim_instrument.h"
+
+// Systolic array library shared with CICERO (common/NPU), NEUREX_NPU in NPU/NPU.h fixes the NEUREX array
+#include "../../common/include/NPUPackDef.h"
+
+#ifndef NPU_SIZE
+#define NPU_SIZE 32          // changeable, NEUREX_NPU rows and columns
+#endif
+#define NEUREX_NPU_ENGINE NEUREX_NPU<>  // changeable, NEUREX_NPU<> (NPU_PE array, HLS target) or NPU_behavioral<> (single-thread C model)
+
+#ifndef NPU_DATAFLOW
+#define NPU_DATAFLOW NPU_WS  // changeable, npu_dataflow of NEUREX_NPU / NPU_behavioral
+#endif
+#ifndef NPU_OS_K
+#define NPU_OS_K NPU_SIZE    // changeable, NPU_OS reduction depth per output tile (>= NPU_SIZE, the drain has to finish within it)
+#endif
 
 typedef ac_int<16, true> NPU_W_Elem_Type;
 typedef ac_int<16, true> NPU_In_Elem_Type;
@@ -26,34 +43,58 @@ typedef ac_int<16, true> NPU_Out_Elem_Type;
 // typedef ac_std_float<32, 8> NPU_In_Elem_Type;
 // typedef ac_std_float<32, 8> NPU_Out_Elem_Type;
 
-class NPU_W_Type : public nvhls_message {
-public:
-    NPU_W_Elem_Type X[NPU_SIZE];
-    AUTO_GEN_FIELD_METHODS((X))
-};
+typedef NPU_W_Vec<NPU_W_Elem_Type, NPU_SIZE>    NPU_W_Type;
+typedef NPU_In_Vec<NPU_In_Elem_Type, NPU_SIZE>  NPU_In_Type;   // swap / last: see NPUPackDef.h
+typedef NPU_Out_Vec<NPU_Out_Elem_Type, NPU_SIZE> NPU_Out_Type; // only sent when a column holds a result
 
-class NPU_In_Type : public nvhls_message {
+// GEMM controller, C[M][N] = A[M][K] * B[K][N] tiled on the NPU_WS array
+class GEMM_Req_Type : public nvhls_message {
 public:
-    NPU_In_Elem_Type X[NPU_SIZE];
-    AUTO_GEN_FIELD_METHODS((X))
-};
-
-class NPU_Out_Type : public nvhls_message {
-public:
-    NPU_Out_Elem_Type X[NPU_SIZE];
-    AUTO_GEN_FIELD_METHODS((X))
+    ac_int<16, false> M, K, N;
+    bool overlap;  // preload the next weight tile while the current one streams (false: after it drained)
+    AUTO_GEN_FIELD_METHODS((M, K, N, overlap))
 };
 
 // Index compute unit
 typedef ac_std_float<32, 8> ICU_In_Elem;
-class ICU_In_Type : public nvhls_message {
+typedef ac_std_float<32, 8> ICU_Out_Type;
+#ifndef ICU_FEATURES
+#define ICU_FEATURES 2       // changeable, feature channels per hash table entry (2, 4 or 8)
+#endif
+// The 8 corner features of one level, channel f of corner c at x[c*F + f]
+template <int F = ICU_FEATURES>
+class ICU_Feat_Type : public nvhls_message {
 public:
-    ICU_In_Elem x[8];
+    ICU_In_Elem x[8*F];
     AUTO_GEN_FIELD_METHODS((x))
 };
-typedef ac_std_float<32, 8> ICU_Out_Type;
+// Interpolated feature of one level
+template <int F = ICU_FEATURES>
+class ICU_Out_Vec : public nvhls_message {
+public:
+    ICU_Out_Type x[F];
+    AUTO_GEN_FIELD_METHODS((x))
+};
+
+// Index generation unit, multi-resolution hash encoding (template parameters of IGU)
+#ifndef IGU_LEVELS
+#define IGU_LEVELS 16        // changeable, hash grid levels per sample
+#endif
+#ifndef IGU_LANES
+#define IGU_LANES 4          // changeable, levels encoded per cycle, a sample takes IGU_LEVELS / IGU_LANES cycles
+#endif
+#ifndef IGU_TABLE_BITS
+#define IGU_TABLE_BITS 19    // changeable, log2 of the hash table entries per level
+#endif
+// Corner reuse, 1: a level whose grid cell (pos_lower_int) is the one of the previous sample is not re-hashed,
+// the FeatureTable forwards the features it read for the level last instead of reading the table again
+// (consecutive samples of a ray at the coarse levels)
+#ifndef IGU_CORNER_REUSE
+#define IGU_CORNER_REUSE 0   // changeable, opt-in
+#endif
+#define IGU_P1 2654435761u   // spatial hash primes of y and z (x uses 1), as in Instant-NGP
+#define IGU_P2 805459861u
 
-// Index generation unit
 typedef ac_std_float<32, 8> IGU_In_Elem_Type;
 class IGU_In_Type : public nvhls_message {
 public:
@@ -62,23 +103,62 @@ public:
 };
 typedef ac_std_float<32, 8> IGU_Out_Elem_Type;
 typedef int IGU_Grid_Res;
+typedef ac_int<8, false> IGU_Level_Type;
+// Configuration, grid resolution of one level
+class IGU_Level_Res : public nvhls_message {
+public:
+    IGU_Level_Type level;
+    IGU_Grid_Res res;
+    AUTO_GEN_FIELD_METHODS((level, res))
+};
 class Hashed_addr : public nvhls_message {
 public:
-    IGU_Grid_Res x[8];
-    AUTO_GEN_FIELD_METHODS((x))
+    IGU_Grid_Res x[8];     // corner entries in the level's table
+    IGU_Level_Type level;
+    bool reuse;            // same cell as the previous sample at this level (IGU_CORNER_REUSE), x not computed
+    AUTO_GEN_FIELD_METHODS((x, level, reuse))
 };
 class IGU_Weight : public nvhls_message {
 public:
     IGU_Out_Elem_Type x[8];
     AUTO_GEN_FIELD_METHODS((x))
 };
+// Feature table between IGU and ICU, banked hash table SRAM
+#ifndef FT_BANKS
+#define FT_BANKS 8           // changeable, single-port banks (power of two)
+#endif
+// bank of a lookup, FT_MAP_LOW: low address bits, FT_MAP_XOR: XOR fold of the address bits (and the level),
+// FT_MAP_CORNER: corner c reads bank c % FT_BANKS (tables replicated per bank, conflict free for FT_BANKS >= 8)
+enum ft_mapping {FT_MAP_LOW=0, FT_MAP_XOR=1, FT_MAP_CORNER=2};
+#ifndef FT_MAPPING
+#define FT_MAPPING FT_MAP_XOR  // changeable
+#endif
+
+// NEUREX top, hash encoding -> MLP on the GEMM controller
+#ifndef NEUREX_BATCH
+#define NEUREX_BATCH 128     // changeable, samples per MLP batch
+#endif
+#ifndef NEUREX_HIDDEN
+#define NEUREX_HIDDEN 64     // changeable, hidden layer width
+#endif
+#ifndef NEUREX_LAYERS
+#define NEUREX_LAYERS 3      // changeable, MLP layers: IGU_LEVELS*ICU_FEATURES -> NEUREX_HIDDEN ... -> NEUREX_OUT
+#endif
+#define NEUREX_OUT 4         // MLP outputs per sample (density, rgb)
+#define NEUREX_FEAT_FRAC 8   // fraction bits of the encoded features on the NPU
+#define NEUREX_ACT_SHIFT 8   // requantization of the hidden activations (fraction bits of the weights)
+#define NEUREX_W_DEPTH 4     // IGU weights waiting for their features (FeatureTable latency and conflicts)
+class NEUREX_Out_Type : public nvhls_message {
+public:
+    NPU_Out_Elem_Type x[NEUREX_OUT];
+    AUTO_GEN_FIELD_METHODS((x))
+};
+
 class IGU_Pos : public nvhls_message {
 public:
     int x[3];
     AUTO_GEN_FIELD_METHODS((x))
 };
-static int P1 = 20;
-static int P2 = 30;
 
 
 
@@ -0,0 +1,313 @@
+#ifndef NPU_H
+#define NPU_H
+
+#include "../include/NPUPackDef.h"
+#include <nvhls_int.h>
+#include <nvhls_connections.h>
+#include <ac_std_float.h>
+
+#include "../NPU_PE/NPU_PE.h"
+
+/*
+ * Rows x Cols systolic array of NPU_PE<WType, AType, PType, DATAFLOW>, shared by the accelerators (CICERO_NPU,
+ * NEUREX_NPU<DATAFLOW, WBUF>). Rows is the reduction depth of a weight tile, Cols its output width.
+ * w_in rows (Cols weights) enter at the top, act_in columns (Rows activations) at the left, psums leave at the
+ * bottom (one Out_Type of Cols psums per cycle)
+ * NPU_WS / NPU_IS: the caller skews act_in (element i one cycle later per row i) and loads w_in bottom row first
+ * NPU_OS:          act_in is column k of A, w_in row k of B, the skew registers delay row i / column j by i / j cycles,
+ *                  every PE accumulates OS_K (>= Rows) products
+ * WBUF (NPU_WS / NPU_IS): w_in loads the shadow weights, act_in.swap[i] switches row i to them (see NPU_PE)
+ * psum_out is only sent in cycles a bottom row PE produced a psum, valid marks those columns; last is set with
+ * the last column's psum of an act_in vector flagged last (NPU_WS / NPU_IS, it leaves PE(Rows-1, Cols-1) with it)
+ */
+template <int Rows, int Cols, typename WType, typename AType, typename PType,
+          int DATAFLOW = NPU_WS, bool WBUF = false, int OS_K = Rows>
+class NPU : public match::Module {
+    SC_HAS_PROCESS(NPU);
+public:
+
+    typedef NPU_W_Vec<WType, Cols>   W_Type;
+    typedef NPU_In_Vec<AType, Rows>  In_Type;
+    typedef NPU_Out_Vec<PType, Cols> Out_Type;
+    typedef NPU_PE<WType, AType, PType, DATAFLOW, WBUF, OS_K> PE_Type;
+
+    const static int ROWS = Rows;
+    const static int COLS = Cols;
+
+    PE_Type* array[Rows][Cols];
+
+    Connections::In<W_Type>     w_in;
+    Connections::In<In_Type>    act_in;
+    Connections::Out<Out_Type>  psum_out;
+
+    Connections::Combinational<WType>         w_data[Rows][Cols];
+    Connections::Combinational<AType>         act_data[Rows][Cols];
+    Connections::Combinational<PType>         psum_data[Rows][Cols];
+    Connections::Combinational<NPU_Flag_Type> flag_data[Rows][Cols];
+
+    Connections::Combinational<WType>         w_in_vec[Cols];
+    Connections::Combinational<AType>         act_in_vec[Rows];
+    Connections::Combinational<PType>         psum_in_vec[Cols];
+    Connections::Combinational<NPU_Flag_Type> flag_in_vec[Rows];
+
+    // NPU_OS input skew, stage d of column j / row i holds what entered d cycles ago (stage j / i is pushed)
+    bool w_skew_v[Cols][Cols], act_skew_v[Rows][Rows];
+    WType w_skew[Cols][Cols];
+    AType act_skew[Rows][Rows];
+
+    NPU(sc_module_name name) : match::Module(name),
+                               w_in("w_in"),
+                               act_in("act_in"),
+                               psum_out("psum_out") {
+        for (int i = 0; i < Rows; i++) {      // rows
+            for (int j = 0; j < Cols; j++) {  // cols
+                array[i][j] = new PE_Type(sc_gen_unique_name("npu_pe")); // Pass row and column index to PE
+                array[i][j]->clk(clk);
+                array[i][j]->rst(rst);
+                
+                // Weight connections (top to bottom)
+                if (i == 0) {
+                    array[i][j]->w_in(w_in_vec[j]);
+                    array[i][j]->w_out(w_data[i][j]);
+                } else {
+                    array[i][j]->w_in(w_data[i-1][j]);
+                    array[i][j]->w_out(w_data[i][j]);
+                }
+
+                // Activation connections (left to right)
+                if (j == 0) {
+                    array[i][j]->act_in(act_in_vec[i]);
+                    array[i][j]->act_out(act_data[i][j]);
+                    array[i][j]->flag_in(flag_in_vec[i]);
+                    array[i][j]->flag_out(flag_data[i][j]);
+                } else {
+                    array[i][j]->act_in(act_data[i][j-1]);
+                    array[i][j]->act_out(act_data[i][j]);
+                    array[i][j]->flag_in(flag_data[i][j-1]);
+                    array[i][j]->flag_out(flag_data[i][j]);
+                }
+
+                // Partial sum connections (top to bottom)
+                if (i == 0) {
+                    array[i][j]->psum_in(psum_in_vec[j]);
+                    array[i][j]->psum_out(psum_data[i][j]);
+                } else {
+                    array[i][j]->psum_in(psum_data[i-1][j]);
+                    array[i][j]->psum_out(psum_data[i][j]);
+                }
+            }
+        }
+ 
+        // Initialize threads
+        SC_THREAD (CollectPsums);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+
+        SC_THREAD (SendInputs);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+
+        SC_THREAD (Popout);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+    }
+
+    // Statistics over the PEs
+    unsigned long Macs() const {
+        unsigned long n = 0;
+        for (int i = 0; i < Rows; i++)
+            for (int j = 0; j < Cols; j++) n += array[i][j]->macs;
+        return n;
+    }
+    unsigned long Skipped() const {
+        unsigned long n = 0;
+        for (int i = 0; i < Rows; i++)
+            for (int j = 0; j < Cols; j++) n += array[i][j]->skipped;
+        return n;
+    }
+
+    // Backdoor access for the testbench (C simulation only, no timing): weight tile row i into PE row i,
+    // replaces the w_in load of NPU_WS / NPU_IS, after reset and with the array drained
+    void PreloadWeights(const W_Type w[Rows]) {
+        for (int i = 0; i < Rows; i++)
+            for (int j = 0; j < Cols; j++) array[i][j]->PreloadWeight(w[i].X[j]);
+    }
+
+    // Collect partial sums from the bottom row
+    void CollectPsums() {
+        #pragma hls_unroll yes
+        for (int j = 0; j < Cols; j++) {
+            psum_data[Rows-1][j].ResetRead();  // Bottom row
+        }
+        flag_data[Rows-1][Cols-1].ResetRead();
+        psum_out.Reset();
+        wait();
+
+        #pragma hls_pipeline_init_interval 1
+        while(1) {
+            wait();
+            
+            Out_Type out;
+            out.valid = 0;
+            #pragma hls_unroll yes
+            for (int j = 0; j < Cols; j++) {
+                PType psum_value;
+                if (NRSIM_POPNB(psum_data[Rows-1][j], psum_value)) {  // Bottom row
+                    out.X[j] = psum_value;
+                    out.valid[j] = 1;
+                } else {
+                    out.X[j] = PType(0);
+                }
+            }
+
+            // Pushed by PE(Rows-1, Cols-1) in the cycle of its psum
+            NPU_Flag_Type flag = 0;
+            NRSIM_POPNB(flag_data[Rows-1][Cols-1], flag);
+            out.last = (flag & NPU_FLAG_LAST) != 0;
+
+            if (out.valid != 0) NRSIM_PUSH(psum_out, out);
+        }
+    }
+
+    void SendInputs() {
+        w_in.Reset();
+        act_in.Reset();
+
+        #pragma hls_unroll
+        for (int i = 0; i < Rows; i++) {
+            act_in_vec[i].ResetWrite();
+            flag_in_vec[i].ResetWrite();
+        }
+
+        // Reset w_in_vec and psum_in_vec
+        #pragma hls_unroll
+        for (int j = 0; j < Cols; j++) {
+            w_in_vec[j].ResetWrite();
+            psum_in_vec[j].ResetWrite();
+        }
+
+        #pragma hls_unroll
+        for (int j = 0; j < Cols; j++) {
+            for (int d = 0; d < Cols; d++) w_skew_v[j][d] = false;
+        }
+        #pragma hls_unroll
+        for (int i = 0; i < Rows; i++) {
+            for (int d = 0; d < Rows; d++) act_skew_v[i][d] = false;
+        }
+        
+        wait();
+
+        #pragma hls_pipeline_init_interval 1
+        while (1) {
+            wait();
+
+            if (DATAFLOW == NPU_OS) {
+                SkewInputs();
+                continue;
+            }
+
+            // Push weight inputs - weights flow top to bottom through columns
+            W_Type w_tmp;
+            if (NRSIM_POPNB(w_in, w_tmp)) {
+                #pragma hls_unroll
+                for (int j = 0; j < Cols; j++) {
+                    NRSIM_PUSH(w_in_vec[j], w_tmp.X[j]);
+                }
+            }
+
+            // Push activation inputs
+            In_Type act_tmp;
+            if (NRSIM_POPNB(act_in, act_tmp)) {
+                #pragma hls_unroll
+                for (int i = 0; i < Rows; i++) {
+                    NRSIM_PUSH(act_in_vec[i], act_tmp.X[i]);
+                    NPU_Flag_Type flag = 0;
+                    if (WBUF && act_tmp.swap[i]) flag |= NPU_FLAG_SWAP;
+                    if (act_tmp.last) flag |= NPU_FLAG_LAST;
+                    NRSIM_PUSH(flag_in_vec[i], flag);
+                }
+            }
+        }
+    }
+
+    // One cycle of the NPU_OS input skew
+    void SkewInputs() {
+        #pragma hls_unroll
+        for (int j = 0; j < Cols; j++) {
+            #pragma hls_unroll
+            for (int d = Cols-1; d > 0; d--) {
+                if (d <= j) {
+                    w_skew_v[j][d] = w_skew_v[j][d-1];
+                    w_skew[j][d] = w_skew[j][d-1];
+                }
+            }
+        }
+        #pragma hls_unroll
+        for (int i = 0; i < Rows; i++) {
+            #pragma hls_unroll
+            for (int d = Rows-1; d > 0; d--) {
+                if (d <= i) {
+                    act_skew_v[i][d] = act_skew_v[i][d-1];
+                    act_skew[i][d] = act_skew[i][d-1];
+                }
+            }
+        }
+
+        W_Type w_tmp;
+        bool w_valid = NRSIM_POPNB(w_in, w_tmp);
+        In_Type act_tmp;
+        bool act_valid = NRSIM_POPNB(act_in, act_tmp);
+        #pragma hls_unroll
+        for (int j = 0; j < Cols; j++) {
+            w_skew_v[j][0] = w_valid;
+            w_skew[j][0] = w_tmp.X[j];
+        }
+        #pragma hls_unroll
+        for (int i = 0; i < Rows; i++) {
+            act_skew_v[i][0] = act_valid;
+            act_skew[i][0] = act_tmp.X[i];
+        }
+
+        #pragma hls_unroll
+        for (int j = 0; j < Cols; j++) {
+            if (w_skew_v[j][j]) NRSIM_PUSH(w_in_vec[j], w_skew[j][j]);
+        }
+        #pragma hls_unroll
+        for (int i = 0; i < Rows; i++) {
+            if (act_skew_v[i][i]) NRSIM_PUSH(act_in_vec[i], act_skew[i][i]);
+        }
+    }
+
+    void Popout() {
+        #pragma hls_unroll
+        for (int j = 0; j < Cols; j++) {
+            w_data[Rows-1][j].ResetRead();      // Bottom row
+        }
+        #pragma hls_unroll
+        for (int i = 0; i < Rows; i++) {
+            act_data[i][Cols-1].ResetRead();    // Rightmost column
+            if (i < Rows-1) flag_data[i][Cols-1].ResetRead();  // bottom row one read by CollectPsums
+        }
+        wait();
+
+        #pragma hls_pipeline_init_interval 1
+        while (1) {
+            wait();
+            // Pop out to avoid getting stuck
+            #pragma hls_unroll
+            for (int j = 0; j < Cols; j++) {
+                WType w_temp;
+                NRSIM_POPNB(w_data[Rows-1][j], w_temp);      // Bottom row
+            }
+            #pragma hls_unroll
+            for (int i = 0; i < Rows; i++) {
+                AType act_temp;
+                NRSIM_POPNB(act_data[i][Cols-1], act_temp);  // Rightmost column
+                NPU_Flag_Type flag_temp;
+                if (i < Rows-1) NRSIM_POPNB(flag_data[i][Cols-1], flag_temp);
+            }
+        }
+    }
+};
+
+#endif // NPU_H
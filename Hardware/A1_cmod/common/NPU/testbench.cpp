@@ -0,0 +1,212 @@
+#include "NPU.h"
+#include "../include/nrsim_reference.h"
+#include <nvhls_verify.h>
+#include "nvhls_connections.h"
+#include "ac_sysc_trace.h"
+#include <random>
+#include <systemc.h>
+#include <nvhls_module.h>
+#include <mc_connections.h>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+/*
+ * Usage: sim_NPU [M, default 128] [K, default 64] [N, default 64] [backdoor]
+ * Array size sweep: C[M][N] = A[M][K] * B[K][N] on several Rows x Cols NPU_WS arrays (square and not) in one
+ * binary. Each array runs the GEMM tile by tile: the Rows x Cols weight tile B[k0..][n0..] loads bottom row
+ * first and settles, the M + Rows - 1 skewed act vectors stream, the tile's psums drain before the next load.
+ * C is checked against an exact reference, cycles and MAC utilization (M*K*N / (Rows*Cols*cycles)) are reported.
+ * backdoor: each weight tile is written into the PEs directly (NPU::PreloadWeights) instead of loading through
+ * w_in, the cycles are those of the act streams alone.
+ */
+
+typedef ac_int<16, true> Sweep_W;
+typedef ac_int<16, true> Sweep_A;
+typedef ac_int<32, true> Sweep_P;
+
+static int npu_running = 0; // Tops still simulating, the last one stops
+static bool npu_backdoor = false;
+
+struct Gemm {
+    int M, K, N;
+    std::vector<int> A, B;  // [M][K], [K][N]
+    std::vector<long> C;    // reference, [M][N]
+};
+
+template <int Rows, int Cols>
+class Top : public sc_module {
+    SC_HAS_PROCESS(Top);
+public:
+    typedef NPU<Rows, Cols, Sweep_W, Sweep_A, Sweep_P> DUT;
+
+    sc_clock clk;
+    sc_signal<bool> rst;
+
+    Connections::Combinational<typename DUT::W_Type>   w_in;
+    Connections::Combinational<typename DUT::In_Type>  act_in;
+    Connections::Combinational<typename DUT::Out_Type> psum_out;
+
+    DUT dut;
+
+    const Gemm &g;
+    std::vector<long> C;
+    int drained;  // tiles whose psums are in C
+    sc_time first, last;
+
+    Top(sc_module_name name, const Gemm &g) : sc_module(name),
+                   clk("clk", 1, SC_NS, 0.5, 0, SC_NS, true),
+                   rst("rst"),
+                   w_in("w_in"),
+                   act_in("act_in"),
+                   psum_out("psum_out"),
+                   dut("dut"),
+                   g(g),
+                   C(g.M * g.N, 0),
+                   drained(0) {
+
+        sc_object_tracer<sc_clock> trace_clk(clk);
+
+        dut.clk(clk);
+        dut.rst(rst);
+        dut.w_in(w_in);
+        dut.act_in(act_in);
+        dut.psum_out(psum_out);
+        npu_running++;
+
+        SC_THREAD(reset);
+        sensitive << clk.posedge_event();
+
+        SC_THREAD(run);
+        sensitive << clk.posedge_event();
+        async_reset_signal_is(rst, false);
+
+        SC_THREAD(collect);
+        sensitive << clk.posedge_event();
+        async_reset_signal_is(rst, false);
+    }
+
+    int Tiles() const { return ((g.K + Rows - 1) / Rows) * ((g.N + Cols - 1) / Cols); }
+
+    void reset() {
+        rst.write(false);
+        wait(10);
+        rst.write(true);
+    }
+
+    void run() {
+        w_in.ResetWrite();
+        act_in.ResetWrite();
+        wait(10);
+
+        first = sc_time_stamp();
+        int tile = 0;
+        for (int n0 = 0; n0 < g.N; n0 += Cols) {
+            for (int k0 = 0; k0 < g.K; k0 += Rows) {
+                // Weights, bottom row first, then Rows + 1 cycles for the last row to settle
+                typename DUT::W_Type w[Rows];
+                for (int row = Rows - 1; row >= 0; row--) {
+                    for (int j = 0; j < Cols; j++) {
+                        int k = k0 + row, c = n0 + j;
+                        w[row].X[j] = Sweep_W((k < g.K && c < g.N) ? g.B[k * g.N + c] : 0);
+                    }
+                    if (!npu_backdoor) w_in.Push(w[row]);
+                }
+                if (npu_backdoor) dut.PreloadWeights(w);
+                else              wait(Rows + 1);
+
+                // Skewed activations, row i of vector t is A[t - i][k0 + i]
+                for (int t = 0; t < g.M + Rows - 1; t++) {
+                    typename DUT::In_Type x;
+                    for (int i = 0; i < Rows; i++) {
+                        int m = t - i, k = k0 + i;
+                        x.X[i] = Sweep_A((m >= 0 && m < g.M && k < g.K) ? g.A[m * g.K + k] : 0);
+                    }
+                    x.swap = 0;
+                    x.last = false;
+                    act_in.Push(x);
+                }
+
+                tile++;
+                while (drained < tile) wait();
+            }
+        }
+    }
+
+    // Every act vector of a tile leaves one psum per column, the v-th of column j is row v - (Rows - 1)
+    void collect() {
+        psum_out.ResetRead();
+        wait(10);
+
+        for (int n0 = 0; n0 < g.N; n0 += Cols) {
+            for (int k0 = 0; k0 < g.K; k0 += Rows) {
+                int count[Cols];
+                for (int j = 0; j < Cols; j++) count[j] = 0;
+                int remaining = Cols * (g.M + Rows - 1);
+                while (remaining > 0) {
+                    typename DUT::Out_Type out = psum_out.Pop();
+                    for (int j = 0; j < Cols; j++) {
+                        if (!out.valid[j]) continue;
+                        int m = count[j]++ - (Rows - 1), c = n0 + j;
+                        if (m >= 0 && m < g.M && c < g.N) C[m * g.N + c] += out.X[j].to_int64();
+                        remaining--;
+                    }
+                }
+                drained++;
+            }
+        }
+        last = sc_time_stamp();
+
+        if (--npu_running == 0) sc_stop();
+    }
+
+    bool Report() const {
+        nrsim::ref::CompareResult r = nrsim::ref::Compare(C.data(), g.C.data(), long(g.M) * g.N);
+        int errors = r.errors;
+        if (!r.ok()) {
+            long i = r.first;
+            cout << "✗ (MISMATCH) " << name() << " C[" << i / g.N << "][" << i % g.N << "] = " << C[i]
+                 << ", expected " << g.C[i] << " (" << errors << " mismatches)" << endl;
+        }
+        double cycles = (last - first) / sc_time(1, SC_NS) + 1;
+        double macs = double(g.M) * g.K * g.N;
+        cout << ((errors == 0) ? "✓ " : "✗ (MISMATCH) ") << Rows << "x" << Cols << " array: " << Tiles()
+             << " tiles, " << cycles << " cycles, utilization " << macs / (double(Rows) * Cols * cycles) << endl;
+        return errors == 0;
+    }
+};
+
+int sc_main(int argc, char *argv[]) {
+    Gemm g;
+    g.M = (argc > 1) ? atoi(argv[1]) : 128;
+    g.K = (argc > 2) ? atoi(argv[2]) : 64;
+    g.N = (argc > 3) ? atoi(argv[3]) : 64;
+    npu_backdoor = (argc > 4 && std::string(argv[4]) == "backdoor");
+
+    std::mt19937 gen(1);
+    std::uniform_int_distribution<int> u(-8, 8);
+    g.A.resize(g.M * g.K);
+    g.B.resize(g.K * g.N);
+    for (auto &x : g.A) x = u(gen);
+    for (auto &x : g.B) x = u(gen);
+    g.C.resize(g.M * g.N);
+    nrsim::ref::Gemm(g.M, g.K, g.N, g.A.data(), g.B.data(), g.C.data());
+
+    cout << g.M << "x" << g.K << "x" << g.N << " GEMM" << endl;
+    Top<8, 8> a8x8("a8x8", g);
+    Top<16, 16> a16x16("a16x16", g);
+    Top<24, 24> a24x24("a24x24", g);    // CICERO
+    Top<32, 32> a32x32("a32x32", g);    // NEUREX
+    Top<16, 32> a16x32("a16x32", g);
+    Top<32, 16> a32x16("a32x16", g);
+    sc_start();
+
+    bool pass = a8x8.Report();
+    pass &= a16x16.Report();
+    pass &= a24x24.Report();
+    pass &= a32x32.Report();
+    pass &= a16x32.Report();
+    pass &= a32x16.Report();
+    cout << (pass ? "PASSED" : "FAILED") << endl;
+    return 0;
+}
@@ -0,0 +1,204 @@
+#ifndef NPU_PE_H
+#define NPU_PE_H
+
+#include "../include/NPUPackDef.h"
+#include <nvhls_int.h>
+#include <nvhls_connections.h>
+#include <ac_math/ac_sincos_cordic.h>
+#include <ac_std_float.h>
+
+/*
+  A systolic array PE, DATAFLOW (npu_dataflow) selects what stays in the PE
+  WType / AType / PType: weight, activation and psum element types (the accelerator's NPU_*_Elem_Type)
+  NPU_WS / NPU_IS: w_in shifts the stationary operand in, act_in streams through, psum_in + act*w flows down
+  NPU_OS:          w_in and act_in stream through, act*w is accumulated locally for OS_K cycles,
+                   the result is drained down the psum chain (own result first, then the ones from above),
+                   OS_K >= the array Rows (NPU passes it), the drain has to finish within it
+  NPU_WS / NPU_IS: flag_in (NPU_Flag_Type) rides with act_in and is forwarded to flag_out
+  WBUF (NPU_WS / NPU_IS): w_in shifts into a shadow register instead, the computing weight is replaced by it
+                   with the activation flagged NPU_FLAG_SWAP (the first element of the next tile), so the next
+                   tile loads while the current one streams
+  NPU_ZERO_SKIP:   a zero activation passes psum_in through without the multiply (counted in skipped)
+ */
+
+template <typename WType, typename AType, typename PType, int DATAFLOW, bool WBUF, int OS_K>
+class NPU_PE : public match::Module {
+    SC_HAS_PROCESS(NPU_PE);
+public:
+    // Input/Output ports
+    Connections::In<WType>   w_in;
+    Connections::In<AType>  act_in;
+    Connections::In<PType> psum_in;  // Partial sum input (from top
+    Connections::In<NPU_Flag_Type>     flag_in;  // travels with act_in
+  
+    Connections::Out<WType>   w_out;
+    Connections::Out<AType>  act_out;
+    Connections::Out<PType> psum_out; // Partial sum output (to bottom)
+    Connections::Out<NPU_Flag_Type>     flag_out;
+
+    // Constructor
+    NPU_PE(sc_module_name name) : match::Module(name),
+                                 w_in("w_in"),
+                                 act_in("act_in"),
+                                 psum_in("psum_in"),
+                                 flag_in("flag_in"),
+                                 w_out("w_out"),
+                                 act_out("act_out"),
+                                 psum_out("psum_out"),
+                                 flag_out("flag_out") {
+        SC_THREAD(run);
+        sensitive << clk.pos();
+        async_reset_signal_is(rst, false);
+    }
+
+    WType w_reg;           // Fixed weight for this PE
+    WType w_out_reg;
+    WType w_shadow;        // WBUF, weight of the next tile
+    AType act_reg;        // Current activation
+
+    // NPU_OS
+    PType acc;           // Output stationary accumulator
+    ac_int<nvhls::log2_ceil<OS_K>::val+1, false> k;  // products accumulated
+    PType res_reg;       // finished result waiting to drain
+    bool res_valid;
+    PType out_reg;       // value being pushed down
+    bool out_valid;
+
+    // Statistics
+    unsigned long macs;              // products computed
+    unsigned long skipped;           // NPU_ZERO_SKIP, zero activations passed through
+
+    #pragma hls_pipeline_init_interval 1
+    void run() {
+        // Reset all connections
+        w_in.Reset();
+        act_in.Reset();
+        psum_in.Reset();
+        flag_in.Reset();
+        w_out.Reset();
+        act_out.Reset();
+        psum_out.Reset();
+        flag_out.Reset();
+
+        // Initialize registers (NEUREX NPU_behavioral starts from the same state)
+        w_reg = WType(0);
+        w_out_reg = WType(0);
+        w_shadow = WType(0);
+        act_reg = AType(0);
+        acc = PType(0);
+        k = 0;
+        res_valid = false;
+        out_valid = false;
+        macs = 0;
+        skipped = 0;
+        wait(); // Wait for the first clock edge after reset
+
+        #pragma hls_pipeline_init_interval 1
+        while (1) {
+            wait();
+
+            if (DATAFLOW == NPU_OS) {
+                OutputStationary();
+                continue;
+            }
+
+            WType tmp_weight;
+            if (NRSIM_POPNB(w_in, tmp_weight)) {
+                if (WBUF) {
+                    w_out_reg = w_shadow;
+                    w_shadow = tmp_weight;
+                } else {
+                    w_out_reg = w_reg;
+                    w_reg = tmp_weight;
+                }
+                NRSIM_PUSHNB(w_out, w_out_reg);
+            }
+
+            // Handle activation streaming (left to right)
+            AType tmp_act;
+            if (NRSIM_POPNB(act_in, tmp_act)) {
+                act_reg = tmp_act;
+                NRSIM_PUSHNB(act_out, act_reg);
+
+                NPU_Flag_Type flag = 0;
+                NRSIM_POPNB(flag_in, flag);
+                NRSIM_PUSHNB(flag_out, flag);
+
+                // First activation of a new tile, switch to the preloaded weight
+                if (WBUF && (flag & NPU_FLAG_SWAP)) w_reg = w_shadow;
+                
+                // Get partial sum from above (or zero if not available)
+                PType psum = PType(0);
+                NRSIM_POPNB(psum_in, psum);
+                
+                // Compute new partial sum
+                PType new_psum;
+                if (NPU_ZERO_SKIP && act_reg == 0) {
+                    new_psum = psum;
+                    skipped++;
+                } else {
+                    new_psum = (act_reg * w_reg) + psum;
+                    macs++;
+                }
+                NRSIM_TOGGLE(psum, new_psum);
+                
+                // Send partial sum down
+                NRSIM_PUSHNB(psum_out, new_psum);
+            }
+        }
+    }
+
+    // Backdoor access for the testbench (C simulation only, no timing): the computing weight, after reset
+    void PreloadWeight(const WType &w) { w_reg = w; }
+
+    // One cycle of the NPU_OS PE
+    void OutputStationary() {
+        // Weights (top to bottom) and activations (left to right) pass through
+        WType tmp_weight;
+        bool w_valid = NRSIM_POPNB(w_in, tmp_weight);
+        if (w_valid) {
+            w_reg = tmp_weight;
+            NRSIM_PUSHNB(w_out, w_reg);
+        }
+        AType tmp_act;
+        bool act_valid = NRSIM_POPNB(act_in, tmp_act);
+        if (act_valid) {
+            act_reg = tmp_act;
+            NRSIM_PUSHNB(act_out, act_reg);
+        }
+
+        // The skewed streams meet here, accumulate
+        if (w_valid && act_valid) {
+            acc = PType(acc + act_reg * w_reg);
+            NRSIM_TOGGLE(acc, acc);
+            if (k == OS_K-1) {
+                res_reg = acc;
+                res_valid = true;
+                acc = PType(0);
+                k = 0;
+            } else {
+                k++;
+            }
+        }
+
+        // Drain: own result before the ones from above
+        if (out_valid && NRSIM_PUSHNB(psum_out, out_reg)) {
+            out_valid = false;
+        }
+        if (!out_valid) {
+            if (res_valid) {
+                out_reg = res_reg;
+                out_valid = true;
+                res_valid = false;
+            } else {
+                PType psum;
+                if (NRSIM_POPNB(psum_in, psum)) {
+                    out_reg = psum;
+                    out_valid = true;
+                }
+            }
+        }
+    }
+};
+
+#endif //NPU_PE_H
@@ -0,0 +1,71 @@
+#ifndef NPUPackDef_H
+#define NPUPackDef_H
+
+#include <boost/preprocessor/list/for_each.hpp>
+#include <ac_std_float.h>
+#include <systemc.h>
+#include <nvhls_module.h>
+#include <ac_float.h>
+#include <ac_fixed.h>
+#include <ac_int.h>
+#include <nvhls_marshaller.h>
+#include <nvhls_int.h>
+#include <nvhls_types.h>
+
+// Helpers from https://github.com/hlslibs/matchlib_toolkit/blob/main/include/auto_gen_fields.h#L425
+// Slightly modify for marshall, width only
+#include "auto_gen_fields.h"
+
+// Channel / thread stall instrumentation, JSON summary at the end of the simulation (C model only)
+// #define NRSIM_INSTRUMENT
+#include "nrsim_instrument.h"
+
+/*
+ * Shared systolic array library (common/NPU, common/NPU_PE), included by the accelerator PackDefs
+ * NPU<Rows, Cols, WType, AType, PType, DATAFLOW, WBUF>: Rows x Cols array, w_in carries Cols weights,
+ * act_in Rows activations, psum_out Cols psums. The accelerators fix their array in NPU/NPU.h
+ * (CICERO_NPU, NEUREX_NPU<DATAFLOW, WBUF>), common/NPU/testbench.cpp sweeps the shapes.
+ */
+
+// NPU dataflow (template parameter of NPU / NPU_PE / NPU_behavioral)
+// NPU_WS: weights stationary (loaded through w_in), activations stream in from the left, psums flow down
+// NPU_OS: outputs stationary, activations from the left and weights from the top stream in skewed,
+//         each PE accumulates OS_K products and then drains its result down the psum chain
+// NPU_IS: inputs stationary, the WS datapath with the operands swapped (the input tile is loaded
+//         through w_in, weight columns stream in through act_in)
+enum npu_dataflow {NPU_WS=0, NPU_OS=1, NPU_IS=2};
+#ifndef NPU_ZERO_SKIP
+#define NPU_ZERO_SKIP 0      // changeable, 1: NPU_WS / NPU_IS PEs skip the multiply of zero activations (ReLU sparsity)
+#endif
+
+// Per element sideband of the NPU_WS / NPU_IS activation rows (NPU_In_Vec swap / last)
+typedef ac_int<2, false> NPU_Flag_Type;
+enum npu_flag {NPU_FLAG_SWAP=1, NPU_FLAG_LAST=2};
+
+template <typename WType, int Cols>
+class NPU_W_Vec : public nvhls_message {
+public:
+    WType X[Cols];
+    AUTO_GEN_FIELD_METHODS((X))
+};
+
+template <typename AType, int Rows>
+class NPU_In_Vec : public nvhls_message {
+public:
+    AType X[Rows];
+    ac_int<Rows, false> swap;  // NPU WBUF: X[i] is the first element of a new tile, row i switches weights
+    bool last;                 // last vector of the stream (NPU_WS / NPU_IS), tags the last psum_out
+    AUTO_GEN_FIELD_METHODS((X, swap, last))
+};
+
+// Only sent when a column holds a result
+template <typename PType, int Cols>
+class NPU_Out_Vec : public nvhls_message {
+public:
+    PType X[Cols];
+    ac_int<Cols, false> valid;  // X[j] is a psum from the bottom row (not a bubble)
+    bool last;                  // carries the psum of the last column for the last act_in vector
+    AUTO_GEN_FIELD_METHODS((X, valid, last))
+};
+
+#endif //NPUPackDef_H
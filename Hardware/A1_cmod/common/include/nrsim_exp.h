@@ -0,0 +1,422 @@
+#ifndef NRSIM_EXP_H
+#define NRSIM_EXP_H
+
+/*
+ * exp / sigmoid implementations of the volume rendering units, selected at compile time (shared by the projects:
+ * #include "../../common/include/nrsim_exp.h")
+ *
+ * NrsimExp<IMPL, SEGMENTS> is a policy with
+ *   static void exp(const T_in &x, T_out &y);      y = e^x
+ *   static void sigmoid(const T_in &x, T_out &y);  y = 1 / (1 + e^-x)
+ * for ac_fixed and ac_std_float operands. IMPL:
+ *   NRSIM_EXP_AC_PWL  ac_math ac_exp_pwl / ac_sigmoid_pwl (fixed segmentation of the library)
+ *   NRSIM_EXP_CORDIC  ac_math ac_exp_cordic, sigmoid as the reciprocal (ac_reciprocal_pwl) of 1 + e^-x
+ *   NRSIM_EXP_PWL     SEGMENTS (4, 8, 16, 32) uniform minimax segments: exp as 2^i * PWL(2^f) after range
+ *                     reduction (x * log2(e) = i + f), sigmoid over |x| < NRSIM_SIGMOID_RANGE (odd symmetry)
+ *   NRSIM_EXP_LUT     SEGMENTS + 1 (16, 32, 64) table entries, linear interpolation between neighbours, no range
+ *                     reduction: exp over -NRSIM_EXP_RANGE < x <= 0 (1 above, 0 below), sigmoid as for PWL
+ * The projects pick theirs in the PackDef (VRU_EXP_IMPL / VRU_EXP_SEGMENTS, ...), the VRU testbenches report
+ * the error of every choice over the operating range (sim_VRU exp).
+ */
+
+#include <nvhls_int.h>
+#include <ac_fixed.h>
+#include <ac_std_float.h>
+#include <ac_math/ac_hcordic.h>
+#include <ac_math/ac_pow_pwl.h>
+#include <ac_math/ac_reciprocal_pwl.h>
+#include <ac_math/ac_sigmoid_pwl.h>
+
+#define NRSIM_EXP_AC_PWL 0
+#define NRSIM_EXP_CORDIC 1
+#define NRSIM_EXP_PWL    2
+#define NRSIM_EXP_LUT    3
+
+#define NRSIM_EXP_RANGE 8      // LUT exp domain (-8, 0], e^-8 = 3.4e-4 is below the VRU alpha / transmittance cutoffs
+#define NRSIM_SIGMOID_RANGE 8  // PWL / LUT sigmoid domain |x| < 8, sigmoid(8) = 0.99966
+
+namespace nrsim {
+
+typedef ac_fixed<24, 8, true, AC_TRN, AC_SAT> EXP_ARG_TYPE;    // argument of the nrsim PWL / LUT, |x| < 128
+typedef ac_fixed<40, 20, false, AC_TRN, AC_SAT> EXP_RES_TYPE;  // e^x before the conversion to T_out
+typedef ac_fixed<19, 3, false, AC_TRN, AC_SAT> EXP_MAG_TYPE;   // |x| < 8 of the LUT / sigmoid index
+typedef ac_fixed<18, 1, false, AC_TRN, AC_SAT> PWL_C0_TYPE;    // segment intercept
+typedef ac_fixed<16, 0, false, AC_TRN, AC_SAT> PWL_C1_TYPE;    // segment rise
+typedef ac_fixed<18, 1, false, AC_TRN, AC_SAT> LUT_TYPE;       // table entry
+
+// Operand conversion: ac_fixed arguments are used as they are, ac_std_float ones go through EXP_ARG_TYPE
+template <int W, int I, bool S, ac_q_mode Q, ac_o_mode O>
+inline const ac_fixed<W, I, S, Q, O> &ExpArg(const ac_fixed<W, I, S, Q, O> &x) { return x; }
+
+template <int W, int E>
+inline EXP_ARG_TYPE ExpArg(const ac_std_float<W, E> &x) {
+    return x.template convert_to_ac_fixed<24, 8, true, AC_TRN, AC_SAT>();
+}
+
+template <int W, int I, bool S, ac_q_mode Q, ac_o_mode O, int WR, int IR, bool SR, ac_q_mode QR, ac_o_mode OR>
+inline void ExpResult(const ac_fixed<W, I, S, Q, O> &r, ac_fixed<WR, IR, SR, QR, OR> &y) { y = r; }
+
+template <int W, int I, bool S, ac_q_mode Q, ac_o_mode O, int WR, int ER>
+inline void ExpResult(const ac_fixed<W, I, S, Q, O> &r, ac_std_float<WR, ER> &y) { y = ac_std_float<WR, ER>(r); }
+
+/*
+ * Segment / entry tables (generated: minimax intercepts per uniform segment, exact samples for the LUTs)
+ */
+// 2^f, f in [0, 1)
+template <int SEGMENTS> struct Exp2PwlTable;
+
+template <> struct Exp2PwlTable<4> {
+    static void Lookup(int k, PWL_C0_TYPE &c0, PWL_C1_TYPE &c1) {
+        static const PWL_C0_TYPE t0[4] = {
+            0.99795166, 1.18677122, 1.41131677, 1.67834795
+        };
+        static const PWL_C1_TYPE t1[4] = {
+            0.18920712, 0.22500645, 0.26757927, 0.31820717
+        };
+        c0 = t0[k];
+        c1 = t1[k];
+    }
+};
+
+template <> struct Exp2PwlTable<8> {
+    static void Lookup(int k, PWL_C0_TYPE &c0, PWL_C1_TYPE &c1) {
+        static const PWL_C0_TYPE t0[8] = {
+            0.99950993, 1.08997331, 1.18862432, 1.29620402, 1.4135205, 1.54145504, 1.68096864, 1.8331093
+        };
+        static const PWL_C1_TYPE t1[8] = {
+            0.09050773, 0.09869938, 0.10763244, 0.11737401, 0.12799726, 0.13958201, 0.15221526, 0.16599191
+        };
+        c0 = t0[k];
+        c1 = t1[k];
+    }
+};
+
+template <> struct Exp2PwlTable<16> {
+    static void Lookup(int k, PWL_C0_TYPE &c0, PWL_C1_TYPE &c1) {
+        static const PWL_C0_TYPE t0[16] = {
+            0.99988013, 1.0441486, 1.09037701, 1.13865212, 1.18906456, 1.24170895, 1.2966841, 1.35409321,
+            1.41404404, 1.47664911, 1.54202596, 1.61029728, 1.68159123, 1.75604163, 1.83378824, 1.91497698
+        };
+        static const PWL_C1_TYPE t1[16] = {
+            0.04427378, 0.04623395, 0.0482809, 0.05041848, 0.0526507, 0.05498174, 0.05741599, 0.05995802,
+            0.06261258, 0.06538468, 0.06827951, 0.0713025, 0.07445933, 0.07775593, 0.08119847, 0.08479344
+        };
+        c0 = t0[k];
+        c1 = t1[k];
+    }
+};
+
+template <> struct Exp2PwlTable<32> {
+    static void Lookup(int k, PWL_C0_TYPE &c0, PWL_C1_TYPE &c1) {
+        static const PWL_C0_TYPE t0[32] = {
+            0.99997036, 1.02186686, 1.04424283, 1.06710877, 1.09047541, 1.11435371, 1.13875488, 1.16369036,
+            1.18917186, 1.21521133, 1.241821, 1.26901334, 1.29680111, 1.32519736, 1.3542154, 1.38386886,
+            1.41417164, 1.44513797, 1.47678237, 1.50911969, 1.54216511, 1.57593413, 1.61044259, 1.64570669,
+            1.68174298, 1.71856835, 1.7562001, 1.79465587, 1.83395372, 1.87411208, 1.91514979, 1.95708611
+        };
+        static const PWL_C1_TYPE t1[32] = {
+            0.02189715, 0.02237663, 0.02286662, 0.02336733, 0.02387901, 0.02440189, 0.02493622, 0.02548226,
+            0.02604024, 0.02661045, 0.02719315, 0.0277886, 0.02839709, 0.0290189, 0.02965434, 0.03030368,
+            0.03096724, 0.03164534, 0.03233828, 0.0330464, 0.03377002, 0.03450949, 0.03526515, 0.03603735,
+            0.03682647, 0.03763286, 0.03845691, 0.03929901, 0.04015955, 0.04103893, 0.04193756, 0.04285588
+        };
+        c0 = t0[k];
+        c1 = t1[k];
+    }
+};
+
+// sigmoid(a), a in [0, NRSIM_SIGMOID_RANGE)
+template <int SEGMENTS> struct SigmoidPwlTable;
+
+template <> struct SigmoidPwlTable<4> {
+    static void Lookup(int k, PWL_C0_TYPE &c0, PWL_C1_TYPE &c1) {
+        static const PWL_C0_TYPE t0[4] = {
+            0.52043537, 0.89155574, 0.98382655, 0.99778038
+        };
+        static const PWL_C1_TYPE t1[4] = {
+            0.38079708, 0.10121671, 0.01551359, 0.00213727
+        };
+        c0 = t0[k];
+        c1 = t1[k];
+    }
+};
+
+template <> struct SigmoidPwlTable<8> {
+    static void Lookup(int k, PWL_C0_TYPE &c0, PWL_C1_TYPE &c1) {
+        static const PWL_C0_TYPE t0[8] = {
+            0.50353028, 0.73688283, 0.88453688, 0.95428002, 0.98269432, 0.99356515, 0.99762335, 0.9991244
+        };
+        static const PWL_C1_TYPE t1[8] = {
+            0.23105858, 0.1497385, 0.07177705, 0.02943966, 0.01129336, 0.00422023, 0.00156157, 0.0005757
+        };
+        c0 = t0[k];
+        c1 = t1[k];
+    }
+};
+
+template <> struct SigmoidPwlTable<16> {
+    static void Lookup(int k, PWL_C0_TYPE &c0, PWL_C1_TYPE &c1) {
+        static const PWL_C0_TYPE t0[16] = {
+            0.50048493, 0.62367075, 0.73255026, 0.81895827, 0.88188829, 0.92492027, 0.95309586, 0.97102417,
+            0.98222559, 0.98914447, 0.99338797, 0.99597929, 0.99755751, 0.99851715, 0.99910009, 0.99945399
+        };
+        static const PWL_C1_TYPE t1[16] = {
+            0.12245933, 0.10859925, 0.0865159, 0.0632226, 0.04334474, 0.02843231, 0.01811364, 0.01132602,
+            0.00699927, 0.00429409, 0.00262271, 0.00159751, 0.00097144, 0.00059013, 0.00035827, 0.00021743
+        };
+        c0 = t0[k];
+        c1 = t1[k];
+    }
+};
+
+template <> struct SigmoidPwlTable<32> {
+    static void Lookup(int k, PWL_C0_TYPE &c0, PWL_C1_TYPE &c1) {
+        static const PWL_C0_TYPE t0[32] = {
+            0.50006213, 0.56235128, 0.62272742, 0.67951195, 0.73142647, 0.77767467, 0.81793444, 0.85228324,
+            0.88108992, 0.90490297, 0.92435473, 0.94008986, 0.9527185, 0.96278994, 0.97078152, 0.97709738,
+            0.98207308, 0.98598321, 0.98904994, 0.99145149, 0.99332987, 0.99479766, 0.99594377, 0.99683818,
+            0.99753586, 0.99807989, 0.99850398, 0.99883452, 0.99909209, 0.99929278, 0.99944913, 0.99957093
+        };
+        static const PWL_C1_TYPE t1[32] = {
+            0.0621765, 0.06028283, 0.05671937, 0.05187988, 0.04624128, 0.04027462, 0.03437833, 0.02884428,
+            0.02385346, 0.01949128, 0.01577153, 0.01266078, 0.01009899, 0.00801466, 0.00633486, 0.00499116,
+            0.00392258, 0.00307668, 0.00240946, 0.00188463, 0.00147273, 0.00114999, 0.00089745, 0.00070006,
+            0.00054589, 0.00042555, 0.00033167, 0.00025846, 0.00020138, 0.00015689, 0.00012222, 0.00009521
+        };
+        c0 = t0[k];
+        c1 = t1[k];
+    }
+};
+
+// exp(-d), d = j * NRSIM_EXP_RANGE / ENTRIES
+template <int ENTRIES> struct ExpLutTable;
+
+template <> struct ExpLutTable<16> {
+    static void Lookup(int j, LUT_TYPE &v0, LUT_TYPE &v1) {
+        static const LUT_TYPE t[17] = {
+            1.0, 0.60653066, 0.36787944, 0.22313016, 0.13533528, 0.082085, 0.04978707, 0.03019738,
+            0.01831564, 0.011109, 0.00673795, 0.00408677, 0.00247875, 0.00150344, 0.00091188, 0.00055308,
+            0.00033546
+        };
+        v0 = t[j];
+        v1 = t[j+1];
+    }
+};
+
+template <> struct ExpLutTable<32> {
+    static void Lookup(int j, LUT_TYPE &v0, LUT_TYPE &v1) {
+        static const LUT_TYPE t[33] = {
+            1.0, 0.77880078, 0.60653066, 0.47236655, 0.36787944, 0.2865048, 0.22313016, 0.17377394,
+            0.13533528, 0.10539922, 0.082085, 0.06392786, 0.04978707, 0.03877421, 0.03019738, 0.02351775,
+            0.01831564, 0.01426423, 0.011109, 0.0086517, 0.00673795, 0.00524752, 0.00408677, 0.00318278,
+            0.00247875, 0.00193045, 0.00150344, 0.00117088, 0.00091188, 0.00071017, 0.00055308, 0.00043074,
+            0.00033546
+        };
+        v0 = t[j];
+        v1 = t[j+1];
+    }
+};
+
+template <> struct ExpLutTable<64> {
+    static void Lookup(int j, LUT_TYPE &v0, LUT_TYPE &v1) {
+        static const LUT_TYPE t[65] = {
+            1.0, 0.8824969, 0.77880078, 0.68728928, 0.60653066, 0.53526143, 0.47236655, 0.41686202,
+            0.36787944, 0.32465247, 0.2865048, 0.2528396, 0.22313016, 0.19691168, 0.17377394, 0.15335497,
+            0.13533528, 0.11943297, 0.10539922, 0.09301449, 0.082085, 0.07243976, 0.06392786, 0.05641614,
+            0.04978707, 0.04393693, 0.03877421, 0.03421812, 0.03019738, 0.0266491, 0.02351775, 0.02075434,
+            0.01831564, 0.01616349, 0.01426423, 0.01258814, 0.011109, 0.00980366, 0.0086517, 0.00763509,
+            0.00673795, 0.00594622, 0.00524752, 0.00463092, 0.00408677, 0.00360656, 0.00318278, 0.00280879,
+            0.00247875, 0.00218749, 0.00193045, 0.00170362, 0.00150344, 0.00132678, 0.00117088, 0.0010333,
+            0.00091188, 0.00080473, 0.00071017, 0.00062673, 0.00055308, 0.0004881, 0.00043074, 0.00038013,
+            0.00033546
+        };
+        v0 = t[j];
+        v1 = t[j+1];
+    }
+};
+
+// sigmoid(a), a = j * NRSIM_SIGMOID_RANGE / ENTRIES
+template <int ENTRIES> struct SigmoidLutTable;
+
+template <> struct SigmoidLutTable<16> {
+    static void Lookup(int j, LUT_TYPE &v0, LUT_TYPE &v1) {
+        static const LUT_TYPE t[17] = {
+            0.5, 0.62245933, 0.73105858, 0.81757448, 0.88079708, 0.92414182, 0.95257413, 0.97068777,
+            0.98201379, 0.98901306, 0.99330715, 0.99592986, 0.99752738, 0.99849882, 0.99908895, 0.99944722,
+            0.99966465
+        };
+        v0 = t[j];
+        v1 = t[j+1];
+    }
+};
+
+template <> struct SigmoidLutTable<32> {
+    static void Lookup(int j, LUT_TYPE &v0, LUT_TYPE &v1) {
+        static const LUT_TYPE t[33] = {
+            0.5, 0.5621765, 0.62245933, 0.6791787, 0.73105858, 0.77729986, 0.81757448, 0.8519528,
+            0.88079708, 0.90465054, 0.92414182, 0.93991335, 0.95257413, 0.96267311, 0.97068777, 0.97702263,
+            0.98201379, 0.98593637, 0.98901306, 0.99142251, 0.99330715, 0.99477987, 0.99592986, 0.99682732,
+            0.99752738, 0.99807327, 0.99849882, 0.99883049, 0.99908895, 0.99929033, 0.99944722, 0.99956944,
+            0.99966465
+        };
+        v0 = t[j];
+        v1 = t[j+1];
+    }
+};
+
+template <> struct SigmoidLutTable<64> {
+    static void Lookup(int j, LUT_TYPE &v0, LUT_TYPE &v1) {
+        static const LUT_TYPE t[65] = {
+            0.5, 0.53120937, 0.5621765, 0.5926666, 0.62245933, 0.65135486, 0.6791787, 0.70578503,
+            0.73105858, 0.75491499, 0.77729986, 0.79818678, 0.81757448, 0.83548354, 0.8519528, 0.86703576,
+            0.88079708, 0.89330941, 0.90465054, 0.91490095, 0.92414182, 0.93245331, 0.93991335, 0.94659667,
+            0.95257413, 0.95791227, 0.96267311, 0.96691402, 0.97068777, 0.97404264, 0.97702263, 0.97966765,
+            0.98201379, 0.98409361, 0.98593637, 0.98756835, 0.98901306, 0.99029152, 0.99142251, 0.99242276,
+            0.99330715, 0.99408893, 0.99477987, 0.99539043, 0.99592986, 0.9964064, 0.99682732, 0.99719907,
+            0.99752738, 0.99781728, 0.99807327, 0.99829928, 0.99849882, 0.99867498, 0.99883049, 0.99896777,
+            0.99908895, 0.99919591, 0.99929033, 0.99937367, 0.99944722, 0.99951214, 0.99956944, 0.99962002,
+            0.99966465
+        };
+        v0 = t[j];
+        v1 = t[j+1];
+    }
+};
+
+// Index of a in [0, 8): the top LOG2 bits select the segment / entry, the rest is the position u in [0, 1) within it
+template <int LOG2>
+inline void ExpSplit(const EXP_MAG_TYPE &a, int &k, ac_fixed<19 - LOG2, 0, false> &u) {
+    k = a.template slc<LOG2>(19 - LOG2).to_int();
+    u.set_slc(0, a.template slc<19 - LOG2>(0));
+}
+
+/*
+ * Policies
+ */
+struct ExpAcPwl {
+    template <class T_in, class T_out>
+    static void exp(const T_in &x, T_out &y) { ac_math::ac_exp_pwl(x, y); }
+
+    template <class T_in, class T_out>
+    static void sigmoid(const T_in &x, T_out &y) { ac_math::ac_sigmoid_pwl(x, y); }
+};
+
+struct ExpCordic {
+    template <class T_in, int WR, int IR, ac_q_mode QR, ac_o_mode OR>
+    static void exp(const T_in &x, ac_fixed<WR, IR, false, QR, OR> &y) { ac_math::ac_exp_cordic(ExpArg(x), y); }
+
+    template <class T_in, int WR, int ER>
+    static void exp(const T_in &x, ac_std_float<WR, ER> &y) {
+        EXP_RES_TYPE r;
+        ac_math::ac_exp_cordic(ExpArg(x), r);
+        ExpResult(r, y);
+    }
+
+    template <class T_in, class T_out>
+    static void sigmoid(const T_in &x, T_out &y) {
+        EXP_ARG_TYPE nx = -EXP_ARG_TYPE(ExpArg(x));
+        EXP_RES_TYPE e;
+        ac_math::ac_exp_cordic(nx, e);
+        ac_fixed<41, 21, false, AC_TRN, AC_SAT> den = e + 1;
+        LUT_TYPE r;
+        ac_math::ac_reciprocal_pwl(den, r);
+        ExpResult(r, y);
+    }
+};
+
+template <int SEGMENTS>
+struct ExpPwl {
+    static const int LOG2 = nvhls::log2_ceil<SEGMENTS>::val;
+
+    template <class T_in, class T_out>
+    static void exp(const T_in &x, T_out &y) {
+        static const ac_fixed<18, 1, false> LOG2E = 1.4426950408889634;
+        // x * log2(e) = i + f, 0 <= f < 1
+        ac_fixed<25, 9, true, AC_TRN, AC_SAT> t = EXP_ARG_TYPE(ExpArg(x)) * LOG2E;
+        ac_int<9, true> i = t.template slc<9>(16);
+        ac_fixed<16, 0, false> f;
+        f.set_slc(0, t.template slc<16>(0));
+
+        // 2^f on segment k, position u
+        int k = f.template slc<LOG2>(16 - LOG2).to_int();
+        ac_fixed<16 - LOG2, 0, false> u;
+        u.set_slc(0, f.template slc<16 - LOG2>(0));
+        PWL_C0_TYPE c0;
+        PWL_C1_TYPE c1;
+        Exp2PwlTable<SEGMENTS>::Lookup(k, c0, c1);
+        ac_fixed<19, 2, false> m = c0 + c1 * u;
+
+        // 2^i * m, saturated above and flushed to 0 below the EXP_RES_TYPE range
+        EXP_RES_TYPE r = 0;
+        if (i >= 19) {
+            r.template set_val<AC_VAL_MAX>();
+        } else if (i > -21) {
+            r = m;
+            r = r << i;
+        }
+        ExpResult(r, y);
+    }
+
+    template <class T_in, class T_out>
+    static void sigmoid(const T_in &x, T_out &y) {
+        EXP_ARG_TYPE xa = ExpArg(x);
+        bool neg = xa < 0;
+        EXP_MAG_TYPE a = neg ? EXP_ARG_TYPE(-xa) : xa;
+        int k;
+        ac_fixed<19 - LOG2, 0, false> u;
+        ExpSplit<LOG2>(a, k, u);
+        PWL_C0_TYPE c0;
+        PWL_C1_TYPE c1;
+        SigmoidPwlTable<SEGMENTS>::Lookup(k, c0, c1);
+        LUT_TYPE s = c0 + c1 * u;
+        if (xa >= NRSIM_SIGMOID_RANGE || xa <= -NRSIM_SIGMOID_RANGE) s = 1;
+        LUT_TYPE r = neg ? LUT_TYPE(LUT_TYPE(1) - s) : s;
+        ExpResult(r, y);
+    }
+};
+
+template <int ENTRIES>
+struct ExpLut {
+    static const int LOG2 = nvhls::log2_ceil<ENTRIES>::val;
+
+    template <class T_in, class T_out>
+    static void exp(const T_in &x, T_out &y) {
+        EXP_ARG_TYPE xa = ExpArg(x);
+        EXP_MAG_TYPE d = EXP_ARG_TYPE(-xa);
+        int j;
+        ac_fixed<19 - LOG2, 0, false> u;
+        ExpSplit<LOG2>(d, j, u);
+        LUT_TYPE v0, v1;
+        ExpLutTable<ENTRIES>::Lookup(j, v0, v1);
+        LUT_TYPE r = v0 - (v0 - v1) * u;  // e^-d falls from v0 to v1
+        if (xa >= 0) r = 1;
+        if (xa <= -NRSIM_EXP_RANGE) r = 0;
+        ExpResult(r, y);
+    }
+
+    template <class T_in, class T_out>
+    static void sigmoid(const T_in &x, T_out &y) {
+        EXP_ARG_TYPE xa = ExpArg(x);
+        bool neg = xa < 0;
+        EXP_MAG_TYPE a = neg ? EXP_ARG_TYPE(-xa) : xa;
+        int j;
+        ac_fixed<19 - LOG2, 0, false> u;
+        ExpSplit<LOG2>(a, j, u);
+        LUT_TYPE v0, v1;
+        SigmoidLutTable<ENTRIES>::Lookup(j, v0, v1);
+        LUT_TYPE s = v0 + (v1 - v0) * u;
+        if (xa >= NRSIM_SIGMOID_RANGE || xa <= -NRSIM_SIGMOID_RANGE) s = 1;
+        LUT_TYPE r = neg ? LUT_TYPE(LUT_TYPE(1) - s) : s;
+        ExpResult(r, y);
+    }
+};
+
+// Policy of an (IMPL, SEGMENTS) pair of compile flags
+template <int IMPL, int SEGMENTS> struct NrsimExp;
+template <int SEGMENTS> struct NrsimExp<NRSIM_EXP_AC_PWL, SEGMENTS> : public ExpAcPwl {};
+template <int SEGMENTS> struct NrsimExp<NRSIM_EXP_CORDIC, SEGMENTS> : public ExpCordic {};
+template <int SEGMENTS> struct NrsimExp<NRSIM_EXP_PWL, SEGMENTS> : public ExpPwl<SEGMENTS> {};
+template <int SEGMENTS> struct NrsimExp<NRSIM_EXP_LUT, SEGMENTS> : public ExpLut<SEGMENTS> {};
+
+} // namespace nrsim
+
+#endif //NRSIM_EXP_H
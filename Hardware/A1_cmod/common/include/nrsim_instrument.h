@@ -0,0 +1,718 @@
+#ifndef NRSIM_INSTRUMENT_H
+#define NRSIM_INSTRUMENT_H
+
+/*
+ * Opt-in channel / thread instrumentation for the C models (same file in every project include dir)
+ *
+ * Channel operations in the modules go through NRSIM_POPNB / NRSIM_PUSHNB / NRSIM_POP / NRSIM_PUSH.
+ * Without NRSIM_INSTRUMENT they are the plain Connections calls. With it (define in *PackDef.h or
+ * pass -DNRSIM_INSTRUMENT), every call is counted per named port / channel and per SC_THREAD:
+ *   channel: transfers, failed PushNB (stall), failed PopNB (empty), cycles blocked in Push / Pop
+ *   thread:  cycles with a transfer (valid), with a failed push or blocked call (stall), without
+ *            any channel activity (idle), from its first channel operation to the last one in the run
+ * The summary is written as JSON to $NRSIM_INSTRUMENT_JSON (default nrsim_instrument.json) when the
+ * simulation ends (after sc_stop, when sc_main returns).
+ *
+ * Switching activity for data-dependent power (NRSIM_ACTIVITY, independent of NRSIM_INSTRUMENT):
+ * every value pushed through NRSIM_PUSHNB / NRSIM_PUSH (module ports and internal channels) and every
+ * register a module marks with NRSIM_TOGGLE(reg, value) / NRSIM_TOGGLE_AT(reg, index, value) is
+ * tracked bit by bit, a value holds until the next update. Per bit: toggle count (TC) and time at 1 (T1).
+ * Written as SAIF (backward, per instance and net bit, the format power tools annotate from) to
+ * $NRSIM_ACTIVITY_SAIF (default nrsim_activity.saif) when the simulation ends, with a per-module
+ * toggle-rate summary on stdout. NRSIM_TOGGLE is a no-op without NRSIM_ACTIVITY and NRSIM_TRACE.
+ *
+ * Windowed waveform trace (NRSIM_TRACE, independent of the above): the same pushed values and NRSIM_TOGGLE
+ * registers as value changes (a port also gets a <port>_vld strobe for the cycle of each transfer), written
+ * only inside a cycle window and a module subtree, so one tile of a long run can be looked at. At run time:
+ *   NRSIM_TRACE_VCD      output, default nrsim_trace.vcd.gz (gzip-compressed VCD when it ends in .gz)
+ *   NRSIM_TRACE_SCOPE    comma-separated hierarchy prefixes to trace (e.g. tb.dut.vru), default everything
+ *   NRSIM_TRACE_TRIGGER  comma-separated stages name[:n], each armed by the one before, fires on the n-th
+ *                        (from 0, default 0) NRSIM_TRACE_EVENT(name) or transfer on port name (a hierarchical
+ *                        name or its last components), e.g. "tile:37,last_gaussian"; default: from cycle 0
+ *   NRSIM_TRACE_START    window start, cycles after the trigger (default 0)
+ *   NRSIM_TRACE_CYCLES   window length (default up to the end of the simulation)
+ * Outside the window a value costs one comparison. The window's nets are declared when it closes, the
+ * value changes stream to a temporary file meanwhile. NRSIM_TRACE_EVENT is a no-op without NRSIM_TRACE.
+ */
+
+#if defined(NRSIM_INSTRUMENT) || defined(NRSIM_ACTIVITY) || defined(NRSIM_TRACE)
+#include <systemc.h>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <string>
+
+#ifndef NRSIM_CLOCK_NS
+#define NRSIM_CLOCK_NS 1.0  // clock period of the testbenches
+#endif
+#endif
+
+#ifdef NRSIM_INSTRUMENT
+
+namespace nrsim {
+
+struct ChannelStats {
+    unsigned long transfers;
+    unsigned long push_stalls;      // failed PushNB
+    unsigned long pop_empty;        // failed PopNB
+    unsigned long blocked_cycles;   // cycles spent waiting inside Push / Pop
+    ChannelStats() : transfers(0), push_stalls(0), pop_empty(0), blocked_cycles(0) {}
+};
+
+struct ThreadStats {
+    unsigned long first_cycle, cur_cycle;
+    unsigned long valid, stall;
+    bool cur_valid, cur_stall;
+    ThreadStats() : first_cycle(0), cur_cycle(0), valid(0), stall(0), cur_valid(false), cur_stall(false) {}
+};
+
+class Registry {
+public:
+    static Registry &Get() {
+        static Registry r;
+        return r;
+    }
+
+    static unsigned long Cycle() {
+        return (unsigned long)(sc_core::sc_time_stamp() / sc_core::sc_time(NRSIM_CLOCK_NS, sc_core::SC_NS));
+    }
+
+    // ok: transfer done, otherwise a stall (push) or an empty channel (pop); blocked: cycles inside Push / Pop
+    void Record(const char *channel, bool push, bool ok, unsigned long blocked = 0) {
+        ChannelStats &c = channels[channel];
+        if (ok) c.transfers++;
+        else if (push) c.push_stalls++;
+        else c.pop_empty++;
+        c.blocked_cycles += blocked;
+
+        unsigned long now = Cycle();
+        if (now > last_cycle) last_cycle = now;
+        sc_core::sc_process_handle h = sc_core::sc_get_current_process_handle();
+        if (!h.valid()) return;
+        std::map<std::string, ThreadStats>::iterator it = threads.find(h.name());
+        if (it == threads.end()) {
+            it = threads.insert(std::make_pair(std::string(h.name()), ThreadStats())).first;
+            it->second.first_cycle = it->second.cur_cycle = now - blocked;
+        }
+        ThreadStats &t = it->second;
+        if (now != t.cur_cycle) {
+            Close(t);
+            t.cur_cycle = now;
+        }
+        t.stall += blocked;
+        if (ok) t.cur_valid = true;
+        if (push && !ok) t.cur_stall = true;
+    }
+
+    void Dump() {
+        if (dumped) return;
+        dumped = true;
+        const char *env = getenv("NRSIM_INSTRUMENT_JSON");
+        std::string path = env ? env : "nrsim_instrument.json";
+        std::ofstream os(path.c_str());
+        unsigned long end = last_cycle + 1;  // the kernel may be gone already, use the last activity
+
+        os << "{\n  \"clock_ns\": " << NRSIM_CLOCK_NS << ",\n  \"cycles\": " << end << ",\n  \"channels\": [";
+        bool first = true;
+        for (std::map<std::string, ChannelStats>::iterator it = channels.begin(); it != channels.end(); ++it) {
+            const ChannelStats &c = it->second;
+            os << (first ? "\n" : ",\n") << "    {\"name\": \"" << it->first << "\", \"transfers\": " << c.transfers
+               << ", \"push_stalls\": " << c.push_stalls << ", \"pop_empty\": " << c.pop_empty
+               << ", \"blocked_cycles\": " << c.blocked_cycles
+               << ", \"utilization\": " << (end ? double(c.transfers) / end : 0.0) << "}";
+            first = false;
+        }
+        os << "\n  ],\n  \"threads\": [";
+        first = true;
+        for (std::map<std::string, ThreadStats>::iterator it = threads.begin(); it != threads.end(); ++it) {
+            ThreadStats &t = it->second;
+            Close(t);
+            unsigned long total = (end > t.first_cycle) ? end - t.first_cycle : 0;
+            unsigned long busy = t.valid + t.stall;
+            os << (first ? "\n" : ",\n") << "    {\"name\": \"" << it->first << "\", \"cycles\": " << total
+               << ", \"valid\": " << t.valid << ", \"stall\": " << t.stall
+               << ", \"idle\": " << (total > busy ? total - busy : 0) << "}";
+            first = false;
+        }
+        os << "\n  ]\n}\n";
+        std::cout << "nrsim instrumentation: " << channels.size() << " channels, " << threads.size()
+                  << " threads -> " << path << std::endl;
+    }
+
+    ~Registry() { Dump(); }
+
+private:
+    Registry() : last_cycle(0), dumped(false) {}
+
+    static void Close(ThreadStats &t) {
+        if (t.cur_stall) t.stall++;
+        else if (t.cur_valid) t.valid++;
+        t.cur_valid = t.cur_stall = false;
+    }
+
+    std::map<std::string, ChannelStats> channels;
+    std::map<std::string, ThreadStats> threads;
+    unsigned long last_cycle;
+    bool dumped;
+};
+
+template <typename Port, typename Msg>
+bool PopNB(Port &port, Msg &msg) {
+    bool ok = port.PopNB(msg);
+    Registry::Get().Record(port.name(), false, ok);
+    return ok;
+}
+
+template <typename Port, typename Msg>
+bool PushNB(Port &port, const Msg &msg) {
+    bool ok = port.PushNB(msg);
+    Registry::Get().Record(port.name(), true, ok);
+    return ok;
+}
+
+template <typename Port>
+auto Pop(Port &port) -> decltype(port.Pop()) {
+    unsigned long start = Registry::Cycle();
+    decltype(port.Pop()) msg = port.Pop();
+    unsigned long cycles = Registry::Cycle() - start;
+    Registry::Get().Record(port.name(), false, true, cycles > 1 ? cycles - 1 : 0);
+    return msg;
+}
+
+template <typename Port, typename Msg>
+void Push(Port &port, const Msg &msg) {
+    unsigned long start = Registry::Cycle();
+    port.Push(msg);
+    unsigned long cycles = Registry::Cycle() - start;
+    Registry::Get().Record(port.name(), true, true, cycles > 1 ? cycles - 1 : 0);
+}
+
+} // namespace nrsim
+
+#define NRSIM_POPNB(port, msg) nrsim::PopNB(port, msg)
+#define NRSIM_PUSHNB_CALL(port, msg) nrsim::PushNB(port, msg)
+#define NRSIM_POP(port) nrsim::Pop(port)
+#define NRSIM_PUSH_CALL(port, msg) nrsim::Push(port, msg)
+
+#else
+
+#define NRSIM_POPNB(port, msg) (port).PopNB(msg)
+#define NRSIM_PUSHNB_CALL(port, msg) (port).PushNB(msg)
+#define NRSIM_POP(port) (port).Pop()
+#define NRSIM_PUSH_CALL(port, msg) (port).Push(msg)
+
+#endif
+
+#if defined(NRSIM_ACTIVITY) || defined(NRSIM_TRACE)
+
+#include <nvhls_marshaller.h>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace nrsim {
+
+// Bits of a recorded value: the marshalled message, plain integers (Combinational<int>) as they are
+template <typename T, bool = std::is_integral<T>::value>
+struct ValueBits {
+    static const int width = Wrapped<T>::width;
+    static sc_dt::sc_lv<width> Get(const T &v) { return TypeToBits(v); }
+};
+template <typename T>
+struct ValueBits<T, true> {
+    static const int width = 8 * sizeof(T);
+    static sc_dt::sc_lv<width> Get(const T &v) { return sc_dt::sc_lv<width>(sc_dt::sc_biguint<width>((unsigned long long)v)); }
+};
+
+} // namespace nrsim
+
+#endif
+
+#ifdef NRSIM_ACTIVITY
+
+namespace nrsim {
+
+// One tracked net: a register or the data of a port, bit b of the value at bit b
+struct SignalActivity {
+    std::string name;                     // hierarchical, instance path '.' net
+    int width;
+    std::vector<bool> value;              // current value
+    std::vector<unsigned long> toggles;   // TC
+    std::vector<unsigned long> high;      // cycles at 1 up to last_cycle (T1)
+    unsigned long updates, last_cycle;
+};
+
+class Activity {
+public:
+    static Activity &Get() {
+        static Activity a;
+        return a;
+    }
+
+    static unsigned long Cycle() {
+        return (unsigned long)(sc_core::sc_time_stamp() / sc_core::sc_time(NRSIM_CLOCK_NS, sc_core::SC_NS));
+    }
+
+    // owner: sc_object name (stable pointer), signal: NULL for a port (its own name), index: -1 for a scalar
+    template <typename T>
+    void Record(const char *owner, const char *signal, int index, const T &v) {
+        const int W = ValueBits<T>::width;
+        sc_dt::sc_lv<W> bits = ValueBits<T>::Get(v);
+        SignalActivity &s = Find(owner, signal, index, W);
+        unsigned long now = Cycle();
+        if (now > last_cycle) last_cycle = now;
+        unsigned long held = now - s.last_cycle;
+        for (int b = 0; b < W && b < s.width; b++) {
+            bool x = (bits[b] == sc_dt::SC_LOGIC_1);
+            if (s.value[b]) s.high[b] += held;
+            if (x != s.value[b]) {
+                s.toggles[b]++;
+                s.value[b] = x;
+            }
+        }
+        s.last_cycle = now;
+        s.updates++;
+    }
+
+    void Dump() {
+        if (dumped || signals.empty()) return;
+        dumped = true;
+        const char *env = getenv("NRSIM_ACTIVITY_SAIF");
+        std::string path = env ? env : "nrsim_activity.saif";
+        unsigned long end = last_cycle + 1;
+
+        // Instance tree, nets at their instance
+        Node root;
+        for (std::map<Key, SignalActivity>::iterator it = signals.begin(); it != signals.end(); ++it) {
+            SignalActivity &s = it->second;
+            for (int b = 0; b < s.width; b++) {  // hold the last value to the end
+                if (s.value[b]) s.high[b] += end - s.last_cycle;
+            }
+            s.last_cycle = end;
+            Node *n = &root;
+            std::string::size_type start = 0, dot;
+            while ((dot = s.name.find('.', start)) != std::string::npos) {
+                n = &n->children[s.name.substr(start, dot - start)];
+                start = dot + 1;
+            }
+            n->nets.push_back(std::make_pair(s.name.substr(start), &s));
+        }
+
+        std::ofstream os(path.c_str());
+        os << "(SAIFILE\n(SAIFVERSION \"2.0\")\n(DIRECTION \"backward\")\n(DESIGN )\n"
+           << "(PROGRAM_NAME \"nrsim\")\n(DIVIDER . )\n(TIMESCALE 1 ns)\n(DURATION " << end * NRSIM_CLOCK_NS << ")\n";
+        for (std::map<std::string, Node>::iterator it = root.children.begin(); it != root.children.end(); ++it) {
+            Write(os, it->first, it->second, end, 0);
+        }
+        os << ")\n";
+
+        // Per module summary: toggles per bit per cycle over its nets
+        std::cout << "nrsim activity: " << signals.size() << " nets over " << end << " cycles -> " << path << std::endl;
+        std::map<std::string, std::pair<double, double> > modules;  // toggles, bit-cycles
+        for (std::map<Key, SignalActivity>::iterator it = signals.begin(); it != signals.end(); ++it) {
+            const SignalActivity &s = it->second;
+            std::string module = s.name.substr(0, s.name.rfind('.'));
+            unsigned long tc = 0;
+            for (int b = 0; b < s.width; b++) tc += s.toggles[b];
+            modules[module].first += tc;
+            modules[module].second += double(s.width) * end;
+        }
+        for (std::map<std::string, std::pair<double, double> >::iterator it = modules.begin(); it != modules.end(); ++it) {
+            std::cout << "  " << it->first << ": toggle rate "
+                      << (it->second.second > 0 ? it->second.first / it->second.second : 0.0) << std::endl;
+        }
+    }
+
+    ~Activity() { Dump(); }
+
+private:
+    struct Key {
+        const char *owner, *signal;
+        int index;
+        bool operator<(const Key &o) const {
+            if (owner != o.owner) return owner < o.owner;
+            if (signal != o.signal) return signal < o.signal;
+            return index < o.index;
+        }
+    };
+    struct Node {
+        std::map<std::string, Node> children;
+        std::vector<std::pair<std::string, const SignalActivity *> > nets;
+    };
+
+    Activity() : last_cycle(0), dumped(false) {}
+
+    SignalActivity &Find(const char *owner, const char *signal, int index, int width) {
+        Key k = {owner, signal, index};
+        std::map<Key, SignalActivity>::iterator it = signals.find(k);
+        if (it != signals.end()) return it->second;
+        SignalActivity &s = signals[k];
+        s.name = owner;
+        if (signal) s.name += std::string(".") + signal;
+        if (index >= 0) s.name += "_" + std::to_string(index);
+        s.width = width;
+        s.value.assign(width, false);     // reset value 0
+        s.toggles.assign(width, 0);
+        s.high.assign(width, 0);
+        s.updates = 0;
+        s.last_cycle = 0;
+        return s;
+    }
+
+    static void Write(std::ostream &os, const std::string &name, const Node &n, unsigned long end, int depth) {
+        std::string ind(2 * depth, ' ');
+        os << ind << "(INSTANCE " << name << "\n";
+        if (!n.nets.empty()) {
+            os << ind << "  (NET\n";
+            for (size_t i = 0; i < n.nets.size(); i++) {
+                const SignalActivity &s = *n.nets[i].second;
+                for (int b = 0; b < s.width; b++) {
+                    double t1 = s.high[b] * NRSIM_CLOCK_NS, t0 = end * NRSIM_CLOCK_NS - t1;
+                    os << ind << "    (" << n.nets[i].first;
+                    if (s.width > 1) os << "\\[" << b << "\\]";
+                    os << " (T0 " << t0 << ") (T1 " << t1 << ") (TX 0) (TC " << s.toggles[b] << ") (IG 0))\n";
+                }
+            }
+            os << ind << "  )\n";
+        }
+        for (std::map<std::string, Node>::const_iterator it = n.children.begin(); it != n.children.end(); ++it) {
+            Write(os, it->first, it->second, end, depth + 1);
+        }
+        os << ind << ")\n";
+    }
+
+    std::map<Key, SignalActivity> signals;
+    unsigned long last_cycle;
+    bool dumped;
+};
+
+} // namespace nrsim
+
+#endif
+
+#ifdef NRSIM_TRACE
+
+#include <cstdio>
+#include <climits>
+
+namespace nrsim {
+
+class Trace {
+public:
+    static Trace &Get() {
+        static Trace t;
+        return t;
+    }
+
+    static unsigned long Cycle() {
+        return (unsigned long)(sc_core::sc_time_stamp() / sc_core::sc_time(NRSIM_CLOCK_NS, sc_core::SC_NS));
+    }
+
+    // owner / signal / index as for Activity::Record, a port (signal NULL) also pulses its _vld strobe
+    template <typename T>
+    void Record(const char *owner, const char *signal, int index, const T &v) {
+        if (signal == NULL) Trigger(owner, NULL);
+        if (!Window() || !InScope(owner)) return;
+        const int W = ValueBits<T>::width;
+        TraceSignal &s = Find(owner, signal, index, W);
+        Advance(Cycle());
+        std::string bits = ValueBits<T>::Get(v).to_string();
+        if (bits != s.value) {
+            s.value = bits;
+            Value(s.id, bits);
+        }
+        if (signal == NULL && !s.strobe) {
+            s.strobe = true;
+            raised.push_back(&s);
+            Value(s.vld_id, "1");
+        }
+    }
+
+    // NRSIM_TRACE_EVENT: a named point of a module or testbench the trigger can wait for
+    void Event(const char *owner, const char *event) { Trigger(owner, event); }
+
+    void Dump() {
+        if (done) return;
+        done = true;
+        if (!triggered) {
+            std::cout << "nrsim trace: trigger " << getenv("NRSIM_TRACE_TRIGGER") << " did not fire" << std::endl;
+            return;
+        }
+        if (!body || signals.empty()) return;
+        Advance(last_cycle + 1);  // drop the last strobes
+
+        const char *env = getenv("NRSIM_TRACE_VCD");
+        std::string path = env ? env : "nrsim_trace.vcd.gz";
+        bool gz = path.size() > 3 && path.compare(path.size() - 3, 3, ".gz") == 0;
+        FILE *os = gz ? popen(("gzip -c > '" + path + "'").c_str(), "w") : fopen(path.c_str(), "w");
+        if (!os) {
+            std::cout << "nrsim trace: cannot write " << path << std::endl;
+            return;
+        }
+
+        // Header: the nets of the window in their instance scopes, then the streamed value changes
+        Node root;
+        for (std::map<Key, TraceSignal>::iterator it = signals.begin(); it != signals.end(); ++it) {
+            const TraceSignal &t = it->second;
+            Node *n = &root;
+            std::string::size_type start = 0, dot;
+            while ((dot = t.name.find('.', start)) != std::string::npos) {
+                n = &n->children[t.name.substr(start, dot - start)];
+                start = dot + 1;
+            }
+            n->nets.push_back(std::make_pair(t.name.substr(start), &t));
+        }
+        fprintf(os, "$version nrsim $end\n$timescale 1 ps $end\n");
+        Write(os, "nrsim", root);
+        fprintf(os, "$enddefinitions $end\n");
+        rewind(body);
+        char buf[1 << 16];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), body)) > 0) fwrite(buf, 1, n, os);
+        fclose(body);
+        body = NULL;
+        if (gz) pclose(os);
+        else fclose(os);
+        std::cout << "nrsim trace: " << signals.size() << " nets, cycles " << begin << " to " << last_cycle
+                  << " -> " << path << std::endl;
+    }
+
+    ~Trace() { Dump(); }
+
+private:
+    struct Key {
+        const char *owner, *signal;
+        int index;
+        bool operator<(const Key &o) const {
+            if (owner != o.owner) return owner < o.owner;
+            if (signal != o.signal) return signal < o.signal;
+            return index < o.index;
+        }
+    };
+    struct TraceSignal {
+        std::string name, id, vld_id;  // hierarchical name, VCD identifiers of the value and a port's strobe
+        int width;
+        bool port, strobe;      // strobe: _vld raised this cycle
+        std::string value;      // last written, MSB first
+    };
+    struct Node {
+        std::map<std::string, Node> children;
+        std::vector<std::pair<std::string, const TraceSignal *> > nets;
+    };
+
+    Trace() : start(0), cycles(ULONG_MAX), stage(0), count(0), triggered(false), closed(false), done(false),
+              begin(0), end(ULONG_MAX), cur_cycle(0), last_cycle(0), written_cycle(0), time_written(false),
+              ids(0), body(NULL) {
+        const char *env;
+        if ((env = getenv("NRSIM_TRACE_SCOPE"))) Split(env, scopes);
+        if ((env = getenv("NRSIM_TRACE_START"))) start = strtoul(env, NULL, 0);
+        if ((env = getenv("NRSIM_TRACE_CYCLES"))) cycles = strtoul(env, NULL, 0);
+        if ((env = getenv("NRSIM_TRACE_TRIGGER"))) {
+            std::vector<std::string> list;
+            Split(env, list);
+            for (size_t i = 0; i < list.size(); i++) {
+                std::string::size_type colon = list[i].find(':');
+                unsigned long nth = (colon == std::string::npos) ? 0 : strtoul(list[i].c_str() + colon + 1, NULL, 0);
+                stages.push_back(std::make_pair(list[i].substr(0, colon), nth));
+            }
+        }
+        if (stages.empty()) Open(0);
+    }
+
+    static void Split(const char *list, std::vector<std::string> &out) {
+        std::string s(list);
+        std::string::size_type pos = 0, comma;
+        while ((comma = s.find(',', pos)) != std::string::npos) {
+            if (comma > pos) out.push_back(s.substr(pos, comma - pos));
+            pos = comma + 1;
+        }
+        if (pos < s.size()) out.push_back(s.substr(pos));
+    }
+
+    // name is the hierarchical name or ends with "." name
+    static bool Matches(const std::string &full, const std::string &name) {
+        if (full == name) return true;
+        return full.size() > name.size() && full[full.size() - name.size() - 1] == '.' &&
+               full.compare(full.size() - name.size(), name.size(), name) == 0;
+    }
+
+    // A transfer on port owner (event NULL) or NRSIM_TRACE_EVENT(event) of owner, matches cached per stage
+    void Trigger(const char *owner, const char *event) {
+        if (triggered || stage >= stages.size()) return;
+        std::pair<const char *, const char *> k(owner, event);
+        std::map<std::pair<const char *, const char *>, bool>::iterator it = matches.find(k);
+        if (it == matches.end()) {
+            std::string name = event ? std::string(owner) + "." + event : std::string(owner);
+            it = matches.insert(std::make_pair(k, Matches(name, stages[stage].first))).first;
+        }
+        if (!it->second || count++ < stages[stage].second) return;
+        count = 0;
+        matches.clear();
+        if (++stage == stages.size()) Open(Cycle());
+    }
+
+    void Open(unsigned long at) {
+        triggered = true;
+        begin = at + start;
+        end = (cycles == ULONG_MAX) ? ULONG_MAX : begin + cycles;
+    }
+
+    bool Window() {
+        if (!triggered || closed) return false;
+        unsigned long now = Cycle();
+        if (now < begin) return false;
+        if (now >= end) {
+            closed = true;
+            Dump();
+            return false;
+        }
+        return true;
+    }
+
+    bool InScope(const char *owner) {
+        if (scopes.empty()) return true;
+        std::map<const char *, bool>::iterator it = in_scope.find(owner);
+        if (it != in_scope.end()) return it->second;
+        bool in = false;
+        std::string o(owner);
+        for (size_t i = 0; i < scopes.size() && !in; i++) {
+            const std::string &p = scopes[i];
+            in = o.compare(0, p.size(), p) == 0 && (o.size() == p.size() || o[p.size()] == '.');
+        }
+        in_scope[owner] = in;
+        return in;
+    }
+
+    TraceSignal &Find(const char *owner, const char *signal, int index, int width) {
+        Key k = {owner, signal, index};
+        std::map<Key, TraceSignal>::iterator it = signals.find(k);
+        if (it != signals.end()) return it->second;
+        TraceSignal &s = signals[k];
+        s.name = owner;
+        if (signal) s.name += std::string(".") + signal;
+        if (index >= 0) s.name += "_" + std::to_string(index);
+        s.id = Id(ids++);
+        s.vld_id = Id(ids++);
+        s.width = width;
+        s.port = (signal == NULL);
+        s.strobe = false;
+        if (!body) body = tmpfile();
+        return s;
+    }
+
+    static std::string Id(unsigned long n) {  // printable VCD identifier
+        std::string id;
+        for (;; n /= 94) {
+            id += char('!' + n % 94);
+            if (n < 94) break;
+        }
+        return id;
+    }
+
+    // Value changes of a new cycle: the strobes of the previous one fall a cycle after they rose
+    void Advance(unsigned long now) {
+        if (time_written && now == cur_cycle) return;
+        if (!raised.empty()) {
+            if (now > cur_cycle + 1) Time(cur_cycle + 1);
+            else Time(now);
+            for (size_t i = 0; i < raised.size(); i++) {
+                raised[i]->strobe = false;
+                Value(raised[i]->vld_id, "0");
+            }
+            raised.clear();
+        }
+        Time(now);
+        cur_cycle = now;
+        if (now > last_cycle) last_cycle = now;
+    }
+
+    void Time(unsigned long cycle) {
+        if (time_written && cycle == written_cycle) return;
+        fprintf(body, "#%llu\n", (unsigned long long)(cycle * NRSIM_CLOCK_NS * 1000.0 + 0.5));
+        written_cycle = cycle;
+        time_written = true;
+    }
+
+    void Value(const std::string &id, const std::string &bits) {
+        if (bits.size() == 1) fprintf(body, "%s%s\n", bits.c_str(), id.c_str());
+        else fprintf(body, "b%s %s\n", bits.c_str(), id.c_str());
+    }
+
+    static void Write(FILE *os, const std::string &name, const Node &n) {
+        fprintf(os, "$scope module %s $end\n", name.c_str());
+        for (size_t i = 0; i < n.nets.size(); i++) {
+            const TraceSignal &t = *n.nets[i].second;
+            fprintf(os, "$var wire %d %s %s $end\n", t.width, t.id.c_str(), n.nets[i].first.c_str());
+            if (t.port) fprintf(os, "$var wire 1 %s %s_vld $end\n", t.vld_id.c_str(), n.nets[i].first.c_str());
+        }
+        for (std::map<std::string, Node>::const_iterator it = n.children.begin(); it != n.children.end(); ++it) {
+            Write(os, it->first, it->second);
+        }
+        fprintf(os, "$upscope $end\n");
+    }
+
+    std::vector<std::string> scopes;
+    std::map<const char *, bool> in_scope;
+    std::vector<std::pair<std::string, unsigned long> > stages;
+    std::map<std::pair<const char *, const char *>, bool> matches;
+    unsigned long start, cycles;
+    size_t stage;
+    unsigned long count;
+    bool triggered, closed, done;
+    unsigned long begin, end;           // window, cycles
+    unsigned long cur_cycle, last_cycle, written_cycle;
+    bool time_written;
+    unsigned long ids;
+    std::map<Key, TraceSignal> signals;
+    std::vector<TraceSignal *> raised;
+    FILE *body;
+};
+
+} // namespace nrsim
+
+#endif
+
+#if defined(NRSIM_ACTIVITY) || defined(NRSIM_TRACE)
+
+namespace nrsim {
+
+template <typename T>
+void Toggle(const char *owner, const char *signal, int index, const T &v) {
+#ifdef NRSIM_ACTIVITY
+    Activity::Get().Record(owner, signal, index, v);
+#endif
+#ifdef NRSIM_TRACE
+    Trace::Get().Record(owner, signal, index, v);
+#endif
+}
+
+// The data of a port counts when it is transferred
+template <typename T>
+bool ToggleIf(bool ok, const char *port, const T &v) {
+    if (ok) Toggle(port, NULL, -1, v);
+    return ok;
+}
+
+} // namespace nrsim
+
+#define NRSIM_PUSHNB(port, msg) nrsim::ToggleIf(NRSIM_PUSHNB_CALL(port, msg), (port).name(), msg)
+#define NRSIM_PUSH(port, msg) (NRSIM_PUSH_CALL(port, msg), nrsim::Toggle((port).name(), NULL, -1, msg))
+#define NRSIM_TOGGLE(reg, value) nrsim::Toggle(this->name(), #reg, -1, value)
+#define NRSIM_TOGGLE_AT(reg, index, value) nrsim::Toggle(this->name(), #reg, int(index), value)
+
+#else
+
+#define NRSIM_PUSHNB(port, msg) NRSIM_PUSHNB_CALL(port, msg)
+#define NRSIM_PUSH(port, msg) NRSIM_PUSH_CALL(port, msg)
+#define NRSIM_TOGGLE(reg, value) ((void)0)
+#define NRSIM_TOGGLE_AT(reg, index, value) ((void)0)
+
+#endif
+
+#ifdef NRSIM_TRACE
+#define NRSIM_TRACE_EVENT(event) nrsim::Trace::Get().Event(this->name(), #event)
+#else
+#define NRSIM_TRACE_EVENT(event) ((void)0)
+#endif
+
+#endif //NRSIM_INSTRUMENT_H
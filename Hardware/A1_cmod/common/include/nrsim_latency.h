@@ -0,0 +1,156 @@
+#ifndef NRSIM_LATENCY_H
+#define NRSIM_LATENCY_H
+
+/*
+ * Per-item latency distribution of a unit testbench (host code only, shared by the projects:
+ * #include "../../common/include/nrsim_latency.h")
+ *
+ * The testbench calls In(id, cycle) when the first input of an item (pixel, ray) enters the unit and Out(id, cycle,
+ * group) when the unit emits the output tagged with that id; the latency is the difference. Items are grouped
+ * (e.g. by tile) so the tail of every group is reported next to the overall p50 / p95 / p99:
+ *   GSCore VRU trace: pixel of the tile (VRU_OUT_TYPE::pixel), grouped by tile
+ *   ICARUS VRU:       ray (VRU_Out_Type::ray)
+ * Print() gives the summary on stdout, Write() the histogram as JSON to $NRSIM_LATENCY_JSON (default
+ * nrsim_latency_<unit>.json):
+ *   {"unit": "VRU", "item": "pixel", "clock_ns": 1, "group": "tile", "count": 65536, "mean": 181.2,
+ *    "p50": 170, "p95": 260, "p99": 301, "max": 344,
+ *    "histogram": [[128, 256, 40211], ...],          // [lo, hi) cycles, power-of-two bins
+ *    "groups": [{"group": 0, "count": 256, "p50": 150, "p99": 210, "max": 214}, ...]}
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#ifndef NRSIM_CLOCK_NS
+#define NRSIM_CLOCK_NS 1.0  // clock period of the testbenches
+#endif
+
+namespace nrsim {
+
+class LatencyHistogram {
+public:
+    LatencyHistogram(const std::string &unit, const std::string &item, const std::string &group = "tile")
+        : unit(unit), item(item), group_name(group), unmatched(0) {}
+
+    // First input of item id; later inputs of the same item (its other Gaussians / samples) are ignored
+    void In(uint64_t id, double cycle) { open.insert(std::make_pair(id, cycle)); }
+
+    // Output of item id, returns its latency (-1 without a matching In)
+    double Out(uint64_t id, double cycle, long group = -1) {
+        std::map<uint64_t, double>::iterator it = open.find(id);
+        if (it == open.end()) {
+            unmatched++;
+            return -1;
+        }
+        double lat = cycle - it->second;
+        open.erase(it);
+        all.push_back(lat);
+        if (group >= 0) groups[group].push_back(lat);
+        return lat;
+    }
+
+    size_t Count() const { return all.size(); }
+    unsigned long Unmatched() const { return unmatched + open.size(); }
+
+    // Nearest-rank percentile (0 < p <= 100) of v, reordered in place
+    static double Percentile(std::vector<double> &v, double p) {
+        if (v.empty()) return 0.0;
+        size_t k = size_t(p / 100.0 * v.size() + 0.999999);
+        k = std::min(std::max<size_t>(k, 1), v.size()) - 1;
+        std::nth_element(v.begin(), v.begin() + k, v.end());
+        return v[k];
+    }
+
+    void Print() {
+        std::vector<double> v(all);
+        PrintLine(v);
+        if (groups.empty()) return;
+        std::vector<double> tails;
+        long worst = -1;
+        double worst_p99 = -1;
+        for (std::map<long, std::vector<double> >::iterator it = groups.begin(); it != groups.end(); ++it) {
+            std::vector<double> g(it->second);
+            double p99 = Percentile(g, 99);
+            tails.push_back(p99);
+            if (p99 > worst_p99) {
+                worst_p99 = p99;
+                worst = it->first;
+            }
+        }
+        std::cout << "Per-" << group_name << " p99 (" << groups.size() << " " << group_name << "s): median "
+                  << Percentile(tails, 50) << ", p95 " << Percentile(tails, 95) << ", max " << worst_p99 << " ("
+                  << group_name << " " << worst << ")" << std::endl;
+    }
+
+    void Write() {
+        const char *env = getenv("NRSIM_LATENCY_JSON");
+        std::string path = env ? env : "nrsim_latency_" + unit + ".json";
+        std::ofstream os(path.c_str());
+        os.precision(10);
+        std::vector<double> v(all);
+        double sum = 0, mx = 0;
+        for (size_t i = 0; i < v.size(); i++) {
+            sum += v[i];
+            mx = std::max(mx, v[i]);
+        }
+        os << "{\n  \"unit\": \"" << unit << "\", \"item\": \"" << item << "\", \"clock_ns\": " << NRSIM_CLOCK_NS
+           << ", \"group\": \"" << group_name << "\", \"count\": " << v.size() << ", \"unmatched\": " << Unmatched()
+           << ", \"mean\": " << (v.empty() ? 0.0 : sum / v.size()) << ",\n  \"p50\": " << Percentile(v, 50)
+           << ", \"p95\": " << Percentile(v, 95) << ", \"p99\": " << Percentile(v, 99) << ", \"max\": " << mx
+           << ",\n  \"histogram\": [";
+        std::map<int, unsigned long> bins;  // bin b: [2^(b-1), 2^b), bin 0: [0, 1)
+        for (size_t i = 0; i < v.size(); i++) {
+            int b = 0;
+            while (b < 63 && v[i] >= double(1ull << b)) b++;
+            bins[b]++;
+        }
+        bool first = true;
+        for (std::map<int, unsigned long>::iterator it = bins.begin(); it != bins.end(); ++it) {
+            double lo = it->first ? double(1ull << (it->first - 1)) : 0.0;
+            os << (first ? "" : ", ") << "[" << lo << ", " << double(1ull << it->first) << ", " << it->second << "]";
+            first = false;
+        }
+        os << "],\n  \"groups\": [";
+        first = true;
+        for (std::map<long, std::vector<double> >::iterator it = groups.begin(); it != groups.end(); ++it) {
+            std::vector<double> g(it->second);
+            double gmax = *std::max_element(g.begin(), g.end());
+            os << (first ? "\n" : ",\n") << "    {\"group\": " << it->first << ", \"count\": " << g.size()
+               << ", \"p50\": " << Percentile(g, 50) << ", \"p99\": " << Percentile(g, 99) << ", \"max\": " << gmax
+               << "}";
+            first = false;
+        }
+        os << "\n  ]\n}\n";
+        std::cout << "Latency histogram -> " << path << std::endl;
+    }
+
+private:
+    void PrintLine(std::vector<double> &v) {
+        double sum = 0, mx = 0;
+        for (size_t i = 0; i < v.size(); i++) {
+            sum += v[i];
+            mx = std::max(mx, v[i]);
+        }
+        std::cout << item << " latency (cycles, " << v.size() << " " << item << "s): mean "
+                  << (v.empty() ? 0.0 : sum / v.size()) << ", p50 " << Percentile(v, 50) << ", p95 "
+                  << Percentile(v, 95) << ", p99 " << Percentile(v, 99) << ", max " << mx;
+        if (Unmatched()) std::cout << ", " << Unmatched() << " unmatched";
+        std::cout << std::endl;
+    }
+
+    std::string unit, item, group_name;
+    std::map<uint64_t, double> open;            // items with an input and no output yet
+    std::vector<double> all;
+    std::map<long, std::vector<double> > groups;
+    unsigned long unmatched;                    // outputs without an input
+};
+
+} // namespace nrsim
+
+#endif //NRSIM_LATENCY_H
@@ -0,0 +1,380 @@
+#ifndef NRSIM_REFERENCE_H
+#define NRSIM_REFERENCE_H
+
+/*
+ * Golden reference kernels for the testbenches (host code only, shared by the projects:
+ * #include "../../common/include/nrsim_reference.h")
+ *
+ * Batched float / integer models of the datapaths, structure of arrays and unit-stride inner loops so the
+ * compiler vectorizes them (the projects build without -O, the kernels are compiled at O3 through the
+ * pragma below, check with -fopt-info-vec); exp / sigmoid / sin / cos are polynomial versions that
+ * vectorize, not libm calls (error ~1e-7, far below the tolerance of any FP16 / fixed-point datapath).
+ *   Gemm / WrapSigned:        NPU (psums wrap to the PType width, wrapping once at the end is the same)
+ *   ReduceTrilinear:          CICERO reducer, sum of the 8 weight x feature products per channel
+ *   HashGridLevel / HashGridInterp: NEUREX IGU corner addresses / trilinear weights, ICU feature lookup
+ *   BlendTile:                GSCore VRU, alpha blending of a depth-sorted Gaussian list over the pixels of a tile
+ *   Encode / Dense / Composite: ICARUS PEU (A*x, sin / cos), MLP layer, VRU volume rendering
+ * Compare checks hardware outputs against a reference with |hw - ref| <= abs_tol + rel_tol * |ref|.
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC push_options
+#pragma GCC optimize("O3", "tree-vectorize", "no-trapping-math")  // selects of the clamps stay if-converted
+#define NRSIM_REF_VECTOR _Pragma("GCC ivdep")
+#define NRSIM_REF_INLINE inline __attribute__((always_inline))
+#elif defined(__clang__)
+#define NRSIM_REF_VECTOR _Pragma("clang loop vectorize(enable)")
+#define NRSIM_REF_INLINE inline __attribute__((always_inline))
+#else
+#define NRSIM_REF_VECTOR
+#define NRSIM_REF_INLINE inline
+#endif
+
+namespace nrsim {
+namespace ref {
+
+/*** Vectorizable elementary functions ***/
+
+// exp(x), Cody-Waite reduction to [-ln2/2, ln2/2] and a degree 6 polynomial, 2^n built in the exponent bits
+NRSIM_REF_INLINE float Exp(float x) {
+    x = (x < -87.0f) ? -87.0f : ((x > 88.0f) ? 88.0f : x);
+    float t = x * 1.44269504f;
+    int n = int(t + ((t < 0.0f) ? -0.5f : 0.5f));
+    float fn = float(n);
+    float r = x - fn * 0.693359375f + fn * 2.12194440e-4f;
+    float p = 1.9875691500e-4f;
+    p = p * r + 1.3981999507e-3f;
+    p = p * r + 8.3334519073e-3f;
+    p = p * r + 4.1665795894e-2f;
+    p = p * r + 1.6666665459e-1f;
+    p = p * r + 5.0000001201e-1f;
+    float y = p * r * r + r + 1.0f;
+    int32_t bits = (n + 127) << 23;
+    float scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+    return y * scale;
+}
+
+NRSIM_REF_INLINE float Sigmoid(float x) { return 1.0f / (1.0f + Exp(-x)); }
+
+// sin(x) and cos(x), reduction by pi/2 (3-part constant), minimax polynomials on [-pi/4, pi/4]
+NRSIM_REF_INLINE void SinCos(float x, float &s, float &c) {
+    float t = x * 0.636619772f;
+    int q = int(t + ((t < 0.0f) ? -0.5f : 0.5f));
+    float fq = float(q);
+    float r = ((x - fq * 1.5703125f) - fq * 4.83751296997e-4f) - fq * 7.54978995489e-8f;
+    float r2 = r * r;
+    float ps = r + r * r2 * (-1.6666654611e-1f + r2 * (8.3321608736e-3f + r2 * -1.9515295891e-4f));
+    float pc = 1.0f - 0.5f * r2 + r2 * r2 * (4.166664568298827e-2f + r2 * (-1.388731625493765e-3f
+             + r2 * 2.443315711809948e-5f));
+    int k = q & 3;
+    float ss = (k & 1) ? pc : ps;
+    float cc = (k & 1) ? ps : pc;
+    s = (k & 2) ? -ss : ss;
+    c = ((k + 1) & 2) ? -cc : cc;
+}
+
+/*** Comparison ***/
+
+struct CompareResult {
+    long n;          // elements compared
+    long errors;     // elements outside the tolerance
+    long first;      // index of the first one (-1: none)
+    long worst;      // index of the largest absolute error
+    double max_err;  // largest absolute error
+    bool ok() const { return errors == 0; }
+};
+
+// hw[i] vs ref[i], i < n: |hw - ref| <= abs_tol + rel_tol * |ref| (0, 0: exact), a NaN is a mismatch.
+// Blocks of LANES elements with per-lane error counts / maxima, which vectorize (a plain max reduction
+// only does with -ffinite-math-only, which would drop the NaN check).
+template <typename H, typename R>
+inline CompareResult Compare(const H *hw, const R *ref, long n, double abs_tol = 0.0, double rel_tol = 0.0) {
+    const int LANES = 8;
+    double lane_err[LANES], lane_max[LANES];
+    for (int j = 0; j < LANES; j++) lane_err[j] = lane_max[j] = 0.0;
+    long i = 0;
+    for (; i + LANES <= n; i += LANES) {
+        for (int j = 0; j < LANES; j++) {
+            double r = double(ref[i + j]), e = std::fabs(double(hw[i + j]) - r);
+            lane_err[j] += (e <= abs_tol + rel_tol * std::fabs(r)) ? 0.0 : 1.0;
+            lane_max[j] = (e > lane_max[j] || e != e) ? e : lane_max[j];
+        }
+    }
+    double errors = 0.0, max_err = 0.0;
+    for (; i < n; i++) {
+        double r = double(ref[i]), e = std::fabs(double(hw[i]) - r);
+        errors += (e <= abs_tol + rel_tol * std::fabs(r)) ? 0.0 : 1.0;
+        max_err = (e > max_err || e != e) ? e : max_err;
+    }
+    for (int j = 0; j < LANES; j++) {
+        errors += lane_err[j];
+        max_err = (lane_max[j] > max_err || lane_max[j] != lane_max[j]) ? lane_max[j] : max_err;
+    }
+
+    CompareResult res;
+    res.n = n;
+    res.errors = long(errors);
+    res.first = -1;
+    res.worst = -1;
+    res.max_err = max_err;
+    // Scalar pass for the indices only, up to the worst element and the first mismatch
+    for (i = 0; i < n && (res.worst < 0 || (res.errors > 0 && res.first < 0)); i++) {
+        double r = double(ref[i]), e = std::fabs(double(hw[i]) - r);
+        if (res.worst < 0 && (e == max_err || (e != e && max_err != max_err))) res.worst = i;
+        if (res.first < 0 && !(e <= abs_tol + rel_tol * std::fabs(r))) res.first = i;
+    }
+    return res;
+}
+
+// One result line in the testbench style, "✓ what: ..." or "✗ (MISMATCH) what: ..."
+inline void Report(std::ostream &os, const char *what, const CompareResult &r) {
+    os << (r.ok() ? "✓ " : "✗ (MISMATCH) ") << what << ": " << r.n - r.errors << " of " << r.n
+       << " within tolerance, max error " << r.max_err;
+    if (r.worst >= 0) os << " at " << r.worst;
+    if (!r.ok()) os << ", first mismatch at " << r.first;
+    os << std::endl;
+}
+
+/*** NPU ***/
+
+// C[M][N] = A[M][K] * B[K][N], row major; i-k-j order, the inner loop runs over a row of B and C
+template <typename T, typename Acc>
+inline void Gemm(int M, int K, int N, const T *__restrict__ A, const T *__restrict__ B, Acc *__restrict__ C) {
+    for (int i = 0; i < M * N; i++) C[i] = Acc(0);
+    for (int m = 0; m < M; m++) {
+        Acc *__restrict__ c = C + long(m) * N;
+        for (int k = 0; k < K; k++) {
+            Acc a = Acc(A[long(m) * K + k]);
+            const T *__restrict__ b = B + long(k) * N;
+            NRSIM_REF_VECTOR
+            for (int n = 0; n < N; n++) c[n] += a * Acc(b[n]);
+        }
+    }
+}
+
+// Two's complement wrap to bits (ac_int<bits, true> accumulation)
+template <typename T>
+inline void WrapSigned(T *x, long n, int bits) {
+    const int sh = 64 - bits;
+    NRSIM_REF_VECTOR
+    for (long i = 0; i < n; i++) x[i] = T(int64_t(uint64_t(int64_t(x[i])) << sh) >> sh);
+}
+
+/*** CICERO reducer ***/
+
+// out[s][ch] = sum_v w[s][v] * f[s][v][ch], v < 8 voxel vertices, exact in 64 bits
+template <typename W, typename F>
+inline void ReduceTrilinear(long S, int C, const W *__restrict__ w, const F *__restrict__ f,
+                            uint64_t *__restrict__ out) {
+    for (long s = 0; s < S; s++) {
+        uint64_t *__restrict__ o = out + s * C;
+        for (int ch = 0; ch < C; ch++) o[ch] = 0;
+        for (int v = 0; v < 8; v++) {
+            uint64_t wv = uint64_t(w[s * 8 + v]);
+            const F *__restrict__ fv = f + (s * 8 + v) * C;
+            NRSIM_REF_VECTOR
+            for (int ch = 0; ch < C; ch++) o[ch] += wv * uint64_t(fv[ch]);
+        }
+    }
+}
+
+/*** NEUREX hash grid ***/
+
+// One level of the multiresolution hash encoding for S positions pos[s][3] in [0, 1): corner c (bit 2-i set:
+// upper corner along axis i) at addr[s][c] = (x * 1) ^ (y * p1) ^ (z * p2) & mask, its trilinear weight at w[s][c]
+// (product over x, y, z in that order, as IGU::Encode)
+inline void HashGridLevel(long S, const float *__restrict__ pos, float res, uint32_t mask,
+                          uint32_t *__restrict__ addr, float *__restrict__ w,
+                          uint32_t p1 = 2654435761u, uint32_t p2 = 805459861u) {
+    NRSIM_REF_VECTOR
+    for (long s = 0; s < S; s++) {
+        uint32_t lo[3];
+        float fr[3];
+        for (int i = 0; i < 3; i++) {
+            float scaled = pos[s * 3 + i] * res;
+            int l = int(scaled);
+            lo[i] = uint32_t(l);
+            fr[i] = scaled - float(l);
+        }
+        for (int c = 0; c < 8; c++) {
+            int bx = (c >> 2) & 1, by = (c >> 1) & 1, bz = c & 1;
+            float wc = 1.0f;
+            wc = wc * (bx ? fr[0] : 1.0f - fr[0]);
+            wc = wc * (by ? fr[1] : 1.0f - fr[1]);
+            wc = wc * (bz ? fr[2] : 1.0f - fr[2]);
+            uint32_t h = (lo[0] + bx) ^ ((lo[1] + by) * p1) ^ ((lo[2] + bz) * p2);
+            addr[s * 8 + c] = h & mask;
+            w[s * 8 + c] = wc;
+        }
+    }
+}
+
+// out[s][f] = sum_c w[s][c] * table[addr[s][c]][f], F features per table entry
+inline void HashGridInterp(long S, int F, const uint32_t *__restrict__ addr, const float *__restrict__ w,
+                           const float *__restrict__ table, float *__restrict__ out) {
+    for (long s = 0; s < S; s++) {
+        float *__restrict__ o = out + s * F;
+        for (int f = 0; f < F; f++) o[f] = 0.0f;
+        for (int c = 0; c < 8; c++) {
+            float wc = w[s * 8 + c];
+            const float *__restrict__ e = table + long(addr[s * 8 + c]) * F;
+            NRSIM_REF_VECTOR
+            for (int f = 0; f < F; f++) o[f] += wc * e[f];
+        }
+    }
+}
+
+/*** GSCore VRU ***/
+
+// Depth-sorted Gaussians of one tile, tile-relative pixel coordinates
+struct Splats {
+    long n;
+    const float *mean_x, *mean_y;
+    const float *conx, *cony, *conz;  // inverse 2D covariance
+    const float *r, *g, *b, *opacity;
+};
+
+/*
+ * Front-to-back blending of s over P pixels at (px[p], py[p]), as the VRU pipeline:
+ *   alpha = opacity * exp(-0.5 * d^T Con d), dropped below alpha_min, C += T * alpha * c, T *= 1 - alpha
+ *   a pixel saturates once T < t_min and takes no further Gaussians
+ * rgb is planar, rgb[0..P) red, [P..2P) green, [2P..3P) blue; T (may be NULL) the final transmittance.
+ * Gaussian by Gaussian, the pixel loop is the vector loop; scratch holds 2 * P floats (NULL: allocated).
+ */
+inline void BlendTile(int P, const float *__restrict__ px, const float *__restrict__ py, const Splats &s,
+                      float alpha_min, float t_min, float *__restrict__ rgb, float *__restrict__ T = NULL,
+                      float *scratch = NULL) {
+    float *buf = scratch ? scratch : new float[2 * P];
+    float *__restrict__ t = buf;
+    float *__restrict__ live = buf + P;   // 1: not saturated
+    float *__restrict__ cr = rgb, *__restrict__ cg = rgb + P, *__restrict__ cb = rgb + 2 * P;
+    for (int p = 0; p < P; p++) {
+        t[p] = 1.0f;
+        live[p] = 1.0f;
+        cr[p] = cg[p] = cb[p] = 0.0f;
+    }
+    for (long i = 0; i < s.n; i++) {
+        const float mx = s.mean_x[i], my = s.mean_y[i];
+        const float a = s.conx[i], bxy = s.cony[i], c = s.conz[i], o = s.opacity[i];
+        const float r = s.r[i], g = s.g[i], b = s.b[i];
+        NRSIM_REF_VECTOR
+        for (int p = 0; p < P; p++) {
+            float dx = px[p] - mx, dy = py[p] - my;
+            float e = -0.5f * (dx * (a * dx + bxy * dy) + dy * (bxy * dx + c * dy));
+            float alpha = o * Exp(e);
+            float issued = alpha * live[p];
+            alpha = (alpha >= alpha_min) ? issued : 0.0f;
+            float ta = t[p] * alpha;
+            cr[p] += ta * r;
+            cg[p] += ta * g;
+            cb[p] += ta * b;
+            float tn = t[p] - ta;
+            t[p] = tn;
+            live[p] = (tn < t_min) ? 0.0f : live[p];
+        }
+    }
+    if (T) {
+        for (int p = 0; p < P; p++) T[p] = t[p];
+    }
+    if (!scratch) delete[] buf;
+}
+
+/*** ICARUS ***/
+
+// PEU: a[s][e] = sum_k A[e][k] * x[s][k], enc[s][2e] = sin(a), enc[s][2e+1] = cos(a) (E frequencies, 3D x)
+inline void Encode(long S, int E, const float *__restrict__ x, const float *__restrict__ A,
+                   float *__restrict__ enc) {
+    for (long s = 0; s < S; s++) {
+        const float x0 = x[s * 3], x1 = x[s * 3 + 1], x2 = x[s * 3 + 2];
+        float *__restrict__ o = enc + s * 2 * E;
+        NRSIM_REF_VECTOR
+        for (int e = 0; e < E; e++) {
+            float a = A[e * 3] * x0 + A[e * 3 + 1] * x1 + A[e * 3 + 2] * x2;
+            float sn, cs;
+            SinCos(a, sn, cs);
+            o[2 * e] = sn;
+            o[2 * e + 1] = cs;
+        }
+    }
+}
+
+// MLP layer: out[s][o] = bias[o] + sum_i in[s][i] * Wt[i][o] (weights transposed, [I][O]), optional ReLU
+inline void Dense(long S, int I, int O, const float *__restrict__ in, const float *__restrict__ Wt,
+                  const float *__restrict__ bias, bool relu, float *__restrict__ out) {
+    for (long s = 0; s < S; s++) {
+        float *__restrict__ o = out + s * O;
+        NRSIM_REF_VECTOR
+        for (int j = 0; j < O; j++) o[j] = bias ? bias[j] : 0.0f;
+        for (int i = 0; i < I; i++) {
+            float v = in[s * I + i];
+            const float *__restrict__ w = Wt + long(i) * O;
+            NRSIM_REF_VECTOR
+            for (int j = 0; j < O; j++) o[j] += v * w[j];
+        }
+        if (relu) {
+            NRSIM_REF_VECTOR
+            for (int j = 0; j < O; j++) o[j] = (o[j] > 0.0f) ? o[j] : 0.0f;
+        }
+    }
+}
+
+/*
+ * VRU volume rendering of S samples out[s] = (r, g, b, sigma) in ray order, last[s] != 0 closes a ray:
+ *   T_{i+1} = T_i * exp(-sigma_i * delta_i), C += sigmoid(c_i) * (T_i - T_{i+1})
+ * a ray stops accumulating once T <= t_min (t_min < 0: no early termination). color[ray][3], returns the rays.
+ * The exp / sigmoid of every sample are computed in one vector pass, then the scan over T; scratch holds
+ * 4 * S floats (NULL: allocated).
+ */
+inline long Composite(long S, const float *__restrict__ out, const float *__restrict__ delta,
+                      const unsigned char *__restrict__ last, float t_min, float *__restrict__ color,
+                      float *scratch = NULL) {
+    float *buf = scratch ? scratch : new float[4 * S];
+    float *__restrict__ att = buf;   // exp(-sigma * delta)
+    float *__restrict__ sig = buf + S;
+    NRSIM_REF_VECTOR
+    for (long s = 0; s < S; s++) {
+        float sigma = out[s * 4 + 3];
+        sigma = (sigma > 0.0f) ? sigma : 0.0f;
+        att[s] = Exp(-sigma * delta[s]);
+        sig[3 * s] = Sigmoid(out[s * 4]);
+        sig[3 * s + 1] = Sigmoid(out[s * 4 + 1]);
+        sig[3 * s + 2] = Sigmoid(out[s * 4 + 2]);
+    }
+    long rays = 0;
+    float T = 1.0f, c[3] = {0.0f, 0.0f, 0.0f};
+    bool done = false;
+    for (long s = 0; s < S; s++) {
+        if (!done) {
+            float Tn = T * att[s];
+            for (int i = 0; i < 3; i++) c[i] += sig[3 * s + i] * (T - Tn);
+            T = Tn;
+            done = (T <= t_min) && !last[s];
+        }
+        if (last[s]) {
+            for (int i = 0; i < 3; i++) color[rays * 3 + i] = c[i];
+            rays++;
+            T = 1.0f;
+            c[0] = c[1] = c[2] = 0.0f;
+            done = false;
+        }
+    }
+    if (!scratch) delete[] buf;
+    return rays;
+}
+
+} // namespace ref
+} // namespace nrsim
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC pop_options
+#endif
+#undef NRSIM_REF_VECTOR
+#undef NRSIM_REF_INLINE
+
+#endif // NRSIM_REFERENCE_H
@@ -0,0 +1,165 @@
+#ifndef NRSIM_STIMULUS_H
+#define NRSIM_STIMULUS_H
+
+/*
+ * Operator-boundary tensors captured from an instrumented rendering run, as testbench stimulus (host code only,
+ * shared by the projects: #include "../../common/include/nrsim_stimulus.h")
+ *
+ * Written by Instrumentation/instrumentation/stimulus.py (ns-eval --stimulus-output, "tensors_to_export" of the
+ * trace config). Stimulus file (.nrst), little endian:
+ *   NRStimHeader
+ *   { NRStimRecord, count x float32 (row major) } per captured tensor, in capture order
+ * A tensor name repeats once per call of its operator (call = 0, 1, ...). The names read by the testbenches:
+ *   igu_positions [n, 3]            NEUREX IGU, normalized positions at the HashEncoding input
+ *   icu_weights [n, 8], icu_features [n, 8, F]   NEUREX ICU, corner weights / features of one level per row
+ *   ray_positions [rays, samples, 3]  ICARUS PEU, sample positions along the rays (Frustums.get_positions)
+ * The splatfacto gs_* tensors are binned into a GSCore trace by GSCore/trace/gs_trace.py stim.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define NRSTIM_VERSION 1
+
+namespace nrsim {
+
+struct NRStimHeader {
+    char magic[4];              // "NRST"
+    uint32_t version;
+    uint32_t reserved[2];
+};
+
+struct NRStimRecord {
+    char name[32];              // NUL padded
+    uint32_t ndim;              // 1..4, leading dimensions of higher rank tensors are flattened
+    uint32_t dims[4];           // unused dimensions are 1
+    uint32_t call;              // call index of the operator the tensor was captured at
+    uint64_t count;             // float32 values that follow
+};
+
+static_assert(sizeof(NRStimHeader) == 16, "NRStimHeader layout");
+static_assert(sizeof(NRStimRecord) == 64, "NRStimRecord layout");
+
+/*
+ * Memory-mapped stimulus reader
+ */
+class StimulusReader {
+public:
+    StimulusReader() : base(NULL), size(0) {}
+    ~StimulusReader() { Close(); }
+
+    bool Open(const char *path) {
+        Close();
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            std::cerr << "StimulusReader: cannot open " << path << std::endl;
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(NRStimHeader)) {
+            std::cerr << "StimulusReader: " << path << " is not a stimulus file" << std::endl;
+            close(fd);
+            return false;
+        }
+        size = st.st_size;
+        void *p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (p == MAP_FAILED) {
+            std::cerr << "StimulusReader: mmap failed for " << path << std::endl;
+            size = 0;
+            return false;
+        }
+        base = static_cast<const char *>(p);
+
+        const NRStimHeader *h = reinterpret_cast<const NRStimHeader *>(base);
+        if (memcmp(h->magic, "NRST", 4) != 0 || h->version != NRSTIM_VERSION) {
+            std::cerr << "StimulusReader: bad magic or version in " << path << std::endl;
+            Close();
+            return false;
+        }
+
+        // Index the records, a truncated last record (run killed while capturing) is dropped
+        size_t offset = sizeof(NRStimHeader);
+        while (offset + sizeof(NRStimRecord) <= size) {
+            const NRStimRecord *r = reinterpret_cast<const NRStimRecord *>(base + offset);
+            size_t bytes = (size_t)r->count * sizeof(float);
+            if (offset + sizeof(NRStimRecord) + bytes > size) {
+                std::cerr << "StimulusReader: truncated record " << Name(*r) << ", ignored" << std::endl;
+                break;
+            }
+            records.push_back(r);
+            offset += sizeof(NRStimRecord) + bytes;
+        }
+        return true;
+    }
+
+    void Close() {
+        if (base != NULL) munmap(const_cast<char *>(base), size);
+        base = NULL;
+        size = 0;
+        records.clear();
+    }
+
+    const std::vector<const NRStimRecord *> &Records() const { return records; }
+
+    static std::string Name(const NRStimRecord &r) { return std::string(r.name, strnlen(r.name, sizeof(r.name))); }
+    static const float *Data(const NRStimRecord &r) { return reinterpret_cast<const float *>(&r + 1); }
+
+    // Values per row of a record: every dimension after the first
+    static uint64_t RowSize(const NRStimRecord &r) {
+        uint64_t n = 1;
+        for (uint32_t d = 1; d < r.ndim && d < 4; d++) n *= r.dims[d];
+        return n;
+    }
+
+    /*
+     * Output: every call of tensor name concatenated, cut into rows of row_size values (the trailing dimensions,
+     * e.g. 3 for the [rays, samples, 3] positions), at most max_rows rows (0: all)
+     * Returns the number of rows, 0 if the tensor is missing or its rows are not a multiple of row_size values
+     */
+    size_t Gather(const std::string &name, size_t row_size, std::vector<float> &out, size_t max_rows = 0) const {
+        out.clear();
+        size_t rows = 0;
+        for (size_t i = 0; i < records.size(); i++) {
+            const NRStimRecord &r = *records[i];
+            if (Name(r) != name) continue;
+            if (row_size == 0 || RowSize(r) % row_size != 0) {
+                std::cerr << "StimulusReader: " << name << " rows have " << RowSize(r) << " values, not a multiple of "
+                          << row_size << std::endl;
+                out.clear();
+                return 0;
+            }
+            size_t n = r.count / row_size;
+            if (max_rows && rows + n > max_rows) n = max_rows - rows;
+            out.insert(out.end(), Data(r), Data(r) + n * row_size);
+            rows += n;
+            if (max_rows && rows == max_rows) break;
+        }
+        if (rows == 0) std::cerr << "StimulusReader: no tensor " << name << " in the stimulus" << std::endl;
+        return rows;
+    }
+
+    // First record of tensor name, NULL if missing
+    const NRStimRecord *Find(const std::string &name) const {
+        for (size_t i = 0; i < records.size(); i++) {
+            if (Name(*records[i]) == name) return records[i];
+        }
+        return NULL;
+    }
+
+private:
+    const char *base;
+    size_t size;
+    std::vector<const NRStimRecord *> records;
+};
+
+} // namespace nrsim
+
+#endif //NRSIM_STIMULUS_H
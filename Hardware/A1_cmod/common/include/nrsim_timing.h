@@ -0,0 +1,78 @@
+#ifndef NRSIM_TIMING_H
+#define NRSIM_TIMING_H
+
+/*
+ * Measured per-operation timing of a unit testbench, for the analytical models (host code only, shared by
+ * the projects: #include "../../common/include/nrsim_timing.h")
+ *
+ * A testbench that streams a workload through its unit reports each operation with the number of items it
+ * processed, the cycles from the first input to the last output and the cycles from the first input to the
+ * first output. Written as JSON to $NRSIM_TIMING_JSON (default nrsim_timing_<unit>.json):
+ *   {"unit": "VRU", "clock_ns": 1,
+ *    "ops": {"blend": {"item": "pixel-Gaussian pair", "items": 65536, "cycles": 66102, "latency": 12,
+ *                      "ii": 1.009, "throughput": 0.991}},
+ *    "values": {"gauss_hits_per_pixel": 4.2}}
+ * ii is the spacing of back-to-back items in steady state ((cycles - latency) / (items - 1), 0 when fewer than
+ * two items were measured), throughput items per cycle. "values"
+ * holds measured workload quantities that are not timing. Read by Scheduler/gscore_schedule.py --timing and
+ * Operators/utils/analysis_model.py load_timing in place of their per-operation constants.
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifndef NRSIM_CLOCK_NS
+#define NRSIM_CLOCK_NS 1.0  // clock period of the testbenches
+#endif
+
+namespace nrsim {
+
+class TimingReport {
+public:
+    explicit TimingReport(const std::string &unit) : unit(unit) {}
+
+    void Op(const std::string &name, const std::string &item, double items, double cycles, double latency) {
+        OpTiming o = {name, item, items, cycles, latency};
+        ops.push_back(o);
+    }
+
+    void Value(const std::string &name, double v) { values.push_back(std::make_pair(name, v)); }
+
+    void Write() const {
+        const char *env = getenv("NRSIM_TIMING_JSON");
+        std::string path = env ? env : "nrsim_timing_" + unit + ".json";
+        std::ofstream os(path.c_str());
+        os.precision(10);
+        os << "{\n  \"unit\": \"" << unit << "\", \"clock_ns\": " << NRSIM_CLOCK_NS << ",\n  \"ops\": {";
+        for (size_t i = 0; i < ops.size(); i++) {
+            const OpTiming &o = ops[i];
+            double ii = (o.items > 1) ? (o.cycles - o.latency) / (o.items - 1) : 0.0;
+            os << (i ? "," : "") << "\n    \"" << o.name << "\": {\"item\": \"" << o.item << "\", \"items\": "
+               << o.items << ", \"cycles\": " << o.cycles << ", \"latency\": " << o.latency << ", \"ii\": " << ii
+               << ", \"throughput\": " << (ii > 0 ? 1.0 / ii : 0.0) << "}";
+        }
+        os << "\n  },\n  \"values\": {";
+        for (size_t i = 0; i < values.size(); i++) {
+            os << (i ? ", " : "") << "\"" << values[i].first << "\": " << values[i].second;
+        }
+        os << "}\n}\n";
+        std::cout << "Measured timing -> " << path << std::endl;
+    }
+
+private:
+    struct OpTiming {
+        std::string name, item;
+        double items, cycles, latency;
+    };
+    std::string unit;
+    std::vector<OpTiming> ops;
+    std::vector<std::pair<std::string, double> > values;
+};
+
+} // namespace nrsim
+
+#endif //NRSIM_TIMING_H
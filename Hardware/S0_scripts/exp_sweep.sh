@@ -0,0 +1,81 @@
+#!/usr/bin/env bash
+# exp_sweep.sh: Synthesize every exp / sigmoid implementation of a VRU (A1_cmod/common/include/nrsim_exp.h) and
+# tabulate the HLS latency / II of each next to its error over the operating range.
+# Usage:  ./exp_sweep.sh <MODULE_PATH> [SIM_VRU] [CLK_PERIOD] [TECH_NODE]
+# Example: ./exp_sweep.sh GSCore/VRU ../A1_cmod/build/GSCore/VRU/sim_VRU 1.0 tn28rvt9t
+# The choices are the make hls builds printed by `sim_VRU exp` (build_hls_exp<IMPL>_<SEGMENTS>, ICARUS also
+# build_hls_sig<IMPL>_<SEGMENTS>); with SIM_VRU the error columns are taken from its output, otherwise left empty.
+# Builds whose cycle.rpt already exists are not synthesized again.
+
+set -euo pipefail
+
+if [[ $# -lt 1 ]]; then
+  echo "Usage: $0 <MODULE_PATH> (GSCore/VRU or ICARUS/VRU) [SIM_VRU] [CLK_PERIOD] [TECH_NODE]" >&2
+  exit 1
+fi
+
+MODULE_PATH="$1"
+SIM_VRU="${2:-}"
+CLK_PERIOD="${3:-1.0}"
+TECH_NODE="${4:-tn28rvt9t}"
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+MODULE_NAME="$(basename "${MODULE_PATH}")"
+
+# name | impl | segments | flag prefix
+CHOICES=(
+  "exp 0 0 VRU_EXP" "exp 1 0 VRU_EXP"
+  "exp 2 4 VRU_EXP" "exp 2 8 VRU_EXP" "exp 2 16 VRU_EXP" "exp 2 32 VRU_EXP"
+  "exp 3 16 VRU_EXP" "exp 3 32 VRU_EXP" "exp 3 64 VRU_EXP"
+)
+if [[ "$MODULE_PATH" == ICARUS/* ]]; then
+  CHOICES+=(
+    "sig 0 0 VRU_SIGMOID" "sig 1 0 VRU_SIGMOID"
+    "sig 2 4 VRU_SIGMOID" "sig 2 8 VRU_SIGMOID" "sig 2 16 VRU_SIGMOID" "sig 2 32 VRU_SIGMOID"
+    "sig 3 16 VRU_SIGMOID" "sig 3 32 VRU_SIGMOID" "sig 3 64 VRU_SIGMOID"
+  )
+fi
+IMPL_NAMES=(ac_pwl cordic pwl lut)
+
+SIM_OUT=""
+if [[ -n "$SIM_VRU" ]]; then
+  SIM_OUT="$("$SIM_VRU" exp || true)"
+fi
+
+cd "$SCRIPT_DIR"
+ROWS=()
+for choice in "${CHOICES[@]}"; do
+  read -r FN IMPL SEGMENTS FLAG <<< "$choice"
+  BUILD="build_hls_${FN}${IMPL}_${SEGMENTS}"
+  CYCLE_RPT="$SCRIPT_DIR/../A2_hls/${MODULE_PATH}/${BUILD}/${MODULE_NAME}_${BUILD}/${MODULE_NAME}.v1/cycle.rpt"
+  if [[ ! -f "$CYCLE_RPT" ]]; then
+    make hls PROJ_PATH="$MODULE_PATH" HLS_BUILD_NAME="$BUILD" CLK_PERIOD="$CLK_PERIOD" TECH_NODE="$TECH_NODE" \
+             HLS_DEFINES="-D${FLAG}_IMPL=${IMPL} -D${FLAG}_SEGMENTS=${SEGMENTS}" || true
+  fi
+
+  # Design Total: <operations> <latency> <throughput> <reset length> <II>
+  LATENCY="-"; II="-"
+  if [[ -f "$CYCLE_RPT" ]]; then
+    read -r LATENCY II < <(grep "Design Total:" "$CYCLE_RPT" | head -1 | awk '{print $4, $7}') || true
+  else
+    echo "[Missing] $CYCLE_RPT" >&2
+  fi
+
+  MAX_ERR="-"; MEAN_ERR="-"
+  if [[ -n "$SIM_OUT" ]]; then
+    LINE="$(grep "HLS_BUILD_NAME=${BUILD} " <<< "$SIM_OUT" || true)"
+    if [[ -n "$LINE" ]]; then
+      MAX_ERR="$(sed -n 's/.*max err \([^ ]*\).*/\1/p' <<< "$LINE")"
+      MEAN_ERR="$(sed -n 's/.*mean err \([^ ]*\).*/\1/p' <<< "$LINE")"
+    fi
+  fi
+  ROWS+=("$(printf "%-8s %-8s %8s | %10s %10s | %8s %4s" "$FN" "${IMPL_NAMES[$IMPL]}" "$SEGMENTS" \
+                   "$MAX_ERR" "$MEAN_ERR" "$LATENCY" "$II")")
+done
+
+echo "======================================================================================================="
+echo "${MODULE_PATH} exp / sigmoid implementations (CLK_PERIOD ${CLK_PERIOD} ns, ${TECH_NODE})"
+printf "%-8s %-8s %8s | %10s %10s | %8s %4s\n" "function" "impl" "segments" "max err" "mean err" "latency" "II"
+for row in "${ROWS[@]}"; do
+  echo "$row"
+done
+echo "======================================================================================================="
@@ -0,0 +1,293 @@
+"""
+Partitioned C-model run: independent tiles / rays simulated as parallel processes, results merged
+
+  python partition.py ../A1_cmod/GSCore/VRU/sim_VRU --trace lego.gstr -n 32 -o part_lego
+  python partition.py ../A1_cmod/GSCore/QSU/sim_QSU --trace lego.gstr -n 8 -- trace {trace}
+  python partition.py ../A1_cmod/CICERO/CICERO/sim_CICERO --count 1024 -n 16 -- {count} 64
+  python partition.py ../A1_cmod/NEUREX/NEUREX/sim_NEUREX --count 8192 -n 16 -- pe {count}
+
+Tiles of a GSCore trace (.gstr, GSCore/include/GSCORETrace.h) are independent, so a frame can be split into
+-n contiguous tile ranges of about equal work (tile-Gaussian pairs, an empty tile counts as one). Each range
+is written as its own trace into <out>/shard<k>/ and simulated by its own copy of the simulator. --count
+does the same for the ray / sample count argument of simulators with synthetic inputs (CICERO rays,
+NEUREX samples). sim_ICARUS renders a fixed set of rays and has nothing to split.
+
+Simulator arguments after -- with {trace}, {colors}, {count}, {shard}, {shards} replaced per shard
+(default with --trace: trace {trace} {colors}). The shards run at most --jobs at a time (default: host
+cores), each in its shard directory, so nrsim_instrument.json (built with -DNRSIM_INSTRUMENT) and
+nrsim_timing_<unit>.json (nrsim_timing.h) land there.
+
+Merged into <out>:
+  colors.gsco             the shards' rendered tiles in trace order (gs_trace.py compare / ppm)
+  nrsim_instrument.json   channel and thread counters summed over the shards
+  nrsim_timing.json       per operation: items and cycles summed, latency the largest (Scheduler --timing)
+  partition.json / .csv   per shard status, tiles / count, cycles, wall time
+Frame time on C cores (--cores, default 1 and -n): the shards are placed longest first on the least
+loaded core, the frame takes the most loaded core's cycles. With as many cores as shards that is the
+slowest shard; summed over the shards it is the one-core frame.
+"""
+import argparse
+import csv
+import json
+import mmap
+import os
+import struct
+import subprocess
+import sys
+import time
+from concurrent.futures import ThreadPoolExecutor, as_completed
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from sweep import summarize  # noqa: E402
+
+HEADER = struct.Struct("<4sIIIIIQ")   # GSTraceHeader
+TILE = struct.Struct("<IIII")         # GSTraceTile
+GAUSS_BYTES = 48                      # GSTraceGauss
+
+
+# ───────────────────────────── trace split / color merge ─────────────────────────────
+
+def read_tiles(buf):
+    """GSTR buffer -> header tuple, [(offset, bytes, num_gaussians)] per tile"""
+    h = HEADER.unpack_from(buf, 0)
+    if h[0] != b"GSTR" or h[1] != 1:
+        sys.exit("not a version 1 GSTR trace")
+    tiles, off = [], HEADER.size
+    for _ in range(h[5]):
+        n = TILE.unpack_from(buf, off)[2]
+        size = TILE.size + n * GAUSS_BYTES
+        if off + size > len(buf):
+            sys.exit("truncated trace")
+        tiles.append((off, size, n))
+        off += size
+    return h, tiles
+
+
+def split_ranges(work, n):
+    """Contiguous ranges [start, stop) of about equal summed work, at most n, none empty"""
+    total = float(sum(work)) or 1.0
+    ranges, start, acc = [], 0, 0.0
+    for i, w in enumerate(work):
+        acc += w
+        if len(ranges) < n - 1 and acc >= total * (len(ranges) + 1) / n and i + 1 < len(work):
+            ranges.append((start, i + 1))
+            start = i + 1
+    ranges.append((start, len(work)))
+    return [r for r in ranges if r[1] > r[0]]
+
+
+def split_trace(path, n, out):
+    """Writes <out>/shard<k>/part.gstr, returns [(tiles, pairs)] per shard"""
+    with open(path, "rb") as f, mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ) as buf:
+        h, tiles = read_tiles(buf)
+        ranges = split_ranges([max(t[2], 1) for t in tiles], n)
+        shards = []
+        for k, (a, b) in enumerate(ranges):
+            d = os.path.join(out, f"shard{k}")
+            os.makedirs(d, exist_ok=True)
+            pairs = sum(t[2] for t in tiles[a:b])
+            with open(os.path.join(d, "part.gstr"), "wb") as o:
+                o.write(HEADER.pack(h[0], h[1], h[2], h[3], h[4], b - a, pairs))
+                o.write(buf[tiles[a][0]:tiles[b - 1][0] + tiles[b - 1][1]])
+            shards.append({"tiles": b - a, "pairs": pairs})
+    return shards
+
+
+def merge_colors(paths, out):
+    """Shard color files (same header, tiles in order) -> one GSCO file"""
+    header, body, tiles = None, [], 0
+    for p in paths:
+        with open(p, "rb") as f:
+            data = f.read()
+        h = HEADER.unpack_from(data, 0)
+        header = header or h
+        tiles += h[5]
+        body.append(data[HEADER.size:])
+    with open(out, "wb") as f:
+        f.write(HEADER.pack(header[0], header[1], header[2], header[3], header[4], tiles, 0))
+        for b in body:
+            f.write(b)
+    return tiles
+
+
+# ───────────────────────────── statistics merge ─────────────────────────────
+
+def merge_instrument(paths, out):
+    """Channel / thread counters summed by name, run cycles summed (one core)"""
+    channels, threads, cycles, clock = {}, {}, 0, 1
+    for p in paths:
+        with open(p) as f:
+            d = json.load(f)
+        cycles += d.get("cycles", 0)
+        clock = d.get("clock_ns", clock)
+        for c in d.get("channels", []):
+            m = channels.setdefault(c["name"], {"transfers": 0, "push_stalls": 0, "pop_empty": 0, "blocked_cycles": 0})
+            for k in m:
+                m[k] += c[k]
+        for t in d.get("threads", []):
+            m = threads.setdefault(t["name"], {"cycles": 0, "valid": 0, "stall": 0, "idle": 0})
+            for k in m:
+                m[k] += t[k]
+    d = {"clock_ns": clock, "cycles": cycles,
+         "channels": [dict(name=n, utilization=(c["transfers"] / cycles if cycles else 0.0), **c)
+                      for n, c in sorted(channels.items())],
+         "threads": [dict(name=n, **t) for n, t in sorted(threads.items())]}
+    with open(out, "w") as f:
+        json.dump(d, f, indent=2)
+
+
+def merge_timing(paths, out):
+    """nrsim_timing.h reports of the shards -> one report of the whole run"""
+    unit, clock, ops, values, n = None, 1, {}, {}, 0
+    for p in paths:
+        with open(p) as f:
+            d = json.load(f)
+        unit, clock, n = d.get("unit", unit), d.get("clock_ns", clock), n + 1
+        for name, o in d.get("ops", {}).items():
+            m = ops.setdefault(name, {"item": o.get("item", ""), "items": 0, "cycles": 0, "latency": 0})
+            m["items"] += o["items"]
+            m["cycles"] += o["cycles"]
+            m["latency"] = max(m["latency"], o["latency"])
+        for name, v in d.get("values", {}).items():   # workload quantities: mean over the shards
+            values[name] = values.get(name, 0.0) + v
+    for o in ops.values():
+        o["ii"] = (o["cycles"] - o["latency"]) / (o["items"] - 1) if o["items"] > 1 else 0.0
+        o["throughput"] = 1.0 / o["ii"] if o["ii"] > 0 else 0.0
+    d = {"unit": unit, "clock_ns": clock, "ops": ops, "values": {k: v / n for k, v in values.items()}}
+    with open(out, "w") as f:
+        json.dump(d, f, indent=2)
+
+
+def frame_cycles(shard_cycles, cores):
+    """Largest core load with the shards placed longest first on the least loaded core"""
+    load = [0] * cores
+    for c in sorted(shard_cycles, reverse=True):
+        load[load.index(min(load))] += c
+    return max(load)
+
+
+# ───────────────────────────── runs ─────────────────────────────
+
+def run_shard(args, k, shard):
+    d = shard["dir"]
+    fill = {"trace": os.path.join(d, "part.gstr"), "colors": os.path.join(d, "colors.gsco"),
+            "count": str(shard.get("count", "")), "shard": str(k), "shards": str(args.shards)}
+    cmd = [args.sim] + [a.format(**fill) for a in args.sim_args]
+    json_path = os.path.join(d, "nrsim_instrument.json")
+    for stale in [json_path, fill["colors"]] + [os.path.join(d, f) for f in os.listdir(d) if f.startswith("nrsim_timing")]:
+        if os.path.exists(stale):
+            os.remove(stale)
+    env = dict(os.environ, NRSIM_INSTRUMENT_JSON=json_path)
+    env.pop("NRSIM_TIMING_JSON", None)     # default name in the shard directory
+    row = dict(shard, status="", wall_s=0.0, cycles=None)
+    start = time.time()
+    try:
+        with open(os.path.join(d, "run.log"), "w") as out:
+            rc = subprocess.run(cmd, cwd=d, env=env, stdout=out, stderr=subprocess.STDOUT,
+                                timeout=args.timeout).returncode
+    except subprocess.TimeoutExpired:
+        row["status"] = "timeout"
+        return row
+    row["wall_s"] = round(time.time() - start, 1)
+
+    with open(os.path.join(d, "run.log"), errors="replace") as f:
+        text = f.read()
+    if rc != 0:
+        row["status"] = f"run failed ({rc})"
+    elif "FAILED" in text or "MISMATCH" in text:
+        row["status"] = "FAILED"
+    elif "PASSED" in text or "✓" in text:
+        row["status"] = "PASSED"
+    else:
+        row["status"] = "ok"
+    timing = [os.path.join(d, f) for f in os.listdir(d) if f.startswith("nrsim_timing") and f.endswith(".json")]
+    row["timing"] = timing[0] if timing else None
+    if os.path.exists(json_path):
+        row["instrument"] = json_path
+        row["cycles"] = summarize(json_path)["cycles"]
+    elif row["timing"]:
+        with open(row["timing"]) as f:
+            ops = json.load(f).get("ops", {})
+        row["cycles"] = max([o["cycles"] for o in ops.values()], default=None)
+    return row
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description="tile / ray partitioned C-model run",
+                                     epilog="simulator arguments go after --")
+    parser.add_argument("sim", help="built simulator, e.g. A1_cmod/GSCore/VRU/sim_VRU")
+    src = parser.add_mutually_exclusive_group(required=True)
+    src.add_argument("--trace", help="GSCore scene trace (.gstr), split into tile ranges")
+    src.add_argument("--count", type=int, help="ray / sample count, split into per shard {count}")
+    parser.add_argument("-n", "--shards", type=int, default=os.cpu_count() or 1, help="shards (default: host cores)")
+    parser.add_argument("-j", "--jobs", type=int, default=os.cpu_count() or 1, help="concurrent simulations")
+    parser.add_argument("--cores", default=None, help="core counts of the frame-time estimate (default 1,<shards>)")
+    parser.add_argument("-o", "--out", default="partition", help="output directory (default ./partition)")
+    parser.add_argument("--timeout", type=float, default=None, help="simulation timeout per shard (s)")
+    sim_args = argv[argv.index("--") + 1:] if "--" in argv else []
+    args = parser.parse_args(argv[:len(argv) - len(sim_args) - (1 if "--" in argv else 0)])
+    args.sim = os.path.abspath(args.sim)
+    args.sim_args = sim_args or (["trace", "{trace}", "{colors}"] if args.trace else ["{count}"])
+    if not os.access(args.sim, os.X_OK):
+        sys.exit(f"{args.sim}: no simulator")
+    args.out = os.path.abspath(args.out)
+    os.makedirs(args.out, exist_ok=True)
+
+    if args.trace:
+        shards = split_trace(args.trace, args.shards, args.out)
+    else:
+        n = min(args.shards, args.count)
+        shards = [{"count": args.count // n + (k < args.count % n)} for k in range(n)]
+        for k in range(n):
+            os.makedirs(os.path.join(args.out, f"shard{k}"), exist_ok=True)
+    args.shards = len(shards)
+    for k, s in enumerate(shards):
+        s["dir"] = os.path.join(args.out, f"shard{k}")
+    print(f"{os.path.basename(args.sim)}: {len(shards)} shards, {args.jobs} jobs -> {args.out}")
+
+    rows = [None] * len(shards)
+    with ThreadPoolExecutor(max_workers=args.jobs) as pool:
+        futures = {pool.submit(run_shard, args, k, s): k for k, s in enumerate(shards)}
+        for n, fut in enumerate(as_completed(futures), 1):
+            k = futures[fut]
+            rows[k] = dict(fut.result(), shard=k)
+            print(f"[{n}/{len(shards)}] shard{k}: {rows[k]['status']}, cycles {rows[k]['cycles']}")
+            sys.stdout.flush()
+
+    # Merge
+    colors = [os.path.join(r["dir"], "colors.gsco") for r in rows]
+    if args.trace and all(os.path.exists(c) for c in colors):
+        tiles = merge_colors(colors, os.path.join(args.out, "colors.gsco"))
+        print(f"colors.gsco: {tiles} tiles")
+    instrument = [r["instrument"] for r in rows if r.get("instrument")]
+    if instrument:
+        merge_instrument(instrument, os.path.join(args.out, "nrsim_instrument.json"))
+    timing = [r["timing"] for r in rows if r.get("timing")]
+    if timing:
+        merge_timing(timing, os.path.join(args.out, "nrsim_timing.json"))
+
+    fields = ["shard", "status", "tiles", "pairs", "count", "cycles", "wall_s", "dir"]
+    table = [{f: r.get(f) for f in fields} for r in rows]
+    with open(os.path.join(args.out, "partition.csv"), "w", newline="") as f:
+        w = csv.DictWriter(f, fieldnames=fields)
+        w.writeheader()
+        w.writerows(table)
+
+    failed = [r["shard"] for r in rows if r["status"] not in ("PASSED", "ok")]
+    cycles = [r["cycles"] for r in rows if r["cycles"] is not None]
+    summary = {"shards": table, "failed": failed}
+    if len(cycles) == len(rows) and cycles:
+        cores = [int(c) for c in args.cores.split(",")] if args.cores else sorted({1, len(rows)})
+        one = sum(cycles)
+        summary["frame_cycles"] = {c: frame_cycles(cycles, c) for c in cores}
+        print(f"shard cycles: min {min(cycles)}, max {max(cycles)}, sum {one}; "
+              f"wall {sum(r['wall_s'] for r in rows):.1f} s summed over the shards")
+        for c, f in summary["frame_cycles"].items():
+            print(f"  {c:4d} cores: frame {f} cycles, speedup {one / f:.2f}")
+    with open(os.path.join(args.out, "partition.json"), "w") as f:
+        json.dump(summary, f, indent=2)
+    print(("PASSED" if not failed else f"FAILED (shards {failed})"))
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
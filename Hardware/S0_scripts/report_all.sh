@@ -8,7 +8,9 @@ modules=(
   "GauRast/PE"
   "GauRast/PE_array"
   "GauRast/VRU"
+  "GSCore/BMU"
   "GSCore/BSU"
+  "GSCore/CCU"
   "GSCore/QSU"
   "GSCore/VRU"
   "GS_processor/IE"
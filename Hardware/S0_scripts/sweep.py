@@ -0,0 +1,209 @@
+"""
+Parallel design-space sweep over C-model configurations
+
+  python sweep.py GSCore sim_GSCore -p NUM_ROTATE=1,2,4,8 -p GSCORE_NUM_VRU=4,8,16 -j 16
+  python sweep.py CICERO sim_CICERO -p NPU_SIZE=8,16,24,32 -- 8 64       # simulator arguments after --
+  python sweep.py NEUREX sim_NEUREX --grid neurex_grid.json -o sweep_neurex
+
+Every point of the grid (cartesian product of the -p lists, or of the "params" of a --grid JSON) is a
+separate build of the project's C model: A1_cmod/<project> is configured into <out>/<point>/ with the
+point's values as -D defines on top of the fixed ones (-D, "defines") and -DNRSIM_INSTRUMENT, so a swept
+name has to be an #ifndef-guarded macro of the PackDef (NPU_SIZE, SORT_NUM, NUM_ROTATE, BLOCK_SZ, ...).
+Points are configured, built and run concurrently, at most --jobs at a time (default: host cores), each
+build with --build-jobs make jobs. A point whose simulator already exists is not rebuilt (resume a sweep),
+--rebuild forces it.
+
+Each run writes run.log and its channel / thread JSON (nrsim_instrument.h) into its directory. The table
+(<out>/sweep.csv and sweep.json, sorted by cycles) has per point the swept values, the status (build /
+run failure, timeout, PASSED / FAILED as printed by the testbench), wall time, simulated cycles, summed
+thread stall and channel blocked cycles, and the most stalled channel.
+
+Grid JSON: {"params": {"NPU_SIZE": [16, 32]}, "defines": {"NPU_DATAFLOW": "NPU_WS"}, "args": ["8", "64"]}
+"""
+import argparse
+import csv
+import itertools
+import json
+import os
+import re
+import subprocess
+import sys
+import time
+from concurrent.futures import ThreadPoolExecutor, as_completed
+
+HW_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+CMOD_DIR = os.path.join(HW_DIR, "A1_cmod")
+
+
+def parse_values(text):
+    """'1,2,4' or '1:9:2' (start:stop:step, stop excluded) -> list of strings"""
+    if re.fullmatch(r"-?\d+:-?\d+(:-?\d+)?", text):
+        r = [int(x) for x in text.split(":")]
+        return [str(v) for v in range(*r)]
+    return [v for v in text.split(",") if v != ""]
+
+
+def grid_points(params):
+    """params: {name: [values]} -> list of {name: value}, first name varies slowest"""
+    names = list(params)
+    return [dict(zip(names, [str(v) for v in values]))
+            for values in itertools.product(*(params[n] for n in names))]
+
+
+def point_dir(point):
+    return "_".join(f"{k}{v}" for k, v in point.items()) or "default"
+
+
+def find_binary(build_dir, target):
+    for root, _, files in os.walk(build_dir):
+        if target in files:
+            path = os.path.join(root, target)
+            if os.access(path, os.X_OK):
+                return path
+    return None
+
+
+def summarize(json_path):
+    """nrsim_instrument.json -> cycles, thread stall cycles, channel blocked cycles, most stalled channel"""
+    with open(json_path) as f:
+        d = json.load(f)
+    stall = sum(t["stall"] for t in d.get("threads", []))
+    blocked = sum(c["blocked_cycles"] for c in d.get("channels", []))
+    worst, worst_name = 0, ""
+    for c in d.get("channels", []):
+        s = c["push_stalls"] + c["blocked_cycles"]
+        if s > worst:
+            worst, worst_name = s, c["name"]
+    return {"cycles": d.get("cycles"), "stall_cycles": stall, "blocked_cycles": blocked,
+            "worst_channel": worst_name, "worst_channel_stalls": worst}
+
+
+def run_point(args, point, fixed):
+    d = os.path.join(args.out, point_dir(point))
+    os.makedirs(d, exist_ok=True)
+    row = dict(point)
+    row.update({"status": "", "wall_s": 0.0, "cycles": None, "stall_cycles": None, "blocked_cycles": None,
+                "worst_channel": "", "worst_channel_stalls": None, "dir": d})
+    binary = None if args.rebuild else find_binary(d, args.target)
+    if binary is None:
+        defines = dict(fixed)
+        defines.update(point)
+        flags = " ".join([f"-D{k}={v}" for k, v in defines.items()] +
+                         ([] if args.no_instrument else ["-DNRSIM_INSTRUMENT"]))
+        steps = [["cmake", "-S", os.path.join(CMOD_DIR, args.project), "-B", d, f"-DCMAKE_CXX_FLAGS={flags}"],
+                 ["cmake", "--build", d, "--target", args.target, "-j", str(args.build_jobs)]]
+        with open(os.path.join(d, "build.log"), "w") as log:
+            for cmd in steps:
+                if subprocess.run(cmd, stdout=log, stderr=subprocess.STDOUT).returncode != 0:
+                    row["status"] = "build failed"
+                    return row
+        binary = find_binary(d, args.target)
+        if binary is None:
+            row["status"] = "build failed"
+            return row
+
+    json_path = os.path.join(d, "nrsim_instrument.json")
+    if os.path.exists(json_path):
+        os.remove(json_path)
+    env = dict(os.environ, NRSIM_INSTRUMENT_JSON=json_path)
+    start = time.time()
+    try:
+        with open(os.path.join(d, "run.log"), "w") as out:
+            rc = subprocess.run([binary] + args.sim_args, cwd=d, env=env, stdout=out, stderr=subprocess.STDOUT,
+                                timeout=args.timeout).returncode
+    except subprocess.TimeoutExpired:
+        row["status"] = "timeout"
+        return row
+    row["wall_s"] = round(time.time() - start, 1)
+
+    with open(os.path.join(d, "run.log"), errors="replace") as f:
+        text = f.read()
+    if rc != 0:
+        row["status"] = f"run failed ({rc})"
+    elif "FAILED" in text or "MISMATCH" in text:
+        row["status"] = "FAILED"
+    elif "PASSED" in text:
+        row["status"] = "PASSED"
+    else:
+        row["status"] = "ok"
+    if os.path.exists(json_path):
+        row.update(summarize(json_path))
+    return row
+
+
+def print_table(rows, names):
+    cols = names + ["status", "cycles", "stall_cycles", "blocked_cycles", "wall_s", "worst_channel"]
+    cells = [[("" if r.get(c) is None else str(r.get(c))) for c in cols] for r in rows]
+    widths = [max([len(c)] + [len(x[i]) for x in cells]) for i, c in enumerate(cols)]
+    print("  ".join(c.rjust(w) for c, w in zip(cols, widths)))
+    for x in cells:
+        print("  ".join(v.rjust(w) for v, w in zip(x, widths)))
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description="parallel C-model DSE sweep", epilog="simulator arguments go after --")
+    parser.add_argument("project", help="A1_cmod project (CICERO, GSCore, ICARUS, NEUREX, common)")
+    parser.add_argument("target", help="simulator target, e.g. sim_GSCore")
+    parser.add_argument("-p", "--param", action="append", default=[], metavar="NAME=V1,V2|START:STOP[:STEP]",
+                        help="swept macro and its values (repeatable)")
+    parser.add_argument("-D", "--define", action="append", default=[], metavar="NAME=V",
+                        help="fixed macro for every point (repeatable)")
+    parser.add_argument("--grid", help="grid JSON (params / defines / args), merged with -p / -D")
+    parser.add_argument("-o", "--out", default="sweep", help="output directory (default ./sweep)")
+    parser.add_argument("-j", "--jobs", type=int, default=os.cpu_count() or 1, help="concurrent points")
+    parser.add_argument("--build-jobs", type=int, default=1, help="make jobs per point build")
+    parser.add_argument("--timeout", type=float, default=None, help="simulation timeout per point (s)")
+    parser.add_argument("--rebuild", action="store_true", help="rebuild points with an existing simulator")
+    parser.add_argument("--no-instrument", action="store_true", help="build without -DNRSIM_INSTRUMENT")
+    parser.add_argument("--dry-run", action="store_true", help="list the points and exit")
+    sim_args = argv[argv.index("--") + 1:] if "--" in argv else []
+    args = parser.parse_args(argv[:len(argv) - len(sim_args) - (1 if "--" in argv else 0)])
+    args.sim_args = sim_args
+    params, fixed = {}, {}
+    if args.grid:
+        with open(args.grid) as f:
+            g = json.load(f)
+        params.update({k: [str(v) for v in vs] for k, vs in g.get("params", {}).items()})
+        fixed.update({k: str(v) for k, v in g.get("defines", {}).items()})
+        if not args.sim_args:
+            args.sim_args = [str(a) for a in g.get("args", [])]
+    for p in args.param:
+        name, _, values = p.partition("=")
+        params[name] = parse_values(values)
+    for p in args.define:
+        name, _, value = p.partition("=")
+        fixed[name] = value or "1"
+    if not os.path.isdir(os.path.join(CMOD_DIR, args.project)):
+        sys.exit(f"no project {args.project} in {CMOD_DIR}")
+
+    points = grid_points(params)
+    names = list(params)
+    print(f"{args.project}/{args.target}: {len(points)} points, {args.jobs} jobs -> {args.out}")
+    if args.dry_run:
+        for p in points:
+            print("  " + point_dir(p))
+        return
+    args.out = os.path.abspath(args.out)
+    os.makedirs(args.out, exist_ok=True)
+
+    rows = []
+    with ThreadPoolExecutor(max_workers=args.jobs) as pool:
+        futures = {pool.submit(run_point, args, p, fixed): p for p in points}
+        for n, fut in enumerate(as_completed(futures), 1):
+            row = fut.result()
+            rows.append(row)
+            print(f"[{n}/{len(points)}] {point_dir(futures[fut])}: {row['status']}, cycles {row['cycles']}")
+            sys.stdout.flush()
+
+    rows.sort(key=lambda r: (r["cycles"] is None, r["cycles"] or 0))
+    with open(os.path.join(args.out, "sweep.json"), "w") as f:
+        json.dump(rows, f, indent=2)
+    with open(os.path.join(args.out, "sweep.csv"), "w", newline="") as f:
+        w = csv.DictWriter(f, fieldnames=list(rows[0]) if rows else names)
+        w.writeheader()
+        w.writerows(rows)
+    print_table(rows, names)
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
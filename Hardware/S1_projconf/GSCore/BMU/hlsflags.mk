@@ -0,0 +1 @@
+-DHLS_CATAPULT -D_SYNTHESIS_ 
\ No newline at end of file
@@ -0,0 +1 @@
+${MATCHLIB_HOME} ${PWD}/../A1_cmod/GSCore/include
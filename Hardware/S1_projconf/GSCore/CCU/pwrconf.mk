@@ -0,0 +1,7 @@
+allavg allavg
+alltmb alltmb
+avg 0 150000 mlp_avg
+avg 150000 330000 plo_avg
+tmb 0 150000 mlp_tmb
+tmb 150000 330000 plo_tmb
+
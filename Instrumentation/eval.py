@@ -38,6 +38,7 @@ import importlib.util
 
 # Tracing will be loaded *later* if the user enables it via CLI flag.
 tracing_mod = None  # will hold imported module when enabled
+stimulus_mod = None  # instrumentation/stimulus.py, loaded when --stimulus-output is given
 
 import tyro
 
@@ -66,6 +67,9 @@ class ComputePSNR:
     enable_trace: bool = False
     # Path to JSON with functions_to_trace; defaults to file beside instrumentation/tracing.py
     trace_config_path: Optional[Path] = None
+    # Dump the tensors listed under tensors_to_export of the trace config to this file (.nrst), the stimulus
+    # of the C-model testbenches (Hardware/A1_cmod/common/include/nrsim_stimulus.h)
+    stimulus_output: Optional[Path] = None
 
     def main(self) -> None:
         """Main function."""
@@ -94,6 +98,21 @@ class ComputePSNR:
             except Exception as e:
                 print(f"[Tracing] Failed to initialise: {e}")
 
+        global stimulus_mod  # noqa: PLW0603
+        if self.stimulus_output is not None and stimulus_mod is None:
+            try:
+                instr_dir = Path(__file__).resolve().parent.parent / "instrumentation"
+                spec = importlib.util.spec_from_file_location("nerfstudio.instrumentation.stimulus",
+                                                              instr_dir / "stimulus.py")
+                stimulus_mod = importlib.util.module_from_spec(spec)  # type: ignore
+                assert spec and spec.loader
+                spec.loader.exec_module(stimulus_mod)  # type: ignore
+
+                cfg_json = self.trace_config_path if self.trace_config_path else (instr_dir / "trace_config.json")
+                stimulus_mod.load_export_config(str(cfg_json), self.stimulus_output)
+            except Exception as e:
+                print(f"[Stimulus] Failed to initialise: {e}")
+
         config, pipeline, checkpoint_path, _ = eval_setup(self.load_config)
         assert self.output_path.suffix == ".json"
         if self.render_output_path is not None:
@@ -129,6 +148,9 @@ class ComputePSNR:
             except Exception as e:
                 print(f"[Tracing] Could not save DAG: {e}")
 
+        if stimulus_mod:
+            stimulus_mod.close()
+
         self.output_path.parent.mkdir(parents=True, exist_ok=True)
         # Get the output and define the names to save to
         benchmark_info = {
@@ -0,0 +1,216 @@
+"""
+Operator-boundary tensor export for the C-model testbenches (format: Hardware/A1_cmod/common/include/nrsim_stimulus.h)
+
+The functions listed under "tensors_to_export" in trace_config.json are wrapped so that the tensors at their
+boundary are appended to a stimulus file (.nrst) while ns-eval renders:
+
+    "tensors_to_export": {
+        "nerfstudio.field_components.encodings.HashEncoding.forward": {"in_tensor": "igu_positions", "hash_corners": "icu"},
+        "nerfstudio.cameras.rays.Frustums.get_positions": {"output": "ray_positions"},
+        "nerfstudio.models.splatfacto.SplatfactoModel.get_outputs": {"splats": "gs"}
+    }
+
+An entry maps an argument name, "output" or "output[key]" to the name of the tensor in the file. Two entries derive
+the hardware-side tensors of an operator instead:
+  hash_corners: <prefix>_weights [n, 8] / <prefix>_features [n, 8, F], trilinear corner weights and hash table
+                features of every (sample, level) of a HashEncoding (torch implementation only, the tcnn table layout
+                is not reproduced)
+  splats:       <prefix>_means2d / _conics / _depths / _radii / _opacities / _colors / _frame of the Gaussians
+                splatfacto rasterized, binned into a GSCore trace by gs_trace.py stim
+
+    ns-eval --load-config ... --stimulus-output capture.nrst --eval-image-indices "(0,)"
+    ./sim_IGU stim capture.nrst;  ./sim_ICU stim capture.nrst;  ./sim_PEU stim capture.nrst
+    python gs_trace.py stim capture.nrst -o frame0.gstr;  ./sim_VRU trace frame0.gstr
+
+Rows per tensor name are capped by "stimulus_max_rows" (default 65536, 0: no cap), the splats are always whole.
+"""
+import importlib
+import json
+import struct
+from functools import wraps
+
+import torch
+
+VERSION = 1
+HEADER = struct.Struct("<4sIII")
+RECORD = struct.Struct("<32sI4IIQ")
+assert HEADER.size == 16 and RECORD.size == 64
+
+SH_C0 = 0.28209479177387814
+
+
+class StimulusWriter:
+    def __init__(self, path, max_rows=65536):
+        self.path = str(path)
+        self.max_rows = max_rows
+        self.rows = {}   # rows written per tensor name
+        self.calls = {}  # records written per tensor name
+        self.f = open(self.path, "wb")
+        self.f.write(HEADER.pack(b"NRST", VERSION, 0, 0))
+
+    def write(self, name, tensor, capped=True):
+        t = tensor.detach()
+        if t.dim() == 0:
+            t = t.reshape(1)
+        if t.dim() > 4:  # keep the last three dimensions, flatten the rest into rows
+            t = t.reshape(-1, *t.shape[-3:])
+        rows = self.rows.get(name, 0)
+        if capped and self.max_rows:
+            if rows >= self.max_rows:
+                return
+            t = t[: self.max_rows - rows]
+        data = t.to(device="cpu", dtype=torch.float32).contiguous()
+        dims = list(data.shape) + [1] * (4 - data.dim())
+        call = self.calls.get(name, 0)
+        self.f.write(RECORD.pack(name.encode()[:31], data.dim(), *dims, call, data.numel()))
+        self.f.write(data.numpy().tobytes())
+        self.f.flush()  # a killed run still leaves whole records
+        self.rows[name] = rows + data.shape[0]
+        self.calls[name] = call + 1
+
+    def close(self):
+        if self.f:
+            self.f.close()
+            self.f = None
+            summary = ", ".join(f"{n} {r} rows / {self.calls[n]} calls" for n, r in self.rows.items())
+            print(f"[Stimulus] {self.path}: {summary or 'nothing captured'}")
+
+
+writer = None
+
+
+def hash_corners(enc, positions):
+    """Corner weights [n*L, 8] and features [n*L, 8, F] of nerfstudio's HashEncoding.pytorch_fwd, one row per
+    (sample, level): corner c takes ceil on the axes whose bit is set (x: bit 0, y: bit 1, z: bit 2)"""
+    x = positions.reshape(-1, 1, 3)
+    scaled = x * enc.scalings.view(-1, 1).to(x.device)  # [n, L, 3]
+    lo = torch.floor(scaled).type(torch.int32)
+    hi = torch.ceil(scaled).type(torch.int32)
+    offset = scaled - lo
+    weights, features = [], []
+    for c in range(8):
+        bits = torch.tensor([(c >> a) & 1 for a in range(3)], device=x.device, dtype=torch.bool)
+        corner = torch.where(bits, hi, lo)
+        w = torch.where(bits, offset, 1 - offset).prod(-1)  # [n, L]
+        features.append(enc.hash_table[enc.hash_fn(corner)])  # [n, L, F]
+        weights.append(w)
+    weights = torch.stack(weights, -1).reshape(-1, 8)
+    features = torch.stack(features, -2).reshape(-1, 8, enc.features_per_level)
+    return weights, features
+
+
+def export_hash_corners(prefix, enc, positions):
+    if getattr(enc, "hash_table", None) is None:
+        print(f"[Stimulus] {prefix}: HashEncoding uses tcnn, corner features not exported (implementation='torch')")
+        return
+    with torch.no_grad():
+        w, f = hash_corners(enc, positions)
+    writer.write(f"{prefix}_weights", w)
+    writer.write(f"{prefix}_features", f)
+
+
+def export_splats(prefix, model, camera):
+    """Post-projection Gaussians of the last splatfacto render (model.info, the gsplat rasterization meta)"""
+    info = getattr(model, "info", None)
+    if not info or "means2d" not in info:
+        print(f"[Stimulus] {prefix}: no rasterization info on {type(model).__name__}")
+        return
+    with torch.no_grad():
+        means2d = info["means2d"].reshape(-1, 2)
+        radii = info["radii"].reshape(means2d.shape[0], -1).max(-1).values
+        n = means2d.shape[0]
+        # View-dependent colors with the camera of the render, as rasterization evaluates them
+        dc = model.features_dc
+        rest = model.features_rest
+        sh = torch.cat((dc[:, None, :], rest), dim=1)
+        if sh.shape[0] == n:
+            try:
+                from gsplat import spherical_harmonics
+                dirs = model.means - camera.camera_to_worlds.reshape(-1, 3, 4)[0, :3, 3].to(model.means.device)
+                degree = int(round(sh.shape[1] ** 0.5)) - 1
+                colors = spherical_harmonics(degree, dirs, sh)
+            except ImportError:
+                colors = SH_C0 * dc
+        else:
+            colors = SH_C0 * dc
+        colors = torch.clamp_min(colors + 0.5, 0.0)
+        if colors.shape[0] != n:  # Gaussians cropped away before rasterization
+            print(f"[Stimulus] {prefix}: {n} rasterized vs {colors.shape[0]} model Gaussians, colors not exported")
+            return
+        writer.write(f"{prefix}_means2d", means2d, capped=False)
+        writer.write(f"{prefix}_conics", info["conics"].reshape(-1, 3), capped=False)
+        writer.write(f"{prefix}_depths", info["depths"].reshape(-1), capped=False)
+        writer.write(f"{prefix}_radii", radii, capped=False)
+        writer.write(f"{prefix}_opacities", info["opacities"].reshape(-1), capped=False)
+        writer.write(f"{prefix}_colors", colors.reshape(-1, 3), capped=False)
+        writer.write(f"{prefix}_frame", torch.tensor([float(info["width"]), float(info["height"])]), capped=False)
+
+
+def select(spec_key, bound, result):
+    """argument name, output or output[key] -> tensor"""
+    if spec_key == "output":
+        return result
+    if spec_key.startswith("output[") and spec_key.endswith("]"):
+        key = spec_key[7:-1]
+        return result[int(key)] if isinstance(result, (list, tuple)) else result[key]
+    return bound.arguments.get(spec_key)
+
+
+def make_export_function(spec):
+    def export_function(func):
+        import inspect
+        sig = inspect.signature(func)
+
+        @wraps(func)
+        def wrapper(*args, **kwargs):
+            result = func(*args, **kwargs)
+            if writer is None:
+                return result
+            bound = sig.bind(*args, **kwargs)
+            for key, name in spec.items():
+                try:
+                    if key == "hash_corners":
+                        export_hash_corners(name, bound.arguments["self"], bound.arguments["in_tensor"])
+                    elif key == "splats":
+                        export_splats(name, bound.arguments["self"], bound.arguments["camera"])
+                    else:
+                        t = select(key, bound, result)
+                        if isinstance(t, torch.Tensor):
+                            writer.write(name, t)
+                except Exception as e:  # never break the render
+                    print(f"[Stimulus] {func.__qualname__} {key}: {e}")
+            return result
+        return wrapper
+    return export_function
+
+
+def load_export_config(config_path, output_path):
+    """Open the stimulus file and wrap every function under tensors_to_export"""
+    global writer
+    with open(config_path, "r") as f:
+        config = json.load(f)
+    writer = StimulusWriter(output_path, config.get("stimulus_max_rows", 65536))
+    for func_path, spec in config.get("tensors_to_export", {}).items():
+        try:
+            parts = func_path.split(".")
+            owner = None
+            for split in (len(parts) - 1, len(parts) - 2):  # module.function or module.Class.function
+                try:
+                    owner = importlib.import_module(".".join(parts[:split]))
+                    for attr in parts[split:-1]:
+                        owner = getattr(owner, attr)
+                    break
+                except ImportError:
+                    owner = None
+            if owner is None:
+                raise ImportError(f"no module for {func_path}")
+            setattr(owner, parts[-1], make_export_function(spec)(getattr(owner, parts[-1])))
+        except (ImportError, AttributeError) as e:
+            print(f"[Stimulus] Cannot export {func_path}: {e}")
+
+
+def close():
+    global writer
+    if writer is not None:
+        writer.close()
+        writer = None
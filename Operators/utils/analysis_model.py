@@ -1,11 +1,43 @@
 # analysis/analysis_model.py
 
+import json
 import pandas as pd
 
-def analysis_model(model_operators, system):
+# Operators with a C-model unit that measures them (nrsim_timing_<unit>.json written by the GSCore
+# testbenches, Hardware/A1_cmod/common/include/nrsim_timing.h): op type -> (unit, op, items of the operator)
+MEASURED_OPS = {
+    "FrustumCullProj":    [("CCU", "preprocess", lambda dim: dim[0])],             # Gaussians
+    "Sorting":            [("QSU", "partition",  lambda dim: dim[0] * dim[1]),    # keys, QSU and BSU pipelined
+                           ("BSU", "sort",       lambda dim: dim[0] * dim[1])],
+    "GaussianAlphaBlend": [("VRU", "blend",      lambda dim: dim[0] * dim[1])],   # pixel-Gaussian pairs
+}
+
+def load_timing(paths):
+    """Measured timing JSONs -> {unit: {op: {"items", "cycles", "latency", "ii", "throughput"}}}"""
+    timing = {}
+    for path in paths:
+        with open(path) as f:
+            d = json.load(f)
+        timing[d["unit"]] = d["ops"]
+    return timing
+
+def measured_cycles(operator_instance, timing):
+    """Cycles of the operator on one measured unit of each kind (latency + (items - 1) x ii), None if not measured"""
+    stages = MEASURED_OPS.get(operator_instance.get_op_type(), [])
+    cycles = []
+    for unit, op, items in stages:
+        if op not in timing.get(unit, {}):
+            return None
+        t = timing[unit][op]
+        cycles.append(t["latency"] + max(items(operator_instance.dim) - 1, 0) * t["ii"])
+    return max(cycles) if cycles else None
+
+def analysis_model(model_operators, system, timing=None):
     roofline_list = []
     for operator_instance in model_operators:
         roofline = operator_instance.get_roofline(system=system)
+        if timing is not None:
+            roofline['Measured Cycles'] = measured_cycles(operator_instance, timing)
         roofline_list.append(roofline)
     df = pd.DataFrame(roofline_list)
     return df
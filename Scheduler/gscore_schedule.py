@@ -1,5 +1,6 @@
 from __future__ import annotations
-import math, itertools, argparse, sys
+import math, argparse, sys, struct, re, json, bisect
+from concurrent.futures import ProcessPoolExecutor
 from dataclasses import dataclass, asdict
 import pandas as pd
 import matplotlib as mpl
@@ -17,14 +18,18 @@ CONFIG = {
                        "VRCore":1.81/64, "Buf":1.25/8},
     "unit_power_W" : {"CCU":0.52/4, "QSU":0.01/8, "BSU":0.05/4,
                        "VRCore":0.25/64, "Buf":0.04/8},
+    # Switching activity behind unit_power_W; a C-model SAIF (--activity) rescales each unit by its
+    # measured toggle rate / this one. Units are the SAIF instances whose path contains the key (CCU_0, QSU_n ...)
+    "ref_toggle_rate": 0.15,
+    "activity_instances": {"CCU":"ccu", "QSU":"qsu", "BSU":"bsu", "VRCore":"vru"},
 
-    # Core timing constants
+    # Core timing constants (paper estimates, replaced by the C-model measurements with --timing)
     "clock_hz":   1_000_000_000,
     "FEATURE_BYTES": 32,
     "BSU_WIDTH":  16,
     "ccu_cycle_per_gauss": 1.0,
     "qsort_cmp_cyc":       1.0,
-    "bsu_cmp_cyc":         0.5,
+    "bsu_cmp_cyc":         0.5,    # per key and merge level; the staged BSU streams one SORT_NUM array per cycle (--timing)
     "dram_load_cyc":       1.0,
     "PIX_CYCLES":          4,
     "GAUSS_HITS_PER_PIXEL":5,
@@ -39,6 +44,7 @@ CONFIG = {
 @dataclass(frozen=True)
 class Scene:
     name:str; gaussians:int; all_points:int; width:int; height:int
+    tile_gauss:tuple = ()       # ((Gaussians of a tile, tiles with that count), ...), from a trace
     @property
     def pixels(self): return self.width * self.height
     @property
@@ -46,6 +52,27 @@ class Scene:
     @property
     def gauss_per_tile(self): return self.all_points / self.tiles
 
+    @classmethod
+    def from_trace(cls, path:str, name:Optional[str]=None) -> "Scene":
+        """Measured scene from a GSCore trace (Hardware/A1_cmod/GSCore/trace/gs_trace.py):
+        all_points = tile-Gaussian pairs, gaussians = distinct visible Gaussians,
+        tile_gauss = histogram of the per-tile Gaussian counts"""
+        buf = np.memmap(path, dtype=np.uint8, mode="r")
+        magic, _, width, height, _, num_tiles, pairs = struct.unpack_from("<4sIIIIIQ", buf, 0)
+        if magic != b"GSTR":
+            raise ValueError(f"{path}: not a GSCore trace")
+        off, gids, counts = 32, [], []
+        for _ in range(num_tiles):
+            _, _, n, _ = struct.unpack_from("<IIII", buf, off)
+            counts.append(n)
+            rec = np.frombuffer(buf, dtype="<u4", count=n * 12, offset=off + 16)
+            gids.append(rec[0::12])                     # gid is the first word of a 48-byte record
+            off += 16 + n * 48
+        gaussians = len(np.unique(np.concatenate(gids))) if gids else 0
+        hist = tuple(zip(*np.unique(counts, return_counts=True))) if counts else ()
+        return cls(name or path, gaussians, int(pairs), width, height,
+                   tuple((int(n), int(k)) for n, k in hist))
+
 @dataclass(frozen=True)
 class Hardware:
     CCU:int; QSU:int; BSU:int; VRCore:int; Buf:int; BW_GBps:float
@@ -62,54 +89,140 @@ class Hardware:
     def dram_bw_Bps(self):
         return self.BW_GBps * 1e9   # convert GB/s → bytes/s
 
+def load_activity(path:str) -> dict:
+    """Toggle rate (toggles per bit per cycle) per unit from a SAIF written by the C models
+    (NRSIM_ACTIVITY in Hardware/A1_cmod/common/include/nrsim_instrument.h)"""
+    with open(path) as f:
+        tokens = re.findall(r'[()]|"[^"]*"|[^\s()]+', f.read())
+    def parse(i):
+        node = []
+        while i < len(tokens):
+            t = tokens[i]
+            if t == "(":
+                child, i = parse(i + 1)
+                node.append(child)
+            elif t == ")":
+                return node, i + 1
+            else:
+                node.append(t)
+                i += 1
+        return node, i
+    root, _ = parse(0)
+    saif = root[0]
+    duration = next(float(x[1]) for x in saif if isinstance(x, list) and x[0] == "DURATION")
+    toggles, bits = {}, {}
+    def walk(inst, path):
+        for x in inst:
+            if not isinstance(x, list):
+                continue
+            if x[0] == "INSTANCE":
+                walk(x[2:], path + [x[1]])
+            elif x[0] == "NET":
+                name = ".".join(path).lower()
+                unit = next((u for u, key in CONFIG["activity_instances"].items() if key in name), None)
+                if unit is None:
+                    continue
+                for net in x[1:]:
+                    tc = next(int(a[1]) for a in net[1:] if a[0] == "TC")
+                    toggles[unit] = toggles.get(unit, 0) + tc
+                    bits[unit] = bits.get(unit, 0) + 1
+    walk(saif, [])
+    cycles = duration * CONFIG["clock_hz"] * 1e-9   # TIMESCALE 1 ns
+    return {u: toggles[u] / (bits[u] * cycles) for u in bits}
+
+def apply_activity(rates:dict):
+    """Scale unit_power_W by the measured activity, units without nets in the SAIF keep the default"""
+    for unit, rate in rates.items():
+        CONFIG["unit_power_W"][unit] *= rate / CONFIG["ref_toggle_rate"]
+
+# Timing constants from the GSCore unit testbenches (nrsim_timing_<unit>.json, Hardware/A1_cmod/common/include/nrsim_timing.h)
+# per CONFIG key: unit, op or value, conversion of the measured number. One unit of each kind per testbench,
+# the sweeps scale by the unit counts as before.
+TIMING_MAP = {
+    "ccu_cycle_per_gauss":  ("CCU", "preprocess", lambda op, v: op["ii"]),
+    # one QSU pass splits into num_subsets at once, the model halves per pass: log2(num_subsets) passes of it
+    "qsort_cmp_cyc":        ("QSU", "partition",  lambda op, v: op["ii"] / math.log2(v.get("num_subsets", 2))),
+    "bsu_cmp_cyc":          ("BSU", "sort",       lambda op, v: op["ii"] / math.log2(v.get("sort_num", CONFIG["BSU_WIDTH"]))),
+    "PIX_CYCLES":           ("VRU", "blend",      lambda op, v: op["ii"]),       # per pixel-Gaussian pair
+    "GAUSS_HITS_PER_PIXEL": ("VRU", None,         lambda op, v: v["gauss_hits_per_pixel"]),
+}
+
+def load_timing(paths:list[str]) -> dict:
+    """CONFIG timing keys measured by the C-model testbenches, keys of units without a JSON are left out"""
+    units = {}
+    for path in paths:
+        with open(path) as f:
+            d = json.load(f)
+        units[d["unit"]] = d
+    measured = {}
+    for key, (unit, op, conv) in TIMING_MAP.items():
+        if unit not in units:
+            continue
+        d = units[unit]
+        if op is not None and (op not in d["ops"] or d["ops"][op]["items"] < 2):
+            continue                          # no ii from fewer than two items
+        measured[key] = conv(d["ops"].get(op), d.get("values", {}))
+    return measured
+
 # ─────────────────────── 2. Core latency model ─────────────────────
 FB   = CONFIG["FEATURE_BYTES"]
 BSUW = CONFIG["BSU_WIDTH"]
 
+# The model is elementwise numpy: a Hardware whose fields are arrays (sweep) evaluates every design
+# point at once, scalar fields give the single point.
+
 def buf_cap(hw):
-    return hw.Buf * BUF_BYTES // FB
+    return np.asarray(hw.Buf) * BUF_BYTES // FB
 
 # --- helpers that understand hw parallelism -------------------------
 
-def qsort_cyc(n:int, qsus:int):
+def ceil_div(a, b):
+    return -(-a // b)
+
+def qsort_cyc(n, qsus):
     """Cycles to quick‑sort *n* keys with *qsus* compare units."""
-    cyc = 0
-    while n > BSUW:
-        comps  = n
-        lanes  = max(1, qsus)
-        steps  = math.ceil(comps / lanes)
-        cyc   += steps * CONFIG["qsort_cmp_cyc"]
-        n      = math.ceil(n / 2)
+    n     = np.asarray(n, dtype=np.int64)
+    lanes = np.maximum(1, qsus)
+    cyc   = np.zeros(np.broadcast(n, lanes).shape)
+    active = n > BSUW
+    while active.any():                       # one pass per halving, points drop out at BSUW keys
+        steps = ceil_div(n, lanes)
+        cyc  += np.where(active, steps * CONFIG["qsort_cmp_cyc"], 0)
+        n     = np.where(active, ceil_div(n, 2), n)
+        active = n > BSUW
     return cyc
 
 
-def bsu_cyc(n:int, bsus:int):
+def bsu_cyc(n, bsus):
     """Cycles to bitonic‑merge *n* keys using *bsus* sorters."""
-    if n <= 1:
-        return 0
+    n     = np.asarray(n, dtype=np.int64)
     comps = n * int(math.log2(BSUW))
-    lanes = max(1, bsus)
-    steps = math.ceil(comps / lanes)
-    return steps * CONFIG["bsu_cmp_cyc"]
+    lanes = np.maximum(1, bsus)
+    steps = ceil_div(comps, lanes)
+    return np.where(n <= 1, 0, steps * CONFIG["bsu_cmp_cyc"])
 
 
-def tile_lat(scene: Scene, hw: Hardware):
-    gpt    = scene.gauss_per_tile
+def tile_lat(scene: Scene, hw: Hardware, gpt=None):
+    gpt    = scene.gauss_per_tile if gpt is None else gpt
     cap    = buf_cap(hw)
-    chunks = max(1, math.ceil(gpt / cap))
+    chunks = np.maximum(1, np.ceil(gpt / cap))
     g      = gpt / chunks
 
     L = g * CONFIG["dram_load_cyc"]
-    S = qsort_cyc(int(g), hw.QSU) + bsu_cyc(int(g), hw.BSU)  # Now using hw.BSU instead of hw.QSU//2
-    R = 256 * CONFIG["GAUSS_HITS_PER_PIXEL"] * CONFIG["PIX_CYCLES"] / hw.VRCore
+    S = qsort_cyc(g.astype(np.int64), hw.QSU) + bsu_cyc(g.astype(np.int64), hw.BSU)  # Now using hw.BSU instead of hw.QSU//2
+    R = 256 * CONFIG["GAUSS_HITS_PER_PIXEL"] * CONFIG["PIX_CYCLES"] / np.asarray(hw.VRCore)
     
-    return chunks * max(L, S, R)   # fully overlapped pipeline
+    return chunks * np.maximum(np.maximum(L, S), R)   # fully overlapped pipeline
 
 
 def frame_cyc(scene: Scene, hw: Hardware):
-    prep = CONFIG["ccu_cycle_per_gauss"] * scene.gaussians / hw.CCU
+    prep = CONFIG["ccu_cycle_per_gauss"] * scene.gaussians / np.asarray(hw.CCU)
     
-    return prep + scene.tiles * tile_lat(scene, hw)
+    if not scene.tile_gauss:
+        return prep + scene.tiles * tile_lat(scene, hw)
+    # Measured scene: tiles are serialized, so the frame is the sum over the uneven tiles,
+    # not tiles x the latency of the mean tile
+    return prep + sum(k * tile_lat(scene, hw, n) for n, k in scene.tile_gauss)
 
 # ──────────────── 3. SRAM & DRAM traffic / energy ────────────────
 
@@ -147,39 +260,63 @@ SWEEP_GRID = {
 }
 
 
-def sweep(scene: Scene) -> pd.DataFrame:
-    rows = []
-    keys = list(SWEEP_GRID.keys())
-    for vals in itertools.product(*SWEEP_GRID.values()):
-        # Create a dictionary of parameter values
-        params = dict(zip(keys, vals))
-        
-        # Calculate BSU as QSU//2
-        params["BSU"] = params["QSU"] // 2
-        
-        # Create Hardware instance with all parameters
-        hw = Hardware(**params)
-        
-        fps, energy_mJ, bw_util = eval_hw(scene, hw)
-        rows.append({**asdict(hw),
-                     "FPS":fps,
-                     "Energy_mJ":energy_mJ,
-                     "Area_mm2":hw.area_mm2(),
-                     "BW_util":bw_util})
-    return pd.DataFrame(rows)
+def sweep(scene: Scene, grid: dict = SWEEP_GRID) -> pd.DataFrame:
+    """Every point of the grid (order of itertools.product over the values) in one vectorized evaluation"""
+    keys = list(grid.keys())
+    mesh = np.meshgrid(*[np.asarray(grid[k]) for k in keys], indexing="ij")
+    params = {k: m.ravel() for k, m in zip(keys, mesh)}
+
+    # Calculate BSU as QSU//2
+    params["BSU"] = params["QSU"] // 2
+
+    # One Hardware holding an array per field
+    hw = Hardware(**params)
+
+    fps, energy_mJ, bw_util = eval_hw(scene, hw)
+    df = pd.DataFrame(asdict(hw))
+    df["FPS"] = fps
+    df["Energy_mJ"] = energy_mJ
+    df["Area_mm2"] = hw.area_mm2()
+    df["BW_util"] = bw_util
+    return df
+
+
+def _sweep_job(job):
+    scene, grid, config = job
+    CONFIG.update(config)                     # measured --timing / --activity values of the parent
+    return sweep(scene, grid)
+
+
+def sweep_scenes(scenes: list[Scene], grid: dict = SWEEP_GRID, jobs: Optional[int] = None) -> list[pd.DataFrame]:
+    """sweep() of several scenes, one process per scene"""
+    if len(scenes) == 1:
+        return [sweep(scenes[0], grid)]
+    with ProcessPoolExecutor(max_workers=jobs) as pool:
+        return list(pool.map(_sweep_job, [(s, grid, CONFIG) for s in scenes]))
 
 
 def pareto(df: pd.DataFrame):
+    """Points no other point matches or beats in FPS, area and energy at once (of equal points the first).
+    Sorted by area, a point is dominated iff an earlier one has no more energy and no less FPS: the
+    staircase of (energy, best FPS) of the points seen answers that with a bisection. Each point enters and
+    leaves the staircase at most once, but the list splice shifts it, so the worst case is O(n * front size),
+    O(n^2) when every point is on the front."""
     df = df.reset_index(drop=True)
-    keep = [True]*len(df)
-    for i in range(len(df)):
-        if not keep[i]:
+    fps, area, energy = (df[c].to_numpy() for c in ("FPS", "Area_mm2", "Energy_mJ"))
+    order = np.lexsort((np.arange(len(df)), -fps, energy, area))
+    stair_e, stair_f = [], []                 # energy ascending, FPS ascending
+    keep = np.zeros(len(df), dtype=bool)
+    for i in order:
+        e, f = energy[i], fps[i]
+        k = bisect.bisect_right(stair_e, e)
+        if k and stair_f[k-1] >= f:
             continue
-        dom = ((df.FPS >= df.FPS[i]) &
-               (df.Area_mm2 <= df.Area_mm2[i]) &
-               (df.Energy_mJ <= df.Energy_mJ[i]))
-        dom.iloc[i] = False
-        keep = [k and not d for k, d in zip(keep, dom)]
+        j = k
+        while j < len(stair_e) and stair_f[j] <= f:
+            j += 1
+        stair_e[k:j] = [e]
+        stair_f[k:j] = [f]
+        keep[i] = True
     return df[keep]
 
 
@@ -188,41 +325,72 @@ def pareto(df: pd.DataFrame):
 def main(argv: list[str]):
     parser = argparse.ArgumentParser()
     parser.add_argument('--csv',   help='dump full sweep to CSV')
-    parser.add_argument('--scene', choices=['lego', 'bicycle'], default='lego',
-                        help='which preset scene to sweep')
+    parser.add_argument('--scene', nargs='+', choices=['lego', 'bicycle'], default=['lego'],
+                        help='preset scenes to sweep (one process each)')
+    parser.add_argument('--trace', nargs='+', help='GSCore scene traces (.gstr), override --scene')
+    parser.add_argument('-p', '--param', action='append', default=[], metavar='NAME=V1,V2|START:STOP[:STEP]',
+                        help='replace the SWEEP_GRID values of a Hardware field (repeatable)')
+    parser.add_argument('-j', '--jobs', type=int, default=None, help='scenes swept concurrently')
+    parser.add_argument('--activity', help='C-model switching activity (.saif), scales unit_power_W')
+    parser.add_argument('--timing', nargs='+', metavar='JSON',
+                        help='measured C-model timing (nrsim_timing_<unit>.json), replaces the timing constants')
     args = parser.parse_args(argv)
 
+    if args.timing:
+        for key, v in load_timing(args.timing).items():
+            print(f"{key}: {CONFIG[key]} -> {v:.4g} (measured)")
+            CONFIG[key] = v
+
+    if args.activity:
+        rates = load_activity(args.activity)
+        apply_activity(rates)
+        print("Measured toggle rates (reference %.2f): " % CONFIG["ref_toggle_rate"]
+              + ", ".join(f"{u} {r:.3f}" for u, r in sorted(rates.items())))
+
     # preset scenes (extend as desired)
-    if args.scene == 'lego':
-        scene = Scene("Lego", 167_894, 1_570_804, 800, 800)
+    presets = {"lego":    Scene("Lego", 167_894, 1_570_804, 800, 800),
+               "bicycle": Scene("Bicycle", 1_656_176, 10_329_175, 4946, 3286)}
+    if args.trace:
+        scenes = [Scene.from_trace(t) for t in args.trace]
     else:
-        scene = Scene("Bicycle", 1_656_176, 10_329_175, 4946, 3286)
+        scenes = [presets[s] for s in args.scene]
+
+    grid = dict(SWEEP_GRID)
+    for p in args.param:
+        name, _, values = p.partition("=")
+        if name not in grid:
+            sys.exit(f"-p {name}: not a SWEEP_GRID field ({', '.join(grid)})")
+        if re.fullmatch(r"\d+:\d+(:\d+)?", values):        # start:stop[:step], stop excluded
+            grid[name] = list(range(*[int(x) for x in values.split(":")]))
+        else:
+            grid[name] = [float(v) if "." in v else int(v) for v in values.split(",") if v]
 
-    df = sweep(scene)
+    dfs = sweep_scenes(scenes, grid, args.jobs)
 
     # optional CSV dump
     if args.csv:
-        df.to_csv(args.csv, index=False)
+        pd.concat([df.assign(Scene=scene.name) for scene, df in zip(scenes, dfs)]).to_csv(args.csv, index=False)
         print(f"CSV written -> {args.csv}")
 
-    # add GSCore reference design (4/8/4/64/8 @ 51.2 GB/s)
-    g_hw = Hardware(CCU=4, QSU=8, BSU=4, VRCore=64, Buf=8, BW_GBps=51.2)
-    g_fps, g_e, g_bw = eval_hw(scene, g_hw)
-    g_point = {**asdict(g_hw), "FPS":g_fps, "Energy_mJ":g_e,
-               "Area_mm2":g_hw.area_mm2(), "BW_util":g_bw}
-
-    # print Pareto
-    good  = df[df.FPS >= 30]
-    front = pareto(good)
-    print(f"\nPareto front (≥30 FPS, {scene.name}):")
-    print(front.sort_values(['Area_mm2','Energy_mJ'])
-               [["CCU","QSU","BSU","VRCore","Buf","BW_GBps",
-                 "Area_mm2","Energy_mJ","FPS","BW_util"]]
-               .to_string(index=False,formatters={
-                   "Area_mm2":"{:.2f}".format,
-                   "Energy_mJ":"{:.1f}".format,
-                   "FPS":"{:.0f}".format,
-                   "BW_util":"{:.2f}".format}))
+    for scene, df in zip(scenes, dfs):
+        # add GSCore reference design (4/8/4/64/8 @ 51.2 GB/s)
+        g_hw = Hardware(CCU=4, QSU=8, BSU=4, VRCore=64, Buf=8, BW_GBps=51.2)
+        g_fps, g_e, g_bw = eval_hw(scene, g_hw)
+        g_point = {**asdict(g_hw), "FPS":g_fps, "Energy_mJ":g_e,
+                   "Area_mm2":g_hw.area_mm2(), "BW_util":g_bw}
+
+        # print Pareto
+        good  = df[df.FPS >= 30]
+        front = pareto(good)
+        print(f"\nPareto front (≥30 FPS, {scene.name}, {len(df)} points):")
+        print(front.sort_values(['Area_mm2','Energy_mJ'])
+                   [["CCU","QSU","BSU","VRCore","Buf","BW_GBps",
+                     "Area_mm2","Energy_mJ","FPS","BW_util"]]
+                   .to_string(index=False,formatters={
+                       "Area_mm2":"{:.2f}".format,
+                       "Energy_mJ":"{:.1f}".format,
+                       "FPS":"{:.0f}".format,
+                       "BW_util":"{:.2f}".format}))
 
 # ─────────────────────────── entry ──────────────────────────
 if __name__ == "__main__":